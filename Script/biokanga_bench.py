@@ -0,0 +1,368 @@
+#!/usr/bin/env python3
+# Reproducible end-to-end benchmarks of the core biokanga pipelines over synthetic datasets
+# Datasets are generated deterministically for each requested scale:
+#   seed genome      - pseudo-random multifasta generated by this script from the random seed
+#   genome           - 'kangarg' randomised seed genome, maintaining trinucleotide composition
+#   SE, PE reads     - 'biokanga simreads' from the genome, with simulated sequencer errors
+#   RNA-seq reads    - 'biokanga simreads' from spliced transcripts of generated gene models (BED12) for control and experiment
+#                      conditions, in the experiment condition every OverExprGene'th gene is OverExprFold times over represented
+#   long reads       - 'biokanga simreads' long reads for 'pacbiokanga ecreads'
+# The pipelines then benchmarked are: index, align (SE and PE), filter, assemb, ngsqc, rnade and pacbiokanga ecreads
+# For each benchmarked pipeline the wall time, throughput, peak resident memory of the process and the per-phase timings
+# as recorded by the process into the SQLite summary database ('-q' option, tables TblPhases and TblPhaseCounters) are
+# written as JSON and CSV to the output directory.
+# If a baseline JSON, from a previous run, is specified then the wall time and peak memory relative to that baseline are also reported.
+# Example: python3 Script/biokanga_bench.py --bindir . --scales small --outdir bench --baseline bench_prev/bench_results.json
+
+import argparse
+import csv
+import json
+import os
+import platform
+import random
+import sqlite3
+import subprocess
+import sys
+import time
+
+# dataset scales, genome size in bp and numbers of reads to simulate
+Scales = {
+    "tiny":   {"GenomeLen": 1000000,   "NumChroms": 2,  "SEReads": 50000,    "PEPairs": 25000,    "RNAReads": 20000,   "LongReads": 200,   "LongReadLen": 3000},
+    "small":  {"GenomeLen": 10000000,  "NumChroms": 4,  "SEReads": 1000000,  "PEPairs": 500000,   "RNAReads": 250000,  "LongReads": 2000,  "LongReadLen": 5000},
+    "medium": {"GenomeLen": 50000000,  "NumChroms": 8,  "SEReads": 5000000,  "PEPairs": 2500000,  "RNAReads": 1000000, "LongReads": 10000, "LongReadLen": 8000},
+    "large":  {"GenomeLen": 200000000, "NumChroms": 12, "SEReads": 20000000, "PEPairs": 10000000, "RNAReads": 4000000, "LongReads": 40000, "LongReadLen": 10000}}
+
+ReadLen = 100             # simulated short read length
+PEMinFrag = 250           # simulated PE fragment lengths
+PEMaxFrag = 450
+GeneSpacing = 10000       # gene models are placed every GeneSpacing bp along each chromosome
+GeneLen = 3000            # each gene model spans this many bp with 3 exons
+SeqErrRate = "0.01"       # simulated dynamic sequencer error rate
+OverExprGene = 5          # in the experiment condition every OverExprGene'th gene
+OverExprFold = 4          # is over represented this many fold
+
+# all benchmarked steps in the order executed
+AllSteps = ["index", "alignse", "alignpe", "filter", "assemb", "ngsqc", "rnade", "ecreads"]
+
+def locate_exe(bindir, name):
+    # executables may be in their automake build subdirectories, directly in bindir, or on the PATH
+    exe = name + (".exe" if platform.system() == "Windows" else "")
+    for cand in (os.path.join(bindir, name, exe), os.path.join(bindir, exe)):
+        if os.path.isfile(cand) and os.access(cand, os.X_OK):
+            return os.path.abspath(cand)
+    for path in os.environ.get("PATH", "").split(os.pathsep):
+        cand = os.path.join(path, exe)
+        if os.path.isfile(cand) and os.access(cand, os.X_OK):
+            return cand
+    return None
+
+def run_timed(cmd, logfile):
+    # run cmd, returning exit code, wall seconds and peak resident memory (KB, None if not available on this platform)
+    with open(logfile, "a") as log:
+        log.write("# " + " ".join(cmd) + "\n")
+        log.flush()
+        start = time.time()
+        proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT)
+        if hasattr(os, "wait4"):
+            _, status, usage = os.wait4(proc.pid, 0)
+            wall = time.time() - start
+            proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+            peakrss = usage.ru_maxrss
+            if platform.system() == "Darwin":  # reported in bytes on OSX, KB on Linux
+                peakrss //= 1024
+        else:
+            proc.wait()
+            wall = time.time() - start
+            peakrss = None
+    return proc.returncode, wall, peakrss
+
+def gen_seed_genome(fname, scale, seed):
+    # pseudo-random genome, deterministic for a given seed; composition is then randomised by kangarg
+    rng = random.Random(seed)
+    chromlen = scale["GenomeLen"] // scale["NumChroms"]
+    with open(fname, "w") as out:
+        for chrom in range(scale["NumChroms"]):
+            out.write(">Chr%d\n" % (chrom + 1))
+            for ofs in range(0, chromlen, 80):
+                out.write("".join(rng.choice("ACGT") for _ in range(min(80, chromlen - ofs))) + "\n")
+
+def gen_gene_models(fname, scale):
+    # BED12 gene models, 3 exons each, alternating strands
+    chromlen = scale["GenomeLen"] // scale["NumChroms"]
+    exonlen = GeneLen // 5
+    with open(fname, "w") as out:
+        geneid = 0
+        for chrom in range(scale["NumChroms"]):
+            for start in range(GeneSpacing // 2, chromlen - GeneLen, GeneSpacing):
+                geneid += 1
+                out.write("Chr%d\t%d\t%d\tGene%d\t0\t%s\t%d\t%d\t0\t3\t%d,%d,%d,\t0,%d,%d,\n" %
+                          (chrom + 1, start, start + GeneLen, geneid, "+" if geneid % 2 else "-", start, start + GeneLen,
+                           exonlen, exonlen, exonlen, 2 * exonlen, GeneLen - exonlen))
+
+def load_fasta(fname):
+    seqs = {}
+    name = None
+    with open(fname) as fasta:
+        for line in fasta:
+            line = line.strip()
+            if line[:1] == ">":
+                name = line[1:].split()[0]
+                seqs[name] = []
+            elif name is not None:
+                seqs[name].append(line)
+    return dict((name, "".join(lines)) for name, lines in seqs.items())
+
+def revcpl(seq):
+    return seq[::-1].translate(RevCplTrans)
+
+RevCplTrans = str.maketrans("ACGTNacgtn", "TGCANtgcan")
+
+def gen_transcripts(fname, genome, genesbed, bExperiment):
+    # spliced transcript sequences for gene models, 'biokanga simreads' requires a bioseq genome when simulating from BED
+    # features so transcripts are instead extracted here and reads simulated directly from these
+    seqs = load_fasta(genome)
+    with open(genesbed) as bed, open(fname, "w") as out:
+        for geneidx, line in enumerate(bed):
+            fields = line.rstrip().split("\t")
+            chrom, start, strand = fields[0], int(fields[1]), fields[5]
+            sizes = [int(x) for x in fields[10].strip(",").split(",")]
+            starts = [int(x) for x in fields[11].strip(",").split(",")]
+            seq = "".join(seqs[chrom][start + exstart:start + exstart + size] for exstart, size in zip(starts, sizes))
+            if strand == "-":
+                seq = revcpl(seq)
+            copies = OverExprFold if bExperiment and (geneidx + 1) % OverExprGene == 0 else 1
+            for copy in range(copies):
+                out.write(">%s_%d\n%s\n" % (fields[3], copy + 1, seq))
+
+def num_fasta_bases(fname):
+    bases = 0
+    with open(fname) as fasta:
+        for line in fasta:
+            if line[:1] != ">":
+                bases += len(line.strip())
+    return bases
+
+def max_processing_id(sumdb):
+    if not os.path.isfile(sumdb):
+        return 0
+    conn = sqlite3.connect(sumdb)
+    try:
+        row = conn.execute("SELECT MAX(ProcessingID) FROM TblProcessing").fetchone()
+    except sqlite3.Error:
+        row = None
+    conn.close()
+    return row[0] if row and row[0] else 0
+
+def phase_timings(sumdb, after_id):
+    # per-phase timings and counters recorded by processing instances with identifiers greater than after_id
+    phases = []
+    if not os.path.isfile(sumdb):
+        return phases
+    conn = sqlite3.connect(sumdb)
+    try:
+        for phaseid, name, elapsed, peakrss in conn.execute(
+                "SELECT PhaseID,PhaseName,ElapsedSecs,PeakRSSKB FROM TblPhases WHERE ProcessingID > ? ORDER BY PhaseID", (after_id,)):
+            counters = {}
+            for cname, total, nsamples, minsample, maxsample in conn.execute(
+                    "SELECT CounterName,Total,NumSamples,MinSample,MaxSample FROM TblPhaseCounters WHERE PhaseID = ?", (phaseid,)):
+                counters[cname] = {"Total": total, "NumSamples": nsamples, "Min": minsample, "Max": maxsample}
+            phases.append({"Phase": name, "ElapsedSecs": elapsed, "PeakRSSKB": peakrss, "Counters": counters})
+    except sqlite3.Error:
+        pass
+    conn.close()
+    return phases
+
+class Bench(object):
+    def __init__(self, args):
+        self.args = args
+        self.results = []
+        self.biokanga = locate_exe(args.bindir, "biokanga")
+        self.kangarg = locate_exe(args.bindir, "kangarg")
+        self.pacbiokanga = locate_exe(args.bindir, "pacbiokanga")
+        if self.biokanga is None:
+            sys.exit("Unable to locate 'biokanga' executable in '%s' or on the PATH" % args.bindir)
+
+    def common(self, scalename, step):
+        # options common to all biokanga/pacbiokanga subprocesses: logging, threads and SQLite summary
+        return ["-F", os.path.join(self.logdir, "%s_%s.log" % (scalename, step)),
+                "-T", str(self.args.threads),
+                "-q", self.sumdb, "-w", "bench_" + scalename, "-W", "biokanga_bench"]
+
+    def prepare(self, scalename, scale, datadir):
+        # generate datasets, reusing any previously generated for the same scale and seed
+        seed = self.args.seed
+        marker = os.path.join(datadir, "datasets.done")
+        if os.path.isfile(marker):
+            with open(marker) as f:
+                if f.read().strip() == "seed=%d" % seed:
+                    return True
+        genome = os.path.join(datadir, "genome.fa")
+        seedgenome = os.path.join(datadir, "seed_genome.fa")
+        gen_seed_genome(seedgenome, scale, seed)
+        if self.kangarg is not None:
+            rc, _, _ = run_timed([self.kangarg, "-m0", "-k3", "-s%d" % seed, "-i", seedgenome, "-o", genome,
+                                  "-F", os.path.join(self.logdir, scalename + "_kangarg.log")], self.cmdlog)
+            if rc != 0:
+                print("kangarg failed, see '%s'" % self.cmdlog)
+                return False
+        else:
+            print("kangarg not located, using seed genome directly")
+            os.rename(seedgenome, genome)
+        gen_gene_models(os.path.join(datadir, "genes.bed"), scale)
+        gen_transcripts(os.path.join(datadir, "transcripts_ctl.fa"), genome, os.path.join(datadir, "genes.bed"), False)
+        gen_transcripts(os.path.join(datadir, "transcripts_exp.fa"), genome, os.path.join(datadir, "genes.bed"), True)
+
+        simreads = [self.biokanga, "simreads", "-T", str(self.args.threads)]
+        onGenome = ["-i", genome, "-y%d" % seed]
+        sims = [onGenome + ["-n%d" % scale["SEReads"], "-l%d" % ReadLen, "-g3", "-z" + SeqErrRate, "-o", os.path.join(datadir, "se.fa")],
+                onGenome + ["-n%d" % (scale["PEPairs"] * 2), "-l%d" % ReadLen, "-g3", "-z" + SeqErrRate, "-p", "-j%d" % PEMinFrag, "-J%d" % PEMaxFrag,
+                    "-o", os.path.join(datadir, "pe1.fa"), "-O", os.path.join(datadir, "pe2.fa")],
+                ["-i", os.path.join(datadir, "transcripts_ctl.fa"), "-y%d" % (seed + 1), "-n%d" % scale["RNAReads"], "-l%d" % ReadLen, "-g3", "-z" + SeqErrRate,
+                    "-o", os.path.join(datadir, "rna_ctl.fa")],
+                ["-i", os.path.join(datadir, "transcripts_exp.fa"), "-y%d" % (seed + 2), "-n%d" % scale["RNAReads"], "-l%d" % ReadLen, "-g3", "-z" + SeqErrRate,
+                    "-o", os.path.join(datadir, "rna_exp.fa")],
+                onGenome + ["-n%d" % scale["LongReads"], "-l%d" % scale["LongReadLen"], "-g3", "-z" + SeqErrRate, "-o", os.path.join(datadir, "long.fa")]]
+        for sim in sims:
+            rc, _, _ = run_timed(simreads + sim + ["-F", os.path.join(self.logdir, scalename + "_simreads.log")], self.cmdlog)
+            if rc != 0:
+                print("simreads failed, see '%s'" % self.cmdlog)
+                return False
+        with open(marker, "w") as f:
+            f.write("seed=%d\n" % seed)
+        return True
+
+    def step(self, scalename, step, cmd, units, count):
+        # execute and record a single benchmarked step
+        prev_id = max_processing_id(self.sumdb)
+        print("[%s] %s ..." % (scalename, step), end="")
+        sys.stdout.flush()
+        rc, wall, peakrss = run_timed(cmd, self.cmdlog)
+        rslt = {"Scale": scalename, "Step": step, "ExitCode": rc, "WallSecs": round(wall, 3), "PeakRSSKB": peakrss,
+                "Units": units, "Count": count, "Throughput": round(count / wall, 1) if wall > 0 and rc == 0 else None,
+                "Phases": phase_timings(self.sumdb, prev_id), "Command": " ".join(cmd)}
+        self.results.append(rslt)
+        print(" exit %d, %.1fs, %s %s/sec, peak %s KB" % (rc, wall, rslt["Throughput"], units, peakrss))
+        return rc == 0
+
+    def run_scale(self, scalename):
+        scale = Scales[scalename]
+        datadir = os.path.join(self.args.outdir, "data_" + scalename)
+        wrkdir = os.path.join(self.args.outdir, "work_" + scalename)
+        for d in (datadir, wrkdir):
+            if not os.path.isdir(d):
+                os.makedirs(d)
+        if not self.prepare(scalename, scale, datadir):
+            return
+        data = lambda f: os.path.join(datadir, f)
+        work = lambda f: os.path.join(wrkdir, f)
+        bk = self.biokanga
+        genomebases = num_fasta_bases(data("genome.fa"))
+        steps = [s for s in AllSteps if self.args.steps is None or s in self.args.steps]
+
+        if "index" in steps or not os.path.isfile(work("genome.sfx")):
+            self.step(scalename, "index", [bk, "index", "-i", data("genome.fa"), "-o", work("genome.sfx"), "-r", "bench"] +
+                      self.common(scalename, "index"), "bp", genomebases)
+        if "alignse" in steps:
+            self.step(scalename, "alignse", [bk, "align", "-I", work("genome.sfx"), "-i", data("se.fa"), "-o", work("se.sam")] +
+                      self.common(scalename, "alignse"), "reads", scale["SEReads"])
+        if "alignpe" in steps:
+            self.step(scalename, "alignpe", [bk, "align", "-I", work("genome.sfx"), "-U1", "-i", data("pe1.fa"), "-u", data("pe2.fa"),
+                      "-d%d" % PEMinFrag, "-D%d" % PEMaxFrag, "-o", work("pe.sam")] +
+                      self.common(scalename, "alignpe"), "reads", scale["PEPairs"] * 2)
+        if "filter" in steps or ("assemb" in steps and not os.path.isfile(work("filtered.pkd"))):
+            self.step(scalename, "filter", [bk, "filter", "-m1", "-i", data("pe1.fa"), "-I", data("pe2.fa"), "-o", work("filtered.pkd")] +
+                      self.common(scalename, "filter"), "reads", scale["PEPairs"] * 2)
+        if "assemb" in steps:
+            self.step(scalename, "assemb", [bk, "assemb", "-m2", "-i", work("filtered.pkd"), "-o", work("contigs.fa")] +
+                      self.common(scalename, "assemb"), "reads", scale["PEPairs"] * 2)
+        if "ngsqc" in steps:
+            self.step(scalename, "ngsqc", [bk, "ngsqc", "-i", data("se.fa"), "-o", work("ngsqc.csv")] +
+                      self.common(scalename, "ngsqc"), "reads", scale["SEReads"])
+        if "rnade" in steps:
+            aligned = True
+            for cond in ("ctl", "exp"):
+                if not os.path.isfile(work("rna_%s.sam" % cond)):
+                    rc, _, _ = run_timed([bk, "align", "-I", work("genome.sfx"), "-i", data("rna_%s.fa" % cond), "-o", work("rna_%s.sam" % cond)] +
+                                         self.common(scalename, "rnaalign"), self.cmdlog)
+                    aligned = aligned and rc == 0
+            if aligned:
+                self.step(scalename, "rnade", [bk, "rnade", "-i", work("rna_ctl.sam"), "-I", work("rna_exp.sam"), "-g", data("genes.bed"),
+                          "-o", work("rnade.csv")] + self.common(scalename, "rnade"), "reads", scale["RNAReads"] * 2)
+        if "ecreads" in steps:
+            if self.pacbiokanga is None:
+                print("[%s] ecreads skipped, unable to locate 'pacbiokanga' executable" % scalename)
+            else:
+                longlen = scale["LongReadLen"]
+                self.step(scalename, "ecreads", [self.pacbiokanga, "ecreads", "-i", data("long.fa"), "-o", work("long_ec.fa"),
+                          "-l%d" % (longlen // 2), "-L%d" % (longlen * 2), "-b%d" % (longlen // 4), "-S%d" % (longlen // 4)] +
+                          self.common(scalename, "ecreads"), "reads", scale["LongReads"])
+
+    def run(self):
+        if not os.path.isdir(self.args.outdir):
+            os.makedirs(self.args.outdir)
+        self.logdir = os.path.join(self.args.outdir, "logs")
+        if not os.path.isdir(self.logdir):
+            os.makedirs(self.logdir)
+        self.cmdlog = os.path.join(self.logdir, "commands.log")
+        self.sumdb = os.path.abspath(os.path.join(self.args.outdir, "bench_summary.sqlite"))
+        for scalename in self.args.scales:
+            self.run_scale(scalename)
+        self.write_results()
+
+    def write_results(self):
+        baseline = {}
+        if self.args.baseline:
+            with open(self.args.baseline) as f:
+                for rslt in json.load(f)["Results"]:
+                    baseline[(rslt["Scale"], rslt["Step"])] = rslt
+        for rslt in self.results:
+            base = baseline.get((rslt["Scale"], rslt["Step"]))
+            if base and base["ExitCode"] == 0 and rslt["ExitCode"] == 0 and base["WallSecs"] > 0:
+                rslt["WallVsBaseline"] = round(rslt["WallSecs"] / base["WallSecs"], 3)
+                if base["PeakRSSKB"] and rslt["PeakRSSKB"]:
+                    rslt["PeakRSSVsBaseline"] = round(float(rslt["PeakRSSKB"]) / base["PeakRSSKB"], 3)
+
+        jsonfile = os.path.join(self.args.outdir, "bench_results.json")
+        with open(jsonfile, "w") as f:
+            json.dump({"Host": platform.node(), "Platform": platform.platform(), "Threads": self.args.threads,
+                       "Seed": self.args.seed, "Timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+                       "Results": self.results}, f, indent=1)
+
+        # flattened CSV, one row per step plus one row per recorded phase
+        csvfile = os.path.join(self.args.outdir, "bench_results.csv")
+        with open(csvfile, "w") as f:
+            out = csv.writer(f)
+            out.writerow(["Scale", "Step", "Phase", "ExitCode", "WallSecs", "PeakRSSKB", "Units", "Count", "Throughput", "WallVsBaseline", "PeakRSSVsBaseline"])
+            for rslt in self.results:
+                out.writerow([rslt["Scale"], rslt["Step"], "", rslt["ExitCode"], rslt["WallSecs"], rslt["PeakRSSKB"], rslt["Units"], rslt["Count"],
+                              rslt["Throughput"], rslt.get("WallVsBaseline", ""), rslt.get("PeakRSSVsBaseline", "")])
+                for phase in rslt["Phases"]:
+                    out.writerow([rslt["Scale"], rslt["Step"], phase["Phase"], "", phase["ElapsedSecs"], phase["PeakRSSKB"], "", "", "", "", ""])
+        print("Results written to '%s' and '%s'" % (jsonfile, csvfile))
+        return all(rslt["ExitCode"] == 0 for rslt in self.results)
+
+def main():
+    parser = argparse.ArgumentParser(description="Reproducible end-to-end benchmarks of biokanga pipelines over synthetic datasets")
+    parser.add_argument("--bindir", default=".", help="top build directory, or directory containing biokanga, kangarg and pacbiokanga executables")
+    parser.add_argument("--scales", default="small", help="comma separated dataset scales: " + ",".join(sorted(Scales)))
+    parser.add_argument("--steps", default=None, help="comma separated steps to benchmark (default all): " + ",".join(AllSteps))
+    parser.add_argument("--outdir", default="bench", help="datasets, outputs and results are written into this directory")
+    parser.add_argument("--threads", type=int, default=0, help="number of processing threads (default 0 for number of CPU cores)")
+    parser.add_argument("--seed", type=int, default=1234, help="random seed used for all dataset generation")
+    parser.add_argument("--baseline", default=None, help="report relative to results JSON from a previous benchmark run")
+    args = parser.parse_args()
+    args.scales = [s for s in args.scales.split(",") if s]
+    for s in args.scales:
+        if s not in Scales:
+            parser.error("unknown scale '%s'" % s)
+    if args.steps is not None:
+        args.steps = [s for s in args.steps.split(",") if s]
+        for s in args.steps:
+            if s not in AllSteps:
+                parser.error("unknown step '%s'" % s)
+    bench = Bench(args)
+    bench.run()
+    sys.exit(0 if all(rslt["ExitCode"] == 0 for rslt in bench.results) else 1)
+
+if __name__ == "__main__":
+    main()
@@ -127,6 +127,7 @@ CAligner::Align(etPMode PMode,			// processing mode
 		char **ppszExcludeChroms)		// array of exclude chromosome regular expressions
 {
 int Rslt;
+int PhaseID;								// telemetry phase identifier as returned by gSQLiteSummaries.StartPhase()
 int Idx;
 int BuffLen = 0;
 int BuffOfs = 0;
@@ -199,6 +200,10 @@ m_SAMFormat = SAMFormat;
 m_PEproc = PEproc;
 m_QMethod = Quality;
 m_NumThreads = NumThreads;
+
+// on multinode hosts worker threads may be pinned onto NUMA nodes, reads are then accessed by threads on all nodes so are interleaved over the nodes
+if(CNUMATopology::Discover() > 1 && CNUMATopology::PinThreads())
+	m_ReadHitsArena.SetPlacement(cMemArenaDefaults | cMemArenaInterleave);
 m_bBisulfite = bBisulfite;
 m_MaxMLmatches = MaxMLmatches;
 m_bClampMaxMLmatches = bClampMaxMLmatches;
@@ -399,26 +404,12 @@ if(m_MLMode >= eMLall || m_FMode == eFMsamAll)
 	{
 	size_t memreq = (size_t)(sizeof(tsReadHit) + 150) * 5 * cAllocMultihits;	// read sizes not known yet so assume 100bp reads plus long descriptors plus many multiloci - realloc'd as may be required
 
-#ifdef _WIN32
-	m_pMultiAll = (tsReadHit *) malloc(memreq);	// initial and perhaps the only allocation
-
-	if(m_pMultiAll == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes for multiAll - %s",(INT64)memreq,strerror(errno));
-		Reset(false);
-		return(eBSFerrMem);
-		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pMultiAll = (tsReadHit *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pMultiAll == MAP_FAILED)
+	if((m_pMultiAll = (tsReadHit *)m_MultiAllArena.Grow(memreq)) == NULL)	// initial and perhaps the only allocation
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes for multiAll through mmap()  failed - %s",(INT64)memreq,strerror(errno));
-		m_pMultiAll = NULL;
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes for multiAll failed",(INT64)memreq);
 		Reset(false);
 		return(eBSFerrMem);
 		}
-#endif
 	m_AllocMultiAllMem = memreq;
 	m_NumMultiAll = 0;
 	m_NxtMultiAllOfs = 0;
@@ -537,16 +528,7 @@ m_OrigNumReadsLoaded = m_NumReadsLoaded;		// make a copy of actual number of rea
 if(m_MLMode >= eMLall)		// a little involved as need to reuse m_pReadHits ptrs so sorting and reporting of multi-SAM hits will be same as if normal processing...
 	{
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Treating accepted %d multialigned reads as uniquely aligned %d source reads in subsequent processing",m_TotAcceptedAsMultiAligned,m_TotLociAligned - m_TotAcceptedAsUniqueAligned);
-	if(m_pReadHits != NULL)
-		{
-#ifdef _WIN32
-		free(m_pReadHits);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-		if(m_pReadHits != MAP_FAILED)
-			munmap(m_pReadHits,m_AllocdReadHitsMem);
-#endif
-		m_pReadHits = NULL;
-		}
+	m_ReadHitsArena.Transfer(&m_MultiAllArena);
 	m_pReadHits = m_pMultiAll;
 	m_pMultiAll = NULL;
 	m_AllocdReadHitsMem = m_AllocMultiAllMem;
@@ -569,11 +551,14 @@ if(m_MLMode >= eMLall)		// a little involved as need to reuse m_pReadHits ptrs s
 if(PEproc != ePEdefault)
 	{
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Paired end association and partner alignment processing started..");
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"PairedEnds") : 0;
 	if((Rslt=ProcessPairedEnds(PEproc,MinEditDist,PairMinLen,PairMaxLen,bPairStrand,m_InitalAlignSubs)) < eBSFSuccess)
 		{
 		Reset(false);
 		return(Rslt);
 		}
+	if(PhaseID > 0)
+		gSQLiteSummaries.EndPhase(PhaseID);
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Paired end association and partner alignment processing completed..");
 	}
 
@@ -582,11 +567,14 @@ if(PEproc != ePEdefault)
 if(PEproc == ePEdefault && m_MLMode > eMLrand && m_MLMode != eMLall)
 	{
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Multialignment processing started..");
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"MultiAlign") : 0;
 	if((Rslt = AssignMultiMatches()) < eBSFSuccess)
 		{
 		Reset(false);
 		return(Rslt);
 		}
+	if(PhaseID > 0)
+		gSQLiteSummaries.EndPhase(PhaseID);
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Multialignment processing completed");
 	}
 
@@ -596,11 +584,14 @@ IdentifyConstraintViolations(PEproc != ePEdefault);
 if(PEproc == ePEdefault && PCRartefactWinLen >= 0)
 	{
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Processing to reduce PCR differential amplification artefacts processing started..");
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"PCRartefacts") : 0;
 	if((Rslt=ReducePCRduplicates(PCRartefactWinLen)) < eBSFSuccess)
 		{
 		Reset(false);
 		return(Rslt);
 		}
+	if(PhaseID > 0)
+		gSQLiteSummaries.EndPhase(PhaseID);
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"PCR differential amplification artefacts processing completed");
 	}
 
@@ -707,6 +698,7 @@ if(m_NARAccepted && m_hSitePrefsFile != -1)
 
 // now time to write out the read hits
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Reporting of aligned result set started...");
+PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"Reporting") : 0;
 if(FMode >= eFMsam)
 	{
 	if(m_hJctOutFile != -1 || m_hIndOutFile != -1)	// even though SAM for read alignments, splice and indels are reported as BED format
@@ -728,6 +720,8 @@ if(Rslt < eBSFSuccess)
 	Reset(false);
 	return(Rslt);
 	}
+if(PhaseID > 0)
+	gSQLiteSummaries.EndPhase(PhaseID);
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Reporting of aligned result set completed");
 
 if(m_bPEInsertLenDist && m_NARAccepted)
@@ -754,7 +748,10 @@ if(Rslt >= eBSFSuccess && m_NARAccepted && MinSNPreads > 0 && m_hSNPfile != -1)
 		}
 	else
 		bMarkers = false;
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"SNPs") : 0;
 	Rslt = ProcessSNPs();			// track title if output format is to be UCSC BED, will have '_SNPs' appended
+	if(PhaseID > 0)
+		gSQLiteSummaries.EndPhase(PhaseID);
 	if(Rslt >= eBSFSuccess)
 		{
 		if(bMarkers)
@@ -809,6 +806,8 @@ m_pMultiHits = NULL;
 m_pMultiAll = NULL;
 m_pLociPValues = NULL;
 m_pSfxArray = NULL;
+m_NumNodeSfxArrays = 0;
+memset(m_pNodeSfxArrays,0,sizeof(m_pNodeSfxArrays));
 m_pPriorityRegionBED = NULL;
 m_pAllocsIdentNodes = NULL;
 m_pAllocsMultiHitLoci = NULL;
@@ -842,6 +841,8 @@ m_UsedReadHitsMem = 0;
 m_FinalReadID = 0;
 m_NumDescrReads = 0;
 m_FinalReadID = 0;
+m_NxtRdsBlockIdx = 0;
+m_NumRdsBlocksLoaded = 0;
 m_AllocdReadHitsIdx = 0;
 m_AllocdMultiHits = 0;
 m_AllocdMultiHitsMem = 0;
@@ -1161,6 +1162,7 @@ if(m_pAllocsMultiHitLoci != NULL)
 	delete m_pAllocsMultiHitLoci;
 	m_pAllocsMultiHitLoci = NULL;
 	}
+DeleteNodeSfxArrays();			// replicas share entries with m_pSfxArray so must be deleted first
 if(m_pSfxArray != NULL)
 	{
 	delete m_pSfxArray;
@@ -1174,23 +1176,13 @@ if(m_pPriorityRegionBED != NULL)
 
 if(m_pReadHits != NULL)
 	{
-#ifdef _WIN32
-	free(m_pReadHits);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pReadHits != MAP_FAILED)
-		munmap(m_pReadHits,m_AllocdReadHitsMem);
-#endif
+	m_ReadHitsArena.Release();
 	m_pReadHits = NULL;
 	}
 
 if(m_pMultiAll != NULL)
 	{
-#ifdef _WIN32
-	free(m_pMultiAll);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pMultiAll != MAP_FAILED)
-		munmap(m_pMultiAll,m_AllocMultiAllMem);
-#endif
+	m_MultiAllArena.Release();
 	m_pMultiAll = NULL;
 	}
 
@@ -4622,6 +4614,25 @@ pthread_exit(NULL);
 #endif
 }
 
+#ifdef _WIN32
+unsigned __stdcall LoadRdsBlocksThread(void * pThreadPars)
+#else
+void *LoadRdsBlocksThread(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsLoadRdsBlocksThreadPars *pPars = (tsLoadRdsBlocksThreadPars *)pThreadPars;	// makes it easier not having to deal with casts!
+CAligner *pAligner = (CAligner *)pPars->pThis;
+Rslt = pAligner->ProcLoadRdsBlocks(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
 int
 CAligner::InitiateLoadingReads(void)
 {
@@ -6485,13 +6496,7 @@ pthread_mutex_lock(&m_hMtxMultiMatches);
 if(m_NxtMultiAllOfs + (2 * HitLen) >= m_AllocMultiAllMem)
 	{
 	size_t memreq = m_AllocMultiAllMem + (cAllocMultihits * HitLen);
-#ifdef _WIN32
-	pMultiHit = (tsReadHit *) realloc(m_pMultiAll,memreq);
-#else
-	pMultiHit = (tsReadHit *)mremap(m_pMultiAll,m_AllocMultiAllMem,memreq,MREMAP_MAYMOVE);
-	if(pMultiHit == MAP_FAILED)
-		pMultiHit = NULL;
-#endif
+	pMultiHit = (tsReadHit *)m_MultiAllArena.Grow(memreq);
 	if(pMultiHit == NULL)
 		{
 #ifdef _WIN32
@@ -6499,7 +6504,7 @@ ReleaseMutex(m_hMtxMultiMatches);
 #else
 pthread_mutex_unlock(&m_hMtxMultiMatches);
 #endif
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddMultiHit: Memory re-allocation to %lld bytes - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddMultiHit: Memory re-allocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 	m_pMultiAll = pMultiHit;
@@ -7934,38 +7939,30 @@ if(m_FileHdr.NumRds == 0 || m_FileHdr.TotReadsLen == 0)
 	return(eBSFerrOpnFile);
 	}
 
+// V7 reads files are block indexed, blocks are mapped and concurrently decoded
+if(m_FileHdr.Version >= 7)
+	{
+	delete [] pReadBuff;
+	close(m_hInFile);
+	m_hInFile = -1;
+	return(LoadBlockedReads(pszRdsFile));
+	}
+
 // initial allocation of memory to hold all pre-processed reads plus a little safety margin (10000) bytes)
 memreq = ((size_t)m_FileHdr.NumRds * sizeof(tsReadHit)) + (size_t)m_FileHdr.TotReadsLen + 10000;
 AcquireSerialise();
 AcquireLock(true);
-#ifdef _WIN32
-m_pReadHits = (tsReadHit *) malloc(memreq);	// initial and perhaps the only allocation
-
-if(m_pReadHits == NULL)
+// initial and perhaps the only allocation, grown in place if more memory is required
+if((m_pReadHits = (tsReadHit *)m_ReadHitsArena.Grow(memreq)) == NULL)
 	{
 	ReleaseLock(true);
 	ReleaseSerialise();
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes - %s",(INT64)memreq,strerror(errno));
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes failed",(INT64)memreq);
 	delete pReadBuff;
 	close(m_hInFile);
 	m_hInFile = -1;
 	return(eBSFerrMem);
 	}
-#else
-// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-m_pReadHits = (tsReadHit *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-if(m_pReadHits == MAP_FAILED)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)memreq,strerror(errno));
-	m_pReadHits = NULL;
-	ReleaseLock(true);
-	ReleaseSerialise();
-	delete pReadBuff;
-	close(m_hInFile);
-	m_hInFile = -1;
-	return(eBSFerrMem);
-	}
-#endif
 
 m_AllocdReadHitsMem = memreq;
 m_UsedReadHitsMem = 0;
@@ -8015,18 +8012,12 @@ while((RdLen = read(m_hInFile,&pReadBuff[BuffLen],cRdsBuffAlloc - BuffLen)) > 0)
 			memreq = m_AllocdReadHitsMem + ((sizeof(tsReadHit) + (size_t)cDfltReadLen) * cReadsHitReAlloc);
 			gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadReads: Needing memory re-allocation to %lld bytes from %lld",(INT64)m_AllocdReadHitsMem,(INT64)memreq);
 
-#ifdef _WIN32
-			pReadHit = (tsReadHit *) realloc(m_pReadHits,memreq);
-#else
-			pReadHit = (tsReadHit *)mremap(m_pReadHits,m_AllocdReadHitsMem,memreq,MREMAP_MAYMOVE);
-			if(pReadHit == MAP_FAILED)
-				pReadHit = NULL;
-#endif
+			pReadHit = (tsReadHit *)m_ReadHitsArena.Grow(memreq);
 			if(pReadHit == NULL)
 				{
 				ReleaseLock(true);
 				ReleaseSerialise();
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory re-allocation to %lld bytes - %s",(INT64)(m_AllocdReadHitsMem + ((sizeof(tsReadHit) + cDfltReadLen)*cReadsHitReAlloc)),strerror(errno));
+				gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory re-allocation to %lld bytes failed",(INT64)memreq);
 				delete pReadBuff;
 				close(m_hInFile);
 				m_hInFile = -1;
@@ -8092,6 +8083,162 @@ if(m_NumDescrReads != m_NumReadsLoaded)
 return(m_NumDescrReads);
 }
 
+// LoadBlockedReads
+// V7 reads files are mapped and the blocks of reads decoded by multiple threads, each block being decoded into its own precomputed region of m_pReadHits
+// As blocks are decoded the reads in the leading contiguous blocks are made available to the aligner threads
+int
+CAligner::LoadBlockedReads(char *pszRdsFile)	// file containing V7 block indexed preprocessed reads
+{
+int Rslt;
+int BlockIdx;
+int NumBlocks;
+int NumThreads;
+int ThreadIdx;
+size_t memreq;
+size_t *pBlockHitsOfs;
+UINT8 *pBlockLoaded;
+tsRdsV7BlockDir *pBlockDir;
+CRdsBlocks RdsBlocks;
+tsLoadRdsBlocksThreadPars LoadThreads[cMaxWorkerThreads];
+
+if((Rslt = RdsBlocks.Open(pszRdsFile)) != eBSFSuccess)
+	return(Rslt);
+NumBlocks = RdsBlocks.GetNumBlocks();
+
+pBlockHitsOfs = new size_t [NumBlocks + 1];
+pBlockLoaded = new UINT8 [NumBlocks + 1];
+memset(pBlockLoaded,0,NumBlocks + 1);
+pBlockHitsOfs[0] = 0;
+for(BlockIdx = 0; BlockIdx < NumBlocks; BlockIdx++)
+	{
+	pBlockDir = RdsBlocks.GetBlockDir(BlockIdx);
+	pBlockHitsOfs[BlockIdx + 1] = pBlockHitsOfs[BlockIdx] + ((size_t)pBlockDir->NumReads * sizeof(tsReadHit)) + (size_t)pBlockDir->TotDescrLen + (size_t)pBlockDir->TotBases;
+	}
+
+// block directory provides the exact memory required to hold all reads plus a little safety margin (10000) bytes)
+memreq = pBlockHitsOfs[NumBlocks] + 10000;
+AcquireSerialise();
+AcquireLock(true);
+if((m_pReadHits = (tsReadHit *)m_ReadHitsArena.Grow(memreq)) == NULL)
+	{
+	ReleaseLock(true);
+	ReleaseSerialise();
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadBlockedReads: Memory allocation of %lld bytes failed",(INT64)memreq);
+	delete [] pBlockHitsOfs;
+	delete [] pBlockLoaded;
+	return(eBSFerrMem);
+	}
+m_AllocdReadHitsMem = memreq;
+m_UsedReadHitsMem = 0;
+m_FinalReadID = 0;
+m_NumReadsLoaded = 0;
+m_NumDescrReads = 0;
+m_NxtRdsBlockIdx = 0;
+m_NumRdsBlocksLoaded = 0;
+ReleaseLock(true);
+ReleaseSerialise();
+
+NumThreads = min(m_NumThreads,NumBlocks);
+if(NumThreads < 1)
+	NumThreads = 1;
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadBlockedReads: Decoding %d blocks of reads using %d threads",NumBlocks,NumThreads);
+
+memset(LoadThreads,0,sizeof(LoadThreads));
+for(ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++)
+	{
+	LoadThreads[ThreadIdx].ThreadIdx = ThreadIdx + 1;
+	LoadThreads[ThreadIdx].pThis = this;
+	LoadThreads[ThreadIdx].pRdsBlocks = &RdsBlocks;
+	LoadThreads[ThreadIdx].NumBlocks = NumBlocks;
+	LoadThreads[ThreadIdx].pBlockHitsOfs = pBlockHitsOfs;
+	LoadThreads[ThreadIdx].pBlockLoaded = pBlockLoaded;
+#ifdef _WIN32
+	LoadThreads[ThreadIdx].threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,LoadRdsBlocksThread,&LoadThreads[ThreadIdx],0,&LoadThreads[ThreadIdx].threadID);
+#else
+	LoadThreads[ThreadIdx].threadRslt =	pthread_create (&LoadThreads[ThreadIdx].threadID , NULL , LoadRdsBlocksThread , &LoadThreads[ThreadIdx] );
+#endif
+	}
+
+Rslt = eBSFSuccess;
+for(ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++)
+	{
+#ifdef _WIN32
+	while(WAIT_TIMEOUT == WaitForSingleObject( LoadThreads[ThreadIdx].threadHandle, 60000))
+		{
+		}
+	CloseHandle( LoadThreads[ThreadIdx].threadHandle);
+#else
+	struct timespec ts;
+	int JoinRlt;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += 60;
+	while((JoinRlt = pthread_timedjoin_np(LoadThreads[ThreadIdx].threadID, NULL, &ts)) != 0)
+		{
+		ts.tv_sec += 60;
+		}
+#endif
+	if(LoadThreads[ThreadIdx].Rslt < eBSFSuccess)
+		Rslt = LoadThreads[ThreadIdx].Rslt;
+	}
+delete [] pBlockHitsOfs;
+delete [] pBlockLoaded;
+if(Rslt < eBSFSuccess)
+	return(Rslt);
+return(m_NumDescrReads);
+}
+
+int
+CAligner::ProcLoadRdsBlocks(tsLoadRdsBlocksThreadPars *pPars)
+{
+int BlockIdx;
+int RecIdx;
+tsRdsV7Block *pBlock;
+tsRdsV7Read *pRead;
+tsRdsV7BlockDir *pBlockDir;
+tsReadHit *pReadHit;
+
+while(1)
+	{
+	AcquireSerialise();
+	BlockIdx = m_NxtRdsBlockIdx < pPars->NumBlocks ? m_NxtRdsBlockIdx++ : -1;
+	ReleaseSerialise();
+	if(BlockIdx < 0)
+		break;
+	if((pBlock = pPars->pRdsBlocks->GetBlock(BlockIdx)) == NULL)
+		return(eBSFerrFileAccess);
+
+	pReadHit = (tsReadHit *)((UINT8 *)m_pReadHits + pPars->pBlockHitsOfs[BlockIdx]);
+	for(RecIdx = 0; RecIdx < pBlock->NumReads; RecIdx++)
+		{
+		pRead = CRdsBlocks::GetRead(pBlock,RecIdx);
+		memset(pReadHit,0,sizeof(tsReadHit));
+		pReadHit->HitLoci.Hit.Seg[0].Strand = '?';
+		pReadHit->ReadLen = pRead->ReadLen;
+		pReadHit->DescrLen = pRead->DescrLen;
+		pReadHit->ReadID = pBlock->StartReadID + RecIdx;
+		pReadHit->PairReadID = pRead->PairReadID;
+		pReadHit->NumReads = pRead->NumReads;
+		memcpy(pReadHit->Read,CRdsBlocks::GetDescr(pBlock,pRead),pRead->DescrLen + 1);
+		CRdsBlocks::UnpackRead(pBlock,pRead,&pReadHit->Read[pRead->DescrLen + 1]);
+		pReadHit = (tsReadHit *)((UINT8 *)pReadHit + sizeof(tsReadHit) + pRead->ReadLen + pRead->DescrLen);
+		}
+
+	// reads are made available to the aligner threads in file order as the leading blocks are decoded
+	AcquireSerialise();
+	pPars->pBlockLoaded[BlockIdx] = 1;
+	while(m_NumRdsBlocksLoaded < pPars->NumBlocks && pPars->pBlockLoaded[m_NumRdsBlocksLoaded])
+		{
+		pBlockDir = pPars->pRdsBlocks->GetBlockDir(m_NumRdsBlocksLoaded++);
+		m_NumDescrReads += pBlockDir->NumReads;
+		m_UsedReadHitsMem = pPars->pBlockHitsOfs[m_NumRdsBlocksLoaded];
+		}
+	m_FinalReadID = m_NumDescrReads;
+	m_NumReadsLoaded = m_NumDescrReads;
+	ReleaseSerialise();
+	}
+return(eBSFSuccess);
+}
+
 int
 CAligner::CreateMutexes(void)
 {
@@ -8218,8 +8365,12 @@ UINT32 PrevReadsLoaded;
 int MaxNumSlides;
 
 int ThreadIdx;
+int PhaseID;
 tsThreadMatchPars WorkerThreads[cMaxWorkerThreads];
 
+// phase includes loading of the suffix array; per thread read counts are sampled as each worker thread is joined
+PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"Align") : 0;
+
 m_PerThreadAllocdIdentNodes = cMaxNumIdentNodes;
 m_TotAllocdIdentNodes = m_PerThreadAllocdIdentNodes * m_NumThreads;
 if((m_pAllocsIdentNodes = new tsIdentNode [m_TotAllocdIdentNodes])==NULL)
@@ -8270,6 +8421,9 @@ if((Rslt=m_pSfxArray->SetTargBlock(CurBlockID))<0)
 	}
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Genome assembly suffix array loaded");
 
+if((Rslt = ReplicateSfxArray()) < eBSFSuccess)
+	return(Rslt);
+
 	// determine minimum core length from targeted sequence length
 	// core length is a balance between sensitivity and throughput
 	// reducing core size has a relatively minor effect on sensitivity but significantly reduces throughput
@@ -8333,6 +8487,11 @@ for(ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++)
 	else
 		WorkerThreads[ThreadIdx].pszOutBuff = NULL;
 	WorkerThreads[ThreadIdx].OutBuffIdx = 0;
+	WorkerThreads[ThreadIdx].NUMANode = CNUMATopology::ThreadNode(ThreadIdx);
+	if(WorkerThreads[ThreadIdx].NUMANode >= 0 && WorkerThreads[ThreadIdx].NUMANode < m_NumNodeSfxArrays)
+		WorkerThreads[ThreadIdx].pSfxArray = m_pNodeSfxArrays[WorkerThreads[ThreadIdx].NUMANode];
+	else
+		WorkerThreads[ThreadIdx].pSfxArray = m_pSfxArray;
 #ifdef _WIN32
 	WorkerThreads[ThreadIdx].threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,CoredApproxThread,&WorkerThreads[ThreadIdx],0,&WorkerThreads[ThreadIdx].threadID);
 #else
@@ -8389,6 +8548,12 @@ for(ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++)
 	MinusHits += WorkerThreads[ThreadIdx].MinusHits;
 	ChimericHits += WorkerThreads[ThreadIdx].ChimericHits;
 	TotNumReadsProc += WorkerThreads[ThreadIdx].NumReadsProc;
+	if(PhaseID > 0)
+		{
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"ReadsProcessed",WorkerThreads[ThreadIdx].NumReadsProc);
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"PlusHits",WorkerThreads[ThreadIdx].PlusHits);
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"MinusHits",WorkerThreads[ThreadIdx].MinusHits);
+		}
 
 	if(WorkerThreads[ThreadIdx].OutBuffIdx != 0)
 		{
@@ -8416,6 +8581,9 @@ for(ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++)
 		}
 	}
 
+// all alignment threads have completed so any node local suffix array replicas are no longer required
+DeleteNodeSfxArrays();
+
 // pickup the read loader thread, if the reads processing threads all finished then the loader thread should also have finished
 #ifdef _WIN32
 if(m_hThreadLoadReads != NULL)
@@ -8450,6 +8618,8 @@ if(m_ThreadLoadReadsRslt < 0 || m_ThreadCoredApproxRslt < 0)
 	}
 ApproxNumReadsProcessed(&CurReadsProcessed,&CurReadsLoaded);
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Alignment of %u from %u loaded completed",CurReadsProcessed,CurReadsLoaded);
+if(PhaseID > 0)
+	gSQLiteSummaries.EndPhase(PhaseID);
 
 m_PerThreadAllocdIdentNodes = 0;
 m_TotAllocdIdentNodes = 0;
@@ -8487,6 +8657,48 @@ return(eBSFSuccess);
 
 
 
+int
+CAligner::ReplicateSfxArray(void)		// if requested then replicate suffix array onto each NUMA node
+{
+int NodeIdx;
+int NumNodes;
+
+DeleteNodeSfxArrays();
+if(CNUMATopology::IdxMode() != eNUMAIdxReplicate || !CNUMATopology::PinThreads() || (NumNodes = CNUMATopology::NumNodes()) < 2)
+	return(eBSFSuccess);
+
+// primary suffix array was placed onto the first node when loaded, replicas are placed onto the remaining nodes
+m_pNodeSfxArrays[0] = m_pSfxArray;
+m_NumNodeSfxArrays = 1;
+for(NodeIdx = 1; NodeIdx < NumNodes; NodeIdx++)
+	{
+	if((m_pNodeSfxArrays[NodeIdx] = m_pSfxArray->Replicate(CNUMATopology::NodeID(NodeIdx))) == NULL)
+		{
+		while(m_pSfxArray->NumErrMsgs())
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,m_pSfxArray->GetErrMsg());
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Fatal: unable to replicate suffix array onto NUMA node %d",CNUMATopology::NodeID(NodeIdx));
+		DeleteNodeSfxArrays();
+		return(eBSFerrMem);
+		}
+	m_NumNodeSfxArrays += 1;
+	}
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Genome assembly suffix array replicated onto %d NUMA nodes",m_NumNodeSfxArrays);
+return(eBSFSuccess);
+}
+
+void
+CAligner::DeleteNodeSfxArrays(void)		// delete any NUMA node replicas of suffix array
+{
+int NodeIdx;
+for(NodeIdx = 1; NodeIdx < m_NumNodeSfxArrays; NodeIdx++)
+	{
+	if(m_pNodeSfxArrays[NodeIdx] != NULL)
+		delete m_pNodeSfxArrays[NodeIdx];
+	}
+m_NumNodeSfxArrays = 0;
+memset(m_pNodeSfxArrays,0,sizeof(m_pNodeSfxArrays));
+}
+
 int
 CAligner::ProcCoredApprox(tsThreadMatchPars *pPars)
 {
@@ -8563,7 +8775,11 @@ memset(MultiHitDist,0,sizeof(MultiHitDist));
 ExtdProcFlags = 0;
 pPrevReadHit = NULL;
 PrevMatchLen = 0;
-MaxIter = m_pSfxArray->GetMaxIter();
+
+// when pinned onto a NUMA node then this thread's ident nodes and multihit loci, which are yet to be touched, will also be placed onto that node
+if(pPars->NUMANode >= 0)
+	CNUMATopology::BindThread(pPars->NUMANode);
+MaxIter = pPars->pSfxArray->GetMaxIter();
 
 
 // m_hRwLock will be released and regained within ThreadedIterReads so need to always have acquired a read lock before calling ThreadedIterReads
@@ -8665,7 +8881,7 @@ while(ThreadedIterReads(&ReadsHitBlock))
 			bProcNorm = true;
 			if(RefExacts > 0)
 				{
-				HitRslt = m_pSfxArray->AlignReads(ExtdProcFlags,						// flags indicating if lower levels need to do any form of extended processing with this specific read...
+				HitRslt = pPars->pSfxArray->AlignReads(ExtdProcFlags,						// flags indicating if lower levels need to do any form of extended processing with this specific read...
 														pReadHit->ReadID,				// identifies this read
 														pPars->MinChimericLen,			// minimum chimeric length as a percentage (0 to disable, otherwise 50..99) of probe sequence
 														MaxTotMM,						// max number of mismatches allowed
@@ -8742,7 +8958,7 @@ while(ThreadedIterReads(&ReadsHitBlock))
 				if(m_bLocateBestMatches)
 					{
 					HitRslt =						// < 0 if errors, 0 if no matches, 1..MaxHits, or MaxHits+1 if additional matches have been sloughed
-						m_pSfxArray->LocateBestMatches(pReadHit->ReadID,			// identifies this read
+						pPars->pSfxArray->LocateBestMatches(pReadHit->ReadID,			// identifies this read
 											MaxTotMM,			        // return matches having at most this number of mismatches
 											CoreLen,					// core window length
 											CoreDelta,					// core window offset increment (1..n)
@@ -8762,7 +8978,7 @@ while(ThreadedIterReads(&ReadsHitBlock))
 							HitRslt = eHRhits;
 					}
 				else
-					HitRslt = m_pSfxArray->AlignReads(ExtdProcFlags,					// flags indicating if lower levels need to do any form of extended processing with this specific read...
+					HitRslt = pPars->pSfxArray->AlignReads(ExtdProcFlags,					// flags indicating if lower levels need to do any form of extended processing with this specific read...
 														pReadHit->ReadID,				// identifies this read
 														pPars->MinChimericLen,			// minimum chimeric length as a percentage (0 to disable, otherwise 50..99) of probe sequence
 														MaxTotMM,CoreLen,CoreDelta,
@@ -10131,27 +10347,13 @@ if(m_pReadHits == NULL)
 	memreq = cDataBuffAlloc;
 	AcquireSerialise();
 	AcquireLock(true);
-#ifdef _WIN32
-	m_pReadHits = (tsReadHit *) malloc((size_t)memreq);
-	if(m_pReadHits == NULL)
+	if((m_pReadHits = (tsReadHit *)m_ReadHitsArena.Grow((size_t)memreq)) == NULL)
 		{
 		ReleaseLock(true);
 		ReleaseSerialise();
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddEntry: Memory allocation of %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pReadHits = (tsReadHit *)mmap(NULL,(size_t)memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pReadHits == MAP_FAILED)
-		{
-		m_pReadHits = NULL;
-		ReleaseLock(true);
-		ReleaseSerialise();
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddEntry: Memory allocation of %lld bytes through mmap()  failed",(INT64)memreq,strerror(errno));
-		return(eBSFerrMem);
-		}
-#endif
 	m_AllocdReadHitsMem = memreq;
 	m_DataBuffOfs = 0;
 	ReleaseLock(true);
@@ -10164,18 +10366,10 @@ if((m_AllocdReadHitsMem - m_DataBuffOfs) < (sizeof(tsReadHit) +  ReadLen + Descr
 	memreq = m_AllocdReadHitsMem + cDataBuffAlloc;
 	AcquireSerialise();
 	AcquireLock(true);
-#ifdef _WIN32
-	pTmpAlloc = (UINT8 *) realloc(m_pReadHits,memreq);
+	pTmpAlloc = (UINT8 *)m_ReadHitsArena.Grow(memreq);
 	if(pTmpAlloc == NULL)
 		{
-#else
-	pTmpAlloc = (UINT8 *)mremap(m_pReadHits,m_AllocdReadHitsMem,memreq,MREMAP_MAYMOVE);
-	if(pTmpAlloc == MAP_FAILED)
-		{
-		pTmpAlloc = NULL;
-#endif
-
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddEntry: Memory reallocation to %lld bytes failed - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddEntry: Memory reallocation to %lld bytes failed",(INT64)memreq);
 		ReleaseLock(true);
 		ReleaseSerialise();
 		return(eBSFerrMem);
@@ -10322,6 +10516,10 @@ UINT32 NxtToSample;
 
 CFasta PE1Fasta;
 CFasta PE2Fasta;
+CReadsIngest ReadsIngest;
+bool bIngest;
+tsFastqRecView *pPE1Rec;
+tsFastqRecView *pPE2Rec;
 
 INT32 EstScoreSchema;				// guestimated scoring schema - 0: no scoring, 1: Solexa, 2: Illumina 1.3+, 3: Illumina 1.5+, 4: Illumina 1.8+ or could be Sanger 
 INT32 EstSeqLen;
@@ -10411,30 +10609,15 @@ AcquireLock(true);
 if(m_pReadHits == NULL)
 	{
 	m_AllocdReadHitsMem = (size_t)ReqAllocSize;
-#ifdef _WIN32
-	m_pReadHits = (tsReadHit *) malloc((size_t)m_AllocdReadHitsMem);
-	if(m_pReadHits == NULL)
+	if((m_pReadHits = (tsReadHit *)m_ReadHitsArena.Grow((size_t)m_AllocdReadHitsMem)) == NULL)
 		{
 		ReleaseLock(true);
 		ReleaseSerialise();
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Concatenated sequences memory allocation of %lld bytes - %s",(INT64)m_AllocdReadHitsMem,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Concatenated sequences memory allocation of %lld bytes failed",(INT64)m_AllocdReadHitsMem);
 		PE1Fasta.Close();
 		m_AllocdReadHitsMem = 0;
 		return(eBSFerrMem);
 		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pReadHits = (tsReadHit *)mmap(NULL,m_AllocdReadHitsMem, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pReadHits == MAP_FAILED)
-		{
-		ReleaseLock(true);
-	    ReleaseSerialise();
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Concatenated sequences memory of %lld bytes through mmap()  failed - %s",(INT64)m_AllocdReadHitsMem,strerror(errno));
-		PE1Fasta.Close();
-		m_pReadHits = NULL;
-		return(eBSFerrMem);
-		}
-#endif
 	m_DataBuffOfs = 0;
 
 	}
@@ -10445,16 +10628,12 @@ else
 	if((m_DataBuffOfs + ReqAllocSize + 0x0fffff) >= m_AllocdReadHitsMem)		// 1M as a small safety margin!
 		{
 		memreq = (size_t)(m_AllocdReadHitsMem + ReqAllocSize);
-#ifdef _WIN32
-		pDstSeq = (UINT8 *) realloc(m_pReadHits,memreq);
-#else
-		pDstSeq = (UINT8 *)mremap(m_pReadHits,m_AllocdReadHitsMem,memreq,MREMAP_MAYMOVE);
-		if(pDstSeq == MAP_FAILED)
-			pDstSeq = NULL;
-#endif
+		pDstSeq = (UINT8 *)m_ReadHitsArena.Grow(memreq);
 		if(pDstSeq == NULL)
 			{
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSeq: Memory re-allocation to %lld bytes - %s",memreq,strerror(errno));
+			ReleaseLock(true);
+			ReleaseSerialise();
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSeq: Memory re-allocation to %lld bytes failed",(INT64)memreq);
 			PE1Fasta.Close();
 			return(eBSFerrMem);
 			}
@@ -10465,6 +10644,27 @@ else
 ReleaseLock(true);
 ReleaseSerialise();
 
+// fastq reads are loaded and parsed in chunks by ingestion threads concurrently with this thread, chunks are dequeued in file order
+// so read identifiers and PE1/PE2 pairings are as if the reads had been parsed serially; multifasta and colorspace continue to be parsed serially
+bIngest = false;
+pPE1Rec = NULL;
+pPE2Rec = NULL;
+if(bIsFastq && !m_bIsSOLiD)
+	{
+	if((Rslt = (teBSFrsltCodes)ReadsIngest.Open(pszPE1File,bIsPairReads ? pszPE2File : NULL,max(1,m_NumThreads/2),true)) != eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Load: Unable to start concurrent loading of '%s'",pszPE1File);
+		PE1Fasta.Close();
+		if(bIsPairReads)
+			PE2Fasta.Close();
+		return(Rslt);
+		}
+	PE1Fasta.Close();			// no longer required, releases the staging buffers
+	if(bIsPairReads)
+		PE2Fasta.Close();
+	bIngest = true;
+	}
+
 PE1NumUnsupportedBases = 0;
 PE1NumDescrReads = 0;
 PE1NumReadsAccepted = 0;
@@ -10488,17 +10688,27 @@ bPE2SimReads = false;
 NxtToSample = m_SampleNthRawRead;
 
 
-while((Rslt = (teBSFrsltCodes)(PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,sizeof(szPE1ReadBuff)-1,true,false))) > eBSFSuccess)
+while((Rslt = (teBSFrsltCodes)(PE1ReadLen = bIngest ? ReadsIngest.NxtRec(&pPE1Rec,&pPE2Rec) : PE1Fasta.ReadSequence(szPE1ReadBuff,sizeof(szPE1ReadBuff)-1,true,false))) > eBSFSuccess)
 	{
 	if(m_TermBackgoundThreads != 0)	// need to immediately self-terminate?
 		break;
 
 	PE1NumDescrReads += 1;
-	if(PE1ReadLen == eBSFFastaDescr)		// just read a descriptor line which would be as expected for multifasta or fastq
+	if(bIngest || PE1ReadLen == eBSFFastaDescr)		// just read a descriptor line which would be as expected for multifasta or fastq
 		{
-		PE1DescrLen = PE1Fasta.ReadDescriptor((char *)szPE1DescrBuff,sizeof(szPE1DescrBuff)-1);
-		szPE1DescrBuff[cMaxDescrLen-1] = '\0';
-		PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,sizeof(szPE1ReadBuff)-1);
+		if(bIngest)
+			{
+			PE1DescrLen = min(pPE1Rec->DescrLen,(int)sizeof(szPE1DescrBuff)-2);
+			memcpy(szPE1DescrBuff,pPE1Rec->pDescr,PE1DescrLen);
+			szPE1DescrBuff[PE1DescrLen] = '\0';
+			PE1ReadLen = pPE1Rec->SeqLen < (int)sizeof(szPE1ReadBuff) ? CFasta::Ascii2Sense(pPE1Rec->pSeq,pPE1Rec->SeqLen,(etSeqBase *)szPE1ReadBuff) : cMaxReadLen + 1;
+			}
+		else
+			{
+			PE1DescrLen = PE1Fasta.ReadDescriptor((char *)szPE1DescrBuff,sizeof(szPE1DescrBuff)-1);
+			szPE1DescrBuff[cMaxDescrLen-1] = '\0';
+			PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,sizeof(szPE1ReadBuff)-1);
+			}
 		if(PE1ReadLen < 0 || PE1ReadLen == eBSFFastaDescr || PE1ReadLen > cMaxReadLen)
 			{
 			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing sequence after %d reads parsed",PE1NumDescrReads);
@@ -10521,7 +10731,7 @@ while((Rslt = (teBSFrsltCodes)(PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,
 		// if paired end processing then also load PE2 read
 		if(bIsPairReads)
 			{
-			if((Rslt = (teBSFrsltCodes)(PE2ReadLen = PE2Fasta.ReadSequence(szPE2ReadBuff,sizeof(szPE2ReadBuff)-1,true,false))) <= eBSFSuccess)
+			if((Rslt = (teBSFrsltCodes)(PE2ReadLen = bIngest ? eBSFFastaDescr : PE2Fasta.ReadSequence(szPE2ReadBuff,sizeof(szPE2ReadBuff)-1,true,false))) <= eBSFSuccess)
 				{
 				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing sequence after %d reads parsed",PE2NumDescrReads);
 				if(PE2NumDescrReads)
@@ -10537,10 +10747,20 @@ while((Rslt = (teBSFrsltCodes)(PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,
 			PE2NumDescrReads += 1;
 			if(PE2ReadLen == eBSFFastaDescr)		// just read a descriptor line which would be as expected for multifasta or fastq
 				{
-				PE2DescrLen = PE2Fasta.ReadDescriptor((char *)szPE2DescrBuff,sizeof(szPE2DescrBuff)-1);
-				szPE2DescrBuff[cMaxDescrLen-1] = '\0';
-				PE2ReadLen = PE2Fasta.ReadSequence(szPE2ReadBuff,sizeof(szPE2ReadBuff)-1);
-				if(PE2ReadLen < 0  || PE1ReadLen == eBSFFastaDescr  || PE1ReadLen > cMaxReadLen)
+				if(bIngest)
+					{
+					PE2DescrLen = min(pPE2Rec->DescrLen,(int)sizeof(szPE2DescrBuff)-2);
+					memcpy(szPE2DescrBuff,pPE2Rec->pDescr,PE2DescrLen);
+					szPE2DescrBuff[PE2DescrLen] = '\0';
+					PE2ReadLen = pPE2Rec->SeqLen < (int)sizeof(szPE2ReadBuff) ? CFasta::Ascii2Sense(pPE2Rec->pSeq,pPE2Rec->SeqLen,(etSeqBase *)szPE2ReadBuff) : cMaxReadLen + 1;
+					}
+				else
+					{
+					PE2DescrLen = PE2Fasta.ReadDescriptor((char *)szPE2DescrBuff,sizeof(szPE2DescrBuff)-1);
+					szPE2DescrBuff[cMaxDescrLen-1] = '\0';
+					PE2ReadLen = PE2Fasta.ReadSequence(szPE2ReadBuff,sizeof(szPE2ReadBuff)-1);
+					}
+				if(PE2ReadLen < 0  || PE2ReadLen == eBSFFastaDescr  || PE2ReadLen > cMaxReadLen)
 					{
 					gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing sequence after %d reads parsed",PE2NumDescrReads);
 					gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",szPE2DescrBuff);
@@ -10665,7 +10885,14 @@ while((Rslt = (teBSFrsltCodes)(PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,
 
 		if(bIsFastq && m_QMethod != eFQIgnore)
 			{
-			PE1QualLen = PE1Fasta.ReadQValues((char *)szPE1QualBuff,sizeof(szPE1QualBuff)-1);
+			if(bIngest)
+				{
+				PE1QualLen = min(pPE1Rec->QualLen,(int)sizeof(szPE1QualBuff)-2);
+				memcpy(szPE1QualBuff,pPE1Rec->pQual,PE1QualLen);
+				szPE1QualBuff[PE1QualLen] = '\0';
+				}
+			else
+				PE1QualLen = PE1Fasta.ReadQValues((char *)szPE1QualBuff,sizeof(szPE1QualBuff)-1);
 			if(PE1QualLen != PE1ReadLen)		// must be same...
 				{
 				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Load: quality length (%d) not same as read length (%d) for '%s' entry in file '%s'",PE1QualLen,PE1ReadLen,szPE1DescrBuff,pszPE1File);
@@ -10745,7 +10972,14 @@ while((Rslt = (teBSFrsltCodes)(PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,
 
 			if(bIsPairReads)
 				{
-				PE2QualLen = PE2Fasta.ReadQValues((char *)szPE2QualBuff,sizeof(szPE2QualBuff)-1);
+				if(bIngest)
+					{
+					PE2QualLen = min(pPE2Rec->QualLen,(int)sizeof(szPE2QualBuff)-2);
+					memcpy(szPE2QualBuff,pPE2Rec->pQual,PE2QualLen);
+					szPE2QualBuff[PE2QualLen] = '\0';
+					}
+				else
+					PE2QualLen = PE2Fasta.ReadQValues((char *)szPE2QualBuff,sizeof(szPE2QualBuff)-1);
 				if(PE2QualLen != PE2ReadLen)		// must be same...
 					{
 					gDiagnostics.DiagOut(eDLFatal,gszProcName,"Load: quality length (%d) not same as read length (%d) for '%s' entry in file '%s'",PE2QualLen,PE2ReadLen,szPE2DescrBuff,pszPE2File);
@@ -10911,6 +11145,8 @@ while((Rslt = (teBSFrsltCodes)(PE1ReadLen = PE1Fasta.ReadSequence(szPE1ReadBuff,
 		return(eBSFerrParse);
 		}
 	}
+if(bIngest)
+	ReadsIngest.Close();
 if(Rslt != eBSFSuccess)
 	{
 	if(m_TermBackgoundThreads == 0)
@@ -7,7 +7,7 @@
 
 #pragma once
 
-const int cBSFRdsVersion = 6;			// latest file header version which can be handled
+const int cBSFRdsVersion = 7;			// latest file header version which can be handled, V7 is block indexed
 const int cBSFRdsVersionBack= 5;		// backward compatible to this version
 
 const unsigned int cMaxInFileSpecs = 100;	// allow user to specify upto this many input file specs
@@ -375,6 +375,8 @@ typedef struct TAG_sThreadMatchPars {
 	int OutBuffIdx;					// index at which to write next formated hit into szOutBuff
 	UINT8 *pszOutBuff;				// used to buffer multiple hit formated output records prior to writing to disk
 	tsHitLoci *pMultiHits;			// allocated to hold read multihit loci
+	int NUMANode;					// if >= 0 then thread is pinned onto this NUMA node (index into CNUMATopology nodes)
+	CSfxArrayV3 *pSfxArray;			// align against this suffix array, will be a node local replica if index is being replicated onto each NUMA node
 } tsThreadMatchPars;
 
 typedef struct TAG_sClusterThreadPars {
@@ -407,6 +409,24 @@ typedef struct TAG_sLoadReadsThreadPars {
 	int Rslt;						// returned result code
 } tsLoadReadsThreadPars;
 
+typedef struct TAG_sLoadRdsBlocksThreadPars {
+	int ThreadIdx;					// uniquely identifies this thread
+	void *pThis;					// will be initialised to pt to CAligner instance
+
+#ifdef _WIN32
+	HANDLE threadHandle;			// handle as returned by _beginthreadex()
+	unsigned int threadID;			// identifier as set by _beginthreadex()
+#else
+	int threadRslt;					// result as returned by pthread_create ()
+	pthread_t threadID;				// identifier as set by pthread_create ()
+#endif
+	CRdsBlocks *pRdsBlocks;			// blocks are decoded from this mapped V7 reads file
+	int NumBlocks;					// number of blocks to be decoded
+	size_t *pBlockHitsOfs;			// each block's reads are decoded into m_pReadHits starting at these offsets
+	UINT8 *pBlockLoaded;			// set non-zero as each block is decoded
+	int Rslt;						// returned result code
+} tsLoadRdsBlocksThreadPars;
+
 
 typedef struct TAG_sReadsHitBlock {
 	int NumReads;			// number of reads for processing in this block
@@ -450,12 +470,14 @@ class CAligner
 	UINT32 m_NumDescrReads;			// number of reads thus far parsed
 
 	tsReadHit *m_pReadHits;			// memory allocated to hold reads, reads are written contiguously into this memory
-									// caution: m_pReadHits is allocated/freed with malloc/realloc/free or mmap/mremap/munmap
+	CMemArena m_ReadHitsArena;		// m_pReadHits is allocated from this arena, grown in place as more reads are loaded
 	size_t m_AllocdReadHitsMem;		// how many bytes of memory  for reads have been allocated
 	size_t m_UsedReadHitsMem;		// how many bytes of allocated reads memory is currently used
 	UINT32 m_NumReadsLoaded;		// m_pReadHits contains this many reads
 	UINT32 m_OrigNumReadsLoaded;	// if multiloci read alignments being treated as if each was a separate read then this is a copy of m_NumReadsLoaded prior to overwriting with the multiloci read count 
 	UINT32 m_FinalReadID;			// final read identifier loaded as a preprocessed read (tsProcRead)
+	int m_NxtRdsBlockIdx;			// next V7 reads block to be decoded
+	int m_NumRdsBlocksLoaded;		// this many V7 reads blocks, in file order, have been decoded and their reads made available
 	UINT32 m_PrevSizeOf;			// size (UINT8's) of the previously loaded tsReadHit - allows easy referencing of partner pairs
 
 	tsReadHit **m_ppReadHitsIdx;	// memory allocated to hold array of ptrs to read hits in m_pReadHits - usually sorted by some critera
@@ -486,6 +508,7 @@ class CAligner
 	size_t m_NxtMultiAllOfs;			// offset in m_pMultiSAM at which to append next alignment
 	size_t m_AllocMultiAllMem;			// current allocation size 			
 	tsReadHit *m_pMultiAll;				// allocated memory for holding multiloci alignments which are all to be reported
+	CMemArena m_MultiAllArena;			// m_pMultiAll is allocated from this arena
 
 	UINT32 m_NumSloughedNs;			// number of reads which were not aligned because they contained excessive number of indeterminate bases
 	UINT32 m_TotNonAligned;			// number of reads for which no alignment was discovered
@@ -610,6 +633,8 @@ class CAligner
 	char *m_pszLineBuff;			// allocated to hold output line buffering
 
 	CSfxArrayV3 *m_pSfxArray;		// suffix array holds genome of interest
+	int m_NumNodeSfxArrays;			// number of NUMA nodes for which m_pNodeSfxArrays[] has been initialised
+	CSfxArrayV3 *m_pNodeSfxArrays[cMaxNUMANodes];	// if replicating index onto NUMA nodes then node local replicas of m_pSfxArray, m_pNodeSfxArrays[0] is m_pSfxArray
 	char m_szTargSpecies[cMaxDatasetSpeciesChrom+1]; // suffix array was generated over this targeted species
 
 	CBEDfile *m_pPriorityRegionBED;	// to hold exact match priority regions
@@ -716,6 +741,7 @@ class CAligner
 	teBSFrsltCodes LoadLociConstraints(char *pszLociConstraints);	// load loci constraints from file
 
 	int LoadReads(char *pszRdsFile);	// file containing preprocessed reads (genreads output)
+	int LoadBlockedReads(char *pszRdsFile);	// file containing V7 block indexed preprocessed reads
 
 	teBSFrsltCodes Disk2Hdr(char *pszRdsFile);	// read from disk and validate header
 
@@ -1035,7 +1061,10 @@ public:
 
 		int ProcAssignMultiMatches(tsClusterThreadPars *pPars);
 		int ProcCoredApprox(tsThreadMatchPars *pPars);
+		int ReplicateSfxArray(void);		// if requested then replicate suffix array onto each NUMA node
+		void DeleteNodeSfxArrays(void);		// delete any NUMA node replicas of suffix array
 		int ProcLoadReadFiles(tsLoadReadsThreadPars *pPars);
+		int ProcLoadRdsBlocks(tsLoadRdsBlocksThreadPars *pPars);
 
 };
 
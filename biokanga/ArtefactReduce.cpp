@@ -903,6 +903,7 @@ UINT32 TotNumSEReads;
 UINT32 TotNumPEReads;
 UINT32 NumPE1Reads;
 UINT32 NumPE2Reads;
+int PhaseID;						// telemetry phase identifier as returned by gSQLiteSummaries.StartPhase()
 
 int SeqWrdBytes;
 UINT64 CumulativeMemory;
@@ -942,6 +943,7 @@ CumulativeMemory = 0;
 
 SeqWrdBytes = GetSeqWrdBytes();
 
+PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"LoadReads") : 0;
 Rslt = eBSFerrOpnFile;		// assumes no check point resumption
 if(pszCheckpointFile != NULL && pszCheckpointFile[0] != '\0')
 	{
@@ -1174,6 +1176,12 @@ UINT32 LoadedMaxSeqLen;
 GetNumReads(&NumPE1Reads,&NumPE2Reads,NULL,NULL,&TotSeqsParsed,&TotSeqsUnderlength,&TotSeqsExcessNs,&LoadedMeanSeqLen,&LoadedMinSeqLen,&LoadedMaxSeqLen);
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Process: Accepted read lengths: min %d, max %d, mean %d",LoadedMinSeqLen,LoadedMaxSeqLen,LoadedMeanSeqLen);
+if(PhaseID > 0)
+	{
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"Parsed",TotSeqsParsed);
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"Accepted",(INT64)NumPE1Reads + NumPE2Reads);
+	gSQLiteSummaries.EndPhase(PhaseID);
+	}
 
 m_LoadedMeanSeqLen = LoadedMeanSeqLen;
 m_LoadedMinSeqLen = LoadedMinSeqLen;
@@ -1226,10 +1234,16 @@ GenRdsSfx(1);			// first SeqWrd only requires indexing
 
 if(!bNoDedupe)
 	{
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"Dedupe") : 0;
 	RemoveDuplicates(NumPE2Reads > 0 ? true : false,bStrand,szPEDupDistFile);
 	FreeSfx();
 	FreeSeqStarts();
 	GetNumReads(NULL,NULL,&NumPE1Reads,&NumPE2Reads);
+	if(PhaseID > 0)
+		{
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"Retained",(INT64)NumPE1Reads + NumPE2Reads);
+		gSQLiteSummaries.EndPhase(PhaseID);
+		}
 
 	if(gProcessingID > 0)
 		{
@@ -1310,14 +1324,25 @@ m_AllocdKMerSeqInstsMem = 0;
 	// now identify those reads which are not overlapped on both 5' and 3' by some other read
 	// if not overlapped then remove as these are likely to contain sequencer errors
 if(MinOverlap != -1)
+	{
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"RemoveNonOverlaps") : 0;
 	RemoveNonOverlaps(MinOverlap,MinFlankLen,IterativePasses);
+	if(PhaseID > 0)
+		{
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"Retained",m_Sequences.NumSeqs2Assemb);
+		gSQLiteSummaries.EndPhase(PhaseID);
+		}
+	}
 
 gSQLiteSummaries.AddResult(gProcessingID,(char *)"Retained",ePTUint32,sizeof(UINT32),"Cnt",&m_Sequences.NumSeqs2Assemb);
 
 FreeSfx();
 FreeSeqStarts();
 
+PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"SavePackedSeqs") : 0;
 Rslt = SavePackedSeqsToFile(pszOutFile);
+if(PhaseID > 0)
+	gSQLiteSummaries.EndPhase(PhaseID);
 ARReset();
 Reset(Rslt == eBSFSuccess ? true : false);
 return(Rslt);
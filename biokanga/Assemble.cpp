@@ -966,7 +966,12 @@ if((Rslt = pAssemble->AssembReads(PMode,TrimEnds,MinSeqLen,TrimPE2SE,bSenseStran
 
 // write out sequences here
 if(Rslt >= eBSFSuccess)
+	{
+	int PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"SaveAssembSeqs") : 0;
 	Rslt = pAssemble->SaveAssembSeqs(pszOutFile,0);
+	if(PhaseID > 0)
+		gSQLiteSummaries.EndPhase(PhaseID);
+	}
 
 delete pAssemble;
 return(0);
@@ -22,6 +22,7 @@
 #include "biokanga.h"
 
 #include "../libbiokanga/bgzf.h"
+#include "SQLiteBulk.h"
 #include "SQLitePSL.h"
 #include "Blitz.h"
 
@@ -1279,7 +1280,12 @@ for (ThreadIdx = 1; ThreadIdx <= NumThreads; ThreadIdx++, pThread++)
 	pThread->pThis = this;
 	pThread->pAllocdAlignNodes = new tsQueryAlignNodes [cNumAllocdAlignNodes];
 	pThread->ppFirst2Rpts = new tsQueryAlignNodes * [cNumAllocdAlignNodes];
+	pThread->pPathScoreTree = new int [cPathScoreTreeSize];
 	pThread->NumAllocdAlignNodes = cNumAllocdAlignNodes;
+	pThread->pBatchQuerySeqs = new tsBatchQuerySeq [cBatchQuerySeqs];
+	pThread->pAllocdCoreSeeds = new tsQueryCoreSeed [cBatchCoreSeeds];
+	pThread->ppSortedCoreSeeds = new tsQueryCoreSeed * [cBatchCoreSeeds];
+	pThread->NumAllocdCoreSeeds = cBatchCoreSeeds;
 
 #ifdef _WIN32
 	pThread->threadHandle = (HANDLE)_beginthreadex(NULL, 0x0fffff, AlignQuerySeqsThread, pThread, 0, &pThread->threadID);
@@ -1355,6 +1361,26 @@ for (ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++, pThread++)
 		delete pThread->ppFirst2Rpts;
 		pThread->ppFirst2Rpts = NULL; 
 		}
+	if(pThread->pPathScoreTree != NULL)
+		{
+		delete [] pThread->pPathScoreTree;
+		pThread->pPathScoreTree = NULL; 
+		}
+	if(pThread->pBatchQuerySeqs != NULL)
+		{
+		delete [] pThread->pBatchQuerySeqs;
+		pThread->pBatchQuerySeqs = NULL; 
+		}
+	if(pThread->pAllocdCoreSeeds != NULL)
+		{
+		delete [] pThread->pAllocdCoreSeeds;
+		pThread->pAllocdCoreSeeds = NULL; 
+		}
+	if(pThread->ppSortedCoreSeeds != NULL)
+		{
+		delete pThread->ppSortedCoreSeeds;
+		pThread->ppSortedCoreSeeds = NULL; 
+		}
 	}
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Completed reporting %u alignment paths for %u query sequences from %d processed",m_ReportedPaths,m_QueriesPaths,m_NumQueriesProc);
@@ -1365,37 +1391,91 @@ return(0);
 }
 
 
+// query sequences are dequeued in batches and the cores of all query sequences in a batch are located in the suffix array together
+// before each query sequence is then extended from its located cores and reported
 int
 CBlitz::ProcAlignQuerySeqs(tsThreadQuerySeqsPars *pPars) 
 {
 int NumQueriesProc;
 int PrevNumQueriesProc;
 int NumMatches;
-int QuerySeqLen;
-int SeqID;
-UINT8 *pQuerySeq;
-char szQuerySeqIdent[cMaxQuerySeqIdentLen+1];
+int NumBatched;
+int BatchIdx;
+int NumCoreSeeds;
+tsBatchQuerySeq *pBatched;
 
 NumQueriesProc = 0;
 PrevNumQueriesProc = 0;
-while((pQuerySeq = DequeueQuerySeq(120,sizeof(szQuerySeqIdent),&SeqID,szQuerySeqIdent,&QuerySeqLen))!=NULL)
-	{
-	NumQueriesProc += 1;
-	NumMatches = m_pSfxArray->LocateQuerySeqs(SeqID,pQuerySeq,QuerySeqLen,m_ExtnScoreThres,m_CoreLen,m_CoreDelta,m_AlignStrand,m_MinExtdCoreLen,pPars->NumAllocdAlignNodes,pPars->pAllocdAlignNodes,m_MaxIter);
-	if(NumMatches)
+do {
+	// dequeue batch of query sequences, only waiting for the first, and generate their core seeds
+	NumBatched = 0;
+	NumCoreSeeds = 0;
+	pBatched = pPars->pBatchQuerySeqs;
+	while(NumBatched < cBatchQuerySeqs && NumCoreSeeds < pPars->NumAllocdCoreSeeds)
 		{
-		if(NumMatches > 1)	// sorting by TargSeqID.QueryID.FlgStrand.TargStartOfs.QueryStartOfs
-			qsort(pPars->pAllocdAlignNodes,NumMatches,sizeof(tsQueryAlignNodes),SortQueryAlignNodes);
+		if((pBatched->Query.pQuerySeq = DequeueQuerySeq(NumBatched == 0 ? 120 : 0,sizeof(pBatched->Query.szQueryIdent),&pBatched->Query.SeqID,pBatched->Query.szQueryIdent,&pBatched->Query.QuerySeqLen))==NULL)
+			break;
+		pBatched->pRevCplSeq = NULL;
+		pBatched->CoreSeedsIdx = NumCoreSeeds;
+		pBatched->NumCoreSeeds = m_pSfxArray->GenQueryCoreSeeds(pBatched->Query.pQuerySeq,NULL,pBatched->Query.QuerySeqLen,m_CoreLen,m_CoreDelta,m_AlignStrand,0,NULL);
+		if(pBatched->NumCoreSeeds > (pPars->NumAllocdCoreSeeds - NumCoreSeeds))	// too many to batch, cores will be individually located
+			pBatched->NumCoreSeeds = 0;
+		if(pBatched->NumCoreSeeds > 0)
+			{
+			if(m_AlignStrand == eALSboth || m_AlignStrand == eALSCrick)
+				{
+				pBatched->pRevCplSeq = new UINT8 [pBatched->Query.QuerySeqLen];
+				memcpy(pBatched->pRevCplSeq,pBatched->Query.pQuerySeq,pBatched->Query.QuerySeqLen);
+				CSeqTrans::ReverseComplement(pBatched->Query.QuerySeqLen,pBatched->pRevCplSeq);
+				}
+			pBatched->NumCoreSeeds = m_pSfxArray->GenQueryCoreSeeds(pBatched->Query.pQuerySeq,pBatched->pRevCplSeq,pBatched->Query.QuerySeqLen,m_CoreLen,m_CoreDelta,m_AlignStrand,
+															pPars->NumAllocdCoreSeeds - NumCoreSeeds,&pPars->pAllocdCoreSeeds[NumCoreSeeds]);
+			if(pBatched->NumCoreSeeds > 0)
+				NumCoreSeeds += pBatched->NumCoreSeeds;
+			else
+				pBatched->NumCoreSeeds = 0;
+			}
+		NumBatched += 1;
+		pBatched += 1;
+		}
 
-		Report(m_MinPathScore,m_MaxPathsToReport,szQuerySeqIdent,QuerySeqLen,pQuerySeq,NumMatches,pPars->pAllocdAlignNodes,pPars->ppFirst2Rpts);
+	// locate all batched core seeds
+	if(NumCoreSeeds > 0 && m_pSfxArray->LocateCoreSeeds(m_CoreLen,NumCoreSeeds,pPars->pAllocdCoreSeeds,pPars->ppSortedCoreSeeds) < 0)
+		{
+		pBatched = pPars->pBatchQuerySeqs;
+		for(BatchIdx = 0; BatchIdx < NumBatched; BatchIdx++, pBatched++)
+			pBatched->NumCoreSeeds = 0;
+		}
 
-		AcquireSerialise();
-		m_QueriesPaths += 1;
-		m_NumQueriesProc += NumQueriesProc - PrevNumQueriesProc;
-		ReleaseSerialise();
-		PrevNumQueriesProc = NumQueriesProc;
+	pBatched = pPars->pBatchQuerySeqs;
+	for(BatchIdx = 0; BatchIdx < NumBatched; BatchIdx++, pBatched++)
+		{
+		NumQueriesProc += 1;
+		NumMatches = m_pSfxArray->LocateQuerySeqs(pBatched->Query.SeqID,pBatched->Query.pQuerySeq,pBatched->Query.QuerySeqLen,m_ExtnScoreThres,m_CoreLen,m_CoreDelta,m_AlignStrand,m_MinExtdCoreLen,pPars->NumAllocdAlignNodes,pPars->pAllocdAlignNodes,m_MaxIter,
+												pBatched->NumCoreSeeds > 0 ? &pPars->pAllocdCoreSeeds[pBatched->CoreSeedsIdx] : NULL);
+		if(NumMatches)
+			{
+			if(NumMatches > 1)	// sorting by TargSeqID.QueryID.FlgStrand.TargStartOfs.QueryStartOfs
+				qsort(pPars->pAllocdAlignNodes,NumMatches,sizeof(tsQueryAlignNodes),SortQueryAlignNodes);
+
+			Report(m_MinPathScore,m_MaxPathsToReport,pBatched->Query.szQueryIdent,pBatched->Query.QuerySeqLen,pBatched->Query.pQuerySeq,NumMatches,pPars->pAllocdAlignNodes,pPars->ppFirst2Rpts,pPars->pPathScoreTree);
+
+			AcquireSerialise();
+			m_QueriesPaths += 1;
+			m_NumQueriesProc += NumQueriesProc - PrevNumQueriesProc;
+			ReleaseSerialise();
+			PrevNumQueriesProc = NumQueriesProc;
+			}
+		if(pBatched->pRevCplSeq != NULL)
+			{
+			delete [] pBatched->pRevCplSeq;
+			pBatched->pRevCplSeq = NULL;
+			}
+		delete pBatched->Query.pQuerySeq;
+		pBatched->Query.pQuerySeq = NULL;
 		}
 	}
+while(NumBatched > 0);
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: Thread %d completed, processed %d query sequences",pPars->ThreadIdx,NumQueriesProc);
 if(NumQueriesProc > PrevNumQueriesProc)
 	{
@@ -1487,6 +1567,212 @@ pCurNode->FlgScored = 1;
 return(pCurNode->HiScore);
 }
 
+// sparse chaining, scores the same highest scoring paths as HighScoreSW() but without the exhaustive all nodes against all nodes exploration
+// Nodes are scored in descending node order, so all putative successors of a node have been scored before that node is scored. Putative successors
+// are then bisected on their query start offsets, and explored in a branch and bound over a range-max tree of the scores of those nodes already scored,
+// with exploration terminating when no node remaining in the range could improve on the best score thus far
+// Requires that the nodes on bStrand are contiguous, sorted by QueryStartOfs ascending, and have AlignLen > cMaxOverlapFloat so any successor has a higher node index
+bool										// false if nodes not ordered as required for sparse chaining and are to be scored by HighScoreSW()
+CBlitz::SparseHighScores(bool bStrand,			// scoring for series on this strand - false if sense, true if antisense
+			UINT32 NumNodes,					// total number of alignment nodes
+			tsQueryAlignNodes *pAlignNodes,		// alignment nodes
+			int *pPathScoreTree)				// allocated to hold range-max tree over alignment node path scores
+{
+UINT32 NodeIdx;
+UINT32 BlkStart;
+UINT32 BlkLen;
+UINT32 NumLeafs;
+UINT32 LeafIdx;
+UINT32 TreeIdx;
+UINT32 SuccLo;
+UINT32 SuccHi;
+UINT32 Lo;
+UINT32 Hi;
+UINT32 Mid;
+UINT32 QueryLo;
+UINT32 QueryHi;
+UINT32 TargLo;
+UINT32 TargHi;
+int CurNodeScore;
+int MinGapScore;
+int GapScore;
+int GapLen;
+int TargGapLen;
+int QueryGapLen;
+int PutHighScore;
+int BestHighScore;
+UINT32 BestSuccIdx;
+int Bound;
+int NumExplored;
+int StackDepth;
+UINT32 StackTree[64];
+UINT32 StackLo[64];
+UINT32 StackHi[64];
+UINT32 TreeLo;
+UINT32 TreeHi;
+UINT32 TreeMid;
+tsQueryAlignNodes *pCurNode;
+tsQueryAlignNodes *pSuccNode;
+
+// locate nodes on strand and check these meet the ordering requirements
+BlkStart = 0;
+BlkLen = 0;
+pCurNode = pAlignNodes;
+for(NodeIdx = 0; NodeIdx < NumNodes; NodeIdx++,pCurNode++)
+	{
+	if(pCurNode->FlgStrand != (bStrand ? 1 : 0))
+		continue;
+	if(BlkLen == 0)
+		BlkStart = NodeIdx;
+	else
+		if(NodeIdx != BlkStart + BlkLen || pCurNode->QueryStartOfs < pCurNode[-1].QueryStartOfs)
+			return(false);
+	if(pCurNode->AlignLen <= cMaxOverlapFloat)
+		return(false);
+	BlkLen += 1;
+	}
+if(BlkLen < cSparseChainMinNodes)
+	return(false);
+for(NumLeafs = 1; NumLeafs < BlkLen; NumLeafs <<= 1);
+if((NumLeafs * 2) > (UINT32)cPathScoreTreeSize)
+	return(false);
+
+// any path gap costs at least this much
+MinGapScore = 1;
+if(MinGapScore > cGapExtendCostLimit)
+	MinGapScore = cGapExtendCostLimit;
+MinGapScore += m_GapOpenScore;
+
+// tree leafs hold node scores, or -1 if node is not yet scored or can't be a successor
+for(TreeIdx = 1; TreeIdx < NumLeafs * 2; TreeIdx++)
+	pPathScoreTree[TreeIdx] = -1;
+
+for(LeafIdx = BlkLen; LeafIdx-- > 0;)
+	{
+	pCurNode = &pAlignNodes[BlkStart + LeafIdx];
+	if(pCurNode->Flg2Rpt)				// already on a path to be reported so can't be on any other path
+		continue;
+
+	// score for exactly matching bp
+	CurNodeScore = ((pCurNode->AlignLen - pCurNode->NumMismatches) * m_ExactMatchScore);
+	// penalise score for mismatches
+	if(pCurNode->NumMismatches)
+		{
+		CurNodeScore -= (pCurNode->NumMismatches * m_MismatchScore);
+		if(CurNodeScore < 0)
+			CurNodeScore = 0;
+		}
+
+	// putative successors are within these query and target windows
+	QueryLo = pCurNode->QueryStartOfs + pCurNode->AlignLen - cMaxOverlapFloat;
+	QueryHi = pCurNode->QueryStartOfs + cGapMaxLength;
+	TargLo = pCurNode->TargStartOfs + pCurNode->AlignLen - cMaxOverlapFloat;
+	TargHi = pCurNode->TargStartOfs + pCurNode->AlignLen + cGapMaxLength;
+
+	// bisect for first node with QueryStartOfs >= QueryLo
+	Lo = LeafIdx + 1;
+	Hi = BlkLen;
+	while(Lo < Hi)
+		{
+		Mid = (Lo + Hi) / 2;
+		if(pAlignNodes[BlkStart + Mid].QueryStartOfs < QueryLo)
+			Lo = Mid + 1;
+		else
+			Hi = Mid;
+		}
+	SuccLo = Lo;
+	// bisect for first node with QueryStartOfs > QueryHi
+	Hi = BlkLen;
+	while(Lo < Hi)
+		{
+		Mid = (Lo + Hi) / 2;
+		if(pAlignNodes[BlkStart + Mid].QueryStartOfs <= QueryHi)
+			Lo = Mid + 1;
+		else
+			Hi = Mid;
+		}
+	SuccHi = Lo;
+
+	// branch and bound for the lowest indexed successor giving the highest path score
+	BestHighScore = 0;
+	BestSuccIdx = 0;
+	NumExplored = 0;
+	StackDepth = 0;
+	if(SuccLo < SuccHi)
+		{
+		StackTree[0] = 1;
+		StackLo[0] = 0;
+		StackHi[0] = NumLeafs - 1;
+		StackDepth = 1;
+		}
+	while(StackDepth > 0 && NumExplored < cMaxChainSuccessors)
+		{
+		StackDepth -= 1;
+		TreeIdx = StackTree[StackDepth];
+		TreeLo = StackLo[StackDepth];
+		TreeHi = StackHi[StackDepth];
+		if(TreeHi < SuccLo || TreeLo >= SuccHi || pPathScoreTree[TreeIdx] < 0)
+			continue;
+		Bound = pPathScoreTree[TreeIdx] + CurNodeScore - MinGapScore;
+		if(Bound <= 0 || Bound < BestHighScore || (Bound == BestHighScore && TreeLo > BestSuccIdx))
+			continue;
+		if(TreeLo != TreeHi)
+			{
+			TreeMid = (TreeLo + TreeHi) / 2;
+			if(pPathScoreTree[TreeIdx * 2] >= pPathScoreTree[(TreeIdx * 2) + 1])	// explore the higher scoring subtree first, lower indexes if equal
+				{
+				StackTree[StackDepth] = (TreeIdx * 2) + 1; StackLo[StackDepth] = TreeMid + 1; StackHi[StackDepth++] = TreeHi;
+				StackTree[StackDepth] = TreeIdx * 2; StackLo[StackDepth] = TreeLo; StackHi[StackDepth++] = TreeMid;
+				}
+			else
+				{
+				StackTree[StackDepth] = TreeIdx * 2; StackLo[StackDepth] = TreeLo; StackHi[StackDepth++] = TreeMid;
+				StackTree[StackDepth] = (TreeIdx * 2) + 1; StackLo[StackDepth] = TreeMid + 1; StackHi[StackDepth++] = TreeHi;
+				}
+			continue;
+			}
+
+		// leaf, score path through this successor
+		NumExplored += 1;
+		pSuccNode = &pAlignNodes[BlkStart + TreeLo];
+		if(pSuccNode->TargStartOfs < TargLo || pSuccNode->TargStartOfs > TargHi)
+			continue;
+		QueryGapLen = abs((int)(pSuccNode->QueryStartOfs - (pCurNode->QueryStartOfs + pCurNode->AlignLen)));
+		TargGapLen = abs((int)(pSuccNode->TargStartOfs - (pCurNode->TargStartOfs + pCurNode->AlignLen)));
+		GapLen = (int)sqrt(((double)QueryGapLen * QueryGapLen) + ((double)TargGapLen * TargGapLen));
+		GapScore = 1 + ((GapLen / 10) * cGapExtendCost);
+		if(GapScore > cGapExtendCostLimit)
+			GapScore = cGapExtendCostLimit;
+		GapScore += m_GapOpenScore;
+		PutHighScore = pSuccNode->HiScore + CurNodeScore - GapScore;
+		if(PutHighScore > BestHighScore || (PutHighScore > 0 && PutHighScore == BestHighScore && TreeLo < BestSuccIdx))
+			{
+			BestHighScore = PutHighScore;
+			BestSuccIdx = TreeLo;
+			}
+		}
+
+	if(BestHighScore > 0)
+		{
+		pCurNode->HiScore = BestHighScore;
+		pCurNode->HiScorePathNextIdx = BlkStart + BestSuccIdx + 1;
+		}
+	else
+		{
+		pCurNode->HiScore = CurNodeScore;
+		pCurNode->HiScorePathNextIdx = 0;
+		}
+	pCurNode->FlgScored = 1;
+
+	// update range-max tree with this node's score
+	TreeIdx = NumLeafs + LeafIdx;
+	pPathScoreTree[TreeIdx] = pCurNode->HiScore;
+	for(TreeIdx /= 2; TreeIdx >= 1; TreeIdx /= 2)
+		pPathScoreTree[TreeIdx] = max(pPathScoreTree[TreeIdx * 2],pPathScoreTree[(TreeIdx * 2) + 1]);
+	}
+return(true);
+}
+
 // expectation is that nodes will have been sorted in TargSeqID.QueryID.FlgStrand.QueryStartOfs.TargStartOfs ascending order
 // essentially is dynamic programming (a.k smith-waterman) using nodes instead of the sequences as the nodes already contain
 // matching + mismatches along the diagonals
@@ -1498,7 +1784,8 @@ CBlitz::IdentifyHighScorePaths(UINT32 QueryLen,			// query length
 			UINT32 StartNodeIdx,				// report for nodes starting at this node index (1..NumNodes) which is expected to be the first alignment node of a new target sequence
 			tsQueryAlignNodes *pAlignNodes,		// alignment nodes
 			int MinPathScore,					// only interested in paths having at least this score
-			int  MaxPathsToReport)				// report at most this many alignment paths for any query
+			int  MaxPathsToReport,				// report at most this many alignment paths for any query
+			int *pPathScoreTree)				// allocated to hold range-max tree over alignment node path scores, NULL if nodes only to be scored by HighScoreSW()
 {
 int PutBestHighScore;
 int BestHighScore;
@@ -1522,6 +1809,8 @@ do {
 		pCurNode->HiScore = 0;
 		pCurNode->HiScorePathNextIdx = 0;
 		}
+	if(pPathScoreTree != NULL)			// if nodes can be sparse chained then all nodes will be scored, otherwise HighScoreSW() scores nodes
+		SparseHighScores(bStrand,NumNodes,pAlignSeqNodes,pPathScoreTree);
 	BestHighScore = MinPathScore - 1;
 	BestHighScoreNodeIdx = 0;
 	pCurNode = pAlignSeqNodes;
@@ -2159,7 +2448,8 @@ CBlitz::Report(int MinPathScore,			// only report paths having at least this min
 				UINT8 *pQuerySeq,			// the query sequence
 				UINT32 NumNodes,			// number of alignment nodes
 				tsQueryAlignNodes *pAlignNodes,		// alignment nodes
-				tsQueryAlignNodes **ppFirst2Rpts)	// allocated to hold ptrs to alignment nodes which are marked as being FlgFirst2tRpt
+				tsQueryAlignNodes **ppFirst2Rpts,	// allocated to hold ptrs to alignment nodes which are marked as being FlgFirst2tRpt
+				int *pPathScoreTree)		// allocated to hold range-max tree over alignment node path scores
 {
 tsQueryAlignNodes *pCurNode;
 UINT32 MaxAlignLen;
@@ -2219,9 +2509,9 @@ for(StartTargNodeIdx=EndTargNodeIdx=1; EndTargNodeIdx <= NumNodes; EndTargNodeId
 			CurTargMatchNodes += 1;
 		TargSeqLen = m_pSfxArray->GetSeqLen(CurTargSeqID);
 		if(m_AlignStrand != eALSCrick)
- 			NumPutPaths += IdentifyHighScorePaths(QueryLen,TargSeqLen,false,CurTargMatchNodes,StartTargNodeIdx,pAlignNodes,MinPathScore,MaxPathsToReport);	// sense/sense paths
+ 			NumPutPaths += IdentifyHighScorePaths(QueryLen,TargSeqLen,false,CurTargMatchNodes,StartTargNodeIdx,pAlignNodes,MinPathScore,MaxPathsToReport,pPathScoreTree);	// sense/sense paths
 		if(m_AlignStrand != eALSWatson)
-			NumPutPaths += IdentifyHighScorePaths(QueryLen,TargSeqLen,true,CurTargMatchNodes,StartTargNodeIdx,pAlignNodes,MinPathScore,MaxPathsToReport);     // antisense/sense paths
+			NumPutPaths += IdentifyHighScorePaths(QueryLen,TargSeqLen,true,CurTargMatchNodes,StartTargNodeIdx,pAlignNodes,MinPathScore,MaxPathsToReport,pPathScoreTree);     // antisense/sense paths
 		CurTargSeqID = pCurNode->TargSeqID;
 		CurTargMatchNodes = 0;
 		StartTargNodeIdx = EndTargNodeIdx;
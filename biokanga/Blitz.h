@@ -61,6 +61,11 @@ const int cMaxQuerySeqLen = (cAllocQuerySeqLen * 8);    // can handle query sequ
 const int cMaxReadAheadQuerySeqs = 4000;	// read ahead and enqueue up to at most this many query sequences
 
 const int cNumAllocdAlignNodes = 200000;  // allow each query sequence to have up to this many aligned subsequences
+const int cPathScoreTreeSize = 0x080000;	// range-max tree over alignment node path scores, must be at least twice cNumAllocdAlignNodes rounded up to a power of 2
+const int cSparseChainMinNodes = 32;		// alignment nodes on a target strand are sparse chained if there are at least this many nodes
+const int cMaxChainSuccessors = 5000;		// when sparse chaining then examine at most this many putative successor nodes for each alignment node
+const int cBatchQuerySeqs = 256;			// query core seeds are batch located over at most this many query sequences
+const int cBatchCoreSeeds = 0x080000;	// query core seeds are batch located over at most this many seeds, query sequences with more seeds are individually located
 
 const int cAlignRprtBufferSize = 500000; // buffer for buffering alignment results ready to write to file
 
@@ -98,6 +103,13 @@ typedef struct TAG_sQuerySeq {
 	UINT8 *pQuerySeq;				// allocated to hold sequence 
 } tsQuerySeq;
 
+typedef struct TAG_sBatchQuerySeq {
+	tsQuerySeq Query;				// dequeued query sequence
+	UINT8 *pRevCplSeq;				// query sequence reverse complemented, NULL if not aligning to the crick strand or not batch located
+	int NumCoreSeeds;				// number of core seeds generated for this query, 0 if query cores are to be individually located
+	int CoreSeedsIdx;				// query core seeds start at this index in the thread's batched core seeds
+} tsBatchQuerySeq;
+
 typedef struct TAG_sLoadQuerySeqsThreadPars {
 	int ThreadIdx;					// uniquely identifies this thread
 	void *pThis;					// will be initialised to pt to CBlitz instance
@@ -127,6 +139,11 @@ typedef struct TAG_sThreadQuerySeqsPars {
 	UINT32 NumAllocdAlignNodes;				// number of allocated alignment nodes
 	tsQueryAlignNodes *pAllocdAlignNodes;	// allocated to hold aligned subsequences
 	tsQueryAlignNodes **ppFirst2Rpts;		// allocated to hold ptrs to alignment nodes which are marked as being FlgFirst2tRpt
+	int *pPathScoreTree;					// allocated to hold range-max tree over alignment node path scores
+	tsBatchQuerySeq *pBatchQuerySeqs;		// allocated to hold batch of dequeued query sequences
+	int NumAllocdCoreSeeds;					// number of allocated core seeds
+	tsQueryCoreSeed *pAllocdCoreSeeds;		// allocated to hold core seeds for batch of query sequences
+	tsQueryCoreSeed **ppSortedCoreSeeds;	// allocated to hold ptrs to core seeds when sorting
 	int *pRslt;						// write intermediate result codes to this location
 	int Rslt;						// returned result code
 } tsThreadQuerySeqsPars;
@@ -298,7 +315,8 @@ public:
 				UINT8 *pQuerySeq,			// the query sequence
 				UINT32 NumNodes,			// number of alignment nodes
 				tsQueryAlignNodes *pAlignNodes, // alignment nodes
-				tsQueryAlignNodes **ppFirst2Rpts);	// allocated to hold ptrs to alignment nodes which are marked as being FlgFirst2tRpt
+				tsQueryAlignNodes **ppFirst2Rpts,	// allocated to hold ptrs to alignment nodes which are marked as being FlgFirst2tRpt
+				int *pPathScoreTree);		// allocated to hold range-max tree over alignment node path scores
 
 
 	int	// reporting alignment as SQLite PSL format 
@@ -419,7 +437,14 @@ public:
 			UINT32 StartNodeIdx,				// report for nodes starting at this node index (1..NumNodes) which is expected to be the first alignment node of a new target sequence
 			tsQueryAlignNodes *pAlignNodes,		// alignment nodes
 			int MinPathScore,					// only report those series having at least this score
-			int  MaxPathsToReport);				// report at most this many alignment paths for any query
+			int  MaxPathsToReport,				// report at most this many alignment paths for any query
+			int *pPathScoreTree);				// allocated to hold range-max tree over alignment node path scores, NULL if nodes only to be scored by HighScoreSW()
+
+	bool										// false if nodes not ordered as required for sparse chaining and are to be scored by HighScoreSW()
+		SparseHighScores(bool bStrand,			// scoring for series on this strand - false if sense, true if antisense
+			UINT32 NumNodes,					// total number of alignment nodes
+			tsQueryAlignNodes *pAlignNodes,		// alignment nodes
+			int *pPathScoreTree);				// allocated to hold range-max tree over alignment node path scores
 
 	int											// returned best score for paths starting at pAlignNodes[ExploreNodeIdx]
 		HighScoreSW(UINT32 QueryLen,			// query length
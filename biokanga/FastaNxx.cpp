@@ -22,6 +22,7 @@ Process(etNxxPMode Mode,			// processing mode - 0  N50 distributions, 1 n-mer co
 		int MaxLength,				// will be truncated to this length
 		int NumBins,				// when generating length distributions then use this many bins - 0 defaults to using 1000
 		int BinDelta,				// when generating length distributions then each bin holds this length delta - 0 defaults to auto determine from NunBins and longest sequence length
+		int NumThreads,				// use at most this many threads when scanning files for sequence lengths
 		int NumInputFiles,			// number of input sequence files
 		char **pszInFastaFile,		// names of input sequence files (wildcards allowed)
 		char *pszRsltsFile);		// file to write results out into
@@ -54,6 +55,9 @@ int iMaxLength;				// and no longer than this length
 int NumBins;				// when generating length distributions then use this many bins - 0 defaults to using 1000
 int BinDelta;				// when generating length distributions then each bin holds this length delta - 0 defaults to auto determine from NunBins and longest sequence length
 
+int NumberOfProcessors;		// number of installed CPUs
+int NumThreads;				// number of threads (0 defaults to number of CPUs)
+
 int NumInputFiles;							// number of input sequence files
 char *pszInFastaFile[cMaxInFileSpecs];		// names of input sequence files (wildcards allowed)
 
@@ -80,6 +84,7 @@ struct arg_int  *MaxLength = arg_int0("L","maxlength","<int>",	"truncate fasta s
 
 struct arg_int  *numbins = arg_int0("b","numbins","<int>",	"when generating length distributions then use this many bins (defaults to 1000, range 10..10000)");
 struct arg_int  *bindelta = arg_int0("B","bindelta","<int>","when generating length distributions then each bin holds this length delta (default 0 for auto-determination, range 1,2,5,10,25,50,100,250,500 or 1000)");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
 struct arg_file *summrslts = arg_file0("q","sumrslts","<file>",		"Output results summary to this SQLite3 database file");
 struct arg_str *experimentname = arg_str0("w","experimentname","<str>",		"experiment name SQLite3 database file");
@@ -89,7 +94,7 @@ struct arg_end *end = arg_end(100);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
-					pmode,pinputfiles,RsltsFile,MinLength,MaxLength,numbins,bindelta,
+					pmode,pinputfiles,RsltsFile,MinLength,MaxLength,numbins,bindelta,threads,
 					end};
 
 char **pAllArgs;
@@ -269,6 +274,23 @@ if (!argerrors)
 		}
 
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 	NumInputFiles = 0;
 
 	for(NumInputFiles=Idx=0;NumInputFiles < cMaxInFileSpecs && Idx < pinputfiles->count; Idx++)
@@ -349,6 +371,7 @@ if (!argerrors)
 			gDiagnostics.DiagOutMsgOnly(eDLInfo,"Bin length delta: %d",BinDelta);
 			}
 		}
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 	if(PMode == ePMKMerDist)
 		{
 		gDiagnostics.DiagOutMsgOnly(eDLInfo,"Minimum fasta sequence length: %d",iMinLength);
@@ -369,6 +392,7 @@ if (!argerrors)
 
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"numbins",&numbins);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"bindelta",&bindelta);
+		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"threads",&NumThreads);
 
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"NumInputFiles",&NumInputFiles);
 		for(Idx = 0; Idx < NumInputFiles; Idx++)
@@ -383,7 +407,7 @@ if (!argerrors)
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = Process(PMode,iMinLength,iMaxLength,NumBins,BinDelta,NumInputFiles,pszInFastaFile,szRsltsFile);
+	Rslt = Process(PMode,iMinLength,iMaxLength,NumBins,BinDelta,NumThreads,NumInputFiles,pszInFastaFile,szRsltsFile);
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -411,6 +435,7 @@ Process(etNxxPMode Mode,			// processing mode - 0  N50 distributions, 1 n-mer co
 		int MaxLength,				// will be truncated to this length
 		int NumBins,				// when generating length distributions then use this many bins - 0 defaults to using 1000
 		int BinDelta,				// when generating length distributions then each bin holds this length delta - 0 defaults to auto determine from NunBins and longest sequence length
+		int NumThreads,				// use at most this many threads when scanning files for sequence lengths
 		int NumInputFiles,			// number of input sequence files
 		char **pszInFastaFile,		// names of input sequence files (wildcards allowed)
 		char *pszRsltsFile)			// file to write fasta into
@@ -422,7 +447,7 @@ if((pFastaNxx = new CFastaNxx) == NULL)
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to create CFastaNxx object");
 	return(eBSFerrObj);
 	}
-Rslt = pFastaNxx->Process(Mode,MinLength,MaxLength,NumBins,BinDelta,NumInputFiles,pszInFastaFile,pszRsltsFile);
+Rslt = pFastaNxx->Process(Mode,MinLength,MaxLength,NumBins,BinDelta,NumThreads,NumInputFiles,pszInFastaFile,pszRsltsFile);
 
 delete pFastaNxx;
 return(Rslt);
@@ -435,7 +460,8 @@ m_pDimerCnts = NULL;
 m_pTrimerCnts = NULL;
 m_pTetramerCnts = NULL;
 m_pBins = NULL;
-m_pContigLengths = NULL;
+m_pLenDist = NULL;
+m_pszNxxFiles = NULL;
 Reset();
 }
 
@@ -473,19 +499,20 @@ if(m_pBins != NULL)
 	delete(m_pBins);
 	m_pBins = NULL;
 	}
-if(m_pContigLengths != NULL)
+if(m_pLenDist != NULL)
 	{
-#ifdef _WIN32
-	free(m_pContigLengths);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pContigLengths != MAP_FAILED)
-		munmap(m_pContigLengths,m_AllocdCtgLens);
-#endif	
-	m_pContigLengths = NULL;
+	FreeLenDist(m_pLenDist);
+	m_pLenDist = NULL;
+	}
+if(m_pszNxxFiles != NULL)
+	{
+	delete [] m_pszNxxFiles;
+	m_pszNxxFiles = NULL;
 	}
 
-m_NumContigLens = 0;
-m_AllocdCtgLens = 0; 
+m_NumNxxFiles = 0;
+m_AllocNxxFiles = 0;
+m_NumNxxFilesClaimed = 0;
 m_TotLenCovered = 0;
 m_MaxLengthRead = 0;
 
@@ -511,7 +538,6 @@ int NumProcessed;
 int PrevNumProcessed;
 int NumUnderLen;
 int NumOverLen;
-int NumContigs;
 int MaxLengthRead;
 int SeqNsIdx;
 
@@ -541,7 +567,6 @@ NumAccepted = 0;
 NumProcessed = 0;
 NumUnderLen = 0;
 NumOverLen = 0;
-NumContigs = 0;
 MaxLengthRead = 0;
 m_TotLenCovered = 0;
 PrevNumProcessed = 0;
@@ -574,68 +599,19 @@ while((Rslt = SeqLen = pFasta->ReadSequence(m_pSeq,MaxLength + 10)) > eBSFSucces
 	
 
 	NumProcessed += 1;
-	if(Mode == ePMdefault)
+	if(SeqLen < MinLength)
 		{
-		bInSeq = true;
-
-		// slough contig sequences not within requested length range 
-		if(SeqLen < MinLength)
-			{
-			NumUnderLen += 1;
-			continue;
-			}
-		if(SeqLen > MaxLength)			
-			{
-			NumOverLen += 1;
-			continue;
-			}
-
-		if(SeqLen > MaxLengthRead)
-			MaxLengthRead = SeqLen;
-
-		NumContigs += 1;
-		m_TotLenCovered += SeqLen;
-
-		// is more memory required to hold this new contig length?
-		if(((m_NumContigLens + 10) * sizeof(int)) > m_AllocdCtgLens)	// allow a little safety margin
-			{
-			int *pTmp;
-			size_t AllocNeeded = m_AllocdCtgLens + (cAllocCtgLenDist * sizeof(int));
-#ifdef _WIN32
-			pTmp = (int *) realloc(m_pContigLengths,AllocNeeded);
-#else
-			pTmp = (int *)mremap(m_pContigLengths,m_AllocdCtgLens,AllocNeeded,MREMAP_MAYMOVE);
-			if(pTmp == MAP_FAILED)
-				pTmp = NULL;
-#endif
-			if(pTmp == NULL)
-				{
-				gDiagnostics.DiagOut(eDLInfo,gszProcName,"GenContig memory reallocation for contig lengths distribution of %d bytes failed..",AllocNeeded);
-				return(eBSFerrMem);
-				}
-			m_pContigLengths = pTmp;
-			m_AllocdCtgLens = AllocNeeded;
-			}
-		m_pContigLengths[m_NumContigLens++] = SeqLen;
-		NumAccepted += 1;
+		NumUnderLen += 1;
 		continue;
 		}
-	else
-		{
-		if(SeqLen < MinLength)
-			{
-			NumUnderLen += 1;
-			continue;
-			}
 
-		if(SeqLen > MaxLength)			// overlength sequences are truncated
-			{
-			bInSeq = true;
-			NumOverLen += 1;
-			SeqLen = MaxLength;
-			}
-		m_TotLenCovered += SeqLen;
+	if(SeqLen > MaxLength)			// overlength sequences are truncated
+		{
+		bInSeq = true;
+		NumOverLen += 1;
+		SeqLen = MaxLength;
 		}
+	m_TotLenCovered += SeqLen;
 
 	if(SeqLen > MaxLengthRead)
 		MaxLengthRead = SeqLen;
@@ -702,6 +678,7 @@ CFastaNxx::Process(etNxxPMode Mode,		// processing mode - 0  N50 distributions,
 		int MaxLength,				// will be truncated to this length
 		int NumBins,				// when generating length distributions then use this many bins - 0 defaults to using 1000
 		int BinDelta,				// when generating length distributions then each bin holds this length delta - 0 defaults to auto determine from NunBins and longest sequence length
+		int NumThreads,				// use at most this many threads when scanning files for sequence lengths
 		int NumInputFiles,			// number of input sequence files
 		char **pszInFastaFile,		// names of input sequence files (wildcards allowed)
 		char *pszRsltsFile)			// file to write fasta into
@@ -747,82 +724,136 @@ if(Mode == ePMKMerDist)
 	memset(m_DistBaseCnts,0,sizeof(m_DistBaseCnts));
 	}
 
-if((m_pSeq = new UINT8 [MaxLength+10])==NULL)	// allows to check if sequence has been loaded which is longer than MaxLength
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory to hold sequence of length %d",MaxLength);
-	Reset();
-	return(eBSFerrMem);
-	}
-
 if(Mode == ePMdefault)
 	{
-	size_t MemReq = cAllocCtgLenDist * sizeof(int);
-#ifdef _WIN32
-	m_pContigLengths = (int *) malloc(MemReq);	// initial and perhaps the only allocation
-	if(m_pContigLengths == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"GenContigs: Memory allocation of %d bytes for contig length distributions - %s",MemReq,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pContigLengths = (int *)mmap(NULL,MemReq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pContigLengths == MAP_FAILED)
+	INT64 NxLens[10];	// to hold contig lengths for all Nx where Nx varies from 10 to 100 in increments of N10
+	INT64 SumCtgLens;
+	INT64 NxSum;
+	INT64 *pNxLens;
+	INT64 Needed;
+	INT64 Remain;
+	UINT64 NumCtgs;
+	UINT64 NumSeqs;
+	UINT32 SpillIdx;
+	int CtgLenIdx;
+	int CtgNxIdx;
+	int CtgLen;
+	int ThreadIdx;
+	tsNxxThreadPars *pThreads;
+	tsNxxThreadPars *pPars;
+	int *pCnts;
+
+	if((m_pLenDist = AllocLenDist()) == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %d bytes through mmap()  failed - %s",MemReq,strerror(errno));
-		m_pContigLengths = NULL;
 		Reset();
 		return(eBSFerrMem);
 		}
-#endif
-	m_AllocdCtgLens = MemReq;
-	m_NumContigLens = 0;
-	m_TotLenCovered = 0;
-	}
 
-CSimpleGlob glob(SG_GLOB_FULLSORT);
-int Idx;
-char *pszInFile;
-for(Idx = 0; Idx < NumInputFiles; Idx++)
-	{
-	glob.Init();
-	if(glob.Add(pszInFastaFile[Idx]) < SG_SUCCESS)
+	// Nxx processing only requires sequence lengths so input files are streamed, concurrently if multiple files, without the sequences being retained
+	CSimpleGlob glob(SG_GLOB_FULLSORT);
+	int Idx;
+	for(Idx = 0; Idx < NumInputFiles; Idx++)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to glob '%s",pszInFastaFile[Idx]);
-		Reset();
-		return(eBSFerrOpnFile);	// treat as though unable to open file
-		}	
-	if(glob.FileCount() <= 0)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to locate any source raw reads file matching '%s",pszInFastaFile[Idx]);
-		continue;
+		glob.Init();
+		if(glob.Add(pszInFastaFile[Idx]) < SG_SUCCESS)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to glob '%s",pszInFastaFile[Idx]);
+			Reset();
+			return(eBSFerrOpnFile);	// treat as though unable to open file
+			}
+		if(glob.FileCount() <= 0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to locate any source raw reads file matching '%s",pszInFastaFile[Idx]);
+			continue;
+			}
+		for (int FileID = 0; FileID < glob.FileCount(); ++FileID)
+			{
+			if(m_pszNxxFiles == NULL || m_NumNxxFiles == m_AllocNxxFiles)
+				{
+				char *pszTmp;
+				if((pszTmp = new char [(m_AllocNxxFiles + cNxxAllocFiles) * _MAX_PATH]) == NULL)
+					{
+					gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory for input file names");
+					Reset();
+					return(eBSFerrMem);
+					}
+				if(m_pszNxxFiles != NULL)
+					{
+					memcpy(pszTmp,m_pszNxxFiles,m_NumNxxFiles * _MAX_PATH);
+					delete [] m_pszNxxFiles;
+					}
+				m_pszNxxFiles = pszTmp;
+				m_AllocNxxFiles += cNxxAllocFiles;
+				}
+			strncpy(&m_pszNxxFiles[m_NumNxxFiles * _MAX_PATH],glob.File(FileID),_MAX_PATH-1);
+			m_pszNxxFiles[(m_NumNxxFiles * _MAX_PATH) + _MAX_PATH-1] = '\0';
+			m_NumNxxFiles += 1;
+			}
 		}
-	Rslt = eBSFSuccess;
-	for (int FileID = 0; Rslt >= eBSFSuccess &&  FileID < glob.FileCount(); ++FileID)
+
+	if(m_NumNxxFiles)
 		{
-		pszInFile = glob.File(FileID);
-		if((Rslt = ProcessFile(Mode,MinLength,MaxLength,pszInFile)) < 0)
+		NumThreads = min(NumThreads,min(m_NumNxxFiles,cMaxNxxThreads));
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Scanning %d file(s) for sequence lengths using %d threads",m_NumNxxFiles,NumThreads);
+		if((pThreads = new tsNxxThreadPars [NumThreads]) == NULL)
 			{
-			delete m_pSeq;
-			m_pSeq = NULL;
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory for %d threads",NumThreads);
+			Reset();
+			return(eBSFerrMem);
+			}
+		memset(pThreads,0,sizeof(tsNxxThreadPars) * NumThreads);
+		m_NumNxxFilesClaimed = 0;
+		for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+			{
+			pPars->ThreadIdx = ThreadIdx + 1;
+			pPars->pThis = this;
+			pPars->MinLength = MinLength;
+			pPars->MaxLength = MaxLength;
+			pPars->Rslt = eBSFSuccess;
+#ifdef _WIN32
+			pPars->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,NxxThreadStart,pPars,0,&pPars->threadID);
+#else
+			pPars->threadRslt =	pthread_create (&pPars->threadID , NULL , NxxThreadStart , pPars );
+#endif
+			}
+
+		Rslt = eBSFSuccess;
+		for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+			{
+#ifdef _WIN32
+			while(WAIT_TIMEOUT == WaitForSingleObject( pPars->threadHandle, 60000))
+				gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u of %d files claimed for scanning",min(m_NumNxxFilesClaimed,(unsigned int)m_NumNxxFiles),m_NumNxxFiles);
+			CloseHandle( pPars->threadHandle);
+#else
+			struct timespec ts;
+			int JoinRlt;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec += 60;
+			while((JoinRlt = pthread_timedjoin_np(pPars->threadID, NULL, &ts)) != 0)
+				{
+				gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u of %d files claimed for scanning",min(m_NumNxxFilesClaimed,(unsigned int)m_NumNxxFiles),m_NumNxxFiles);
+				ts.tv_sec += 60;
+				}
+#endif
+			if(pPars->Rslt < eBSFSuccess && Rslt >= eBSFSuccess)
+				Rslt = pPars->Rslt;
+			if(Rslt >= eBSFSuccess && pPars->pLenDist != NULL)
+				Rslt = MergeLenDist(pPars->pLenDist);
+			if(pPars->pLenDist != NULL)
+				{
+				FreeLenDist(pPars->pLenDist);
+				pPars->pLenDist = NULL;
+				}
+			}
+		delete [] pThreads;
+		if(Rslt < eBSFSuccess)
+			{
+			Reset();
 			return(Rslt);
 			}
 		}
-
-	}
-
-
-if(Mode == ePMdefault)
-	{
-	INT64 NxLens[11];	// to hold contig lengths for all Nx where Nx varies from 10 to 100 in increments of N10
-	INT64 SumCtgLens;
-	INT64 NxSum;
-	INT64 *pNxLens;
-	int CtgLenIdx;
-	int CtgNxIdx;
-	int NumCtgs;
-	int *pCnts;
+	m_MaxLengthRead = m_pLenDist->MaxLen;
+	NumSeqs = m_pLenDist->NumSeqs;
 
 	if(pszRsltsFile != NULL && pszRsltsFile[0] != '\0')
 		{
@@ -884,14 +915,15 @@ if(Mode == ePMdefault)
 	else
 		m_pBins = NULL;
 
-	SumCtgLens = 0;
-	pCnts = m_pContigLengths;
-	for(CtgLenIdx = 0; CtgLenIdx < m_NumContigLens; CtgLenIdx++,pCnts++)
+	SumCtgLens = m_pLenDist->TotLen;
+	if(m_pBins != NULL)
 		{
-		SumCtgLens += *pCnts;
-		if(m_pBins != NULL && *pCnts != 0)
-			m_pBins[min(*pCnts / BinDelta,NumBins)] += 1;
-		}	
+		for(CtgLenIdx = 1; CtgLenIdx < cNxxExactLens; CtgLenIdx++)
+			if(m_pLenDist->LenCnts[CtgLenIdx])
+				m_pBins[min(CtgLenIdx / BinDelta,NumBins)] += (UINT32)m_pLenDist->LenCnts[CtgLenIdx];
+		for(SpillIdx = 0; SpillIdx < m_pLenDist->NumSpill; SpillIdx++)
+			m_pBins[min(m_pLenDist->pSpillLens[SpillIdx] / BinDelta,NumBins)] += 1;
+		}
 
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"  Total sequence length over accepted contigs: %lld",SumCtgLens);
 
@@ -924,48 +956,102 @@ if(Mode == ePMdefault)
 		m_pBins = NULL;
 		}
 
-	m_MTqsort.SetMaxThreads(4);
-	m_MTqsort.qsort(m_pContigLengths,(UINT64)m_NumContigLens,sizeof(int),SortByContigLen);
-
+	// only the relatively few contigs longer than the exact length histogram need sorting
+	if(m_pLenDist->NumSpill > 1)
+		{
+		m_MTqsort.SetMaxThreads(4);
+		m_MTqsort.qsort(m_pLenDist->pSpillLens,(UINT64)m_pLenDist->NumSpill,sizeof(int),SortByContigLen);
+		}
 
 	pNxLens = NxLens;
 	for(CtgNxIdx = 1; CtgNxIdx <= 10; CtgNxIdx++,pNxLens++)
 		*pNxLens = (SumCtgLens * CtgNxIdx)/10;
 
+	// iterate contig lengths in descending order, spilled lengths first then the histogram, with all contigs of the same length processed as a group
+	// any Nx thresholds crossed within a group are reported with the exact number of contigs required to cross that threshold
 	NxSum = 0;
 	CtgNxIdx = 0;
 	NumCtgs = 0;
-	pCnts = m_pContigLengths;
-	for(int Idx = 0; Idx < m_NumContigLens; Idx++,pCnts++)
+	SpillIdx = 0;
+	CtgLenIdx = cNxxExactLens - 1;
+	while(CtgNxIdx < 10 && NumSeqs > 0)
 		{
-		if(*pCnts)
+		if(SpillIdx < m_pLenDist->NumSpill)
 			{
-			NxSum += *pCnts;
-			NumCtgs += 1;
+			CtgLen = m_pLenDist->pSpillLens[SpillIdx];
+			Remain = 1;
+			while(++SpillIdx < m_pLenDist->NumSpill && m_pLenDist->pSpillLens[SpillIdx] == CtgLen)
+				Remain += 1;
+			}
+		else
+			{
+			while(CtgLenIdx > 0 && m_pLenDist->LenCnts[CtgLenIdx] == 0)
+				CtgLenIdx -= 1;
+			if(CtgLenIdx == 0)
+				break;
+			CtgLen = CtgLenIdx--;
+			Remain = m_pLenDist->LenCnts[CtgLen];
 			}
 
-		if(NxSum >= NxLens[CtgNxIdx])
+		while(CtgNxIdx < 10 && NxSum + (Remain * CtgLen) >= NxLens[CtgNxIdx])
 			{
-			gDiagnostics.DiagOut(eDLInfo,gszProcName,"  N%d contig length is %d, Contigs: %d (%1.2f%%)",(CtgNxIdx+1)*10,*pCnts,NumCtgs, ((double)NumCtgs * 100)/(double)m_NumContigLens);
-			NxLens[CtgNxIdx++] = *pCnts;
+			Needed = NxLens[CtgNxIdx] > NxSum ? (NxLens[CtgNxIdx] - NxSum + CtgLen - 1) / CtgLen : 0;
+			if(Needed == 0 && NumCtgs == 0)
+				Needed = 1;
+			NxSum += Needed * CtgLen;
+			NumCtgs += Needed;
+			Remain -= Needed;
+			gDiagnostics.DiagOut(eDLInfo,gszProcName,"  N%d contig length is %d, Contigs: %lld (%1.2f%%)",(CtgNxIdx+1)*10,CtgLen,NumCtgs, ((double)NumCtgs * 100)/(double)NumSeqs);
+			CtgNxIdx += 1;
 			}
+		NxSum += Remain * CtgLen;
+		NumCtgs += Remain;
 		}
 
-#ifdef _WIN32
-	free(m_pContigLengths);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pContigLengths != MAP_FAILED)
-		munmap(m_pContigLengths,m_AllocdCtgLens);
-#endif	
-	m_pContigLengths = NULL;
+	FreeLenDist(m_pLenDist);
+	m_pLenDist = NULL;
 
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Processing completed");
-	delete m_pSeq;
-	m_pSeq = NULL;
 	return(eBSFSuccess);
 	}
 
+if((m_pSeq = new UINT8 [MaxLength+10])==NULL)	// allows to check if sequence has been loaded which is longer than MaxLength
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory to hold sequence of length %d",MaxLength);
+	Reset();
+	return(eBSFerrMem);
+	}
 
+CSimpleGlob glob(SG_GLOB_FULLSORT);
+int Idx;
+char *pszInFile;
+for(Idx = 0; Idx < NumInputFiles; Idx++)
+	{
+	glob.Init();
+	if(glob.Add(pszInFastaFile[Idx]) < SG_SUCCESS)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to glob '%s",pszInFastaFile[Idx]);
+		Reset();
+		return(eBSFerrOpnFile);	// treat as though unable to open file
+		}	
+	if(glob.FileCount() <= 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to locate any source raw reads file matching '%s",pszInFastaFile[Idx]);
+		continue;
+		}
+	Rslt = eBSFSuccess;
+	for (int FileID = 0; Rslt >= eBSFSuccess &&  FileID < glob.FileCount(); ++FileID)
+		{
+		pszInFile = glob.File(FileID);
+		if((Rslt = ProcessFile(Mode,MinLength,MaxLength,pszInFile)) < 0)
+			{
+			delete [] m_pSeq;
+			m_pSeq = NULL;
+			return(Rslt);
+			}
+		}
+
+	}
 
 // output results
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"About to write results into file '%s'",pszRsltsFile);
@@ -1176,6 +1262,209 @@ m_pSeq = NULL;
 return(eBSFSuccess);
 }
 
+tsNxxLenDist *
+CFastaNxx::AllocLenDist(void)		// allocate and initialise an empty length distribution
+{
+tsNxxLenDist *pLenDist;
+if((pLenDist = new tsNxxLenDist) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory for sequence length distribution");
+	return(NULL);
+	}
+memset(pLenDist,0,sizeof(tsNxxLenDist));
+if((pLenDist->pSpillLens = (int *)malloc(sizeof(int) * cNxxInitAllocSpill)) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory for sequence length distribution");
+	delete pLenDist;
+	return(NULL);
+	}
+pLenDist->AllocSpill = cNxxInitAllocSpill;
+return(pLenDist);
+}
+
+void
+CFastaNxx::FreeLenDist(tsNxxLenDist *pLenDist)
+{
+if(pLenDist == NULL)
+	return;
+if(pLenDist->pSpillLens != NULL)
+	free(pLenDist->pSpillLens);		// was allocated with malloc/realloc
+delete pLenDist;
+}
+
+int
+CFastaNxx::AddSpillLen(tsNxxLenDist *pLenDist,	// add length, >= cNxxExactLens, to distribution spilled lengths
+				int SeqLen)
+{
+if(pLenDist->NumSpill == pLenDist->AllocSpill)
+	{
+	int *pTmp;
+	UINT32 AllocSpill = pLenDist->AllocSpill + max(cNxxInitAllocSpill,pLenDist->AllocSpill / 2);
+	if((pTmp = (int *)realloc(pLenDist->pSpillLens,sizeof(int) * (size_t)AllocSpill)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Memory reallocation for %u sequence lengths failed",AllocSpill);
+		return(eBSFerrMem);
+		}
+	pLenDist->pSpillLens = pTmp;
+	pLenDist->AllocSpill = AllocSpill;
+	}
+pLenDist->pSpillLens[pLenDist->NumSpill++] = SeqLen;
+return(eBSFSuccess);
+}
+
+int
+CFastaNxx::MergeLenDist(tsNxxLenDist *pLenDist)	// merge thread length distribution into m_pLenDist
+{
+int Rslt;
+int LenIdx;
+UINT32 SpillIdx;
+for(LenIdx = 0; LenIdx < cNxxExactLens; LenIdx++)
+	m_pLenDist->LenCnts[LenIdx] += pLenDist->LenCnts[LenIdx];
+for(SpillIdx = 0; SpillIdx < pLenDist->NumSpill; SpillIdx++)
+	if((Rslt = AddSpillLen(m_pLenDist,pLenDist->pSpillLens[SpillIdx])) < eBSFSuccess)
+		return(Rslt);
+m_pLenDist->NumSeqs += pLenDist->NumSeqs;
+m_pLenDist->TotLen += pLenDist->TotLen;
+if(pLenDist->MaxLen > m_pLenDist->MaxLen)
+	m_pLenDist->MaxLen = pLenDist->MaxLen;
+return(eBSFSuccess);
+}
+
+#ifdef _WIN32
+unsigned int __stdcall CFastaNxx::NxxThreadStart(void *args)
+{
+#else
+void * CFastaNxx::NxxThreadStart(void *args)
+{
+#endif
+tsNxxThreadPars *pArgs = (tsNxxThreadPars *)args;
+pArgs->Rslt = pArgs->pThis->NxxThread(pArgs);
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+int
+CFastaNxx::NxxThread(tsNxxThreadPars *pPars)	// worker thread scanning files until all files claimed
+{
+int Rslt;
+unsigned int FileIdx;
+
+if((pPars->pLenDist = AllocLenDist()) == NULL)
+	return(eBSFerrMem);
+
+Rslt = eBSFSuccess;
+while(Rslt >= eBSFSuccess)
+	{
+#ifdef _WIN32
+	FileIdx = InterlockedIncrement((volatile LONG *)&m_NumNxxFilesClaimed) - 1;
+#else
+	FileIdx = __sync_fetch_and_add(&m_NumNxxFilesClaimed,1);
+#endif
+	if(FileIdx >= (unsigned int)m_NumNxxFiles)
+		break;
+	Rslt = ScanFileLens(pPars,&m_pszNxxFiles[FileIdx * _MAX_PATH]);
+	}
+return(Rslt);
+}
+
+int
+CFastaNxx::ScanFileLens(tsNxxThreadPars *pPars,	// scan file, accumulating sequence lengths into thread length distribution
+			char *pszFastaFile)			// scan sequences in this input file
+{
+int Rslt;
+int SeqLen;
+int NumAccepted;
+int NumProcessed;
+int NumUnderLen;
+int NumOverLen;
+int MaxLengthRead;
+INT64 TotLenAccepted;
+tsNxxLenDist *pLenDist = pPars->pLenDist;
+
+CFasta *pFasta = NULL;
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Starting to process source fasta file '%s'",pszFastaFile);
+
+if((pFasta = new CFasta())==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to create CFasta object");
+	return(eBSFerrObj);
+	}
+
+if((Rslt=pFasta->Open(pszFastaFile,true)) < eBSFSuccess)
+	{
+	while(pFasta->NumErrMsgs())
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,pFasta->GetErrMsg());
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open fasta file '%s'",pszFastaFile);
+	delete pFasta;
+	return(Rslt);
+	}
+
+NumAccepted = 0;
+NumProcessed = 0;
+NumUnderLen = 0;
+NumOverLen = 0;
+MaxLengthRead = 0;
+TotLenAccepted = 0;
+
+// only the sequence lengths are of interest so sequences are not returned, just their lengths
+while((Rslt = SeqLen = pFasta->ReadSequence(NULL,0)) > eBSFSuccess)
+	{
+	if(SeqLen == eBSFFastaDescr)		// just read a descriptor line, slough, only interested in sequences
+		continue;
+
+	NumProcessed += 1;
+	// slough contig sequences not within requested length range 
+	if(SeqLen < pPars->MinLength)
+		{
+		NumUnderLen += 1;
+		continue;
+		}
+	if(SeqLen > pPars->MaxLength)			
+		{
+		NumOverLen += 1;
+		continue;
+		}
+
+	if(SeqLen > MaxLengthRead)
+		MaxLengthRead = SeqLen;
+	TotLenAccepted += SeqLen;
+	NumAccepted += 1;
+
+	if(SeqLen < cNxxExactLens)
+		pLenDist->LenCnts[SeqLen] += 1;
+	else
+		if((Rslt = AddSpillLen(pLenDist,SeqLen)) < eBSFSuccess)
+			break;
+	}
+if(Rslt < eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Encountered errors after %d sequences loaded of which %d were processed. There were %d underlength and %d overlength",
+					NumProcessed,NumAccepted,NumUnderLen,NumOverLen);
+	while(pFasta->NumErrMsgs())
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,pFasta->GetErrMsg());
+	delete pFasta;
+	return(Rslt);
+	}
+delete pFasta;
+
+pLenDist->NumSeqs += NumAccepted;
+pLenDist->TotLen += TotLenAccepted;
+if(MaxLengthRead > pLenDist->MaxLen)
+	pLenDist->MaxLen = MaxLengthRead;
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Sequences loaded %d of which %d were processed. There were %d underlength and %d overlength",
+					NumProcessed,NumAccepted,NumUnderLen,NumOverLen);
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Maximum length sequence loaded and accepted for processing was %d bp",MaxLengthRead);
+if(NumAccepted > 0)
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Total length of all accepted sequences was %lld bp with mean length %d",TotLenAccepted,(int)(TotLenAccepted/NumAccepted));
+return(eBSFSuccess);
+}
+
 // SortByContigLen
 // Sorts contig lengths descending
 int
@@ -7,7 +7,12 @@ const int cDfltTruncLength = 200;	    // default truncate length
 
 const int cMaxN50Length = 100000000;	// if N50 processing then can handle at most this length contigs
 const int cDfltN50Length = 100000000;	// if N50 processing then this is the default max length contig
-const UINT32 cAllocCtgLenDist = 10000000;	// allocate to hold this number of contig lengths for calc of N50 etc
+
+const int cMaxWorkerThreads = 128;		// limiting max number of threads to this many
+const int cMaxNxxThreads = 16;			// scanning files for sequence lengths is I/O bound so use at most this many threads
+const int cNxxExactLens = 0x08000;		// sequence lengths less than this are counted by length, longer lengths are spilled as exact lengths
+const UINT32 cNxxInitAllocSpill = 0x010000;	// initially allocate to hold this many spilled sequence lengths, realloc'd as required
+const int cNxxAllocFiles = 100;			// allocate for input file names in increments of this many files
 
 const int cMaxInFileSpecs = 50;			// allow at most this many input file specs
 
@@ -16,13 +21,45 @@ typedef enum {
 	ePMKMerDist							// K-mer distributions
 	} etNxxPMode;
 
+// Nxx processing only requires sequence lengths so these are accumulated as a length distribution, rather than as a list of all lengths,
+// with the number of lengths retained bounded by the total length of all sequences divided by cNxxExactLens
+typedef struct TAG_sNxxLenDist {
+	UINT64 NumSeqs;						// number of accepted sequences
+	INT64 TotLen;						// sum of accepted sequence lengths
+	int MaxLen;							// longest accepted sequence length
+	UINT32 NumSpill;					// number of sequence lengths in pSpillLens
+	UINT32 AllocSpill;					// pSpillLens allocated to hold this many lengths
+	int *pSpillLens;					// lengths >= cNxxExactLens
+	UINT64 LenCnts[cNxxExactLens];		// number of accepted sequences of each length < cNxxExactLens
+	} tsNxxLenDist;
+
+#pragma pack(1)
+typedef struct TAG_sNxxThreadPars {
+	int ThreadIdx;						// uniquely identifies this thread
+#ifdef _WIN32
+	HANDLE threadHandle;				// handle as returned by _beginthreadex()
+	unsigned int threadID;				// identifier as set by _beginthreadex()
+#else
+	int threadRslt;						// result as returned by pthread_create ()
+	pthread_t threadID;					// identifier as set by pthread_create ()
+#endif
+	class CFastaNxx *pThis;				// class instance
+	int MinLength;						// accept sequences of at least this length
+	int MaxLength;						// and no longer than this length
+	tsNxxLenDist *pLenDist;				// thread accumulates lengths into this distribution
+	int Rslt;							// returned result code
+	} tsNxxThreadPars;
+#pragma pack()
+
 class CFastaNxx
 {
 	size_t m_AllocMemSeq;				// allocation size of m_pSeq
 	etSeqBase *m_pSeq;					// allocated to fasta sequences
-	int m_NumContigLens;				// current number of contig lengths in m_pContigLengths
-	size_t m_AllocdCtgLens;				// memory size currently alloc'd to m_pContigLengths 
-	int *m_pContigLengths;				// used to hold contig lengths for N50 and other stats generation 
+	tsNxxLenDist *m_pLenDist;			// distribution of accepted sequence lengths for N50 and other stats generation
+	int m_NumNxxFiles;					// number of input files to be scanned for sequence lengths
+	int m_AllocNxxFiles;				// m_pszNxxFiles allocated to hold this many file names
+	char *m_pszNxxFiles;				// input file names, each _MAX_PATH chars
+	volatile unsigned int m_NumNxxFilesClaimed;	// number of input files claimed for scanning by worker threads
 	INT64 m_TotLenCovered;				// sum of all contig lengths
 	UINT32 m_BaseCnts[6];				// total counts for each base including 'N's
 	UINT32 m_DistBaseCnts[6][cMaxFastQSeqLen]; // distribution of base counts along reads
@@ -35,6 +72,20 @@ class CFastaNxx
 	CMTqsort m_MTqsort;					// use this instance for sorts
 	static int SortByContigLen(const void *arg1, const void *arg2); // compare length function used by m_MTqsort
 
+	tsNxxLenDist *AllocLenDist(void);	// allocate and initialise an empty length distribution
+	void FreeLenDist(tsNxxLenDist *pLenDist);
+	int AddSpillLen(tsNxxLenDist *pLenDist,	// add length, >= cNxxExactLens, to distribution spilled lengths
+					int SeqLen);
+	int MergeLenDist(tsNxxLenDist *pLenDist);	// merge thread length distribution into m_pLenDist
+	int ScanFileLens(tsNxxThreadPars *pPars,	// scan file, accumulating sequence lengths into thread length distribution
+					char *pszFastaFile);
+	int NxxThread(tsNxxThreadPars *pPars);	// worker thread scanning files until all files claimed
+#ifdef _WIN32
+	static unsigned int __stdcall NxxThreadStart(void *args);
+#else
+	static void * NxxThreadStart(void *args);
+#endif
+
 public:
 	CFastaNxx();
 	~CFastaNxx();
@@ -47,6 +98,7 @@ public:
 			int MaxLength,					// will be truncated to this length
 			int NumBins,				// when generating length distributions then use this many bins - 0 defaults to using 1000
 			int BinDelta,				// when generating length distributions then each bin holds this length delta - 0 defaults to auto determine from NunBins and longest sequence length
+			int NumThreads,				// use at most this many threads when scanning files for sequence lengths
 			int NumInputFiles,				// number of input sequence files
 			char **pszInFastaFile,			// names of input sequence files (wildcards allowed)
 			char *pszRsltsFile);			// file to write fasta into
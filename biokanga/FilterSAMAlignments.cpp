@@ -24,7 +24,8 @@ int Process(int NumIncludeChroms,		// number of retained chromosomes regular exp
 	int NumExcludeChroms,		// number of chromosome expressions to explicitly exclude
 	char **ppszExcludeChroms,	// array of exclude chromosome regular expressions
 	char *pszInFile,			// input file containing alignments to be filtered
-	char *pszOutFile);			// write filtered alignments to this output file)
+	char *pszOutFile,			// write filtered alignments to this output file)
+	int NumThreads);			// number of reader threads to use if input BAM is indexed
 
 int TrimREQuotes(char *pszTxt);
 
@@ -48,6 +49,9 @@ int Rslt;
 int Idx;
 int ReLen;
 
+int NumberOfProcessors;		// number of installed CPUs
+int NumThreads;				// number of threads (0 defaults to number of CPUs)
+
 int PMode;				// processing mode
 int NumIncludeChroms;
 char *pszIncludeChroms[cMaxIncludeChroms];
@@ -75,12 +79,13 @@ struct arg_file *outfile = arg_file1("o","output","<file>",		"write accepted ali
 struct arg_file *summrslts = arg_file0("q","sumrslts","<file>",		"Output results summary to this SQLite3 database file");
 struct arg_str *experimentname = arg_str0("w","experimentname","<str>",		"experiment name SQLite3 database file");
 struct arg_str *experimentdescr = arg_str0("W","experimentdescr","<str>",	"experiment description SQLite3 database file");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
 struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
-					pmode,excludechroms,includechroms,infile,outfile,
+					pmode,excludechroms,includechroms,infile,outfile,threads,
 					end};
 
 char **pAllArgs;
@@ -244,6 +249,23 @@ if (!argerrors)
 	strncpy(szOutFile,outfile->filename[0],_MAX_PATH);
 	szOutFile[_MAX_PATH-1] = '\0';
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 // show user current resource limits
 #ifndef _WIN32
 	gDiagnostics.DiagOut(eDLInfo, gszProcName, "Resources: %s",CUtility::ReportResourceLimits());
@@ -266,6 +288,7 @@ if (!argerrors)
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Input alignment file: '%s'",szInFile);
 
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Output accepted alignments to file: '%s'",szOutFile);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 	if(szExperimentName[0] != '\0')
 		gDiagnostics.DiagOutMsgOnly(eDLInfo,"This processing reference: %s",szExperimentName);
@@ -274,7 +297,7 @@ if (!argerrors)
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = Process(NumIncludeChroms,pszIncludeChroms,NumExcludeChroms,pszExcludeChroms,szInFile,szOutFile);
+	Rslt = Process(NumIncludeChroms,pszIncludeChroms,NumExcludeChroms,pszExcludeChroms,szInFile,szOutFile,NumThreads);
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -319,27 +342,39 @@ int Process(int NumIncludeChroms,		// number of retained chromosomes regular exp
 	int NumExcludeChroms,				// number of chromosome expressions to explicitly exclude
 	char **ppszExcludeChroms,			// array of exclude chromosome regular expressions
 	char *pszInFile,					// input file containing alignments to be filtered
-	char *pszOutFile)					// write filtered alignments to this output file
+	char *pszOutFile,					// write filtered alignments to this output file
+	int NumThreads)						// number of reader threads to use if input BAM is indexed
 {
 CFilterSAMAlignments FilterSAMAlignments;
-return(FilterSAMAlignments.FilterSAMbyChrom(NumIncludeChroms,ppszIncludeChroms,NumExcludeChroms,ppszExcludeChroms,pszInFile,pszOutFile));
+return(FilterSAMAlignments.FilterSAMbyChrom(NumIncludeChroms,ppszIncludeChroms,NumExcludeChroms,ppszExcludeChroms,pszInFile,pszOutFile,NumThreads));
 }
 
 CFilterSAMAlignments::CFilterSAMAlignments()
 {
 m_pInBAMfile = NULL;
 m_pOutBAMfile = NULL;
+m_pszRetainedChroms = NULL;
+m_pThreads = NULL;
+m_NumStartedThreads = 0;
+m_pBatches = NULL;
+m_NumBatches = 0;
+m_pChromBatches = NULL;
+m_CASSerialise = 0;
 }
 
 
 CFilterSAMAlignments::~CFilterSAMAlignments()
 {
+EndReadThreads();
+if(m_pszRetainedChroms != NULL)
+	free(m_pszRetainedChroms);
 }
 
 
 void
 CFilterSAMAlignments::Reset(void)
 {
+EndReadThreads();
 if(m_pInBAMfile != NULL)
 	{
 	m_pInBAMfile->Close();
@@ -360,6 +395,35 @@ m_NumIncludeChroms = 0;
 m_ppszIncludeChroms = NULL;		
 m_NumExcludeChroms = 0;			
 m_ppszExcludeChroms = NULL;		
+
+if(m_pszRetainedChroms != NULL)
+	{
+	free(m_pszRetainedChroms);
+	m_pszRetainedChroms = NULL;
+	}
+m_NumRetainedChroms = 0;
+m_AllocRetainedChroms = 0;
+m_RetainedChromsLen = 0;
+
+m_bIdxDriven = false;
+m_NxtIdxChrom = 0;
+m_pszNxtIdxChrom = NULL;
+m_pszCurIdxChrom = NULL;
+m_szLastRName[0] = 0;
+m_bLastRNameRetained = false;
+
+m_NumThreads = 1;
+m_szInFile[0] = '\0';
+m_NxtReadChrom = 0;
+m_pszNxtReadChrom = NULL;
+m_CurWriteChrom = 0;
+m_NxtWriteSeq = 0;
+m_pWriteBatch = NULL;
+m_pNxtWriteLine = NULL;
+m_NxtWriteLineIdx = 0;
+m_bTermThreads = false;
+m_ThreadsRslt = eBSFSuccess;
+m_CASSerialise = 0;
 }
 
 
@@ -534,17 +598,498 @@ m_bFiltChrom = m_NumIncludeChroms > 0 ? true : false;
 return(m_bFiltChrom);
 }
 
+int
+CFilterSAMAlignments::AddRetainedChrom(char *pszChrom)	// append to retained chrom names
+{
+size_t Len;
+char *pTmp;
+Len = strlen(pszChrom) + 1;
+if((m_RetainedChromsLen + Len) > m_AllocRetainedChroms)
+	{
+	if((pTmp = (char *)realloc(m_pszRetainedChroms,m_AllocRetainedChroms + Len + cAllocRetainedChroms)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddRetainedChrom: unable to realloc memory for retained chrom names");
+		return(eBSFerrMem);
+		}
+	m_pszRetainedChroms = pTmp;
+	m_AllocRetainedChroms += Len + cAllocRetainedChroms;
+	}
+memcpy(&m_pszRetainedChroms[m_RetainedChromsLen],pszChrom,Len);
+m_RetainedChromsLen += Len;
+m_NumRetainedChroms += 1;
+return(m_NumRetainedChroms);
+}
+
+char *
+CFilterSAMAlignments::LocateRName(char *pszLine)	// returns ptr to the RNAME field (3rd) in a SAM alignment line, NULL if no RNAME
+{
+int FieldIdx;
+for(FieldIdx = 0; FieldIdx < 2; FieldIdx++)
+	{
+	if((pszLine = strchr(pszLine,'\t')) == NULL)
+		return(NULL);
+	pszLine += 1;
+	}
+return(pszLine);
+}
+
+int										// number of chars returned in pszLine, 0 if no more alignments
+CFilterSAMAlignments::GetNxtAlignLine(char *pszLine)	// next alignment line, if index driven then only alignments to retained chroms are returned
+{
+int Rslt;
+int LineLen;
+int NameLen;
+char *pRName;
+
+if(!m_bIdxDriven)
+	return(m_pInBAMfile->GetNxtSAMline(pszLine));
+if(m_NumStartedThreads > 0)
+	return(GetNxtBatchLine(pszLine));
+
+// alignments are sorted so all alignments to a retained chrom follow the first as located from the index
+// and are returned until an alignment to some other chrom is read
+while(1)
+	{
+	if(m_pszCurIdxChrom == NULL)
+		{
+		if(m_NxtIdxChrom == m_NumRetainedChroms)
+			return(0);
+		m_pszCurIdxChrom = m_pszNxtIdxChrom;
+		m_pszNxtIdxChrom += strlen(m_pszNxtIdxChrom) + 1;
+		m_NxtIdxChrom += 1;
+		if((Rslt = m_pInBAMfile->SeekRefSeq(m_pszCurIdxChrom)) <= 0)
+			{
+			m_pszCurIdxChrom = NULL;
+			if(Rslt < 0)
+				return(Rslt);
+			continue;		// no alignments to this chrom
+			}
+		}
+	if((LineLen = m_pInBAMfile->GetNxtSAMline(pszLine)) <= 0)
+		{
+		m_pszCurIdxChrom = NULL;
+		if(LineLen < 0)
+			return(LineLen);
+		continue;
+		}
+	NameLen = (int)strlen(m_pszCurIdxChrom);
+	if((pRName = LocateRName(pszLine)) != NULL && !strncmp(pRName,m_pszCurIdxChrom,NameLen) && pRName[NameLen] == '\t')
+		return(LineLen);
+	m_pszCurIdxChrom = NULL;
+	}
+}
+
+// GetNxtBatchLine
+// Returns the alignment lines read into batches by the reader threads, batches are returned in retained chrom order and then in the order
+// read so lines are returned in the same order as when a single reader seeks to each retained chrom in turn
+int										// number of chars returned in pszLine, 0 if no more alignments
+CFilterSAMAlignments::GetNxtBatchLine(char *pszLine)	// next alignment line from batches filled by reader threads, returned in retained chrom and batch order
+{
+int BatchIdx;
+int LineLen;
+tsFSABatch *pBatch;
+
+while(m_pWriteBatch == NULL)
+	{
+	AcquireSerialise();
+	if(m_ThreadsRslt < eBSFSuccess)
+		{
+		LineLen = m_ThreadsRslt;
+		ReleaseSerialise();
+		return(LineLen);
+		}
+	if(m_CurWriteChrom == m_NumRetainedChroms)
+		{
+		ReleaseSerialise();
+		return(0);
+		}
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)
+		if(pBatch->State == eFSABfilled && pBatch->ChromOrd == m_CurWriteChrom && pBatch->BatchSeq == m_NxtWriteSeq)
+			break;
+	if(BatchIdx < m_NumBatches)
+		{
+		pBatch->State = eFSABwriting;
+		m_pWriteBatch = pBatch;
+		m_pNxtWriteLine = pBatch->pBuff;
+		m_NxtWriteLineIdx = 0;
+		m_NxtWriteSeq += 1;
+		ReleaseSerialise();
+		break;
+		}
+	if(m_pChromBatches[m_CurWriteChrom] == m_NxtWriteSeq)	// all batches for current chrom written?
+		{
+		m_CurWriteChrom += 1;
+		m_NxtWriteSeq = 0;
+		ReleaseSerialise();
+		continue;
+		}
+	ReleaseSerialise();
+	CUtility::SleepMillisecs(1);
+	}
+
+LineLen = (int)strlen(m_pNxtWriteLine);
+memcpy(pszLine,m_pNxtWriteLine,LineLen + 1);
+m_pNxtWriteLine += LineLen + 1;
+m_NxtWriteLineIdx += 1;
+if(m_NxtWriteLineIdx == m_pWriteBatch->NumLines)
+	{
+	AcquireSerialise();
+	m_pWriteBatch->State = eFSABfree;
+	ReleaseSerialise();
+	m_pWriteBatch = NULL;
+	}
+return(LineLen);
+}
+
+// AcquireFreeBatch
+// The last free batch is reserved for the chrom currently being written, readers ahead of the writer are then unable to starve the
+// reader of the chrom being written
+tsFSABatch *						// batch to fill, NULL if reader threads are to terminate
+CFilterSAMAlignments::AcquireFreeBatch(int ChromOrd)	// reader thread requesting a free batch to fill with alignments to ChromOrd
+{
+int BatchIdx;
+int NumFree;
+tsFSABatch *pBatch;
+tsFSABatch *pFreeBatch;
+
+while(1)
+	{
+	AcquireSerialise();
+	if(m_bTermThreads || m_ThreadsRslt < eBSFSuccess)
+		{
+		ReleaseSerialise();
+		return(NULL);
+		}
+	NumFree = 0;
+	pFreeBatch = NULL;
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)
+		{
+		if(pBatch->State != eFSABfree)
+			continue;
+		if(pFreeBatch == NULL)
+			pFreeBatch = pBatch;
+		NumFree += 1;
+		}
+	if(pFreeBatch != NULL && (NumFree > 1 || ChromOrd == m_CurWriteChrom))
+		{
+		pFreeBatch->State = eFSABfilling;
+		pFreeBatch->ChromOrd = ChromOrd;
+		pFreeBatch->BatchSeq = 0;
+		pFreeBatch->NumLines = 0;
+		pFreeBatch->BuffLen = 0;
+		ReleaseSerialise();
+		return(pFreeBatch);
+		}
+	ReleaseSerialise();
+	CUtility::SleepMillisecs(1);
+	}
+}
+
+void
+CFilterSAMAlignments::PostFilledBatch(tsFSABatch *pBatch)	// reader thread has filled pBatch
+{
+AcquireSerialise();
+pBatch->State = pBatch->NumLines > 0 ? eFSABfilled : eFSABfree;
+ReleaseSerialise();
+}
+
+// ThreadReadChroms
+// Reader thread, opens its own instance of the indexed input BAM and claims retained chroms in header order, alignments to each claimed
+// chrom are seeked and read into batches until an alignment to some other chrom is read
+int
+CFilterSAMAlignments::ThreadReadChroms(tsFSAThreadPars *pPars)
+{
+int Rslt;
+int LineLen;
+int NameLen;
+int ChromOrd;
+int NumChromBatches;
+char *pszChrom;
+char *pRName;
+char *pszLine;
+CSAMfile *pInBAMfile;
+tsFSABatch *pBatch;
+
+pInBAMfile = NULL;
+if((pszLine = new char [cMaxBAMLineLen + 1]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ThreadReadChroms: unable to allocate memory for line buffer");
+	Rslt = eBSFerrMem;
+	}
+else
+	if((pInBAMfile = new CSAMfile) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ThreadReadChroms: Unable to instantiate class CSAMfile");
+		Rslt = eBSFerrInternal;
+		}
+	else
+		if((Rslt = pInBAMfile->Open(m_szInFile)) != eBSFSuccess)
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"ThreadReadChroms: Unable to open SAM/BAM format file %s",m_szInFile);
+		else
+			{
+			// reference sequence names are only known to the index after the header has been read
+			while((LineLen = pInBAMfile->GetNxtSAMline(pszLine)) > 0 && pszLine[0] == '@');
+			if(LineLen < 0)
+				Rslt = LineLen;
+			else
+				if(!pInBAMfile->HasRefSeqIdx())
+					{
+					gDiagnostics.DiagOut(eDLFatal,gszProcName,"ThreadReadChroms: Unable to use index for SAM/BAM format file %s",m_szInFile);
+					Rslt = eBSFerrFileAccess;
+					}
+			}
+
+while(Rslt >= eBSFSuccess)
+	{
+	AcquireSerialise();
+	if(m_bTermThreads || m_ThreadsRslt < eBSFSuccess || m_NxtReadChrom == m_NumRetainedChroms)
+		{
+		ReleaseSerialise();
+		break;
+		}
+	ChromOrd = m_NxtReadChrom++;
+	pszChrom = m_pszNxtReadChrom;
+	m_pszNxtReadChrom += strlen(pszChrom) + 1;
+	ReleaseSerialise();
+
+	NumChromBatches = 0;
+	pBatch = NULL;
+	NameLen = (int)strlen(pszChrom);
+	if((Rslt = pInBAMfile->SeekRefSeq(pszChrom)) > 0)
+		{
+		while((LineLen = pInBAMfile->GetNxtSAMline(pszLine)) > 0)
+			{
+			if((pRName = LocateRName(pszLine)) == NULL || strncmp(pRName,pszChrom,NameLen) || pRName[NameLen] != '\t')
+				break;
+			LineLen = (int)strlen(pszLine);
+			if(pBatch != NULL && (pBatch->BuffLen + LineLen + 1) > cFSABatchBuffSize)
+				{
+				PostFilledBatch(pBatch);
+				pBatch = NULL;
+				}
+			if(pBatch == NULL)
+				{
+				if((pBatch = AcquireFreeBatch(ChromOrd)) == NULL)	// NULL if terminating
+					break;
+				pBatch->BatchSeq = NumChromBatches++;
+				}
+			memcpy(&pBatch->pBuff[pBatch->BuffLen],pszLine,LineLen + 1);
+			pBatch->BuffLen += LineLen + 1;
+			pBatch->NumLines += 1;
+			}
+		Rslt = LineLen < 0 ? LineLen : eBSFSuccess;
+		}
+	if(pBatch != NULL)
+		PostFilledBatch(pBatch);
+	if(Rslt < eBSFSuccess)
+		break;
+	AcquireSerialise();
+	m_pChromBatches[ChromOrd] = NumChromBatches;
+	ReleaseSerialise();
+	}
+
+if(Rslt < eBSFSuccess)
+	{
+	AcquireSerialise();
+	if(m_ThreadsRslt >= eBSFSuccess)
+		m_ThreadsRslt = Rslt;
+	ReleaseSerialise();
+	}
+if(pInBAMfile != NULL)
+	{
+	pInBAMfile->Close();
+	delete pInBAMfile;
+	}
+if(pszLine != NULL)
+	delete []pszLine;
+return(Rslt);
+}
+
+#ifdef _WIN32
+unsigned __stdcall FSAReadThread(void * pThreadPars)
+#else
+void *FSAReadThread(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsFSAThreadPars *pPars = (tsFSAThreadPars *)pThreadPars;			// makes it easier not having to deal with casts!
+CFilterSAMAlignments *pFilterSAMAlignments = (CFilterSAMAlignments *)pPars->pThis;
+
+Rslt = pFilterSAMAlignments->ThreadReadChroms(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+int
+CFilterSAMAlignments::StartReadThreads(void)	// start reader threads, each reads alignments to retained chroms claimed in header order into batches
+{
+int Idx;
+int NumThreads;
+tsFSABatch *pBatch;
+tsFSAThreadPars *pThread;
+
+EndReadThreads();
+NumThreads = min(m_NumThreads,m_NumRetainedChroms);
+m_NumBatches = min((NumThreads * 2) + 2,cFSAMaxBatches);
+if((m_pBatches = new tsFSABatch [m_NumBatches]) == NULL ||
+	(m_pChromBatches = new int [m_NumRetainedChroms]) == NULL ||
+	(m_pThreads = new tsFSAThreadPars [NumThreads]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"StartReadThreads: Unable to allocate memory for reader threads");
+	EndReadThreads();
+	return(eBSFerrMem);
+	}
+memset(m_pBatches,0,sizeof(tsFSABatch) * m_NumBatches);
+memset(m_pThreads,0,sizeof(tsFSAThreadPars) * NumThreads);
+pBatch = m_pBatches;
+for(Idx = 0; Idx < m_NumBatches; Idx++,pBatch++)
+	{
+	pBatch->State = eFSABfree;
+	if((pBatch->pBuff = new char [cFSABatchBuffSize]) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"StartReadThreads: Unable to allocate memory for batch buffers");
+		EndReadThreads();
+		return(eBSFerrMem);
+		}
+	}
+for(Idx = 0; Idx < m_NumRetainedChroms; Idx++)
+	m_pChromBatches[Idx] = -1;
+
+m_NxtReadChrom = 0;
+m_pszNxtReadChrom = m_pszRetainedChroms;
+m_CurWriteChrom = 0;
+m_NxtWriteSeq = 0;
+m_pWriteBatch = NULL;
+m_pNxtWriteLine = NULL;
+m_NxtWriteLineIdx = 0;
+m_bTermThreads = false;
+m_ThreadsRslt = eBSFSuccess;
+
+pThread = m_pThreads;
+for(Idx = 1; Idx <= NumThreads; Idx++, pThread++)
+	{
+	pThread->ThreadIdx = Idx;
+	pThread->pThis = this;
+#ifdef _WIN32
+	pThread->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,FSAReadThread,pThread,0,&pThread->threadID);
+	if(pThread->threadHandle == 0)
+#else
+	if((pThread->threadRslt = pthread_create(&pThread->threadID,NULL,FSAReadThread,pThread)) != 0)
+#endif
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"StartReadThreads: Unable to start reader thread %d",Idx);
+		EndReadThreads();
+		return(eBSFerrInternal);
+		}
+	m_NumStartedThreads += 1;
+	}
+return(m_NumStartedThreads);
+}
+
+void
+CFilterSAMAlignments::EndReadThreads(void)	// request reader threads to terminate and wait for them, batches are then freed
+{
+int Idx;
+tsFSABatch *pBatch;
+tsFSAThreadPars *pThread;
+
+if(m_pThreads != NULL)
+	{
+	AcquireSerialise();
+	m_bTermThreads = true;
+	ReleaseSerialise();
+	pThread = m_pThreads;
+	for(Idx = 0; Idx < m_NumStartedThreads; Idx++, pThread++)
+		{
+#ifdef _WIN32
+		WaitForSingleObject(pThread->threadHandle,INFINITE);
+		CloseHandle(pThread->threadHandle);
+#else
+		pthread_join(pThread->threadID,NULL);
+#endif
+		}
+	delete []m_pThreads;
+	m_pThreads = NULL;
+	}
+m_NumStartedThreads = 0;
+
+if(m_pBatches != NULL)
+	{
+	pBatch = m_pBatches;
+	for(Idx = 0; Idx < m_NumBatches; Idx++,pBatch++)
+		if(pBatch->pBuff != NULL)
+			delete []pBatch->pBuff;
+	delete []m_pBatches;
+	m_pBatches = NULL;
+	}
+m_NumBatches = 0;
+if(m_pChromBatches != NULL)
+	{
+	delete []m_pChromBatches;
+	m_pChromBatches = NULL;
+	}
+m_pWriteBatch = NULL;
+}
+
+void
+CFilterSAMAlignments::AcquireSerialise(void)
+{
+int SpinCnt = 1000;
+int BackoffMS = 1;
+
+#ifdef _WIN32
+while(InterlockedCompareExchange(&m_CASSerialise,1,0)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 50)
+		BackoffMS += 1;
+	}
+#else
+while(__sync_val_compare_and_swap(&m_CASSerialise,0,1)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 50)
+		BackoffMS += 1;
+	}
+#endif
+}
+
+void
+CFilterSAMAlignments::ReleaseSerialise(void)
+{
+#ifdef _WIN32
+InterlockedCompareExchange(&m_CASSerialise,0,1);
+#else
+__sync_val_compare_and_swap(&m_CASSerialise,1,0);
+#endif
+}
+
 int								// number of alignments which were retained and written to output file after filtering was applied
 CFilterSAMAlignments::FilterSAMbyChrom(int NumIncludeChroms,		// number of retained chromosomes regular expressions
 	char **ppszIncludeChroms,	// array of include chromosome regular expressions
 	int NumExcludeChroms,		// number of chromosome expressions to explicitly exclude
 	char **ppszExcludeChroms,	// array of exclude chromosome regular expressions
 	char *pszInFile,			// input file containing alignments to be filtered
-	char *pszOutFile)			// write filtered alignments to this output file
+	char *pszOutFile,			// write filtered alignments to this output file
+	int NumThreads)				// number of reader threads to use if input BAM is indexed
 {
 teBSFrsltCodes Rslt;
 
 Reset();
+m_NumThreads = NumThreads;
 
 if((Rslt=(teBSFrsltCodes)SetChromFilters(NumIncludeChroms,ppszIncludeChroms,NumExcludeChroms,ppszExcludeChroms)) != eBSFSuccess)
 	{
@@ -571,6 +1116,8 @@ int ContigLen;
 int Tmp = 0;
 
 char *pTxt;
+char *pRName;
+int RNameLen;
 
 	// if SAM output format then could be BGZF compressed BAM; use the extension to determine which...
 	// if extension is '.bam' then BGZF compressed BAM, any other extension is for SAM
@@ -589,6 +1136,8 @@ if(pszInFile == NULL || *pszInFile == '\0')
 	Reset();
 	return(eBSFerrParams);
 	}
+strncpy(m_szInFile,pszInFile,sizeof(m_szInFile));
+m_szInFile[sizeof(m_szInFile)-1] = '\0';
 
 if((m_pInBAMfile = new CSAMfile) == NULL)
 	{
@@ -645,11 +1194,12 @@ NumAcceptedEls = 0;
 NumUnmappedEls = 0;
 bFirstAlignment = true;
 Rslt = eBSFSuccess;
+LineLen = 0;
 
 NumMappedChroms = 0;
 time_t Then = time(NULL);
 time_t Now;
-while(Rslt >= eBSFSuccess && (LineLen = m_pInBAMfile->GetNxtSAMline(szLine)) > 0)
+while(Rslt >= eBSFSuccess && (LineLen = GetNxtAlignLine(szLine)) > 0)
 	{
 	NumParsedElLines += 1;
 	if(!(NumParsedElLines % 100000) || NumParsedElLines == 1)
@@ -681,6 +1231,8 @@ while(Rslt >= eBSFSuccess && (LineLen = m_pInBAMfile->GetNxtSAMline(szLine)) > 0
 			continue;
 
 		m_pOutBAMfile->AddRefSeq(szGenome,szContig,ContigLen);
+		if((Rslt = (teBSFrsltCodes)AddRetainedChrom(szContig)) < eBSFSuccess)
+			break;
 		NumMappedChroms += 1;
 		continue;
 		}	
@@ -693,6 +1245,41 @@ while(Rslt >= eBSFSuccess && (LineLen = m_pInBAMfile->GetNxtSAMline(szLine)) > 0
 	if(!NumMappedChroms)
 		break;
 
+	if(!m_bIdxDriven && NumAcceptedEls == 0 && NumUnmappedEls == 0 && m_pInBAMfile->HasRefSeqIdx())
+		{
+		// BAM is indexed so can seek directly to the alignments for each retained chrom; this first alignment will be reread if to a retained chrom
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Input is indexed, processing alignments to each of %d retained Chroms directly",NumMappedChroms);
+		m_bIdxDriven = true;
+		m_NxtIdxChrom = 0;
+		m_pszNxtIdxChrom = m_pszRetainedChroms;
+		m_pszCurIdxChrom = NULL;
+		if(m_NumThreads > 1 && NumMappedChroms > 1)	// alignments to each retained chrom are read by reader threads
+			{
+			if((Rslt = (teBSFrsltCodes)StartReadThreads()) < eBSFSuccess)
+				break;
+			gDiagnostics.DiagOut(eDLInfo,gszProcName,"Started %d threads reading alignments to retained Chroms",Rslt);
+			Rslt = eBSFSuccess;
+			}
+		continue;
+		}
+
+	// prefilter on the RNAME so alignments to filtered out chroms need not be fully parsed
+	if((pRName = LocateRName(pTxt)) != NULL)
+		{
+		for(RNameLen = 0; pRName[RNameLen] != '\t' && pRName[RNameLen] != '\0' && RNameLen < (int)sizeof(m_szLastRName)-1; RNameLen++);
+		if(strncmp(pRName,m_szLastRName,RNameLen) || m_szLastRName[RNameLen] != '\0')
+			{
+			memcpy(m_szLastRName,pRName,RNameLen);
+			m_szLastRName[RNameLen] = '\0';
+			m_bLastRNameRetained = m_pOutBAMfile->LocateRefSeqID(m_szLastRName) > 0 ? true : false;
+			}
+		if(!m_bLastRNameRetained)
+			{
+			NumUnmappedEls += 1;
+			continue;
+			}
+		}
+
 	// primary interest is in the reference chromname, startloci, length
 	if((Rslt = (teBSFrsltCodes)m_pOutBAMfile->ParseSAM2BAMalign(pTxt,&ProvBAMalignment,NULL)) < eBSFSuccess)
 		{
@@ -724,6 +1311,12 @@ while(Rslt >= eBSFSuccess && (LineLen = m_pInBAMfile->GetNxtSAMline(szLine)) > 0
 	AcceptedBAMalignment = ProvBAMalignment;
 	NumAcceptedEls += 1;
 	}
+if(Rslt >= eBSFSuccess && LineLen < 0)
+	{
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Error %d reading alignments after parsed %d element lines, unmapped %d, accepted %d",LineLen,NumParsedElLines,NumUnmappedEls,NumAcceptedEls);
+	Rslt = (teBSFrsltCodes)LineLen;
+	}
+EndReadThreads();
 
 if(Rslt >= eBSFSuccess && NumAcceptedEls > 0)
 	{
@@ -2,6 +2,45 @@
 
 const int cMaxExcludeChroms = 20;		// allow upto this many regexpr for specifying chroms to exclude
 const int cMaxIncludeChroms = 20;		// allow upto this many regexpr for specifying chroms to include
+const size_t cAllocRetainedChroms = 0x010000;	// allocate for retained chrom names in this sized increments
+
+const int cMaxWorkerThreads = 128;			// limiting max number of threads to this many
+const size_t cFSABatchBuffSize = 0x0400000;	// batch SAM lines buffer size, must be larger than cMaxBAMLineLen
+const int cFSAMaxBatches = 16;				// at most this many batches in flight, irrespective of the number of reader threads
+
+// batch processing states
+typedef enum TAG_eFSABatchState {
+	eFSABfree = 0,					// batch is available for filling
+	eFSABfilling,					// batch is being filled by a reader thread
+	eFSABfilled,					// batch has been filled and is ready for writing
+	eFSABwriting					// batch lines are being returned to the writer
+	} etFSABatchState;
+
+#pragma pack(1)
+
+typedef struct TAG_sFSABatch {
+	etFSABatchState State;			// current processing state
+	int ChromOrd;					// batch holds alignments to this retained chrom (0..m_NumRetainedChroms-1)
+	int BatchSeq;					// batches for a retained chrom are written in this order (0..n)
+	int NumLines;					// number of SAM lines in pBuff
+	size_t BuffLen;					// current number of chars in pBuff
+	char *pBuff;					// holds '\0' separated SAM lines
+} tsFSABatch;
+
+typedef struct TAG_sFSAThreadPars {
+	int ThreadIdx;					// uniquely identifies this thread
+	void *pThis;					// will be initialised to pt to CFilterSAMAlignments instance
+#ifdef _WIN32
+	HANDLE threadHandle;			// handle as returned by _beginthreadex()
+	unsigned int threadID;			// identifier as set by _beginthreadex()
+#else
+	int threadRslt;					// result as returned by pthread_create ()
+	pthread_t threadID;				// identifier as set by pthread_create ()
+#endif
+	int Rslt;						// returned result code
+} tsFSAThreadPars;
+
+#pragma pack()
 
 class CFilterSAMAlignments
 {
@@ -23,6 +62,57 @@ class CFilterSAMAlignments
 	char m_szFiltChrom[_MAX_PATH];	// used to cache last chrom processed	
 	bool m_bFiltChrom;				// and it's filtered status
 
+	char m_szLastRName[_MAX_PATH];	// used to cache last alignment reference sequence name prefiltered
+	bool m_bLastRNameRetained;		// and if alignments to that reference sequence are retained
+
+	int m_NumRetainedChroms;		// number of chroms retained after filtering, in header order
+	size_t m_AllocRetainedChroms;	// m_pszRetainedChroms currently allocated to this size
+	size_t m_RetainedChromsLen;		// m_pszRetainedChroms currently used
+	char *m_pszRetainedChroms;		// concatenated '\0' terminated retained chrom names
+
+	bool m_bIdxDriven;				// true if input BAM is indexed and alignments to retained chroms are being directly seeked
+	int m_NxtIdxChrom;				// when index driven then next retained chrom to seek
+	char *m_pszNxtIdxChrom;			// name of next retained chrom to seek
+	char *m_pszCurIdxChrom;			// alignments are currently being returned for this retained chrom, NULL if seek to next retained chrom required
+
+	int m_NumThreads;				// number of reader threads to use when index driven
+	char m_szInFile[_MAX_PATH];		// reader threads each open their own instance of this input file
+	int m_NumStartedThreads;		// number of reader threads started
+	tsFSAThreadPars *m_pThreads;	// reader thread parameters
+	int m_NumBatches;				// number of batches in m_pBatches
+	tsFSABatch *m_pBatches;			// batches of SAM lines read by the reader threads
+	int *m_pChromBatches;			// per retained chrom, total number of batches read or -1 if chrom still being read
+	int m_NxtReadChrom;				// next retained chrom to be claimed by a reader thread
+	char *m_pszNxtReadChrom;		// name of next retained chrom to be claimed
+	int m_CurWriteChrom;			// alignments to this retained chrom are currently being written
+	int m_NxtWriteSeq;				// next batch sequence to write for m_CurWriteChrom
+	tsFSABatch *m_pWriteBatch;		// lines are currently being returned from this batch
+	char *m_pNxtWriteLine;			// next line in m_pWriteBatch to return
+	int m_NxtWriteLineIdx;			// index of m_pNxtWriteLine in m_pWriteBatch
+	bool m_bTermThreads;			// set true to request reader threads to terminate
+	int m_ThreadsRslt;				// set < eBSFSuccess by any reader thread which errored
+	volatile unsigned int m_CASSerialise;	// used with synchronous compare and swap (CAS) for serialising access
+
+	void AcquireSerialise(void);
+	void ReleaseSerialise(void);
+
+	int StartReadThreads(void);		// start reader threads, each reads alignments to retained chroms claimed in header order into batches
+	void EndReadThreads(void);		// request reader threads to terminate and wait for them, batches are then freed
+
+	int								// number of chars returned in pszLine, 0 if no more alignments
+		GetNxtBatchLine(char *pszLine);	// next alignment line from batches filled by reader threads, returned in retained chrom and batch order
+
+	tsFSABatch *					// batch to fill, NULL if reader threads are to terminate
+		AcquireFreeBatch(int ChromOrd);	// reader thread requesting a free batch to fill with alignments to ChromOrd
+	void PostFilledBatch(tsFSABatch *pBatch);	// reader thread has filled pBatch
+
+	int AddRetainedChrom(char *pszChrom);	// append to retained chrom names
+
+	int										// number of chars returned in pszLine, 0 if no more alignments
+		GetNxtAlignLine(char *pszLine);		// next alignment line, if index driven then only alignments to retained chroms are returned
+
+	char *LocateRName(char *pszLine);		// returns ptr to the RNAME field (3rd) in a SAM alignment line, NULL if no RNAME
+
 
 	int
 	SetChromFilters(int NumIncludeChroms,		 // number of chromosome regular expressions to include
@@ -45,12 +135,15 @@ public:
 	void Reset(void);
 	void Init(void);
 
+	int ThreadReadChroms(tsFSAThreadPars *pPars);	// reader thread entry, reads alignments to claimed retained chroms
+
 	int								// number of alignments which were retained and written to output file after filtering was applied
 		FilterSAMbyChrom(int NumIncludeChroms,		// number of retained chromosomes regular expressions
 		char **ppszIncludeChroms,	// array of include chromosome regular expressions
 		int NumExcludeChroms,		// number of chromosome expressions to explicitly exclude
 		char **ppszExcludeChroms,	// array of exclude chromosome regular expressions
 		char *pszInFile,			// input file containing alignments to be filtered
-		char *pszOutFile);			// write filtered alignments to this output file
+		char *pszOutFile,			// write filtered alignments to this output file
+		int NumThreads);			// number of reader threads to use if input BAM is indexed
 };
 
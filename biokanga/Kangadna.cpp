@@ -283,12 +283,7 @@ if(m_Sequences.pSuffixArray != NULL)
 
 if(m_Sequences.pSeqs2Assemb != NULL)
 	{
-#ifdef _WIN32
-	free(m_Sequences.pSeqs2Assemb);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_Sequences.pSeqs2Assemb != MAP_FAILED)
-		munmap(m_Sequences.pSeqs2Assemb,m_Sequences.AllocMemSeqs2Assemb);
-#endif	
+	m_Seqs2AssembArena.Release();
 	m_Sequences.pSeqs2Assemb = NULL;
 	}
 
@@ -329,6 +324,16 @@ if(maxThreads < 0 || maxThreads > cMaxWorkerThreads)
 m_NumThreads = maxThreads;
 m_bAffinity = bAffinity;
 m_MTqsort.SetMaxThreads(maxThreads);
+
+// on multinode hosts worker threads are pinned round-robin onto NUMA nodes if affinity was requested, or through 'BIOKANGA_NUMA'
+// sequences and suffix arrays are then accessed by threads on all nodes so are interleaved over the nodes
+if(CNUMATopology::Discover() > 1)
+	{
+	if(bAffinity)
+		CNUMATopology::SetPinThreads(true);
+	if(CNUMATopology::PinThreads())
+		m_Seqs2AssembArena.SetPlacement(cMemArenaDefaults | cMemArenaInterleave);
+	}
 CreateMutexes();
 return(eBSFSuccess);
 }
@@ -1043,8 +1048,19 @@ m_Sequences.AllocMemSeqFlags = 0;
 Rslt = eBSFSuccess;
 if(PPCRdsHdr.Sequences.OfsSeqs2Assemb && PPCRdsHdr.Sequences.AllocMemSeqs2Assemb)
 	{
-	if((Rslt = AllocLoadBlock(pszTypeSeqFile,PPCRdsHdr.Sequences.OfsSeqs2Assemb,PPCRdsHdr.Sequences.AllocMemSeqs2Assemb,&m_Sequences.pSeqs2Assemb,&m_Sequences.AllocMemSeqs2Assemb))!=eBSFSuccess)
+	// loaded into an arena so the concatenated sequences can subsequently be grown in place
+	if((m_Sequences.pSeqs2Assemb = m_Seqs2AssembArena.Grow((size_t)PPCRdsHdr.Sequences.AllocMemSeqs2Assemb)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadPackedSeqsFromFile: Concatenated packed sequences memory allocation of %llu bytes failed",PPCRdsHdr.Sequences.AllocMemSeqs2Assemb);
+		Reset(false);
+		return(eBSFerrMem);
+		}
+	m_Sequences.AllocMemSeqs2Assemb = PPCRdsHdr.Sequences.AllocMemSeqs2Assemb;
+	if((Rslt = ChunkedRead(m_hInSeqTypesFile,pszTypeSeqFile,PPCRdsHdr.Sequences.OfsSeqs2Assemb,(UINT8 *)m_Sequences.pSeqs2Assemb,PPCRdsHdr.Sequences.AllocMemSeqs2Assemb))!=eBSFSuccess)
+		{
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadPackedSeqsFromFile: Loading file %s failed",pszTypeSeqFile);
+		Reset(false);
+		}
 	else
 		m_Sequences.bSeqs2AssembDirty = true;			// force suffix indexes to be re-generated
 	}
@@ -1190,39 +1206,18 @@ if((UINT64)SizeT != ReqAllocSize)
 	}
 ReqAllocSize = (ReqAllocSize + 3) & (UINT64)0x0ffffffffffffc;						// ensure allocation is for integral number of tSeqWrd4's
 
-if(m_Sequences.pSeqs2Assemb != NULL && (m_Sequences.AllocMemSeqs2Assemb < ReqAllocSize || ((m_Sequences.AllocMemSeqs2Assemb * 10) > (ReqAllocSize * 12))))
-	{
-#ifdef _WIN32
-	free(m_Sequences.pSeqs2Assemb);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_Sequences.pSeqs2Assemb != MAP_FAILED)
-		munmap(m_Sequences.pSeqs2Assemb,m_Sequences.AllocMemSeqs2Assemb);
-#endif	
-	m_Sequences.pSeqs2Assemb = NULL;
-	m_Sequences.AllocMemSeqs2Assemb = 0;
-	}
+// existing allocation is grown in place, or any surplus over 20% decommitted, rather than being released and reallocated
+if(m_Sequences.pSeqs2Assemb != NULL && (m_Sequences.AllocMemSeqs2Assemb * 10) > (ReqAllocSize * 12))
+	m_Sequences.pSeqs2Assemb = m_Seqs2AssembArena.Shrink((size_t)ReqAllocSize);
 
-if(m_Sequences.pSeqs2Assemb == NULL)
+if((m_Sequences.pSeqs2Assemb = m_Seqs2AssembArena.Grow((size_t)ReqAllocSize)) == NULL)
 	{
-	m_Sequences.AllocMemSeqs2Assemb = (size_t)ReqAllocSize;
-#ifdef _WIN32
-	m_Sequences.pSeqs2Assemb = malloc((size_t)m_Sequences.AllocMemSeqs2Assemb);	
-	if(m_Sequences.pSeqs2Assemb == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocSeqs2AssembMem: Concatenated packed sequences memory allocation of %llu bytes - %s",m_Sequences.AllocMemSeqs2Assemb,strerror(errno));
-		Reset(false);
-		return(eBSFerrMem);
-		}
-#else
-	if((m_Sequences.pSeqs2Assemb = (void *)mmap(NULL,m_Sequences.AllocMemSeqs2Assemb, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0)) == MAP_FAILED)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocSeqs2AssembMem: Concatenated packed sequences memory of %llu bytes through mmap()  failed - %s",m_Sequences.AllocMemSeqs2Assemb,strerror(errno));
-		m_Sequences.pSeqs2Assemb = NULL;
-		Reset(false);
-		return(eBSFerrMem);
-		}
-#endif
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocSeqs2AssembMem: Concatenated packed sequences memory allocation of %llu bytes failed",ReqAllocSize);
+	m_Sequences.AllocMemSeqs2Assemb = 0;
+	Reset(false);
+	return(eBSFerrMem);
 	}
+m_Sequences.AllocMemSeqs2Assemb = ReqAllocSize;
 
 memset(m_Sequences.pSeqs2Assemb,0,(size_t)m_Sequences.AllocMemSeqs2Assemb);	// commits the memory!
 m_Sequences.Seqs2AssembLen = 0;
@@ -1451,6 +1446,7 @@ void * ThreadedFiltReads(void * pThreadPars)
 int Rslt = 0;
 tsThreadFiltReadsPars *pPars = (tsThreadFiltReadsPars *)pThreadPars; // makes it easier not having to deal with casts!
 CKangadna *pThis = (CKangadna *)pPars->pThis;
+CNUMATopology::PinWorker(pPars->ThreadIdx - 1);
 Rslt = pThis->ProcReadsThread(pPars);
 pPars->Rslt = Rslt;
 #ifdef _WIN32
@@ -1484,6 +1480,9 @@ pPars->PE2RawReadsBuff[0] = 0;
 if(pPars == NULL || (pCtrl =  pPars->pProcReadsCtrl) == NULL)
 	return(eBSFerrParams);
 
+if(pCtrl->pReadsIngest != NULL)
+	return(GetNxtIngestRead(pPars));
+
 AcquireSerialiseReadsCtrl();
 if((Rslt = pCtrl->Rslt) < eBSFSuccess || pCtrl->bPE1PE2AllReadsProc || pCtrl->pFastaPE1 == NULL)
 	{
@@ -1625,6 +1624,81 @@ ReleaseSerialiseReadsCtrl();
 return(Rslt);
 }
 
+// GetNxtIngestRead
+// Returns next SE or PE reads from the calling thread's current chunk, when all reads in the chunk have been returned then the next parsed chunk is dequeued
+// Chunks are loaded and parsed by the ingestion threads, only the per chunk counts are updated whilst serialised
+teBSFrsltCodes										// returns < eBSFSuccess if any errors, eBSFSuccess if all reads already processed, 1 if SE or 2 if PE reads being returned for processing
+CKangadna::GetNxtIngestRead(tsThreadFiltReadsPars *pPars)		// uniquely identifies calling thread, used to manage buffers for quality scores and sequences
+{
+int NumRecs;
+bool bAllProc;
+tsProcReadsCtrl *pCtrl;
+tsFastqRecView *pPE1Rec;
+tsFastqRecView *pPE2Rec;
+
+pCtrl = pPars->pProcReadsCtrl;
+if(pPars->pIngestChunk == NULL || pPars->IngestRecIdx >= pPars->pIngestChunk->NumRecs)
+	{
+	if(pPars->pIngestChunk != NULL)
+		{
+		pCtrl->pReadsIngest->ReleaseChunk(pPars->pIngestChunk);
+		pPars->pIngestChunk = NULL;
+		}
+	AcquireSerialiseReadsCtrl();
+	bAllProc = (pCtrl->Rslt < eBSFSuccess || pCtrl->bPE1PE2AllReadsProc) ? true : false;
+	ReleaseSerialiseReadsCtrl();
+	if(bAllProc)
+		return(eBSFSuccess);
+
+	NumRecs = pCtrl->pReadsIngest->GetNxtChunk(&pPars->pIngestChunk);
+	AcquireSerialiseReadsCtrl();
+	if(NumRecs <= 0)
+		{
+		pCtrl->bPE1PE2AllReadsProc = true;
+		if(NumRecs < eBSFSuccess && pCtrl->Rslt >= eBSFSuccess)
+			pCtrl->Rslt = (teBSFrsltCodes)NumRecs;
+		ReleaseSerialiseReadsCtrl();
+		pPars->pIngestChunk = NULL;
+		return((teBSFrsltCodes)NumRecs);
+		}
+	pCtrl->NumPE1ParsedReads += NumRecs;
+	pCtrl->NumPE1DescrReads += NumRecs;
+	pCtrl->CurTotPE1ReadsParsed += NumRecs;
+	if(pCtrl->bProcPE)
+		{
+		pCtrl->NumPE2ParsedReads += NumRecs;
+		pCtrl->NumPE2DescrReads += NumRecs;
+		}
+	ReleaseSerialiseReadsCtrl();
+	pPars->IngestRecIdx = 0;
+	}
+
+pPE1Rec = &pPars->pIngestChunk->pPE1Recs[pPars->IngestRecIdx];
+pPars->NumPE1ParsedReads += 1;
+pPars->PE1ReadLen = CFasta::Ascii2Sense(pPE1Rec->pSeq,min(pPE1Rec->SeqLen,(int)sizeof(pPars->PE1RawReadsBuff)-1),pPars->PE1RawReadsBuff);
+if(pCtrl->MinPhredScore > 0)
+	{
+	pPars->PE1QSLen = min(pPE1Rec->QualLen,(int)sizeof(pPars->szPE1QScoresBuff)-1);
+	memcpy(pPars->szPE1QScoresBuff,pPE1Rec->pQual,pPars->PE1QSLen);
+	pPars->szPE1QScoresBuff[pPars->PE1QSLen] = '\0';
+	}
+
+if(pCtrl->bProcPE)
+	{
+	pPE2Rec = &pPars->pIngestChunk->pPE2Recs[pPars->IngestRecIdx];
+	pPars->NumPE2ParsedReads += 1;
+	pPars->PE2ReadLen = CFasta::Ascii2Sense(pPE2Rec->pSeq,min(pPE2Rec->SeqLen,(int)sizeof(pPars->PE2RawReadsBuff)-1),(etSeqBase *)pPars->PE2RawReadsBuff);
+	if(pCtrl->MinPhredScore > 0)
+		{
+		pPars->PE2QSLen = min(pPE2Rec->QualLen,(int)sizeof(pPars->szPE2QScoresBuff)-1);
+		memcpy(pPars->szPE2QScoresBuff,pPE2Rec->pQual,pPars->PE2QSLen);
+		pPars->szPE2QScoresBuff[pPars->PE2QSLen] = '\0';
+		}
+	}
+pPars->IngestRecIdx += 1;
+return((teBSFrsltCodes)(pCtrl->bProcPE ? 2 : 1));
+}
+
  
 int
 CKangadna::ProcReadsThread(tsThreadFiltReadsPars *pPars)
@@ -1921,6 +1995,11 @@ while((Rslt = GetNxtProcRead(pPars)) > eBSFSuccess)				// < eBSFSuccess if error
 		break;
 		}
 	}
+if(pPars->pIngestChunk != NULL)
+	{
+	pPars->pProcReadsCtrl->pReadsIngest->ReleaseChunk(pPars->pIngestChunk);
+	pPars->pIngestChunk = NULL;
+	}
 pPars->Rslt = Rslt;
 return(Rslt);
 }
@@ -1977,6 +2056,7 @@ UINT32 NumContamFlankTrim;
 
 CFasta FastaPE1;
 CFasta FastaPE2;
+CReadsIngest ReadsIngest;
 
 tsReadFile *pPE1ReadFile;
 tsReadFile *pPE2ReadFile;
@@ -2189,6 +2269,26 @@ if(bIsPE2Fastq)
 else
 	ProcReadsCtrl.szPE2File[0] = '\0';
 
+// fastq files are loaded and parsed in chunks by ingestion threads concurrently with the filtering threads, multifasta continues to be parsed serially by the filtering threads
+ProcReadsCtrl.pReadsIngest = NULL;
+if(bIsPE1Fastq)
+	{
+	if((Rslt = (teBSFrsltCodes)ReadsIngest.Open(pszPE1File,m_Sequences.bPESeqs ? pszPE2File : NULL,max(1,MaxNumThreads/2))) != eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadRawReads: Unable to start concurrent loading of '%s'",pszPE1File);
+		delete [] pFiltReadsPars;
+		FastaPE1.Close();
+		if(m_Sequences.bPESeqs)
+			FastaPE2.Close();
+		Reset(false);
+		return(Rslt);
+		}
+	FastaPE1.Close();			// no longer required, releases the staging buffers
+	if(m_Sequences.bPESeqs)
+		FastaPE2.Close();
+	ProcReadsCtrl.pReadsIngest = &ReadsIngest;
+	}
+
 pCurThread = pFiltReadsPars;
 for(ThreadIdx = 0; ThreadIdx < MaxNumThreads; ThreadIdx++,pCurThread++)
 	{
@@ -2284,6 +2384,10 @@ for(ThreadIdx = 0; ThreadIdx < MaxNumThreads; ThreadIdx++,pCurThread++)
 
 // threads have all terminated
 delete pFiltReadsPars;
+if(ProcReadsCtrl.pReadsIngest != NULL)
+	ReadsIngest.Close();
+if(ProcReadsCtrl.Rslt < eBSFSuccess)
+	Rslt = ProcReadsCtrl.Rslt;
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadReads: Parsed %d, Accepted %d %s",NumPE1ParsedReads,NumPE1AcceptedReads,m_Sequences.bPESeqs ? "paired sequences":"sequences");
 
@@ -4147,6 +4251,7 @@ void *ProcGenLevsThread(void * pThreadPars)
 int Rslt;
 tsThreadPregenLevPars *pPars = (tsThreadPregenLevPars *)pThreadPars;			// makes it easier not having to deal with casts!
 CKangadna *pKangadna = (CKangadna *)pPars->pThis;
+CNUMATopology::PinWorker(pPars->ThreadIdx);
 
 Rslt = pKangadna->ProcGenLevsFwd(pPars);
 pPars->Rslt = Rslt;
@@ -4539,17 +4644,11 @@ if(MemMinReq > m_Sequences.AllocMemSeqs2Assemb)
 	size_t memreq;
 	void *pAllocd;
 	memreq = (size_t)((MemMinReq * 120) / (UINT64)100);
-#ifdef _WIN32
-	pAllocd = realloc(m_Sequences.pSeqs2Assemb,memreq);
-#else
-	pAllocd = mremap(m_Sequences.pSeqs2Assemb,m_Sequences.AllocMemSeqs2Assemb,memreq,MREMAP_MAYMOVE);
-	if(pAllocd == MAP_FAILED)
-		pAllocd = NULL;
-#endif
+	pAllocd = m_Seqs2AssembArena.Grow(memreq);
 	if(pAllocd == NULL)
 		{
 		ReleaseSerialise();
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSeq: Memory re-allocation to %d bytes - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSeq: Memory re-allocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 
@@ -4614,17 +4713,11 @@ if(MemMinReq > m_Sequences.AllocMemSeqs2Assemb)
 	size_t memreq;
 	void *pAllocd;
 	memreq = (size_t)((MemMinReq * 120) / (UINT64)100);
-#ifdef _WIN32
-	pAllocd = realloc(m_Sequences.pSeqs2Assemb,memreq);
-#else
-	pAllocd = mremap(m_Sequences.pSeqs2Assemb,m_Sequences.AllocMemSeqs2Assemb,memreq,MREMAP_MAYMOVE);
-	if(pAllocd == MAP_FAILED)
-		pAllocd = NULL;
-#endif
+	pAllocd = m_Seqs2AssembArena.Grow(memreq);
 	if(pAllocd == NULL)
 		{
 		ReleaseSerialise();
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSeq: Memory re-allocation to %d bytes - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSeq: Memory re-allocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 
@@ -6505,6 +6598,8 @@ if(m_Sequences.pSuffixArray == NULL || m_Sequences.AllocMemSfx == 0)
 		Reset(false);
 		return(eBSFerrMem);
 		}
+	if(CNUMATopology::IdxMode() != eNUMAIdxNone)		// suffix array is rebuilt as sequences are merged so is interleaved rather than replicated
+		CMemArena::Place(m_Sequences.pSuffixArray,(size_t)m_Sequences.AllocMemSfx,cMemArenaInterleave);
 #endif
 	memset(m_Sequences.pSuffixArray,0,(size_t)m_Sequences.AllocMemSfx); // commits the memory!
 
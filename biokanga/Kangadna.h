@@ -196,6 +196,7 @@ typedef struct TAG_sProcReadsCtrl {
 	CFasta *pFastaPE1;				// SE or PE1 reads are being processed from this fasta file
 	char szPE2File[_MAX_PATH];		// name of PE2 reads file
 	CFasta *pFastaPE2;				// if PE processing then PE2 reads are being processed from this fasta file
+	CReadsIngest *pReadsIngest;		// if not NULL then fastq reads are being loaded and parsed concurrently in chunks by this instance
 } tsProcReadsCtrl;
 
 typedef struct TAG_sThreadFiltReadsPars {
@@ -235,6 +236,9 @@ typedef struct TAG_sThreadFiltReadsPars {
 	UINT32 PE2QSLen;
 	UINT8 szPE2QScoresBuff[cMaxQScoreLen+1];
 
+	tsIngestChunk *pIngestChunk;	// if reads are being ingested in chunks then currently processing reads from this chunk
+	int IngestRecIdx;				// next read to process is at this index in pIngestChunk
+
 	int NumPE1ParsedReads;   // thread parsed this many PE1 reads
 	int NumPE1AcceptedReads; // and this many were accepted after filtering
 	int NumPE2ParsedReads;   // thread parsed this many PE2 reads
@@ -460,6 +464,7 @@ friend class CPacBio;					// CPacBio requires access to all members of this clas
 	UINT64 m_BaseWinMaxMem;			// windows base max working set memory in bytes when process initially started
 
 	tsSequences m_Sequences;			//  5' (eSTypePE1) and 3' (eSTtypePE2) sequences
+	CMemArena m_Seqs2AssembArena;		// m_Sequences.pSeqs2Assemb is allocated from this arena
 
 	tsEstSeqs m_SeqEsts;			// estimates of sequence lengths + total number of sequences for each sequence type
 
@@ -1122,6 +1127,9 @@ static const int cLevenshteinPacBioMismatch = 2;  // PacBio has very low rates o
 	teBSFrsltCodes										// returns < eBSFSuccess if any errors, eBSFSuccess if all reads already processed, 1 if SE or 2 if PE reads being returned for processing
 					GetNxtProcRead(tsThreadFiltReadsPars *pPars);		// uniquely identifies calling thread, used to manage buffers for quality scores and sequences
 
+	teBSFrsltCodes										// returns < eBSFSuccess if any errors, eBSFSuccess if all reads already processed, 1 if SE or 2 if PE reads being returned for processing
+					GetNxtIngestRead(tsThreadFiltReadsPars *pPars);		// as GetNxtProcRead() but reads are from chunks which have been concurrently loaded and parsed
+
 	teBSFrsltCodes	LoadLongReads(char *pszLongReadsFile); // file holding long reads (multifasta or fastq)
 
 
@@ -44,7 +44,8 @@ Process(etPROIMode PMode,					// processing mode
 		int NumAssocFiles,				// number of association files in pszAssocFiles[]
 		char *pszAssocFiles[],			// distance association files, if prefixed with #n then n is the feature tye
 		char *pszInFile,				// input CSV or BED file containing read alignment loci
-		char *pszRsltsFile);			// output CSV region loci file
+		char *pszRsltsFile,				// output CSV region loci file
+		int NumThreads);				// number of worker threads
 
 
 char *ROIRegion2Txt(etBEDRegion Region);
@@ -89,6 +90,8 @@ int  NumAssocFiles;				// number of association input files
 char *pszAssocFiles[cMaxNumAssocFiles];  // input (wildcards allowed) association BED files
 
 int Limit;						// 0 if no limit, otherwise only process for at most this number of bases
+int NumberOfProcessors;			// number of installed CPUs
+int NumThreads;					// number of threads (0 defaults to number of CPUs)
 
 // command line args
 struct arg_lit  *help    = arg_lit0("hH","help",                "print this help and exit");
@@ -113,12 +116,13 @@ struct arg_file *filterfile = arg_file0("I","filter","<file>",	"retain read base
 struct arg_file *assocfiles = arg_filen("a","assoc","<file>",0, cMaxNumAssocFiles,"optionally associate ROIs to nearest features in these annotated feature BED files");
 struct arg_file *outfile = arg_file1("o","out","<file>",		"output regions to this file");
 struct arg_int *limit = arg_int0("L","limit","<int>",		    "limit number of reads processed whilst debugging (0 == no limit)");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
 
 struct arg_end *end = arg_end(20);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
-					pmode,format,title,readstrand,retainstrand,featdiststrand,region,minmediancov,minregionlen,maxgaplen,infile,filterfile,assocfiles,outfile,limit,
+					pmode,format,title,readstrand,retainstrand,featdiststrand,region,minmediancov,minregionlen,maxgaplen,infile,filterfile,assocfiles,outfile,limit,threads,
 					end};
 
 char **pAllArgs;
@@ -316,6 +320,23 @@ if (!argerrors)
 		exit(1);
 		}
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 // show user current resource limits
 #ifndef _WIN32
 	gDiagnostics.DiagOut(eDLInfo, gszProcName, "Resources: %s",CUtility::ReportResourceLimits());
@@ -371,12 +392,13 @@ if (!argerrors)
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"output Regions Of Interest to file: '%s'",szRsltsFile);
 	if(Limit > 0)
 		gDiagnostics.DiagOutMsgOnly(eDLInfo,"limit processing to first %d reads",Limit);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 	#ifdef _WIN32
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = Process(PMode,FMode,szTitle,(char)ReadStrand,(char)RestainStrand,(char)FeatDistStrand,Region,Limit,MinMedianCov,MinRegionLen,MaxGapLen,szRegionFile,NumAssocFiles,pszAssocFiles,szInFile,szRsltsFile);
+	Rslt = Process(PMode,FMode,szTitle,(char)ReadStrand,(char)RestainStrand,(char)FeatDistStrand,Region,Limit,MinMedianCov,MinRegionLen,MaxGapLen,szRegionFile,NumAssocFiles,pszAssocFiles,szInFile,szRsltsFile,NumThreads);
 
 	gStopWatch.Stop();
 	Rslt = Rslt >=0 ? 0 : 1;
@@ -442,11 +464,12 @@ Process(etPROIMode PMode,					// processing mode
 		int NumAssocFiles,				// number of association files in pszAssocFiles[]
 		char *pszAssocFiles[],			// distance association files, if prefixed with #n then n is the feature tye
 		char *pszInFile,				// input CSV or BED file containing read alignment loci
-		char *pszRsltsFile)				// output CSV region loci file
+		char *pszRsltsFile,				// output CSV region loci file
+		int NumThreads)					// number of worker threads
 {
 CLocateROI LocateROI;
 
-return(LocateROI.Process(PMode,FMode,pszTitle,ReadStrand,RestainStrand,FeatDistStrand,Region,Limit,MinMedianCov,MinRegionLen,MaxGapLen,pszRetainFile,NumAssocFiles,pszAssocFiles,pszInFile,pszRsltsFile));
+return(LocateROI.Process(PMode,FMode,pszTitle,ReadStrand,RestainStrand,FeatDistStrand,Region,Limit,MinMedianCov,MinRegionLen,MaxGapLen,pszRetainFile,NumAssocFiles,pszAssocFiles,pszInFile,pszRsltsFile,NumThreads));
 }
 
 CLocateROI::CLocateROI()
@@ -475,10 +498,39 @@ for(int ChromIdx = 0; ChromIdx < cMaxChromCov; ChromIdx++)
 	m_ChromCnts[ChromIdx].StartOfs = 0;
 	m_ChromCnts[ChromIdx].EndOfs = 0;
 	m_ChromCnts[ChromIdx].pCovCnts = NULL;
+	m_ChromCnts[ChromIdx].TotCnts = 0;
+	m_ChromCnts[ChromIdx].NumRuns = 0;
+	m_ChromCnts[ChromIdx].pRuns = NULL;
+	m_ChromCnts[ChromIdx].NumROIs = 0;
+	m_ChromCnts[ChromIdx].AllocROIs = 0;
+	m_ChromCnts[ChromIdx].pROIs = NULL;
 	m_ChromCnts[ChromIdx].szChrom[0] = '\0';
 	}
 m_NumChromsCov = 0;	
+m_LastChromIdx = -1;
+m_NumHdrChroms = 0;
+m_AllocHdrChroms = 0;
+m_pHdrChroms = NULL;
+m_NumThreads = 1;
+m_BatchSrc = eRBSSam;
+m_ROIStrand = '*';
+m_pSAMFile = NULL;
+m_NumFiltStrand = 0;
+m_NumBatches = 0;
+m_pBatches = NULL;
+m_NxtFillSeq = 1;
+m_NxtAccumSeq = 1;
+m_bFillCompleted = false;
+m_ChromPhase = eRCPFinalise;
+m_NxtChromIdx = 0;
+m_MinMedianCov = cDfltMedianCov;
+m_MinRegionLen = cDfltRegionLen;
+m_MaxGapLen = cDfltGapLen;
+m_bNoFilter = true;
+m_ThreadsRslt = eBSFSuccess;
+m_CASSerialise = 0;
 m_NumFeatFiles = 0;
+memset(m_pszFeatFiles,0,sizeof(m_pszFeatFiles));
 m_AllocNumROIsMem = 0;
 m_AllocNumROIs = 0;
 m_NumOfROIs = 0;
@@ -518,21 +570,43 @@ if(m_NumChromsCov > 0)
 		{
 		m_ChromCnts[ChromIdx].StartOfs = 0;
 		m_ChromCnts[ChromIdx].EndOfs = 0;
-		if(m_ChromCnts[ChromIdx].pCovCnts != NULL)
+		m_CovCntsArenas[ChromIdx].Release();
+		m_ChromCnts[ChromIdx].pCovCnts = NULL;
+		if(m_ChromCnts[ChromIdx].pRuns != NULL)
 			{
 #ifdef _WIN32
-			free(m_ChromCnts[ChromIdx].pCovCnts);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
+			free(m_ChromCnts[ChromIdx].pRuns);
 #else
-			if(m_ChromCnts[ChromIdx].pCovCnts != MAP_FAILED)
-				munmap(m_ChromCnts[ChromIdx].pCovCnts,m_ChromCnts[ChromIdx].AllocCovCnts * sizeof(UINT32));
+			if(m_ChromCnts[ChromIdx].pRuns != MAP_FAILED)
+				munmap(m_ChromCnts[ChromIdx].pRuns,m_ChromCnts[ChromIdx].NumRuns * sizeof(tsCovRun));
 #endif
-			m_ChromCnts[ChromIdx].pCovCnts = NULL;
+			m_ChromCnts[ChromIdx].pRuns = NULL;
+			}
+		if(m_ChromCnts[ChromIdx].pROIs != NULL)
+			{
+			free(m_ChromCnts[ChromIdx].pROIs);
+			m_ChromCnts[ChromIdx].pROIs = NULL;
 			}
 		m_ChromCnts[ChromIdx].AllocCovCnts = 0;
+		m_ChromCnts[ChromIdx].TotCnts = 0;
+		m_ChromCnts[ChromIdx].NumRuns = 0;
+		m_ChromCnts[ChromIdx].NumROIs = 0;
+		m_ChromCnts[ChromIdx].AllocROIs = 0;
 		m_ChromCnts[ChromIdx].szChrom[0] = '\0';
 		}
 	m_NumChromsCov = 0;	
 	}
+m_LastChromIdx = -1;
+
+FreeBatches();
+
+if(m_pHdrChroms != NULL)
+	{
+	free(m_pHdrChroms);
+	m_pHdrChroms = NULL;
+	}
+m_NumHdrChroms = 0;
+m_AllocHdrChroms = 0;
 
 if(m_pROIs != NULL)
 	{
@@ -551,7 +625,7 @@ if(m_NumFeatFiles > 0)
 		{
 		if(m_pszFeatFiles[Idx] != NULL)
 			{
-			delete m_pszFeatFiles[Idx];
+			delete []m_pszFeatFiles[Idx];
 			m_pszFeatFiles[Idx] = NULL;
 			}
 		}
@@ -561,37 +635,35 @@ if(m_NumFeatFiles > 0)
 m_NumAcceptedReads = 0;
 }
 
-int
-CLocateROI::BuildReadCoverage(char *pszChrom,		// coverage is onto this chrom
-			  int StartOfs,				// coverage start at this offset 
-			  int EndOfs,				// and ends at this offset inclusive
-			  int Cnt)					// increment coverage by this
+// ResolveChromCov
+// Locates, or if a new chromosome then registers, the chromosome onto which coverage is to be accumulated and ensures the chromosome's
+// coverage counts extend to the delta immediately following EndOfs. Offsets are normalised in place to be >= 0 with StartOfs <= EndOfs
+// Only the thread filling batches resolves so chromosomes are never concurrently registered or extended, counts are held in arenas whose address
+// space is reserved for the SAM header chromosome length so extending the counts within that length never moves counts onto which worker threads
+// are applying deltas. Should counts need to be extended beyond the reservation then the arena will be relocated, so all resolved batches are
+// first drained of their deltas
+int												// returns chromosome index (m_ChromCnts[]) or < 0 if errors
+CLocateROI::ResolveChromCov(char *pszChrom,		// coverage is onto this chrom
+			  int *pStartOfs,			// coverage start at this offset 
+			  int *pEndOfs)				// and ends at this offset inclusive
 {
 tsChromCnts *pChrom;
 int ChromIdx;
-int AllocCovCnts;
+int StartOfs;
+int EndOfs;
+int ChromLen;
 UINT32 *pCovCnts;
-size_t ReallocTo;
+size_t ReqSize;
 
 if(pszChrom == NULL || pszChrom[0] == '\0')
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"BuildReadCoverage: No chromosome specified");
-	Reset();
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ResolveChromCov: No chromosome specified");
 	return(eBSFerrChrom);
 	}
 
-// arbitary count clamping to be in range 1..10000 inclusive
-if(Cnt < 1)
-	Cnt = 1;
-else
-	if(Cnt > 10000)
-		Cnt = 10000;
-
 // ensure StartOfs and EndOfs are both >= 0
-if(StartOfs < 0)
-	StartOfs = 0;
-if(EndOfs < 0)
-	EndOfs = 0;
+StartOfs = *pStartOfs < 0 ? 0 : *pStartOfs;
+EndOfs = *pEndOfs < 0 ? 0 : *pEndOfs;
 
 // ensure StartOfs <= EndOfs
 if(StartOfs > EndOfs)
@@ -601,88 +673,121 @@ if(StartOfs > EndOfs)
 	StartOfs = TmpOfs;
 	}
 
-// check if this is a new chrom or if coverage is onto an existing chrom
-pChrom = &m_ChromCnts[0];
-ChromIdx = 0;
-if(m_NumChromsCov > 0)
+// elements are usually sorted by chrom so check if coverage is onto the same chrom as the previous element before searching
+if(m_LastChromIdx >= 0 && !strnicmp(pszChrom,m_ChromCnts[m_LastChromIdx].szChrom,cMaxDatasetSpeciesChrom))
 	{
-	for(ChromIdx = 0; ChromIdx < m_NumChromsCov; ChromIdx++,pChrom++)
-		{
-		if(!strnicmp(pszChrom,pChrom->szChrom,cMaxDatasetSpeciesChrom))
-			break;
-		}
+	ChromIdx = m_LastChromIdx;
+	pChrom = &m_ChromCnts[ChromIdx];
 	}
-if(ChromIdx == m_NumChromsCov)	// if a new or first chrom
+else
 	{
-	strncpy(pChrom->szChrom,pszChrom,cMaxDatasetSpeciesChrom);
-	pChrom->szChrom[cMaxDatasetSpeciesChrom-1] = 0;
-	pChrom->StartOfs = StartOfs;
-	pChrom->EndOfs = EndOfs;
-	AllocCovCnts = EndOfs + cAllocCovCnts;
-	ReallocTo =  AllocCovCnts * sizeof(UINT32);
-#ifdef _WIN32
-	pChrom->pCovCnts = (UINT32 *) malloc(ReallocTo);	// initial and perhaps the only allocation
-	if(pChrom->pCovCnts == NULL)
+	// check if this is a new chrom or if coverage is onto an existing chrom
+	pChrom = &m_ChromCnts[0];
+	ChromIdx = 0;
+	if(m_NumChromsCov > 0)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"BuildReadCoverage: Memory allocation of %lld bytes - %s",(INT64)ReallocTo,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
+		for(ChromIdx = 0; ChromIdx < m_NumChromsCov; ChromIdx++,pChrom++)
+			{
+			if(!strnicmp(pszChrom,pChrom->szChrom,cMaxDatasetSpeciesChrom))
+				break;
+			}
 		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	pChrom->pCovCnts = (UINT32 *)mmap(NULL,ReallocTo, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(pChrom->pCovCnts == MAP_FAILED)
+	if(ChromIdx == m_NumChromsCov)	// if a new or first chrom
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"BuildReadCoverage: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)ReallocTo,strerror(errno));
+		if(m_NumChromsCov == cMaxChromCov)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"ResolveChromCov: Coverage on more than %d chromosomes is not supported",cMaxChromCov);
+			return(eBSFerrMaxChroms);
+			}
+		if((ChromLen = LocateHdrChromLen(pszChrom)) == 0)
+			ChromLen = cCovCntsDfltChromLen;
+		if(m_CovCntsArenas[ChromIdx].Init(0,((UINT64)ChromLen + cAllocCovCnts + 2) * sizeof(UINT32)) != eBSFSuccess)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"ResolveChromCov: Unable to reserve %lld bytes for chromosome coverage",((INT64)ChromLen + cAllocCovCnts + 2) * (INT64)sizeof(UINT32));
+			return(eBSFerrMem);
+			}
+		strncpy(pChrom->szChrom,pszChrom,cMaxDatasetSpeciesChrom);
+		pChrom->szChrom[cMaxDatasetSpeciesChrom-1] = 0;
+		pChrom->StartOfs = StartOfs;
+		pChrom->EndOfs = EndOfs;
 		pChrom->pCovCnts = NULL;
-		Reset();
-		return(eBSFerrMem);
+		pChrom->AllocCovCnts = 0;
+		m_NumChromsCov += 1;
 		}
-#endif
-	pChrom->AllocCovCnts = AllocCovCnts;
-	memset(pChrom->pCovCnts,0,ReallocTo);
-	m_NumChromsCov += 1;
+	m_LastChromIdx = ChromIdx;
 	}
 
-// check if chrom coverage cnts needs to be extended
-if(EndOfs >= pChrom->AllocCovCnts)
+// check if chrom coverage cnts needs to be extended, allowing for the delta immediately following EndOfs
+if((EndOfs + 1) >= pChrom->AllocCovCnts)
 	{
-	AllocCovCnts = EndOfs + cAllocCovCnts;
-	ReallocTo = AllocCovCnts * sizeof(UINT32);
-#ifdef _WIN32
-	pCovCnts = (UINT32 *) realloc(pChrom->pCovCnts,ReallocTo);
-#else
-	pCovCnts = (UINT32 *)mremap(pChrom->pCovCnts,pChrom->AllocCovCnts * sizeof(UINT32),ReallocTo,MREMAP_MAYMOVE);
-	if(pCovCnts == MAP_FAILED)
-		pCovCnts = NULL;
-#endif
-	if(pCovCnts == NULL)
+	ReqSize = ((size_t)EndOfs + cAllocCovCnts) * sizeof(UINT32);
+	if(ReqSize > m_CovCntsArenas[ChromIdx].Reserved() && DrainAppliedBatches() < eBSFSuccess)	// arena will be relocated
+		return(m_ThreadsRslt);
+	if((pCovCnts = (UINT32 *)m_CovCntsArenas[ChromIdx].Grow(ReqSize)) == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"BuildReadCoverage: Memory re-allocation to %d bytes - %s",ReallocTo,strerror(errno));
-		Reset();
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ResolveChromCov: Memory allocation of %lld bytes failed",(INT64)ReqSize);
 		return(eBSFerrMem);
 		}
 	pChrom->pCovCnts = pCovCnts;
-	memset(&pChrom->pCovCnts[pChrom->AllocCovCnts],0,(AllocCovCnts - pChrom->AllocCovCnts) * sizeof(UINT32));
-	pChrom->AllocCovCnts = AllocCovCnts;
+	pChrom->AllocCovCnts = (int)min((size_t)INT_MAX,m_CovCntsArenas[ChromIdx].Committed() / sizeof(UINT32));
 	}
 
 if(EndOfs > pChrom->EndOfs)
 	pChrom->EndOfs = EndOfs;
 if(StartOfs < pChrom->StartOfs)
 	pChrom->StartOfs = StartOfs;
+*pStartOfs = StartOfs;
+*pEndOfs = EndOfs;
+return(ChromIdx);
+}
 
-pCovCnts = &pChrom->pCovCnts[StartOfs];
-while(StartOfs++ <= EndOfs)
+// BuildReadCoverage
+// Coverage is accumulated as deltas, the count at StartOfs is incremented and the count immediately following EndOfs is decremented
+// so accumulation cost is independent of the element length. FinaliseChromCov() subsequently converts the deltas into coverage counts
+int
+CLocateROI::BuildReadCoverage(char *pszChrom,		// coverage is onto this chrom
+			  int StartOfs,				// coverage start at this offset 
+			  int EndOfs,				// and ends at this offset inclusive
+			  int Cnt)					// increment coverage by this
+{
+int ChromIdx;
+INT32 *pCovCnts;
+
+// arbitary count clamping to be in range 1..10000 inclusive
+if(Cnt < 1)
+	Cnt = 1;
+else
+	if(Cnt > 10000)
+		Cnt = 10000;
+
+if((ChromIdx = ResolveChromCov(pszChrom,&StartOfs,&EndOfs)) < 0)
+	return(ChromIdx);
+
+pCovCnts = (INT32 *)m_ChromCnts[ChromIdx].pCovCnts;
+pCovCnts[StartOfs] += Cnt;
+pCovCnts[EndOfs+1] -= Cnt;
+return(eBSFSuccess);
+}
+
+// FinaliseChromCov
+// Converts the coverage deltas accumulated by BuildReadCoverage() or ApplyBatchCov() into coverage counts
+// Accumulated counts are clamped to be no greater than cMaxAccumCnt
+int
+CLocateROI::FinaliseChromCov(tsChromCnts *pChrom)
+{
+INT32 *pDelta;
+INT64 CurCnt;
+int SeqIdx;
+
+if(pChrom->pCovCnts == NULL)
+	return(eBSFSuccess);
+CurCnt = 0;
+pDelta = &((INT32 *)pChrom->pCovCnts)[pChrom->StartOfs];
+for(SeqIdx = pChrom->StartOfs; SeqIdx <= pChrom->EndOfs+1; SeqIdx++,pDelta++)
 	{
-	// clamp accumulated cnts to be no greater than cMaxAccumCnt
-	if((cMaxAccumCnt - *pCovCnts) > (UINT32)Cnt)
-		*pCovCnts += (UINT32)Cnt;
-	else
-		*pCovCnts = cMaxAccumCnt;
-	pCovCnts += 1;
+	CurCnt += *pDelta;
+	*(UINT32 *)pDelta = CurCnt > cMaxAccumCnt ? cMaxAccumCnt : (UINT32)CurCnt;
 	}
-
 return(eBSFSuccess);
 }
 
@@ -749,6 +854,9 @@ return(eBSFSuccess);
 
 
 
+// IdentROI
+// Identifies ROIs on all chromosomes in parallel, each chromosome is processed by IdentChromROI(), and then
+// concatenates the per chromosome ROIs in chromosome order so region identifiers are independent of the number of threads
 int
 CLocateROI::IdentROI(etFROIMode FMode,					// output in this format to m_hRsltsFile
 		  int MinMedianCov,				// minimum median coverage required in reported regions
@@ -756,29 +864,40 @@ CLocateROI::IdentROI(etFROIMode FMode,					// output in this format to m_hRsltsF
 			int MaxGapLen,				// report regions containing no read gaps of <= this length 
 			bool bNoFilter)				// true if all counts to be processed
 {
+int Rslt;
 tsROI *pROI;
+tsROI *pChromROI;
 tsChromCnts *pChrom;
-UINT32 *pCnts;
-int Cnts;
-UINT32 SumCnts;
 int ChromIdx;
-int SeqIdx;
-int StartOfRegion;
-int EndOfRegion;
-int CurGapLen;
-int NumMedCnts;	
-int SubRegionLen;
-int TotRegionLen;
+int ROIIdx;
 int NumRegions;
 UINT64 TotGenomeCnts;
 double GenomeCntsPerM;
 size_t memreq;
 
-if(m_pROIs == NULL)		// should be the case but who knows :-)
+m_MinMedianCov = MinMedianCov;
+m_MinRegionLen = MinRegionLen;
+m_MaxGapLen = MaxGapLen;
+m_bNoFilter = bNoFilter;
+if((Rslt = RunChromThreads(eRCPIdentROI)) < eBSFSuccess)
+	{
+	Reset();
+	return(Rslt);
+	}
+
+TotGenomeCnts = 0;
+NumRegions = 0;
+pChrom = &m_ChromCnts[0];
+for(ChromIdx = 0 ; ChromIdx < m_NumChromsCov; ChromIdx++,pChrom++)
 	{
-		// initial allocation of memory to hold regions of interest
-	memreq = cROIAlloc * 2 * sizeof(tsROI);
+	TotGenomeCnts += pChrom->TotCnts;
+	NumRegions += pChrom->NumROIs;
+	}
+GenomeCntsPerM = 1000000.0 / TotGenomeCnts;
 
+memreq = (m_NumOfROIs + NumRegions + cROIAlloc) * sizeof(tsROI);
+if(m_pROIs == NULL)		// should be the case but who knows :-)
+	{
 #ifdef _WIN32
 	m_pROIs = (tsROI *) malloc(memreq);	// initial allocation
 	if(m_pROIs == NULL)
@@ -800,127 +919,240 @@ if(m_pROIs == NULL)		// should be the case but who knows :-)
 #endif
 	m_AllocNumROIsMem = memreq;
 	m_NumOfROIs = 0;
-	m_AllocNumROIs = cROIAlloc * 2;
+	m_AllocNumROIs = NumRegions + cROIAlloc;
 	}
+else
+	if((m_NumOfROIs + NumRegions) >= m_AllocNumROIs)
+		{
+		tsROI *pTmpAlloc;
+#ifdef _WIN32
+		pTmpAlloc = (tsROI *) realloc(m_pROIs,memreq);
+#else
+		pTmpAlloc = (tsROI *)mremap(m_pROIs,m_AllocNumROIsMem,memreq,MREMAP_MAYMOVE);
+		if(pTmpAlloc == MAP_FAILED)
+			pTmpAlloc = NULL;
+#endif
+		if(pTmpAlloc == NULL)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentROI: Memory re-allocation to %lld bytes - %s",(INT64)memreq,strerror(errno));
+			Reset();	
+			return(eBSFerrMem);
+			}
+		m_pROIs = pTmpAlloc;
+		m_AllocNumROIsMem = memreq;
+		m_AllocNumROIs = m_NumOfROIs + NumRegions + cROIAlloc;
+		}
 
-TotGenomeCnts = 0;
+// concatenate per chromosome ROIs, assigning region identifiers and completing BPKMs now that total genome counts are known
+NumRegions = 0;
+pROI = &m_pROIs[m_NumOfROIs];
 pChrom = &m_ChromCnts[0];
 for(ChromIdx = 0 ; ChromIdx < m_NumChromsCov; ChromIdx++,pChrom++)
 	{
-	pCnts = &pChrom->pCovCnts[pChrom->StartOfs];
-	for(SeqIdx = pChrom->StartOfs; SeqIdx <= pChrom->EndOfs+1; SeqIdx++,pCnts++)
-		TotGenomeCnts += *pCnts & cMaxAccumCnt;
+	pChromROI = pChrom->pROIs;
+	for(ROIIdx = 0; ROIIdx < pChrom->NumROIs; ROIIdx++,pChromROI++,pROI++)
+		{
+		*pROI = *pChromROI;
+		NumRegions += 1;
+		pROI->RegionID = NumRegions;
+		pROI->BPKM *= GenomeCntsPerM;
+		m_NumOfROIs += 1;
+		}
+	if(pChrom->pROIs != NULL)
+		{
+		free(pChrom->pROIs);
+		pChrom->pROIs = NULL;
+		}
+	pChrom->NumROIs = 0;
+	pChrom->AllocROIs = 0;
 	}
-GenomeCntsPerM = 1000000.0 / TotGenomeCnts;
+return(NumRegions);
+}
 
-pChrom = &m_ChromCnts[0];
-NumRegions = 0;
-pROI = &m_pROIs[m_NumOfROIs];
-for(ChromIdx = 0 ; ChromIdx < m_NumChromsCov; ChromIdx++,pChrom++)
+// IdentChromROI
+// Run length encodes the chromosome coverage, releasing the per base coverage counts, then identifies ROIs by iterating over the runs
+// Run length encoded coverage is processed exactly as if processing the per base coverage counts
+// ROI BPKMs are returned without normalisation by total genome counts, IdentROI() completes the normalisation
+int
+CLocateROI::IdentChromROI(int ChromIdx)	// identify ROIs on this chromosome
+{
+tsChromCnts *pChrom;
+tsROI *pROI;
+tsCovRun *pRun;
+UINT32 *pCnts;
+UINT32 Cnts;
+UINT32 PrevCnts;
+UINT64 TotCnts;
+int NumRuns;
+int RunIdx;
+int RunLen;
+bool bEnd;
+UINT32 SumCnts;
+int SeqIdx;
+int StartOfRegion;
+int EndOfRegion;
+int CurGapLen;
+int NumMedCnts;	
+int SubRegionLen;
+int TotRegionLen;
+size_t memreq;
+
+pChrom = &m_ChromCnts[ChromIdx];
+if(pChrom->pCovCnts == NULL)
+	return(eBSFSuccess);
+
+// first pass determines the number of runs required
+TotCnts = 0;
+NumRuns = 0;
+PrevCnts = 0;
+pCnts = &pChrom->pCovCnts[pChrom->StartOfs];
+for(SeqIdx = pChrom->StartOfs; SeqIdx <= pChrom->EndOfs; SeqIdx++,pCnts++)
 	{
-	CurGapLen = 0;				
-	NumMedCnts = 0;
-	SumCnts = 0;
-	SubRegionLen = -1;
-	StartOfRegion = -1;
-	EndOfRegion = -1;
-	
-	pCnts = &pChrom->pCovCnts[pChrom->StartOfs];
-	for(SeqIdx = pChrom->StartOfs; SeqIdx <= pChrom->EndOfs+1; SeqIdx++,pCnts++)
+	TotCnts += *pCnts & cMaxAccumCnt;
+	if(m_bNoFilter || *pCnts >= cRetainCnt)
+		Cnts = *pCnts & cMaxAccumCnt;
+	else
+		Cnts = 0;
+	if(NumRuns == 0 || Cnts != PrevCnts)
+		NumRuns += 1;
+	PrevCnts = Cnts;
+	}
+NumRuns += 1;					// terminating run immediately following EndOfs
+
+memreq = NumRuns * sizeof(tsCovRun);
+#ifdef _WIN32
+pChrom->pRuns = (tsCovRun *) malloc(memreq);
+if(pChrom->pRuns == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentChromROI: Memory allocation of %lld bytes - %s",(INT64)memreq,strerror(errno));
+	return(eBSFerrMem);
+	}
+#else
+pChrom->pRuns = (tsCovRun *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
+if(pChrom->pRuns == MAP_FAILED)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentChromROI: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)memreq,strerror(errno));
+	pChrom->pRuns = NULL;
+	return(eBSFerrMem);
+	}
+#endif
+pChrom->NumRuns = NumRuns;
+pChrom->TotCnts = TotCnts;
+
+// second pass fills the runs
+pRun = pChrom->pRuns;
+RunIdx = 0;
+pCnts = &pChrom->pCovCnts[pChrom->StartOfs];
+for(SeqIdx = pChrom->StartOfs; SeqIdx <= pChrom->EndOfs; SeqIdx++,pCnts++)
+	{
+	if(m_bNoFilter || *pCnts >= cRetainCnt)
+		Cnts = *pCnts & cMaxAccumCnt;
+	else
+		Cnts = 0;
+	if(RunIdx == 0 || Cnts != pRun->Cnt)
 		{
-		if(bNoFilter || *pCnts >= cRetainCnt)
-			Cnts = *pCnts & cMaxAccumCnt;
-		else
-			Cnts = 0;
-		if(Cnts == 0 ||				// if in gap with no reads
-			SeqIdx > pChrom->EndOfs)    // or past the last read
+		if(RunIdx++ > 0)
+			pRun += 1;
+		pRun->StartOfs = SeqIdx;
+		pRun->Cnt = Cnts;
+		}
+	}
+if(RunIdx > 0)
+	pRun += 1;
+pRun->StartOfs = pChrom->EndOfs + 1;
+pRun->Cnt = 0;
+
+// per base coverage no longer required
+m_CovCntsArenas[ChromIdx].Release();
+pChrom->pCovCnts = NULL;
+pChrom->AllocCovCnts = 0;
+
+CurGapLen = 0;				
+NumMedCnts = 0;
+SumCnts = 0;
+SubRegionLen = -1;
+StartOfRegion = -1;
+EndOfRegion = -1;
+pRun = pChrom->pRuns;
+for(RunIdx = 0; RunIdx < NumRuns; RunIdx++,pRun++)
+	{
+	SeqIdx = pRun->StartOfs;
+	bEnd = (RunIdx + 1) == NumRuns ? true : false;	// terminating run is past the last read
+	RunLen = bEnd ? 1 : pRun[1].StartOfs - SeqIdx;
+	if(bEnd || pRun->Cnt == 0)	// if in gap with no reads or past the last read
+		{
+		if(StartOfRegion < 0)		// if not actually started a region then continue until region or new chrom
+			continue;
+		if(CurGapLen == 0 || bEnd)	// if gap just started then check if subregion can be accepted
+			{			
+			if(NumMedCnts >= (SubRegionLen+1)/2)	// more than 50% of bases in subregion had at least the minimum coverage?
+				EndOfRegion = SeqIdx - 1;
+			}
+		if(bEnd || (CurGapLen + RunLen) > m_MaxGapLen)	// if gap is too large, or at end of chrom, then terminate region
 			{
-			if(StartOfRegion < 0)		// if not actually started a region then continue until region or new chrom
-				continue;
-			if(CurGapLen == 0 || SeqIdx > pChrom->EndOfs)	// if gap just started then check if subregion can be accepted
-				{			
-				if(NumMedCnts >= (SubRegionLen+1)/2)	// more than 50% of bases in subregion had at least the minimum coverage?
-					EndOfRegion = SeqIdx - 1;
-				}
-			if(CurGapLen++ == MaxGapLen ||	// if gap is too large then terminate region 
-				SeqIdx > pChrom->EndOfs)	// or at end of chrom also terminates region
+			if(EndOfRegion != -1)
 				{
-				if(EndOfRegion != -1)
+				TotRegionLen = 1 + EndOfRegion - StartOfRegion; // region meets minimum length requirements?
+				if(TotRegionLen >= m_MinRegionLen)
 					{
-					TotRegionLen = 1 + EndOfRegion - StartOfRegion; // region meets minimum length requirements?
-					if(TotRegionLen >= MinRegionLen)
+					if(pChrom->pROIs == NULL || pChrom->NumROIs == pChrom->AllocROIs)
 						{
-						// output region here!!
-						// check though that m_pROIs can hold this ROI
-						if((m_NumOfROIs + 10) >= m_AllocNumROIs)
+						tsROI *pTmpAlloc;
+						memreq = (pChrom->AllocROIs + cROIAlloc) * sizeof(tsROI);
+						if((pTmpAlloc = (tsROI *)realloc(pChrom->pROIs,memreq))==NULL)
 							{
-							tsROI *pTmpAlloc;
-							memreq = m_AllocNumROIsMem + (cROIAlloc * sizeof(tsROI));
-#ifdef _WIN32
-							pTmpAlloc = (tsROI *) realloc(m_pROIs,memreq);
-#else
-							pTmpAlloc = (tsROI *)mremap(m_pROIs,m_AllocNumROIsMem,memreq,MREMAP_MAYMOVE);
-							if(pTmpAlloc == MAP_FAILED)
-								pTmpAlloc = NULL;
-#endif
-							if(pTmpAlloc == NULL)
-								{
-								gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentROI: Memory re-allocation to %d bytes - %s",memreq,strerror(errno));
-								Reset();	
-								return(eBSFerrMem);
-								}
-							m_pROIs = pTmpAlloc;
-							m_AllocNumROIsMem = memreq;
-							m_AllocNumROIs += cROIAlloc;
-							pROI = &m_pROIs[m_NumOfROIs];
+							gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentChromROI: Memory re-allocation to %lld bytes - %s",(INT64)memreq,strerror(errno));
+							return(eBSFerrMem);
 							}
-						NumRegions += 1;
-						pROI->RegionID = NumRegions;
-						pROI->ChromIdx = ChromIdx+1;
-						pROI->StartOfRegion = StartOfRegion;
-						pROI->EndOfRegion = EndOfRegion;
-						pROI->Strand = m_ReadStrand == '*' ? '+' : m_ReadStrand;
-						pROI->BPKM = (SumCnts * 1000.0 / TotRegionLen) * GenomeCntsPerM;
-						pROI->szDSFeatID[0] = '\0';
-						pROI->DSFeatDist = -1;
-						pROI->DSFeatStrand = '*';
-						pROI->szUSFeatID[0] = '\0';
-						pROI->USFeatDist = -1;
-						pROI->USFeatStrand = '*';
-						m_NumOfROIs += 1;
-						pROI += 1;
+						pChrom->pROIs = pTmpAlloc;
+						pChrom->AllocROIs += cROIAlloc;
 						}
+					pROI = &pChrom->pROIs[pChrom->NumROIs++];
+					memset(pROI,0,sizeof(tsROI));
+					pROI->ChromIdx = ChromIdx+1;
+					pROI->StartOfRegion = StartOfRegion;
+					pROI->EndOfRegion = EndOfRegion;
+					pROI->Strand = m_ReadStrand == '*' ? '+' : m_ReadStrand;
+					pROI->BPKM = SumCnts * 1000.0 / TotRegionLen;
+					pROI->szDSFeatID[0] = '\0';
+					pROI->DSFeatDist = -1;
+					pROI->DSFeatStrand = '*';
+					pROI->szUSFeatID[0] = '\0';
+					pROI->USFeatDist = -1;
+					pROI->USFeatStrand = '*';
 					}
-				StartOfRegion = -1;
-				EndOfRegion = -1;
-				SumCnts = 0;
 				}
-			SubRegionLen = -1;
-			continue;
-			}
-
-		CurGapLen = 0;
-		if(StartOfRegion < 0)	// starting a putative region?
-			{
-			StartOfRegion = SeqIdx;
-			SubRegionLen = -1;
+			StartOfRegion = -1;
+			EndOfRegion = -1;
 			SumCnts = 0;
 			}
-
-		if(SubRegionLen < 0)	// starting a subregion?
-			{
-			NumMedCnts = 0;
-			SubRegionLen = 1;
-			}
 		else
-			SubRegionLen += 1;
+			CurGapLen += RunLen;
+		SubRegionLen = -1;
+		continue;
+		}
 
-		if(Cnts >= MinMedianCov)
-			NumMedCnts += 1;
-		SumCnts += Cnts;
+	CurGapLen = 0;
+	if(StartOfRegion < 0)	// starting a putative region?
+		{
+		StartOfRegion = SeqIdx;
+		SubRegionLen = -1;
+		SumCnts = 0;
+		}
+
+	if(SubRegionLen < 0)	// starting a subregion?
+		{
+		NumMedCnts = 0;
+		SubRegionLen = RunLen;
 		}
+	else
+		SubRegionLen += RunLen;
+
+	if((int)pRun->Cnt >= m_MinMedianCov)
+		NumMedCnts += RunLen;
+	SumCnts += pRun->Cnt * (UINT32)RunLen;
 	}
-return(NumRegions);
+return(pChrom->NumROIs);
 }
 
 int
@@ -993,9 +1225,9 @@ for(ROIidx = 0; ROIidx < m_NumOfROIs; ROIidx++,pROI++)
 				BuffIdx+=sprintf(&szLineBuff[BuffIdx],"%d,\"ROI\",\"%s\",\"%s\",%d,%d,%d,\"%c\",\"%s\",\"%c\",%d,\"%s\",\"%s\",\"%c\",%d,\"%s\",%1.3f\n",
 								pROI->RegionID,pszTitle,pChrom->szChrom,pROI->StartOfRegion,pROI->EndOfRegion,1 + pROI->EndOfRegion - pROI->StartOfRegion,
 											pROI->Strand,
-								m_pszFeatFiles[AnnoFileID-1],
+								AnnoFileID <= m_NumFeatFiles ? m_pszFeatFiles[AnnoFileID-1] : "",
 							    pROI->USFeatStrand,pROI->USFeatDist,pROI->szUSFeatID,
-								m_pszFeatFiles[AnnoFileID-1],
+								AnnoFileID <= m_NumFeatFiles ? m_pszFeatFiles[AnnoFileID-1] : "",
 								pROI->DSFeatStrand,pROI->DSFeatDist,pROI->szDSFeatID,
 								pROI->BPKM);
 				}
@@ -1026,9 +1258,9 @@ if(FMode == eFROIsumCSV && bFinal)
 		BuffIdx+=sprintf(&szLineBuff[BuffIdx],"%d,\"ROI\",\"%s\",\"%s\",%d,%d,%d,\"%c\",\"%s\",\"%c\",%d,\"%s\",\"%s\",\"%c\",%d,\"%s\",%1.3f\n",
 								pROI->RegionID,pszTitle,pChrom->szChrom,pROI->StartOfRegion,pROI->EndOfRegion,1 + pROI->EndOfRegion - pROI->StartOfRegion,
 								pROI->Strand,
-								m_pszFeatFiles[pROI->USFeatFileID-1],
+								(pROI->USFeatFileID > 0 && pROI->USFeatFileID <= m_NumFeatFiles) ? m_pszFeatFiles[pROI->USFeatFileID-1] : "",
 								pROI->USFeatStrand,pROI->USFeatDist,pROI->szUSFeatID,
-								m_pszFeatFiles[pROI->DSFeatFileID-1],
+								(pROI->DSFeatFileID > 0 && pROI->DSFeatFileID <= m_NumFeatFiles) ? m_pszFeatFiles[pROI->DSFeatFileID-1] : "",
 								pROI->DSFeatStrand,pROI->DSFeatDist,pROI->szDSFeatID,pROI->BPKM);
 								
 		if((BuffIdx + 200) > sizeof(szLineBuff))
@@ -1145,18 +1377,11 @@ CLocateROI::GenBEDWiggle(int Limit,						// limit (0 if no limit) processing to
 				 char *pszInFile)				// UCSC BED input file
 {
 int Rslt;
-int CurFeatureID;
-int StartLoci;
-int EndLoci;
-int Score;
-char szChrom[128];
-char szPrevChrom[128];
-char szFeatName[128];
-char Strand;
-int RefID;
-int IntergenicStart;
 int NumEls;
-int NumFiltStrand;
+int NumFeatures;
+int CurFeatureID;
+tsROIBatch *pBatch;
+tsROIThreadPars *pThreads;
 
 if((m_pBEDFile = new CBEDfile)==NULL)
 	{
@@ -1176,53 +1401,56 @@ if((Rslt=m_pBEDFile->Open(pszInFile,eBTAnyBed)) !=eBSFSuccess)
 	}
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Load completed, iterating reads...");
 
-// now iterate over the reads 
-szPrevChrom[0] = '\0';
-CurFeatureID = 0;
-IntergenicStart = 0;
-RefID = 0;
-Rslt = eBSFSuccess;
-NumEls = 0;
-NumFiltStrand = 0;
-while(Rslt == eBSFSuccess && (CurFeatureID = m_pBEDFile->GetNextFeatureID(CurFeatureID)) > 0)
+NumFeatures = m_pBEDFile->GetNumFeatures();
+NumEls = NumFeatures;
+if(Limit && NumFeatures > Limit)
 	{
-	NumEls += 1;
-	if(Limit && NumEls > Limit)
-		{
-		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Reached limit of %d reads",NumEls);
-		break;
-		}
-
-	m_pBEDFile->GetFeature(CurFeatureID,	// feature instance identifier
-				szFeatName,				// where to return feature name
-				szChrom,				// where to return chromosome name
-				&StartLoci,				// where to return feature start on chromosome (0..n) 
-				&EndLoci,				// where to return feature end on chromosome
- 				&Score,					// where to return score
- 				&Strand);				// where to return strand
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Reached limit of %d reads",Limit+1);
+	NumFeatures = Limit;
+	NumEls = Limit + 1;
+	}
 
-	if(CurFeatureID == 1 || stricmp(szChrom,szPrevChrom))	// if new chromosome then reset IntergenicStart
-		{
-		strcpy(szPrevChrom,szChrom);
-		IntergenicStart = 0;
-		}
+// now iterate over the reads, worker threads parse batches of features which are resolved onto chromosomes by this thread and the coverage deltas then applied by the worker threads
+m_BatchSrc = eRBSBed;
+m_ROIStrand = ROIStrand;
+m_NumFiltStrand = 0;
+if((Rslt = AllocBatches(min((m_NumThreads * 2) + 2,cROIMaxBatches))) < eBSFSuccess)
+	return(Rslt);
+pThreads = new tsROIThreadPars [m_NumThreads];
+StartParseThreads(pThreads);
 
-	if(ROIStrand != '*')
+for(CurFeatureID = 1; Rslt >= eBSFSuccess && CurFeatureID <= NumFeatures; CurFeatureID += cROIBatchLines)
+	{
+	if((pBatch = ReqFreeBatch()) == NULL)
 		{
-		if(ROIStrand != Strand)
-			{
-			NumFiltStrand += 1;
-			continue;
-			}
+		Rslt = m_ThreadsRslt < eBSFSuccess ? m_ThreadsRslt : eBSFerrInternal;
+		break;
 		}
-	
-	Rslt=BuildReadCoverage(szChrom,StartLoci,EndLoci,1);
-	if(Rslt >= eBSFSuccess)
-		m_NumAcceptedReads += 1;
+	pBatch->FirstFeatID = CurFeatureID;
+	pBatch->NumLines = min(cROIBatchLines,1 + NumFeatures - CurFeatureID);
+	AcquireSerialise();
+	pBatch->BatchSeq = m_NxtFillSeq++;
+	pBatch->State = eRBfilled;
+	ReleaseSerialise();
 	}
-if(Rslt == eBSFSuccess)
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"From %d reads there were %d accepted and %d filtered out because of strand",NumEls,NumEls-NumFiltStrand,NumFiltStrand);
-return(Rslt == eBSFSuccess ? (NumEls-NumFiltStrand) : Rslt);
+
+AcquireSerialise();
+m_bFillCompleted = true;
+if(Rslt < eBSFSuccess && m_ThreadsRslt >= eBSFSuccess)
+	m_ThreadsRslt = Rslt;
+ReleaseSerialise();
+if(Rslt >= eBSFSuccess)
+	Rslt = ResolveParsedBatches(true);
+EndParseThreads(pThreads);
+delete []pThreads;
+FreeBatches();
+delete m_pBEDFile;
+m_pBEDFile = NULL;
+if(Rslt < eBSFSuccess)
+	return(Rslt);
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"From %d reads there were %d accepted and %d filtered out because of strand",NumEls,NumEls-m_NumFiltStrand,m_NumFiltStrand);
+return(NumEls-m_NumFiltStrand);
 }
 
 
@@ -1232,21 +1460,13 @@ CLocateROI::GenSAMWiggle(int Limit,						// limit (0 if no limit) processing to
 				 char *pszInFile)				// SAM input file
 {
 int Rslt;
-int StartLoci;
-char szDescriptor[128];			// parsed out descriptor
-int Flags;						// parsed out flags
-int MAPQ;
-int TLen;
-char szCigar[128];
-char szRNext[128];
-int PNext;
-char szChrom[128];
-char szLine[16000];				// buffer input lines
-char Strand;
+char *pszLine;					// buffer input lines
 int NumEls;
-int NumFiltStrand;
 char *pTxt;
 int LineLen;
+bool bHdrChromsSorted;
+tsROIBatch *pBatch;
+tsROIThreadPars *pThreads;
 
 CSAMfile BAMfile;
 
@@ -1259,18 +1479,54 @@ if((Rslt = BAMfile.Open(pszInFile)) != eBSFSuccess)
 	return((teBSFrsltCodes)Rslt);
 	}
 
+if((pszLine = new char [cMaxBAMLineLen]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"GenSAMWiggle: Unable to allocate memory for line buffer");
+	BAMfile.Close();
+	return(eBSFerrMem);
+	}
+
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Starting to load reads %s",pszInFile);
 
-NumEls = 0;
+// this thread reads the SAM lines into batches which are parsed by the worker threads, parsed batches are then resolved onto chromosomes by this thread in the order read
+// and the coverage deltas applied by the worker threads
+m_BatchSrc = eRBSSam;
+m_ROIStrand = ROIStrand;
+m_pSAMFile = &BAMfile;
+m_NumFiltStrand = 0;
+m_NumHdrChroms = 0;
+if((Rslt = AllocBatches(min((m_NumThreads * 2) + 2,cROIMaxBatches))) < eBSFSuccess)
+	{
+	delete []pszLine;
+	BAMfile.Close();
+	return(Rslt);
+	}
+pThreads = new tsROIThreadPars [m_NumThreads];
+StartParseThreads(pThreads);
+
+NumEls = 0;
 m_NumAcceptedReads = 0;
-NumFiltStrand = 0;
+pBatch = NULL;
+bHdrChromsSorted = false;
 Rslt = eBSFSuccess;
-while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
+while((LineLen = BAMfile.GetNxtSAMline(pszLine)) > 0)
 	{
-	szLine[sizeof(szLine)-1] = '\0';
-	pTxt = TrimWhitespace(szLine);
-	if(*pTxt=='\0' || *pTxt=='@')	// simply slough lines which were just whitespace or start with '@'
+	pszLine[cMaxBAMLineLen-1] = '\0';
+	pTxt = TrimWhitespace(pszLine);
+	if(*pTxt=='@')					// header chromosome lengths are retained so coverage address space can be sized to the chromosome
+		{
+		if(!strncmp(pTxt,"@SQ",3) && (Rslt = AddHdrChrom(pTxt)) < eBSFSuccess)
+			break;
+		continue;
+		}
+	if(*pTxt=='\0')					// simply slough lines which were just whitespace
 		continue;
+	if(!bHdrChromsSorted)
+		{
+		if(m_NumHdrChroms > 1)
+			qsort(m_pHdrChroms,m_NumHdrChroms,sizeof(tsROIHdrChrom),SortHdrChroms);
+		bHdrChromsSorted = true;
+		}
 
 	NumEls += 1;
 	if(Limit && NumEls > Limit)
@@ -1279,22 +1535,407 @@ while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
 		break;
 		}
 
-	// expecting to parse as "%s\t%d\t%s\t%d\t%d\t%s\t%s\t%d\t%d\t", szDescriptor, Flags, m_szSAMTargChromName, StartLoci+1,MAPQ,szCigar,pszRNext,PNext,TLen);
-	// interest is in the chromname, startloci, and length
-	if((Rslt = sscanf(szLine,"%s\t%d\t%s\t%d\t%d\t%s\t%s\t%d\t%d\t",szDescriptor, &Flags, szChrom, &StartLoci,&MAPQ,szCigar,szRNext,&PNext,&TLen)) != 9)
+	// only the leading fields are parsed so overlong lines can be truncated
+	LineLen = (int)strlen(pTxt);
+	if(LineLen >= cMaxROIBatchLineLen)
+		LineLen = cMaxROIBatchLineLen - 1;
+
+	if(pBatch != NULL && (pBatch->NumLines == cROIBatchLines || (pBatch->BuffLen + LineLen + 1) > cROIBatchBuffSize))
 		{
+		AcquireSerialise();
+		pBatch->BatchSeq = m_NxtFillSeq++;
+		pBatch->State = eRBfilled;
+		ReleaseSerialise();
+		pBatch = NULL;
+		}
+	if(pBatch == NULL && (pBatch = ReqFreeBatch()) == NULL)
+		{
+		Rslt = m_ThreadsRslt < eBSFSuccess ? m_ThreadsRslt : eBSFerrInternal;
+		break;
+		}
+	memcpy(&pBatch->pBuff[pBatch->BuffLen],pTxt,LineLen);
+	pBatch->BuffLen += LineLen;
+	pBatch->pBuff[pBatch->BuffLen++] = '\0';
+	pBatch->NumLines += 1;
+	}
+
+AcquireSerialise();
+if(pBatch != NULL && pBatch->NumLines > 0)
+	{
+	pBatch->BatchSeq = m_NxtFillSeq++;
+	pBatch->State = eRBfilled;
+	}
+m_bFillCompleted = true;
+if(Rslt < eBSFSuccess && m_ThreadsRslt >= eBSFSuccess)
+	m_ThreadsRslt = Rslt;
+ReleaseSerialise();
+if(Rslt >= eBSFSuccess)
+	Rslt = ResolveParsedBatches(true);
+EndParseThreads(pThreads);
+delete []pThreads;
+delete []pszLine;
+FreeBatches();
+m_pSAMFile = NULL;
+BAMfile.Close();
+if(Rslt < eBSFSuccess)
+	return(Rslt);
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"From %d reads there were %d accepted and %d filtered out because of strand",NumEls,NumEls-m_NumFiltStrand,m_NumFiltStrand);
+return(NumEls-m_NumFiltStrand);
+}
+
+int
+CLocateROI::AllocBatches(int NumBatches)	// allocate batches used when loading SAM or BED elements
+{
+int BatchIdx;
+tsROIBatch *pBatch;
+
+FreeBatches();
+if((m_pBatches = new tsROIBatch [NumBatches]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocBatches: Unable to allocate memory for batches");
+	return(eBSFerrMem);
+	}
+memset(m_pBatches,0,sizeof(tsROIBatch) * NumBatches);
+m_NumBatches = NumBatches;
+pBatch = m_pBatches;
+for(BatchIdx = 0; BatchIdx < NumBatches; BatchIdx++,pBatch++)
+	{
+	pBatch->State = eRBfree;
+	if((pBatch->pBuff = new char [cROIBatchBuffSize]) == NULL ||
+		(pBatch->pIntvls = new tsROIIntvl [cROIBatchLines]) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocBatches: Unable to allocate memory for batch buffers");
+		FreeBatches();
+		return(eBSFerrMem);
+		}
+	}
+m_NxtFillSeq = 1;
+m_NxtAccumSeq = 1;
+m_bFillCompleted = false;
+m_ThreadsRslt = eBSFSuccess;
+return(eBSFSuccess);
+}
+
+void
+CLocateROI::FreeBatches(void)
+{
+int BatchIdx;
+tsROIBatch *pBatch;
+
+if(m_pBatches != NULL)
+	{
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)
+		{
+		if(pBatch->pBuff != NULL)
+			delete []pBatch->pBuff;
+		if(pBatch->pIntvls != NULL)
+			delete []pBatch->pIntvls;
+		}
+	delete []m_pBatches;
+	m_pBatches = NULL;
+	}
+m_NumBatches = 0;
+}
+
+// DrainAppliedBatches
+// Waits until all resolved batches have had their coverage deltas applied by the worker threads, called by the resolving thread before
+// chromosome coverage counts are relocated. No further batches are resolved whilst waiting so once drained no deltas are being applied
+// Returns < 0 if worker threads errored
+int
+CLocateROI::DrainAppliedBatches(void)
+{
+int BatchIdx;
+int Rslt;
+tsROIBatch *pBatch;
+
+while(1)
+	{
+	AcquireSerialise();
+	if((Rslt = m_ThreadsRslt) < eBSFSuccess)
+		{
+		ReleaseSerialise();
+		return(Rslt);
+		}
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)
+		if(pBatch->State == eRBresolved || pBatch->State == eRBapplying)
+			break;
+	ReleaseSerialise();
+	if(BatchIdx == m_NumBatches)
+		return(eBSFSuccess);
+	CUtility::SleepMillisecs(1);
+	}
+}
+
+// AddHdrChrom
+// Adds the chromosome name and length from a SAM header '@SQ' line, lines without both a name and length are ignored
+int
+CLocateROI::AddHdrChrom(char *pszSQLine)		// SAM header '@SQ' line
+{
+int Len;
+char *pName;
+char *pLen;
+tsROIHdrChrom *pTmpHdrChroms;
+
+if((pName = strstr(pszSQLine,"SN:")) == NULL || (pLen = strstr(pszSQLine,"LN:")) == NULL)
+	return(eBSFSuccess);
+if(m_NumHdrChroms == m_AllocHdrChroms)
+	{
+	if((pTmpHdrChroms = (tsROIHdrChrom *)realloc(m_pHdrChroms,sizeof(tsROIHdrChrom) * (m_AllocHdrChroms + cAllocHdrChroms))) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddHdrChrom: Memory reallocation for SAM header chromosomes failed");
+		return(eBSFerrMem);
+		}
+	m_pHdrChroms = pTmpHdrChroms;
+	m_AllocHdrChroms += cAllocHdrChroms;
+	}
+pName += 3;
+for(Len = 0; Len < cMaxDatasetSpeciesChrom && pName[Len] != '\0' && !isspace(pName[Len]); Len++)
+	m_pHdrChroms[m_NumHdrChroms].szChrom[Len] = pName[Len];
+m_pHdrChroms[m_NumHdrChroms].szChrom[Len] = '\0';
+m_pHdrChroms[m_NumHdrChroms].ChromLen = atoi(pLen + 3);
+if(m_pHdrChroms[m_NumHdrChroms].ChromLen > 0)
+	m_NumHdrChroms += 1;
+return(eBSFSuccess);
+}
+
+// LocateHdrChromLen
+// Returns the SAM header length of chromosome, 0 if no SAM header length is known for the chromosome
+int
+CLocateROI::LocateHdrChromLen(char *pszChrom)	// chromosome name
+{
+int Lo;
+int Hi;
+int Mid;
+int Cmp;
+
+Lo = 0;
+Hi = m_NumHdrChroms - 1;
+while(Lo <= Hi)
+	{
+	Mid = (Lo + Hi) / 2;
+	if((Cmp = strnicmp(pszChrom,m_pHdrChroms[Mid].szChrom,cMaxDatasetSpeciesChrom)) == 0)
+		return(m_pHdrChroms[Mid].ChromLen);
+	if(Cmp < 0)
+		Hi = Mid - 1;
+	else
+		Lo = Mid + 1;
+	}
+return(0);
+}
+
+// SortHdrChroms
+// Sort SAM header chromosomes ascending by name, case insensitive as chromosome names are matched case insensitively
+int
+CLocateROI::SortHdrChroms(const void *arg1, const void *arg2)
+{
+tsROIHdrChrom *pEl1 = (tsROIHdrChrom *)arg1;
+tsROIHdrChrom *pEl2 = (tsROIHdrChrom *)arg2;
+return(strnicmp(pEl1->szChrom,pEl2->szChrom,cMaxDatasetSpeciesChrom));
+}
+
+// ReqFreeBatch
+// Returns a free batch ready for filling, whilst waiting for a batch to become free then any parsed batches are resolved onto chromosomes
+// Returns NULL if errors
+tsROIBatch *
+CLocateROI::ReqFreeBatch(void)
+{
+int BatchIdx;
+tsROIBatch *pBatch;
+
+while(1)
+	{
+	AcquireSerialise();
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)
+		if(pBatch->State == eRBfree)
+			break;
+	ReleaseSerialise();
+	if(BatchIdx < m_NumBatches)
+		{
+		pBatch->NumLines = 0;
+		pBatch->FirstFeatID = 0;
+		pBatch->BuffLen = 0;
+		pBatch->NumIntvls = 0;
+		pBatch->NumFiltStrand = 0;
+		pBatch->NumPEReverse = 0;
+		return(pBatch);
+		}
+	if(ResolveParsedBatches(false) < eBSFSuccess)
+		return(NULL);
+	}
+}
+
+// ResolveParsedBatches
+// Resolves the intervals of parsed batches onto chromosomes, extending chromosome coverage as required, in the order in which batches were filled
+// so chromosomes are registered in the same order as if the elements were serially processed. Resolved batches then have their coverage deltas
+// applied by the worker threads
+// If bWait then returns only after all filled batches have been resolved, otherwise returns after resolving those parsed batches which are available
+// Only the filling thread resolves so ResolveChromCov() is never concurrently called
+int
+CLocateROI::ResolveParsedBatches(bool bWait)
+{
+int Rslt;
+int BatchIdx;
+int IntvlIdx;
+bool bPending;
+tsROIBatch *pBatch;
+tsROIIntvl *pIntvl;
+
+while(1)
+	{
+	AcquireSerialise();
+	if(m_ThreadsRslt < eBSFSuccess)
+		{
+		Rslt = m_ThreadsRslt;
+		ReleaseSerialise();
+		return(Rslt);
+		}
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)
+		if(pBatch->State == eRBparsed && pBatch->BatchSeq == m_NxtAccumSeq)
+			break;
+	bPending = m_NxtAccumSeq < m_NxtFillSeq ? true : false;
+	ReleaseSerialise();
+
+	if(BatchIdx == m_NumBatches)		// next batch in sequence yet to be parsed?
+		{
+		if(!bWait || !bPending)
+			return(eBSFSuccess);
+		CUtility::SleepMillisecs(1);
 		continue;
 		}
 
+	pIntvl = pBatch->pIntvls;
+	for(IntvlIdx = 0; IntvlIdx < pBatch->NumIntvls; IntvlIdx++,pIntvl++)
+		{
+		if((Rslt = pIntvl->ChromIdx = ResolveChromCov(&pBatch->pBuff[pIntvl->ChromOfs],&pIntvl->StartOfs,&pIntvl->EndOfs)) < eBSFSuccess)
+			{
+			AcquireSerialise();
+			m_ThreadsRslt = Rslt;
+			ReleaseSerialise();
+			return(Rslt);
+			}
+		}
+	m_NumAcceptedReads += pBatch->NumIntvls + pBatch->NumPEReverse;
+	m_NumFiltStrand += pBatch->NumFiltStrand;
+
+	AcquireSerialise();
+	pBatch->State = eRBresolved;
+	m_NxtAccumSeq += 1;
+	ReleaseSerialise();
+	}
+}
+
+// ApplyBatchCov
+// Applies the coverage deltas of batch intervals which have been resolved onto chromosomes, deltas are applied with atomic adds as
+// other worker threads may be concurrently applying deltas onto the same chromosome
+void
+CLocateROI::ApplyBatchCov(tsROIBatch *pBatch)
+{
+int IntvlIdx;
+INT32 *pCovCnts;
+tsROIIntvl *pIntvl;
+
+pIntvl = pBatch->pIntvls;
+for(IntvlIdx = 0; IntvlIdx < pBatch->NumIntvls; IntvlIdx++,pIntvl++)
+	{
+	pCovCnts = (INT32 *)m_ChromCnts[pIntvl->ChromIdx].pCovCnts;
+#ifdef _WIN32
+	InterlockedExchangeAdd((volatile LONG *)&pCovCnts[pIntvl->StartOfs],1);
+	InterlockedExchangeAdd((volatile LONG *)&pCovCnts[pIntvl->EndOfs+1],-1);
+#else
+	__sync_fetch_and_add(&pCovCnts[pIntvl->StartOfs],1);
+	__sync_fetch_and_sub(&pCovCnts[pIntvl->EndOfs+1],1);
+#endif
+	}
+}
+
+// ParseBatch
+// Parses SAM lines or BED features in batch into coverage intervals
+// Chromosome names are written into the batch buffer, SAM names overwrite the line from which the name was parsed
+int
+CLocateROI::ParseBatch(tsROIBatch *pBatch)
+{
+int Idx;
+int StartLoci;
+int EndLoci;
+int Flags;						// parsed out flags
+int MAPQ;
+int TLen;
+int PNext;
+char Strand;
+int Score;
+char *pLine;
+char *pNxtLine;
+int PrevChromOfs;
+tsROIIntvl *pIntvl;
+char szDescriptor[cMaxROIBatchLineLen];			// parsed out descriptor
+char szCigar[cMaxROIBatchLineLen];
+char szRNext[cMaxROIBatchLineLen];
+char szChrom[cMaxROIBatchLineLen];
+
+pBatch->NumIntvls = 0;
+pBatch->NumFiltStrand = 0;
+pBatch->NumPEReverse = 0;
+pIntvl = pBatch->pIntvls;
+PrevChromOfs = -1;
+
+if(m_BatchSrc == eRBSBed)
+	{
+	pBatch->BuffLen = 0;
+	for(Idx = 0; Idx < pBatch->NumLines; Idx++)
+		{
+		m_pBEDFile->GetFeature(pBatch->FirstFeatID + Idx,	// feature instance identifier
+					NULL,					// where to return feature name
+					szChrom,				// where to return chromosome name
+					&StartLoci,				// where to return feature start on chromosome (0..n) 
+					&EndLoci,				// where to return feature end on chromosome
+ 					&Score,					// where to return score
+ 					&Strand);				// where to return strand
+
+		if(m_ROIStrand != '*' && m_ROIStrand != Strand)
+			{
+			pBatch->NumFiltStrand += 1;
+			continue;
+			}
+		if(PrevChromOfs == -1 || strcmp(szChrom,&pBatch->pBuff[PrevChromOfs]))
+			{
+			PrevChromOfs = (int)pBatch->BuffLen;
+			strcpy(&pBatch->pBuff[PrevChromOfs],szChrom);
+			pBatch->BuffLen += strlen(szChrom) + 1;
+			}
+		pIntvl->ChromOfs = PrevChromOfs;
+		pIntvl->StartOfs = StartLoci;
+		pIntvl->EndOfs = EndLoci;
+		pIntvl += 1;
+		pBatch->NumIntvls += 1;
+		}
+	return(pBatch->NumIntvls);
+	}
+
+pNxtLine = pBatch->pBuff;
+for(Idx = 0; Idx < pBatch->NumLines; Idx++)
+	{
+	pLine = pNxtLine;
+	pNxtLine += strlen(pLine) + 1;
+
+	// expecting to parse as "%s\t%d\t%s\t%d\t%d\t%s\t%s\t%d\t%d\t", szDescriptor, Flags, m_szSAMTargChromName, StartLoci+1,MAPQ,szCigar,pszRNext,PNext,TLen);
+	// interest is in the chromname, startloci, and length
+	if(sscanf(pLine,"%s\t%d\t%s\t%d\t%d\t%s\t%s\t%d\t%d\t",szDescriptor, &Flags, szChrom, &StartLoci,&MAPQ,szCigar,szRNext,&PNext,&TLen) != 9)
+		continue;
+
 	if(Flags & 0x04 || szCigar[0] == '*')	// unmapped?
 		continue;
 
 	Strand = Flags & 0x010 ? '-' : '+';
-	if(ROIStrand != '*')
+	if(m_ROIStrand != '*')
 		{
-		if(ROIStrand != Strand)
+		if(m_ROIStrand != Strand)
 			{
-			NumFiltStrand += 1;
+			pBatch->NumFiltStrand += 1;
 			continue;
 			}
 		}
@@ -1309,26 +1950,297 @@ while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
 	
 	if(szRNext[0] == '*')		// SE alignment
 		{
-		TLen = BAMfile.CigarAlignLen(szCigar);
+		TLen = m_pSAMFile->CigarAlignLen(szCigar);
 		}
 	else                        // else was a PE alignment with both ends on the same chrom or contig   
 		{
 		// treating the TLen as the length but only wanting to count it once, not twice for each end...
 		if(PNext < StartLoci)   // counting the forward TLen only for coverage
 			{
-			m_NumAcceptedReads += 1;
+			pBatch->NumPEReverse += 1;
 			continue;
 			}
 		}
 
-	Rslt=BuildReadCoverage(szChrom,StartLoci-1,StartLoci + TLen - 2,1);
-	if(Rslt >= eBSFSuccess)
-		m_NumAcceptedReads += 1;
+	// line has been parsed so chromosome name can overwrite the line
+	if(PrevChromOfs == -1 || strcmp(szChrom,&pBatch->pBuff[PrevChromOfs]))
+		{
+		PrevChromOfs = (int)(pLine - pBatch->pBuff);
+		strcpy(pLine,szChrom);
+		}
+	pIntvl->ChromOfs = PrevChromOfs;
+	pIntvl->StartOfs = StartLoci-1;
+	pIntvl->EndOfs = StartLoci + TLen - 2;
+	pIntvl += 1;
+	pBatch->NumIntvls += 1;
 	}
-BAMfile.Close();
-if(Rslt == eBSFSuccess)
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"From %d reads there were %d accepted and %d filtered out because of strand",NumEls,NumEls-NumFiltStrand,NumFiltStrand);
-return(Rslt == eBSFSuccess ? (NumEls-NumFiltStrand) : Rslt);
+return(pBatch->NumIntvls);
+}
+
+#ifdef _WIN32
+unsigned __stdcall ROIParseThread(void * pThreadPars)
+#else
+void *ROIParseThread(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsROIThreadPars *pPars = (tsROIThreadPars *)pThreadPars;			// makes it easier not having to deal with casts!
+CLocateROI *pLocateROI = (CLocateROI *)pPars->pThis;
+
+Rslt = pLocateROI->ThreadParse(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+#ifdef _WIN32
+unsigned __stdcall ROIChromsThread(void * pThreadPars)
+#else
+void *ROIChromsThread(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsROIThreadPars *pPars = (tsROIThreadPars *)pThreadPars;			// makes it easier not having to deal with casts!
+CLocateROI *pLocateROI = (CLocateROI *)pPars->pThis;
+
+Rslt = pLocateROI->ThreadChroms(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+int
+CLocateROI::StartParseThreads(tsROIThreadPars *pThreads)	// start batch parsing worker threads
+{
+int ThreadIdx;
+tsROIThreadPars *pThread;
+
+memset(pThreads,0,sizeof(tsROIThreadPars) * m_NumThreads);
+pThread = pThreads;
+for(ThreadIdx = 1; ThreadIdx <= m_NumThreads; ThreadIdx++, pThread++)
+	{
+	pThread->ThreadIdx = ThreadIdx;
+	pThread->pThis = this;
+#ifdef _WIN32
+	pThread->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ROIParseThread,pThread,0,&pThread->threadID);
+#else
+	pThread->threadRslt = pthread_create(&pThread->threadID,NULL,ROIParseThread,pThread);
+#endif
+	}
+return(m_NumThreads);
+}
+
+void
+CLocateROI::EndParseThreads(tsROIThreadPars *pThreads)	// wait for batch parsing worker threads to terminate
+{
+int ThreadIdx;
+tsROIThreadPars *pThread;
+
+pThread = pThreads;
+for(ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++, pThread++)
+	{
+#ifdef _WIN32
+	WaitForSingleObject(pThread->threadHandle,INFINITE);
+	CloseHandle(pThread->threadHandle);
+#else
+	pthread_join(pThread->threadID,NULL);
+#endif
+	}
+}
+
+// ThreadParse
+// Worker thread parsing filled batches, and applying the coverage deltas of resolved batches, until all batches have been filled, parsed and applied
+int
+CLocateROI::ThreadParse(tsROIThreadPars *pPars)
+{
+int Rslt;
+int BatchIdx;
+bool bAllFree;
+tsROIBatch *pBatch;
+tsROIBatch *pParseBatch;
+tsROIBatch *pApplyBatch;
+
+while(1)
+	{
+	AcquireSerialise();
+	if(m_ThreadsRslt < eBSFSuccess)
+		{
+		ReleaseSerialise();
+		return(eBSFSuccess);
+		}
+	bAllFree = true;
+	pParseBatch = NULL;
+	pApplyBatch = NULL;
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++,pBatch++)		// parse in filled order so the resolving thread is not kept waiting
+		{
+		if(pBatch->State != eRBfree)
+			bAllFree = false;
+		if(pBatch->State == eRBresolved && pApplyBatch == NULL)
+			pApplyBatch = pBatch;
+		if(pBatch->State == eRBfilled && (pParseBatch == NULL || pBatch->BatchSeq < pParseBatch->BatchSeq))
+			pParseBatch = pBatch;
+		}
+	if(pApplyBatch != NULL)			// applying resolved batches takes priority as batches are then freed for filling
+		{
+		pApplyBatch->State = eRBapplying;
+		ReleaseSerialise();
+		ApplyBatchCov(pApplyBatch);
+		AcquireSerialise();
+		pApplyBatch->State = eRBfree;
+		ReleaseSerialise();
+		continue;
+		}
+	if(pParseBatch == NULL)
+		{
+		if(m_bFillCompleted && bAllFree)
+			{
+			ReleaseSerialise();
+			return(eBSFSuccess);
+			}
+		ReleaseSerialise();
+		CUtility::SleepMillisecs(1);
+		continue;
+		}
+	pParseBatch->State = eRBparsing;
+	ReleaseSerialise();
+
+	Rslt = ParseBatch(pParseBatch);
+
+	AcquireSerialise();
+	pParseBatch->State = eRBparsed;
+	if(Rslt < eBSFSuccess && m_ThreadsRslt >= eBSFSuccess)
+		m_ThreadsRslt = Rslt;
+	ReleaseSerialise();
+	}
+}
+
+// RunChromThreads
+// Starts worker threads which process all chromosomes in the requested phase, chromosomes are independent so each is processed by a single thread
+int
+CLocateROI::RunChromThreads(etROIChromPhase Phase)
+{
+int ThreadIdx;
+int NumThreads;
+tsROIThreadPars *pThreads;
+tsROIThreadPars *pThread;
+
+if((NumThreads = min(m_NumThreads,m_NumChromsCov)) < 1)
+	return(eBSFSuccess);
+
+m_ChromPhase = Phase;
+m_NxtChromIdx = 0;
+m_ThreadsRslt = eBSFSuccess;
+pThreads = new tsROIThreadPars [NumThreads];
+memset(pThreads,0,sizeof(tsROIThreadPars) * NumThreads);
+pThread = pThreads;
+for(ThreadIdx = 1; ThreadIdx <= NumThreads; ThreadIdx++, pThread++)
+	{
+	pThread->ThreadIdx = ThreadIdx;
+	pThread->pThis = this;
+#ifdef _WIN32
+	pThread->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ROIChromsThread,pThread,0,&pThread->threadID);
+#else
+	pThread->threadRslt = pthread_create(&pThread->threadID,NULL,ROIChromsThread,pThread);
+#endif
+	}
+
+pThread = pThreads;
+for(ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++, pThread++)
+	{
+#ifdef _WIN32
+	WaitForSingleObject(pThread->threadHandle,INFINITE);
+	CloseHandle(pThread->threadHandle);
+#else
+	pthread_join(pThread->threadID,NULL);
+#endif
+	}
+delete []pThreads;
+return(m_ThreadsRslt);
+}
+
+// ThreadChroms
+// Worker thread claiming chromosomes and processing these in the current m_ChromPhase
+int
+CLocateROI::ThreadChroms(tsROIThreadPars *pPars)
+{
+int Rslt;
+int ChromIdx;
+
+Rslt = eBSFSuccess;
+while(1)
+	{
+	AcquireSerialise();
+	if(m_ThreadsRslt < eBSFSuccess || m_NxtChromIdx >= m_NumChromsCov)
+		{
+		ReleaseSerialise();
+		break;
+		}
+	ChromIdx = m_NxtChromIdx++;
+	ReleaseSerialise();
+
+	if(m_ChromPhase == eRCPFinalise)
+		Rslt = FinaliseChromCov(&m_ChromCnts[ChromIdx]);
+	else
+		Rslt = IdentChromROI(ChromIdx);
+
+	if(Rslt < eBSFSuccess)
+		{
+		AcquireSerialise();
+		if(m_ThreadsRslt >= eBSFSuccess)
+			m_ThreadsRslt = Rslt;
+		ReleaseSerialise();
+		break;
+		}
+	}
+return(Rslt);
+}
+
+void
+CLocateROI::AcquireSerialise(void)
+{
+int SpinCnt = 1000;
+int BackoffMS = 1;
+
+#ifdef _WIN32
+while(InterlockedCompareExchange(&m_CASSerialise,1,0)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 50)
+		BackoffMS += 1;
+	}
+#else
+while(__sync_val_compare_and_swap(&m_CASSerialise,0,1)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 50)
+		BackoffMS += 1;
+	}
+#endif
+}
+
+void
+CLocateROI::ReleaseSerialise(void)
+{
+#ifdef _WIN32
+InterlockedCompareExchange(&m_CASSerialise,0,1);
+#else
+__sync_val_compare_and_swap(&m_CASSerialise,1,0);
+#endif
 }
 
 
@@ -1706,7 +2618,8 @@ CLocateROI::Process(etPROIMode PMode,					// processing mode
 		int NumAssocFiles,				// number of association files in pszAssocFiles[]
 		char *pszAssocFiles[],			// distance association files
 		char *pszInFile,				// input CSV or BED file containing read alignment loci
-		char *pszRsltsFile)				// output CSV region loci file
+		char *pszRsltsFile,				// output CSV region loci file
+		int NumThreads)					// number of worker threads
 {
 int Rslt;
 bool bNoFilter;
@@ -1715,6 +2628,7 @@ char *pszInLociFile;
 int Idx;
 
 Init();
+m_NumThreads = NumThreads < 1 ? 1 : (NumThreads > cMaxWorkerThreads ? cMaxWorkerThreads : NumThreads);
 
 CSimpleGlob glob(SG_GLOB_FULLSORT);
 if (glob.Add(pszInFile) >= SG_SUCCESS)
@@ -1802,6 +2716,14 @@ if(!m_NumAcceptedReads)
 	return(1);
 	}
 
+// all source files processed so can now convert the accumulated coverage deltas into coverage counts
+int FinaliseRslt;
+if((FinaliseRslt = RunChromThreads(eRCPFinalise)) < eBSFSuccess)
+	{
+	Reset();
+	return(FinaliseRslt);
+	}
+
 
 // now filter by genomic regions
 if(pszRetainFile != NULL && pszRetainFile[0] != '\0')
@@ -24,6 +24,14 @@ const char *cpszNoFeat = "FxNxL";		// unlocated features are assigned this name
 
 const int cMaxChromCov = 1000;			// can handle at most this many chromosomes
 const int cAllocCovCnts = 0x07fffff;	// allocate for chrom coverage cnts in this sized increments
+const int cCovCntsDfltChromLen = 0x04000000;	// coverage cnts address space is reserved for the SAM header chrom length, or this length if chrom length is unknown
+const int cAllocHdrChroms = 0x01000;		// allocate for SAM header chrom lengths in this sized increments
+
+const int cMaxWorkerThreads = 128;			// limiting max number of threads to this many
+const int cROIBatchLines = 0x8000;			// parse at most this many SAM lines or BED features per batch
+const size_t cROIBatchBuffSize = 0x01000000;	// batch SAM lines buffer size
+const int cROIMaxBatches = 16;				// at most this many batches in flight, irrespective of the number of worker threads
+const int cMaxROIBatchLineLen = 0x4000;		// SAM lines are truncated to this length when copied into batches (only the first 9 fields are parsed)
 
 // processing modes
 typedef enum TAG_ePROIMode {		
@@ -61,16 +69,34 @@ typedef enum eBEDRegion {
 	eMEG3UTR					// only process 3'UTRs
 } etBEDRegion;
 
-#pragma pack(1)
+// batch source types
+typedef enum TAG_eROIBatchSrc {
+	eRBSSam = 0,					// batch lines are SAM alignments
+	eRBSBed							// batch is a range of BED feature identifiers
+	} etROIBatchSrc;
+
+// batch processing states
+typedef enum TAG_eROIBatchState {
+	eRBfree = 0,					// batch is available for filling
+	eRBfilled,						// batch has been filled and is ready for parsing
+	eRBparsing,						// batch is being parsed by a worker thread
+	eRBparsed,						// batch parsed, intervals ready to be resolved onto chromosomes
+	eRBresolved,					// intervals resolved onto chromosomes with coverage allocated, deltas ready to be applied
+	eRBapplying						// coverage deltas being applied by a worker thread
+	} etROIBatchState;
+
+// per chromosome processing phases
+typedef enum TAG_eROIChromPhase {
+	eRCPFinalise = 0,				// convert coverage deltas into coverage counts
+	eRCPIdentROI					// run length encode coverage and identify ROIs
+	} etROIChromPhase;
 
-typedef struct TAG_sChromCnts {
-	char szChrom[cMaxDatasetSpeciesChrom+1];	// coverage is on this chromosome
-	int AllocCovCnts;							// allocated to hold cnts for this sized chromosome
-	int StartOfs;								// pCovCnts[offset] of first coverage cnt
-	int EndOfs;									// pCovCnts[offset] of last coverage cnt
-	UINT32 *pCovCnts;							// coverage counts
-} tsChromCnts;
+#pragma pack(1)
 
+typedef struct TAG_sCovRun {
+	int StartOfs;								// run starts at this offset and ends immediately before the next run starts
+	UINT32 Cnt;									// all bases in run have this coverage
+} tsCovRun;
 
 typedef struct TAG_sROI {
 	int RegionID;					// unique region identifier
@@ -90,6 +116,59 @@ typedef struct TAG_sROI {
 	char szDSFeatID[cMaxGeneNameLen];	// nearest downstream feature name
 	int DSFeatFileID;				// nearest downstream feature file (in m_pszFeatFiles[DSFeatFileID-1])
 } tsROI;
+
+typedef struct TAG_sChromCnts {
+	char szChrom[cMaxDatasetSpeciesChrom+1];	// coverage is on this chromosome
+	int AllocCovCnts;							// allocated to hold cnts for this sized chromosome
+	int StartOfs;								// pCovCnts[offset] of first coverage cnt
+	int EndOfs;									// pCovCnts[offset] of last coverage cnt
+	UINT32 *pCovCnts;							// coverage counts, held as deltas until coverage has been finalised
+	UINT64 TotCnts;								// total coverage counts over this chromosome
+	int NumRuns;								// number of coverage runs in pRuns, including terminating run at EndOfs+1
+	tsCovRun *pRuns;							// run length encoded coverage, replaces pCovCnts when ROIs are identified
+	int NumROIs;								// number of ROIs identified on this chromosome
+	int AllocROIs;								// pROIs allocated to hold at most this many ROIs
+	tsROI *pROIs;								// ROIs identified on this chromosome
+} tsChromCnts;
+
+typedef struct TAG_sROIIntvl {
+	UINT32 ChromOfs;							// chromosome name is at this offset in the batch buffer
+	int ChromIdx;								// chromosome (m_ChromCnts[]) as resolved from the chromosome name
+	int StartOfs;								// interval starts at this offset
+	int EndOfs;									// and ends at this offset inclusive
+} tsROIIntvl;
+
+typedef struct TAG_sROIHdrChrom {
+	char szChrom[cMaxDatasetSpeciesChrom+1];	// SAM header '@SQ' chromosome name
+	int ChromLen;								// and length
+} tsROIHdrChrom;
+
+typedef struct TAG_sROIBatch {
+	etROIBatchState State;						// current processing state
+	INT64 BatchSeq;								// batches are resolved onto chromosomes in this order (1..n)
+	int NumLines;								// number of SAM lines in pBuff, or number of BED features
+	int FirstFeatID;							// if BED then first feature identifier in this batch
+	size_t BuffLen;								// current number of chars in pBuff
+	char *pBuff;								// holds '\0' separated SAM lines, overwritten with chromosome names when parsed
+	int NumIntvls;								// number of intervals parsed
+	tsROIIntvl *pIntvls;						// parsed intervals
+	int NumFiltStrand;							// number of elements filtered out because of strand
+	int NumPEReverse;							// number of PE reverse ends accepted but not contributing coverage
+} tsROIBatch;
+
+typedef struct TAG_sROIThreadPars {
+	int ThreadIdx;					// uniquely identifies this thread
+	void *pThis;					// will be initialised to pt to CLocateROI instance
+#ifdef _WIN32
+	HANDLE threadHandle;			// handle as returned by _beginthreadex()
+	unsigned int threadID;			// identifier as set by _beginthreadex()
+#else
+	int threadRslt;					// result as returned by pthread_create ()
+	pthread_t threadID;				// identifier as set by pthread_create ()
+#endif
+	int Rslt;						// returned result code
+} tsROIThreadPars;
+
 #pragma pack()
 
 
@@ -104,7 +183,32 @@ class CLocateROI
 	UINT32 m_NumAcceptedReads;			// total number of accepted reads or element loci
 
 	tsChromCnts m_ChromCnts[cMaxChromCov];
+	CMemArena m_CovCntsArenas[cMaxChromCov];	// m_ChromCnts[].pCovCnts are held in these arenas so can be extended whilst deltas are being applied
 	int m_NumChromsCov;		
+	int m_LastChromIdx;						// index of chromosome last accumulated onto, checked before searching all chromosomes
+	int m_NumHdrChroms;						// number of SAM header chromosome lengths in m_pHdrChroms
+	int m_AllocHdrChroms;					// m_pHdrChroms allocated to hold this many chromosome lengths
+	tsROIHdrChrom *m_pHdrChroms;			// SAM header chromosome lengths, sorted by name once header has been loaded
+
+	int m_NumThreads;						// number of worker threads
+	etROIBatchSrc m_BatchSrc;				// batches are being filled from this source type
+	char m_ROIStrand;						// batches filtered to accept elements on this strand
+	CSAMfile *m_pSAMFile;					// SAM or BAM file currently being loaded
+	int m_NumFiltStrand;					// number of batch elements filtered out because of strand
+	int m_NumBatches;						// number of allocated batches
+	tsROIBatch *m_pBatches;					// allocated batches
+	INT64 m_NxtFillSeq;						// sequence number to assign to next filled batch
+	INT64 m_NxtAccumSeq;					// next batch to be resolved onto chromosomes must have this sequence number
+	bool m_bFillCompleted;					// true when all batches have been filled
+	etROIChromPhase m_ChromPhase;			// per chromosome processing phase being run by ThreadChroms
+	int m_NxtChromIdx;						// next chromosome to be claimed by ThreadChroms
+	int m_MinMedianCov;						// ROI parameters used by ThreadChroms
+	int m_MinRegionLen;
+	int m_MaxGapLen;
+	bool m_bNoFilter;
+	int m_ThreadsRslt;						// set < 0 if any worker thread errors
+
+	volatile unsigned int m_CASSerialise;	// used with synchronous compare and swap (CAS) for serialising access
 
 	int m_hRsltsFile;						// handle for opened results file
 
@@ -123,11 +227,46 @@ class CLocateROI
 	char *TrimWhitespace(char *pTxt);
 	void Init(void);
 	void Reset(void);
+	int
+		ResolveChromCov(char *pszChrom,			// coverage is onto this chrom
+				  int *pStartOfs,			// coverage start at this offset 
+				  int *pEndOfs);			// and ends at this offset inclusive, returns chrom index or < 0 if errors
 	int
 		BuildReadCoverage(char *pszChrom,		// coverage is onto this chrom
 				  int StartOfs,				// coverage start at this offset 
 				  int EndOfs,				// and ends at this offset inclusive
 				  int Cnt);					// increment coverage by this
+	int
+		FinaliseChromCov(tsChromCnts *pChrom);	// convert coverage deltas into coverage counts
+
+	int
+		IdentChromROI(int ChromIdx);		// run length encode coverage then identify ROIs on this chromosome
+
+	int
+		RunChromThreads(etROIChromPhase Phase);	// process all chromosomes in this phase using worker threads
+
+	int
+		AllocBatches(int NumBatches);		// allocate batches used when loading SAM or BED elements
+	void FreeBatches(void);
+	int DrainAppliedBatches(void);		// wait until all resolved batches have had their coverage deltas applied
+
+	int AddHdrChrom(char *pszSQLine);		// add chromosome length from a SAM header '@SQ' line
+	int LocateHdrChromLen(char *pszChrom);	// returns SAM header length of chromosome, 0 if unknown
+	static int SortHdrChroms(const void *arg1, const void *arg2);	// used when sorting SAM header chromosomes by name
+
+	tsROIBatch *ReqFreeBatch(void);		// returns a free batch, resolving parsed batches whilst waiting
+	int	ResolveParsedBatches(bool bWait);	// resolve parsed batches, in batch order, onto chromosomes; if bWait then waits for all filled batches
+	int ParseBatch(tsROIBatch *pBatch);		// parse SAM lines or BED features into intervals
+	void ApplyBatchCov(tsROIBatch *pBatch);	// apply coverage deltas of resolved batch intervals
+
+	int
+		StartParseThreads(tsROIThreadPars *pThreads);	// start batch parsing worker threads
+	void
+		EndParseThreads(tsROIThreadPars *pThreads);		// wait for batch parsing worker threads to terminate
+
+	void AcquireSerialise(void);
+	void ReleaseSerialise(void);
+
 	int
 		RetainReadCoverage(char *pszChrom,		// filtering is onto this chrom
 			  int StartOfs,				// filtering is to start at this offset 
@@ -195,7 +334,10 @@ public:
 			int NumAssocFiles,				// number of association files in pszAssocFiles[]
 			char *pszAssocFiles[],			// distance association files
 			char *pszInFile,				// input CSV or BED file containing read alignment loci
-			char *pszRsltsFile);				// output CSV region loci file
+			char *pszRsltsFile,				// output CSV region loci file
+			int NumThreads = 1);			// number of worker threads
 
+	int ThreadParse(tsROIThreadPars *pPars);	// worker thread parsing filled batches
+	int ThreadChroms(tsROIThreadPars *pPars);	// worker thread processing chromosomes in m_ChromPhase
 };
 
@@ -24,6 +24,11 @@
 
 #include "MapLoci2Feat.h"
 
+#ifdef _WIN32
+unsigned __stdcall MLFMapLociThread(void * pThreadPars);
+#else
+void *MLFMapLociThread(void * pThreadPars);
+#endif
 
 CMapLoci2Feat::CMapLoci2Feat()
 {
@@ -33,6 +38,8 @@ m_pChromRegionCnts = NULL;
 m_pBiobed = NULL;
 m_pHypers = NULL;
 m_pFeatCntDists = NULL;
+m_pChromMaps = NULL;
+m_CASSerialise = 0;
 MLFReset();
 }
 
@@ -77,6 +84,12 @@ CMapLoci2Feat::MLFReset(void)
 		m_pChromRegionCnts = NULL;
 	}
 
+	if (m_pChromMaps != NULL)
+	{
+		delete [] m_pChromMaps;
+		m_pChromMaps = NULL;
+	}
+
 	m_MLFPMode = ePMdefault;
 	m_StrandProc = eStrandDflt;
 	m_IsoformRprt = eISOFPRPKM;
@@ -86,59 +99,36 @@ CMapLoci2Feat::MLFReset(void)
 	m_NumSplitEls = 0;
 	m_bFeatinsts = false;
 	m_bOneCntRead = false;
+	m_NumThreads = 1;
+	m_NumChromMaps = 0;
+	m_NumMissingChroms = 0;
 }
 
 // MapLoci2Features
 // Maps element loci to features and writes mapping for each element loci to pszRsltsFile
 // Assumes that the bed file containing features (m_pBiobed) has been opened and that all element loci have been parsed into m_pHypers
+// Elements are processed in windows of cMLFWindowEls, each window partitioned into contiguous element ranges over the worker threads.
+// Worker threads accumulate counts into their own tsMLFFeatCnts/tsChromRegionCnts which are reduced after all elements have been processed,
+// element mappings are written in element order after each window has been processed
 int
 CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 {
 	int Rslt;
-	char szLineBuff[0x03fff];
-	int BuffIdx;
-	int SrcID;
-	char Strand;
-	char *pszChrom;
-	int ChromID;
-	char *pszElType;
-	char *pszRefSpecies;
-	char *pszRelSpecies;
-	int PrevChromID;
-	int PrevElTypeID;
-	int PrevRefSpeciesID;
-	int PrevRelSpeciesID;
-	int StartLoci;
-	int EndLoci;
-	int Len;
-	int Features;
-	int AccumFeatures;
-	int NumFeatsOverlap;
-	int FeatMsk;
-	int FeatIdx;
-	UINT32 ElID;
 	int FeatID;
-	int NxtFeatID;
-	int NxtFeatStart;
-	int NxtFeatEnd;
-	int PrvFeatID;
-	int PrvFeatStart;
-	int PrvFeatEnd;
-	int RelScale;
-	int NumMissingChroms;
-
-	int PrevStartChromID = -1;
-	int	PrevStartLoci = -1;
-	char PrevStrand = '*';
-	bool bStartUniqLoci = true;
-
-	int MaxChromID;
-	int CoreStartLoci;
-	int CoreEndLoci;
+	int FeatIdx;
+	int ChromIdx;
+	int ThreadIdx;
+	int NumWindowThreads;
 	int TotNumFeatures;
+	UINT32 WindowStartElID;
+	UINT32 WindowEndElID;
+	UINT32 ElsPerThread;
+	int *pSrcCnts;
+	int *pDstCnts;
 	tsFeatCntDist *pCurFeatCntDist;		// to hold currently being processed feature count distribution
-	tsHyperElement *pEl;
-	int *pChromRegionCnts;
+	tsMLFFeatCnts *pFeatCnts;
+	tsMLFThreadPars *pThreads;
+	tsMLFThreadPars *pThread;
 
 	if (m_hRsltFile != -1)				// ensure closed
 	{
@@ -160,20 +150,6 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Output file created/truncated: '%s'", pszRsltsFile);
 	}
 
-	pszChrom = NULL;
-	PrevChromID = -1;
-	pszElType = NULL;
-	PrevElTypeID = -1;
-	pszRefSpecies = NULL;
-	PrevRefSpeciesID = -1;
-	pszRelSpecies = NULL;
-	PrevRelSpeciesID = -1;
-	BuffIdx = 0;
-
-	MaxChromID = 0;
-	AccumFeatures = 0;
-
-
 	m_AllocdChromRegionCnts = m_pBiobed->GetNumChromosomes();
 	if(m_pChromRegionCnts != NULL)
 		{
@@ -220,19 +196,329 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 		}
 	}
 
-	NumMissingChroms = 0;
+	// element chromosomes are mapped onto BED chromosomes up front so worker threads don't need to access the BED chromosome name cache
+	if ((Rslt = MapChroms()) < eBSFSuccess)
+	{
+		MLFReset();
+		return(Rslt);
+	}
+
+	if ((pThreads = new tsMLFThreadPars[m_NumThreads]) == NULL)
+	{
+		gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to allocate for %d tsMLFThreadPars instances", m_NumThreads);
+		MLFReset();
+		return(eBSFerrMem);
+	}
+	memset(pThreads, 0, sizeof(tsMLFThreadPars) * m_NumThreads);
+	Rslt = eBSFSuccess;
+	pThread = pThreads;
+	for (ThreadIdx = 1; ThreadIdx <= m_NumThreads; ThreadIdx++, pThread++)
+	{
+		pThread->ThreadIdx = ThreadIdx;
+		pThread->pThis = this;
+		pThread->AllocOverlapIDs = cMLFAllocOverlapIDs;
+		pThread->AllocOutBuff = cMLFAllocOutBuff;
+		if ((pThread->pFeatCnts = new tsMLFFeatCnts[TotNumFeatures]) == NULL ||
+			(pThread->pChromRegionCnts = new tsChromRegionCnts[m_AllocdChromRegionCnts]) == NULL ||
+			(pThread->pOverlapIDs = new int[pThread->AllocOverlapIDs]) == NULL ||
+			(pThread->pOutBuff = new char[pThread->AllocOutBuff]) == NULL)
+		{
+			gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to allocate memory for worker thread %d counts", ThreadIdx);
+			Rslt = eBSFerrMem;
+			break;
+		}
+		memset(pThread->pFeatCnts, 0, sizeof(tsMLFFeatCnts) * TotNumFeatures);
+		memset(pThread->pChromRegionCnts, 0, sizeof(tsChromRegionCnts) * m_AllocdChromRegionCnts);
+	}
+
+	m_NumMissingChroms = 0;
 	gDiagnostics.DiagOut(eDLInfo, gszProcName, "Associating (from %d) element %9.9d", m_NumEls, 1);
+	WindowEndElID = 0;
+	for (WindowStartElID = 1; Rslt >= eBSFSuccess && WindowStartElID <= m_NumEls; WindowStartElID = WindowEndElID + 1)
+	{
+		WindowEndElID = min(m_NumEls, WindowStartElID + cMLFWindowEls - 1);
+		NumWindowThreads = (int)min((UINT32)m_NumThreads, WindowEndElID - WindowStartElID + 1);
+		ElsPerThread = (WindowEndElID - WindowStartElID + NumWindowThreads) / NumWindowThreads;
+
+		pThread = pThreads;
+		for (ThreadIdx = 0; ThreadIdx < NumWindowThreads; ThreadIdx++, pThread++)
+		{
+			pThread->StartElID = WindowStartElID + (ThreadIdx * ElsPerThread);
+			pThread->EndElID = min(WindowEndElID, pThread->StartElID + ElsPerThread - 1);
+			pThread->OutBuffLen = 0;
+			pThread->Rslt = eBSFSuccess;
+			if (NumWindowThreads == 1)		// no point in starting a thread if only a single thread
+			{
+				pThread->Rslt = MapLociThread(pThread);
+				break;
+			}
+#ifdef _WIN32
+			pThread->threadHandle = (HANDLE)_beginthreadex(NULL, 0x0fffff, MLFMapLociThread, pThread, 0, &pThread->threadID);
+#else
+			pThread->threadRslt = pthread_create(&pThread->threadID, NULL, MLFMapLociThread, pThread);
+#endif
+		}
+
+		pThread = pThreads;
+		for (ThreadIdx = 0; ThreadIdx < NumWindowThreads; ThreadIdx++, pThread++)
+		{
+			if (NumWindowThreads > 1)
+			{
+#ifdef _WIN32
+				WaitForSingleObject(pThread->threadHandle, INFINITE);
+				CloseHandle(pThread->threadHandle);
+#else
+				pthread_join(pThread->threadID, NULL);
+#endif
+			}
+			if (pThread->Rslt < eBSFSuccess && Rslt >= eBSFSuccess)
+				Rslt = pThread->Rslt;
+		}
+
+		// write out element mappings in element order
+		pThread = pThreads;
+		for (ThreadIdx = 0; Rslt >= eBSFSuccess && m_hRsltFile != -1 && ThreadIdx < NumWindowThreads; ThreadIdx++, pThread++)
+			if (pThread->OutBuffLen > 0)
+				CUtility::SafeWrite(m_hRsltFile, pThread->pOutBuff, pThread->OutBuffLen);
+		printf("\b\b\b\b\b\b\b\b\b%9.9d", WindowEndElID);
+	}
+
+	// reduce worker thread counts
+	pThread = pThreads;
+	for (ThreadIdx = 0; Rslt >= eBSFSuccess && ThreadIdx < m_NumThreads; ThreadIdx++, pThread++)
+	{
+		pCurFeatCntDist = m_pFeatCntDists;
+		pFeatCnts = pThread->pFeatCnts;
+		for (FeatID = 1; FeatID <= TotNumFeatures; FeatID++, pCurFeatCntDist++, pFeatCnts++)
+		{
+			for (FeatIdx = 0; FeatIdx < 8; FeatIdx++)
+				pCurFeatCntDist->RegionCnts[FeatIdx] += pFeatCnts->RegionCnts[FeatIdx];
+			pCurFeatCntDist->RelAbundance += pFeatCnts->RelAbundance;
+			pCurFeatCntDist->UniqueReadLociHits += pFeatCnts->UniqueReadLociHits;
+		}
+		pSrcCnts = (int *)pThread->pChromRegionCnts;
+		pDstCnts = (int *)m_pChromRegionCnts;
+		for (ChromIdx = 0; ChromIdx < (int)((sizeof(tsChromRegionCnts) / sizeof(int)) * m_AllocdChromRegionCnts); ChromIdx++)
+			*pDstCnts++ += *pSrcCnts++;
+	}
+
+	pThread = pThreads;
+	for (ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++, pThread++)
+	{
+		if (pThread->pFeatCnts != NULL)
+			delete [] pThread->pFeatCnts;
+		if (pThread->pChromRegionCnts != NULL)
+			delete [] pThread->pChromRegionCnts;
+		if (pThread->pOverlapIDs != NULL)
+			delete [] pThread->pOverlapIDs;
+		if (pThread->pOutBuff != NULL)
+			delete [] pThread->pOutBuff;
+	}
+	delete [] pThreads;
+
+	if (Rslt < eBSFSuccess)
+	{
+		MLFReset();
+		return(Rslt);
+	}
+
+	gDiagnostics.DiagOut(eDLInfo, gszProcName, "All elements (%d) now associated", m_NumEls);
+	if (m_NumMissingChroms > 0)
+		gDiagnostics.DiagOut(eDLInfo, gszProcName, "There were %d elements not associated because of missing chromosomes", m_NumMissingChroms);
+
+	if (m_hRsltFile != -1)
+	{
+#ifdef _WIN32
+		_commit(m_hRsltFile);
+#else
+		fsync(m_hRsltFile);
+#endif
+		close(m_hRsltFile);
+		m_hRsltFile = -1;
+	}
+	return(eBSFSuccess);
+}
+
+#ifdef _WIN32
+unsigned __stdcall MLFMapLociThread(void * pThreadPars)
+#else
+void *MLFMapLociThread(void * pThreadPars)
+#endif
+{
+	int Rslt;
+	tsMLFThreadPars *pPars = (tsMLFThreadPars *)pThreadPars;			// makes it easier not having to deal with casts!
+	CMapLoci2Feat *pMapLoci2Feat = (CMapLoci2Feat *)pPars->pThis;
+
+	Rslt = pMapLoci2Feat->MapLociThread(pPars);
+	pPars->Rslt = Rslt;
+#ifdef _WIN32
+	_endthreadex(0);
+	return(eBSFSuccess);
+#else
+	pthread_exit(NULL);
+#endif
+}
+
+// MapChroms
+// Map each element chromosome onto a BED chromosome
+int
+CMapLoci2Feat::MapChroms(void)
+{
+	int Rslt;
+	int ChromID;
+	char *pszChrom;
+	tsMLFChromMap *pChromMap;
+
+	if (m_pChromMaps != NULL)
+	{
+		delete [] m_pChromMaps;
+		m_pChromMaps = NULL;
+	}
+	for (m_NumChromMaps = 0; m_pHypers->GetChrom(m_NumChromMaps + 1) != NULL; m_NumChromMaps++);
+	if ((m_pChromMaps = new tsMLFChromMap[m_NumChromMaps + 1]) == NULL)
+	{
+		gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to allocate for %d tsMLFChromMap instances", m_NumChromMaps + 1);
+		return(eBSFerrMem);
+	}
+	memset(m_pChromMaps, 0, sizeof(tsMLFChromMap) * (m_NumChromMaps + 1));
+	pChromMap = &m_pChromMaps[1];
+	for (ChromID = 1; ChromID <= m_NumChromMaps; ChromID++, pChromMap++)
+	{
+		pszChrom = m_pHypers->GetChrom(ChromID);
+		if (pszChrom == NULL || pszChrom[0] == '\0')
+		{
+			gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to get chrom text for ChromID: %d", ChromID);
+			return(eBSFerrInternal);
+		}
+
+		// some old datasets may be referencing ChrM as mitochondria, or ChrC as chloroplast
+		// so need to check for these
+		if (!stricmp(pszChrom, "chloroplast"))
+			pszChrom = (char *)"ChrC";
+		else
+			if (!stricmp(pszChrom, "mitochondria"))
+				pszChrom = (char *)"ChrM";
+		pChromMap->pszChrom = pszChrom;
+
+		Rslt = m_pBiobed->LocateChromIDbyName(pszChrom);
+		if (Rslt == eBSFerrChrom)
+		{
+			if (!stricmp(pszChrom, "ChrM"))
+				Rslt = m_pBiobed->LocateChromIDbyName((char *)"mitochondria");
+			else
+				if (!stricmp(pszChrom, "ChrC"))
+					Rslt = m_pBiobed->LocateChromIDbyName((char *)"chloroplast");
+		}
+		pChromMap->BEDChromID = Rslt > 0 ? Rslt : 0;
+	}
+	return(eBSFSuccess);
+}
+
+// LocateOverlaps
+// Locates all features overlapping StartLoci..EndLoci into pPars->pOverlapIDs, extending pOverlapIDs if required
+int
+CMapLoci2Feat::LocateOverlaps(tsMLFThreadPars *pPars, // thread's overlap identifiers buffer
+								int ChromID,		// features on this BED chromosome
+								int StartLoci,		// features must end on or after StartLoci
+								int EndLoci)		// and start on or before EndLoci
+{
+	int NumOverlaps;
+
+	NumOverlaps = m_pBiobed->LocateFeatureIDsinRangeOnChrom(ChromID, StartLoci, EndLoci, pPars->AllocOverlapIDs, pPars->pOverlapIDs);
+	if (NumOverlaps > pPars->AllocOverlapIDs)
+	{
+		delete [] pPars->pOverlapIDs;
+		pPars->AllocOverlapIDs = NumOverlaps + cMLFAllocOverlapIDs;
+		if ((pPars->pOverlapIDs = new int[pPars->AllocOverlapIDs]) == NULL)
+		{
+			pPars->AllocOverlapIDs = 0;
+			return(eBSFerrMem);
+		}
+		NumOverlaps = m_pBiobed->LocateFeatureIDsinRangeOnChrom(ChromID, StartLoci, EndLoci, pPars->AllocOverlapIDs, pPars->pOverlapIDs);
+	}
+	return(NumOverlaps < 0 ? 0 : NumOverlaps);
+}
+
+// MapLociThread
+// Associates elements pPars->StartElID..pPars->EndElID with features, accumulating counts into this thread's pPars->pFeatCnts and pPars->pChromRegionCnts
+// Element state (previous chrom and start loci) is initialised from the elements preceding StartElID so counts are independent of how elements were partitioned
+int
+CMapLoci2Feat::MapLociThread(tsMLFThreadPars *pPars)
+{
+	char *pCpy;
+	char *pszChrom;
+	char Strand;
+	char *pszElType;
+	char *pszRefSpecies;
+	int PrevChromID;
+	int PrevElTypeID;
+	int PrevRefSpeciesID;
+	int StartLoci;
+	int EndLoci;
+	int Len;
+	int Features;
+	int ChromFeatures;
+	int AccumFeatures;
+	int NumFeatsOverlap;
+	int OverlapIdx;
+	int FeatMsk;
+	int FeatIdx;
+	UINT32 ElID;
+	int FeatID;
+	int NxtFeatID;
+	int NxtFeatStart;
+	int NxtFeatEnd;
+	int PrvFeatID;
+	int PrvFeatStart;
+	int PrvFeatEnd;
+	int RelScale;
+	int SrcID;
+
+	int PrevStartChromID = -1;
+	int	PrevStartLoci = -1;
+	char PrevStrand = '*';
+	bool bStartUniqLoci = true;
+
+	int ChromID;
+	int CoreStartLoci;
+	int CoreEndLoci;
+	tsMLFFeatCnts *pCurFeatCnts;
+	tsHyperElement *pEl;
+	int *pChromRegionCnts;
+
+	pszChrom = NULL;
+	PrevChromID = -1;
+	pszElType = NULL;
+	PrevElTypeID = -1;
+	pszRefSpecies = NULL;
+	PrevRefSpeciesID = -1;
+	ChromID = 0;
+
+	// initialise the previous loci as if all elements preceding this thread's elements had been processed
+	for (ElID = pPars->StartElID - 1; ElID >= 1; ElID--)
+	{
+		if ((pEl = m_pHypers->GetElement(ElID)) == NULL)
+			break;
+		if (m_MLFPMode == ePMstarts && pEl->SplitElement == 1 &&
+			((pEl->PlusStrand == 1 && pEl->SplitFirst != 1) || (pEl->PlusStrand == 0 && pEl->SplitLast != 1)))
+			continue;
+		pszChrom = m_pChromMaps[pEl->ChromID].pszChrom;
+		ChromID = m_pChromMaps[pEl->ChromID].BEDChromID;
+		PrevChromID = pEl->ChromID;
+		PrevStartChromID = pEl->ChromID;
+		PrevStartLoci = pEl->StartLoci;
+		PrevStrand = pEl->PlusStrand ? '+' : '-';
+		break;
+	}
+
 	// Note: alignments will have been sorted ascending by chrom, start loci
-	for (ElID = 1; ElID <= m_NumEls; ElID++)
+	for (ElID = pPars->StartElID; ElID <= pPars->EndElID; ElID++)
 	{
 		AccumFeatures = 0;
-		if (!(ElID % 100000))
-			printf("\b\b\b\b\b\b\b\b\b%9.9d", ElID);
 		pEl = m_pHypers->GetElement(ElID);
-		if (pEl == NULL)
+		if (pEl == NULL || pEl->ChromID < 1 || pEl->ChromID > m_NumChromMaps)
 		{
 			gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to get details for element: %d", ElID);
-			MLFReset();
 			return(eBSFerrInternal);
 		}
 
@@ -247,21 +533,8 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 
 		if (pszChrom == NULL || PrevChromID != pEl->ChromID)
 		{
-			pszChrom = m_pHypers->GetChrom(pEl->ChromID);
-			if (pszChrom == NULL || pszChrom[0] == '\0')
-			{
-				gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to get chrom text for element: %d ChromID: %d", ElID, pEl->ChromID);
-				MLFReset();
-				return(eBSFerrInternal);
-			}
-
-			// some old datasets may be referencing ChrM as mitochondria, or ChrC as chloroplast
-			// so need to check for these
-			if (!stricmp(pszChrom, "chloroplast"))
-				pszChrom = (char *)"ChrC";
-			else
-				if (!stricmp(pszChrom, "mitochondria"))
-					pszChrom = (char *)"ChrM";
+			pszChrom = m_pChromMaps[pEl->ChromID].pszChrom;
+			ChromID = m_pChromMaps[pEl->ChromID].BEDChromID;
 			PrevChromID = pEl->ChromID;
 			PrevStartChromID = -1;
 			PrevStartLoci = -1;
@@ -281,13 +554,6 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 			PrevRefSpeciesID = pEl->RefSpeciesID;
 		}
 
-		if (pszRelSpecies == NULL || PrevRelSpeciesID != pEl->RelSpeciesID)
-		{
-			pszRelSpecies = m_pHypers->GetRelSpecies(pEl->RelSpeciesID);
-			PrevRelSpeciesID = pEl->RelSpeciesID;
-		}
-
-
 		StartLoci = pEl->StartLoci;
 		EndLoci = pEl->StartLoci + pEl->Len - 1;
 
@@ -305,9 +571,8 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 			bStartUniqLoci = false;
 
 		SrcID = pEl->SrcID;
-		Features = pEl->Features;
 		RelScale = pEl->RelScale;
-		switch (m_StrandProc)
+		switch (m_StrandProc)		// strand processing is only with a single worker thread as the BED strand filter is shared
 		{
 			case eStrandDflt:
 				break;
@@ -320,193 +585,183 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 		}
 		FeatID = 0;
 
-		if (m_pBiobed != NULL)
+		if (ChromID < 1)
 		{
-			Rslt = ChromID = m_pBiobed->LocateChromIDbyName(pszChrom);
-			if (Rslt == eBSFerrChrom)
-			{
-				// some old datasets may be referencing ChrM as mitochondria, or ChrC as chloroplast
-				// so need to check for these
-				if (!stricmp(pszChrom, "ChrM"))
-					Rslt = ChromID = m_pBiobed->LocateChromIDbyName((char *)"mitochondria");
-				else
-					if (!stricmp(pszChrom, "ChrC"))
-						Rslt = ChromID = m_pBiobed->LocateChromIDbyName((char *)"chloroplast");
-			}
+			AcquireSerialise();
+			if (m_NumMissingChroms++ < 10)
+				gDiagnostics.DiagOut(eDLInfo, gszProcName, "Unable to locate chromosome %s in BED file", pszChrom);
+			if (m_NumMissingChroms == 10)
+				gDiagnostics.DiagOut(eDLInfo, gszProcName, "Not reporting any additional missing chromosomes");
+			ReleaseSerialise();
+			continue;
+		}
 
-			if (Rslt == eBSFerrChrom)
-			{
-				if (NumMissingChroms++ < 10)
-					gDiagnostics.DiagOut(eDLInfo, gszProcName, "Unable to locate chromosome %s in BED file", pszChrom);
-				if (NumMissingChroms == 10)
-					gDiagnostics.DiagOut(eDLInfo, gszProcName, "Not reporting any additional missing chromosomes");
-				Rslt = 0;
-				continue;
-			}
+		CoreStartLoci = StartLoci;
+		CoreEndLoci = EndLoci;
 
-			if (Rslt > 0)
-			{
-				if (MaxChromID < ChromID)
-					MaxChromID = ChromID;
+		switch (m_MLFPMode)
+		{
+			case ePMdefault:
+				break;
 
-				CoreStartLoci = StartLoci;
-				CoreEndLoci = EndLoci;
+			case ePMstarts:
+				if (Strand == '+')
+					CoreEndLoci = CoreStartLoci;
+				else
+					CoreStartLoci = CoreEndLoci;
+				break;
 
-				switch (m_MLFPMode)
+			case ePMdyad:
+				if (Strand == '+')
 				{
-					case ePMdefault:
-						break;
+					CoreStartLoci += 73;
+					CoreEndLoci = CoreStartLoci;
+				}
+				else
+				{
+					CoreEndLoci -= 73;
+					if (CoreEndLoci < 0)
+						CoreEndLoci = 0;
+					CoreStartLoci = CoreEndLoci;
+				}
+				break;
+		}
 
-					case ePMstarts:
-						if (Strand == '+')
-							CoreEndLoci = CoreStartLoci;
-						else
-							CoreStartLoci = CoreEndLoci;
-						break;
+		// locate all overlapping features in a single index traversal
+		AccumFeatures = 0;
+		if ((NumFeatsOverlap = LocateOverlaps(pPars, ChromID, CoreStartLoci, CoreEndLoci)) < 0)
+			return(NumFeatsOverlap);
 
-					case ePMdyad:
-						if (Strand == '+')
-						{
-							CoreStartLoci += 73;
-							CoreEndLoci = CoreStartLoci;
-						}
-						else
-						{
-							CoreEndLoci -= 73;
-							if (CoreEndLoci < 0)
-								CoreEndLoci = 0;
-							CoreStartLoci = CoreEndLoci;
-						}
-						break;
-				}
+		// when not associating to individual features then the feature bits are those of all features at the loci so only need to be determined once
+		ChromFeatures = 0;
+		if (NumFeatsOverlap && !m_bFeatinsts)
+		{
+			ChromFeatures = m_pBiobed->GetFeatureBits(ChromID,			// feature is on which chromosome
+												 CoreStartLoci,							// feature must end on or after Start
+												 CoreEndLoci,							// and start on or before End
+												 cRegionFeatBits,
+												 m_RegRegionLen);
+			ChromFeatures |= m_pBiobed->GetSpliceSiteBits(ChromID, CoreStartLoci, CoreEndLoci, cMinSpliceOverlap);
+		}
 
-				// see if overlapping any features
-				AccumFeatures = 0;
-				NumFeatsOverlap = 0;
-				do
-				{
-					FeatID = m_pBiobed->LocateFeatureIDinRangeOnChrom(ChromID,	// feature is on which chromosome
-																	  CoreStartLoci,						// feature must end on or after Start
-																	  CoreEndLoci,						// and start on or before End 
-																	  NumFeatsOverlap + 1);				// Ith instance to return (1..n)
+		for (OverlapIdx = 0; OverlapIdx < NumFeatsOverlap; OverlapIdx++)
+		{
+			FeatID = pPars->pOverlapIDs[OverlapIdx];
+			if (m_bFeatinsts)
+			{
+				Features = m_pBiobed->GetFeatureOverlaps(cRegionFeatBits, FeatID, CoreStartLoci, CoreEndLoci, m_RegRegionLen);
+				Features |= m_pBiobed->GetFeatureBitsSpliceOverlaps(FeatID, CoreStartLoci, CoreEndLoci, cMinSpliceOverlap);
+			}
+			else
+				Features = ChromFeatures;
 
-					if (FeatID > 0 && m_pFeatCntDists != NULL)
+			if (m_bOneCntRead)
+			{
+				for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
+					if (Features & FeatMsk)
 					{
-						if (m_bFeatinsts)
-						{
-							Features = m_pBiobed->GetFeatureOverlaps(cRegionFeatBits, FeatID, CoreStartLoci, CoreEndLoci, m_RegRegionLen);
-							Features |= m_pBiobed->GetFeatureBitsSpliceOverlaps(FeatID, CoreStartLoci, CoreEndLoci, cMinSpliceOverlap);
-						}
-						else
-						{
-							Features = m_pBiobed->GetFeatureBits(ChromID,			// feature is on which chromosome
-																 CoreStartLoci,							// feature must end on or after Start
-																 CoreEndLoci,							// and start on or before End
-																 cRegionFeatBits,
-																 m_RegRegionLen);
-
-							Features |= m_pBiobed->GetSpliceSiteBits(ChromID, CoreStartLoci, CoreEndLoci, cMinSpliceOverlap);
-						}
-
-						if (m_bOneCntRead)
-						{
-							for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
-								if (Features & FeatMsk)
-								{
-									Features = FeatMsk;
-									break;
-								}
-						}
-						AccumFeatures |= Features;
-						pCurFeatCntDist = &m_pFeatCntDists[FeatID - 1];
-						for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
-							if (Features & FeatMsk)
-								pCurFeatCntDist->RegionCnts[FeatIdx] += 1;
-
-						// only accumulate relative abundance for reads in exons
-						if (Features & (cFeatBitCDS | cFeatBit5UTR | cFeatBit3UTR))
-						{
-							pCurFeatCntDist->RelAbundance += 999.0 / (double)max(1, RelScale);
-							if (bStartUniqLoci)
-								pCurFeatCntDist->UniqueReadLociHits += 1;
-						}
+						Features = FeatMsk;
+						break;
 					}
-					if (FeatID > 0)
-						NumFeatsOverlap += 1;
-				}
-				while (FeatID > 0);
+			}
+			AccumFeatures |= Features;
+			pCurFeatCnts = &pPars->pFeatCnts[FeatID - 1];
+			for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
+				if (Features & FeatMsk)
+					pCurFeatCnts->RegionCnts[FeatIdx] += 1;
+
+			// only accumulate relative abundance for reads in exons
+			if (Features & (cFeatBitCDS | cFeatBit5UTR | cFeatBit3UTR))
+			{
+				pCurFeatCnts->RelAbundance += 999.0 / (double)max(1, RelScale);
+				if (bStartUniqLoci)
+					pCurFeatCnts->UniqueReadLociHits += 1;
+			}
+		}
 
-				if (!NumFeatsOverlap) // if not overlapping or not contained in any feature then locate nearest feature up/dnstream
+		if (!NumFeatsOverlap) // if not overlapping or not contained in any feature then locate nearest feature up/dnstream
+		{
+			// find feature starting after core end loci
+			NxtFeatID = m_pBiobed->LocateFeatureAfter(ChromID,	// feature is on this chromosome
+													  CoreEndLoci);					         // feature starts on or immediately after this offset
+			if (NxtFeatID > 0)
+				m_pBiobed->GetFeature(NxtFeatID,		// feature instance identifier
+									  NULL,							// where to return feature name
+									  NULL,							// where to return chromosome name
+									  &NxtFeatStart,					// where to return feature start on chromosome (0..n) 
+									  &NxtFeatEnd);					// where to return feature end on chromosome
+
+																	// find feature ending before or at core start loci
+			PrvFeatID = m_pBiobed->LocateFeatureBefore(ChromID,	// feature is on this chromosome
+													   CoreStartLoci);			// feature ends on or immediately before this offset
+			if (PrvFeatID > 0)
+				m_pBiobed->GetFeature(PrvFeatID,		// feature instance identifier
+									  NULL,	// where to return feature name
+									  NULL,	// where to return chromosome name
+									  &PrvFeatStart,		// where to return feature start on chromosome (0..n) 
+									  &PrvFeatEnd);		// where to return feature end on chromosome
+
+			if (NxtFeatID < 1)
+				FeatID = PrvFeatID;
+			else
+			{
+				if (PrvFeatID < 1)
+					FeatID = NxtFeatID;
+				else
 				{
-					// find feature starting after core end loci
-					NxtFeatID = m_pBiobed->LocateFeatureAfter(ChromID,	// feature is on this chromosome
-															  CoreEndLoci);					         // feature starts on or immediately after this offset
-					if (NxtFeatID > 0)
-						m_pBiobed->GetFeature(NxtFeatID,		// feature instance identifier
-											  NULL,							// where to return feature name
-											  NULL,							// where to return chromosome name
-											  &NxtFeatStart,					// where to return feature start on chromosome (0..n) 
-											  &NxtFeatEnd);					// where to return feature end on chromosome
-
-																			// find feature ending before or at core start loci
-					PrvFeatID = m_pBiobed->LocateFeatureBefore(ChromID,	// feature is on this chromosome
-															   CoreStartLoci);			// feature ends on or immediately before this offset
-					if (PrvFeatID > 0)
-						m_pBiobed->GetFeature(PrvFeatID,		// feature instance identifier
-											  NULL,	// where to return feature name
-											  NULL,	// where to return chromosome name
-											  &PrvFeatStart,		// where to return feature start on chromosome (0..n) 
-											  &PrvFeatEnd);		// where to return feature end on chromosome
-
-					if (NxtFeatID < 1)
-						FeatID = PrvFeatID;
+					if ((NxtFeatStart - CoreEndLoci) < (CoreStartLoci - PrvFeatEnd))
+						FeatID = NxtFeatID;
 					else
-					{
-						if (PrvFeatID < 1)
-							FeatID = NxtFeatID;
-						else
-						{
-							if ((NxtFeatStart - CoreEndLoci) < (CoreStartLoci - PrvFeatEnd))
-								FeatID = NxtFeatID;
-							else
-								FeatID = PrvFeatID;
-						}
-					}
+						FeatID = PrvFeatID;
+				}
+			}
 
 
-					if (m_bFeatinsts)
-						AccumFeatures = m_pBiobed->GetFeatureOverlaps(cRegionFeatBits, FeatID, CoreStartLoci, CoreEndLoci, m_RegRegionLen);
-					else
-						AccumFeatures = m_pBiobed->GetFeatureBits(ChromID,			// feature is on which chromosome
-																  CoreStartLoci,							// feature must end on or after Start
-																  CoreEndLoci,							// and start on or before End
-																  cRegionFeatBits,
-																  m_RegRegionLen);
+			if (m_bFeatinsts)
+				AccumFeatures = m_pBiobed->GetFeatureOverlaps(cRegionFeatBits, FeatID, CoreStartLoci, CoreEndLoci, m_RegRegionLen);
+			else
+				AccumFeatures = m_pBiobed->GetFeatureBits(ChromID,			// feature is on which chromosome
+														  CoreStartLoci,							// feature must end on or after Start
+														  CoreEndLoci,							// and start on or before End
+														  cRegionFeatBits,
+														  m_RegRegionLen);
 
-					if (m_bOneCntRead)
+			if (m_bOneCntRead)
+			{
+				for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
+					if (AccumFeatures & FeatMsk)
 					{
-						for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
-							if (AccumFeatures & FeatMsk)
-							{
-								AccumFeatures = FeatMsk;
-								break;
-							}
+						AccumFeatures = FeatMsk;
+						break;
 					}
-					if (AccumFeatures && FeatID > 0 && m_pFeatCntDists != NULL)
-					{
-						pCurFeatCntDist = &m_pFeatCntDists[FeatID - 1];
+			}
+			if (AccumFeatures && FeatID > 0)
+			{
+				pCurFeatCnts = &pPars->pFeatCnts[FeatID - 1];
 
-						for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
-							if (AccumFeatures & FeatMsk)
-								pCurFeatCntDist->RegionCnts[FeatIdx] += 1;
-					}
-				}
+				for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1)
+					if (AccumFeatures & FeatMsk)
+						pCurFeatCnts->RegionCnts[FeatIdx] += 1;
 			}
 		}
 
 		if (m_hRsltFile != -1)
-			BuffIdx += sprintf(&szLineBuff[BuffIdx], "%d,\"%s\",\"%s\",\"%s\",%d,%d,%d,\"%c\",%d,%d\n",
+		{
+			if ((pPars->OutBuffLen + 1000) > pPars->AllocOutBuff)
+			{
+				if ((pCpy = new char[pPars->AllocOutBuff * 2]) == NULL)
+				{
+					gDiagnostics.DiagOut(eDLFatal, gszProcName, "Unable to extend element mapping output buffer to %zd chars", pPars->AllocOutBuff * 2);
+					return(eBSFerrMem);
+				}
+				memcpy(pCpy, pPars->pOutBuff, pPars->OutBuffLen);
+				delete [] pPars->pOutBuff;
+				pPars->pOutBuff = pCpy;
+				pPars->AllocOutBuff *= 2;
+			}
+			pPars->OutBuffLen += sprintf(&pPars->pOutBuff[pPars->OutBuffLen], "%d,\"%s\",\"%s\",\"%s\",%d,%d,%d,\"%c\",%d,%d\n",
 							   SrcID, pszElType, pszRefSpecies, pszChrom, StartLoci, EndLoci, Len, Strand, AccumFeatures, RelScale);
+		}
 
 		if (m_bOneCntRead)
 		{
@@ -519,39 +774,55 @@ CMapLoci2Feat::MapLoci2Features(char *pszRsltsFile)
 		}
 
 		if (!AccumFeatures)
-			m_pChromRegionCnts[ChromID - 1].Intergenic += 1;
+			pPars->pChromRegionCnts[ChromID - 1].Intergenic += 1;
 		else
 			{
-			pChromRegionCnts = (int *)&m_pChromRegionCnts[ChromID - 1];
+			pChromRegionCnts = (int *)&pPars->pChromRegionCnts[ChromID - 1];
 			for (FeatMsk = 0x01, FeatIdx = 0; FeatIdx < 8; FeatIdx++, FeatMsk <<= 1, pChromRegionCnts+=1)
 				if (AccumFeatures & FeatMsk)
 					*pChromRegionCnts += 1;
 			}
-
-		if (m_hRsltFile != -1 && ((BuffIdx + 1000) > sizeof(szLineBuff)))
-		{
-			CUtility::SafeWrite(m_hRsltFile, szLineBuff, BuffIdx);
-			BuffIdx = 0;
-		}
 	}
-	printf("\b\b\b\b\b\b\b\b\b%9.9d", ElID - 1);
-	gDiagnostics.DiagOut(eDLInfo, gszProcName, "All elements (%d) now associated", ElID - 1);
-	if (NumMissingChroms > 0)
-		gDiagnostics.DiagOut(eDLInfo, gszProcName, "There were %d elements not associated because of missing chromosomes", NumMissingChroms);
+	return(eBSFSuccess);
+}
 
-	if (m_hRsltFile != -1)
+void
+CMapLoci2Feat::AcquireSerialise(void)
+{
+	int SpinCnt = 1000;
+	int BackoffMS = 1;
+
+#ifdef _WIN32
+	while (InterlockedCompareExchange(&m_CASSerialise, 1, 0) != 0)
+	{
+		if (SpinCnt -= 1)
+			continue;
+		CUtility::SleepMillisecs(BackoffMS);
+		SpinCnt = 100;
+		if (BackoffMS < 50)
+			BackoffMS += 1;
+	}
+#else
+	while (__sync_val_compare_and_swap(&m_CASSerialise, 0, 1) != 0)
 	{
-		if (BuffIdx > 0)
-			CUtility::SafeWrite(m_hRsltFile, szLineBuff, BuffIdx);
+		if (SpinCnt -= 1)
+			continue;
+		CUtility::SleepMillisecs(BackoffMS);
+		SpinCnt = 100;
+		if (BackoffMS < 50)
+			BackoffMS += 1;
+	}
+#endif
+}
+
+void
+CMapLoci2Feat::ReleaseSerialise(void)
+{
 #ifdef _WIN32
-		_commit(m_hRsltFile);
+	InterlockedCompareExchange(&m_CASSerialise, 0, 1);
 #else
-		fsync(m_hRsltFile);
+	__sync_val_compare_and_swap(&m_CASSerialise, 1, 0);
 #endif
-		close(m_hRsltFile);
-		m_hRsltFile = -1;
-	}
-	return(eBSFSuccess);
 }
 
 // CompareFeatName
@@ -931,7 +1202,8 @@ CMapLoci2Feat::MLFProcess(etMLFPMode PMode,				// processing mode
 						  int RegRegionLen,			// regulatory region length
 						  int MinLength,				// minimum element length
 						  int MaxLength,				// maximum element length
-						  int JoinOverlap)			// deduping join overlap
+						  int JoinOverlap,			// deduping join overlap
+						  int NumThreads)			// number of worker threads
 {
 	int Rslt;
 	char *pszChrom;
@@ -946,6 +1218,12 @@ CMapLoci2Feat::MLFProcess(etMLFPMode PMode,				// processing mode
 	m_RegRegionLen = RegRegionLen;
 	m_bFeatinsts = bFeatinsts;
 	m_bOneCntRead = bOneCntRead;
+	m_NumThreads = NumThreads < 1 ? 1 : NumThreads;
+	if (m_StrandProc != eStrandDflt && m_NumThreads > 1)	// strand filtering is set on the shared BED file for each element so restricted to a single thread
+	{
+		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Strand processing requested, mapping elements to features using a single thread");
+		m_NumThreads = 1;
+	}
 
 	if ((m_pHypers = new CHyperEls) == NULL)
 	{
@@ -5,6 +5,11 @@ const int cMaxJoinOverlap = 100;		// max allowed join overlap
 
 const int cMaxLengthRange = 1000000;	// maximal element length
 
+const int cMaxWorkerThreads = 128;		// limiting max number of threads to this many
+const int cMLFWindowEls = 0x100000;		// elements are associated with features in windows of this many elements, each window is partitioned over the worker threads
+const int cMLFAllocOverlapIDs = 1000;	// initially allocate to hold this many overlapping feature identifiers per thread, realloc'd as may be required
+const size_t cMLFAllocOutBuff = 0x0400000;	// initially allocate per thread element mapping output buffers of this size, realloc'd as may be required
+
 										// processing modes
 typedef enum TAG_eMLFPMode
 {
@@ -67,6 +72,42 @@ typedef struct TAG_sChromRegionCnts
 	int Intergenic;						// cnts in Intergenic
 } tsChromRegionCnts;
 
+typedef struct TAG_sMLFFeatCnts
+{
+	int RegionCnts[8];					// region counts
+	double RelAbundance;				// relative abundance (sum of all the reciprocals for each read's RelScale)
+	int UniqueReadLociHits;				// number of unique loci in this transcript to which at least one read mapped
+} tsMLFFeatCnts;
+
+typedef struct TAG_sMLFChromMap
+{
+	int BEDChromID;						// element chromosome maps onto this BED chromosome, 0 if no BED chromosome
+	char *pszChrom;						// element chromosome name after any ChrC/ChrM renaming
+} tsMLFChromMap;
+
+typedef struct TAG_sMLFThreadPars
+{
+	int ThreadIdx;						// uniquely identifies this thread
+	void *pThis;						// will be initialised to pt to CMapLoci2Feat instance
+#ifdef _WIN32
+	HANDLE threadHandle;				// handle as returned by _beginthreadex()
+	unsigned int threadID;				// identifier as set by _beginthreadex()
+#else
+	int threadRslt;						// result as returned by pthread_create ()
+	pthread_t threadID;					// identifier as set by pthread_create ()
+#endif
+	UINT32 StartElID;					// process elements starting from this element identifier
+	UINT32 EndElID;						// through to this element identifier inclusive
+	tsMLFFeatCnts *pFeatCnts;			// this thread's per feature counts, reduced into m_pFeatCntDists after all elements processed
+	tsChromRegionCnts *pChromRegionCnts; // this thread's per chrom region counts, reduced into m_pChromRegionCnts after all elements processed
+	int AllocOverlapIDs;				// pOverlapIDs allocated to hold this many feature identifiers
+	int *pOverlapIDs;					// to hold identifiers of features overlapping currently processed element
+	size_t AllocOutBuff;				// pOutBuff allocated to hold this many chars
+	size_t OutBuffLen;					// pOutBuff currently holds this many chars
+	char *pOutBuff;						// element mapping output for this thread's elements, written in element order after window processed
+	int Rslt;							// returned result code
+} tsMLFThreadPars;
+
 #pragma pack()
 
 class CMapLoci2Feat
@@ -91,6 +132,23 @@ class CMapLoci2Feat
 
 	int m_hFeatRsltFile;
 
+	int m_NumThreads;					// number of worker threads to use
+	int m_NumChromMaps;					// m_pChromMaps holds mappings for this many element chromosomes
+	tsMLFChromMap *m_pChromMaps;		// element chromosomes mapped onto BED chromosomes
+	int m_NumMissingChroms;				// number of elements not associated because chromosome not in BED file
+	volatile unsigned int m_CASSerialise;	// used with synchronous compare and swap (CAS) for serialising access
+
+	int MapChroms(void);				// map element chromosomes onto BED chromosomes
+
+	int									// returned number of overlapping feature identifiers in pPars->pOverlapIDs
+		LocateOverlaps(tsMLFThreadPars *pPars, // thread's overlap identifiers buffer
+						int ChromID,		// features on this BED chromosome
+						int StartLoci,		// features must end on or after StartLoci
+						int EndLoci);		// and start on or before EndLoci
+
+	void AcquireSerialise(void);
+	void ReleaseSerialise(void);
+
 public:
 	CMapLoci2Feat();
 	~CMapLoci2Feat();
@@ -104,6 +162,8 @@ public:
 	bool IsIsoform(char *pszName);	// assumes that if the feature name is at least cMinNameRootLen long and suffixed by '.[0-99]' then thats an isoform
 	int MapFeatures2Loci(char *pszFeatRsltsFile);
 
+	int MapLociThread(tsMLFThreadPars *pPars);	// worker thread associating a contiguous range of elements with features
+
 	int MLFProcess(etMLFPMode PMode,				// processing mode
 								  bool bDedupe,				// true if input elements are to be deduped
 								  bool bFeatinsts,			// true if input elements are to be associated to individual features, false if to all features at that locus
@@ -120,7 +180,8 @@ public:
 								  int RegRegionLen,			// regulatory region length
 								  int MinLength,				// minimum element length
 								  int MaxLength,				// maximum element length
-								  int JoinOverlap);			// deduping join overlap
+								  int JoinOverlap,			// deduping join overlap
+								  int NumThreads = 1);		// number of worker threads
 
 };
 
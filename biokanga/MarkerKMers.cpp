@@ -16,6 +16,7 @@
 #include "../libbiokanga/commhdrs.h"
 #else
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <pthread.h>
 #include "../libbiokanga/commhdrs.h"
 #endif
@@ -33,6 +34,13 @@ m_pSfxArray = NULL;
 m_pMarkerBuff = NULL;
 m_pPutMarkers = NULL;
 m_pPutMarkersIndex = NULL;
+m_pInSeqFasta = NULL;
+m_pKMerBktFiles = NULL;
+m_pKMerBktSizes = NULL;
+m_pKMerBktKMers = NULL;
+m_NumKMerBuckets = 0;
+m_NumInSeqFiles = 0;
+memset(m_pszInSeqFiles,0,sizeof(m_pszInSeqFiles));
 m_hOutFile = -1;
 #ifdef _WIN32
 InitializeSRWLock(&m_hRwLock);
@@ -57,6 +65,12 @@ if(m_pSfxArray != NULL)
 	delete m_pSfxArray;
 if(m_pMarkerBuff != NULL)
 	delete m_pMarkerBuff;
+DeleteKMerBkts();
+if(m_pInSeqFasta != NULL)
+	delete m_pInSeqFasta;
+for(int Idx = 0; Idx < m_NumInSeqFiles; Idx++)
+	if(m_pszInSeqFiles[Idx] != NULL)
+		delete [] m_pszInSeqFiles[Idx];
 if(m_pPutMarkers != NULL)
 	{
 #ifdef _WIN32
@@ -131,6 +145,28 @@ if(m_pPutMarkersIndex != NULL)
 	m_pPutMarkersIndex = NULL;
 	}
 
+DeleteKMerBkts();
+if(m_pInSeqFasta != NULL)
+	{
+	delete m_pInSeqFasta;
+	m_pInSeqFasta = NULL;
+	}
+for(int Idx = 0; Idx < m_NumInSeqFiles; Idx++)
+	if(m_pszInSeqFiles[Idx] != NULL)
+		{
+		delete [] m_pszInSeqFiles[Idx];
+		m_pszInSeqFiles[Idx] = NULL;
+		}
+m_NumInSeqFiles = 0;
+m_CurInSeqFileIdx = 0;
+m_CurCultivarIdx = -1;
+m_ChunkTailLen = 0;
+m_bHomozygotic = false;
+m_bRevCplStrand = false;
+m_SuperKMerSpan = 0;
+m_NxtKMerBkt = 0;
+m_NumBktKMers = 0;
+
 m_szDataset[0] = '\0';
 m_szMarkerFile[0] = '\0';
 m_NumSfxEntries = 0;
@@ -264,18 +300,13 @@ CMarkerKMers::LocKMers(etPMode PMode,			// processing mode - defaults to 0
 		  int SuffixLen,				// cultivar specific suffix length
 		  int MinWithPrefix,			// minimum number of cultivars required to have the shared prefix
 		  int MaxHomozygotic,			// only report prefixes if K-Mer suffixes are homozygotic between a maximum of this many cultivars, if 1 then no other cultivars
-		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar
+		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar, NULL if K-mers to be partitioned from pszInSeqFiles
+		  int NumInSeqFiles,			// number of cultivar sequence file specs, wildcards allowed, used if pszSfxPseudoGenome is NULL
+		  char *pszInSeqFiles[],		// cultivar sequence files, each fasta entry is a cultivar pseudo-chromosome
 		  char *pszMarkerFile,			// output potential markers to this file
 		  int NumThreads)				// max number of threads allowed
 {
 int Rslt;
-INT64 NumPutativePrefixKMers;
-INT64 TotSenseCnts;
-INT64 TotAntisenseCnts;
-
-int EntryID;
-char szSfxEntryName[100];
-tsCultivar *pCultivar;
 
 Reset();
 
@@ -287,7 +318,7 @@ m_MinWithPrefix = MinWithPrefix;
 m_MaxHomozygotic = MaxHomozygotic;
 m_PutMarkerSize = (int)sizeof(tsPutMarker) + m_PrefixLen - 1;
 
-m_NumThreads = NumThreads;
+m_NumThreads = min(max(NumThreads,1),cMaxWorkerThreads);
 strncpy(m_szMarkerFile,pszMarkerFile,sizeof(m_szMarkerFile));
 m_szMarkerFile[sizeof(m_szMarkerFile)-1] = '\0';
 
@@ -326,79 +357,49 @@ if(m_pPutMarkers == MAP_FAILED)
 #endif
 m_NumPutMarkers = 0;
 
-if((m_pSfxArray = new CSfxArrayV3)==NULL)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Unable to instantiate instance of CSfxArrayV3");
-	Reset();
-	return(eBSFerrObj);
-	}
-
-if((Rslt = m_pSfxArray->Open(pszSfxPseudoGenome))!=eBSFSuccess)
-	{
-	while(m_pSfxArray->NumErrMsgs())
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,m_pSfxArray->GetErrMsg());
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open input bioseq suffix array file '%s'",pszSfxPseudoGenome);
-	Reset();
-	return(Rslt);
-	}
-
-// report to user some sfx array metadata for user conformation the targeted assembly is correct
-strcpy(m_szDataset,m_pSfxArray->GetDatasetName());
-if(m_pSfxArray->IsSOLiD())
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to process SOLiD colorspace suffix array file '%s'",pszSfxPseudoGenome);
-	Reset();
-	return(eBSFerrRefDataset);
-	}
-tsSfxHeaderV3 SfxHeader;
-m_pSfxArray->GetSfxHeader(&SfxHeader);
-gDiagnostics.DiagOut(eDLInfo,gszProcName,"Psuedo-assembly Name: '%s' Descr: '%s' Title: '%s' Version: %d",
-					 m_szDataset,SfxHeader.szDescription,SfxHeader.szTitle,SfxHeader.Version);
-gDiagnostics.DiagOut(eDLInfo,gszProcName,"Assembly block size: %llu",SfxHeader.SfxBlockSize);
-
-m_NumSfxEntries = m_pSfxArray->GetNumEntries();
-if(m_NumSfxEntries < 1)
+if(pszSfxPseudoGenome != NULL)
+	Rslt = LoadSfxCultivars(pszSfxPseudoGenome);
+else
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"No pseudo-chroms in '%s'",pszSfxPseudoGenome);
-	Reset();
-	return(eBSFerrEntry);
+	// expand any wildcards in the cultivar sequence file specs
+	CSimpleGlob glob(SG_GLOB_FULLSORT);
+	int Idx;
+	int FileID;
+	Rslt = eBSFSuccess;
+	for(Idx = 0; Rslt == eBSFSuccess && Idx < NumInSeqFiles; Idx++)
+		{
+		glob.Init();
+		if(glob.Add(pszInSeqFiles[Idx]) < SG_SUCCESS)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to glob '%s'",pszInSeqFiles[Idx]);
+			Rslt = eBSFerrOpnFile;	// treat as though unable to open file
+			break;
+			}
+		if(glob.FileCount() <= 0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to locate any cultivar sequence file matching '%s'",pszInSeqFiles[Idx]);
+			Rslt = eBSFerrOpnFile;
+			break;
+			}
+		for(FileID = 0; FileID < glob.FileCount(); FileID++)
+			{
+			if(m_NumInSeqFiles == cMaxKMerInSeqFiles)
+				{
+				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Too many cultivar sequence files, at most %d can be processed",cMaxKMerInSeqFiles);
+				Rslt = eBSFerrMaxEntries;
+				break;
+				}
+			m_pszInSeqFiles[m_NumInSeqFiles] = new char [_MAX_PATH];
+			strncpy(m_pszInSeqFiles[m_NumInSeqFiles],glob.File(FileID),_MAX_PATH);
+			m_pszInSeqFiles[m_NumInSeqFiles++][_MAX_PATH-1] = '\0';
+			}
+		}
 	}
-
-if(m_NumSfxEntries < 2 || m_NumSfxEntries > cMaxCultivars)
+if(Rslt < eBSFSuccess)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Number of pseudo-chroms (%d) in '%s' must be between 2 and %d",m_NumSfxEntries,pszSfxPseudoGenome,cMaxCultivars);
 	Reset();
-	return(eBSFerrEntry);
-	}
-
-// ensure assembly and suffix array has been fully loaded into memory 
-int CurBlockID = 1;		// currently only single block supported
-gDiagnostics.DiagOut(eDLInfo,gszProcName,"Loading genome assembly suffix array...");
-if((Rslt=m_pSfxArray->SetTargBlock(CurBlockID))<0)
-	{
-	while(m_pSfxArray->NumErrMsgs())
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,m_pSfxArray->GetErrMsg());
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Fatal: unable to load assembly suffix array");
 	return(Rslt);
 	}
-gDiagnostics.DiagOut(eDLInfo,gszProcName,"Assembly suffix array loaded");
-
-
-// now report whilst populating m_AllCultivars[]
-pCultivar = m_AllCultivars;
-for(EntryID = 1; EntryID <= m_NumSfxEntries; EntryID++, pCultivar++)
-	{
-	pCultivar->Status = 0;
-	m_pSfxArray->GetIdentName(EntryID,sizeof(szSfxEntryName),szSfxEntryName);
-	pCultivar->EntryID = EntryID;
-	strncpy(pCultivar->szEntryName,szSfxEntryName,sizeof(pCultivar->szEntryName));
-	pCultivar->szEntryName[sizeof(pCultivar->szEntryName)-1] = '\0';
-	pCultivar->EntryLen = m_pSfxArray->GetSeqLen(EntryID);
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"   Processing K-mers against pseudo-chromosome '%s'",szSfxEntryName);
-	}
-
-if(m_MinWithPrefix == 0 || m_MinWithPrefix > m_NumSfxEntries)
-	m_MinWithPrefix = m_NumSfxEntries;
 
 // looks good to go so create/truncate output marker sequence file
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Truncating/Creating output multi-fasta marker file '%s'",m_szMarkerFile);
@@ -422,78 +423,16 @@ if(m_hOutFile < 0)
 	return(eBSFerrCreateFile);
 	}
 
-// initialise and startup K-mer processing worker threads
-tsKMerThreadPars WorkerThreads[cMaxWorkerThreads];			// allow for max possible user configured number of threads
-int ThreadIdx;
-memset(WorkerThreads,0,sizeof(WorkerThreads));
-int NumActiveThreads;
-INT64 StartSfxIdx;
-INT64 EndSfxIdx;
-
-// partition the processing over multiple threads
-StartSfxIdx = 0;
-for(NumActiveThreads = 0; NumActiveThreads < m_NumThreads; NumActiveThreads++)
-	{
-	if((Rslt = m_pSfxArray->GenKMerCultThreadRange(PrefixLen,NumActiveThreads+1,m_NumThreads,StartSfxIdx,&EndSfxIdx))<1)
-		break;
-	WorkerThreads[NumActiveThreads].StartSfxIdx = StartSfxIdx;
-	WorkerThreads[NumActiveThreads].EndSfxIdx = EndSfxIdx;
-	StartSfxIdx = EndSfxIdx + 1;
-	}
-if(Rslt < 0)
+if(pszSfxPseudoGenome != NULL)
+	Rslt = GenSfxPrefixKMers();
+else
+	Rslt = GenBktPrefixKMers();
+if(Rslt < eBSFSuccess)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to partition processing between threads");
 	Reset();
 	return(Rslt);
 	}
 
-gDiagnostics.DiagOut(eDLInfo,gszProcName,"Process: Partitioning processing between %d threads",NumActiveThreads);
-for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
-	{
-	WorkerThreads[ThreadIdx].ThreadIdx = ThreadIdx + 1;
-	WorkerThreads[ThreadIdx].pThis = this;
-#ifdef _WIN32
-	WorkerThreads[ThreadIdx].threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,KMerThreadStart,&WorkerThreads[ThreadIdx],0,&WorkerThreads[ThreadIdx].threadID);
-#else
-	WorkerThreads[ThreadIdx].threadRslt =	pthread_create (&WorkerThreads[ThreadIdx].threadID , NULL , KMerThreadStart , &WorkerThreads[ThreadIdx] );
-#endif
-	}
-
-// allow threads a few seconds to startup
-#ifdef _WIN32
-	Sleep(10000);
-#else
-	sleep(10);
-#endif
-
-// let user know that this K-mer processing process is working hard...
-NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
-gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
-
-// wait for all threads to have completed
-for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
-	{
-#ifdef _WIN32
-	while(WAIT_TIMEOUT == WaitForSingleObject( WorkerThreads[ThreadIdx].threadHandle, 60000 * 10))
-		{
-		NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
-		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
-		}
-	CloseHandle( WorkerThreads[ThreadIdx].threadHandle);
-#else
-	struct timespec ts;
-	int JoinRlt;
-	clock_gettime(CLOCK_REALTIME, &ts);
-	ts.tv_sec += 60 * 10;
-	while((JoinRlt = pthread_timedjoin_np(WorkerThreads[ThreadIdx].threadID, NULL, &ts)) != 0)
-		{
-		NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
-		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
-		ts.tv_sec += 60;
-		}
-#endif
-	}
-
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Completed - putative prefix K-Mers: %lld",m_NumPutMarkers);
 
 if(m_pSfxArray != NULL)						// releases memory!
@@ -669,6 +608,1341 @@ return(eBSFSuccess);
 }
 
 
+// open and load suffix array over cultivar pseudo-chromosomes, each pseudo-chromosome is a cultivar
+int
+CMarkerKMers::LoadSfxCultivars(char *pszSfxPseudoGenome)	// contains pregenerated suffix over psuedochromosomes for each cultivar
+{
+int Rslt;
+int EntryID;
+char szSfxEntryName[100];
+tsCultivar *pCultivar;
+
+if((m_pSfxArray = new CSfxArrayV3)==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Unable to instantiate instance of CSfxArrayV3");
+	return(eBSFerrObj);
+	}
+
+if((Rslt = m_pSfxArray->Open(pszSfxPseudoGenome))!=eBSFSuccess)
+	{
+	while(m_pSfxArray->NumErrMsgs())
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,m_pSfxArray->GetErrMsg());
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open input bioseq suffix array file '%s'",pszSfxPseudoGenome);
+	return(Rslt);
+	}
+
+// report to user some sfx array metadata for user conformation the targeted assembly is correct
+strcpy(m_szDataset,m_pSfxArray->GetDatasetName());
+if(m_pSfxArray->IsSOLiD())
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to process SOLiD colorspace suffix array file '%s'",pszSfxPseudoGenome);
+	return(eBSFerrRefDataset);
+	}
+tsSfxHeaderV3 SfxHeader;
+m_pSfxArray->GetSfxHeader(&SfxHeader);
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Psuedo-assembly Name: '%s' Descr: '%s' Title: '%s' Version: %d",
+					 m_szDataset,SfxHeader.szDescription,SfxHeader.szTitle,SfxHeader.Version);
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Assembly block size: %llu",SfxHeader.SfxBlockSize);
+
+m_NumSfxEntries = m_pSfxArray->GetNumEntries();
+if(m_NumSfxEntries < 1)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"No pseudo-chroms in '%s'",pszSfxPseudoGenome);
+	return(eBSFerrEntry);
+	}
+
+if(m_NumSfxEntries < 2 || m_NumSfxEntries > cMaxCultivars)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Number of pseudo-chroms (%d) in '%s' must be between 2 and %d",m_NumSfxEntries,pszSfxPseudoGenome,cMaxCultivars);
+	return(eBSFerrEntry);
+	}
+
+// ensure assembly and suffix array has been fully loaded into memory 
+int CurBlockID = 1;		// currently only single block supported
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Loading genome assembly suffix array...");
+if((Rslt=m_pSfxArray->SetTargBlock(CurBlockID))<0)
+	{
+	while(m_pSfxArray->NumErrMsgs())
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,m_pSfxArray->GetErrMsg());
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Fatal: unable to load assembly suffix array");
+	return(Rslt);
+	}
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Assembly suffix array loaded");
+
+
+// now report whilst populating m_AllCultivars[]
+pCultivar = m_AllCultivars;
+for(EntryID = 1; EntryID <= m_NumSfxEntries; EntryID++, pCultivar++)
+	{
+	pCultivar->Status = 0;
+	m_pSfxArray->GetIdentName(EntryID,sizeof(szSfxEntryName),szSfxEntryName);
+	pCultivar->EntryID = EntryID;
+	strncpy(pCultivar->szEntryName,szSfxEntryName,sizeof(pCultivar->szEntryName));
+	pCultivar->szEntryName[sizeof(pCultivar->szEntryName)-1] = '\0';
+	pCultivar->EntryLen = m_pSfxArray->GetSeqLen(EntryID);
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"   Processing K-mers against pseudo-chromosome '%s'",szSfxEntryName);
+	}
+
+if(m_MinWithPrefix == 0 || m_MinWithPrefix > m_NumSfxEntries)
+	m_MinWithPrefix = m_NumSfxEntries;
+return(eBSFSuccess);
+}
+
+// locate prefix K-mers by iterating over the suffix array, iterations are partitioned over multiple threads
+int
+CMarkerKMers::GenSfxPrefixKMers(void)
+{
+int Rslt = eBSFSuccess;
+INT64 NumPutativePrefixKMers;
+INT64 TotSenseCnts;
+INT64 TotAntisenseCnts;
+
+// initialise and startup K-mer processing worker threads
+tsKMerThreadPars WorkerThreads[cMaxWorkerThreads];			// allow for max possible user configured number of threads
+int ThreadIdx;
+memset(WorkerThreads,0,sizeof(WorkerThreads));
+int NumActiveThreads;
+INT64 StartSfxIdx;
+INT64 EndSfxIdx;
+
+// partition the processing over multiple threads
+StartSfxIdx = 0;
+for(NumActiveThreads = 0; NumActiveThreads < m_NumThreads; NumActiveThreads++)
+	{
+	if((Rslt = m_pSfxArray->GenKMerCultThreadRange(m_PrefixLen,NumActiveThreads+1,m_NumThreads,StartSfxIdx,&EndSfxIdx))<1)
+		break;
+	WorkerThreads[NumActiveThreads].StartSfxIdx = StartSfxIdx;
+	WorkerThreads[NumActiveThreads].EndSfxIdx = EndSfxIdx;
+	StartSfxIdx = EndSfxIdx + 1;
+	}
+if(Rslt < 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to partition processing between threads");
+	return(Rslt);
+	}
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Process: Partitioning processing between %d threads",NumActiveThreads);
+for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
+	{
+	WorkerThreads[ThreadIdx].ThreadIdx = ThreadIdx + 1;
+	WorkerThreads[ThreadIdx].pThis = this;
+#ifdef _WIN32
+	WorkerThreads[ThreadIdx].threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,KMerThreadStart,&WorkerThreads[ThreadIdx],0,&WorkerThreads[ThreadIdx].threadID);
+#else
+	WorkerThreads[ThreadIdx].threadRslt =	pthread_create (&WorkerThreads[ThreadIdx].threadID , NULL , KMerThreadStart , &WorkerThreads[ThreadIdx] );
+#endif
+	}
+
+// allow threads a few seconds to startup
+#ifdef _WIN32
+	Sleep(10000);
+#else
+	sleep(10);
+#endif
+
+// let user know that this K-mer processing process is working hard...
+NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
+
+// wait for all threads to have completed
+for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
+	{
+#ifdef _WIN32
+	while(WAIT_TIMEOUT == WaitForSingleObject( WorkerThreads[ThreadIdx].threadHandle, 60000 * 10))
+		{
+		NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
+		}
+	CloseHandle( WorkerThreads[ThreadIdx].threadHandle);
+#else
+	struct timespec ts;
+	int JoinRlt;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += 60 * 10;
+	while((JoinRlt = pthread_timedjoin_np(WorkerThreads[ThreadIdx].threadID, NULL, &ts)) != 0)
+		{
+		NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
+		ts.tv_sec += 60;
+		}
+#endif
+	}
+return(eBSFSuccess);
+}
+
+// Partitioned prefix K-mer counting
+// Cultivar pseudo-chromosome sequences are loaded directly from fasta files, no suffix array is required. In a first phase, worker threads
+// scan chunks of these sequences and write runs of consecutive K-mers sharing the same canonical minimizer (super K-mers) into disk
+// backed buckets, the bucket being determined by that minimizer. As a prefix and its reverse complement share the same canonical minimizer then
+// all sense and antisense instances of a prefix will be in the same bucket. In a second phase, worker threads load complete buckets and
+// expand the super K-mers into packed K-mers which are sorted by canonical prefix, with cultivar presence bitmasks and counts then accumulated
+// over each canonical prefix. Memory is bounded by the number of buckets, which is chosen from the total cultivar sequence file sizes, but as
+// the number of buckets is itself limited by partitioning buffer memory and open file limits then any bucket which would still be too large
+// to expand is recursively re-bucketed, on a different part of the same minimizer, into sub-buckets which are then counted in turn.
+//
+// Sense counts for a prefix are the number of K-mers, containing only canonical bases over prefix + suffix, which start with that prefix;
+// antisense counts are the number of such K-mers which start with the reverse complement of that prefix. If checking for homozygotic
+// suffixes then the maximum number of cultivars sharing any prefix + suffix K-mer, on either strand, is limited to m_MaxHomozygotic.
+int
+CMarkerKMers::GenBktPrefixKMers(void)
+{
+int Rslt;
+int Idx;
+int ThreadIdx;
+int NumActiveThreads;
+int Phase;
+INT64 NumPutativePrefixKMers;
+INT64 TotSenseCnts;
+INT64 TotAntisenseCnts;
+INT64 TotSeqFileSize;
+INT64 EstBktMem;
+int MaxBuckets;
+int RecWords;
+char szBktFile[_MAX_PATH+32];
+
+m_bHomozygotic = (m_SuffixLen > 0 && m_MaxHomozygotic > 0) ? true : false;
+m_bRevCplStrand = (m_bHomozygotic && m_PMode != ePMNSenseKMers) ? true : false;
+m_SuperKMerSpan = m_bHomozygotic ? m_KMerLen : m_PrefixLen;
+RecWords = ((m_PrefixLen + 31) / 32) + 1 + (m_bHomozygotic ? ((m_SuffixLen + 31) / 32) : 0);
+
+// choose number of buckets so that an expanded bucket, at one K-mer per base, is expected to fit within cKMerBucketTargMem
+TotSeqFileSize = 0;
+for(Idx = 0; Idx < m_NumInSeqFiles; Idx++)
+	{
+#ifdef _WIN32
+	struct _stat64 st;
+	if(!_stat64(m_pszInSeqFiles[Idx],&st))
+#else
+	struct stat64 st;
+	if(!stat64(m_pszInSeqFiles[Idx],&st))
+#endif
+		TotSeqFileSize += (INT64)st.st_size;
+	}
+EstBktMem = TotSeqFileSize * (m_bRevCplStrand ? 2 : 1) * RecWords * sizeof(UINT64);
+
+// number of buckets is limited by per thread partitioning buffer memory and by the number of files which can be opened, allowing for sub-bucket files
+MaxBuckets = (int)(cKMerBktBuffMem / cKMerBucketBuffSize);
+#ifndef _WIN32
+struct rlimit FileLimit;
+if(!getrlimit(RLIMIT_NOFILE,&FileLimit) && FileLimit.rlim_cur != RLIM_INFINITY)
+	{
+	INT64 FilesAvail = (INT64)FileLimit.rlim_cur - cKMerBktRsvdFiles - ((INT64)m_NumThreads * (cMaxKMerSubBkts + cMaxKMerReBktDepth));
+	if(FilesAvail < (INT64)MaxBuckets)
+		MaxBuckets = (int)max((INT64)cMinKMerBuckets,FilesAvail);
+	}
+#endif
+m_NumKMerBuckets = (int)min((INT64)MaxBuckets,max((INT64)cMinKMerBuckets,(EstBktMem / cKMerBucketTargMem) + 1));
+
+// create/truncate bucket files
+if((m_pKMerBktFiles = new int [m_NumKMerBuckets])==NULL ||
+   (m_pKMerBktSizes = new INT64 [m_NumKMerBuckets])==NULL ||
+   (m_pKMerBktKMers = new INT64 [m_NumKMerBuckets])==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Unable to allocate memory for %d K-mer buckets",m_NumKMerBuckets);
+	return(eBSFerrMem);
+	}
+for(Idx = 0; Idx < m_NumKMerBuckets; Idx++)
+	{
+	m_pKMerBktFiles[Idx] = -1;
+	m_pKMerBktSizes[Idx] = 0;
+	m_pKMerBktKMers[Idx] = 0;
+	}
+for(Idx = 0; Idx < m_NumKMerBuckets; Idx++)
+	{
+	sprintf(szBktFile,"%s.kbkt%d",m_szMarkerFile,Idx+1);
+#ifdef _WIN32
+	m_pKMerBktFiles[Idx] = open(szBktFile,O_CREATETRUNC);
+#else
+	if((m_pKMerBktFiles[Idx] = open(szBktFile,O_RDWR | O_CREAT,S_IREAD | S_IWRITE))!=-1)
+		if(ftruncate(m_pKMerBktFiles[Idx],0)!=0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to truncate %s - %s",szBktFile,strerror(errno));
+			return(eBSFerrCreateFile);
+			}
+#endif
+	if(m_pKMerBktFiles[Idx] < 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to create/truncate K-mer bucket file '%s'",szBktFile);
+		m_pKMerBktFiles[Idx] = -1;
+		return(eBSFerrCreateFile);
+		}
+	}
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Partitioning K-mers from %d cultivar sequence files into %d buckets",m_NumInSeqFiles,m_NumKMerBuckets);
+
+tsKMerBktThreadPars *pWorkerThreads;
+if((pWorkerThreads = new tsKMerBktThreadPars [m_NumThreads])==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Unable to allocate memory for %d threads",m_NumThreads);
+	return(eBSFerrMem);
+	}
+memset(pWorkerThreads,0,sizeof(tsKMerBktThreadPars) * m_NumThreads);
+NumActiveThreads = m_NumThreads;
+
+Rslt = eBSFSuccess;
+for(Phase = 0; Rslt >= eBSFSuccess && Phase < 2; Phase++)
+	{
+	if(Phase == 1)
+		{
+		if(m_NumSfxEntries < 2 || m_NumSfxEntries > cMaxCultivars)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Number of cultivar pseudo-chroms (%d) must be between 2 and %d",m_NumSfxEntries,cMaxCultivars);
+			Rslt = eBSFerrEntry;
+			break;
+			}
+		for(Idx = 0; Idx < m_NumSfxEntries; Idx++)
+			gDiagnostics.DiagOut(eDLInfo,gszProcName,"   Processing K-mers against pseudo-chromosome '%s'",m_AllCultivars[Idx].szEntryName);
+		if(m_MinWithPrefix == 0 || m_MinWithPrefix > m_NumSfxEntries)
+			m_MinWithPrefix = m_NumSfxEntries;
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Partitioned %lld K-mers, now counting K-mers in buckets ...",m_NumBktKMers);
+		m_NxtKMerBkt = 0;
+		}
+
+	for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
+		{
+		pWorkerThreads[ThreadIdx].ThreadIdx = ThreadIdx + 1;
+		pWorkerThreads[ThreadIdx].pThis = this;
+		pWorkerThreads[ThreadIdx].bCountPhase = Phase == 1 ? true : false;
+		pWorkerThreads[ThreadIdx].Rslt = eBSFSuccess;
+		if(Phase == 0)
+			{
+			pWorkerThreads[ThreadIdx].AllocSeqChunk = cKMerSeqChunkSize;
+			if((pWorkerThreads[ThreadIdx].pSeqChunk = new etSeqBase [cKMerSeqChunkSize])==NULL ||
+				(m_bRevCplStrand && (pWorkerThreads[ThreadIdx].pRevCplChunk = new etSeqBase [cKMerSeqChunkSize])==NULL) ||
+				(pWorkerThreads[ThreadIdx].pMinimizers = new UINT32 [cKMerSeqChunkSize])==NULL ||
+				(pWorkerThreads[ThreadIdx].pBktBuffs = new UINT8 [(size_t)m_NumKMerBuckets * cKMerBucketBuffSize])==NULL ||
+				(pWorkerThreads[ThreadIdx].pBktBuffLens = new UINT32 [m_NumKMerBuckets])==NULL ||
+				(pWorkerThreads[ThreadIdx].pBktBuffKMers = new UINT32 [m_NumKMerBuckets])==NULL)
+				{
+				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Unable to allocate memory for K-mer partitioning");
+				Rslt = eBSFerrMem;
+				break;
+				}
+			memset(pWorkerThreads[ThreadIdx].pBktBuffLens,0,sizeof(UINT32) * m_NumKMerBuckets);
+			memset(pWorkerThreads[ThreadIdx].pBktBuffKMers,0,sizeof(UINT32) * m_NumKMerBuckets);
+			}
+		}
+	if(Rslt < eBSFSuccess)
+		break;
+
+	for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
+		{
+#ifdef _WIN32
+		pWorkerThreads[ThreadIdx].threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,KMerBktThreadStart,&pWorkerThreads[ThreadIdx],0,&pWorkerThreads[ThreadIdx].threadID);
+#else
+		pWorkerThreads[ThreadIdx].threadRslt =	pthread_create (&pWorkerThreads[ThreadIdx].threadID , NULL , KMerBktThreadStart , &pWorkerThreads[ThreadIdx] );
+#endif
+		}
+
+	// wait for all threads to have completed, periodically letting user know that processing is progressing
+	for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
+		{
+#ifdef _WIN32
+		while(WAIT_TIMEOUT == WaitForSingleObject( pWorkerThreads[ThreadIdx].threadHandle, 60000 * 10))
+			{
+			NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
+			gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
+			}
+		CloseHandle( pWorkerThreads[ThreadIdx].threadHandle);
+#else
+		struct timespec ts;
+		int JoinRlt;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += 60 * 10;
+		while((JoinRlt = pthread_timedjoin_np(pWorkerThreads[ThreadIdx].threadID, NULL, &ts)) != 0)
+			{
+			NumPutativePrefixKMers = GetKMerProcProgress(&TotSenseCnts,&TotAntisenseCnts);
+			gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - putative prefix K-Mers: %lld",NumPutativePrefixKMers);
+			ts.tv_sec += 60;
+			}
+#endif
+		if(pWorkerThreads[ThreadIdx].Rslt < eBSFSuccess)
+			Rslt = pWorkerThreads[ThreadIdx].Rslt;
+		}
+	}
+
+for(ThreadIdx = 0; ThreadIdx < NumActiveThreads; ThreadIdx++)
+	{
+	if(pWorkerThreads[ThreadIdx].pSeqChunk != NULL)
+		delete [] pWorkerThreads[ThreadIdx].pSeqChunk;
+	if(pWorkerThreads[ThreadIdx].pRevCplChunk != NULL)
+		delete [] pWorkerThreads[ThreadIdx].pRevCplChunk;
+	if(pWorkerThreads[ThreadIdx].pMinimizers != NULL)
+		delete [] pWorkerThreads[ThreadIdx].pMinimizers;
+	if(pWorkerThreads[ThreadIdx].pBktBuffs != NULL)
+		delete [] pWorkerThreads[ThreadIdx].pBktBuffs;
+	if(pWorkerThreads[ThreadIdx].pBktBuffLens != NULL)
+		delete [] pWorkerThreads[ThreadIdx].pBktBuffLens;
+	if(pWorkerThreads[ThreadIdx].pBktBuffKMers != NULL)
+		delete [] pWorkerThreads[ThreadIdx].pBktBuffKMers;
+	}
+delete [] pWorkerThreads;
+DeleteKMerBkts();
+return(Rslt);
+}
+
+// close and remove any bucket files
+void
+CMarkerKMers::DeleteKMerBkts(void)
+{
+int Idx;
+char szBktFile[_MAX_PATH+32];
+if(m_pKMerBktFiles != NULL)
+	{
+	for(Idx = 0; Idx < m_NumKMerBuckets; Idx++)
+		{
+		if(m_pKMerBktFiles[Idx] == -1)
+			continue;
+		close(m_pKMerBktFiles[Idx]);
+		sprintf(szBktFile,"%s.kbkt%d",m_szMarkerFile,Idx+1);
+		remove(szBktFile);
+		}
+	delete [] m_pKMerBktFiles;
+	m_pKMerBktFiles = NULL;
+	}
+if(m_pKMerBktSizes != NULL)
+	{
+	delete [] m_pKMerBktSizes;
+	m_pKMerBktSizes = NULL;
+	}
+if(m_pKMerBktKMers != NULL)
+	{
+	delete [] m_pKMerBktKMers;
+	m_pKMerBktKMers = NULL;
+	}
+m_NumKMerBuckets = 0;
+}
+
+// Thread startup for partitioned K-mer processing
+#ifdef WIN32
+unsigned int __stdcall CMarkerKMers::KMerBktThreadStart(void *args)
+{
+#else
+void * CMarkerKMers::KMerBktThreadStart(void *args)
+{
+#endif
+tsKMerBktThreadPars *pArgs = (tsKMerBktThreadPars *)args;
+if(pArgs->bCountPhase)
+	pArgs->Rslt = pArgs->pThis->CountBktKMers(pArgs);
+else
+	pArgs->Rslt = pArgs->pThis->PartitionKMers(pArgs);
+#ifdef WIN32
+ExitThread(1);
+#else
+return NULL;
+#endif
+}
+
+// returns next chunk of sequence bases for partitioning, chunks from the same cultivar overlap by m_KMerLen-1 bases
+// so K-mers spanning chunks are not lost
+int									// returned number of bases in chunk, 0 if no more sequences, < 0 if errors
+CMarkerKMers::GetSeqChunk(int MaxLen,			// return at most this many bases
+				etSeqBase *pSeqChunk,	// into this buffer
+				int *pCultivarIdx)		// bases are from this cultivar
+{
+int Rslt;
+int SeqLen;
+int ChunkLen;
+int Idx;
+char szDescription[cBSFDescriptionSize];
+char szName[cBSFDescriptionSize];
+tsCultivar *pCultivar;
+
+AcquireLock(true);
+while(1)
+	{
+	if(m_pInSeqFasta == NULL)
+		{
+		if(m_CurInSeqFileIdx >= m_NumInSeqFiles)		// all sequences loaded?
+			{
+			ReleaseLock(true);
+			return(0);
+			}
+		if((m_pInSeqFasta = new CFasta)==NULL)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Unable to instantiate instance of CFasta");
+			m_CurInSeqFileIdx = m_NumInSeqFiles;
+			ReleaseLock(true);
+			return(eBSFerrObj);
+			}
+		if((Rslt = m_pInSeqFasta->Open(m_pszInSeqFiles[m_CurInSeqFileIdx],true))!=eBSFSuccess)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open cultivar sequence file '%s' [%s] %s",m_pszInSeqFiles[m_CurInSeqFileIdx],m_pInSeqFasta->ErrText((teBSFrsltCodes)Rslt),m_pInSeqFasta->GetErrMsg());
+			delete m_pInSeqFasta;
+			m_pInSeqFasta = NULL;
+			m_CurInSeqFileIdx = m_NumInSeqFiles;
+			ReleaseLock(true);
+			return(Rslt);
+			}
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Partitioning K-mers from cultivar sequence file '%s'",m_pszInSeqFiles[m_CurInSeqFileIdx]);
+		m_CurCultivarIdx = -1;
+		m_ChunkTailLen = 0;
+		}
+
+	if(m_ChunkTailLen)
+		memcpy(pSeqChunk,m_ChunkTail,m_ChunkTailLen);
+	SeqLen = m_pInSeqFasta->ReadSequence(&pSeqChunk[m_ChunkTailLen],MaxLen - m_ChunkTailLen,true,false);
+	if(SeqLen == eBSFFastaDescr || (SeqLen > 0 && m_CurCultivarIdx == -1))		// starting a new cultivar?
+		{
+		if(SeqLen == eBSFFastaDescr)
+			{
+			m_pInSeqFasta->ReadDescriptor(szDescription,sizeof(szDescription));
+			if(sscanf(szDescription," %s[ ,]",szName)!=1)
+				sprintf(szName,"%s.%d",m_pszInSeqFiles[m_CurInSeqFileIdx],m_NumSfxEntries+1);
+			}
+		else		// no descriptor so dummy up one...
+			sprintf(szName,"%s.%d",m_pszInSeqFiles[m_CurInSeqFileIdx],m_NumSfxEntries+1);
+		if(m_NumSfxEntries == cMaxCultivars)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Too many cultivar pseudo-chroms, at most %d can be processed",cMaxCultivars);
+			m_CurInSeqFileIdx = m_NumInSeqFiles;
+			delete m_pInSeqFasta;
+			m_pInSeqFasta = NULL;
+			ReleaseLock(true);
+			return(eBSFerrMaxEntries);
+			}
+		m_CurCultivarIdx = m_NumSfxEntries++;
+		pCultivar = &m_AllCultivars[m_CurCultivarIdx];
+		pCultivar->EntryID = m_CurCultivarIdx + 1;
+		strncpy(pCultivar->szEntryName,szName,sizeof(pCultivar->szEntryName));
+		pCultivar->szEntryName[sizeof(pCultivar->szEntryName)-1] = '\0';
+		pCultivar->EntryLen = 0;
+		pCultivar->Status = 0;
+		m_ChunkTailLen = 0;
+		if(SeqLen == eBSFFastaDescr)
+			continue;
+		}
+
+	if(SeqLen <= 0)			// onto next file?
+		{
+		delete m_pInSeqFasta;
+		m_pInSeqFasta = NULL;
+		if(SeqLen < 0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst reading cultivar sequence file '%s'",m_pszInSeqFiles[m_CurInSeqFileIdx]);
+			m_CurInSeqFileIdx = m_NumInSeqFiles;
+			ReleaseLock(true);
+			return(SeqLen);
+			}
+		m_CurInSeqFileIdx += 1;
+		continue;
+		}
+
+	// remove any repeat masking flags
+	for(Idx = m_ChunkTailLen; Idx < m_ChunkTailLen + SeqLen; Idx++)
+		pSeqChunk[Idx] &= ~cRptMskFlg;
+	m_AllCultivars[m_CurCultivarIdx].EntryLen += SeqLen;
+
+	ChunkLen = m_ChunkTailLen + SeqLen;
+	m_ChunkTailLen = min(ChunkLen,m_KMerLen - 1);
+	memcpy(m_ChunkTail,&pSeqChunk[ChunkLen - m_ChunkTailLen],m_ChunkTailLen);
+	*pCultivarIdx = m_CurCultivarIdx;
+	ReleaseLock(true);
+	return(ChunkLen);
+	}
+}
+
+// partition K-mers in sequence chunks into buckets
+int
+CMarkerKMers::PartitionKMers(tsKMerBktThreadPars *pPars)
+{
+int Rslt;
+int ChunkLen;
+int CultivarIdx;
+int Idx;
+etSeqBase *pSrc;
+etSeqBase *pDst;
+
+Rslt = eBSFSuccess;
+while((ChunkLen = GetSeqChunk(pPars->AllocSeqChunk,pPars->pSeqChunk,&CultivarIdx)) > 0)
+	{
+	if((Rslt = PartitionChunk(pPars,CultivarIdx,0,ChunkLen,pPars->pSeqChunk)) < eBSFSuccess)
+		break;
+	if(m_bRevCplStrand)
+		{
+		pSrc = &pPars->pSeqChunk[ChunkLen-1];
+		pDst = pPars->pRevCplChunk;
+		for(Idx = 0; Idx < ChunkLen; Idx++,pSrc--,pDst++)
+			*pDst = *pSrc <= eBaseT ? eBaseT - *pSrc : eBaseN;
+		if((Rslt = PartitionChunk(pPars,CultivarIdx,cSuperKMerRevStrand,ChunkLen,pPars->pRevCplChunk)) < eBSFSuccess)
+			break;
+		}
+	}
+if(ChunkLen < 0)
+	Rslt = ChunkLen;
+
+// flush any remaining buffered super K-mers
+for(Idx = 0; Rslt >= eBSFSuccess && Idx < m_NumKMerBuckets; Idx++)
+	if(pPars->pBktBuffLens[Idx])
+		Rslt = FlushBktBuff(pPars,Idx);
+return(Rslt);
+}
+
+// append buffered super K-mers to bucket file
+int
+CMarkerKMers::FlushBktBuff(tsKMerBktThreadPars *pPars,	// append buffered super K-mers to bucket file
+				int BktIdx)				// bucket
+{
+bool bWritten;
+AcquireLock(true);
+bWritten = CUtility::SafeWrite(m_pKMerBktFiles[BktIdx],&pPars->pBktBuffs[(size_t)BktIdx * cKMerBucketBuffSize],pPars->pBktBuffLens[BktIdx]);
+m_pKMerBktSizes[BktIdx] += pPars->pBktBuffLens[BktIdx];
+m_pKMerBktKMers[BktIdx] += pPars->pBktBuffKMers[BktIdx];
+ReleaseLock(true);
+pPars->pBktBuffLens[BktIdx] = 0;
+pPars->pBktBuffKMers[BktIdx] = 0;
+if(!bWritten)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst writing K-mer bucket file - %s",strerror(errno));
+	return(eBSFerrWrite);
+	}
+return(eBSFSuccess);
+}
+
+// hashes a canonical minimizer, the minimum of the forward and reverse complement packed cKMerMinimizerLen bases
+static inline UINT32
+HashMinimizer(UINT32 FwdMer,	// packed forward bases
+			  UINT32 RevMer)	// packed reverse complement bases
+{
+return((UINT32)((((UINT64)min(FwdMer,RevMer) + 1) * 0x9E3779B97F4A7C15ULL) >> 32));
+}
+
+// returns the hashed canonical minimizer of the first K-mer prefix in super K-mer bases
+// All K-mers in a super K-mer share this minimizer, bases are all canonical
+UINT32
+CMarkerKMers::SuperKMerMinimizer(etSeqBase *pBases)	// super K-mer bases, at least m_PrefixLen
+{
+int BaseIdx;
+UINT32 FwdMer;
+UINT32 RevMer;
+UINT32 MerMsk;
+UINT32 Hash;
+UINT32 MinHash;
+
+MerMsk = (UINT32)((1 << (2 * cKMerMinimizerLen)) - 1);
+FwdMer = 0;
+RevMer = 0;
+MinHash = 0xffffffff;
+for(BaseIdx = 0; BaseIdx < m_PrefixLen; BaseIdx++,pBases++)
+	{
+	FwdMer = ((FwdMer << 2) | *pBases) & MerMsk;
+	RevMer = (RevMer >> 2) | ((UINT32)(eBaseT - *pBases) << (2 * (cKMerMinimizerLen - 1)));
+	if(BaseIdx >= cKMerMinimizerLen - 1 && (Hash = HashMinimizer(FwdMer,RevMer)) < MinHash)
+		MinHash = Hash;
+	}
+return(MinHash);
+}
+
+// partition K-mers in chunk into buckets
+// Each K-mer must only contain canonical bases over m_KMerLen, the bucket is determined by the minimum hashed canonical
+// minimizer over the K-mer's prefix, consecutive K-mers sharing the same minimizer are written as a single super K-mer
+int
+CMarkerKMers::PartitionChunk(tsKMerBktThreadPars *pPars,	// partition K-mers in this chunk into buckets
+				int CultivarIdx,		// chunk is from this cultivar
+				UINT8 Flags,			// cSuperKMerRevStrand if from reverse complement strand
+				int ChunkLen,			// chunk contains this many bases
+				etSeqBase *pChunk)		// chunk bases
+{
+int Rslt;
+int Idx;
+int BaseIdx;
+int RunLen;
+int NumWindows;
+int MinimizerSpan;
+int CurMinIdx;
+int LastNonCanonical;
+int SKStart;
+int SKEnd;
+int SKLen;
+int BktIdx;
+UINT32 SKMinimizer;
+UINT32 FwdMer;
+UINT32 RevMer;
+UINT32 MerMsk;
+UINT32 *pMinimizers;
+etSeqBase Base;
+etSeqBase *pBase;
+UINT8 *pBuff;
+UINT8 *pPacked;
+tsSuperKMer *pSuperKMer;
+INT64 NumKMers;
+
+if(ChunkLen < m_KMerLen)
+	return(eBSFSuccess);
+
+// hash canonical minimizer candidates starting at each base, candidates containing non-canonical bases are never accepted as K-mers
+pMinimizers = pPars->pMinimizers;
+MerMsk = (UINT32)((1 << (2 * cKMerMinimizerLen)) - 1);
+FwdMer = 0;
+RevMer = 0;
+RunLen = 0;
+pBase = pChunk;
+for(BaseIdx = 0; BaseIdx < ChunkLen; BaseIdx++,pBase++)
+	{
+	if((Base = *pBase) > eBaseT)
+		{
+		RunLen = 0;
+		FwdMer = RevMer = 0;
+		}
+	else
+		{
+		RunLen += 1;
+		FwdMer = ((FwdMer << 2) | Base) & MerMsk;
+		RevMer = (RevMer >> 2) | ((UINT32)(eBaseT - Base) << (2 * (cKMerMinimizerLen - 1)));
+		}
+	if(BaseIdx >= cKMerMinimizerLen - 1)
+		{
+		if(RunLen >= cKMerMinimizerLen)
+			pMinimizers[BaseIdx - cKMerMinimizerLen + 1] = HashMinimizer(FwdMer,RevMer);
+		else
+			pMinimizers[BaseIdx - cKMerMinimizerLen + 1] = 0xffffffff;
+		}
+	}
+
+MinimizerSpan = m_PrefixLen - cKMerMinimizerLen + 1;
+NumWindows = ChunkLen - m_KMerLen + 1;
+NumKMers = 0;
+CurMinIdx = -1;
+SKStart = -1;
+SKEnd = -1;
+SKMinimizer = 0;
+LastNonCanonical = -1;
+for(BaseIdx = 0; BaseIdx < m_KMerLen - 1; BaseIdx++)
+	if(pChunk[BaseIdx] > eBaseT)
+		LastNonCanonical = BaseIdx;
+
+for(Idx = 0; Idx <= NumWindows; Idx++)
+	{
+	if(Idx < NumWindows)
+		{
+		if(pChunk[Idx + m_KMerLen - 1] > eBaseT)
+			LastNonCanonical = Idx + m_KMerLen - 1;
+		if(LastNonCanonical < Idx)		// K-mer only contains canonical bases
+			{
+			// update minimizer over K-mer prefix
+			if(CurMinIdx < Idx)
+				{
+				CurMinIdx = Idx;
+				for(BaseIdx = Idx + 1; BaseIdx < Idx + MinimizerSpan; BaseIdx++)
+					if(pMinimizers[BaseIdx] < pMinimizers[CurMinIdx])
+						CurMinIdx = BaseIdx;
+				}
+			else
+				if(pMinimizers[Idx + MinimizerSpan - 1] < pMinimizers[CurMinIdx])
+					CurMinIdx = Idx + MinimizerSpan - 1;
+			NumKMers += 1;
+
+			// extend current super K-mer?
+			if(SKStart != -1 && SKEnd == Idx - 1 && pMinimizers[CurMinIdx] == SKMinimizer && (Idx - SKStart + m_SuperKMerSpan) <= cMaxSuperKMerLen)
+				{
+				SKEnd = Idx;
+				continue;
+				}
+			}
+		else
+			CurMinIdx = -1;
+		}
+
+	// write out any current super K-mer
+	if(SKStart != -1)
+		{
+		SKLen = SKEnd - SKStart + m_SuperKMerSpan;
+		BktIdx = (int)(SKMinimizer % (UINT32)m_NumKMerBuckets);
+		if((pPars->pBktBuffLens[BktIdx] + sizeof(tsSuperKMer) + ((SKLen + 3) / 4)) > (UINT32)cKMerBucketBuffSize)
+			if((Rslt = FlushBktBuff(pPars,BktIdx)) < eBSFSuccess)
+				return(Rslt);
+		pBuff = &pPars->pBktBuffs[((size_t)BktIdx * cKMerBucketBuffSize) + pPars->pBktBuffLens[BktIdx]];
+		pSuperKMer = (tsSuperKMer *)pBuff;
+		pSuperKMer->CultivarIdx = (UINT8)CultivarIdx;
+		pSuperKMer->Flags = Flags;
+		pSuperKMer->NumBases = (UINT16)SKLen;
+		pPacked = pBuff + sizeof(tsSuperKMer);
+		memset(pPacked,0,(SKLen + 3) / 4);
+		pBase = &pChunk[SKStart];
+		for(BaseIdx = 0; BaseIdx < SKLen; BaseIdx++,pBase++)
+			pPacked[BaseIdx / 4] |= *pBase << (2 * (BaseIdx & 0x03));
+		pPars->pBktBuffLens[BktIdx] += (UINT32)(sizeof(tsSuperKMer) + ((SKLen + 3) / 4));
+		pPars->pBktBuffKMers[BktIdx] += (UINT32)(SKEnd - SKStart + 1);
+		SKStart = -1;
+		}
+
+	// start a new super K-mer
+	if(Idx < NumWindows && CurMinIdx != -1)
+		{
+		SKStart = SKEnd = Idx;
+		SKMinimizer = pMinimizers[CurMinIdx];
+		}
+	}
+
+EnterCritSect();
+m_NumBktKMers += NumKMers;
+LeaveCritSect();
+return(eBSFSuccess);
+}
+
+static int gBktPrefixWords = 0;				// used when sorting bucket K-mers, number of UINT64 words holding packed prefix
+static int gBktSuffixWords = 0;				// used when sorting bucket K-mers, number of UINT64 words holding packed suffix
+
+// pack bases, 2 bits per base with the first base in the most significant bits, into UINT64 words
+static inline void
+PackKMerBases(int NumBases,			// number of bases to pack
+			  etSeqBase *pBases,	// bases to pack
+			  UINT64 *pWords)		// pack into these words, (NumBases + 31)/32 words
+{
+int Idx;
+UINT64 Word;
+Word = 0;
+for(Idx = 0; Idx < NumBases; Idx++,pBases++)
+	{
+	Word = (Word << 2) | *pBases;
+	if((Idx & 0x1f) == 0x1f)
+		{
+		*pWords++ = Word;
+		Word = 0;
+		}
+	}
+if(Idx & 0x1f)
+	*pWords = Word << (2 * (32 - (Idx & 0x1f)));
+}
+
+// count K-mers in buckets, buckets are claimed by counting threads until all buckets have been counted
+int
+CMarkerKMers::CountBktKMers(tsKMerBktThreadPars *pPars)
+{
+int Rslt;
+int BktIdx;
+char szBktFile[_MAX_PATH+32];
+
+gBktPrefixWords = (m_PrefixLen + 31) / 32;
+gBktSuffixWords = m_bHomozygotic ? (m_SuffixLen + 31) / 32 : 0;
+pPars->KMerCultsCnts.TotCultivars = m_NumSfxEntries;
+Rslt = eBSFSuccess;
+
+while(Rslt >= eBSFSuccess)
+	{
+	EnterCritSect();
+	BktIdx = m_NxtKMerBkt < m_NumKMerBuckets ? m_NxtKMerBkt++ : -1;
+	LeaveCritSect();
+	if(BktIdx == -1)
+		break;
+	if(m_pKMerBktSizes[BktIdx] == 0)
+		continue;
+
+	sprintf(szBktFile,"%s.kbkt%d",m_szMarkerFile,BktIdx+1);
+	if((Rslt = CountBktFile(pPars,m_pKMerBktFiles[BktIdx],szBktFile,m_pKMerBktSizes[BktIdx],m_pKMerBktKMers[BktIdx],(UINT32)m_NumKMerBuckets,0)) < eBSFSuccess)
+		break;
+
+	// bucket no longer required
+	AcquireLock(true);
+	close(m_pKMerBktFiles[BktIdx]);
+	m_pKMerBktFiles[BktIdx] = -1;
+	ReleaseLock(true);
+	remove(szBktFile);
+	}
+
+if(pPars->pBktData != NULL)
+	{
+	free(pPars->pBktData);
+	pPars->pBktData = NULL;
+	}
+if(pPars->pBktRecs != NULL)
+	{
+	free(pPars->pBktRecs);
+	pPars->pBktRecs = NULL;
+	}
+return(Rslt);
+}
+
+// count K-mers in a bucket or sub-bucket file
+// If the bucket's expanded K-mers would need more than cKMerBucketMaxMem then the bucket is re-bucketed into sub-buckets, on the
+// minimizer divided by Divisor, and each sub-bucket is then counted. As all K-mers sharing a canonical prefix also share the same
+// minimizer then these K-mers will all be in the same sub-bucket.
+int
+CMarkerKMers::CountBktFile(tsKMerBktThreadPars *pPars,	// count K-mers in a bucket or sub-bucket file, re-bucketing if oversized
+				int hBktFile,			// opened bucket file
+				char *pszBktFile,		// bucket file name, sub-bucket file names are derived from this name
+				INT64 BktFileSize,		// bucket file size
+				INT64 BktKMers,			// number of K-mers in bucket
+				UINT32 Divisor,			// all minimizers in this bucket share the same value modulo this divisor
+				int Depth)				// re-bucketing depth, 0 if a top level bucket
+{
+int Rslt;
+int PrefixWords;
+int SuffixWords;
+int RecWords;
+int Idx;
+int Ofs;
+int NumBases;
+int Orient;
+int SubIdx;
+int NumSubBkts;
+int hSubBktFile;
+size_t BktSize;
+size_t BktOfs;
+size_t ReqAlloc;
+int NumRead;
+INT64 NumRecs;
+INT64 RecIdx;
+INT64 GroupStart;
+INT64 *pSubBktSizes;
+INT64 *pSubBktKMers;
+UINT64 *pRec;
+UINT64 *pGroup;
+tsSuperKMer *pSuperKMer;
+UINT8 *pPacked;
+etSeqBase Bases[cMaxSuperKMerLen];
+etSeqBase RevCplPrefix[cMaxKMerLen];
+etSeqBase *pPrefix;
+char szSubBktFile[_MAX_PATH+64];
+
+PrefixWords = gBktPrefixWords;
+SuffixWords = gBktSuffixWords;
+RecWords = PrefixWords + 1 + SuffixWords;
+
+// if oversized then re-bucket, sub-bucket is (minimizer / Divisor) % NumSubBkts so Divisor * NumSubBkts must be representable
+if((BktKMers * RecWords * (INT64)sizeof(UINT64)) > cKMerBucketMaxMem && Depth < cMaxKMerReBktDepth)
+	{
+	NumSubBkts = (int)min((INT64)cMaxKMerSubBkts,((BktKMers * RecWords * (INT64)sizeof(UINT64)) / cKMerBucketTargMem) + 1);
+	if(((UINT64)Divisor * (UINT64)NumSubBkts) <= (UINT64)0xffffffff)
+		{
+		if((pSubBktSizes = new INT64 [NumSubBkts])==NULL ||
+			(pSubBktKMers = new INT64 [NumSubBkts])==NULL)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"CountBktFile: unable to allocate memory for %d K-mer sub-buckets",NumSubBkts);
+			if(pSubBktSizes != NULL)
+				delete [] pSubBktSizes;
+			return(eBSFerrMem);
+			}
+		Rslt = ReBucket(hBktFile,pszBktFile,BktFileSize,Divisor,NumSubBkts,pSubBktSizes,pSubBktKMers);
+		for(SubIdx = 0; SubIdx < NumSubBkts; SubIdx++)
+			{
+			sprintf(szSubBktFile,"%s.%d",pszBktFile,SubIdx+1);
+			if(Rslt >= eBSFSuccess && pSubBktSizes[SubIdx] > 0)
+				{
+				if((hSubBktFile = open(szSubBktFile,O_READSEQ)) == -1)
+					{
+					gDiagnostics.DiagOut(eDLFatal,gszProcName,"CountBktFile: unable to open K-mer sub-bucket file '%s' - %s",szSubBktFile,strerror(errno));
+					Rslt = eBSFerrOpnFile;
+					}
+				else
+					{
+					// a sub-bucket holding all of the bucket's K-mers is most likely a single dominant minimizer so is not re-bucketed any further
+					Rslt = CountBktFile(pPars,hSubBktFile,szSubBktFile,pSubBktSizes[SubIdx],pSubBktKMers[SubIdx],Divisor * (UINT32)NumSubBkts,
+												pSubBktKMers[SubIdx] == BktKMers ? cMaxKMerReBktDepth : Depth + 1);
+					close(hSubBktFile);
+					}
+				}
+			remove(szSubBktFile);
+			}
+		delete [] pSubBktSizes;
+		delete [] pSubBktKMers;
+		return(Rslt);
+		}
+	}
+
+// load complete bucket
+BktSize = (size_t)BktFileSize;
+if(pPars->pBktData == NULL || pPars->AllocBktData < BktSize)
+	{
+	if(pPars->pBktData != NULL)
+		free(pPars->pBktData);
+	if((pPars->pBktData = (UINT8 *)malloc(BktSize))==NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CountBktKMers: unable to allocate %lld bytes for K-mer bucket",(INT64)BktSize);
+		pPars->AllocBktData = 0;
+		return(eBSFerrMem);
+		}
+	pPars->AllocBktData = BktSize;
+	}
+_lseeki64(hBktFile,0,SEEK_SET);
+for(BktOfs = 0; BktOfs < BktSize; BktOfs += NumRead)
+	if((NumRead = read(hBktFile,&pPars->pBktData[BktOfs],(int)min(BktSize - BktOfs,(size_t)0x40000000))) <= 0)
+		break;
+if(BktOfs < BktSize)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CountBktKMers: errors whilst reading K-mer bucket file - %s",strerror(errno));
+	return(eBSFerrFileAccess);
+	}
+
+// expand super K-mers into packed K-mer records
+NumRecs = 0;
+for(BktOfs = 0; BktOfs < BktSize; BktOfs += sizeof(tsSuperKMer) + ((pSuperKMer->NumBases + 3) / 4))
+	{
+	pSuperKMer = (tsSuperKMer *)&pPars->pBktData[BktOfs];
+	NumRecs += pSuperKMer->NumBases - m_SuperKMerSpan + 1;
+	}
+ReqAlloc = (size_t)NumRecs * RecWords * sizeof(UINT64);
+if(pPars->pBktRecs == NULL || pPars->AllocBktRecs < ReqAlloc)
+	{
+	if(pPars->pBktRecs != NULL)
+		free(pPars->pBktRecs);
+	if((pPars->pBktRecs = (UINT64 *)malloc(ReqAlloc))==NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CountBktKMers: unable to allocate %lld bytes for K-mer bucket",(INT64)ReqAlloc);
+		pPars->AllocBktRecs = 0;
+		return(eBSFerrMem);
+		}
+	pPars->AllocBktRecs = ReqAlloc;
+	}
+
+pRec = pPars->pBktRecs;
+for(BktOfs = 0; BktOfs < BktSize; BktOfs += sizeof(tsSuperKMer) + ((pSuperKMer->NumBases + 3) / 4))
+	{
+	pSuperKMer = (tsSuperKMer *)&pPars->pBktData[BktOfs];
+	pPacked = (UINT8 *)pSuperKMer + sizeof(tsSuperKMer);
+	NumBases = pSuperKMer->NumBases;
+	for(Idx = 0; Idx < NumBases; Idx++)
+		Bases[Idx] = (pPacked[Idx / 4] >> (2 * (Idx & 0x03))) & 0x03;
+	for(Idx = 0; Idx <= NumBases - m_SuperKMerSpan; Idx++, pRec += RecWords)
+		{
+		// prefix is canonical if not lexicographically greater than its reverse complement
+		pPrefix = &Bases[Idx];
+		for(Ofs = 0; Ofs < m_PrefixLen; Ofs++)
+			if(pPrefix[Ofs] != eBaseT - pPrefix[m_PrefixLen - 1 - Ofs])
+				break;
+		Orient = (Ofs < m_PrefixLen && pPrefix[Ofs] > eBaseT - pPrefix[m_PrefixLen - 1 - Ofs]) ? 1 : 0;
+		if(Orient)
+			{
+			for(Ofs = 0; Ofs < m_PrefixLen; Ofs++)
+				RevCplPrefix[Ofs] = eBaseT - pPrefix[m_PrefixLen - 1 - Ofs];
+			PackKMerBases(m_PrefixLen,RevCplPrefix,pRec);
+			}
+		else
+			PackKMerBases(m_PrefixLen,pPrefix,pRec);
+		pRec[PrefixWords] = (UINT64)pSuperKMer->CultivarIdx | ((UINT64)Orient << 8) | ((UINT64)(pSuperKMer->Flags & cSuperKMerRevStrand) << 9);
+		if(SuffixWords)
+			PackKMerBases(m_SuffixLen,&pPrefix[m_PrefixLen],&pRec[PrefixWords + 1]);
+		}
+	}
+
+// sort by canonical prefix, prefix orientation and suffix then process each canonical prefix
+qsort(pPars->pBktRecs,(size_t)NumRecs,RecWords * sizeof(UINT64),SortBktKMers);
+pGroup = pPars->pBktRecs;
+GroupStart = 0;
+pRec = pGroup;
+for(RecIdx = 1; RecIdx <= NumRecs; RecIdx++)
+	{
+	pRec += RecWords;
+	if(RecIdx < NumRecs && !memcmp(pRec,pGroup,PrefixWords * sizeof(UINT64)))
+		continue;
+	if((Rslt = CountBktGroup(pPars,RecWords,pGroup,RecIdx - GroupStart)) < eBSFSuccess)
+		return(Rslt);
+	pGroup = pRec;
+	GroupStart = RecIdx;
+	}
+return(eBSFSuccess);
+}
+
+// re-bucket super K-mers in an oversized bucket into sub-bucket files, sub-bucket being (minimizer / Divisor) % NumSubBkts
+// The bucket is streamed in blocks so it is never loaded whole, sub-bucket files are closed on return
+int
+CMarkerKMers::ReBucket(int hBktFile,			// re-bucket super K-mers in this opened oversized bucket file into sub-buckets
+				char *pszBktFile,		// bucket file name, sub-bucket file names are derived from this name
+				INT64 BktSize,			// bucket file size
+				UINT32 Divisor,			// sub-bucket is (minimizer / Divisor) % NumSubBkts
+				int NumSubBkts,			// number of sub-buckets
+				INT64 *pSubBktSizes,	// returned sub-bucket file sizes
+				INT64 *pSubBktKMers)	// returned number of K-mers in each sub-bucket
+{
+int Rslt;
+int Idx;
+int SubIdx;
+int NumRead;
+int BuffLen;
+int BuffOfs;
+int SKSize;
+INT64 BktOfs;
+int *phSubBktFiles;
+UINT32 *pSubBuffLens;
+UINT8 *pSubBuffs;
+UINT8 *pReadBuff;
+UINT8 *pPacked;
+tsSuperKMer *pSuperKMer;
+etSeqBase Bases[cMaxKMerLen];
+char szSubBktFile[_MAX_PATH+64];
+
+phSubBktFiles = NULL;
+pSubBuffLens = NULL;
+pSubBuffs = NULL;
+pReadBuff = NULL;
+if((phSubBktFiles = new int [NumSubBkts])==NULL ||
+	(pSubBuffLens = new UINT32 [NumSubBkts])==NULL ||
+	(pSubBuffs = new UINT8 [(size_t)NumSubBkts * cKMerBucketBuffSize])==NULL ||
+	(pReadBuff = new UINT8 [cKMerBktReadSize])==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReBucket: unable to allocate memory for %d K-mer sub-buckets",NumSubBkts);
+	if(phSubBktFiles != NULL)
+		for(SubIdx = 0; SubIdx < NumSubBkts; SubIdx++)
+			phSubBktFiles[SubIdx] = -1;
+	Rslt = eBSFerrMem;
+	}
+else
+	{
+	Rslt = eBSFSuccess;
+	for(SubIdx = 0; SubIdx < NumSubBkts; SubIdx++)
+		{
+		phSubBktFiles[SubIdx] = -1;
+		pSubBuffLens[SubIdx] = 0;
+		pSubBktSizes[SubIdx] = 0;
+		pSubBktKMers[SubIdx] = 0;
+		}
+	}
+
+// create/truncate sub-bucket files
+for(SubIdx = 0; Rslt >= eBSFSuccess && SubIdx < NumSubBkts; SubIdx++)
+	{
+	sprintf(szSubBktFile,"%s.%d",pszBktFile,SubIdx+1);
+#ifdef _WIN32
+	phSubBktFiles[SubIdx] = open(szSubBktFile,O_CREATETRUNC);
+#else
+	if((phSubBktFiles[SubIdx] = open(szSubBktFile,O_RDWR | O_CREAT,S_IREAD | S_IWRITE))!=-1)
+		if(ftruncate(phSubBktFiles[SubIdx],0)!=0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to truncate %s - %s",szSubBktFile,strerror(errno));
+			Rslt = eBSFerrCreateFile;
+			break;
+			}
+#endif
+	if(phSubBktFiles[SubIdx] < 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to create/truncate K-mer sub-bucket file '%s'",szSubBktFile);
+		Rslt = eBSFerrCreateFile;
+		}
+	}
+
+// stream bucket super K-mers into sub-bucket buffers, appending buffers to sub-bucket files as they fill
+if(Rslt >= eBSFSuccess)
+	_lseeki64(hBktFile,0,SEEK_SET);
+BktOfs = 0;
+BuffLen = 0;
+while(Rslt >= eBSFSuccess && BktOfs < BktSize)
+	{
+	if((NumRead = read(hBktFile,&pReadBuff[BuffLen],(int)min((INT64)(cKMerBktReadSize - BuffLen),BktSize - BktOfs))) <= 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReBucket: errors whilst reading K-mer bucket file - %s",strerror(errno));
+		Rslt = eBSFerrFileAccess;
+		break;
+		}
+	BktOfs += NumRead;
+	BuffLen += NumRead;
+
+	for(BuffOfs = 0; BuffOfs + (int)sizeof(tsSuperKMer) <= BuffLen; BuffOfs += SKSize)
+		{
+		pSuperKMer = (tsSuperKMer *)&pReadBuff[BuffOfs];
+		SKSize = (int)sizeof(tsSuperKMer) + ((pSuperKMer->NumBases + 3) / 4);
+		if(BuffOfs + SKSize > BuffLen)		// super K-mer continues into next block
+			break;
+		pPacked = (UINT8 *)pSuperKMer + sizeof(tsSuperKMer);
+		for(Idx = 0; Idx < m_PrefixLen; Idx++)
+			Bases[Idx] = (pPacked[Idx / 4] >> (2 * (Idx & 0x03))) & 0x03;
+		SubIdx = (int)((SuperKMerMinimizer(Bases) / Divisor) % (UINT32)NumSubBkts);
+		if((pSubBuffLens[SubIdx] + SKSize) > (UINT32)cKMerBucketBuffSize)
+			{
+			if(!CUtility::SafeWrite(phSubBktFiles[SubIdx],&pSubBuffs[(size_t)SubIdx * cKMerBucketBuffSize],pSubBuffLens[SubIdx]))
+				{
+				gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReBucket: errors whilst writing K-mer sub-bucket file - %s",strerror(errno));
+				Rslt = eBSFerrWrite;
+				break;
+				}
+			pSubBuffLens[SubIdx] = 0;
+			}
+		memcpy(&pSubBuffs[((size_t)SubIdx * cKMerBucketBuffSize) + pSubBuffLens[SubIdx]],pSuperKMer,SKSize);
+		pSubBuffLens[SubIdx] += SKSize;
+		pSubBktSizes[SubIdx] += SKSize;
+		pSubBktKMers[SubIdx] += pSuperKMer->NumBases - m_SuperKMerSpan + 1;
+		}
+	if(Rslt < eBSFSuccess)
+		break;
+
+	// retain any partial super K-mer for the next block
+	BuffLen -= BuffOfs;
+	if(BuffLen)
+		{
+		if(BktOfs == BktSize)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReBucket: K-mer bucket file '%s' is truncated",pszBktFile);
+			Rslt = eBSFerrFileAccess;
+			break;
+			}
+		memmove(pReadBuff,&pReadBuff[BuffOfs],BuffLen);
+		}
+	}
+
+// flush remaining buffered super K-mers and close sub-bucket files
+for(SubIdx = 0; phSubBktFiles != NULL && SubIdx < NumSubBkts; SubIdx++)
+	{
+	if(phSubBktFiles[SubIdx] == -1)
+		continue;
+	if(Rslt >= eBSFSuccess && pSubBuffLens[SubIdx] &&
+		!CUtility::SafeWrite(phSubBktFiles[SubIdx],&pSubBuffs[(size_t)SubIdx * cKMerBucketBuffSize],pSubBuffLens[SubIdx]))
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReBucket: errors whilst writing K-mer sub-bucket file - %s",strerror(errno));
+		Rslt = eBSFerrWrite;
+		}
+	close(phSubBktFiles[SubIdx]);
+	}
+
+if(phSubBktFiles != NULL)
+	delete [] phSubBktFiles;
+if(pSubBuffLens != NULL)
+	delete [] pSubBuffLens;
+if(pSubBuffs != NULL)
+	delete [] pSubBuffs;
+if(pReadBuff != NULL)
+	delete [] pReadBuff;
+return(Rslt);
+}
+
+// returns number of bits set in cultivar bitmask
+static inline int
+NumCultivarBits(UINT64 *pCultivars)
+{
+int Idx;
+int NumBits;
+UINT64 Bits;
+NumBits = 0;
+for(Idx = 0; Idx < (cMaxCultivars + 63) / 64; Idx++)
+	for(Bits = pCultivars[Idx]; Bits; Bits &= Bits - 1)
+		NumBits += 1;
+return(NumBits);
+}
+
+// process all K-mers sharing the same canonical prefix, reporting prefixes in either orientation which meet the minimum cultivars and homozygotic
+// suffix requirements back to MarkersCallback
+int
+CMarkerKMers::CountBktGroup(tsKMerBktThreadPars *pPars,	// process all K-mers sharing same canonical prefix
+				int RecWords,			// each K-mer record is this many UINT64 words
+				UINT64 *pGroup,			// first K-mer record in group
+				INT64 NumRecs)			// number of K-mer records in group
+{
+int Rslt;
+int Idx;
+int PrefixWords;
+int Orient;
+int CultivarIdx;
+bool bPalindrome;
+INT64 RecIdx;
+INT64 NumOrient[2];
+INT64 SenseCnts[2];
+UINT64 Cultivars[2][(cMaxCultivars + 63) / 64];
+UINT64 HomoCultivars[(cMaxCultivars + 63) / 64];
+UINT64 MarkerCultivars[(cMaxCultivars + 63) / 64];
+UINT64 *pRec;
+UINT64 *pOrient[2];
+UINT64 *pSuffixStart;
+UINT64 Meta;
+int MaxHomozygotic;
+etSeqBase Prefix[cMaxKMerLen];
+
+PrefixWords = (m_PrefixLen + 31) / 32;
+memset(Cultivars,0,sizeof(Cultivars));
+NumOrient[0] = NumOrient[1] = 0;
+SenseCnts[0] = SenseCnts[1] = 0;
+pOrient[0] = pOrient[1] = NULL;
+pRec = pGroup;
+for(RecIdx = 0; RecIdx < NumRecs; RecIdx++, pRec += RecWords)
+	{
+	Meta = pRec[PrefixWords];
+	Orient = (int)((Meta >> 8) & 0x01);
+	if(pOrient[Orient] == NULL)
+		pOrient[Orient] = pRec;
+	NumOrient[Orient] += 1;
+	if(Meta & ((UINT64)cSuperKMerRevStrand << 9))		// reverse strand K-mers only contribute to homozygotic suffix checks
+		continue;
+	CultivarIdx = (int)(Meta & 0x0ff);
+	Cultivars[Orient][CultivarIdx / 64] |= (UINT64)1 << (CultivarIdx % 64);
+	SenseCnts[Orient] += 1;
+	}
+
+// unpack canonical prefix and check if palindromic
+for(Idx = 0; Idx < m_PrefixLen; Idx++)
+	Prefix[Idx] = (etSeqBase)((pGroup[Idx / 32] >> (2 * (31 - (Idx % 32)))) & 0x03);
+for(Idx = 0; Idx < m_PrefixLen; Idx++)
+	if(Prefix[Idx] != eBaseT - Prefix[m_PrefixLen - 1 - Idx])
+		break;
+bPalindrome = Idx == m_PrefixLen ? true : false;
+
+for(Orient = 0; Orient < 2; Orient++)
+	{
+	if(SenseCnts[Orient] == 0)		// prefix must be present on the sense strand
+		continue;
+
+	// if checking homozygotic suffixes then number of cultivars sharing any prefix + suffix is limited
+	if(m_bHomozygotic)
+		{
+		MaxHomozygotic = 0;
+		pSuffixStart = pOrient[Orient];
+		pRec = pSuffixStart;
+		memset(HomoCultivars,0,sizeof(HomoCultivars));
+		for(RecIdx = 0; RecIdx <= NumOrient[Orient]; RecIdx++, pRec += RecWords)
+			{
+			if(RecIdx == NumOrient[Orient] || memcmp(&pRec[PrefixWords + 1],&pSuffixStart[PrefixWords + 1],(RecWords - PrefixWords - 1) * sizeof(UINT64)))
+				{
+				if((Idx = NumCultivarBits(HomoCultivars)) > MaxHomozygotic)
+					MaxHomozygotic = Idx;
+				if(RecIdx == NumOrient[Orient])
+					break;
+				memset(HomoCultivars,0,sizeof(HomoCultivars));
+				pSuffixStart = pRec;
+				}
+			CultivarIdx = (int)(pRec[PrefixWords] & 0x0ff);
+			HomoCultivars[CultivarIdx / 64] |= (UINT64)1 << (CultivarIdx % 64);
+			}
+		if(MaxHomozygotic > m_MaxHomozygotic)
+			continue;
+		}
+
+	memcpy(MarkerCultivars,Cultivars[Orient],sizeof(MarkerCultivars));
+	pPars->KMerCultsCnts.SenseCnts = SenseCnts[Orient];
+	pPars->KMerCultsCnts.AntisenseCnts = 0;
+	if(m_PMode != ePMNSenseKMers)
+		{
+		if(bPalindrome)
+			pPars->KMerCultsCnts.AntisenseCnts = SenseCnts[Orient];
+		else
+			{
+			pPars->KMerCultsCnts.AntisenseCnts = SenseCnts[Orient ^ 1];
+			for(Idx = 0; Idx < (cMaxCultivars + 63) / 64; Idx++)
+				MarkerCultivars[Idx] |= Cultivars[Orient ^ 1][Idx];
+			}
+		}
+	pPars->KMerCultsCnts.NumCultivars = NumCultivarBits(MarkerCultivars);
+	if(pPars->KMerCultsCnts.NumCultivars < (UINT32)m_MinWithPrefix)
+		continue;
+
+	// only the prefix sequence and totals are used by MarkersCallback, per cultivar counts are not populated
+	if(Orient == 0)
+		memcpy(pPars->KMerCultsCnts.KMerSeq,Prefix,m_PrefixLen);
+	else
+		for(Idx = 0; Idx < m_PrefixLen; Idx++)
+			pPars->KMerCultsCnts.KMerSeq[Idx] = eBaseT - Prefix[m_PrefixLen - 1 - Idx];
+	pPars->KMerCultsCnts.KMerSeq[m_PrefixLen] = eBaseEOS;
+	if((Rslt = MarkersCallback(this,&pPars->KMerCultsCnts)) < 0)
+		return(Rslt);
+	}
+return(eBSFSuccess);
+}
+
+// SortBktKMers
+// Sort bucket K-mers ascending by canonical prefix, prefix orientation and then suffix
+int
+CMarkerKMers::SortBktKMers(const void *arg1, const void *arg2)
+{
+int Idx;
+UINT64 *pEl1 = (UINT64 *)arg1;
+UINT64 *pEl2 = (UINT64 *)arg2;
+for(Idx = 0; Idx < gBktPrefixWords; Idx++,pEl1++,pEl2++)
+	if(*pEl1 != *pEl2)
+		return(*pEl1 < *pEl2 ? -1 : 1);
+if((*pEl1 & 0x0100) != (*pEl2 & 0x0100))
+	return((*pEl1 & 0x0100) < (*pEl2 & 0x0100) ? -1 : 1);
+pEl1++;
+pEl2++;
+for(Idx = 0; Idx < gBktSuffixWords; Idx++,pEl1++,pEl2++)
+	if(*pEl1 != *pEl2)
+		return(*pEl1 < *pEl2 ? -1 : 1);
+return(0);
+}
+
 // check for overlaps, by m_PrefixLen-1 bases, of one potential prefix marker onto any other potential prefix marker
 bool													// true if overlapping onto at least one other prefix marker
 CMarkerKMers::IsMarkerOverlapping(tsPutMarker *pMarker)	// marker to check if overlapping onto any other sequence
@@ -16,6 +16,23 @@ const int cMaxWorkerThreads = 128;			// limiting max number of threads to this m
 const int cMarkerSeqBuffSize = 0x0fffff;	// marker sequence buffering used to hold markers prior to writing out to file
 const int cAllocNumPutativeSeqs = 0x0fffff;	// allocate for this many putative marker sequences, and realloc in this many increments as may be required
 
+// partitioned K-mer counting, used when K-mers are counted directly from cultivar pseudo-chromosome sequences instead of from a suffix array
+const int cMaxKMerInSeqFiles = 200;			// at most this many cultivar sequence files after wildcard expansion
+const int cKMerMinimizerLen = 12;			// K-mers are partitioned into buckets by the canonical minimizer, of this length, of their prefix
+const int cMinKMerBuckets = 16;				// partition into at least this many buckets
+const INT64 cKMerBucketTargMem = 0x10000000;	// number of buckets chosen so that expanded bucket K-mers are expected to need no more than this much memory per counting thread
+const INT64 cKMerBucketMaxMem = 0x40000000;	// buckets whose expanded K-mers would need more than this much memory are re-bucketed instead of being loaded whole
+const int cKMerBucketBuffSize = 0x08000;	// each partitioning thread buffers this many bytes per bucket before appending to bucket file
+const INT64 cKMerBktBuffMem = 0x10000000;	// number of buckets limited so that each partitioning thread buffers no more than this many bytes over all buckets
+const int cKMerBktRsvdFiles = 64;			// number of buckets also limited by process open file limit less this many files reserved for other uses
+const int cMaxKMerSubBkts = 64;				// oversized buckets are re-bucketed into at most this many sub-buckets, each a separate temporary file
+const int cMaxKMerReBktDepth = 4;			// sub-buckets are themselves re-bucketed to at most this depth
+const int cKMerBktReadSize = 0x0100000;		// oversized buckets are read in blocks of this many bytes when re-bucketing
+const int cKMerSeqChunkSize = 0x0400000;	// partitioning threads process cultivar sequences in chunks of this many bases
+const int cMaxSuperKMerLen = 0x0fff;		// runs of K-mers sharing the same minimizer are written to buckets as sequences of at most this many bases
+
+const UINT8 cSuperKMerRevStrand = 0x01;		// super K-mer is from the reverse complement strand, only used when checking for homozygotic suffixes
+
 const UINT8 cMarkerDupFlg = 0x01;			// marker prefix sequence is a duplicate
 const UINT8 cMarkerOvlFlg = 0x02;			// marker prefix sequence overlaps onto another prefix sequence
 const UINT8 cMarkerAntiFlg = 0x04;			// marker prefix sequence is antisense to another prefix sequence
@@ -60,6 +77,38 @@ typedef struct TAG_sKMerThreadPars {
 	INT64 EndSfxIdx;				// thread to process until this suffix index inclusive
 	int Rslt;						// returned result code
 } tsKMerThreadPars;
+
+typedef struct TAG_sSuperKMer {
+	UINT8 CultivarIdx;				// K-mers are from this cultivar (0..N-1)
+	UINT8 Flags;					// cSuperKMerRevStrand if from reverse complement strand
+	UINT16 NumBases;				// number of bases, packed 4 per byte, immediately following this header
+} tsSuperKMer;
+
+typedef struct TAG_sKMerBktThreadPars {
+	int ThreadIdx;					// uniquely identifies this thread
+	#ifdef _WIN32
+	HANDLE threadHandle;			// handle as returned by _beginthreadex()
+	unsigned int threadID;			// identifier as set by _beginthreadex()
+#else
+	int threadRslt;					// result as returned by pthread_create ()
+	pthread_t threadID;				// identifier as set by pthread_create ()
+#endif
+	class CMarkerKMers *pThis;		// class instance
+	bool bCountPhase;				// false if partitioning sequences into buckets, true if counting K-mers in buckets
+	int Rslt;						// returned result code
+	int AllocSeqChunk;				// pSeqChunk and pRevCplChunk allocated to hold this many bases
+	etSeqBase *pSeqChunk;			// partitioning - chunk of cultivar sequence
+	etSeqBase *pRevCplChunk;		// partitioning - reverse complement of pSeqChunk
+	UINT32 *pMinimizers;			// partitioning - hashed canonical minimizers at each chunk base
+	UINT8 *pBktBuffs;				// partitioning - per bucket buffering of super K-mers
+	UINT32 *pBktBuffLens;			// partitioning - number of bytes currently buffered for each bucket
+	UINT32 *pBktBuffKMers;			// partitioning - number of K-mers currently buffered for each bucket
+	size_t AllocBktData;			// counting - pBktData allocated to hold this many bytes
+	UINT8 *pBktData;				// counting - bucket super K-mers
+	size_t AllocBktRecs;			// counting - pBktRecs allocated to hold this many bytes
+	UINT64 *pBktRecs;				// counting - packed K-mers expanded from bucket super K-mers
+	tsKMerCultsCnts KMerCultsCnts;	// counting - K-mer counts returned to MarkersCallback()
+} tsKMerBktThreadPars;
 #pragma pack()
 
 class CMarkerKMers
@@ -77,6 +126,24 @@ class CMarkerKMers
 	int m_MaxHomozygotic;			// only report prefixes if K-Mer suffixes are homozygotic between a maximum of this many cultivars, if 0 then no homozygotic check
 	int m_NumThreads;				// number of worker threads requested
 
+	// partitioned K-mer counting
+	int m_NumInSeqFiles;			// number of cultivar sequence files
+	char *m_pszInSeqFiles[cMaxKMerInSeqFiles];	// cultivar sequence files, each fasta entry is a cultivar pseudo-chromosome
+	int m_CurInSeqFileIdx;			// currently loading sequences from this file
+	CFasta *m_pInSeqFasta;			// currently opened cultivar sequence file
+	int m_CurCultivarIdx;			// currently loading sequences for this cultivar, -1 if none
+	int m_ChunkTailLen;				// number of bases from end of last chunk to be prepended to the next chunk from same cultivar
+	etSeqBase m_ChunkTail[cTotCultivarKMerLen];	// bases from end of last chunk
+	bool m_bHomozygotic;			// true if checking for homozygotic suffixes, super K-mers then contain prefix + suffix
+	bool m_bRevCplStrand;			// true if super K-mers also to be partitioned from reverse complement strand 
+	int m_SuperKMerSpan;			// bases per K-mer in super K-mers, m_PrefixLen or m_KMerLen if m_bHomozygotic
+	int m_NumKMerBuckets;			// number of buckets
+	int *m_pKMerBktFiles;			// bucket file handles
+	INT64 *m_pKMerBktSizes;			// bucket file sizes
+	INT64 *m_pKMerBktKMers;			// number of K-mers in each bucket
+	int m_NxtKMerBkt;				// next bucket to be counted
+	INT64 m_NumBktKMers;			// total number of K-mers partitioned into buckets
+
 	UINT32 m_NumPrefixKMers;		// current total number of accepted unique prefixed KMers
 	INT64 m_TotSenseCnts;			// current total number of accepted KMers on sense strand
 	INT64 m_TotAntisenseCnts;		// current total number of accepted KMers on antisense strand
@@ -101,6 +168,55 @@ class CMarkerKMers
 
 	int LocateSharedPrefixKMers(tsKMerThreadPars *pPars); // locate K-mers with shared prefixes 
 
+	int LoadSfxCultivars(char *pszSfxPseudoGenome);	// open and load suffix array with cultivar pseudo-chromosomes
+
+	int GenSfxPrefixKMers(void);			// locate prefix K-mers by iterating over suffix array
+
+	int GenBktPrefixKMers(void);			// locate prefix K-mers by partitioning sequences into buckets and then counting bucket K-mers
+
+	int									// returned number of bases in chunk, 0 if no more sequences, < 0 if errors
+		GetSeqChunk(int MaxLen,			// return at most this many bases
+				etSeqBase *pSeqChunk,	// into this buffer
+				int *pCultivarIdx);		// bases are from this cultivar
+
+	int PartitionKMers(tsKMerBktThreadPars *pPars);		// partition K-mers in sequence chunks into buckets
+
+	int PartitionChunk(tsKMerBktThreadPars *pPars,	// partition K-mers in this chunk into buckets
+				int CultivarIdx,		// chunk is from this cultivar
+				UINT8 Flags,			// cSuperKMerRevStrand if from reverse complement strand
+				int ChunkLen,			// chunk contains this many bases
+				etSeqBase *pChunk);		// chunk bases
+
+	int FlushBktBuff(tsKMerBktThreadPars *pPars,	// append buffered super K-mers to bucket file
+				int BktIdx);			// bucket
+
+	int CountBktKMers(tsKMerBktThreadPars *pPars);		// count K-mers in buckets
+
+	int CountBktFile(tsKMerBktThreadPars *pPars,	// count K-mers in a bucket or sub-bucket file, re-bucketing if oversized
+				int hBktFile,			// opened bucket file
+				char *pszBktFile,		// bucket file name, sub-bucket file names are derived from this name
+				INT64 BktFileSize,		// bucket file size
+				INT64 BktKMers,			// number of K-mers in bucket
+				UINT32 Divisor,			// all minimizers in this bucket share the same value modulo this divisor
+				int Depth);				// re-bucketing depth, 0 if a top level bucket
+
+	int ReBucket(int hBktFile,			// re-bucket super K-mers in this opened oversized bucket file into sub-buckets
+				char *pszBktFile,		// bucket file name, sub-bucket file names are derived from this name
+				INT64 BktSize,			// bucket file size
+				UINT32 Divisor,			// sub-bucket is (minimizer / Divisor) % NumSubBkts
+				int NumSubBkts,			// number of sub-buckets
+				INT64 *pSubBktSizes,	// returned sub-bucket file sizes
+				INT64 *pSubBktKMers);	// returned number of K-mers in each sub-bucket
+
+	UINT32 SuperKMerMinimizer(etSeqBase *pBases);	// returns hashed canonical minimizer of the first K-mer prefix in super K-mer bases
+
+	int CountBktGroup(tsKMerBktThreadPars *pPars,	// process all K-mers sharing same canonical prefix
+				int RecWords,			// each K-mer record is this many UINT64 words
+				UINT64 *pGroup,			// first K-mer record in group
+				INT64 NumRecs);			// number of K-mer records in group
+
+	void DeleteKMerBkts(void);			// close and remove any bucket files
+
 	int LocateSharedUniqueKMers(tsKMerThreadPars *pPars);	// locate all unique K-mers of specified length which are common to all cultivars
 
 	bool											// true if overlapping by m_PrefixLen-1 onto at least one other prefix marker
@@ -122,10 +238,12 @@ class CMarkerKMers
 	SRWLOCK m_hRwLock;
 	CRITICAL_SECTION m_hSCritSect;
 	static unsigned int __stdcall KMerThreadStart(void *args);
+	static unsigned int __stdcall KMerBktThreadStart(void *args);
 #else
 	pthread_rwlock_t m_hRwLock;
 	pthread_spinlock_t m_hSpinLock;
 	static void * KMerThreadStart(void *args);
+	static void * KMerBktThreadStart(void *args);
 #endif
 
 	void AcquireLock(bool bExclusive);
@@ -139,6 +257,7 @@ class CMarkerKMers
 
 	static int SortPutativeSeqs(const void *arg1, const void *arg2);			// used when sorting putative marker sequences
 	static int SortNumCultivarsCnts(const void *arg1, const void *arg2);		// used when sorting putative markers by NumCultivars and sense/antisense counts
+	static int SortBktKMers(const void *arg1, const void *arg2);				// used when sorting bucket K-mers by canonical prefix, prefix orientation and suffix
 
 public:
 	CMarkerKMers(void);
@@ -158,7 +277,9 @@ public:
 		  int SuffixLen,				// cultivar specific suffix length
 		  int MinWithPrefix,			// minimum number of cultivars required to have the shared prefix
 		  int MaxHomozygotic,			// only report prefixes if K-Mer suffixes are homozygotic between a maximum of this many cultivars, if 0 then no homozygotic check
-		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar
+		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar, NULL if K-mers to be partitioned from pszInSeqFiles
+		  int NumInSeqFiles,			// number of cultivar sequence file specs, wildcards allowed, used if pszSfxPseudoGenome is NULL
+		  char *pszInSeqFiles[],		// cultivar sequence files, each fasta entry is a cultivar pseudo-chromosome
 		  char *pszMarkerFile,			// output potential markers to this file
 		  int NumThreads);				// max number of threads allowed
 };
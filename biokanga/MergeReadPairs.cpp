@@ -568,6 +568,13 @@ CMergeReadPairs::InitDfltWells(bool bNoMerge) // initialise with default well ba
 {
 tsAmpliconWell *pWell;
 int WellIdx;
+char szOutPrefix[_MAX_PATH];
+
+// if output is to be compressed then the '.gz' extension is moved to the end of each well file name
+strcpy(szOutPrefix,m_szMergeOutFile);
+if(m_bgzOut)
+	szOutPrefix[strlen(szOutPrefix) - 3] = '\0';
+
 m_MaxBarcode5Len = 6;		// maximun length of any 5' barcode - max 16
 m_MaxBarcode3Len = 6;		// maximun length of any 3' barcode - max 16
 m_NumBarcodes = NumBarcodes;	// number of barcodes in m_pBarcodes[]
@@ -579,13 +586,13 @@ for(WellIdx = 0; WellIdx < NumPlateWells; WellIdx++,pWell++)
 	{
 	if(bNoMerge)
 		{
-		sprintf(pWell->WellFile[1].szOutFile, "%s.Well%d.PE2.%s", m_szMergeOutFile, WellIdx + 1, m_OFormat == eOFfasta ? "fasta" : "fastq");
+		sprintf(pWell->WellFile[1].szOutFile, "%s.Well%d.PE2.%s%s", szOutPrefix, WellIdx + 1, m_OFormat == eOFfasta ? "fasta" : "fastq", m_bgzOut ? ".gz" : "");
 		if ((pWell->WellFile[1].pOutBuffer = new char[cAllocOutBuffLen]) == NULL)
 			return(eBSFerrMem);
 		pWell->WellFile[1].AllocdOutBuff = cAllocOutBuffLen;
 		}
 
-	sprintf(pWell->WellFile[0].szOutFile,"%s.Well%d.%s.%s",m_szMergeOutFile,WellIdx+1, bNoMerge == true ? "PE1" : "SE",m_OFormat == eOFfasta ? "fasta" : "fastq");
+	sprintf(pWell->WellFile[0].szOutFile,"%s.Well%d.%s.%s%s",szOutPrefix,WellIdx+1, bNoMerge == true ? "PE1" : "SE",m_OFormat == eOFfasta ? "fasta" : "fastq", m_bgzOut ? ".gz" : "");
 	pWell->WellFile[0].hOutFile = -1;
 	pWell->WellFile[1].hOutFile = -1;
 	if((pWell->WellFile[0].pOutBuffer = new char [cAllocOutBuffLen]) == NULL)
@@ -608,6 +615,9 @@ m_hOutMerged = -1;
 m_hOut5Unmerged = -1;
 m_hOut3Unmerged = -1;
 m_ProcPhase = ePPUninit;
+m_pBatches = NULL;
+m_NumBatches = 0;
+m_CASSerialise = 0;
 m_NumWells = 0;
 memset(m_WellFiles,0,sizeof(m_WellFiles));
 for(int WellIdx = 0; WellIdx < m_NumWells; WellIdx++)
@@ -729,6 +739,11 @@ if(m_ProcPhase != ePPUninit)
 		}
 	}
 
+FreeBatches();
+m_NumThreads = 1;
+m_bgzOut = false;
+m_StartNum = 1;
+
 memset(m_WellFiles,0,sizeof(m_WellFiles));
 pWell = m_WellFiles;
 for(WellIdx = 0; WellIdx < cMaxNumBarcodes; WellIdx++,pWell++)
@@ -1009,16 +1024,18 @@ CMergeReadPairs::MergeOverlaps(etPMode PMode,	// processing mode
 			  char **pszInPE3Files,				// input 3' end if paired end reads files
 			  char *pszMergeOutFile,			// write merged overlaping reads to this file
   			  int StartNum,						// use this initial starting sequence identifier
-  			  bool bAppendOut)				// if true then append if output files exist, otherwise trunctate existing output files
-
+  			  bool bAppendOut,				// if true then append if output files exist, otherwise trunctate existing output files
+			  int NumThreads)				// use this many worker threads for overlap and barcode processing
 {
 int Rslt;
 int Idx;
+int OutFileLen;
 
 if(MinOverlap < 1 ||					// must be at least a 1 base overlap required!
    MaxOverlapPropSubs < 0 ||			// must be reasonable number of allowed substitutions in overlap
    NumInPE5Files < 1 || NumInPE3Files < 0 ||
-   NumInPE5Files != NumInPE3Files)
+   NumInPE5Files != NumInPE3Files ||
+   NumThreads < 1 || NumThreads > cMaxMergeThreads)
    	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"MergeOverlaps: inconsistency in function parameters");
 	return(eBSFerrParams);
@@ -1034,6 +1051,11 @@ m_MinOverlap = MinOverlap;
 m_MaxOverlapPropSubs = MaxOverlapPropSubs;
 strncpy(m_szMergeOutFile,pszMergeOutFile,_MAX_PATH);
 m_szMergeOutFile[_MAX_PATH-1] = '\0';
+m_NumThreads = NumThreads;
+
+// if output file name has extension '.gz' then all output files will be gzip compressed
+OutFileLen = (int)strlen(m_szMergeOutFile);
+m_bgzOut = OutFileLen > 3 && !stricmp(&m_szMergeOutFile[OutFileLen-3],".gz");
 
 if(m_PMode >= ePMAmplicon)
 	{
@@ -1047,9 +1069,14 @@ if(m_PMode >= ePMAmplicon)
 if(PMode == ePMseparate)
 	{
 	strncpy(m_sz5UnmergedOutFile,m_szMergeOutFile,_MAX_PATH-20);
-	strcat(m_sz5UnmergedOutFile,".UPE1");
 	strncpy(m_sz3UnmergedOutFile,m_szMergeOutFile,_MAX_PATH-20);
-	strcat(m_sz3UnmergedOutFile,".UPE2");
+	if(m_bgzOut)
+		{
+		m_sz5UnmergedOutFile[OutFileLen-3] = '\0';
+		m_sz3UnmergedOutFile[OutFileLen-3] = '\0';
+		}
+	strcat(m_sz5UnmergedOutFile,m_bgzOut ? ".UPE1.gz" : ".UPE1");
+	strcat(m_sz3UnmergedOutFile,m_bgzOut ? ".UPE2.gz" : ".UPE2");
 	}
 else
 	{
@@ -1149,308 +1176,547 @@ Reset(true);
 return((int)Rslt);
 }
 
-const int cMinReadSeqLen = 20;			// raw read sequences must be at least this length
-const int cMaxReadDesrLen = 200;		// allow for read descriptors of no longer than this length
-const int ccMaxFastQSeqLen = 4000;		// allow for amplicon PE sequences of this length
-
-int													// returns number of sequences merged and written to output file
-CMergeReadPairs::ProcOverlapPairs(int StartNum)		// initial starting sequence identifier
+#ifdef _WIN32
+unsigned __stdcall MergeParseThread(void * pThreadPars)
+#else
+void *MergeParseThread(void * pThreadPars)
+#endif
 {
 int Rslt;
-int Idx;
-
-int WellIdx;
+tsMergeThreadPars *pPars = (tsMergeThreadPars *)pThreadPars;			// makes it easier not having to deal with casts!
+CMergeReadPairs *pMergeReadPairs = (CMergeReadPairs *)pPars->pThis;
 
-UINT8 PE5Seq[ccMaxFastQSeqLen+1];
-UINT8 PE5Qual[ccMaxFastQSeqLen+1];
-UINT8 PE3Seq[ccMaxFastQSeqLen+1];
-UINT8 PE3Qual[ccMaxFastQSeqLen+1];
-char szPE5DescrBuff[cMaxReadDesrLen+1];
-char szPE3DescrBuff[cMaxReadDesrLen+1];
-UINT8 MSeq[(2*ccMaxFastQSeqLen)+1];
-UINT8 szMSeq[(2*ccMaxFastQSeqLen)+1];
-UINT8 szMQual[(2*ccMaxFastQSeqLen)+1];
-int PlateCell;
+Rslt = pMergeReadPairs->ThreadParse(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
 
-UINT64 Spacer1 = 0;
-int PE5DescrLen;
-int PE3DescrLen;
+#ifdef _WIN32
+unsigned __stdcall MergeProcThread(void * pThreadPars)
+#else
+void *MergeProcThread(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsMergeThreadPars *pPars = (tsMergeThreadPars *)pThreadPars;			// makes it easier not having to deal with casts!
+CMergeReadPairs *pMergeReadPairs = (CMergeReadPairs *)pPars->pThis;
 
-int NumPE5Reads;
-int NumPE3Reads;
-int MinObsOverlap;
-int MaxObsOverlap;
+Rslt = pMergeReadPairs->ThreadProc(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
 
-int OverlapDistCnts[ccMaxFastQSeqLen];
-int OverlapDistSubs[cMaxOverlapPercSubs+1];
+void
+CMergeReadPairs::AcquireSerialise(void)
+{
+int SpinCnt = 1000;
+int BackoffMS = 1;
 
-int MergeIdx;
-UINT8 *pMSeq;
-UINT8 *pMSeqQual;
-UINT8 *pSeq5Qual;
-UINT8 *pSeq3Qual;
-etSeqBase *pSeq5;
-etSeqBase *pSeq3;
-etSeqBase Base5;
-etSeqBase Base3;
-int OL5Idx;
-int OL3Idx;
-int MaxOverlap;
-int OLStartsIdx;
-int ReqOverlap3;
-int MaxSubs;
-int CurSubs;
-int CurOvlpScore;
-int BestOvlpScore;
-int AllowedSubs;
+#ifdef _WIN32
+while(InterlockedCompareExchange(&m_CASSerialise,1,0)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 50)
+		BackoffMS += 1;
+	}
+#else
+while(__sync_val_compare_and_swap(&m_CASSerialise,0,1)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 50)
+		BackoffMS += 1;
+	}
+#endif
+}
 
-int NumOverlapping;
-int NumUnmapped;
-int NumPENoBarcode;
-int NumPEWithBarcode;
-int PE5SeqLen;
-int PE3SeqLen;
-int PE5QualLen;
-int PE3QualLen;
+void
+CMergeReadPairs::ReleaseSerialise(void)
+{
+#ifdef _WIN32
+InterlockedCompareExchange(&m_CASSerialise,0,1);
+#else
+__sync_val_compare_and_swap(&m_CASSerialise,1,0);
+#endif
+}
 
+int
+CMergeReadPairs::AllocBatches(int NumBatches)	// allocate pipeline batches
+{
+int BatchIdx;
+tsMergeBatch *pBatch;
 
-if(m_hOutMerged != -1 && m_pszMSeqs == NULL)
+FreeBatches();
+if((m_pBatches = new tsMergeBatch [NumBatches]) == NULL)
 	{
-	if((m_pszMSeqs = new char [cAllocOutBuffLen])==NULL)
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocBatches: unable to allocate memory for %d pipeline batches",NumBatches);
+	return(eBSFerrMem);
+	}
+memset(m_pBatches,0,sizeof(tsMergeBatch) * NumBatches);
+m_NumBatches = NumBatches;
+pBatch = m_pBatches;
+for(BatchIdx = 0; BatchIdx < NumBatches; BatchIdx++, pBatch++)
+	{
+	pBatch->State = eMBSfree;
+	pBatch->NumOutBuffs = eMODWells + (2 * m_NumWells);
+	if((pBatch->pPairs = new tsMergePair [cMergeBatchPairs]) == NULL ||
+		(pBatch->pInBuff = new UINT8 [cMergeBatchBuffSize]) == NULL ||
+		(pBatch->pRsltBuff = new UINT8 [2 * cMergeBatchBuffSize]) == NULL ||
+		(pBatch->pOutBuffs = new tsMergeOutBuff [pBatch->NumOutBuffs]) == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to allocate memory (%d) for buffering file writes",cAllocOutBuffLen);
-		Reset(false);
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AllocBatches: unable to allocate memory for %d pipeline batches",NumBatches);
+		FreeBatches();
 		return(eBSFerrMem);
 		}
-	m_AllocdMSeqs = cAllocOutBuffLen;
-	m_CurMSeqLen = 0;
+	memset(pBatch->pOutBuffs,0,sizeof(tsMergeOutBuff) * pBatch->NumOutBuffs);
 	}
+return(eBSFSuccess);
+}
 
-if(m_PMode == ePMseparate)
+void
+CMergeReadPairs::FreeBatches(void)				// free pipeline batches
+{
+int BatchIdx;
+int BuffIdx;
+tsMergeBatch *pBatch;
+tsMergeOutBuff *pOutBuff;
+
+if(m_pBatches != NULL)
 	{
-	if(m_hOut5Unmerged != -1 && m_pszUnmergedP1Seqs == NULL)
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++, pBatch++)
 		{
-		if((m_pszUnmergedP1Seqs = new char [cAllocOutBuffLen])==NULL)
+		if(pBatch->pPairs != NULL)
+			delete []pBatch->pPairs;
+		if(pBatch->pInBuff != NULL)
+			delete []pBatch->pInBuff;
+		if(pBatch->pRsltBuff != NULL)
+			delete []pBatch->pRsltBuff;
+		if(pBatch->pOutBuffs != NULL)
 			{
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to allocate memory (%d) for buffering file writes",cAllocOutBuffLen);
-			Reset(false);
-			return(eBSFerrMem);
+			pOutBuff = pBatch->pOutBuffs;
+			for(BuffIdx = 0; BuffIdx < pBatch->NumOutBuffs; BuffIdx++, pOutBuff++)
+				{
+				if(pOutBuff->pBuff != NULL)
+					free(pOutBuff->pBuff);
+				if(pOutBuff->pgzBuff != NULL)
+					free(pOutBuff->pgzBuff);
+				}
+			delete []pBatch->pOutBuffs;
 			}
-		m_AllocdUnmergedP1Seqs = cAllocOutBuffLen;
-		m_CurUnmergedP1Seqs = 0;
 		}
+	delete []m_pBatches;
+	m_pBatches = NULL;
+	}
+m_NumBatches = 0;
+}
 
-	if(m_hOut3Unmerged != -1 && m_pszUnmergedP2Seqs == NULL)
-		{
-		if((m_pszUnmergedP2Seqs = new char [cAllocOutBuffLen])==NULL)
-			{
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to allocate memory (%d) for buffering file writes",cAllocOutBuffLen);
-			Reset(false);
-			return(eBSFerrMem);
-			}
-		m_AllocdUnmergedP2Seqs = cAllocOutBuffLen;
-		m_CurUnmergedP2Seqs = 0;
-		}
+int									// returns eBSFSuccess if batch output buffer has at least ReqLen chars available
+CMergeReadPairs::ReqOutBuff(tsMergeOutBuff *pOutBuff, // output buffer
+					size_t ReqLen)			// requires this many available chars
+{
+size_t ReallocLen;
+char *pRealloc;
+
+if(pOutBuff->pBuff != NULL && (pOutBuff->CurLen + ReqLen) <= pOutBuff->AllocdLen)
+	return(eBSFSuccess);
+
+ReallocLen = max((size_t)cMergeOutBuffAlloc, (pOutBuff->CurLen + ReqLen) * 2);
+if((pRealloc = (char *)realloc(pOutBuff->pBuff,ReallocLen)) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReqOutBuff: unable to realloc memory (%zd) for output buffering",ReallocLen);
+	return(eBSFerrMem);
 	}
+pOutBuff->pBuff = pRealloc;
+pOutBuff->AllocdLen = ReallocLen;
+return(eBSFSuccess);
+}
 
-m_ProcPhase = ePRdyProc;
+// CompressOutBuff
+// Compress output buffer as a self contained gzip member; output files are then the concatenation of members in batch order
+// which gzip and zlib gzread() process as a single stream
+int
+CMergeReadPairs::CompressOutBuff(tsMergeOutBuff *pOutBuff)
+{
+int Rslt;
+size_t ReqLen;
+UINT8 *pRealloc;
+z_stream zStrm;
 
-memset(OverlapDistCnts,0,sizeof(OverlapDistCnts));
-memset(OverlapDistSubs,0,sizeof(OverlapDistSubs));
-NumPE5Reads = 0;
-NumPE3Reads = 0;
-NumOverlapping = 0;
-MinObsOverlap = -1;
-MaxObsOverlap = -1;
-NumUnmapped = 0;
-NumPENoBarcode = 0;
-NumPEWithBarcode = 0;
-time_t Started = time(0);
-while((Rslt = (teBSFrsltCodes)(PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxFastQSeqLen,true,false))) > eBSFSuccess)
+pOutBuff->CurgzLen = 0;
+if(pOutBuff->CurLen == 0)
+	return(eBSFSuccess);
+
+memset(&zStrm,0,sizeof(zStrm));
+if(deflateInit2(&zStrm,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15 + 16,8,Z_DEFAULT_STRATEGY) != Z_OK)	// 15 + 16 for gzip wrapper
 	{
-	if(!(NumPE5Reads % 10000) && NumPE5Reads > 0)
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CompressOutBuff: unable to initialise for compression");
+	return(eBSFerrInternal);
+	}
+ReqLen = (size_t)deflateBound(&zStrm,(uLong)pOutBuff->CurLen);
+if(pOutBuff->pgzBuff == NULL || ReqLen > pOutBuff->AllocdgzLen)
+	{
+	if((pRealloc = (UINT8 *)realloc(pOutBuff->pgzBuff,ReqLen)) == NULL)
 		{
-		time_t Now = time(0);
-		unsigned long ElapsedSecs = (unsigned long) (Now - Started);
-		if(ElapsedSecs >= 60)
-			{
-			switch(m_PMode) {
-				case ePMAmplicon:
-					gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d overlapped, %d reported with associated barcodes", NumPE5Reads, NumOverlapping, NumOverlapping - NumUnmapped);
-					break;
+		deflateEnd(&zStrm);
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CompressOutBuff: unable to realloc memory (%zd) for output compression",ReqLen);
+		return(eBSFerrMem);
+		}
+	pOutBuff->pgzBuff = pRealloc;
+	pOutBuff->AllocdgzLen = ReqLen;
+	}
+zStrm.next_in = (Bytef *)pOutBuff->pBuff;
+zStrm.avail_in = (uInt)pOutBuff->CurLen;
+zStrm.next_out = (Bytef *)pOutBuff->pgzBuff;
+zStrm.avail_out = (uInt)pOutBuff->AllocdgzLen;
+Rslt = deflate(&zStrm,Z_FINISH);
+pOutBuff->CurgzLen = (size_t)zStrm.total_out;
+deflateEnd(&zStrm);
+if(Rslt != Z_STREAM_END)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CompressOutBuff: compression failed");
+	return(eBSFerrInternal);
+	}
+return(eBSFSuccess);
+}
 
-				case ePMAmpliconNoMerge:
-					gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d reported with associated barcodes", NumPE5Reads, NumPEWithBarcode);
-					break;
+int									// returns eBSFSuccess if output was written or buffered
+CMergeReadPairs::WriteOutDest(int DestIdx,	// write to this output destination
+					 void *pBuff,			// output from this buffer
+					 size_t BuffLen)		// this many bytes
+{
+int hOutFile;
+int *pCurLen;
+int AllocdLen;
+char *pOutBuffer;
+tsAmpliconWellFile *pWellFile;
 
-				default:
-					gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads of which %d overlapped", NumPE5Reads, NumOverlapping);
-					break;
-				}
+switch(DestIdx) {
+	case eMODMerged:
+		hOutFile = m_hOutMerged;
+		pOutBuffer = m_pszMSeqs;
+		pCurLen = &m_CurMSeqLen;
+		AllocdLen = m_AllocdMSeqs;
+		break;
+	case eMODUnmergedP1:
+		hOutFile = m_hOut5Unmerged;
+		pOutBuffer = m_pszUnmergedP1Seqs;
+		pCurLen = &m_CurUnmergedP1Seqs;
+		AllocdLen = m_AllocdUnmergedP1Seqs;
+		break;
+	case eMODUnmergedP2:
+		hOutFile = m_hOut3Unmerged;
+		pOutBuffer = m_pszUnmergedP2Seqs;
+		pCurLen = &m_CurUnmergedP2Seqs;
+		AllocdLen = m_AllocdUnmergedP2Seqs;
+		break;
+	default:
+		DestIdx -= eMODWells;
+		pWellFile = &m_WellFiles[DestIdx / 2].WellFile[DestIdx & 0x01];
+		hOutFile = pWellFile->hOutFile;
+		pOutBuffer = pWellFile->pOutBuffer;
+		pCurLen = &pWellFile->CurBuffLen;
+		AllocdLen = pWellFile->AllocdOutBuff;
+		break;
+	}
 
-			Started = Now;
+if(hOutFile == -1 || pOutBuffer == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"WriteOutDest: output file not opened for writing");
+	return(eBSFerrInternal);
+	}
 
-			if(m_PMode == ePMseparate)
-				{
-				if(m_CurUnmergedP1Seqs > 0)
-					{
-					CUtility::SafeWrite(m_hOut5Unmerged,m_pszUnmergedP1Seqs,(size_t)m_CurUnmergedP1Seqs);
-					m_CurUnmergedP1Seqs = 0;
-					}
-				if(m_CurUnmergedP2Seqs > 0)
-					{
-					CUtility::SafeWrite(m_hOut3Unmerged,m_pszUnmergedP2Seqs,(size_t)m_CurUnmergedP2Seqs);
-					m_CurUnmergedP2Seqs = 0;
-					}
-				}
+if(((size_t)*pCurLen + BuffLen) > (size_t)AllocdLen)
+	{
+	if(*pCurLen > 0 && !CUtility::SafeWrite(hOutFile,pOutBuffer,(size_t)*pCurLen))
+		return(eBSFerrWrite);
+	*pCurLen = 0;
+	if(BuffLen > (size_t)AllocdLen)
+		return(CUtility::SafeWrite(hOutFile,pBuff,BuffLen) ? eBSFSuccess : eBSFerrWrite);
+	}
+memcpy(&pOutBuffer[*pCurLen],pBuff,BuffLen);
+*pCurLen += (int)BuffLen;
+return(eBSFSuccess);
+}
 
+void
+CMergeReadPairs::FlushOutDests(void)				// write all buffered output to output files
+{
+int WellIdx;
+tsAmpliconWell *pWell;
 
-			if(m_PMode >= ePMAmplicon && m_NumWells)
-				{
-				tsAmpliconWell *pWell;
-				pWell = m_WellFiles;
-				for(WellIdx = 0; WellIdx < m_NumWells; WellIdx++,pWell++)
-					{
-					if(pWell->WellFile[0].CurBuffLen > 0)
-						{
-						CUtility::SafeWrite(pWell->WellFile[0].hOutFile, pWell->WellFile[0].pOutBuffer,(size_t)pWell->WellFile[0].CurBuffLen);
-						pWell->WellFile[0].CurBuffLen = 0;
-						}
-					if(pWell->WellFile[1].hOutFile != -1 && pWell->WellFile[1].CurBuffLen > 0)
-						{
-						CUtility::SafeWrite(pWell->WellFile[1].hOutFile, pWell->WellFile[1].pOutBuffer, (size_t)pWell->WellFile[1].CurBuffLen);
-						pWell->WellFile[1].CurBuffLen = 0;
-						}
-					}
-				}
-			}
-		}
- 
-	NumPE5Reads += 1;
-	if(PE5SeqLen == eBSFFastaDescr)		// just read a descriptor line which would be as expected for multifasta or fastq
+if(m_PMode >= ePMAmplicon && m_NumWells)
+	{
+	pWell = m_WellFiles;
+	for(WellIdx = 0; WellIdx < m_NumWells; WellIdx++,pWell++)
 		{
-		PE5DescrLen = m_PE5Fasta.ReadDescriptor((char *)szPE5DescrBuff,sizeof(szPE5DescrBuff)-1);
-		szPE5DescrBuff[sizeof(szPE5DescrBuff)-1] = '\0';
-
-		PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxFastQSeqLen);
-		if(PE5SeqLen < cMinReadSeqLen)
+		if(pWell->WellFile[0].hOutFile != -1 && pWell->WellFile[0].CurBuffLen > 0)
 			{
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing sequence from '%s' after %d reads parsed",m_szIn5ReadsFile,NumPE5Reads);
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",szPE5DescrBuff);
-			m_PE5Fasta.Close();
-			m_PE3Fasta.Close();
-			return(eBSFerrParse);
+			CUtility::SafeWrite(pWell->WellFile[0].hOutFile, pWell->WellFile[0].pOutBuffer,(size_t)pWell->WellFile[0].CurBuffLen);
+			pWell->WellFile[0].CurBuffLen = 0;
 			}
-		if(m_bIsFastq)
+
+		if (pWell->WellFile[1].hOutFile != -1 && pWell->WellFile[1].CurBuffLen > 0)
 			{
-			PE5QualLen = m_PE5Fasta.ReadQValues((char *)PE5Qual,ccMaxFastQSeqLen);
-			PE5Qual[PE5QualLen] = '\0';
-			
-			if(PE5QualLen != PE5SeqLen)
-				{
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing quality from '%s' after %d reads parsed",m_szIn5ReadsFile,NumPE5Reads);
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Sequence length: %d Quality length: %d",PE5SeqLen,PE5QualLen);
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",szPE5DescrBuff);
-				m_PE5Fasta.Close();
-				m_PE3Fasta.Close();
-				return(eBSFerrParse);
-				}
+			CUtility::SafeWrite(pWell->WellFile[1].hOutFile, pWell->WellFile[1].pOutBuffer, (size_t)pWell->WellFile[1].CurBuffLen);
+			pWell->WellFile[1].CurBuffLen = 0;
 			}
 		}
+	}
 
-	Rslt = (teBSFrsltCodes)(PE3SeqLen = m_PE3Fasta.ReadSequence(PE3Seq,ccMaxFastQSeqLen,true,false));
-	if(Rslt <= eBSFSuccess)
+if(m_CurMSeqLen > 0)
+	{
+	CUtility::SafeWrite(m_hOutMerged,m_pszMSeqs,(size_t)m_CurMSeqLen);
+	m_CurMSeqLen = 0;
+	}
+
+if(m_CurUnmergedP1Seqs > 0)
+	{
+	CUtility::SafeWrite(m_hOut5Unmerged,m_pszUnmergedP1Seqs,(size_t)m_CurUnmergedP1Seqs);
+	m_CurUnmergedP1Seqs = 0;
+	}
+
+if(m_CurUnmergedP2Seqs > 0)
+	{
+	CUtility::SafeWrite(m_hOut3Unmerged,m_pszUnmergedP2Seqs,(size_t)m_CurUnmergedP2Seqs);
+	m_CurUnmergedP2Seqs = 0;
+	}
+}
+
+int									// < eBSFSuccess if errors, 0 if no more reads, otherwise read sequence length
+CMergeReadPairs::ParseRead(CFasta *pFasta,	// parse next read from this file
+				char *pszInFile,			// file name, used when reporting parse errors
+				int NumParsed,				// number of reads previously parsed from this file, used when reporting parse errors
+				tsMergeBatch *pBatch,		// parse into this batch
+				UINT32 *pDescrOfs,			// returned offset in batch pInBuff of descriptor
+				UINT32 *pSeqOfs,			// returned offset in batch pInBuff of sequence
+				UINT32 *pQualOfs)			// returned offset in batch pInBuff of quality scores
+{
+int SeqLen;
+int QualLen;
+UINT8 *pBuff;
+char *pszDescr;
+
+pszDescr = NULL;
+pBuff = &pBatch->pInBuff[pBatch->InBuffLen];
+if((SeqLen = pFasta->ReadSequence(pBuff,ccMaxFastQSeqLen,true,false)) <= eBSFSuccess)
+	return(SeqLen);
+
+if(SeqLen == eBSFFastaDescr)		// just read a descriptor line which would be as expected for multifasta or fastq
+	{
+	pFasta->ReadDescriptor((char *)pBuff,cMaxReadDesrLen);
+	pBuff[cMaxReadDesrLen] = '\0';
+	pszDescr = (char *)pBuff;
+	*pDescrOfs = (UINT32)pBatch->InBuffLen;
+	pBatch->InBuffLen += strlen(pszDescr) + 1;
+
+	pBuff = &pBatch->pInBuff[pBatch->InBuffLen];
+	SeqLen = pFasta->ReadSequence(pBuff,ccMaxFastQSeqLen);
+	if(SeqLen < cMinReadSeqLen)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Fewer reads in '%s' than '%s' after %d reads parsed",m_szIn3ReadsFile,m_szIn5ReadsFile,NumPE3Reads);
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",szPE3DescrBuff);
-		m_PE5Fasta.Close();
-		m_PE3Fasta.Close();
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing sequence from '%s' after %d reads parsed",pszInFile,NumParsed);
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",pszDescr);
 		return(eBSFerrParse);
-		}	
-	NumPE3Reads += 1;
-	if(PE3SeqLen == eBSFFastaDescr)		// just read a descriptor line which would be as expected for multifasta or fastq
+		}
+	*pSeqOfs = (UINT32)pBatch->InBuffLen;
+	pBatch->InBuffLen += SeqLen;
+	if(m_bIsFastq)
 		{
-		PE3DescrLen = m_PE3Fasta.ReadDescriptor((char *)szPE3DescrBuff,sizeof(szPE3DescrBuff)-1);
-		szPE3DescrBuff[sizeof(szPE3DescrBuff)-1] = '\0'; 
-		PE3SeqLen = m_PE3Fasta.ReadSequence(PE3Seq,ccMaxFastQSeqLen);
-		if(PE3SeqLen < cMinReadSeqLen)
+		pBuff = &pBatch->pInBuff[pBatch->InBuffLen];
+		QualLen = pFasta->ReadQValues((char *)pBuff,ccMaxFastQSeqLen);
+		pBuff[QualLen] = '\0';
+		if(QualLen != SeqLen)
 			{
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing sequence from '%s' after %d reads parsed",m_szIn3ReadsFile,NumPE3Reads);
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",szPE3DescrBuff);
-			m_PE5Fasta.Close();
-			m_PE3Fasta.Close();
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing quality from '%s' after %d reads parsed",pszInFile,NumParsed);
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Sequence length: %d Quality length: %d",SeqLen,QualLen);
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",pszDescr);
 			return(eBSFerrParse);
 			}
-		if(m_bIsFastq)
-			{
-			PE3QualLen = m_PE3Fasta.ReadQValues((char *)PE3Qual,ccMaxFastQSeqLen);
-			PE3Qual[PE3QualLen] = '\0';
-			if(PE3QualLen != PE3SeqLen)
-				{
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Problem parsing quality from '%s' after %d reads parsed",m_szIn3ReadsFile,NumPE3Reads);
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Sequence length: %d Quality length: %d",PE3SeqLen,PE3QualLen);
-				gDiagnostics.DiagOut(eDLFatal,gszProcName,"Last descriptor parsed: %s",szPE5DescrBuff);
-				m_PE5Fasta.Close();
-				m_PE3Fasta.Close();
-				return(eBSFerrParse);
-				}
-			}
+		*pQualOfs = (UINT32)pBatch->InBuffLen;
+		pBatch->InBuffLen += QualLen + 1;
 		}
+	}
+else		// sequence without a preceding descriptor
+	{
+	*pSeqOfs = (UINT32)pBatch->InBuffLen;
+	pBatch->InBuffLen += SeqLen;
+	*pDescrOfs = (UINT32)pBatch->InBuffLen;
+	pBatch->pInBuff[pBatch->InBuffLen++] = '\0';
+	}
+if(!m_bIsFastq)
+	*pQualOfs = *pDescrOfs;			// not used when reads are non-fastq
+return(SeqLen);
+}
 
-	  int PEPlateCell;
-  	if(m_PMode >= ePMAmplicon && m_bAmpliconNoMerge)
+int									// < eBSFSuccess if errors, 0 if no more read pairs, otherwise number of read pairs parsed into batch
+CMergeReadPairs::ParseBatch(tsMergeBatch *pBatch)	// parse next batch of read pairs
+{
+int Rslt;
+tsMergePair *pPair;
+
+pBatch->NumPairs = 0;
+pBatch->InBuffLen = 0;
+pPair = pBatch->pPairs;
+while(pBatch->NumPairs < cMergeBatchPairs && (pBatch->InBuffLen + cMergeMaxPairBytes) <= (size_t)cMergeBatchBuffSize)
+	{
+	memset(pPair,0,sizeof(tsMergePair));
+	if((Rslt = ParseRead(&m_PE5Fasta,m_szIn5ReadsFile,m_NumPE5Reads,pBatch,&pPair->PE5DescrOfs,&pPair->PE5SeqOfs,&pPair->PE5QualOfs)) <= eBSFSuccess)
 		{
-		if ((PEPlateCell = MapPEBarcodesToWell(min(PE5SeqLen,PE3SeqLen), PE5Seq, PE3Seq)) < 1)
-			NumPENoBarcode += 1;
+		if(Rslt < eBSFSuccess)
+			return(Rslt);
+		break;
+		}
+	pPair->PE5SeqLen = (UINT16)Rslt;
+	m_NumPE5Reads += 1;
+
+	if((Rslt = ParseRead(&m_PE3Fasta,m_szIn3ReadsFile,m_NumPE3Reads,pBatch,&pPair->PE3DescrOfs,&pPair->PE3SeqOfs,&pPair->PE3QualOfs)) <= eBSFSuccess)
+		{
+		if(Rslt == eBSFSuccess)
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Fewer reads in '%s' than '%s' after %d reads parsed",m_szIn3ReadsFile,m_szIn5ReadsFile,m_NumPE3Reads);
+		return(eBSFerrParse);
+		}
+	pPair->PE3SeqLen = (UINT16)Rslt;
+	m_NumPE3Reads += 1;
+	pBatch->NumPairs += 1;
+	pPair += 1;
+	}
+return(pBatch->NumPairs);
+}
+
+int
+CMergeReadPairs::AddRslt(tsMergeBatch *pBatch,	// add to results for this batch
+				tsMergePair *pPair,			// results are for this read pair
+				int RsltIdx,				// result instance (0 or 1)
+				char *pszSeq,				// '\0' terminated ascii sequence
+				char *pszQual)				// '\0' terminated quality scores, NULL if no quality scores to be output
+{
+size_t Len;
+Len = strlen(pszSeq) + 1;
+pPair->RsltSeqOfs[RsltIdx] = (UINT32)pBatch->RsltBuffLen;
+memcpy(&pBatch->pRsltBuff[pBatch->RsltBuffLen],pszSeq,Len);
+pBatch->RsltBuffLen += Len;
+pPair->RsltQualOfs[RsltIdx] = (UINT32)pBatch->RsltBuffLen;
+if(pszQual == NULL || m_OFormat == eOFfasta)
+	pBatch->pRsltBuff[pBatch->RsltBuffLen++] = '\0';
+else
+	{
+	Len = strlen(pszQual) + 1;
+	memcpy(&pBatch->pRsltBuff[pBatch->RsltBuffLen],pszQual,Len);
+	pBatch->RsltBuffLen += Len;
+	}
+return(eBSFSuccess);
+}
+
+int									// returns eBSFSuccess or error code
+CMergeReadPairs::ProcBatch(tsMergeBatch *pBatch,		// overlap merge and/or barcode process this batch
+				  tsMergeThreadPars *pPars)	// thread specific statistics accumulated into these
+{
+int PairIdx;
+tsMergePair *pPair;
+
+UINT8 PE5Seq[ccMaxFastQSeqLen+1];
+UINT8 PE5Qual[ccMaxFastQSeqLen+1];
+UINT8 PE3Seq[ccMaxFastQSeqLen+1];
+UINT8 PE3Qual[ccMaxFastQSeqLen+1];
+UINT8 MSeq[(2*ccMaxFastQSeqLen)+1];
+UINT8 szMSeq[(2*ccMaxFastQSeqLen)+1];
+UINT8 szMQual[(2*ccMaxFastQSeqLen)+1];
+int PlateCell;
+int PEPlateCell;
+
+int MergeIdx;
+UINT8 *pMSeq;
+UINT8 *pMSeqQual;
+UINT8 *pSeq5Qual;
+UINT8 *pSeq3Qual;
+etSeqBase *pSeq5;
+etSeqBase *pSeq3;
+etSeqBase Base5;
+etSeqBase Base3;
+int OL5Idx;
+int OL3Idx;
+int MaxOverlap;
+int OLStartsIdx;
+int ReqOverlap3;
+int MaxSubs;
+int CurSubs;
+int CurOvlpScore;
+int BestOvlpScore;
+int AllowedSubs;
+int PE5SeqLen;
+int PE3SeqLen;
+
+pBatch->RsltBuffLen = 0;
+pBatch->NumOverlapping = 0;
+pBatch->NumUnmapped = 0;
+pBatch->NumPEWithBarcode = 0;
+pBatch->NumPENoBarcode = 0;
+
+pPair = pBatch->pPairs;
+for(PairIdx = 0; PairIdx < pBatch->NumPairs; PairIdx++, pPair++)
+	{
+	pPair->Class = eMCNone;
+	pPair->PlateCell = 0;
+	PE5SeqLen = pPair->PE5SeqLen;
+	PE3SeqLen = pPair->PE3SeqLen;
+	memcpy(PE5Seq,&pBatch->pInBuff[pPair->PE5SeqOfs],PE5SeqLen);
+	memcpy(PE3Seq,&pBatch->pInBuff[pPair->PE3SeqOfs],PE3SeqLen);
+	if(m_bIsFastq)
+		{
+		memcpy(PE5Qual,&pBatch->pInBuff[pPair->PE5QualOfs],PE5SeqLen+1);
+		memcpy(PE3Qual,&pBatch->pInBuff[pPair->PE3QualOfs],PE3SeqLen+1);
+		}
+
+  	if(m_PMode >= ePMAmplicon && m_bAmpliconNoMerge)
+		{
+		if ((PEPlateCell = MapPEBarcodesToWell(min(PE5SeqLen,PE3SeqLen), PE5Seq, PE3Seq)) < 1)
+			{
+			pPair->Class = eMCNoBarcode;
+			pBatch->NumPENoBarcode += 1;
+			}
 		else
 			{
-			tsAmpliconWell *pWell;
+			pPair->Class = eMCBarcoded;
+			pPair->PlateCell = (UINT16)PEPlateCell;
 			MergeIdx = PE5SeqLen - 6;		// trim barcode
 			CSeqTrans::MapSeq2UCAscii(&PE5Seq[6], MergeIdx, (char *)szMSeq);
-
 			if (!m_bIsFastq && m_OFormat != eOFfasta)
 				memset(PE5Qual, cPhredOrphanScore, PE5SeqLen);
 			PE5Qual[PE5SeqLen] = '\0';
 			szMSeq[MergeIdx] = '\0';
-			pWell = &m_WellFiles[PEPlateCell - 1];
-			if (m_OFormat == eOFfasta)
-				pWell->WellFile[0].CurBuffLen += sprintf((char *)&pWell->WellFile[0].pOutBuffer[pWell->WellFile[0].CurBuffLen], ">Seq%d PE1 %s\n%s\n", StartNum + NumPEWithBarcode, szPE5DescrBuff, (char *)szMSeq);
-			else
-				pWell->WellFile[0].CurBuffLen += sprintf((char *)&pWell->WellFile[0].pOutBuffer[pWell->WellFile[0].CurBuffLen], "@Seq%d PE1 %s\n%s\n+\n%s\n", StartNum + NumPEWithBarcode, szPE5DescrBuff, (char *)szMSeq, &PE5Qual[6]);
-				
-			if (pWell->WellFile[0].CurBuffLen > pWell->WellFile[0].AllocdOutBuff - (4 * ccMaxFastQSeqLen))
-				{
-				CUtility::SafeWrite(pWell->WellFile[0].hOutFile, pWell->WellFile[0].pOutBuffer, (size_t)pWell->WellFile[0].CurBuffLen);
-				pWell->WellFile[0].CurBuffLen = 0;
-				}
+			AddRslt(pBatch,pPair,0,(char *)szMSeq,(char *)&PE5Qual[6]);
 
 			MergeIdx = PE3SeqLen - 6;		// trim 3' barcode
 			CSeqTrans::MapSeq2UCAscii(&PE3Seq[6], MergeIdx, (char *)szMSeq);
-
 			if (!m_bIsFastq && m_OFormat != eOFfasta)
 				memset(PE3Qual, cPhredOrphanScore, PE3SeqLen);
 			PE3Qual[PE3SeqLen] = '\0';
 			szMSeq[MergeIdx] = '\0';
-			if (m_OFormat == eOFfasta)
-				pWell->WellFile[1].CurBuffLen += sprintf((char *)&pWell->WellFile[1].pOutBuffer[pWell->WellFile[1].CurBuffLen], ">Seq%d PE2 %s\n%s\n", StartNum + NumPEWithBarcode, szPE3DescrBuff, (char *)szMSeq);
-			else
-				pWell->WellFile[1].CurBuffLen += sprintf((char *)&pWell->WellFile[1].pOutBuffer[pWell->WellFile[1].CurBuffLen], "@Seq%d PE2 %s\n%s\n+\n%s\n", StartNum + NumPEWithBarcode, szPE3DescrBuff, (char *)szMSeq, &PE3Qual[6]);
-
-			if (pWell->WellFile[1].CurBuffLen > pWell->WellFile[1].AllocdOutBuff - (4 * ccMaxFastQSeqLen))
-				{
-				CUtility::SafeWrite(pWell->WellFile[1].hOutFile, pWell->WellFile[1].pOutBuffer, (size_t)pWell->WellFile[1].CurBuffLen);
-				pWell->WellFile[1].CurBuffLen = 0;
-				}
-			NumPEWithBarcode += 1;
+			AddRslt(pBatch,pPair,1,(char *)szMSeq,(char *)&PE3Qual[6]);
+			pBatch->NumPEWithBarcode += 1;
 			}
-
 		continue;
 		}
 
 	// PE3 needs to be revcpl'd
 	CSeqTrans::ReverseComplement(PE3SeqLen,PE3Seq);
 	if(m_bIsFastq)
-		CSeqTrans::ReverseSeq(PE3QualLen,PE3Qual);
+		CSeqTrans::ReverseSeq(PE3SeqLen,PE3Qual);
 
 	// now try for maximal overlap of at least m_MinOverlap allowing (if user specified) for sequencer base call errors
 	// matches scored += 1, and mismatches scored -= 2 
@@ -1522,44 +1788,19 @@ while((Rslt = (teBSFrsltCodes)(PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxF
 
 	if(MaxOverlap < 1 && (m_PMode == ePMcombined || m_PMode == ePMseparate))
 		{
+		pPair->Class = eMCOrphans;
 		CSeqTrans::ReverseComplement(PE3SeqLen,PE3Seq);
 		CSeqTrans::MapSeq2UCAscii(PE3Seq,PE3SeqLen,(char *)szMSeq);
 		szMSeq[PE3SeqLen] = '\0';
 		if(m_OFormat == eOFfastq)
 			{
 			if(m_bIsFastq)
-				CSeqTrans::ReverseSeq(PE3QualLen,PE3Qual);
+				CSeqTrans::ReverseSeq(PE3SeqLen,PE3Qual);
 			else
 				memset(PE3Qual,cPhredOrphanScore,PE3SeqLen);
 			PE3Qual[PE3SeqLen] = '\0';
 			}
-
-		if(m_PMode == ePMseparate)
-			{
-			if(m_OFormat == eOFfasta)
-				m_CurUnmergedP2Seqs += sprintf((char *)&m_pszUnmergedP2Seqs[m_CurUnmergedP2Seqs],">%s\n%s\n",szPE3DescrBuff,(char *)szMSeq);
-			else
-				m_CurUnmergedP2Seqs += sprintf((char *)&m_pszUnmergedP2Seqs[m_CurUnmergedP2Seqs],"@%s\n%s\n+\n%s\n",szPE3DescrBuff,(char *)szMSeq,(char *)PE3Qual);
-				
-			if(m_CurUnmergedP2Seqs > (cAllocOutBuffLen - (8 * ccMaxFastQSeqLen)))
-				{
-				CUtility::SafeWrite(m_hOut3Unmerged,m_pszUnmergedP2Seqs,(size_t)m_CurUnmergedP2Seqs);
-				m_CurUnmergedP2Seqs = 0;
-				}
-			}
-		else
-			{
-			if(m_OFormat == eOFfasta)
-				m_CurMSeqLen += sprintf((char *)&m_pszMSeqs[m_CurMSeqLen],">%s\n%s\n",szPE3DescrBuff,(char *)szMSeq);
-			else
-				m_CurMSeqLen += sprintf((char *)&m_pszMSeqs[m_CurMSeqLen],"@%s\n%s\n+\n%s\n",szPE3DescrBuff,(char *)szMSeq,(char *)PE3Qual);
-
-			if(m_CurMSeqLen > (cAllocOutBuffLen - (8 * ccMaxFastQSeqLen)))
-				{
-				CUtility::SafeWrite(m_hOutMerged,m_pszMSeqs,(size_t)m_CurMSeqLen);
-				m_CurMSeqLen = 0;
-				}	
-			}
+		AddRslt(pBatch,pPair,0,(char *)szMSeq,(char *)PE3Qual);
 
 		CSeqTrans::MapSeq2UCAscii(PE5Seq,PE5SeqLen,(char *)szMSeq);
 		szMSeq[PE5SeqLen] = '\0';
@@ -1569,48 +1810,20 @@ while((Rslt = (teBSFrsltCodes)(PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxF
 				memset(PE5Qual,cPhredOrphanScore,PE5SeqLen);
 			PE5Qual[PE5SeqLen] = '\0';
 			}
-
-			
-		if(m_PMode == ePMseparate)
-			{
-			if(m_OFormat == eOFfasta)
-				m_CurUnmergedP1Seqs += sprintf((char *)&m_pszUnmergedP1Seqs[m_CurUnmergedP1Seqs],">%s\n%s\n",szPE5DescrBuff,(char *)szMSeq);
-			else
-				m_CurUnmergedP1Seqs += sprintf((char *)&m_pszUnmergedP1Seqs[m_CurUnmergedP1Seqs],"@%s\n%s\n+\n%s\n",szPE5DescrBuff,(char *)szMSeq,(char *)PE5Qual);
-
-			if(m_CurUnmergedP1Seqs > (cAllocOutBuffLen - (8 * ccMaxFastQSeqLen)))
-				{
-				CUtility::SafeWrite(m_hOut5Unmerged,m_pszUnmergedP1Seqs,(size_t)m_CurUnmergedP1Seqs);
-				m_CurUnmergedP1Seqs = 0;
-				}
-			}
-		else
-			{
-			if(m_OFormat == eOFfasta)
-				m_CurMSeqLen += sprintf((char *)&m_pszMSeqs[m_CurMSeqLen],">%s\n%s\n",szPE5DescrBuff,(char *)szMSeq);
-			else
-				m_CurMSeqLen += sprintf((char *)&m_pszMSeqs[m_CurMSeqLen],"@%s\n%s\n+\n%s\n",szPE5DescrBuff,(char *)szMSeq,(char *)PE5Qual);
-
-			if(m_CurMSeqLen > (cAllocOutBuffLen - (8 * ccMaxFastQSeqLen)))
-				{
-				CUtility::SafeWrite(m_hOutMerged,m_pszMSeqs,(size_t)m_CurMSeqLen);
-				m_CurMSeqLen = 0;
-				}	
-			}
-
+		AddRslt(pBatch,pPair,1,(char *)szMSeq,(char *)PE5Qual);
 		continue;
 		}
 
 	if(MaxOverlap > 0)
 		{
-		if(MinObsOverlap == -1 || MaxOverlap < MinObsOverlap)
-			MinObsOverlap = MaxOverlap;
-		if(MaxObsOverlap == -1 || MaxOverlap > MaxObsOverlap)
-			MaxObsOverlap = MaxOverlap;
-		OverlapDistSubs[MaxSubs] += 1;
-		OverlapDistCnts[MaxOverlap] += 1;
-		NumOverlapping += 1;
-		// output to file...
+		if(pPars->MinObsOverlap == -1 || MaxOverlap < pPars->MinObsOverlap)
+			pPars->MinObsOverlap = MaxOverlap;
+		if(pPars->MaxObsOverlap == -1 || MaxOverlap > pPars->MaxObsOverlap)
+			pPars->MaxObsOverlap = MaxOverlap;
+		pPars->OverlapDistSubs[MaxSubs] += 1;
+		pPars->OverlapDistCnts[MaxOverlap] += 1;
+		pBatch->NumOverlapping += 1;
+
 		pMSeq = MSeq;
 		pSeq5 = PE5Seq;
 		pMSeqQual = szMQual;
@@ -1676,8 +1889,6 @@ while((Rslt = (teBSFrsltCodes)(PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxF
 					}
 				}
 			}
-		
-
 
 		if(MergeIdx < PE5SeqLen)
 			{
@@ -1692,7 +1903,6 @@ while((Rslt = (teBSFrsltCodes)(PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxF
 						*pMSeqQual = cPhredHiScore;
 					}
 				}
-
 			}
 		else
 			{
@@ -1716,102 +1926,550 @@ while((Rslt = (teBSFrsltCodes)(PE5SeqLen = m_PE5Fasta.ReadSequence(PE5Seq,ccMaxF
 			{
 			if((PlateCell = MapSEBarcodesToWell(MergeIdx,MSeq)) < 1)
 				{
-				NumUnmapped += 1;
+				pPair->Class = eMCMergedUnmapped;
+				pBatch->NumUnmapped += 1;
 				continue;
 				}
+			pPair->PlateCell = (UINT16)PlateCell;
 			}
 
+		pPair->Class = eMCMerged;
 		CSeqTrans::MapSeq2UCAscii(MSeq,MergeIdx,(char *)szMSeq);
 		szMSeq[MergeIdx] = '\0';
-
 		if(m_PMode == ePMAmplicon)
 			{
-			tsAmpliconWell *pWell;
 			MergeIdx -= 6;				// trim 3' barcode
 			szMQual[MergeIdx] = '\0';
-			szMSeq[MergeIdx] = '\0';	
-			pWell = &m_WellFiles[PlateCell-1];
-			if(m_OFormat == eOFfasta)
-				pWell->WellFile[0].CurBuffLen += sprintf((char *)&pWell->WellFile[0].pOutBuffer[pWell->WellFile[0].CurBuffLen],">MSeq%d %s\n%s\n",StartNum+NumOverlapping,szPE5DescrBuff,(char *)&szMSeq[6]);
-			else
-				{
-				szMQual[MergeIdx] = '\0';
-				pWell->WellFile[0].CurBuffLen += sprintf((char *)&pWell->WellFile[0].pOutBuffer[pWell->WellFile[0].CurBuffLen],"@MSeq%d %s\n%s\n+\n%s\n",StartNum+NumOverlapping,szPE5DescrBuff,(char *)&szMSeq[6],&szMQual[6]);
-				}
-			if(pWell->WellFile[0].CurBuffLen > pWell->WellFile[0].AllocdOutBuff - (4 * ccMaxFastQSeqLen))
-				{
-				CUtility::SafeWrite(pWell->WellFile[0].hOutFile, pWell->WellFile[0].pOutBuffer,(size_t)pWell->WellFile[0].CurBuffLen);
-				pWell->WellFile[0].CurBuffLen = 0;
-				}
+			szMSeq[MergeIdx] = '\0';
+			AddRslt(pBatch,pPair,0,(char *)&szMSeq[6],(char *)&szMQual[6]);
 			}
 		else
 			{
+			szMQual[MergeIdx] = '\0';
+			AddRslt(pBatch,pPair,0,(char *)szMSeq,(char *)szMQual);
+			}
+		}
+	}
+return(eBSFSuccess);
+}
+
+int									// returns eBSFSuccess or error code
+CMergeReadPairs::FormatBatch(tsMergeBatch *pBatch,	// format batch output
+				  int BaseOverlapping,		// sequence identifiers for merged pairs start after this count
+				  int BasePEWithBarcode)	// sequence identifiers for barcoded pairs start after this count
+{
+int Rslt;
+int PairIdx;
+int DestIdx;
+size_t ReqLen;
+char *pszDescr;
+char *pszSeq;
+char *pszQual;
+tsMergePair *pPair;
+tsMergeOutBuff *pOutBuff;
+int NumOverlapping;
+int NumPEWithBarcode;
+
+pOutBuff = pBatch->pOutBuffs;
+for(DestIdx = 0; DestIdx < pBatch->NumOutBuffs; DestIdx++, pOutBuff++)
+	{
+	pOutBuff->CurLen = 0;
+	pOutBuff->CurgzLen = 0;
+	}
+
+NumOverlapping = BaseOverlapping;
+NumPEWithBarcode = BasePEWithBarcode;
+pPair = pBatch->pPairs;
+for(PairIdx = 0; PairIdx < pBatch->NumPairs; PairIdx++, pPair++)
+	{
+	switch(pPair->Class) {
+		case eMCMergedUnmapped:
+			NumOverlapping += 1;
+			break;
+
+		case eMCMerged:
+			NumOverlapping += 1;
+			DestIdx = m_PMode == ePMAmplicon ? eMODWells + ((pPair->PlateCell - 1) * 2) : eMODMerged;
+			pOutBuff = &pBatch->pOutBuffs[DestIdx];
+			pszDescr = (char *)&pBatch->pInBuff[pPair->PE5DescrOfs];
+			pszSeq = (char *)&pBatch->pRsltBuff[pPair->RsltSeqOfs[0]];
+			pszQual = (char *)&pBatch->pRsltBuff[pPair->RsltQualOfs[0]];
+			ReqLen = strlen(pszDescr) + (2 * strlen(pszSeq)) + 50;
+			if((Rslt = ReqOutBuff(pOutBuff,ReqLen)) < eBSFSuccess)
+				return(Rslt);
 			if(m_OFormat == eOFfasta)
-				m_CurMSeqLen += sprintf((char *)&m_pszMSeqs[m_CurMSeqLen],">MSeq%d %s\n%s\n",StartNum+NumOverlapping,szPE5DescrBuff,(char *)szMSeq);
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen],">MSeq%d %s\n%s\n",m_StartNum+NumOverlapping,pszDescr,pszSeq);
 			else
-				{
-				szMQual[MergeIdx] = '\0';
-				m_CurMSeqLen += sprintf((char *)&m_pszMSeqs[m_CurMSeqLen],"@MSeq%d %s\n%s\n+\n%s\n",StartNum+NumOverlapping,szPE5DescrBuff,(char *)szMSeq,szMQual);
-				}
-			if(m_CurMSeqLen > (cAllocOutBuffLen - (8 * ccMaxFastQSeqLen)))
-				{
-				CUtility::SafeWrite(m_hOutMerged,m_pszMSeqs,(size_t)m_CurMSeqLen);
-				m_CurMSeqLen = 0;
-				}
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen],"@MSeq%d %s\n%s\n+\n%s\n",m_StartNum+NumOverlapping,pszDescr,pszSeq,pszQual);
+			break;
+
+		case eMCOrphans:
+			DestIdx = m_PMode == ePMseparate ? eMODUnmergedP2 : eMODMerged;
+			pOutBuff = &pBatch->pOutBuffs[DestIdx];
+			pszDescr = (char *)&pBatch->pInBuff[pPair->PE3DescrOfs];
+			pszSeq = (char *)&pBatch->pRsltBuff[pPair->RsltSeqOfs[0]];
+			pszQual = (char *)&pBatch->pRsltBuff[pPair->RsltQualOfs[0]];
+			ReqLen = strlen(pszDescr) + (2 * strlen(pszSeq)) + 50;
+			if((Rslt = ReqOutBuff(pOutBuff,ReqLen)) < eBSFSuccess)
+				return(Rslt);
+			if(m_OFormat == eOFfasta)
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen],">%s\n%s\n",pszDescr,pszSeq);
+			else
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen],"@%s\n%s\n+\n%s\n",pszDescr,pszSeq,pszQual);
+
+			DestIdx = m_PMode == ePMseparate ? eMODUnmergedP1 : eMODMerged;
+			pOutBuff = &pBatch->pOutBuffs[DestIdx];
+			pszDescr = (char *)&pBatch->pInBuff[pPair->PE5DescrOfs];
+			pszSeq = (char *)&pBatch->pRsltBuff[pPair->RsltSeqOfs[1]];
+			pszQual = (char *)&pBatch->pRsltBuff[pPair->RsltQualOfs[1]];
+			ReqLen = strlen(pszDescr) + (2 * strlen(pszSeq)) + 50;
+			if((Rslt = ReqOutBuff(pOutBuff,ReqLen)) < eBSFSuccess)
+				return(Rslt);
+			if(m_OFormat == eOFfasta)
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen],">%s\n%s\n",pszDescr,pszSeq);
+			else
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen],"@%s\n%s\n+\n%s\n",pszDescr,pszSeq,pszQual);
+			break;
+
+		case eMCBarcoded:
+			DestIdx = eMODWells + ((pPair->PlateCell - 1) * 2);
+			pOutBuff = &pBatch->pOutBuffs[DestIdx];
+			pszDescr = (char *)&pBatch->pInBuff[pPair->PE5DescrOfs];
+			pszSeq = (char *)&pBatch->pRsltBuff[pPair->RsltSeqOfs[0]];
+			pszQual = (char *)&pBatch->pRsltBuff[pPair->RsltQualOfs[0]];
+			ReqLen = strlen(pszDescr) + (2 * strlen(pszSeq)) + 50;
+			if((Rslt = ReqOutBuff(pOutBuff,ReqLen)) < eBSFSuccess)
+				return(Rslt);
+			if (m_OFormat == eOFfasta)
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen], ">Seq%d PE1 %s\n%s\n", m_StartNum + NumPEWithBarcode, pszDescr, pszSeq);
+			else
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen], "@Seq%d PE1 %s\n%s\n+\n%s\n", m_StartNum + NumPEWithBarcode, pszDescr, pszSeq, pszQual);
+
+			pOutBuff = &pBatch->pOutBuffs[DestIdx + 1];
+			pszDescr = (char *)&pBatch->pInBuff[pPair->PE3DescrOfs];
+			pszSeq = (char *)&pBatch->pRsltBuff[pPair->RsltSeqOfs[1]];
+			pszQual = (char *)&pBatch->pRsltBuff[pPair->RsltQualOfs[1]];
+			ReqLen = strlen(pszDescr) + (2 * strlen(pszSeq)) + 50;
+			if((Rslt = ReqOutBuff(pOutBuff,ReqLen)) < eBSFSuccess)
+				return(Rslt);
+			if (m_OFormat == eOFfasta)
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen], ">Seq%d PE2 %s\n%s\n", m_StartNum + NumPEWithBarcode, pszDescr, pszSeq);
+			else
+				pOutBuff->CurLen += sprintf(&pOutBuff->pBuff[pOutBuff->CurLen], "@Seq%d PE2 %s\n%s\n+\n%s\n", m_StartNum + NumPEWithBarcode, pszDescr, pszSeq, pszQual);
+			NumPEWithBarcode += 1;
+			break;
+
+		default:		// no output for this pair
+			break;
+		}
+	}
+
+if(m_bgzOut)
+	{
+	pOutBuff = pBatch->pOutBuffs;
+	for(DestIdx = 0; DestIdx < pBatch->NumOutBuffs; DestIdx++, pOutBuff++)
+		if((Rslt = CompressOutBuff(pOutBuff)) < eBSFSuccess)
+			return(Rslt);
+	}
+return(eBSFSuccess);
+}
+
+int
+CMergeReadPairs::WriteBatch(tsMergeBatch *pBatch)	// write formatted batch output to output files
+{
+int Rslt;
+int DestIdx;
+tsMergeOutBuff *pOutBuff;
+
+pOutBuff = pBatch->pOutBuffs;
+for(DestIdx = 0; DestIdx < pBatch->NumOutBuffs; DestIdx++, pOutBuff++)
+	{
+	if(pOutBuff->CurLen == 0)
+		continue;
+	if(m_bgzOut)
+		Rslt = WriteOutDest(DestIdx,pOutBuff->pgzBuff,pOutBuff->CurgzLen);
+	else
+		Rslt = WriteOutDest(DestIdx,pOutBuff->pBuff,pOutBuff->CurLen);
+	if(Rslt < eBSFSuccess)
+		return(Rslt);
+	}
+return(eBSFSuccess);
+}
+
+// ThreadParse
+// Pipeline parser, fills free batches with read pairs parsed from the PE5 and PE3 input files
+int
+CMergeReadPairs::ThreadParse(tsMergeThreadPars *pPars)
+{
+int Rslt;
+int BatchIdx;
+tsMergeBatch *pBatch;
+
+while(1)
+	{
+	// wait for a free batch to become available
+	AcquireSerialise();
+	if(m_PipelineRslt < eBSFSuccess)
+		{
+		m_bParseCompleted = true;
+		ReleaseSerialise();
+		return(m_PipelineRslt);
+		}
+	pBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++, pBatch++)
+		if(pBatch->State == eMBSfree)
+			break;
+	if(BatchIdx == m_NumBatches)
+		{
+		ReleaseSerialise();
+		CUtility::SleepMillisecs(1);
+		continue;
+		}
+	pBatch->State = eMBSparsing;
+	ReleaseSerialise();
+
+	Rslt = ParseBatch(pBatch);
+
+	AcquireSerialise();
+	if(Rslt <= eBSFSuccess)
+		{
+		pBatch->State = eMBSfree;
+		if(Rslt < eBSFSuccess && m_PipelineRslt >= eBSFSuccess)
+			m_PipelineRslt = Rslt;
+		m_bParseCompleted = true;
+		ReleaseSerialise();
+		return(Rslt);
+		}
+	pBatch->BatchSeq = m_NxtParseBatchSeq++;
+	pBatch->State = eMBSparsed;
+	ReleaseSerialise();
+	}
+}
+
+// ThreadProc
+// Pipeline worker, processes parsed batches for overlaps and barcodes then, once sequence identifiers have been claimed in batch order, formats (and compresses) batch output
+int
+CMergeReadPairs::ThreadProc(tsMergeThreadPars *pPars)
+{
+int Rslt;
+int BatchIdx;
+bool bCompleted;
+int BaseOverlapping;
+int BasePEWithBarcode;
+tsMergeBatch *pBatch;
+tsMergeBatch *pCurBatch;
+
+while(1)
+	{
+	// process parsed batches in the order in which they were parsed
+	AcquireSerialise();
+	if(m_PipelineRslt < eBSFSuccess)
+		{
+		ReleaseSerialise();
+		break;
+		}
+	pBatch = NULL;
+	pCurBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++, pCurBatch++)
+		if(pCurBatch->State == eMBSparsed && (pBatch == NULL || pCurBatch->BatchSeq < pBatch->BatchSeq))
+			pBatch = pCurBatch;
+	if(pBatch != NULL)
+		pBatch->State = eMBSproc;
+	bCompleted = m_bParseCompleted;
+	ReleaseSerialise();
+
+	if(pBatch == NULL)
+		{
+		if(bCompleted)
+			break;
+		CUtility::SleepMillisecs(1);
+		continue;
+		}
+
+	Rslt = ProcBatch(pBatch,pPars);
+
+	// sequence identifiers are allocated in batch order so output is deterministic irrespective of the number of threads
+	while(1)
+		{
+		AcquireSerialise();
+		if(m_PipelineRslt < eBSFSuccess)
+			{
+			ReleaseSerialise();
+			return(m_PipelineRslt);
 			}
+		if(m_NxtPrefixBatchSeq == pBatch->BatchSeq)
+			{
+			BaseOverlapping = m_CumOverlapping;
+			BasePEWithBarcode = m_CumPEWithBarcode;
+			m_CumOverlapping += pBatch->NumOverlapping;
+			m_CumPEWithBarcode += pBatch->NumPEWithBarcode;
+			m_NxtPrefixBatchSeq += 1;
+			ReleaseSerialise();
+			break;
+			}
+		ReleaseSerialise();
+		CUtility::SleepMillisecs(1);
+		}
+
+	if(Rslt >= eBSFSuccess)
+		Rslt = FormatBatch(pBatch,BaseOverlapping,BasePEWithBarcode);
+
+	AcquireSerialise();
+	if(Rslt < eBSFSuccess)
+		{
+		if(m_PipelineRslt >= eBSFSuccess)
+			m_PipelineRslt = Rslt;
+		ReleaseSerialise();
+		return(Rslt);
 		}
+	pBatch->State = eMBSprocd;
+	ReleaseSerialise();
 	}
+return(eBSFSuccess);
+}
 
-if(m_PMode == ePMAmplicon && m_NumWells)
+// ProcOverlapPairs
+// Pipelined processing: a single parser thread parses read pairs into batches, worker threads identify overlaps and/or barcodes
+// and format output for each batch, and this calling thread writes the formatted batches to output files in the order parsed
+int													// returns number of sequences merged and written to output file
+CMergeReadPairs::ProcOverlapPairs(int StartNum)		// initial starting sequence identifier
+{
+int Rslt;
+int Idx;
+int ThreadIdx;
+int BatchIdx;
+bool bCompleted;
+tsMergeBatch *pBatch;
+tsMergeBatch *pCurBatch;
+tsMergeThreadPars *pThreads;
+tsMergeThreadPars *pThread;
+tsMergeThreadPars ParseThread;
+
+int NumOverlapping;
+int NumUnmapped;
+int NumPENoBarcode;
+int NumPEWithBarcode;
+int NumPairsWritten;
+int MinObsOverlap;
+int MaxObsOverlap;
+int OverlapDistCnts[ccMaxFastQSeqLen];
+int OverlapDistSubs[cMaxOverlapPercSubs+1];
+
+if(m_hOutMerged != -1 && m_pszMSeqs == NULL)
 	{
-	tsAmpliconWell *pWell;
-	pWell = m_WellFiles;
-	for(WellIdx = 0; WellIdx < m_NumWells; WellIdx++,pWell++)
+	if((m_pszMSeqs = new char [cAllocOutBuffLen])==NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to allocate memory (%d) for buffering file writes",cAllocOutBuffLen);
+		Reset(false);
+		return(eBSFerrMem);
+		}
+	m_AllocdMSeqs = cAllocOutBuffLen;
+	m_CurMSeqLen = 0;
+	}
+
+if(m_PMode == ePMseparate)
+	{
+	if(m_hOut5Unmerged != -1 && m_pszUnmergedP1Seqs == NULL)
 		{
-		if(pWell->WellFile[0].CurBuffLen > 0)
+		if((m_pszUnmergedP1Seqs = new char [cAllocOutBuffLen])==NULL)
 			{
-			CUtility::SafeWrite(pWell->WellFile[0].hOutFile, pWell->WellFile[0].pOutBuffer,(size_t)pWell->WellFile[0].CurBuffLen);
-			pWell->WellFile[0].CurBuffLen = 0;
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to allocate memory (%d) for buffering file writes",cAllocOutBuffLen);
+			Reset(false);
+			return(eBSFerrMem);
 			}
+		m_AllocdUnmergedP1Seqs = cAllocOutBuffLen;
+		m_CurUnmergedP1Seqs = 0;
+		}
 
-		if (pWell->WellFile[1].hOutFile != -1 && pWell->WellFile[1].CurBuffLen > 0)
+	if(m_hOut3Unmerged != -1 && m_pszUnmergedP2Seqs == NULL)
+		{
+		if((m_pszUnmergedP2Seqs = new char [cAllocOutBuffLen])==NULL)
 			{
-			CUtility::SafeWrite(pWell->WellFile[1].hOutFile, pWell->WellFile[1].pOutBuffer, (size_t)pWell->WellFile[1].CurBuffLen);
-			pWell->WellFile[1].CurBuffLen = 0;
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: unable to allocate memory (%d) for buffering file writes",cAllocOutBuffLen);
+			Reset(false);
+			return(eBSFerrMem);
 			}
+		m_AllocdUnmergedP2Seqs = cAllocOutBuffLen;
+		m_CurUnmergedP2Seqs = 0;
 		}
 	}
 
-if(m_CurMSeqLen > 0)
+m_ProcPhase = ePRdyProc;
+
+// sufficent batches so that workers are not starved whilst the writer is waiting on the next batch in sequence
+// but, as there is a single parser, limited so that memory committed to batches does not scale with the number of threads
+if(m_pBatches == NULL && (Rslt = AllocBatches(min(m_NumThreads + 4,cMergeMaxBatches))) < eBSFSuccess)
+	return(Rslt);
+pBatch = m_pBatches;
+for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++, pBatch++)
+	pBatch->State = eMBSfree;
+
+if((pThreads = new tsMergeThreadPars [m_NumThreads]) == NULL)
 	{
-	CUtility::SafeWrite(m_hOutMerged,m_pszMSeqs,(size_t)m_CurMSeqLen);
-	m_CurMSeqLen = 0;
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: memory allocation for thread context failed");
+	return(eBSFerrMem);
 	}
 
-if(m_CurUnmergedP1Seqs > 0)
+m_StartNum = StartNum;
+m_NxtParseBatchSeq = 0;
+m_NxtPrefixBatchSeq = 0;
+m_NxtWriteBatchSeq = 0;
+m_bParseCompleted = false;
+m_PipelineRslt = eBSFSuccess;
+m_NumPE5Reads = 0;
+m_NumPE3Reads = 0;
+m_CumOverlapping = 0;
+m_CumPEWithBarcode = 0;
+
+memset(&ParseThread,0,sizeof(ParseThread));
+ParseThread.pThis = this;
+#ifdef _WIN32
+ParseThread.threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,MergeParseThread,&ParseThread,0,&ParseThread.threadID);
+#else
+ParseThread.threadRslt = pthread_create(&ParseThread.threadID,NULL,MergeParseThread,&ParseThread);
+#endif
+
+memset(pThreads,0,sizeof(tsMergeThreadPars) * m_NumThreads);
+pThread = pThreads;
+for(ThreadIdx = 1; ThreadIdx <= m_NumThreads; ThreadIdx++, pThread++)
 	{
-	CUtility::SafeWrite(m_hOut5Unmerged,m_pszUnmergedP1Seqs,(size_t)m_CurUnmergedP1Seqs);
-	m_CurUnmergedP1Seqs = 0;
+	pThread->ThreadIdx = ThreadIdx;
+	pThread->pThis = this;
+	pThread->MinObsOverlap = -1;
+	pThread->MaxObsOverlap = -1;
+#ifdef _WIN32
+	pThread->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,MergeProcThread,pThread,0,&pThread->threadID);
+#else
+	pThread->threadRslt = pthread_create(&pThread->threadID,NULL,MergeProcThread,pThread);
+#endif
 	}
 
-if(m_CurUnmergedP2Seqs > 0)
+NumOverlapping = 0;
+NumUnmapped = 0;
+NumPENoBarcode = 0;
+NumPEWithBarcode = 0;
+NumPairsWritten = 0;
+time_t Started = time(0);
+while(1)
 	{
-	CUtility::SafeWrite(m_hOut3Unmerged,m_pszUnmergedP2Seqs,(size_t)m_CurUnmergedP2Seqs);
-	m_CurUnmergedP2Seqs = 0;
+	AcquireSerialise();
+	pBatch = NULL;
+	pCurBatch = m_pBatches;
+	for(BatchIdx = 0; BatchIdx < m_NumBatches; BatchIdx++, pCurBatch++)
+		if(pCurBatch->State == eMBSprocd && pCurBatch->BatchSeq == m_NxtWriteBatchSeq)
+			{
+			pBatch = pCurBatch;
+			break;
+			}
+	bCompleted = m_PipelineRslt < eBSFSuccess || (m_bParseCompleted && m_NxtWriteBatchSeq == m_NxtParseBatchSeq);
+	ReleaseSerialise();
+
+	if(pBatch == NULL)
+		{
+		if(bCompleted)
+			break;
+		CUtility::SleepMillisecs(1);
+		continue;
+		}
+
+	if((Rslt = WriteBatch(pBatch)) < eBSFSuccess)
+		{
+		AcquireSerialise();
+		if(m_PipelineRslt >= eBSFSuccess)
+			m_PipelineRslt = Rslt;
+		ReleaseSerialise();
+		break;
+		}
+	NumPairsWritten += pBatch->NumPairs;
+	NumOverlapping += pBatch->NumOverlapping;
+	NumUnmapped += pBatch->NumUnmapped;
+	NumPEWithBarcode += pBatch->NumPEWithBarcode;
+	NumPENoBarcode += pBatch->NumPENoBarcode;
+
+	AcquireSerialise();
+	pBatch->State = eMBSfree;
+	m_NxtWriteBatchSeq += 1;
+	ReleaseSerialise();
+
+	time_t Now = time(0);
+	unsigned long ElapsedSecs = (unsigned long) (Now - Started);
+	if(ElapsedSecs >= 60)
+		{
+		switch(m_PMode) {
+			case ePMAmplicon:
+				gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d overlapped, %d reported with associated barcodes", NumPairsWritten, NumOverlapping, NumOverlapping - NumUnmapped);
+				break;
+
+			case ePMAmpliconNoMerge:
+				gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d reported with associated barcodes", NumPairsWritten, NumPEWithBarcode);
+				break;
+
+			default:
+				gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads of which %d overlapped", NumPairsWritten, NumOverlapping);
+				break;
+			}
+		Started = Now;
+		}
 	}
 
+#ifdef _WIN32
+WaitForSingleObject(ParseThread.threadHandle,INFINITE);
+CloseHandle(ParseThread.threadHandle);
+#else
+pthread_join(ParseThread.threadID,NULL);
+#endif
+pThread = pThreads;
+for(ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++, pThread++)
+	{
+#ifdef _WIN32
+	WaitForSingleObject(pThread->threadHandle,INFINITE);
+	CloseHandle(pThread->threadHandle);
+#else
+	pthread_join(pThread->threadID,NULL);
+#endif
+	}
+
+FlushOutDests();
+
+if(m_PipelineRslt < eBSFSuccess)
+	{
+	delete []pThreads;
+	m_PE5Fasta.Close();
+	m_PE3Fasta.Close();
+	return(m_PipelineRslt);
+	}
+
+// aggregate the per thread overlap distributions
+memset(OverlapDistCnts,0,sizeof(OverlapDistCnts));
+memset(OverlapDistSubs,0,sizeof(OverlapDistSubs));
+MinObsOverlap = -1;
+MaxObsOverlap = -1;
+pThread = pThreads;
+for(ThreadIdx = 0; ThreadIdx < m_NumThreads; ThreadIdx++, pThread++)
+	{
+	if(pThread->MinObsOverlap != -1 && (MinObsOverlap == -1 || pThread->MinObsOverlap < MinObsOverlap))
+		MinObsOverlap = pThread->MinObsOverlap;
+	if(pThread->MaxObsOverlap != -1 && (MaxObsOverlap == -1 || pThread->MaxObsOverlap > MaxObsOverlap))
+		MaxObsOverlap = pThread->MaxObsOverlap;
+	for(Idx = 0; Idx < ccMaxFastQSeqLen; Idx++)
+		OverlapDistCnts[Idx] += pThread->OverlapDistCnts[Idx];
+	for(Idx = 0; Idx <= cMaxOverlapPercSubs; Idx++)
+		OverlapDistSubs[Idx] += pThread->OverlapDistSubs[Idx];
+	}
+delete []pThreads;
+
 switch (m_PMode)
 	{
 	case ePMAmplicon:
-		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d overlapped, %d reported with associated barcodes", NumPE5Reads, NumOverlapping, NumOverlapping - NumUnmapped);
+		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d overlapped, %d reported with associated barcodes", m_NumPE5Reads, NumOverlapping, NumOverlapping - NumUnmapped);
 		break;
 
 	case ePMAmpliconNoMerge:
-		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d reported with associated barcodes", NumPE5Reads, NumPEWithBarcode);
+		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads, %d reported with associated barcodes", m_NumPE5Reads, NumPEWithBarcode);
 		return(NumPEWithBarcode);
 
 	default:
-		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads of which %d overlapped", NumPE5Reads, NumOverlapping);
+		gDiagnostics.DiagOut(eDLInfo, gszProcName, "Processed %d paired reads of which %d overlapped", m_NumPE5Reads, NumOverlapping);
 		break;
 	}
 
@@ -1825,4 +2483,3 @@ if(NumOverlapping)
 
 return(NumOverlapping);
 }
-
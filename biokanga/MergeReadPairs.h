@@ -32,6 +32,17 @@ const int cMaxOverlapPercSubs = 10;	// maximum allowed substitutions as a percen
 
 const int cAllocOutBuffLen = 0x0fffff; // 1M output buffering when writing to file
 
+const int cMinReadSeqLen = 20;			// raw read sequences must be at least this length
+const int cMaxReadDesrLen = 200;		// allow for read descriptors of no longer than this length
+const int ccMaxFastQSeqLen = 4000;		// allow for amplicon PE sequences of this length
+
+const int cMaxMergeThreads = 128;			// pipeline can use at most this many overlap/barcode worker threads
+const int cMergeBatchPairs = 0x4000;		// each pipeline batch contains at most this many read pairs
+const int cMergeBatchBuffSize = 0x0800000;	// each pipeline batch buffers parsed sequences, qualities and descriptors in this many bytes (8M)
+const int cMergeMaxBatches = 16;			// at most this many pipeline batches in flight, irrespective of the number of worker threads
+const int cMergeMaxPairBytes = (4 * (ccMaxFastQSeqLen + 1)) + (2 * (cMaxReadDesrLen + 1)); // worst case bytes buffered for a single read pair
+const int cMergeOutBuffAlloc = 0x03ffff;	// initial allocation for each batch output buffer, reallocd as may be required
+
 const char cPhredLowScore = 'A';	// generated Phred score used when there was a merge induced substitution in overlay and input sequences were non-fastq
 const char cPhredOrphanScore = 'H';	// generated Phred score used if orphan reads and input sequences were non-fastq
 const char cPhredHiScore = 'J';		// generated Phred score used when there was no merge substitution in overlay and input sequences were non-fastq
@@ -43,6 +54,33 @@ typedef enum TAG_eProcPhase {
 	ePRdyProc					// files opened, ready for processing
 } etProcPhase;
 
+// pipeline batches cycle through these states; parser fills free batches, workers process parsed batches, writer outputs processed batches in BatchSeq order
+typedef enum TAG_eMergeBatchState {
+	eMBSfree = 0,				// batch is available for parsing into
+	eMBSparsing,				// batch is currently being parsed into
+	eMBSparsed,					// batch has been parsed and is ready for processing by a worker thread
+	eMBSproc,					// batch is currently being processed by a worker thread
+	eMBSprocd					// batch has been processed and output formatted, ready for writing
+} etMergeBatchState;
+
+// classification of each read pair after overlap and/or barcode processing
+typedef enum TAG_eMergeClass {
+	eMCNone = 0,				// no output for this pair (no overlap and orphans not being reported)
+	eMCMerged,					// overlap merged, merged sequence to be output
+	eMCMergedUnmapped,			// overlap merged, but unable to map barcodes to a well
+	eMCOrphans,					// not overlapped, both PE3 and PE5 to be output as orphans
+	eMCBarcoded,				// PE barcodes mapped to well, no overlap merging
+	eMCNoBarcode				// unable to map PE barcodes to well
+} etMergeClass;
+
+// output destinations are indexed as follows, well outputs are at eMODWells + ((WellID-1) * 2) + PE end
+typedef enum TAG_eMergeOutDest {
+	eMODMerged = 0,				// merged (and combined orphans) output file
+	eMODUnmergedP1,				// separate PE1 orphans output file
+	eMODUnmergedP2,				// separate PE2 orphans output file
+	eMODWells					// start of well output files
+} etMergeOutDest;
+
 #pragma pack(1)
 
 typedef struct TAG_sMIDsBarcode  // MIDs (Multiplex Identifiers) barcode
@@ -78,6 +116,64 @@ typedef struct TAG_sAmpliconWell {
 	tsAmpliconWellFile WellFile[2]; // if SE then output to 1 file, if PE then each end written to separate files
 } tsAmpliconWell;
 
+typedef struct TAG_sMergePair {
+	UINT8 Class;				// pair classified after processing as etMergeClass
+	UINT16 PlateCell;			// if barcode processing then well identifier (1..N)
+	UINT16 PE5SeqLen;			// PE5 sequence length
+	UINT16 PE3SeqLen;			// PE3 sequence length
+	UINT32 PE5DescrOfs;			// offset in batch pInBuff of '\0' terminated PE5 descriptor
+	UINT32 PE3DescrOfs;			// offset in batch pInBuff of '\0' terminated PE3 descriptor
+	UINT32 PE5SeqOfs;			// offset in batch pInBuff of PE5 sequence (etSeqBase)
+	UINT32 PE3SeqOfs;			// offset in batch pInBuff of PE3 sequence (etSeqBase)
+	UINT32 PE5QualOfs;			// offset in batch pInBuff of '\0' terminated PE5 quality scores (only if fastq)
+	UINT32 PE3QualOfs;			// offset in batch pInBuff of '\0' terminated PE3 quality scores (only if fastq)
+	UINT32 RsltSeqOfs[2];		// offsets in batch pRsltBuff of '\0' terminated ascii sequences to be output
+	UINT32 RsltQualOfs[2];		// offsets in batch pRsltBuff of '\0' terminated quality scores to be output
+} tsMergePair;
+
+typedef struct TAG_sMergeOutBuff {
+	size_t CurLen;				// pBuff currently holds this many formatted chars
+	size_t AllocdLen;			// pBuff allocated to hold this many chars
+	char *pBuff;				// formatted output
+	size_t CurgzLen;			// if compressing then pgzBuff holds this many bytes as a gzip member
+	size_t AllocdgzLen;			// pgzBuff allocated to hold this many bytes
+	UINT8 *pgzBuff;				// gzip member compressed from pBuff
+} tsMergeOutBuff;
+
+typedef struct TAG_sMergeBatch {
+	UINT32 BatchSeq;			// batches are sequentially numbered as parsed, and written in this same order
+	etMergeBatchState State;	// current batch processing state
+	int NumPairs;				// batch contains this many read pairs
+	tsMergePair *pPairs;		// allocated to hold cMergeBatchPairs read pairs
+	size_t InBuffLen;			// pInBuff currently holds this many bytes
+	UINT8 *pInBuff;				// allocated (cMergeBatchBuffSize) to hold parsed sequences, qualities and descriptors
+	size_t RsltBuffLen;			// pRsltBuff currently holds this many bytes
+	UINT8 *pRsltBuff;			// allocated (2 * cMergeBatchBuffSize) to hold merged sequences and qualities
+	int NumOverlapping;			// number of pairs in this batch which overlapped
+	int NumUnmapped;			// number of overlapped pairs in this batch which could not be mapped to a well
+	int NumPEWithBarcode;		// number of pairs in this batch which were mapped to a well without merging
+	int NumPENoBarcode;			// number of pairs in this batch which could not be mapped to a well
+	int NumOutBuffs;			// number of output destination buffers
+	tsMergeOutBuff *pOutBuffs;	// output destination buffers indexed by etMergeOutDest
+} tsMergeBatch;
+
+typedef struct TAG_sMergeThreadPars {
+	int ThreadIdx;					// uniquely identifies this thread
+	void *pThis;					// will be initialised to pt to CMergeReadPairs instance
+#ifdef _WIN32
+	HANDLE threadHandle;			// handle as returned by _beginthreadex()
+	unsigned int threadID;			// identifier as set by _beginthreadex()
+#else
+	int threadRslt;					// result as returned by pthread_create ()
+	pthread_t threadID;				// identifier as set by pthread_create ()
+#endif
+	int MinObsOverlap;				// minimum observed overlap by this thread
+	int MaxObsOverlap;				// maximum observed overlap by this thread
+	int OverlapDistCnts[ccMaxFastQSeqLen];	// overlap length distribution as observed by this thread
+	int OverlapDistSubs[cMaxOverlapPercSubs+1]; // overlap substitutions distribution as observed by this thread
+	int Rslt;						// returned result code
+} tsMergeThreadPars;
+
 #pragma pack()
 
 class CMergeReadPairs
@@ -152,7 +248,81 @@ class CMergeReadPairs
 
 	char *RemoveQuotes(char *pszRawText);
 
+	int m_NumThreads;				// number of pipeline worker threads
+	bool m_bgzOut;					// true if output files are to be gzip compressed
+	int m_StartNum;					// initial starting sequence identifier for file currently being processed
+	int m_NumBatches;				// number of batches in m_pBatches
+	tsMergeBatch *m_pBatches;		// pipeline batches
+	UINT32 m_NxtParseBatchSeq;		// next batch parsed will be assigned this sequence number
+	UINT32 m_NxtPrefixBatchSeq;		// next batch to claim sequence identifiers will be this batch
+	UINT32 m_NxtWriteBatchSeq;		// next batch to be written will be this batch
+	bool m_bParseCompleted;			// set true by parser thread when all read pairs have been parsed or on parse errors
+	int m_PipelineRslt;				// set < eBSFSuccess if any pipeline stage encountered errors
+	int m_NumPE5Reads;				// number of PE5 reads parsed
+	int m_NumPE3Reads;				// number of PE3 reads parsed
+	int m_CumOverlapping;			// cumulative number of overlapping pairs over batches which have claimed sequence identifiers
+	int m_CumPEWithBarcode;			// cumulative number of barcoded pairs over batches which have claimed sequence identifiers
+
+#ifdef _WIN32
+	alignas(4)	volatile unsigned int m_CASSerialise; // used with synchronous compare and swap (CAS) for serialising access to pipeline state
+#else
+	__attribute__((aligned(4))) volatile unsigned int m_CASSerialise; // used with synchronous compare and swap (CAS) for serialising access to pipeline state
+#endif
+	void AcquireSerialise(void);
+	void ReleaseSerialise(void);
+
+	int AllocBatches(int NumBatches);	// allocate pipeline batches
+	void FreeBatches(void);				// free pipeline batches
+
+	int									// returns eBSFSuccess if batch output buffer has at least ReqLen chars available
+		ReqOutBuff(tsMergeOutBuff *pOutBuff, // output buffer
+					size_t ReqLen);			// requires this many available chars
+
+	int									// eBSFSuccess or error code
+		CompressOutBuff(tsMergeOutBuff *pOutBuff);	// compress pOutBuff->pBuff into gzip member pOutBuff->pgzBuff
+
+	int									// returns eBSFSuccess if output was written or buffered
+		WriteOutDest(int DestIdx,			// write to this output destination
+					 void *pBuff,			// output from this buffer
+					 size_t BuffLen);		// this many bytes
+
+	int									// < eBSFSuccess if errors, 0 if no more reads, otherwise read sequence length
+		ParseRead(CFasta *pFasta,			// parse next read from this file
+				char *pszInFile,			// file name, used when reporting parse errors
+				int NumParsed,				// number of reads previously parsed from this file, used when reporting parse errors
+				tsMergeBatch *pBatch,		// parse into this batch
+				UINT32 *pDescrOfs,			// returned offset in batch pInBuff of descriptor
+				UINT32 *pSeqOfs,			// returned offset in batch pInBuff of sequence
+				UINT32 *pQualOfs);			// returned offset in batch pInBuff of quality scores
+
+	int									// < eBSFSuccess if errors, 0 if no more read pairs, otherwise number of read pairs parsed into batch
+		ParseBatch(tsMergeBatch *pBatch);	// parse next batch of read pairs
+
+	int
+		AddRslt(tsMergeBatch *pBatch,		// add to results for this batch
+				tsMergePair *pPair,			// results are for this read pair
+				int RsltIdx,				// result instance (0 or 1)
+				char *pszSeq,				// '\0' terminated ascii sequence
+				char *pszQual);				// '\0' terminated quality scores, NULL if no quality scores to be output
+
+	int									// returns eBSFSuccess or error code
+		ProcBatch(tsMergeBatch *pBatch,		// overlap merge and/or barcode process this batch
+				  tsMergeThreadPars *pPars); // thread specific statistics accumulated into these
+
+	int									// returns eBSFSuccess or error code
+		FormatBatch(tsMergeBatch *pBatch,	// format batch output
+				  int BaseOverlapping,		// sequence identifiers for merged pairs start after this count
+				  int BasePEWithBarcode);	// sequence identifiers for barcoded pairs start after this count
+
+	int WriteBatch(tsMergeBatch *pBatch);	// write formatted batch output to output files
+
+	void FlushOutDests(void);				// write all buffered output to output files
+
 public:
+	int ThreadParse(tsMergeThreadPars *pPars);	// pipeline parser thread
+	int ThreadProc(tsMergeThreadPars *pPars);	// pipeline worker thread
+
+
 	CMergeReadPairs(void);
 	~CMergeReadPairs(void);
 	void Reset(bool bSync = true);   // if bDync true then opened output files will be sync'd (commited) to disk before closing
@@ -175,7 +345,8 @@ public:
 			  char **pszInPE3Files,				// input 3' end if paired end reads files
 			  char *pszMergeOutFile,			// write merged overlaping reads to this file
   			  int StartNum = 1,					// use this initial starting sequence identifier
-  			  bool bAppendOut = false);			// if true then append if output files exist, otherwise trunctate existing output files
+  			  bool bAppendOut = false,			// if true then append if output files exist, otherwise trunctate existing output files
+			  int NumThreads = 1);				// use this many worker threads for overlap and barcode processing
 
 	int													// returns number of sequences merged and written to output file
 		ProcOverlapPairs(int StartNum);		// initial starting sequence identifier
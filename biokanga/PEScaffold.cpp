@@ -360,10 +360,26 @@ if(m_pPEIdents != NULL)
 	m_pPEIdents = NULL;
 	}
 
-if(m_pHashPEIdents)
+if(m_pszPENames != NULL)
 	{
-	delete m_pHashPEIdents;
-	m_pHashPEIdents = NULL;
+#ifdef _WIN32
+	free(m_pszPENames);
+#else
+	if(m_pszPENames != MAP_FAILED)
+		munmap(m_pszPENames,m_AllocdPENamesMem);
+#endif
+	m_pszPENames = NULL;
+	}
+
+if(m_pPEIdentHash != NULL)
+	{
+#ifdef _WIN32
+	free(m_pPEIdentHash);
+#else
+	if(m_pPEIdentHash != MAP_FAILED)
+		munmap(m_pPEIdentHash,m_AllocdPEIdentHashMem);
+#endif
+	m_pPEIdentHash = NULL;
 	}
 
 if(m_pScaffoldContigs != NULL)
@@ -394,22 +410,15 @@ if(m_pScaffolds != NULL)
 	m_pScaffolds = NULL;
 	}
 
-
-if(m_ppPE2Scaffolds != NULL)
-	{
-#ifdef _WIN32
-	free(m_ppPE2Scaffolds);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_ppPE2Scaffolds != MAP_FAILED)
-		munmap(m_ppPE2Scaffolds,m_AllocdPE2ScaffoldsMem);
-#endif
-	m_ppPE2Scaffolds = NULL;
-	}
-
 m_szSeqIDTermChrs[0] = '\0';
 m_AllocdNumPEIdents = 0;
 m_NumPEIdents = 0;
 m_AllocdPEIdentsMem = 0;
+m_PENamesLen = 0;
+m_AllocdPENamesMem = 0;
+m_PEIdentHashMask = 0;
+m_AllocdPEIdentHashMem = 0;
+m_TermLoad = 0;
 
 m_AllocdNumScaffoldContigs = 0;
 m_AllocdScaffoldContigsMem = 0;
@@ -418,19 +427,17 @@ m_NumScaffoldContigs = 0;
 m_AllocdScaffoldsMem = 0;
 m_AllocdNumScaffolds = 0;
 m_NumScaffolds = 0;
-
-m_AllocdPE2ScaffoldsMem = 0;
 }
 
 void 
 CPEScaffold::Init(void)
 {
 m_pPEIdents = NULL;
-m_pHashPEIdents = NULL;
+m_pszPENames = NULL;
+m_pPEIdentHash = NULL;
 m_pScaffoldContigs = NULL;
 m_pHashContigs = NULL;
 m_pScaffolds = NULL;
-m_ppPE2Scaffolds = NULL;
 m_hOutFile = -1;
 Reset();
 }
@@ -532,74 +539,159 @@ pScaffoldContig = &m_pScaffoldContigs[ContigID-1];
 return(pScaffoldContig->szContig);
 }
 
-// AddPEIdent
-// If PE name already known then return existing identifier otherwise add to m_pScaffoldContigs
-int
-CPEScaffold::AddPEIdent(char *pszIdentName)
+// TrimPEIdent
+// Identifiers are only significant up until user specified set of terminating chars, inplace trims at rightmost instance of any of these chars
+void
+CPEScaffold::TrimPEIdent(char *pszIdentName)
 {
-static INT32 PrevPEIdentID = 0;
-tsPEIdent *pPEIdent;
-int Hash;
-int HashIdx;
 int IdentLen;
 char Chr;
 char TermChr;
 char *pIdentChr;
 char *pTermChr;
 
-// identifiers are only significant up until user specified set of terminating chars
-if(m_szSeqIDTermChrs[0] != '\0')
+if(m_szSeqIDTermChrs[0] == '\0')
+	return;
+if((IdentLen = (int)strlen(pszIdentName)) < 4)		// don't bother triming identifiers which are too short..
+	return;
+pIdentChr = &pszIdentName[IdentLen-1];			// search for terminating char starts from last char ...
+IdentLen -= 3;									// ensures identifiers after trimming are at least 3 chrs long
+while(IdentLen--)
 	{
-	if((IdentLen = (int)strlen(pszIdentName)) >= 4)		// don't bother triming identifiers which are too short..
+	Chr = *pIdentChr--;
+	pTermChr = m_szSeqIDTermChrs;
+	while((TermChr = *pTermChr++) != '\0')
 		{
-		pIdentChr = &pszIdentName[IdentLen-1];			// search for terminating char starts from last char ...
-		IdentLen -= 3;									// ensures identifiers after trimming are at least 3 chrs long
-		while(IdentLen--)
+		if(Chr == TermChr)
 			{
-			Chr = *pIdentChr--;
-			pTermChr = m_szSeqIDTermChrs;
-			while((TermChr = *pTermChr++) != '\0')
-				{
-				if(Chr == TermChr)
-					{
-					pIdentChr[1] = '\0';
-					break;
-					}
-				}
-			if(pIdentChr[1] == '\0')
-				break;
+			pIdentChr[1] = '\0';
+			break;
 			}
 		}
+	if(pIdentChr[1] == '\0')
+		break;
+	}
+}
+
+// GenNameHash
+// FNV-1a hash of lowercased name, names are compared case insensitively so hash must also be case insensitive
+UINT32
+CPEScaffold::GenNameHash(char *pszName)
+{
+UINT32 Hash;
+UINT8 Chr;
+Hash = 2166136261;
+while((Chr = (UINT8)*pszName++) != '\0')
+	{
+	Hash ^= (UINT32)tolower(Chr);
+	Hash *= 16777619;
 	}
+return(Hash);
+}
+
+// GrowPEIdentHash
+// Allocates PE identifier hash, or if already allocated then doubles the number of slots and rehashes all known identifiers
+int
+CPEScaffold::GrowPEIdentHash(void)
+{
+UINT32 *pNewHash;
+UINT32 NewMask;
+UINT32 SlotIdx;
+size_t memreq;
+int Idx;
+tsPEIdent *pPEIdent;
+
+if(m_pPEIdentHash == NULL)
+	NewMask = ((UINT32)1 << cPEIdentHashInitBits) - 1;
+else
+	{
+	if(m_PEIdentHashMask >= ((UINT32)1 << cPEIdentHashMaxBits) - 1)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"GrowPEIdentHash: Number of PE identifiers exceeds hash capacity");
+		return(eBSFerrMaxEntries);
+		}
+	NewMask = (m_PEIdentHashMask << 1) | 1;
+	}
+memreq = ((size_t)NewMask + 1) * sizeof(UINT32);
+#ifdef _WIN32
+pNewHash = (UINT32 *)malloc(memreq);
+if(pNewHash == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"GrowPEIdentHash: Memory allocation of %lld bytes - %s",(INT64)memreq,strerror(errno));
+	return(eBSFerrMem);
+	}
+memset(pNewHash,0,memreq);
+#else
+pNewHash = (UINT32 *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
+if(pNewHash == MAP_FAILED)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"GrowPEIdentHash: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)memreq,strerror(errno));
+	return(eBSFerrMem);
+	}
+#endif
+
+pPEIdent = m_pPEIdents;
+for(Idx = 1; Idx <= m_NumPEIdents; Idx++, pPEIdent++)
+	{
+	SlotIdx = pPEIdent->NameHash & NewMask;
+	while(pNewHash[SlotIdx] != 0)
+		SlotIdx = (SlotIdx + 1) & NewMask;
+	pNewHash[SlotIdx] = (UINT32)Idx;
+	}
+
+if(m_pPEIdentHash != NULL)
+	{
+#ifdef _WIN32
+	free(m_pPEIdentHash);
+#else
+	munmap(m_pPEIdentHash,m_AllocdPEIdentHashMem);
+#endif
+	}
+m_pPEIdentHash = pNewHash;
+m_AllocdPEIdentHashMem = memreq;
+m_PEIdentHashMask = NewMask;
+return(eBSFSuccess);
+}
+
+// AddPEIdent
+// If PE name already known then return existing identifier otherwise add to m_pPEIdents
+// Caller is expected to have already trimmed the identifier name
+int
+CPEScaffold::AddPEIdent(char *pszIdentName,UINT32 NameHash)
+{
+static INT32 PrevPEIdentID = 0;
+tsPEIdent *pPEIdent;
+char *pszPENames;
+UINT32 SlotIdx;
+int Rslt;
+int IdentLen;
+size_t memreq;
 
 // check to see if PEIdent name already known
 if(PrevPEIdentID != 0)
 	{
 	pPEIdent = &m_pPEIdents[PrevPEIdentID-1];
-	if(!stricmp(pszIdentName,pPEIdent->szIdent))
-		return(pPEIdent->IdentID);
+	if(pPEIdent->NameHash == NameHash && !stricmp(pszIdentName,&m_pszPENames[pPEIdent->NameOfs]))
+		return(PrevPEIdentID);
 	}
 
-Hash = CUtility::GenHash24(pszIdentName);
-if((HashIdx = m_pHashPEIdents[Hash]) != 0)
+SlotIdx = NameHash & m_PEIdentHashMask;
+while((Rslt = (int)m_pPEIdentHash[SlotIdx]) != 0)
 	{
-	do {
-		pPEIdent = &m_pPEIdents[HashIdx-1];
-		if(!stricmp(pszIdentName,pPEIdent->szIdent))
-			{
-			PrevPEIdentID = pPEIdent->IdentID;
-			return( pPEIdent->IdentID);
-			}
-		HashIdx = pPEIdent->HashNext;
+	pPEIdent = &m_pPEIdents[Rslt-1];
+	if(pPEIdent->NameHash == NameHash && !stricmp(pszIdentName,&m_pszPENames[pPEIdent->NameOfs]))
+		{
+		PrevPEIdentID = Rslt;
+		return(Rslt);
 		}
-	while(HashIdx > 0);
+	SlotIdx = (SlotIdx + 1) & m_PEIdentHashMask;
 	}
 
 // its a new PE identifier not previously seen
-// realloc as may be required to hold this new chrom
+// realloc as may be required to hold this new identifier and its name
 if(m_NumPEIdents == m_AllocdNumPEIdents)
 	{
-	size_t memreq = m_AllocdPEIdentsMem + (cAllocPENames * sizeof(tsPEIdent));
+	memreq = m_AllocdPEIdentsMem + (cAllocPENames * sizeof(tsPEIdent));
 #ifdef _WIN32
 	pPEIdent = (tsPEIdent *) realloc(m_pPEIdents,memreq);
 #else
@@ -609,7 +701,7 @@ if(m_NumPEIdents == m_AllocdNumPEIdents)
 #endif
 	if(pPEIdent == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddPEIdent: Memory re-allocation to %d bytes - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddPEIdent: Memory re-allocation to %lld bytes - %s",(INT64)memreq,strerror(errno));
 		return(eBSFerrMem);
 		}
 	m_pPEIdents = pPEIdent;
@@ -617,14 +709,39 @@ if(m_NumPEIdents == m_AllocdNumPEIdents)
 	m_AllocdNumPEIdents += cAllocPENames;
 	}
 
+IdentLen = (int)strlen(pszIdentName);
+if((size_t)(m_PENamesLen + IdentLen + 1) >= m_AllocdPENamesMem)
+	{
+	memreq = m_AllocdPENamesMem + cAllocPENameChrs;
+#ifdef _WIN32
+	pszPENames = (char *) realloc(m_pszPENames,memreq);
+#else
+	pszPENames = (char *)mremap(m_pszPENames,m_AllocdPENamesMem,memreq,MREMAP_MAYMOVE);
+	if(pszPENames == MAP_FAILED)
+		pszPENames = NULL;
+#endif
+	if(pszPENames == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddPEIdent: Memory re-allocation to %lld bytes - %s",(INT64)memreq,strerror(errno));
+		return(eBSFerrMem);
+		}
+	m_pszPENames = pszPENames;
+	m_AllocdPENamesMem = memreq;
+	}
+
 pPEIdent = &m_pPEIdents[m_NumPEIdents++];
-pPEIdent->IdentID = m_NumPEIdents;
+pPEIdent->NameOfs = m_PENamesLen;
+pPEIdent->NameHash = NameHash;
 pPEIdent->PEScafoldID = 0;
-pPEIdent->HashNext = m_pHashPEIdents[Hash];
-m_pHashPEIdents[Hash] = m_NumPEIdents;
-strncpy(pPEIdent->szIdent,pszIdentName,cMaxContigNameLen);
-pPEIdent->szIdent[cMaxContigNameLen] = '\0';
+memcpy(&m_pszPENames[m_PENamesLen],pszIdentName,IdentLen+1);
+m_PENamesLen += IdentLen + 1;
+m_pPEIdentHash[SlotIdx] = (UINT32)m_NumPEIdents;
 PrevPEIdentID = m_NumPEIdents;
+
+// keeping hash at most half full ensures linear probe sequences remain short
+if((UINT32)m_NumPEIdents > (m_PEIdentHashMask >> 1))
+	if((Rslt = GrowPEIdentHash()) < eBSFSuccess)
+		return(Rslt);
 return(m_NumPEIdents);
 }
 
@@ -633,12 +750,13 @@ CPEScaffold::GetSeqName(int SeqID)
 {
 tsPEIdent *pIdent;
 pIdent = &m_pPEIdents[SeqID-1];
-return(pIdent->szIdent);
+return(&m_pszPENames[pIdent->NameOfs]);
 }
 
 int
 CPEScaffold::AddScaffold(bool bPE2,						// if false then PE1, if true then PE2
 			char *pszPEIdent,				// paired end indentifier used to corelate paired ends
+			UINT32 NameHash,				// paired end identifier has this hash
 			char *pszContig,					// PE aligns onto this chromosome
 			char Strand)					// '+' or '-'
 {
@@ -648,8 +766,10 @@ tsPEIdent *pPEIdent;
 int ContigID;
 int PEIdentID;
 
-ContigID = AddContigName(pszContig);
-PEIdentID = AddPEIdent(pszPEIdent);
+if((ContigID = AddContigName(pszContig)) < 1)
+	return(ContigID);
+if((PEIdentID = AddPEIdent(pszPEIdent,NameHash)) < 1)
+	return(PEIdentID);
 
 // if processing PE2 then check to see if already have scaffold with same PEIdent
 if(bPE2)
@@ -723,9 +843,11 @@ else
 return(m_NumScaffolds);
 }
 
+// LoadSAM
+// Parses alignments from SAM/BAM file, mapped alignments are either registered as scaffolds as they are parsed or,
+// if pPars->bBuffer, buffered for later registration so that parsing can proceed concurrently with registration of the other PE file
 int
-CPEScaffold::LoadSAM(bool bPE2,			// false if loading PE1, true if loading PE2
-		char *pszSAMFile)	// load alignments from this SAM file
+CPEScaffold::LoadSAM(tsPESAMLoadPars *pPars)	// load alignments from SAM/BAM file, registering or buffering as specified in pPars
 {
 int Rslt;
 etClassifyFileType FileType;
@@ -739,8 +861,16 @@ char szContig[128];				// parsed out chrom
 int StartLoci;					// start loci
 int NumUnmappedEls;
 int ScaffoldID;
+UINT32 NameHash;
 CSAMfile BAMfile;
 int LineLen;
+bool bPE2;
+char *pszSAMFile;
+
+bPE2 = pPars->bPE2;
+pszSAMFile = pPars->pszSAMFile;
+pPars->NumParsedElLines = 0;
+pPars->NumAcceptedEls = 0;
 
 	// open SAM for reading
 if(pszSAMFile == NULL || *pszSAMFile == '\0')
@@ -767,9 +897,15 @@ NumUnmappedEls = 0;
 
 while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
 	{
+	if(m_TermLoad)				// other loading thread may have failed
+		{
+		BAMfile.Close();
+		return(eBSFerrInternal);
+		}
 	NumParsedElLines += 1;
 	if(!(NumParsedElLines % 1000000) || NumParsedElLines == 1)
-		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Parsed %d SAM lines",NumParsedElLines);
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Parsed %d %s SAM lines",NumParsedElLines,bPE2 ? "PE2" : "PE1");
+	pPars->NumParsedElLines = NumParsedElLines;
 
 	szLine[sizeof(szLine)-1] = '\0';
 	pTxt = TrimWhitespace(szLine);
@@ -786,12 +922,19 @@ while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
 	    continue;
 		}
 
-	if((ScaffoldID = AddScaffold(bPE2,szDescriptor,szContig,Flags & 0x10 ? '+' : '-')) < 1)
+	TrimPEIdent(szDescriptor);
+	NameHash = GenNameHash(szDescriptor);
+	if(pPars->bBuffer)
+		ScaffoldID = BufferAlign(pPars,szDescriptor,NameHash,szContig,Flags & 0x10 ? '+' : '-');
+	else
+		ScaffoldID = AddScaffold(bPE2,szDescriptor,NameHash,szContig,Flags & 0x10 ? '+' : '-');
+	if(ScaffoldID < 1)
 		{
 		BAMfile.Close();
-		return(ScaffoldID);
+		return(ScaffoldID == 0 ? eBSFerrParse : ScaffoldID);
 		}
 	NumAcceptedEls += 1;
+	pPars->NumAcceptedEls = NumAcceptedEls;
 	}
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Loading alignments (%d) for %s from: '%s' completed",NumAcceptedEls,bPE2 ? "PE2" : "PE1", pszSAMFile);
@@ -799,6 +942,227 @@ BAMfile.Close();
 return(NumAcceptedEls);
 }
 
+int									// returns 1 if alignment buffered, < 0 if errors
+CPEScaffold::BufferAlign(tsPESAMLoadPars *pPars,	// buffer alignment for later registration
+			char *pszPEIdent,				// paired end indentifier used to corelate paired ends
+			UINT32 NameHash,				// paired end identifier has this hash
+			char *pszContig,				// PE aligns onto this Contig
+			char Strand)					// '+' or '-'
+{
+tsPESAMAlign *pAlign;
+tsPESAMAlign *pPrevAlign;
+char *pszNames;
+size_t memreq;
+int IdentLen;
+int ContigLen;
+bool bNewContig;
+
+if(pPars->NumAligns == pPars->AllocdNumAligns)
+	{
+	memreq = pPars->AllocdAlignsMem + (cAllocPESAMAligns * sizeof(tsPESAMAlign));
+#ifdef _WIN32
+	pAlign = (tsPESAMAlign *) realloc(pPars->pAligns,memreq);
+#else
+	if(pPars->pAligns == NULL)
+		pAlign = (tsPESAMAlign *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
+	else
+		pAlign = (tsPESAMAlign *)mremap(pPars->pAligns,pPars->AllocdAlignsMem,memreq,MREMAP_MAYMOVE);
+	if(pAlign == MAP_FAILED)
+		pAlign = NULL;
+#endif
+	if(pAlign == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"BufferAlign: Memory re-allocation to %lld bytes - %s",(INT64)memreq,strerror(errno));
+		return(eBSFerrMem);
+		}
+	pPars->pAligns = pAlign;
+	pPars->AllocdAlignsMem = memreq;
+	pPars->AllocdNumAligns += cAllocPESAMAligns;
+	}
+
+// alignments are usually sorted by contig so contig names are only copied when changed from the preceding alignment
+pPrevAlign = pPars->NumAligns ? &pPars->pAligns[pPars->NumAligns-1] : NULL;
+bNewContig = pPrevAlign == NULL || strcmp(pszContig,&pPars->pszNames[pPrevAlign->ContigOfs]);
+
+IdentLen = (int)strlen(pszPEIdent);
+ContigLen = bNewContig ? (int)strlen(pszContig) : 0;
+if((size_t)(pPars->NamesLen + IdentLen + ContigLen + 2) >= pPars->AllocdNamesMem)
+	{
+	memreq = pPars->AllocdNamesMem + cAllocPENameChrs;
+#ifdef _WIN32
+	pszNames = (char *) realloc(pPars->pszNames,memreq);
+#else
+	if(pPars->pszNames == NULL)
+		pszNames = (char *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
+	else
+		pszNames = (char *)mremap(pPars->pszNames,pPars->AllocdNamesMem,memreq,MREMAP_MAYMOVE);
+	if(pszNames == MAP_FAILED)
+		pszNames = NULL;
+#endif
+	if(pszNames == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"BufferAlign: Memory re-allocation to %lld bytes - %s",(INT64)memreq,strerror(errno));
+		return(eBSFerrMem);
+		}
+	pPars->pszNames = pszNames;
+	pPars->AllocdNamesMem = memreq;
+	}
+
+pAlign = &pPars->pAligns[pPars->NumAligns++];
+pAlign->NameHash = NameHash;
+pAlign->Strand = Strand;
+pAlign->NameOfs = pPars->NamesLen;
+memcpy(&pPars->pszNames[pPars->NamesLen],pszPEIdent,IdentLen+1);
+pPars->NamesLen += IdentLen + 1;
+if(bNewContig)
+	{
+	pAlign->ContigOfs = pPars->NamesLen;
+	memcpy(&pPars->pszNames[pPars->NamesLen],pszContig,ContigLen+1);
+	pPars->NamesLen += ContigLen + 1;
+	}
+else
+	pAlign->ContigOfs = pPrevAlign->ContigOfs;
+return(1);
+}
+
+// AddBufferedAligns
+// Alignments are registered in the order in which they were parsed so contig and PE identifiers are
+// the same as if the file had been parsed and registered without buffering
+int
+CPEScaffold::AddBufferedAligns(tsPESAMLoadPars *pPars)
+{
+INT64 Idx;
+int ScaffoldID;
+tsPESAMAlign *pAlign;
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Registering %lld buffered %s alignments",pPars->NumAligns,pPars->bPE2 ? "PE2" : "PE1");
+pAlign = pPars->pAligns;
+for(Idx = 0; Idx < pPars->NumAligns; Idx++, pAlign++)
+	{
+	ScaffoldID = AddScaffold(pPars->bPE2,&pPars->pszNames[pAlign->NameOfs],pAlign->NameHash,&pPars->pszNames[pAlign->ContigOfs],pAlign->Strand);
+	if(ScaffoldID < 1)
+		return(ScaffoldID == 0 ? eBSFerrParse : ScaffoldID);
+	}
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Registering buffered %s alignments completed",pPars->bPE2 ? "PE2" : "PE1");
+return(pPars->NumAcceptedEls);
+}
+
+void
+CPEScaffold::FreeBufferedAligns(tsPESAMLoadPars *pPars)
+{
+if(pPars->pAligns != NULL)
+	{
+#ifdef _WIN32
+	free(pPars->pAligns);
+#else
+	munmap(pPars->pAligns,pPars->AllocdAlignsMem);
+#endif
+	pPars->pAligns = NULL;
+	}
+if(pPars->pszNames != NULL)
+	{
+#ifdef _WIN32
+	free(pPars->pszNames);
+#else
+	munmap(pPars->pszNames,pPars->AllocdNamesMem);
+#endif
+	pPars->pszNames = NULL;
+	}
+pPars->NumAligns = 0;
+pPars->AllocdNumAligns = 0;
+pPars->AllocdAlignsMem = 0;
+pPars->NamesLen = 0;
+pPars->AllocdNamesMem = 0;
+}
+
+// Thread startup for SAM/BAM loading
+#ifdef _WIN32
+unsigned int __stdcall CPEScaffold::SAMLoadThreadStart(void *args)
+{
+#else
+void * CPEScaffold::SAMLoadThreadStart(void *args)
+{
+#endif
+tsPESAMLoadPars *pArgs = (tsPESAMLoadPars *)args;
+pArgs->Rslt = pArgs->pThis->LoadSAM(pArgs);
+if(pArgs->Rslt < 0)
+	pArgs->pThis->m_TermLoad = 1;		// let the other loading thread know that it should terminate
+#ifdef _WIN32
+ExitThread(1);
+#else
+return NULL;
+#endif
+}
+
+// LoadPESAMs
+// PE1 and PE2 files are parsed, and BAM BGZF blocks decompressed, concurrently on their own threads
+// PE1 alignments are registered as parsed whilst PE2 alignments are buffered, then registered after PE1 loading has completed
+// so that identifiers and scaffolds are the same as if the files had been loaded sequentially
+int
+CPEScaffold::LoadPESAMs(char *pszInPE1File,	// concurrently load PE1 alignments from this file
+			char *pszInPE2File)		// and PE2 alignments from this file
+{
+int Rslt;
+int ThreadIdx;
+int NumStarted;
+tsPESAMLoadPars LoadPars[2];
+
+memset(LoadPars,0,sizeof(LoadPars));
+m_TermLoad = 0;
+for(ThreadIdx = 0; ThreadIdx < 2; ThreadIdx++)
+	{
+	LoadPars[ThreadIdx].ThreadIdx = ThreadIdx + 1;
+	LoadPars[ThreadIdx].pThis = this;
+	LoadPars[ThreadIdx].bPE2 = ThreadIdx == 1;
+	LoadPars[ThreadIdx].bBuffer = ThreadIdx == 1;
+	LoadPars[ThreadIdx].pszSAMFile = ThreadIdx == 0 ? pszInPE1File : pszInPE2File;
+#ifdef _WIN32
+	LoadPars[ThreadIdx].threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,SAMLoadThreadStart,&LoadPars[ThreadIdx],0,&LoadPars[ThreadIdx].threadID);
+	if(LoadPars[ThreadIdx].threadHandle == NULL)
+#else
+	LoadPars[ThreadIdx].threadRslt = pthread_create(&LoadPars[ThreadIdx].threadID,NULL,SAMLoadThreadStart,&LoadPars[ThreadIdx]);
+	if(LoadPars[ThreadIdx].threadRslt != 0)
+#endif
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadPESAMs: Unable to start %s loading thread",ThreadIdx == 0 ? "PE1" : "PE2");
+		LoadPars[ThreadIdx].Rslt = eBSFerrInternal;
+		m_TermLoad = 1;			// let any started loading thread know that it should terminate
+		break;
+		}
+	}
+NumStarted = ThreadIdx;
+
+// wait for started threads to have completed, periodically letting user know that loading is progressing
+for(ThreadIdx = 0; ThreadIdx < NumStarted; ThreadIdx++)
+	{
+#ifdef _WIN32
+	while(WAIT_TIMEOUT == WaitForSingleObject(LoadPars[ThreadIdx].threadHandle, 60000))
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - accepted alignments PE1: %d, PE2: %d",LoadPars[0].NumAcceptedEls,LoadPars[1].NumAcceptedEls);
+	CloseHandle(LoadPars[ThreadIdx].threadHandle);
+#else
+	struct timespec ts;
+	int JoinRlt;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += 60;
+	while((JoinRlt = pthread_timedjoin_np(LoadPars[ThreadIdx].threadID, NULL, &ts)) != 0)
+		{
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress - accepted alignments PE1: %d, PE2: %d",LoadPars[0].NumAcceptedEls,LoadPars[1].NumAcceptedEls);
+		ts.tv_sec += 60;
+		}
+#endif
+	}
+
+if(LoadPars[0].Rslt < 1 || LoadPars[1].Rslt < 1)
+	{
+	FreeBufferedAligns(&LoadPars[1]);
+	return(LoadPars[0].Rslt < 1 ? LoadPars[0].Rslt : LoadPars[1].Rslt);
+	}
+
+Rslt = AddBufferedAligns(&LoadPars[1]);
+FreeBufferedAligns(&LoadPars[1]);
+return(Rslt);
+}
+
 // locate scaffold having matching PE1ContigID and PE2ContigID
 // assumes scaffolds have been sorted PE1ContigID.PE2ContigID ascending
 tsPEScaffold *
@@ -841,214 +1205,86 @@ while(Hi >= Lo);
 return(NULL);		// unable to match any
 }
 
-// locate scaffold having matching ContigID as PE1
-// assumes scaffolds have been sorted PE1ContigID.PE2ContigID ascending
+// FindClusterRoot
+// Union-find root of cluster containing ContigIdx, path halving keeps subsequent finds near constant time
 int
-CPEScaffold::LocatePE1Scaffold(int ContigID) // locate scaffold having matching ContigID for PE1
-{
-int Mark;
-int Mid;
-int Hi;
-int Lo;
-tsPEScaffold *pEl1;
-if(m_ppPE2Scaffolds == NULL || m_NumScaffolds == 0)		// better safe than sorry...
-	return(0);
-Lo = 0;
-Hi = m_NumScaffolds-1;
-do {
-	Mid = (Hi + Lo) / 2;
-	pEl1 = &m_pScaffolds[Mid];
-	if(pEl1->PE1ContigID == ContigID)
-		{
-		// drill down to locate 1st instance - linear drill down as not expecting too many instances
-		Mark = Mid;
-		while(Mid--)
-			{
-			pEl1 -= 1;
-			if(pEl1->PE1ContigID != ContigID)
-				break;
-			Mark = Mid;
-			}
-		return(Mark+1);
-		}
-	else
-		{
-		if(pEl1->PE1ContigID > ContigID)
-			Hi = Mid - 1;
-		else
-			Lo = Mid + 1;
-		}
-	}
-while(Hi >= Lo);
-return(0);		// unable to match any
-}
-
-// locate scaffold having matching ContigID as PE2
-// assumes scaffolds have been sorted PE1ContigID.PE2ContigID ascending
-int											// returns 0 if unable to locate
-CPEScaffold::LocatePE2Scaffold(int ContigID) // locates scaffold having matching ContigID as PE2
-{
-int Mark;
-int Mid;
-int Hi;
-int Lo;
-tsPEScaffold *pEl1;
-if(m_ppPE2Scaffolds == NULL || m_NumScaffolds == 0)		// better safe than sorry...
-	return(0);
-Lo = 0;
-Hi = m_NumScaffolds-1;
-do {
-	Mid = (Hi + Lo) / 2;
-	pEl1 = m_ppPE2Scaffolds[Mid];
-	if(pEl1->PE2ContigID == ContigID)
-		{
-		// drill down to locate 1st instance - linear drill down as not expecting too many instances
-		Mark = Mid;
-		while(Mid--)
-			{
-			pEl1 = m_ppPE2Scaffolds[Mid];
-			if(pEl1->PE2ContigID != ContigID)
-				break;
-			Mark = Mid;
-			}
-		return(Mark+1);
-		}
-	else
-		{
-		if(pEl1->PE2ContigID > ContigID)
-			Hi = Mid - 1;
-		else
-			Lo = Mid + 1;
-		}
-	}
-while(Hi >= Lo);
-return(0);		// unable to match any
-}
-
-
-int						// returned next CurIdx to use on a subsequent call to IterPE1s (0 if all scaffords have been iterated)
-CPEScaffold::IterPE1s(int CurIdx,	// iterates, in PE1ContigID.PE2ContigID ascending order, all tsPEScaffolds, to start iterations
-		int ContigID,				// iterate for this PE1 chrom/contig
-		tsPEScaffold **ppPEScaffold)	// returned scafford or NULL if all scaffords have been iterated
-{
-tsPEScaffold *pScaffold;
-
-if(ppPEScaffold != NULL)
-	*ppPEScaffold = NULL;
-if(CurIdx < 0 || CurIdx >= m_NumScaffolds)
-	return(0);
-if(CurIdx == 0)
-	{
-	CurIdx = LocatePE1Scaffold(ContigID);
-	if(CurIdx == 0)
-		return(0);
-	CurIdx -= 1;
-	pScaffold = &m_pScaffolds[CurIdx];
-	}
-else
-	{
-	pScaffold = &m_pScaffolds[CurIdx];
-	if(pScaffold->PE1ContigID != ContigID)
-		return(0);
-	}
-
-if(ppPEScaffold != NULL)
-	*ppPEScaffold = pScaffold;
-return(CurIdx + 1);
-}
-
-int						// returned next CurIdx to use on a subsequent call to IterPE2s (0 if all scaffords have been iterated)
-CPEScaffold::IterPE2s(int CurIdx,	// iterates, in PE2ContigID.PE1ContigID ascending order, all tsPEScaffolds, 0 to start iterations
-		int ContigID,				// iterate for this PE2 chrom/contig
-		tsPEScaffold **ppPEScaffold)	// returned scafford or NULL if all scaffords have been iterated
+CPEScaffold::FindClusterRoot(int *pParents,	// contig union-find parents
+			   int ContigIdx)				// returns index of root contig for cluster containing this contig
 {
-tsPEScaffold *pScaffold;
-
-if(ppPEScaffold != NULL)
-	*ppPEScaffold = NULL;
-if(CurIdx < 0 || CurIdx >= m_NumScaffolds)
-	return(0);
-
-if(CurIdx == 0)
+while(pParents[ContigIdx] != ContigIdx)
 	{
-	CurIdx = LocatePE2Scaffold(ContigID);
-	if(CurIdx == 0)
-		return(0);
-	CurIdx -= 1;
+	pParents[ContigIdx] = pParents[pParents[ContigIdx]];
+	ContigIdx = pParents[ContigIdx];
 	}
-pScaffold = m_ppPE2Scaffolds[CurIdx];
-if(pScaffold->PE2ContigID != ContigID)
-	return(0);
-
-if(ppPEScaffold != NULL)
-	*ppPEScaffold = pScaffold;
-return(CurIdx + 1);
-}
-
-int
-CPEScaffold::RecurseCluster(int ClusterID,		// identifies the cluster (1..N) to be associated with all scaffolded chrom/contigs
-			   int ContigID)						// starting from this chrom/contig (1..N)
-{
-int CurIdx;
-tsPEScaffoldContig *pScaffoldContig;
-tsPEScaffold *pScaffold;
-if(ContigID == 0)
-	return(0);
-
-pScaffoldContig = &m_pScaffoldContigs[ContigID-1];
-if(pScaffoldContig->ClusterID > 0)		
-	return(0);
-pScaffoldContig->ClusterID = ClusterID;
-
-CurIdx = 0;
-while((CurIdx = IterPE1s(CurIdx,ContigID,&pScaffold)) > 0)
-	if(pScaffold->PE1ContigID != pScaffold->PE2ContigID)
-		RecurseCluster(ClusterID,pScaffold->PE2ContigID);	
-CurIdx = 0;
-while((CurIdx = IterPE2s(CurIdx,ContigID,&pScaffold)) > 0)
-	if(pScaffold->PE1ContigID != pScaffold->PE2ContigID)
-		RecurseCluster(ClusterID,pScaffold->PE1ContigID);	
-return(0);
+return(ContigIdx);
 }
 
-
+// IdentifyClusters
+// Contigs linked by PE scaffolds are iteratively unioned (by cluster size) into clusters, clusters are then identified (1..N) in
+// order of their lowest indexed contig
 int												// returns largest cluster size
 CPEScaffold::IdentifyClusters(void)				// indentify cluster sizes
 {
 int ClusterID;
 int MaxNumClustered;
 int Idx;
-int *pNumClusterCnts;
+int Root1;
+int Root2;
+int *pParents;
+int *pSizes;
 tsPEScaffoldContig *pContig;
+tsPEScaffold *pScaffold;
 
 ClusterID = 0;
-pContig = m_pScaffoldContigs;
-for(Idx = 0; Idx < m_NumScaffoldContigs; Idx++,pContig++)
-	if(pContig->ClusterID == 0)
+MaxNumClustered = 0;
+if(m_NumScaffoldContigs)
+	{
+	pParents = new int [m_NumScaffoldContigs];
+	pSizes = new int [m_NumScaffoldContigs];
+	for(Idx = 0; Idx < m_NumScaffoldContigs; Idx++)
 		{
-		ClusterID += 1;
-		RecurseCluster(ClusterID,pContig->ContigID);
+		pParents[Idx] = Idx;
+		pSizes[Idx] = 1;
 		}
 
-if(ClusterID)
-	{
-	// clusters identified, for each cluster count the number of members
-	MaxNumClustered = 0;
-	pNumClusterCnts = new int [ClusterID];
-	memset(pNumClusterCnts,0,sizeof(int) * ClusterID);
+	pScaffold = m_pScaffolds;
+	for(Idx = 0; Idx < m_NumScaffolds; Idx++,pScaffold++)
+		{
+		if(pScaffold->PE1ContigID == 0 || pScaffold->PE2ContigID == 0 || pScaffold->PE1ContigID == pScaffold->PE2ContigID)
+			continue;
+		Root1 = FindClusterRoot(pParents,pScaffold->PE1ContigID-1);
+		Root2 = FindClusterRoot(pParents,pScaffold->PE2ContigID-1);
+		if(Root1 == Root2)
+			continue;
+		if(pSizes[Root1] < pSizes[Root2])
+			{
+			pParents[Root1] = Root2;
+			pSizes[Root2] += pSizes[Root1];
+			}
+		else
+			{
+			pParents[Root2] = Root1;
+			pSizes[Root1] += pSizes[Root2];
+			}
+		}
+
+	// clusters identified, each contig is associated with its cluster and the number of contigs in that cluster
 	pContig = m_pScaffoldContigs;
 	for(Idx = 0; Idx < m_NumScaffoldContigs; Idx++,pContig++)
-		if(pContig->ClusterID > 0)
-			pNumClusterCnts[pContig->ClusterID-1] += 1;
+		pContig->ClusterID = 0;
 	pContig = m_pScaffoldContigs;
 	for(Idx = 0; Idx < m_NumScaffoldContigs; Idx++,pContig++)
-		if(pContig->ClusterID > 0)
-			{
-			pContig->NumClustered = pNumClusterCnts[pContig->ClusterID-1];
-			if(MaxNumClustered < pContig->NumClustered)
-				MaxNumClustered = pContig->NumClustered;
-			}
-	delete pNumClusterCnts;
+		{
+		Root1 = FindClusterRoot(pParents,Idx);
+		if(m_pScaffoldContigs[Root1].ClusterID == 0)
+			m_pScaffoldContigs[Root1].ClusterID = ++ClusterID;
+		pContig->ClusterID = m_pScaffoldContigs[Root1].ClusterID;
+		pContig->NumClustered = pSizes[Root1];
+		if(MaxNumClustered < pContig->NumClustered)
+			MaxNumClustered = pContig->NumClustered;
+		}
+	delete []pParents;
+	delete []pSizes;
 	}
 m_NumClusters = ClusterID;
 m_MaxNumClustered = MaxNumClustered;
@@ -1371,22 +1607,42 @@ m_AllocdPEIdentsMem = memreq;
 m_AllocdNumPEIdents = cAllocPENames;
 m_NumPEIdents = 0;
 
-m_pHashPEIdents = new int [cHashSize];
-if(m_pHashPEIdents == NULL)
+memreq = cAllocPENameChrs;	
+#ifdef _WIN32
+m_pszPENames = (char *) malloc(memreq);	// initial and perhaps the only allocation
+
+if(m_pszPENames == NULL)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %d bytes for m_pHashPEIdents - %s",cHashSize * sizeof(int),strerror(errno));
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes for m_pszPENames - %s",(INT64)memreq,strerror(errno));
 	Reset();
 	return(eBSFerrMem);
 	}
-memset(m_pHashPEIdents,0,sizeof(int) * cHashSize);
+#else
+	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
+m_pszPENames = (char *)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
+if(m_pszPENames == MAP_FAILED)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes for m_pszPENames through mmap()  failed - %s",(INT64)memreq,strerror(errno));
+	m_pszPENames = NULL;
+	Reset();
+	return(eBSFerrMem);
+	}
+#endif
+m_AllocdPENamesMem = memreq;
+m_PENamesLen = 0;
 
-Rslt = LoadSAM(false,pszInPE1File);
-if(Rslt < 1)
+if((Rslt = GrowPEIdentHash()) < eBSFSuccess)
+	{
+	Reset();
 	return(Rslt);
+	}
 
-Rslt = LoadSAM(true,pszInPE2File);
+Rslt = LoadPESAMs(pszInPE1File,pszInPE2File);
 if(Rslt < 1)
+	{
+	Reset();
 	return(Rslt);
+	}
 
 if(m_NumScaffolds > 1)
 	{
@@ -1400,40 +1656,6 @@ if(m_NumScaffolds > 1)
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Sorting scaffolds by PE1ContigID.PE2ContigID ascending completed");
 	}
 
-// number of scaffolds known, allocate to hold PE2 indexes and then sort
-if(m_NumScaffolds > 0)
-	{
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Create index and sorting %d scaffolds by PE2ContigID.PE1ContigID ascending",m_NumScaffolds);
-	memreq = (size_t)(sizeof(tsPEScaffold *) * m_NumScaffolds);	
-#ifdef _WIN32
-	m_ppPE2Scaffolds = (tsPEScaffold **) malloc(memreq);	// initial and perhaps the only allocation
-
-	if(m_ppPE2Scaffolds == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Memory allocation of %lld bytes for m_ppPE2Scaffolds - %s",(INT64)memreq,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-		// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_ppPE2Scaffolds = (tsPEScaffold **)mmap(NULL,memreq, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_ppPE2Scaffolds == MAP_FAILED)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Memory allocation of %lld bytes for m_ppPE2Scaffolds through mmap()  failed - %s",(INT64)memreq,strerror(errno));
-		m_ppPE2Scaffolds = NULL;
-		Reset();
-		return(eBSFerrMem);
-		}
-#endif
-	m_AllocdPE2ScaffoldsMem = memreq;
-	// initialise index and then sort
-	for(int Idx = 0; Idx < m_NumScaffolds; Idx++)
-		m_ppPE2Scaffolds[Idx] = &m_pScaffolds[Idx];
-	if(m_NumScaffolds > 1)
-		m_qsort.qsort(m_ppPE2Scaffolds,m_NumScaffolds,sizeof(tsPEScaffold **),SortPE2Scaffolds);
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Sorting scaffolds by PE2ContigID.PE1ContigID ascending completed");
-	}
-
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Identifying clusters of scaffolded chrom/contigs");
 IdentifyClusters();
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Cluster identification of scaffolded chrom/contigs completed");
@@ -1459,21 +1681,3 @@ if(pEl1->PE2ContigID < pEl2->PE2ContigID)
 	return(-1);
 return(0);
 }
-
-// Sort scaffolds by PE2ContigID.PE1ContigID ascending
-int
-CPEScaffold::SortPE2Scaffolds(const void *arg1, const void *arg2)
-{
-tsPEScaffold *pEl1 = *(tsPEScaffold **)arg1;
-tsPEScaffold *pEl2 = *(tsPEScaffold **)arg2;
-
-if(pEl1->PE2ContigID > pEl2->PE2ContigID)
-	return(1);
-if(pEl1->PE2ContigID < pEl2->PE2ContigID)
-	return(-1);
-if(pEl1->PE1ContigID > pEl2->PE1ContigID)
-	return(1);
-if(pEl1->PE1ContigID < pEl2->PE1ContigID)
-	return(-1);
-return(0);
-}
\ No newline at end of file
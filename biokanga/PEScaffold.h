@@ -7,10 +7,14 @@ const int cMinSeqLength = 10;			// minimal accepted sequence length
 const int cMaxSeqLength = 10000;		// maximal accepted sequence length
 
 const int cAllocContigNames	= 250000;	// alloc/realloc Contigosome names in increments of this many
-const int cAllocPENames		= 25000000;	// alloc/realloc paired end identifier names in increments of this many
+const int cAllocPENames		= 25000000;	// alloc/realloc paired end identifiers in increments of this many
+const size_t cAllocPENameChrs = 0x20000000;	// alloc/realloc paired end identifier name chars in increments of this many
 const int cAllocScafolds	= 25000000;	// alloc/realloc scaffolds in increments of this many
+const int cAllocPESAMAligns	= 25000000;	// alloc/realloc buffered PE2 alignments in increments of this many
 
 const int cHashSize = 0x0ffffff;			// use this sized hash (24bits) 
+const int cPEIdentHashInitBits = 24;	// PE identifier hash initially has 2^24 slots, doubled whenever more than half full
+const int cPEIdentHashMaxBits = 31;		// PE identifier hash is limited to 2^31 slots
 
 #pragma pack(1)
 typedef struct TAG_sPEScaffoldContig {
@@ -21,11 +25,10 @@ typedef struct TAG_sPEScaffoldContig {
 	INT32 HashNext;						// if non-zero then identifier of next contig with same hash
 	} tsPEScaffoldContig;
 
-typedef struct TAG_sPEIdent {
-	INT32 IdentID;						// uniquely identifies this PE identifier
-	char szIdent[cMaxPENameLen+1];		// which has this name
+typedef struct TAG_sPEIdent {			// PE identifiers are uniquely identified by their index + 1
+	INT64 NameOfs;						// identifier name starts at this offset in m_pszPENames
+	UINT32 NameHash;					// 32bit hash of lowercased identifier name
 	INT32 PEScafoldID;					// associated scaffold (invalid after scaffolds sorted)
-	INT32 HashNext;						// if non-zero then identifier of next PEIdent with same hash
 	} tsPEIdent;
 
 typedef struct TAG_sPEScaffold {
@@ -36,6 +39,40 @@ typedef struct TAG_sPEScaffold {
 	UINT8 PE1Sense:1;					// 1 if PE1 aligned sense onto PE1ContigID; 0 if aligned antisense
 	UINT8 PE2Sense:1;					// 1 if PE2 aligned sense onto PE2ContigID; 0 if aligned antisense
 } tsPEScaffold; 
+
+typedef struct TAG_sPESAMAlign {		// alignment parsed from SAM/BAM and buffered until it can be registered
+	INT64 NameOfs;						// PE identifier name starts at this offset in pszNames
+	INT64 ContigOfs;					// contig name starts at this offset in pszNames, shared with preceding alignment if onto same contig
+	UINT32 NameHash;					// 32bit hash of lowercased PE identifier name
+	char Strand;						// '+' or '-'
+} tsPESAMAlign;
+
+class CPEScaffold;
+
+typedef struct TAG_sPESAMLoadPars {
+	int ThreadIdx;						// uniquely identifies this thread
+	CPEScaffold *pThis;					// will be initialised to pt to class instance
+#ifdef _WIN32
+	HANDLE threadHandle;				// handle as returned by _beginthreadex()
+	unsigned int threadID;				// identifier as set by _beginthreadex()
+#else
+	int threadRslt;						// result as returned by pthread_create ()
+	pthread_t threadID;					// identifier as set by pthread_create ()
+#endif
+	bool bPE2;							// false if loading PE1, true if loading PE2
+	bool bBuffer;						// true if alignments to be buffered for later registration, false if registered as parsed
+	char *pszSAMFile;					// load alignments from this SAM/BAM file
+	int NumParsedElLines;				// number of SAM lines parsed
+	int NumAcceptedEls;					// number of mapped alignments accepted
+	INT64 NumAligns;					// number of alignments buffered in pAligns
+	INT64 AllocdNumAligns;				// pAligns allocated to hold at most this many alignments
+	size_t AllocdAlignsMem;				// pAligns memory allocation size
+	tsPESAMAlign *pAligns;				// buffered alignments
+	INT64 NamesLen;						// number of chars used in pszNames
+	size_t AllocdNamesMem;				// pszNames memory allocation size
+	char *pszNames;						// concatenated '\0' terminated buffered PE identifier and contig names
+	int Rslt;							// thread processing result
+} tsPESAMLoadPars;
 #pragma pack()
 
 class CPEScaffold
@@ -53,17 +90,21 @@ class CPEScaffold
 	int m_AllocdNumPEIdents;				// current allocation can hold at most this many PE identifiers
 	int m_NumPEIdents;						// this many PE identifiers are currently in m_pNumPEIdents
 	size_t m_AllocdPEIdentsMem;				// m_pNumPEIdents current memory allocation size
-	tsPEIdent *m_pPEIdents;					// allocated to hold PE identifier names
-	int *m_pHashPEIdents;					// holds hashes mapping to PEIdent identifers 
+	tsPEIdent *m_pPEIdents;					// allocated to hold PE identifiers
+	INT64 m_PENamesLen;						// number of chars used in m_pszPENames
+	size_t m_AllocdPENamesMem;				// m_pszPENames current memory allocation size
+	char *m_pszPENames;						// concatenated '\0' terminated PE identifier names
+	UINT32 m_PEIdentHashMask;				// PE identifier hash has m_PEIdentHashMask+1 slots
+	size_t m_AllocdPEIdentHashMem;			// m_pPEIdentHash current memory allocation size
+	UINT32 *m_pPEIdentHash;					// open addressed hash, linear probing, slots hold PE identifiers (0 if slot unused)
+
+	volatile int m_TermLoad;				// set non-zero by either SAM loading thread if loading failed and both threads are to terminate
 
 	int m_AllocdNumScaffolds;				// current allocation can hold at most this many scaffolds
 	int m_NumScaffolds;						// this many scaffolds are currently in m_pScaffoldContigs
 	size_t m_AllocdScaffoldsMem;			// m_pScaffolds current memory allocation size
 	tsPEScaffold *m_pScaffolds;				// allocated to hold scaffolds
 
-	size_t m_AllocdPE2ScaffoldsMem;			// m_ppPE2Scaffolds memory allocation size - allocated to hold m_NumScaffolds ptrs
-	tsPEScaffold **m_ppPE2Scaffolds;		// scaffolds sorted by PE2Contig.PE1ContigID ascending
-
 	int m_NumClusters;						// number of scaffolded clusters
 	int m_MaxNumClustered;					// largest cluster contains this many contigs
 
@@ -78,44 +119,61 @@ class CPEScaffold
 
 	char *GetContigName(int ContigID);		// returns ptr to contig name
 
-	int AddPEIdent(char *pszIdentName);		// register this sequence name
+	void TrimPEIdent(char *pszIdentName);	// inplace right trimming of identifier at rightmost instance of any of m_szSeqIDTermChrs
+
+	static UINT32 GenNameHash(char *pszName);	// returns 32bit hash of lowercased name
+
+	int AddPEIdent(char *pszIdentName,		// register this sequence name
+			UINT32 NameHash);				// which has this hash
+
+	int GrowPEIdentHash(void);				// double PE identifier hash slots and rehash
 
 	char *GetSeqName(int SeqID);			// returns ptr to sequence name
 
 	int
 		AddScaffold(bool bPE2,				// if false then PE1, if true then PE2
 			char *pszPEIdent,				// paired end indentifier used to corelate paired ends
+			UINT32 NameHash,				// paired end identifier has this hash
 			char *pszContig,					// PE aligns onto this Contig
 			char Strand);					// '+' or '-'
 
-	int LoadSAM(bool bPE2,					// false if loading PE1, true if loading PE2
-		char *pszSAMFile);					// load alignments from this SAM file
+	int LoadSAM(tsPESAMLoadPars *pPars);	// load alignments from SAM/BAM file, registering or buffering as specified in pPars
+
+	int BufferAlign(tsPESAMLoadPars *pPars,	// buffer alignment for later registration
+			char *pszPEIdent,				// paired end indentifier used to corelate paired ends
+			UINT32 NameHash,				// paired end identifier has this hash
+			char *pszContig,				// PE aligns onto this Contig
+			char Strand);					// '+' or '-'
+
+	int AddBufferedAligns(tsPESAMLoadPars *pPars);	// register alignments buffered by LoadSAM
+
+	void FreeBufferedAligns(tsPESAMLoadPars *pPars); // free memory allocated for buffered alignments
+
+	int LoadPESAMs(char *pszInPE1File,		// concurrently load PE1 alignments from this file
+			char *pszInPE2File);			// and PE2 alignments from this file
+
 	tsPEScaffold * LocateMateScaffold(int PE1ContigID,int PE2ContigID); // locate first instance of this scaffold
-	int LocatePE1Scaffold(int ContigID); // locate 1st instance of scaffold having this Contig identifier as PE1, returns 0 if unable to locate
-	int LocatePE2Scaffold(int ContigID); // locate 1st instance of scaffold having this Contig identifier as PE2, returns 0 if unable to locate
-	int										// returned next CurIdx to use on a subsequent call to IterPE1s (0 if all scaffords have been iterated)
-		IterPE1s(int CurIdx,				// iterates, in PE1ContigID.PE2ContigID ascending order, all tsPEScaffolds, set to 0 for 1st scaffold
-				int ContigID,				// iterate for this PE1 contig
-			tsPEScaffold **ppPEScaffold);	// returned scafford or NULL if all scaffords have been iterated
-	int										// returned next CurIdx to use on a subsequent call to IterPE2s (0 if all scaffords have been iterated)
-		IterPE2s(int CurIdx,				// iterates, in PE2ContigID.PE1ContigID ascending order, all tsPEScaffolds
-				int ContigID,				// iterate for this PE2 contig
-				tsPEScaffold **ppPEScaffold); // returned scafford or NULL if all scaffords have been iterated
 
 
 	int	ReportCorelationships(char *pszOutFile); // report corelationships to file
 
 	int IdentifyClusters(void);				// indentify cluster sizes
-	int RecurseCluster(int ClusterID,		// identifies the cluster to be associated with all scaffolded contigs
-			   int ContigID);				// starting from this contig
+
+	static int FindClusterRoot(int *pParents,	// contig union-find parents
+			   int ContigIdx);				// returns index of root contig for cluster containing this contig
 	
 	static int SortScaffolds(const void *arg1, const void *arg2); // Sort scaffolds by PE1ContigID.PE2ContigID ascending
-	static int SortPE2Scaffolds(const void *arg1, const void *arg2); // Sort scaffolds by PE2ContigID.PE1ContigID ascending
 
 public:
 	CPEScaffold(void);
 	~CPEScaffold(void);
 
+#ifdef _WIN32
+	static unsigned int __stdcall SAMLoadThreadStart(void *args);	// SAM/BAM loading thread startup
+#else
+	static void *SAMLoadThreadStart(void *args);	// SAM/BAM loading thread startup
+#endif
+
 	int Process(int PMode,					// processing mode
 		char *pszSeqIDTerm,					// pair sequence identifiers until this terminating character(s) - defaults to none terminating
 		char *pszInPE1File,					// input PE1 file
@@ -891,6 +891,7 @@ m_pContaminates = NULL;
 m_pBaseNs = NULL; 
 m_pScores = NULL; 
 m_pKMerCnts = NULL;
+m_bThreadKMerCnts = false;
 m_bMutexesCreated = false;
 m_hContamRptFile = -1;
 m_hKMerDistRptFile = -1;
@@ -956,6 +957,8 @@ memset(m_ReadLenDist,0,sizeof(m_ReadLenDist));
 memset(m_ProbNoReadErrDist,0,sizeof(m_ProbNoReadErrDist));
 
 m_NumSeqHashes = 0;
+m_NumSketchedReads = 0;
+memset(m_HLLRegs,0,sizeof(m_HLLRegs));
 m_AllocdSampledSeqMem = 0;
 m_AllocdSampledSeqWrds = 0;
 m_UsedSampledSeqWrds = 0;
@@ -1561,6 +1564,10 @@ CreateMutexes();
 
 if (NumThreads > m_NumPE1InFiles)
 	NumThreads = m_NumPE1InFiles;
+
+// if memory allows then each thread accumulates K-mer counts independently, removing the need to serialise updates to the shared counts
+m_bThreadKMerCnts = (m_AllocdKMerCntsMem * NumThreads) <= cMaxThreadKMerCntsMem ? true : false;
+
 tsThreadNGSQCPars *pThreads;
 tsThreadNGSQCPars *pThread;
 if ((pThreads = new tsThreadNGSQCPars[NumThreads]) == NULL)
@@ -1613,11 +1620,31 @@ DeleteMutexes();
 
 if (m_bTerminate)		// early termination because of some problem?
 	{
+	pThread = pThreads;
+	for (ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++, pThread++)
+		FreeThreadDists(pThread);
 	delete [] pThreads;
 	Reset();
 	return(-1);
 	}
 
+// merge the distributions independently accumulated by each thread
+pThread = pThreads;
+for (ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++, pThread++)
+	{
+	if((Rslt = MergeThreadDists(pThread)) < eBSFSuccess)
+		break;
+	FreeThreadDists(pThread);
+	}
+if(ThreadIdx < NumThreads)
+	{
+	for (; ThreadIdx < NumThreads; ThreadIdx++, pThread++)
+		FreeThreadDists(pThread);
+	delete [] pThreads;
+	Reset();
+	return(Rslt);
+	}
+
 
 // report on the number of reads processed
 pThread = pThreads;
@@ -1643,6 +1670,7 @@ for (ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++, pThread++)
 	NotProcQS += pThread->SeqCharacteristics.NotProcQS;
 	NotProcUL += pThread->SeqCharacteristics.NotProcUL;
 	}
+delete [] pThreads;
 
 if (!m_bPEProc)
 	gDiagnostics.DiagOut(eDLInfo, gszProcName, "(Instance %d) Total of %llu SE reads processed", ProcessingID, TotNumSEReads);
@@ -1653,6 +1681,12 @@ gDiagnostics.DiagOut(eDLInfo, gszProcName, "(Instance %d) Total of %llu reads no
 
 gDiagnostics.DiagOut(eDLInfo, gszProcName, "(Instance %d) Total of %lu reads used as seed duplicates", ProcessingID, m_ActMaxDupSeeds);
 gDiagnostics.DiagOut(eDLInfo, gszProcName, "(Instance %d) Total of %llu reads containing 'N's and/or %llu below minimum Phred scores not accepted for duplicate processing", ProcessingID, NotProcNs,NotProcQS);
+if(m_NumSketchedReads > 0)
+	{
+	INT64 EstDistinct = min(HLLEstimate(m_HLLRegs),m_NumSketchedReads);
+	gDiagnostics.DiagOut(eDLInfo, gszProcName, "(Instance %d) Estimated %lld distinct %s from all %lld accepted for duplicate processing, estimated duplicate proportion: %1.2f%%", ProcessingID,
+						EstDistinct, m_bPEProc ? "read pairs" : "reads", m_NumSketchedReads, (100.0 * (m_NumSketchedReads - EstDistinct)) / m_NumSketchedReads);
+	}
 
 if(m_ActMaxDupSeeds == 0)
 	{
@@ -2219,18 +2253,6 @@ if(pthread_spin_init(&m_hSpinLock,PTHREAD_PROCESS_PRIVATE)!=0)
 	}
 
 
-#ifdef _WIN32
-if (!InitializeCriticalSectionAndSpinCount(&m_hSCritSectScores, 1000))
-	{
-#else
-if(pthread_spin_init(&m_hSpinLockScores,PTHREAD_PROCESS_PRIVATE)!=0)
-	{
-	pthread_rwlock_destroy(&m_hRwLock);
-#endif
-	gDiagnostics.DiagOut(eDLFatal, gszProcName, "Fatal: unable to create mutex");
-	return(eBSFerrInternal);
-	}
-
 #ifdef _WIN32
 if (!InitializeCriticalSectionAndSpinCount(&m_hSCritSectKMers, 1000))
 	{
@@ -2311,39 +2333,6 @@ CReadStats::ReleaseSerialise(void)
 }
 
 
-void
-CReadStats::AcquireSerialiseScores(void)
-{
-int SpinCnt = 1000;
-#ifdef _WIN32
-while(!TryEnterCriticalSection(&m_hSCritSectScores))
-	{
-	if (SpinCnt -= 1)
-		continue;
-	SwitchToThread();
-	SpinCnt = 100;
-	}
-#else
-while (pthread_spin_trylock(&m_hSpinLockScores) == EBUSY)
-	{
-	if (SpinCnt -= 1)
-		continue;
-	pthread_yield();
-	SpinCnt = 100;
-	}
-#endif
-}
-
-void
-CReadStats::ReleaseSerialiseScores(void)
-{
-#ifdef _WIN32
-	LeaveCriticalSection(&m_hSCritSectScores);
-#else
-	pthread_spin_unlock(&m_hSpinLockScores);
-#endif
-}
-
 void
 CReadStats::AcquireSerialiseKMers(void)
 {
@@ -2937,6 +2926,27 @@ return((teBSFrsltCodes)(NumPE1AcceptedReads + NumPE2AcceptedReads));
 }
 
 // Sampled read instances are only accepted if the read contains no indeterminates and within the max number of unique instances allowed
+// HashPackedSeqs
+// 64bit hash, using the MurmurHash3 finalisation mix, of packed read sequences for HyperLogLog sketching
+static UINT64
+HashPackedSeqs(int NumPackedWrds,		// number of packed sequence words
+			   UINT32 *pPackedSeqs,		// packed sequences
+			   UINT32 ReadLens)			// read lengths also contribute to hash
+{
+UINT64 Hash;
+Hash = 0x9e3779b97f4a7c15ULL ^ ReadLens;
+while(NumPackedWrds--)
+	{
+	Hash ^= *pPackedSeqs++;
+	Hash ^= Hash >> 33;
+	Hash *= 0xff51afd7ed558ccdULL;
+	Hash ^= Hash >> 33;
+	Hash *= 0xc4ceb9fe1a85ec53ULL;
+	Hash ^= Hash >> 33;
+	}
+return(Hash);
+}
+
 int				// returns 0 if not accepted as read instance, 1 if this is the first instance of an accepted sampled read, 2..N if multiple instances exist
 CReadStats::AddReadInst(tsThreadNGSQCPars *pThread, // thread specific processing state and context
 				int PE1ReadLen,				// number of bases in PE1 read
@@ -2950,7 +2960,8 @@ int PartialPacked;								// number of bases currently packed into PackedBases
 UINT32 *pPackedSeqs;
 UINT32 SeqHash;									// sequence hash
 UINT32 RevCplSeqHash;
-UINT32 HashSeqsOfs;
+UINT64 SketchHash;								// hash used when sketching distinct reads
+UINT64 RevCplSketchHash;
 UINT32 TermRevCplNxtSeq;
 UINT32 TermNxtSeq;
 tsSampledSeq *pSampledSeq;
@@ -2964,7 +2975,6 @@ UINT8 *pPE1RevCplRawRead;
 UINT8 *pPE2RevCplRawRead;
 UINT32 *pRevCplPackedSeqs;
 tsSampledSeq *pRevCplSampledSeq;
-UINT32 RevCplHashSeqsOfs;
 UINT32 RevCplPackedBases;
 int RevCplNumPackedWrds;
 int RevCplPartialPacked;
@@ -3119,70 +3129,72 @@ if (!m_bStrand)
 	RevCplSeqHash &= cHashMask;
 	}
 
+// sketch all reads, including those which can no longer be sampled, so the number of distinct reads can be estimated however many reads are processed
+SketchHash = HashPackedSeqs(NumPackedWrds,PackedSeqs,((UINT32)PE1ReadLen << 16) | (UINT32)(m_bPEProc ? PE2ReadLen : 0));
+if (!m_bStrand)
+	{
+	RevCplSketchHash = HashPackedSeqs(RevCplNumPackedWrds,RevCplPackedSeqs,((UINT32)(m_bPEProc ? PE2ReadLen : PE1ReadLen) << 16) | (UINT32)(m_bPEProc ? PE1ReadLen : 0));
+	if(RevCplSketchHash < SketchHash)
+		SketchHash = RevCplSketchHash;
+	}
+AddHLLSketch(pThread,SketchHash);
+
 // check if this packed sequence has been previously accepted as a sample
-pSampledSeq = NULL;
-TermNxtSeq = 0;
-TermRevCplNxtSeq = 0;
-AcquireSerialise();
-if (m_ActMaxDupSeeds && (HashSeqsOfs = m_pSeqHashes[SeqHash]) != 0)		// seen at least one sequence previously with same hash?
-	{
-	TermNxtSeq = HashSeqsOfs;
-	pSampledSeq = (tsSampledSeq *)&m_pSampledSeqs[HashSeqsOfs-1];
-	do {
-		if(pSampledSeq->PE1ReadLen == PE1ReadLen && (!m_bPEProc || (pSampledSeq->PE2ReadLen == PE2ReadLen)))
-			{
-			if(pSampledSeq->PackedSeqs[0] == PackedSeqs[0])
-				{
-				if((pSampledSeq->NumPackedWrds == 1) || !memcmp(pSampledSeq->PackedSeqs,PackedSeqs,pSampledSeq->NumPackedWrds * sizeof(UINT32)))
-					{
-					pSampledSeq->NumInstances += 1;
-					NumInstances = (int)pSampledSeq->NumInstances;
-					ReleaseSerialise();
-					return(NumInstances);
-					}
-				}
-			}
-		if(pSampledSeq->NxtSeq != 0)
-			TermNxtSeq = pSampledSeq->NxtSeq;
-		}
-	while (pSampledSeq->NxtSeq != 0 && (pSampledSeq = (tsSampledSeq *)&m_pSampledSeqs[pSampledSeq->NxtSeq - 1]));
+// sampled sequences are located holding a shared lock with instance counts atomically incremented, an exclusive lock is only required when adding a newly sampled sequence
+AcquireLock(false);
+if (m_ActMaxDupSeeds && (pSampledSeq = LocateSampledSeq(SeqHash,PE1ReadLen,PE2ReadLen,PackedSeqs,&TermNxtSeq)) != NULL)
+	{
+#ifdef _WIN32
+	NumInstances = (int)InterlockedIncrement((volatile LONG *)&pSampledSeq->NumInstances);
+#else
+	NumInstances = (int)__sync_add_and_fetch(&pSampledSeq->NumInstances,1);
+#endif
+	ReleaseLock(false);
+	return(NumInstances);
 	}
 
 // if no success with finding existing sense natch and not strand dependent then try with sequence reverse complemented
-if (!m_bStrand && m_ActMaxDupSeeds)
+if (!m_bStrand && m_ActMaxDupSeeds && (pRevCplSampledSeq = LocateSampledSeq(RevCplSeqHash,PE1ReadLen,PE2ReadLen,RevCplPackedSeqs,&TermRevCplNxtSeq)) != NULL)
 	{
-	// check if this packed sequence has been previously accepted as a sample
-	pRevCplSampledSeq = NULL;
-	if ((RevCplHashSeqsOfs = m_pSeqHashes[RevCplSeqHash]) != 0)		// seen at least one sequence previously with same hash?
-		{
-		TermRevCplNxtSeq = RevCplHashSeqsOfs;
-		pRevCplSampledSeq = (tsSampledSeq *)&m_pSampledSeqs[RevCplHashSeqsOfs - 1];
-		do
-			{
-			if (pRevCplSampledSeq->PE1ReadLen == PE1ReadLen && (!m_bPEProc || (pRevCplSampledSeq->PE2ReadLen == PE2ReadLen)))
-				{
-				if (pRevCplSampledSeq->PackedSeqs[0] == RevCplPackedSeqs[0])
-					{
-					if((pRevCplSampledSeq->NumPackedWrds == 1) || !memcmp(pRevCplSampledSeq->PackedSeqs, RevCplPackedSeqs, pRevCplSampledSeq->NumPackedWrds * sizeof(UINT32)))
-						{
-						pRevCplSampledSeq->NumInstances += 1;
-						pRevCplSampledSeq->NumRevCplInstances += 1;
-						NumInstances = (int)pRevCplSampledSeq->NumInstances;
-						ReleaseSerialise();
-						return(NumInstances);
-						}
-					}
-				}
-			if(pRevCplSampledSeq->NxtSeq != 0)
-				TermRevCplNxtSeq = pRevCplSampledSeq->NxtSeq;
-			}
-		while (pRevCplSampledSeq->NxtSeq != 0 && (pRevCplSampledSeq = (tsSampledSeq *)&m_pSampledSeqs[pRevCplSampledSeq->NxtSeq - 1]));
-		}
+#ifdef _WIN32
+	InterlockedIncrement((volatile LONG *)&pRevCplSampledSeq->NumRevCplInstances);
+	NumInstances = (int)InterlockedIncrement((volatile LONG *)&pRevCplSampledSeq->NumInstances);
+#else
+	__sync_fetch_and_add(&pRevCplSampledSeq->NumRevCplInstances,1);
+	NumInstances = (int)__sync_add_and_fetch(&pRevCplSampledSeq->NumInstances,1);
+#endif
+	ReleaseLock(false);
+	return(NumInstances);
 	}
 
 if (m_ActMaxDupSeeds >= m_ReqMaxDupSeeds)
 	{
-	ReleaseSerialise();
+	ReleaseLock(false);
+	return(0);
+	}
+ReleaseLock(false);
+
+// need to sample, another thread may have sampled the same sequence whilst unlocked so need to recheck after obtaining the exclusive lock
+AcquireLock(true);
+if (m_ActMaxDupSeeds && (pSampledSeq = LocateSampledSeq(SeqHash,PE1ReadLen,PE2ReadLen,PackedSeqs,&TermNxtSeq)) != NULL)
+	{
+	pSampledSeq->NumInstances += 1;
+	NumInstances = (int)pSampledSeq->NumInstances;
+	ReleaseLock(true);
+	return(NumInstances);
+	}
+if (!m_bStrand && m_ActMaxDupSeeds && (pRevCplSampledSeq = LocateSampledSeq(RevCplSeqHash,PE1ReadLen,PE2ReadLen,RevCplPackedSeqs,&TermRevCplNxtSeq)) != NULL)
+	{
+	pRevCplSampledSeq->NumInstances += 1;
+	pRevCplSampledSeq->NumRevCplInstances += 1;
+	NumInstances = (int)pRevCplSampledSeq->NumInstances;
+	ReleaseLock(true);
+	return(NumInstances);
+	}
+
+if (m_ActMaxDupSeeds >= m_ReqMaxDupSeeds)
+	{
+	ReleaseLock(true);
 	return(0);
 	}
 
@@ -3201,7 +3213,7 @@ if((m_AllocdSampledSeqWrds - m_UsedSampledSeqWrds) < ((cMaxRSSeqLen+3)/4)*10)
 	if(pAllocd == NULL)
 		{
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Thread %d: Memory re-allocation to %d bytes - %s",pThread->ThreadIdx, memreq,strerror(errno));
-		ReleaseSerialise();
+		ReleaseLock(true);
 		return(eBSFerrMem);
 		}
 	m_pSampledSeqs = pAllocd;
@@ -3227,10 +3239,217 @@ else
 	((tsSampledSeq *)&m_pSampledSeqs[TermNxtSeq - 1])->NxtSeq = m_UsedSampledSeqWrds + 1;
 m_UsedSampledSeqWrds += NumPackedWrds + (((sizeof(tsSampledSeq)-sizeof(UINT32)) + 3)/4);
 m_ActMaxDupSeeds += 1;
-ReleaseSerialise();
+ReleaseLock(true);
 return(1);
 }
 
+tsSampledSeq *	// located sampled sequence or NULL if not previously sampled, caller must hold the lock
+CReadStats::LocateSampledSeq(UINT32 SeqHash,	// sequence hash
+				int PE1ReadLen,			// number of bases in PE1 read
+				int PE2ReadLen,			// number of bases in PE2 read
+				UINT32 *pPackedSeqs,	// packed PE1 and PE2 sequences
+				UINT32 *pTermNxtSeq)	// returned index+1 of last sampled sequence with same hash, 0 if none
+{
+UINT32 HashSeqsOfs;
+tsSampledSeq *pSampledSeq;
+
+*pTermNxtSeq = 0;
+if ((HashSeqsOfs = m_pSeqHashes[SeqHash]) == 0)		// seen at least one sequence previously with same hash?
+	return(NULL);
+*pTermNxtSeq = HashSeqsOfs;
+pSampledSeq = (tsSampledSeq *)&m_pSampledSeqs[HashSeqsOfs-1];
+do {
+	if(pSampledSeq->PE1ReadLen == PE1ReadLen && (!m_bPEProc || (pSampledSeq->PE2ReadLen == PE2ReadLen)))
+		{
+		if(pSampledSeq->PackedSeqs[0] == pPackedSeqs[0])
+			{
+			if((pSampledSeq->NumPackedWrds == 1) || !memcmp(pSampledSeq->PackedSeqs,pPackedSeqs,pSampledSeq->NumPackedWrds * sizeof(UINT32)))
+				return(pSampledSeq);
+			}
+		}
+	if(pSampledSeq->NxtSeq != 0)
+		*pTermNxtSeq = pSampledSeq->NxtSeq;
+	}
+while (pSampledSeq->NxtSeq != 0 && (pSampledSeq = (tsSampledSeq *)&m_pSampledSeqs[pSampledSeq->NxtSeq - 1]));
+return(NULL);
+}
+
+// AddHLLSketch
+// HyperLogLog; low cRSHLLPrecision hash bits select the register, which retains the maximum rank (position of the lowest set bit) of the remaining hash bits
+// Sketches are per thread so no serialisation is required, thread sketches are merged by taking the maximum of each register
+void
+CReadStats::AddHLLSketch(tsThreadNGSQCPars *pThread, // thread specific processing state and context
+				UINT64 Hash)			// 64bit hash of read, or read pair, sequence
+{
+UINT8 Rank;
+UINT8 *pReg;
+pReg = &pThread->HLLRegs[Hash & (cRSHLLNumRegs - 1)];
+Hash >>= cRSHLLPrecision;
+for(Rank = 1; Rank <= (64 - cRSHLLPrecision) && !(Hash & 0x01); Rank++)
+	Hash >>= 1;
+if(Rank > *pReg)
+	*pReg = Rank;
+pThread->NumSketchedReads += 1;
+}
+
+INT64			// estimated number of distinct reads
+CReadStats::HLLEstimate(UINT8 *pHLLRegs)	// from this HyperLogLog sketch
+{
+int RegIdx;
+int NumZeroRegs;
+double Sum;
+double Estimate;
+
+Sum = 0.0;
+NumZeroRegs = 0;
+for(RegIdx = 0; RegIdx < cRSHLLNumRegs; RegIdx++, pHLLRegs++)
+	{
+	Sum += ldexp(1.0,-(int)*pHLLRegs);
+	if(*pHLLRegs == 0)
+		NumZeroRegs += 1;
+	}
+Estimate = ((0.7213 / (1.0 + 1.079 / cRSHLLNumRegs)) * cRSHLLNumRegs * (double)cRSHLLNumRegs) / Sum;
+if(Estimate <= 2.5 * cRSHLLNumRegs && NumZeroRegs > 0)	// small cardinality so use linear counting
+	Estimate = cRSHLLNumRegs * log((double)cRSHLLNumRegs / NumZeroRegs);
+return((INT64)(Estimate + 0.5));
+}
+
+// MergeThreadDists
+// Accumulate distributions independently accumulated by a thread into the shared distributions
+// Only called after all threads have completed so no serialisation is required
+int				// < 0 if errors, eBSFSuccess if thread distributions accumulated into the shared distributions
+CReadStats::MergeThreadDists(tsThreadNGSQCPars *pThread) // merge this threads distributions
+{
+int Rslt;
+int Idx;
+size_t NumCnts;
+size_t CntIdx;
+
+if(pThread->MaxReadLen > m_MaxReadLen)
+	m_MaxReadLen = pThread->MaxReadLen;
+if(pThread->MinReadLen > 0 && (m_MinReadLen == 0 || m_MinReadLen > pThread->MinReadLen))
+	m_MinReadLen = pThread->MinReadLen;
+
+if(pThread->AllocdDistsReadLen > 0)
+	{
+	for(Idx = 0; Idx < pThread->AllocdDistsReadLen; Idx++)
+		m_pBaseNs[Idx] += pThread->pBaseNs[Idx];
+	for(Idx = 0; Idx < pThread->AllocdDistsReadLen * 42; Idx++)
+		m_pScores[Idx] += pThread->pScores[Idx];
+	for(Idx = 0; Idx <= pThread->AllocdDistsReadLen; Idx++)
+		m_ReadLenDist[Idx] += pThread->pReadLenDist[Idx];
+	}
+m_ReadLenDist[cMaxRSSeqLen+1] += pThread->NumTruncReads;
+for(Idx = 0; Idx < 100; Idx++)
+	m_ProbNoReadErrDist[Idx] += pThread->ProbNoReadErrDist[Idx];
+
+if(pThread->pKMerCnts != NULL)
+	{
+	if((Rslt = ReallocKMerCnts(pThread->AllocdKMerReadLen,&m_AllocdKMerCntsMem,&m_AllocdMaxReadLen,&m_pKMerCnts)) < eBSFSuccess)
+		return(Rslt);
+	NumCnts = (size_t)m_KMerCntsEls * pThread->AllocdKMerReadLen;
+	for(CntIdx = 0; CntIdx < NumCnts; CntIdx++)
+		m_pKMerCnts[CntIdx] += pThread->pKMerCnts[CntIdx];
+	}
+
+m_NumChkdPE1ContamHits += pThread->NumChkdPE1ContamHits;
+m_NumPE1ContamHits += pThread->NumPE1ContamHits;
+m_NumChkdPE2ContamHits += pThread->NumChkdPE2ContamHits;
+m_NumPE2ContamHits += pThread->NumPE2ContamHits;
+
+m_NumSketchedReads += pThread->NumSketchedReads;
+for(Idx = 0; Idx < cRSHLLNumRegs; Idx++)
+	if(pThread->HLLRegs[Idx] > m_HLLRegs[Idx])
+		m_HLLRegs[Idx] = pThread->HLLRegs[Idx];
+return(eBSFSuccess);
+}
+
+void
+CReadStats::FreeThreadDists(tsThreadNGSQCPars *pThread) // free memory allocated for this threads distributions
+{
+if(pThread->pBaseNs != NULL)
+	{
+	delete []pThread->pBaseNs;
+	pThread->pBaseNs = NULL;
+	}
+if(pThread->pScores != NULL)
+	{
+	delete []pThread->pScores;
+	pThread->pScores = NULL;
+	}
+if(pThread->pReadLenDist != NULL)
+	{
+	delete []pThread->pReadLenDist;
+	pThread->pReadLenDist = NULL;
+	}
+pThread->AllocdDistsReadLen = 0;
+
+if(pThread->pKMerCnts != NULL)
+	{
+#ifdef _WIN32
+	free(pThread->pKMerCnts);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
+#else
+	if(pThread->pKMerCnts != MAP_FAILED)
+		munmap(pThread->pKMerCnts,pThread->AllocdKMerCntsMem);
+#endif
+	pThread->pKMerCnts = NULL;
+	}
+pThread->AllocdKMerCntsMem = 0;
+pThread->AllocdKMerReadLen = 0;
+}
+
+// ReallocKMerCnts
+// Ensure K-mer counts, either the shared counts or a threads counts, are allocated for reads of at least ReadLen, any additional counts are zeroed
+int				// < 0 if errors, eBSFSuccess if allocation is for reads of at least ReadLen
+CReadStats::ReallocKMerCnts(int ReadLen,		// ensure *ppKMerCnts is allocated for reads of at least this length
+					size_t *pAllocdMem,		// current allocation size in bytes
+					int *pAllocdReadLen,	// current allocation is for reads of this length
+					UINT32 **ppKMerCnts)	// allocated K-mer counts
+{
+UINT32 *pAllocd;
+int AllocdReadLen;
+size_t memreq;
+
+if(*ppKMerCnts != NULL && ReadLen <= *pAllocdReadLen)
+	return(eBSFSuccess);
+AllocdReadLen = (ReadLen * 120) / 100;		// allocate for longer than required to reduce the chances of having to later realloc
+memreq = (size_t)m_KMerCntsEls * AllocdReadLen * sizeof(UINT32);
+if(*ppKMerCnts == NULL)
+	{
+#ifdef _WIN32
+	pAllocd = (UINT32 *)malloc(memreq);
+#else
+	pAllocd = (UINT32 *)mmap(NULL, memreq, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pAllocd == MAP_FAILED)
+		pAllocd = NULL;
+#endif
+	if(pAllocd != NULL)
+		memset(pAllocd,0,memreq);
+	}
+else
+	{
+	gDiagnostics.DiagOut(eDLInfo, gszProcName, "ReallocKMerCnts: Memory re-allocation to %lld bytes", (INT64)memreq);
+#ifdef _WIN32
+	pAllocd = (UINT32 *)realloc(*ppKMerCnts, memreq);
+#else
+	pAllocd = (UINT32 *)mremap(*ppKMerCnts,*pAllocdMem,memreq,MREMAP_MAYMOVE);
+	if(pAllocd == MAP_FAILED)
+		pAllocd = NULL;
+#endif
+	if(pAllocd != NULL)
+		memset((UINT8 *)pAllocd + *pAllocdMem,0,memreq - *pAllocdMem);
+	}
+if(pAllocd == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ReallocKMerCnts: Memory allocation of %lld bytes - %s",(INT64)memreq,strerror(errno));
+	return(eBSFerrMem);
+	}
+*ppKMerCnts = pAllocd;
+*pAllocdMem = memreq;
+*pAllocdReadLen = AllocdReadLen;
+return(eBSFSuccess);
+}
+
 double									// returned prob of read being error free
 GenProbErrFreeRead(int QSSchema,		// quality scoring schema - guestimated scoring schema - 0: no scoring, 1: Solexa, 2: Illumina 1.3+, 3: Illumina 1.5+, 4: Illumina 1.8+ or Sanger
 				   int ReadLen,			// read length
@@ -3368,30 +3587,67 @@ for (SeqOfs = 0; SeqOfs < ReadLen; SeqOfs++, pSeq++, pNs++, pScore++,pQScores++)
 	}
 MeanReadScore = SumBaseScores /  ReadLen;
 
-pScores = m_pScores;
+// each thread accumulates into it's own distributions, these are merged into the global distributions after all threads have completed
+if(ReadLen > pThread->AllocdDistsReadLen)
+	{
+	int AllocdDistsReadLen = min((ReadLen * 120) / 100,(int)cMaxRSSeqLen);	// allocate for longer than required to reduce the chances of having to later realloc
+	UINT32 *pAllocdBaseNs;
+	UINT32 *pAllocdScores;
+	UINT32 *pAllocdReadLenDist;
+	pAllocdBaseNs = new UINT32 [AllocdDistsReadLen];
+	pAllocdScores = new UINT32 [AllocdDistsReadLen * 42];
+	pAllocdReadLenDist = new UINT32 [AllocdDistsReadLen + 1];
+	if(pAllocdBaseNs == NULL || pAllocdScores == NULL || pAllocdReadLenDist == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Thread %d: Memory allocation for distributions of reads upto %d length failed",pThread->ThreadIdx,AllocdDistsReadLen);
+		if(pAllocdBaseNs != NULL)
+			delete []pAllocdBaseNs;
+		if(pAllocdScores != NULL)
+			delete []pAllocdScores;
+		if(pAllocdReadLenDist != NULL)
+			delete []pAllocdReadLenDist;
+		return(eBSFerrMem);
+		}
+	memset(pAllocdBaseNs,0,sizeof(UINT32) * AllocdDistsReadLen);
+	memset(pAllocdScores,0,sizeof(UINT32) * AllocdDistsReadLen * 42);
+	memset(pAllocdReadLenDist,0,sizeof(UINT32) * (AllocdDistsReadLen + 1));
+	if(pThread->AllocdDistsReadLen > 0)
+		{
+		memcpy(pAllocdBaseNs,pThread->pBaseNs,sizeof(UINT32) * pThread->AllocdDistsReadLen);
+		memcpy(pAllocdScores,pThread->pScores,sizeof(UINT32) * pThread->AllocdDistsReadLen * 42);
+		memcpy(pAllocdReadLenDist,pThread->pReadLenDist,sizeof(UINT32) * (pThread->AllocdDistsReadLen + 1));
+		delete []pThread->pBaseNs;
+		delete []pThread->pScores;
+		delete []pThread->pReadLenDist;
+		}
+	pThread->pBaseNs = pAllocdBaseNs;
+	pThread->pScores = pAllocdScores;
+	pThread->pReadLenDist = pAllocdReadLenDist;
+	pThread->AllocdDistsReadLen = AllocdDistsReadLen;
+	}
+
+pScores = pThread->pScores;
 pScore = Scores;
 pNs = Ns;
-pBaseNs = m_pBaseNs;
-AcquireSerialiseScores();
+pBaseNs = pThread->pBaseNs;
 for (SeqOfs = 0; SeqOfs < ReadLen; SeqOfs++, pScore++, pBaseNs++, pNs++, pScores += 42)
 	{
 	pScores[*pScore] += 1;
 	*pBaseNs += *pNs;
 	}
-if(ReadLen > m_MaxReadLen)
-	m_MaxReadLen = ReadLen;
-if(m_MinReadLen == 0 || m_MinReadLen > ReadLen)
-	m_MinReadLen = ReadLen;
-m_ReadLenDist[ReadLen] += 1;
+if(ReadLen > pThread->MaxReadLen)
+	pThread->MaxReadLen = ReadLen;
+if(pThread->MinReadLen == 0 || pThread->MinReadLen > ReadLen)
+	pThread->MinReadLen = ReadLen;
+pThread->pReadLenDist[ReadLen] += 1;
 if(bTrunc)
-	m_ReadLenDist[cMaxRSSeqLen+1] += 1;
+	pThread->NumTruncReads += 1;
 
 int ProbNoReadErrBinIdx;
 ProbNoReadErrBinIdx = (int)(ProbNoReadErr * 100);
 if(ProbNoReadErrBinIdx > 99)
 	ProbNoReadErrBinIdx = 99;
-m_ProbNoReadErrDist[ProbNoReadErrBinIdx] += 1;
-ReleaseSerialiseScores();
+pThread->ProbNoReadErrDist[ProbNoReadErrBinIdx] += 1;
 return(MinScore);
 }
 
@@ -3409,6 +3665,7 @@ UINT32 KMerMsk;
 int KMerLen;
 int KmerCntsOfs;
 UINT32 *pKMerCntsSeqOfs;
+UINT32 *pKMerCnts;
 UINT32 KMerOfs;
 UINT32 KMerLenOfs;
 int Pow;
@@ -3453,29 +3710,23 @@ for (SeqOfs = 0; SeqOfs < (ReadLen + m_MaxKMerLen); SeqOfs++, pSeq++)
 	KMerOfs += m_KMerCntsEls;	
 	}
 
-AcquireSerialiseKMers();
-// ensure allocation for KMerCnts is sufficent for read lengths
-if(ReadLen > m_AllocdMaxReadLen)
+// if memory allowed then each thread accumulates into it's own K-mer counts, these are merged into the global counts after all threads have completed
+if(m_bThreadKMerCnts)
 	{
-	UINT32 *pAllocd;
-	m_AllocdMaxReadLen = (ReadLen * 120) / 100;
-	size_t memreq = m_KMerCntsEls * m_AllocdMaxReadLen * sizeof(UINT32);
-	gDiagnostics.DiagOut(eDLInfo, gszProcName, "AddReadInst: Memory re-allocation to %d bytes", memreq);
-#ifdef _WIN32
-	pAllocd = (UINT32 *)realloc(m_pKMerCnts, memreq);
-#else
-	pAllocd = (UINT32 *)mremap(m_pKMerCnts,m_AllocdKMerCntsMem,memreq,MREMAP_MAYMOVE);
-	if(pAllocd == MAP_FAILED)
-		pAllocd = NULL;
-#endif
-	if(pAllocd == NULL)
+	if(ReallocKMerCnts(max(ReadLen,m_EstMaxSeqLen),&pThread->AllocdKMerCntsMem,&pThread->AllocdKMerReadLen,&pThread->pKMerCnts) < eBSFSuccess)
+		return(eBSFerrMem);
+	pKMerCnts = pThread->pKMerCnts;
+	}
+else
+	{
+	AcquireSerialiseKMers();
+	// ensure allocation for KMerCnts is sufficent for read lengths
+	if(ReallocKMerCnts(ReadLen,&m_AllocdKMerCntsMem,&m_AllocdMaxReadLen,&m_pKMerCnts) < eBSFSuccess)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Thread %d: Memory re-allocation to %d bytes - %s",pThread->ThreadIdx, memreq,strerror(errno));
-		ReleaseSerialise();
+		ReleaseSerialiseKMers();
 		return(eBSFerrMem);
 		}
-	m_pKMerCnts = pAllocd;
-	m_AllocdKMerCntsMem = memreq;
+	pKMerCnts = m_pKMerCnts;
 	}
 
 pKMerCntsSeqOfs = pThread->KMerCntOfs;
@@ -3483,9 +3734,10 @@ for(SeqOfs = 0; SeqOfs < ReadLen; SeqOfs++)
 	{
 	for(KMerLen = 0; KMerLen < m_MaxKMerLen; KMerLen++,pKMerCntsSeqOfs++)
 		if(SeqOfs + KMerLen < ReadLen)					// sloughing cnts for k-mers which would have extended out past the end of reads
-			m_pKMerCnts[*pKMerCntsSeqOfs] += 1;		
+			pKMerCnts[*pKMerCntsSeqOfs] += 1;		
 	}	
-ReleaseSerialiseKMers();
+if(!m_bThreadKMerCnts)
+	ReleaseSerialiseKMers();
 return(0);
 }
 
@@ -3569,6 +3821,7 @@ CReadStats::AnalyseReads(tsThreadNGSQCPars *pThread, // thread specific processi
 		UINT8 *pPE2QScores,				// PE2 read quality scores
 		tsInReadsFile *pPE2File)		// file containing PE2
 {
+int Rslt;
 int NumInsts;
 int SeqOfs;
 UINT8 *pBase;
@@ -3631,9 +3884,10 @@ if (m_Trim3)
 	}
 
 // accumulate quality score counts
-AccumQScores(pThread,pPE1File->QSSchema,PE1ReadLen,pPE1RawRead,pPE1QScores);
-if(m_bPEProc)
-	AccumQScores(pThread,pPE2File->QSSchema,PE2ReadLen,pPE2RawRead,pPE2QScores);
+if((Rslt = AccumQScores(pThread,pPE1File->QSSchema,PE1ReadLen,pPE1RawRead,pPE1QScores)) < eBSFSuccess)
+	return((teBSFrsltCodes)Rslt);
+if(m_bPEProc && (Rslt = AccumQScores(pThread,pPE2File->QSSchema,PE2ReadLen,pPE2RawRead,pPE2QScores)) < eBSFSuccess)
+	return((teBSFrsltCodes)Rslt);
 
 // use this read as a sample?
 // will only sample reads which have no bases less than a Phred score of 10 and a mean thred score at least m_MinMeanPhredScore, and which also contain no 'N' indeterminates
@@ -3754,17 +4008,15 @@ if (NumInsts >= 1)
 		else
 			bPE2Contaminated = false;
 		}
-	AcquireSerialise();
-	m_NumChkdPE1ContamHits += 1;
+	pThread->NumChkdPE1ContamHits += 1;
 	if(bPE1Contaminated)
-		m_NumPE1ContamHits += 1;
+		pThread->NumPE1ContamHits += 1;
 	if (m_bPEProc)
 		{
-		m_NumChkdPE2ContamHits += 1;
+		pThread->NumChkdPE2ContamHits += 1;
 		if(bPE2Contaminated)
-			m_NumPE2ContamHits += 1;
+			pThread->NumPE2ContamHits += 1;
 		}
-	ReleaseSerialise();
 	}
 
 if(NumInsts == 1)
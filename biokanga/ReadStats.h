@@ -34,6 +34,10 @@ const UINT32 cHashMask =       0x0fffff;			// hashing is over 10 bases
 const UINT32 cMaxHashArrayEntries = (cHashMask + 1);        // alloc hash array to hold this many entries, must be at least 1 + maximal sized sized hash
 const UINT32 cReallocPackedWrds = (((cMaxRSSeqLen+3)/4) * 1000);	// if needing to realloc memory for holding packed sampled reads then realloc this many additional words 
 
+const int cRSHLLPrecision = 14;						// HyperLogLog distinct read sketches use this many hash bits to select registers
+const int cRSHLLNumRegs = (1 << cRSHLLPrecision);	// giving this many registers per sketch, estimates have a relative standard error of about 1.04/sqrt(cRSHLLNumRegs)
+const size_t cMaxThreadKMerCntsMem = 0x040000000;	// K-mer counts are accumulated by each thread independently if the total memory required by all threads is at most this many bytes
+
 // processing mode enumerations
 typedef enum TAG_eRSDMode
 	{
@@ -109,6 +113,25 @@ typedef struct TAG_sThreadNGSQCPars {
 	INT64 TotNumPEReads;			// total number of PE reads processed by this thread
 	tsSeqCharacteristics SeqCharacteristics; // sequence characteristics for all reads processed by this thread
 	UINT32 KMerCntOfs[cMaxRSSeqLen * cMaxKMerLen];  // each thread buffers offsets into m_pKMerCnts[] untill all K-mers in a read have been identified then updates m_pKMerCnts as an atomic block 
+
+	// distributions are accumulated by each thread independently then merged into the shared distributions after all threads have completed
+	int MinReadLen;					// minimum length read processed by this thread
+	int MaxReadLen;					// maximum length read processed by this thread
+	int AllocdDistsReadLen;			// pBaseNs, pScores and pReadLenDist are currently allocated for reads of at most this length
+	UINT32 *pBaseNs;				// indeterminate counts at each offset along read length
+	UINT32 *pScores;				// Phred score counts at each offset along read length
+	UINT32 *pReadLenDist;			// read length distribution
+	UINT32 NumTruncReads;			// number of reads which were truncated to cMaxRSSeqLen
+	UINT64 ProbNoReadErrDist[100];	// probabilities of read being error free distribution
+	int AllocdKMerReadLen;			// if K-mer counts are accumulated by this thread then pKMerCnts is currently allocated for reads of at most this length
+	size_t AllocdKMerCntsMem;		// memory allocated for pKMerCnts
+	UINT32 *pKMerCnts;				// K-mer counts along lengths of reads processed by this thread
+	UINT32 NumChkdPE1ContamHits;	// number of PE1 sequences checked for contaminant hits
+	UINT32 NumPE1ContamHits;		// number of PE1 sequences with contaminate hits
+	UINT32 NumChkdPE2ContamHits;	// number of PE2 sequences checked for contaminant hits
+	UINT32 NumPE2ContamHits;		// number of PE2 sequences with contaminate hits
+	INT64 NumSketchedReads;			// number of reads, or read pairs, added to HLLRegs
+	UINT8 HLLRegs[cRSHLLNumRegs];	// HyperLogLog sketch of distinct reads, or read pairs, processed by this thread
 } tsThreadNGSQCPars;
 
 typedef struct TAG_sThreadIndependentNGSQCPars {
@@ -161,6 +184,7 @@ class CReadStats
 	int m_KMerCntsEls;			// total number of count elements per base
 	size_t m_AllocdKMerCntsMem;	// allocated memory for K-mer counts
 	UINT32 *m_pKMerCnts;		// to contain all K-mer counts along lengths of reads
+	bool m_bThreadKMerCnts;		// true if K-mer counts are accumulated by each thread independently and merged into m_pKMerCnts after all threads have completed
 
 	int m_MinReadLen;			// minimum length read processed
 	int m_MaxReadLen;			// maximum length read processed
@@ -225,6 +249,9 @@ class CReadStats
 	size_t m_AllocdSampledSeqMem;	// allocation for this many bytes
 	UINT32 *m_pSampledSeqs;		// allocated to hold sampled sequences
 
+	INT64 m_NumSketchedReads;	// number of reads, or read pairs, added to the distinct reads sketch
+	UINT8 m_HLLRegs[cRSHLLNumRegs];	// HyperLogLog sketch of distinct reads, or read pairs, merged from all threads
+
 
 	char *m_pszOutDistFile;		// where to write distributions CSV file
 	char *m_pszOutHTMLFile;		//  where to write distributions HTML5 file
@@ -240,13 +267,11 @@ class CReadStats
 	bool m_bMutexesCreated;			// set true if mutexes and rwlocks created/initialised
 #ifdef _WIN32
 	CRITICAL_SECTION m_hSCritSect;
-	CRITICAL_SECTION m_hSCritSectScores;
 	CRITICAL_SECTION m_hSCritSectKMers;
 	HANDLE m_hMtxMHReads;
 	SRWLOCK m_hRwLock;
 #else
 	pthread_spinlock_t m_hSpinLock;
-	pthread_spinlock_t m_hSpinLockScores;
 	pthread_spinlock_t m_hSpinLockKMers;
 	pthread_mutex_t m_hMtxMHReads;
 	pthread_rwlock_t m_hRwLock;
@@ -260,8 +285,6 @@ class CReadStats
 
 	void AcquireSerialise(void);		// serialise access when determining seed sequences
 	void ReleaseSerialise(void);
-	void AcquireSerialiseScores(void);	// serialise access when updating score counts
-	void ReleaseSerialiseScores(void);
 	void AcquireSerialiseKMers(void);	// serialise access when updating KMer counts
 	void ReleaseSerialiseKMers(void);
 	void AcquireLock(bool bExclusive = false);		// defaults as read only lock
@@ -285,6 +308,32 @@ class CReadStats
 								etSeqBase *pSeq,		// target sequence		
 								bool bPE2 = false);		// false if processing SE/PE1 read, true if PE2
 
+	tsSampledSeq *	// located sampled sequence or NULL if not previously sampled, caller must hold the lock
+		LocateSampledSeq(UINT32 SeqHash,	// sequence hash
+				int PE1ReadLen,			// number of bases in PE1 read
+				int PE2ReadLen,			// number of bases in PE2 read
+				UINT32 *pPackedSeqs,	// packed PE1 and PE2 sequences
+				UINT32 *pTermNxtSeq);	// returned index+1 of last sampled sequence with same hash, 0 if none
+
+	void
+		AddHLLSketch(tsThreadNGSQCPars *pThread, // thread specific processing state and context
+				UINT64 Hash);			// 64bit hash of read, or read pair, sequence
+
+	INT64			// estimated number of distinct reads
+		HLLEstimate(UINT8 *pHLLRegs);	// from this HyperLogLog sketch
+
+	int				// < 0 if errors, eBSFSuccess if thread distributions accumulated into the shared distributions
+		MergeThreadDists(tsThreadNGSQCPars *pThread); // merge this threads distributions
+
+	void
+		FreeThreadDists(tsThreadNGSQCPars *pThread); // free memory allocated for this threads distributions
+
+	int				// < 0 if errors, eBSFSuccess if allocation is for reads of at least ReadLen
+		ReallocKMerCnts(int ReadLen,		// ensure m_pKMerCnts is allocated for reads of at least this length
+					size_t *pAllocdMem,		// current allocation size in bytes
+					int *pAllocdReadLen,	// current allocation is for reads of this length
+					UINT32 **ppKMerCnts);	// allocated K-mer counts
+
 	int				// returns 0 if not accepted as read instance, 1 if this is the first instance of an accepted sampled read, 2..N if multiple instances exist
 		AddReadInst(tsThreadNGSQCPars *pThread, // thread specific processing state and context
 				int PE1ReadLen,			// number of bases in PE1 read
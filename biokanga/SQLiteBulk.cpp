@@ -0,0 +1,978 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#include "stdafx.h"
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#if _WIN32
+#include <process.h>
+#include "../libbiokanga/commhdrs.h"
+#else
+#include <sys/mman.h>
+#include <pthread.h>
+#include "../libbiokanga/commhdrs.h"
+#endif
+
+#include "SQLiteBulk.h"
+
+CSQLiteBulkInsert::CSQLiteBulkInsert(void)
+{
+m_pMultiRowStm = NULL;
+m_pSingleRowStm = NULL;
+m_pVals = NULL;
+m_pText = NULL;
+Reset();
+}
+
+CSQLiteBulkInsert::~CSQLiteBulkInsert(void)
+{
+Reset();
+}
+
+void
+CSQLiteBulkInsert::Reset(void)
+{
+if(m_pMultiRowStm != NULL)
+	{
+	sqlite3_finalize(m_pMultiRowStm);
+	m_pMultiRowStm = NULL;
+	}
+if(m_pSingleRowStm != NULL)
+	{
+	sqlite3_finalize(m_pSingleRowStm);
+	m_pSingleRowStm = NULL;
+	}
+if(m_pVals != NULL)
+	{
+	delete [] m_pVals;
+	m_pVals = NULL;
+	}
+if(m_pText != NULL)
+	{
+	free(m_pText);
+	m_pText = NULL;
+	}
+m_pDB = NULL;
+m_szTblName[0] = '\0';
+m_NumCols = 0;
+m_RowsPerStm = 0;
+m_bAssignIDs = false;
+m_NxtRowID = 0;
+m_NumRows = 0;
+m_NumVals = 0;
+m_TextLen = 0;
+m_AllocdText = 0;
+m_NumInserted = 0;
+m_Rslt = eBSFSuccess;
+}
+
+// set pragmas for bulk loading
+// page size is only effective if set before any tables have been created in a new database
+int
+CSQLiteBulkInsert::TunePragmas(sqlite3 *pDB)
+{
+int sqlite_error;
+char szPragma[200];
+if(pDB == NULL)
+	return(eBSFerrInternal);
+
+sprintf(szPragma,"PRAGMA page_size = %d;PRAGMA cache_size = -%d;PRAGMA temp_store = MEMORY;PRAGMA journal_mode = MEMORY",cSQLiteBulkPageSize,cSQLiteBulkCacheKB);
+if((sqlite_error = sqlite3_exec(pDB,szPragma,NULL,NULL,NULL))!=SQLITE_OK)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - can't set bulk loading pragmas: %s", sqlite3_errmsg(pDB));
+	return(eBSFerrInternal);
+	}
+return(eBSFSuccess);
+}
+
+int
+CSQLiteBulkInsert::Init(sqlite3 *pDB,	// rows to be inserted into this database
+			char *pszTblName,			// into this table
+			char *pszIDCol,				// if not NULL then identifiers for this INTEGER PRIMARY KEY column are assigned by loader
+			char *pszCols)				// comma separated names of the other columns in the order in which values will be added
+{
+int sqlite_error;
+int RowIdx;
+int ColIdx;
+char *pChr;
+char *pszStm;
+char *pszNxt;
+size_t StmLen;
+sqlite3_stmt *pMaxIDStm;
+
+Reset();
+if(pDB == NULL || pszTblName == NULL || pszTblName[0] == '\0' || strlen(pszTblName) >= sizeof(m_szTblName) || pszCols == NULL || pszCols[0] == '\0')
+	return(eBSFerrParams);
+
+m_pDB = pDB;
+strcpy(m_szTblName,pszTblName);
+m_bAssignIDs = pszIDCol != NULL && pszIDCol[0] != '\0';
+m_NumCols = m_bAssignIDs ? 2 : 1;
+for(pChr = pszCols; *pChr != '\0'; pChr++)
+	if(*pChr == ',')
+		m_NumCols += 1;
+if(m_NumCols > cSQLiteBulkMaxCols)
+	{
+	Reset();
+	return(eBSFerrParams);
+	}
+m_RowsPerStm = min(cSQLiteBulkMaxRows,cSQLiteBulkMaxParams / m_NumCols);
+
+// identifiers continue on from any rows already in the table, as would have been assigned by SQLite when inserting rows one at a time
+if(m_bAssignIDs)
+	{
+	char szMaxID[200];
+	sprintf(szMaxID,"SELECT MAX(%s) FROM %s",pszIDCol,pszTblName);
+	if((sqlite_error = sqlite3_prepare_v2(pDB,szMaxID,-1,&pMaxIDStm,NULL))!=SQLITE_OK)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - can't prepare statement on table %s: %s", pszTblName, sqlite3_errmsg(pDB));
+		Reset();
+		return(eBSFerrInternal);
+		}
+	if((sqlite_error = sqlite3_step(pMaxIDStm))!=SQLITE_ROW)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement: %s", sqlite3_errmsg(pDB));
+		sqlite3_finalize(pMaxIDStm);
+		Reset();
+		return(eBSFerrInternal);
+		}
+	m_NxtRowID = sqlite3_column_int64(pMaxIDStm,0) + 1;	// column is NULL, returned as 0, if table is empty
+	sqlite3_finalize(pMaxIDStm);
+	}
+
+// prepare the multirow and single row insert statements
+StmLen = 100 + strlen(pszTblName) + strlen(pszCols) + (m_bAssignIDs ? strlen(pszIDCol) : 0) + ((size_t)m_RowsPerStm * ((m_NumCols * 2) + 3));
+if((pszStm = (char *)malloc(StmLen)) == NULL)
+	{
+	Reset();
+	return(eBSFerrMem);
+	}
+pszNxt = pszStm + sprintf(pszStm,"INSERT INTO %s (%s%s%s) VALUES ",pszTblName,m_bAssignIDs ? pszIDCol : "",m_bAssignIDs ? "," : "",pszCols);
+for(RowIdx = 0; RowIdx < m_RowsPerStm; RowIdx++)
+	{
+	*pszNxt++ = RowIdx == 0 ? '(' : ',';
+	if(RowIdx > 0)
+		*pszNxt++ = '(';
+	for(ColIdx = 0; ColIdx < m_NumCols; ColIdx++)
+		{
+		if(ColIdx > 0)
+			*pszNxt++ = ',';
+		*pszNxt++ = '?';
+		}
+	*pszNxt++ = ')';
+	if(RowIdx == 0)
+		{
+		*pszNxt = '\0';
+		if((sqlite_error = sqlite3_prepare_v2(pDB,pszStm,-1,&m_pSingleRowStm,NULL))!=SQLITE_OK)
+			break;
+		}
+	}
+*pszNxt = '\0';
+if(sqlite_error == SQLITE_OK)
+	sqlite_error = sqlite3_prepare_v2(pDB,pszStm,-1,&m_pMultiRowStm,NULL);
+free(pszStm);
+if(sqlite_error != SQLITE_OK)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - can't prepare insert statement on table %s: %s", pszTblName, sqlite3_errmsg(pDB));
+	Reset();
+	return(eBSFerrInternal);
+	}
+
+if((m_pVals = new tsSQLiteBulkVal [m_RowsPerStm * m_NumCols]) == NULL ||
+	(m_pText = (char *)malloc(cSQLiteBulkInitText)) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CSQLiteBulkInsert: Memory allocation for buffering rows failed");
+	Reset();
+	return(eBSFerrMem);
+	}
+m_AllocdText = cSQLiteBulkInitText;
+return(eBSFSuccess);
+}
+
+INT64
+CSQLiteBulkInsert::NumInserted(void)
+{
+return(m_NumInserted);
+}
+
+tsSQLiteBulkVal *
+CSQLiteBulkInsert::NxtVal(void)
+{
+if(m_pVals == NULL || m_NumVals >= (m_NumRows + 1) * m_NumCols)
+	{
+	m_Rslt = eBSFerrInternal;			// adding more values than columns, or not initialised
+	return(NULL);
+	}
+return(&m_pVals[m_NumVals++]);
+}
+
+INT64									// loader assigned row identifier, 0 if identifiers are assigned by SQLite
+CSQLiteBulkInsert::BeginRow(void)
+{
+INT64 RowID;
+if(!m_bAssignIDs)
+	return(0);
+RowID = m_NxtRowID++;
+AddInt(RowID);
+return(RowID);
+}
+
+void
+CSQLiteBulkInsert::AddInt(INT64 Val)
+{
+tsSQLiteBulkVal *pVal;
+if((pVal = NxtVal()) == NULL)
+	return;
+pVal->ValType = eSQLBVInt;
+pVal->Val.Int = Val;
+}
+
+void
+CSQLiteBulkInsert::AddDouble(double Val)
+{
+tsSQLiteBulkVal *pVal;
+if((pVal = NxtVal()) == NULL)
+	return;
+pVal->ValType = eSQLBVDouble;
+pVal->Val.Dbl = Val;
+}
+
+// text values are bound including the terminating '\0', as the row at a time inserts have always done
+void
+CSQLiteBulkInsert::AddText(char *pszText)
+{
+tsSQLiteBulkVal *pVal;
+size_t TextLen;
+char *pRealloc;
+if((pVal = NxtVal()) == NULL)
+	return;
+TextLen = strlen(pszText) + 1;
+if((m_TextLen + TextLen) > m_AllocdText)
+	{
+	size_t ReallocTo = max(m_AllocdText * 2,m_TextLen + TextLen);
+	if((pRealloc = (char *)realloc(m_pText,ReallocTo)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CSQLiteBulkInsert: Memory reallocation to %lld bytes for buffering text values failed",(INT64)ReallocTo);
+		m_Rslt = eBSFerrMem;
+		pVal->ValType = eSQLBVInt;
+		pVal->Val.Int = 0;
+		return;
+		}
+	m_pText = pRealloc;
+	m_AllocdText = ReallocTo;
+	}
+memcpy(&m_pText[m_TextLen],pszText,TextLen);
+pVal->ValType = eSQLBVText;
+pVal->TextLen = (INT32)TextLen;
+pVal->Val.TextOfs = m_TextLen;
+m_TextLen += TextLen;
+}
+
+int
+CSQLiteBulkInsert::EndRow(void)
+{
+if(m_Rslt < eBSFSuccess)
+	return(m_Rslt);
+if(m_NumVals != (m_NumRows + 1) * m_NumCols)		// row must have had a value added for every column
+	return(m_Rslt = eBSFerrInternal);
+if(++m_NumRows == m_RowsPerStm)
+	return(Flush());
+return(eBSFSuccess);
+}
+
+int
+CSQLiteBulkInsert::BindRows(sqlite3_stmt *pStm,	// bind values to this prepared statement
+				int NumRows,			// for this many rows
+				tsSQLiteBulkVal *pVals)	// starting with these values
+{
+int sqlite_error;
+int ParamIdx;
+int NumParams;
+NumParams = NumRows * m_NumCols;
+for(ParamIdx = 1; ParamIdx <= NumParams; ParamIdx++,pVals++)
+	{
+	switch(pVals->ValType) {
+		case eSQLBVInt:
+			sqlite_error = sqlite3_bind_int64(pStm,ParamIdx,pVals->Val.Int);
+			break;
+		case eSQLBVDouble:
+			sqlite_error = sqlite3_bind_double(pStm,ParamIdx,pVals->Val.Dbl);
+			break;
+		default:
+			sqlite_error = sqlite3_bind_text(pStm,ParamIdx,&m_pText[pVals->Val.TextOfs],pVals->TextLen,SQLITE_STATIC);
+			break;
+		}
+	if(sqlite_error != SQLITE_OK)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB));
+		return(eBSFerrInternal);
+		}
+	}
+return(eBSFSuccess);
+}
+
+int
+CSQLiteBulkInsert::Flush(void)
+{
+int Rslt;
+int sqlite_error;
+int NumRows;
+sqlite3_stmt *pStm;
+tsSQLiteBulkVal *pVals;
+
+if(m_Rslt < eBSFSuccess)
+	return(m_Rslt);
+if(m_pDB == NULL || m_pVals == NULL)
+	return(m_NumRows ? eBSFerrInternal : eBSFSuccess);
+
+pVals = m_pVals;
+while(m_NumRows)
+	{
+	if(m_NumRows == m_RowsPerStm)
+		{
+		pStm = m_pMultiRowStm;
+		NumRows = m_RowsPerStm;
+		}
+	else
+		{
+		pStm = m_pSingleRowStm;
+		NumRows = 1;
+		}
+	if((Rslt = BindRows(pStm,NumRows,pVals)) < eBSFSuccess)
+		return(m_Rslt = Rslt);
+	if((sqlite_error = sqlite3_step(pStm))!=SQLITE_DONE)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement inserting into %s: %s", m_szTblName,sqlite3_errmsg(m_pDB));
+		sqlite3_reset(pStm);
+		return(m_Rslt = eBSFerrInternal);
+		}
+	sqlite3_reset(pStm);
+	pVals += NumRows * m_NumCols;
+	m_NumRows -= NumRows;
+	m_NumInserted += NumRows;
+	}
+m_NumVals = 0;
+m_TextLen = 0;
+return(eBSFSuccess);
+}
+
+
+CSQLiteBulkNames::CSQLiteBulkNames(void)
+{
+m_pNames = NULL;
+m_pszNames = NULL;
+Reset();
+}
+
+CSQLiteBulkNames::~CSQLiteBulkNames(void)
+{
+Reset();
+}
+
+void
+CSQLiteBulkNames::Reset(void)
+{
+if(m_pNames != NULL)
+	{
+	delete [] m_pNames;
+	m_pNames = NULL;
+	}
+if(m_pszNames != NULL)
+	{
+	free(m_pszNames);
+	m_pszNames = NULL;
+	}
+m_NumNames = 0;
+m_AllocdNames = 0;
+m_NamesLen = 0;
+m_AllocdNamesMem = 0;
+}
+
+int
+CSQLiteBulkNames::NumNames(void)
+{
+return(m_NumNames);
+}
+
+// FNV-1a over the lowercased name, names are matched case insensitively as were the most recently accessed caches
+UINT32
+CSQLiteBulkNames::GenNameHash(char *pszName)
+{
+UINT32 Hash = 2166136261;
+while(*pszName != '\0')
+	{
+	Hash ^= (UINT8)tolower(*pszName++);
+	Hash *= 16777619;
+	}
+return(Hash);
+}
+
+int
+CSQLiteBulkNames::Locate(char *pszName)
+{
+UINT32 Hash;
+UINT32 Idx;
+tsSQLiteBulkName *pName;
+if(m_pNames == NULL || pszName == NULL)
+	return(0);
+Hash = GenNameHash(pszName);
+Idx = Hash & (m_AllocdNames - 1);
+while((pName = &m_pNames[Idx])->NameOfs != 0)
+	{
+	if(pName->NameHash == Hash && !stricmp(pszName,&m_pszNames[pName->NameOfs-1]))
+		return(pName->ID);
+	Idx = (Idx + 1) & (m_AllocdNames - 1);
+	}
+return(0);
+}
+
+int
+CSQLiteBulkNames::Grow(void)
+{
+int Idx;
+UINT32 NewIdx;
+int NewAllocd;
+tsSQLiteBulkName *pNewNames;
+tsSQLiteBulkName *pName;
+
+NewAllocd = m_AllocdNames == 0 ? cSQLiteBulkInitNames : m_AllocdNames * 2;
+if((pNewNames = new tsSQLiteBulkName [NewAllocd]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CSQLiteBulkNames: Memory allocation for %d names failed",NewAllocd);
+	return(eBSFerrMem);
+	}
+memset(pNewNames,0,sizeof(tsSQLiteBulkName) * NewAllocd);
+if(m_pNames != NULL)
+	{
+	pName = m_pNames;
+	for(Idx = 0; Idx < m_AllocdNames; Idx++,pName++)
+		{
+		if(pName->NameOfs == 0)
+			continue;
+		NewIdx = pName->NameHash & (NewAllocd - 1);
+		while(pNewNames[NewIdx].NameOfs != 0)
+			NewIdx = (NewIdx + 1) & (NewAllocd - 1);
+		pNewNames[NewIdx] = *pName;
+		}
+	delete [] m_pNames;
+	}
+m_pNames = pNewNames;
+m_AllocdNames = NewAllocd;
+return(eBSFSuccess);
+}
+
+int
+CSQLiteBulkNames::Add(char *pszName,	// associate this name
+			int ID)						// with this identifier (must be > 0)
+{
+int Rslt;
+UINT32 Hash;
+UINT32 Idx;
+size_t NameLen;
+char *pRealloc;
+tsSQLiteBulkName *pName;
+
+if(pszName == NULL || ID <= 0)
+	return(eBSFerrParams);
+
+if((m_NumNames + 1) * 2 > m_AllocdNames)	// keep load factor under 0.5
+	if((Rslt = Grow()) < eBSFSuccess)
+		return(Rslt);
+
+NameLen = strlen(pszName) + 1;
+if((m_NamesLen + NameLen) > m_AllocdNamesMem)
+	{
+	size_t ReallocTo = max(m_AllocdNamesMem * 2,max((size_t)cSQLiteBulkInitNamesMem,m_NamesLen + NameLen));
+	if((pRealloc = (char *)realloc(m_pszNames,ReallocTo)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CSQLiteBulkNames: Memory reallocation to %lld bytes for names failed",(INT64)ReallocTo);
+		return(eBSFerrMem);
+		}
+	m_pszNames = pRealloc;
+	m_AllocdNamesMem = ReallocTo;
+	}
+
+Hash = GenNameHash(pszName);
+Idx = Hash & (m_AllocdNames - 1);
+while((pName = &m_pNames[Idx])->NameOfs != 0)
+	{
+	if(pName->NameHash == Hash && !stricmp(pszName,&m_pszNames[pName->NameOfs-1]))
+		{
+		pName->ID = ID;
+		return(eBSFSuccess);
+		}
+	Idx = (Idx + 1) & (m_AllocdNames - 1);
+	}
+memcpy(&m_pszNames[m_NamesLen],pszName,NameLen);
+pName->NameHash = Hash;
+pName->ID = ID;
+pName->NameOfs = m_NamesLen + 1;
+m_NamesLen += NameLen;
+m_NumNames += 1;
+return(eBSFSuccess);
+}
+
+
+CSQLiteBulkQueue::CSQLiteBulkQueue(void)
+{
+memset(m_Buffs,0,sizeof(m_Buffs));
+m_bLockInitialised = false;
+Reset();
+}
+
+CSQLiteBulkQueue::~CSQLiteBulkQueue(void)
+{
+Reset();
+if(m_bLockInitialised)
+	{
+#ifdef _WIN32
+	DeleteCriticalSection(&m_hSCritSect);
+#else
+	pthread_spin_destroy(&m_hSpinLock);
+#endif
+	m_bLockInitialised = false;
+	}
+}
+
+void
+CSQLiteBulkQueue::Reset(void)
+{
+int Idx;
+for(Idx = 0; Idx < cSQLiteBulkQueueBuffs; Idx++)
+	{
+	if(m_Buffs[Idx].pRecs != NULL)
+		free(m_Buffs[Idx].pRecs);
+	m_Buffs[Idx].pRecs = NULL;
+	m_Buffs[Idx].bFilled = 0;
+	m_Buffs[Idx].Len = 0;
+	}
+m_BuffSize = 0;
+m_WrBuffIdx = 0;
+m_bWrBuff = false;
+m_RdBuffIdx = 0;
+m_bRdBuff = false;
+m_RdOfs = 0;
+m_bEOR = 0;
+m_bTerm = 0;
+m_Rslt = eBSFSuccess;
+}
+
+void
+CSQLiteBulkQueue::AcquireSerialise(void)
+{
+#ifdef _WIN32
+EnterCriticalSection(&m_hSCritSect);
+#else
+pthread_spin_lock(&m_hSpinLock);
+#endif
+}
+
+void
+CSQLiteBulkQueue::ReleaseSerialise(void)
+{
+#ifdef _WIN32
+LeaveCriticalSection(&m_hSCritSect);
+#else
+pthread_spin_unlock(&m_hSpinLock);
+#endif
+}
+
+int
+CSQLiteBulkQueue::Init(size_t BuffSize)		// allocate buffers each of this size
+{
+int Idx;
+Reset();
+if(!m_bLockInitialised)
+	{
+#ifdef _WIN32
+	if(!InitializeCriticalSectionAndSpinCount(&m_hSCritSect,1000))
+#else
+	if(pthread_spin_init(&m_hSpinLock,PTHREAD_PROCESS_PRIVATE)!=0)
+#endif
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CSQLiteBulkQueue: unable to initialise serialisation lock");
+		return(eBSFerrInternal);
+		}
+	m_bLockInitialised = true;
+	}
+for(Idx = 0; Idx < cSQLiteBulkQueueBuffs; Idx++)
+	{
+	if((m_Buffs[Idx].pRecs = (UINT8 *)malloc(BuffSize)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CSQLiteBulkQueue: Memory allocation of %lld bytes for buffering records failed",(INT64)BuffSize);
+		Reset();
+		return(eBSFerrMem);
+		}
+	}
+m_BuffSize = BuffSize;
+return(eBSFSuccess);
+}
+
+// records are prefixed by their length and padded so that each record starts on an 8 byte boundary
+UINT8 *
+CSQLiteBulkQueue::Reserve(size_t RecLen)
+{
+tsSQLiteBulkQueueBuff *pBuff;
+int bFilled;
+int bTerm;
+
+RecLen = (RecLen + 7) & ~(size_t)7;
+if(m_BuffSize == 0 || (RecLen + sizeof(INT64)) > m_BuffSize)
+	return(NULL);
+
+// if insufficient space remaining in the buffer being filled then hand that buffer to the consumer
+if(m_bWrBuff && (m_Buffs[m_WrBuffIdx].Len + sizeof(INT64) + RecLen) > m_BuffSize)
+	{
+	AcquireSerialise();
+	m_Buffs[m_WrBuffIdx].bFilled = 1;
+	ReleaseSerialise();
+	m_WrBuffIdx = (m_WrBuffIdx + 1) % cSQLiteBulkQueueBuffs;
+	m_bWrBuff = false;
+	}
+
+// wait for the next buffer to have been processed by the consumer
+if(!m_bWrBuff)
+	{
+	pBuff = &m_Buffs[m_WrBuffIdx];
+	while(1)
+		{
+		AcquireSerialise();
+		bFilled = pBuff->bFilled;
+		bTerm = m_bTerm;
+		ReleaseSerialise();
+		if(bTerm)
+			return(NULL);
+		if(!bFilled)
+			break;
+		CUtility::SleepMillisecs(1);
+		}
+	pBuff->Len = 0;
+	m_bWrBuff = true;
+	}
+pBuff = &m_Buffs[m_WrBuffIdx];
+return(&pBuff->pRecs[pBuff->Len + sizeof(INT64)]);
+}
+
+void
+CSQLiteBulkQueue::Commit(size_t RecLen)
+{
+tsSQLiteBulkQueueBuff *pBuff;
+RecLen = (RecLen + 7) & ~(size_t)7;
+pBuff = &m_Buffs[m_WrBuffIdx];
+*(INT64 *)&pBuff->pRecs[pBuff->Len] = (INT64)RecLen;
+pBuff->Len += sizeof(INT64) + RecLen;
+}
+
+void
+CSQLiteBulkQueue::Finish(int Rslt)
+{
+AcquireSerialise();
+if(m_bWrBuff && m_Buffs[m_WrBuffIdx].Len > 0)
+	m_Buffs[m_WrBuffIdx].bFilled = 1;
+m_bWrBuff = false;
+m_Rslt = Rslt;
+m_bEOR = 1;
+ReleaseSerialise();
+}
+
+UINT8 *
+CSQLiteBulkQueue::NextRec(void)
+{
+tsSQLiteBulkQueueBuff *pBuff;
+UINT8 *pRec;
+int bFilled;
+int bEOR;
+
+if(m_BuffSize == 0)
+	return(NULL);
+
+// if all records in current buffer have been processed then release buffer back to the producer
+if(m_bRdBuff && m_RdOfs >= m_Buffs[m_RdBuffIdx].Len)
+	{
+	AcquireSerialise();
+	m_Buffs[m_RdBuffIdx].bFilled = 0;
+	ReleaseSerialise();
+	m_RdBuffIdx = (m_RdBuffIdx + 1) % cSQLiteBulkQueueBuffs;
+	m_bRdBuff = false;
+	}
+
+// wait for producer to have filled the next buffer
+if(!m_bRdBuff)
+	{
+	pBuff = &m_Buffs[m_RdBuffIdx];
+	while(1)
+		{
+		AcquireSerialise();
+		bFilled = pBuff->bFilled;
+		bEOR = m_bEOR;
+		ReleaseSerialise();
+		if(bFilled)
+			break;
+		if(bEOR)			// producer fills buffers before flagging that no more records will be queued, so no more records
+			return(NULL);
+		CUtility::SleepMillisecs(1);
+		}
+	m_RdOfs = 0;
+	m_bRdBuff = true;
+	}
+pBuff = &m_Buffs[m_RdBuffIdx];
+pRec = &pBuff->pRecs[m_RdOfs];
+m_RdOfs += sizeof(INT64) + (size_t)*(INT64 *)pRec;
+return(pRec + sizeof(INT64));
+}
+
+void
+CSQLiteBulkQueue::Terminate(void)
+{
+AcquireSerialise();
+m_bTerm = 1;
+ReleaseSerialise();
+}
+
+int
+CSQLiteBulkQueue::GetRslt(void)
+{
+int Rslt;
+AcquireSerialise();
+Rslt = m_Rslt;
+ReleaseSerialise();
+return(Rslt);
+}
+
+
+CSQLiteBulkCSV::CSQLiteBulkCSV(void)
+{
+m_pCSV = NULL;
+m_ppFields = NULL;
+m_MaxFields = 0;
+m_CurNumFields = 0;
+m_bCurLikelyHeader = false;
+m_bParsing = false;
+}
+
+CSQLiteBulkCSV::~CSQLiteBulkCSV(void)
+{
+Close();
+if(m_pCSV != NULL)
+	delete m_pCSV;
+}
+
+int
+CSQLiteBulkCSV::SetMaxFields(int NumFields)
+{
+if(m_pCSV == NULL && (m_pCSV = new CCSVFile) == NULL)
+	return(eBSFerrObj);
+return(m_pCSV->SetMaxFields(NumFields));
+}
+
+int
+CSQLiteBulkCSV::NumErrMsgs(void)
+{
+return(m_pCSV == NULL ? 0 : m_pCSV->NumErrMsgs());
+}
+
+char *
+CSQLiteBulkCSV::GetErrMsg(void)
+{
+return(m_pCSV == NULL ? NULL : m_pCSV->GetErrMsg());
+}
+
+// Thread startup for CSV parsing
+#ifdef _WIN32
+unsigned int __stdcall CSQLiteBulkCSV::ParseThreadStart(void *args)
+{
+#else
+void * CSQLiteBulkCSV::ParseThreadStart(void *args)
+{
+#endif
+CSQLiteBulkCSV *pThis = (CSQLiteBulkCSV *)args;
+pThis->ParseCSV();
+#ifdef _WIN32
+ExitThread(1);
+#else
+return NULL;
+#endif
+}
+
+int
+CSQLiteBulkCSV::Open(char *pszFileName)
+{
+int Rslt;
+Close();
+if(m_pCSV == NULL && (m_pCSV = new CCSVFile) == NULL)
+	return(eBSFerrObj);
+if((Rslt = m_pCSV->Open(pszFileName)) != eBSFSuccess)
+	return(Rslt);
+m_MaxFields = m_pCSV->GetMaxFields();
+if((m_ppFields = new char * [m_MaxFields]) == NULL)
+	{
+	m_pCSV->Close();
+	return(eBSFerrMem);
+	}
+if((Rslt = m_Queue.Init()) != eBSFSuccess)
+	{
+	Close();
+	return(Rslt);
+	}
+m_bParsing = true;
+#ifdef _WIN32
+m_threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ParseThreadStart,this,0,&m_threadID);
+#else
+m_threadRslt = pthread_create(&m_threadID,NULL,ParseThreadStart,this);
+#endif
+return(eBSFSuccess);
+}
+
+void
+CSQLiteBulkCSV::JoinParser(void)
+{
+if(!m_bParsing)
+	return;
+m_Queue.Terminate();
+#ifdef _WIN32
+WaitForSingleObject(m_threadHandle,INFINITE);
+CloseHandle(m_threadHandle);
+#else
+pthread_join(m_threadID,NULL);
+#endif
+m_bParsing = false;
+}
+
+int
+CSQLiteBulkCSV::Close(void)
+{
+JoinParser();
+m_Queue.Reset();
+if(m_ppFields != NULL)
+	{
+	delete [] m_ppFields;
+	m_ppFields = NULL;
+	}
+m_MaxFields = 0;
+m_CurNumFields = 0;
+m_bCurLikelyHeader = false;
+if(m_pCSV != NULL)
+	m_pCSV->Close();
+return(eBSFSuccess);
+}
+
+// parsing thread, each parsed line is queued as a tsSQLiteBulkCSVLine followed by the line's '\0' terminated field values
+// likely header lines are only checked for until the first line which is not a likely header line, the importers only skip leading header lines
+int
+CSQLiteBulkCSV::ParseCSV(void)
+{
+int Rslt;
+int NumFields;
+int FieldIdx;
+size_t RecLen;
+size_t ValLen;
+bool bChkHeader;
+char *pszVal;
+char *pszDst;
+UINT8 *pRec;
+tsSQLiteBulkCSVLine *pLine;
+
+bChkHeader = true;
+while((Rslt = m_pCSV->NextLine()) > 0)
+	{
+	NumFields = m_pCSV->GetCurFields();
+	RecLen = sizeof(tsSQLiteBulkCSVLine);
+	for(FieldIdx = 1; FieldIdx <= NumFields; FieldIdx++)
+		{
+		m_pCSV->GetText(FieldIdx,&pszVal);
+		RecLen += strlen(pszVal) + 1;
+		}
+	if((pRec = m_Queue.Reserve(RecLen)) == NULL)
+		{
+		Rslt = eBSFerrParse;		// either terminated by the consumer, or line too long to be queued
+		break;
+		}
+	pLine = (tsSQLiteBulkCSVLine *)pRec;
+	pLine->NumFields = NumFields;
+	pLine->bLikelyHeader = bChkHeader && m_pCSV->IsLikelyHeaderLine() ? 1 : 0;
+	if(!pLine->bLikelyHeader)
+		bChkHeader = false;
+	pszDst = (char *)&pLine[1];
+	for(FieldIdx = 1; FieldIdx <= NumFields; FieldIdx++)
+		{
+		m_pCSV->GetText(FieldIdx,&pszVal);
+		ValLen = strlen(pszVal) + 1;
+		memcpy(pszDst,pszVal,ValLen);
+		pszDst += ValLen;
+		}
+	m_Queue.Commit(RecLen);
+	}
+m_Queue.Finish(Rslt);
+return(Rslt);
+}
+
+int
+CSQLiteBulkCSV::NextLine(void)
+{
+tsSQLiteBulkCSVLine *pLine;
+char *pszVal;
+int FieldIdx;
+
+m_CurNumFields = 0;
+m_bCurLikelyHeader = false;
+if(!m_bParsing)
+	return(eBSFerrFileClosed);
+if((pLine = (tsSQLiteBulkCSVLine *)m_Queue.NextRec()) == NULL)
+	return(m_Queue.GetRslt());
+pszVal = (char *)&pLine[1];
+for(FieldIdx = 0; FieldIdx < pLine->NumFields && FieldIdx < m_MaxFields; FieldIdx++)
+	{
+	m_ppFields[FieldIdx] = pszVal;
+	pszVal += strlen(pszVal) + 1;
+	}
+m_CurNumFields = FieldIdx;
+m_bCurLikelyHeader = pLine->bLikelyHeader ? true : false;
+return(m_CurNumFields);
+}
+
+int
+CSQLiteBulkCSV::GetCurFields(void)
+{
+if(!m_bParsing)
+	return(eBSFerrFileClosed);
+return(m_CurNumFields);
+}
+
+bool
+CSQLiteBulkCSV::IsLikelyHeaderLine(void)
+{
+return(m_bCurLikelyHeader);
+}
+
+int
+CSQLiteBulkCSV::GetInt(int FieldID,int *pRetInt)
+{
+if(FieldID < 1 || FieldID > m_CurNumFields)
+	return(eBSFerrFieldID);
+*pRetInt = atoi(m_ppFields[FieldID-1]);
+return(errno == ERANGE ? eBSFerrNumRange : eBSFSuccess);
+}
+
+int
+CSQLiteBulkCSV::GetDouble(int FieldID,double *pRetDouble)
+{
+if(FieldID < 1 || FieldID > m_CurNumFields)
+	return(eBSFerrFieldID);
+*pRetDouble = atof(m_ppFields[FieldID-1]);
+return(errno == ERANGE ? eBSFerrNumRange : eBSFSuccess);
+}
+
+int
+CSQLiteBulkCSV::GetText(int FieldID,char **ppszRetText)
+{
+if(FieldID < 1 || FieldID > m_CurNumFields)
+	return(eBSFerrFieldID);
+*ppszRetText = m_ppFields[FieldID-1];
+return(eBSFSuccess);
+}
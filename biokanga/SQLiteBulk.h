@@ -0,0 +1,213 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#pragma once
+
+// Bulk loading support shared by the SQLite importers (psl2sqlite, snpm2sqlite, snps2sqlite and de2sqlite)
+// CSQLiteBulkInsert buffers rows and inserts these with multirow INSERT statements, row identifiers are assigned by the loader instead of being
+// retrieved from SQLite after each row has been inserted
+// CSQLiteBulkNames retains name to identifier mappings in memory so identifiers of previously inserted rows need not be selected back from SQLite
+// CSQLiteBulkQueue hands blocks of parsed records from a parsing thread to the inserting thread
+// CSQLiteBulkCSV parses CSV files on its own thread, presenting the subset of the CCSVFile interface used by the importers
+
+const int cSQLiteBulkMaxParams = 999;			// multirow INSERT statements bind at most this many parameters (SQLite default limit prior to 3.32)
+const int cSQLiteBulkMaxRows = 250;				// and insert at most this many rows
+const int cSQLiteBulkMaxCols = 32;				// tables to be bulk inserted have at most this many columns
+const int cSQLiteBulkPageSize = 32768;			// page size used when creating new databases
+const int cSQLiteBulkCacheKB = 500000;			// page cache size (KB) used whilst populating tables and generating indexes
+const int cSQLiteBulkInitText = 0x010000;		// initial allocation for buffered text values, realloc'd as may be required
+
+const int cSQLiteBulkQueueBuffs = 4;			// parsed records are handed from the parsing thread to the inserting thread through this many buffers
+const int cSQLiteBulkQueueBuffSize = 0x0800000;	// each buffer holds this many bytes of parsed records
+
+const int cSQLiteBulkInitNames = 0x010000;		// names hash table initially sized to hold this many entries, doubled as may be required
+const int cSQLiteBulkInitNamesMem = 0x0100000;	// initial allocation for concatenated names, realloc'd as may be required
+
+typedef enum TAG_eSQLiteBulkValType {
+	eSQLBVInt = 0,					// integer value
+	eSQLBVDouble,					// real value
+	eSQLBVText						// text value
+	} etSQLiteBulkValType;
+
+#pragma pack(1)
+typedef struct TAG_sSQLiteBulkVal {
+	UINT8 ValType;					// value type, one of etSQLiteBulkValType
+	INT32 TextLen;					// if text then length including terminating '\0'
+	union {
+		INT64 Int;					// integer value
+		double Dbl;					// real value
+		INT64 TextOfs;				// offset of text in buffered text values
+		} Val;
+	} tsSQLiteBulkVal;
+
+typedef struct TAG_sSQLiteBulkName {
+	UINT32 NameHash;				// hash over lowercased name
+	INT32 ID;						// identifier associated with name
+	INT64 NameOfs;					// offset+1 of '\0' terminated name in concatenated names, 0 if hash table entry is unused
+	} tsSQLiteBulkName;
+
+typedef struct TAG_sSQLiteBulkQueueBuff {
+	volatile int bFilled;			// set by producer when buffer has been filled with records, reset by consumer when all records processed
+	size_t Len;						// buffer contains this many bytes of records
+	UINT8 *pRecs;					// length prefixed records
+	} tsSQLiteBulkQueueBuff;
+
+typedef struct TAG_sSQLiteBulkCSVLine {
+	INT32 NumFields;				// line contains this many fields, following are NumFields concatenated '\0' terminated field values
+	INT32 bLikelyHeader;			// true if line is likely to be a header line
+	} tsSQLiteBulkCSVLine;
+#pragma pack()
+
+class CSQLiteBulkInsert
+{
+	sqlite3 *m_pDB;						// inserting into this database
+	char m_szTblName[80];				// inserting rows into this table
+	int m_NumCols;						// number of values, including any loader assigned row identifier, in each row
+	int m_RowsPerStm;					// multirow insert statement inserts this many rows
+	sqlite3_stmt *m_pMultiRowStm;		// prepared multirow insert statement
+	sqlite3_stmt *m_pSingleRowStm;		// prepared single row insert statement used for any rows remaining when flushing
+	bool m_bAssignIDs;					// true if row identifiers are assigned by loader
+	INT64 m_NxtRowID;					// next row identifier to be assigned
+	int m_NumRows;						// number of completed rows currently buffered
+	int m_NumVals;						// number of values currently buffered
+	tsSQLiteBulkVal *m_pVals;			// buffered values, sized for m_RowsPerStm rows
+	size_t m_TextLen;					// number of buffered text chars
+	size_t m_AllocdText;				// m_pText allocated to hold this many chars
+	char *m_pText;						// buffered text values
+	INT64 m_NumInserted;				// number of rows inserted
+	int m_Rslt;							// set < eBSFSuccess if any errors whilst buffering values
+
+	tsSQLiteBulkVal *NxtVal(void);		// returns ptr to next value in current row, NULL if row already has m_NumCols values
+
+	int BindRows(sqlite3_stmt *pStm,	// bind values to this prepared statement
+				int NumRows,			// for this many rows
+				tsSQLiteBulkVal *pVals);	// starting with these values
+
+public:
+	CSQLiteBulkInsert(void);
+	~CSQLiteBulkInsert(void);
+
+	void Reset(void);					// finalise prepared statements and discard any buffered rows
+
+	int Init(sqlite3 *pDB,				// rows to be inserted into this database
+			char *pszTblName,			// into this table
+			char *pszIDCol,				// if not NULL then identifiers for this INTEGER PRIMARY KEY column are assigned by loader
+			char *pszCols);				// comma separated names of the other columns in the order in which values will be added
+
+	INT64 BeginRow(void);				// start a new row, returns loader assigned row identifier or 0 if identifiers are assigned by SQLite
+	void AddInt(INT64 Val);				// add integer value to current row
+	void AddDouble(double Val);			// add real value to current row
+	void AddText(char *pszText);		// add '\0' terminated text value to current row
+	int EndRow(void);					// complete current row, inserting buffered rows if sufficient to fill a multirow statement
+	int Flush(void);					// insert all buffered rows
+	INT64 NumInserted(void);			// returns number of rows inserted
+
+	static int TunePragmas(sqlite3 *pDB);	// set page size (effective only if database is newly created), cache size, temp store and journal mode for bulk loading
+};
+
+class CSQLiteBulkNames
+{
+	int m_NumNames;						// number of names in hash table
+	int m_AllocdNames;					// hash table sized for this many entries, always a power of 2
+	tsSQLiteBulkName *m_pNames;			// open addressed hash table
+	size_t m_NamesLen;					// concatenated names currently use this many chars
+	size_t m_AllocdNamesMem;			// m_pszNames allocated to hold this many chars
+	char *m_pszNames;					// concatenated '\0' terminated names
+
+	static UINT32 GenNameHash(char *pszName);	// hash over lowercased name
+	int Grow(void);						// double hash table size
+public:
+	CSQLiteBulkNames(void);
+	~CSQLiteBulkNames(void);
+	void Reset(void);
+	int Locate(char *pszName);			// returns identifier associated with name (case insensitive), 0 if name not known
+	int Add(char *pszName,				// associate this name
+			int ID);					// with this identifier (must be > 0)
+	int NumNames(void);					// returns number of names
+};
+
+class CSQLiteBulkQueue
+{
+	size_t m_BuffSize;					// each buffer is this size
+	tsSQLiteBulkQueueBuff m_Buffs[cSQLiteBulkQueueBuffs];	// buffers used in rotation
+	int m_WrBuffIdx;					// producer is filling this buffer
+	bool m_bWrBuff;						// true if producer has m_Buffs[m_WrBuffIdx] available for filling
+	int m_RdBuffIdx;					// consumer is processing this buffer
+	bool m_bRdBuff;						// true if consumer is processing m_Buffs[m_RdBuffIdx]
+	size_t m_RdOfs;						// offset in m_Buffs[m_RdBuffIdx] of next record to be processed
+	volatile int m_bEOR;				// set by producer when no more records will be queued
+	volatile int m_bTerm;				// set by consumer when producer is to terminate
+	int m_Rslt;							// producer's result as set when no more records will be queued
+
+#ifdef _WIN32
+	CRITICAL_SECTION m_hSCritSect;
+#else
+	pthread_spinlock_t m_hSpinLock;
+#endif
+	bool m_bLockInitialised;			// true if serialisation lock has been initialised
+	void AcquireSerialise(void);
+	void ReleaseSerialise(void);
+
+public:
+	CSQLiteBulkQueue(void);
+	~CSQLiteBulkQueue(void);
+	void Reset(void);
+	int Init(size_t BuffSize = cSQLiteBulkQueueBuffSize);	// allocate buffers each of this size
+
+	// producer
+	UINT8 *Reserve(size_t RecLen);		// returns ptr to space for record of at most RecLen bytes, NULL if consumer has terminated or RecLen too large
+	void Commit(size_t RecLen);			// record of RecLen bytes (no more than was reserved) has been written
+	void Finish(int Rslt);				// no more records will be queued, Rslt is returned to consumer by GetRslt()
+
+	// consumer
+	UINT8 *NextRec(void);				// returns ptr to next record, remains valid until next call; NULL if no more records
+	void Terminate(void);				// producer is to terminate
+	int GetRslt(void);					// producer's result, available after NextRec() has returned NULL
+};
+
+class CSQLiteBulkCSV
+{
+	CCSVFile *m_pCSV;					// parsing this CSV file
+	CSQLiteBulkQueue m_Queue;			// parsed lines are queued for the consumer
+	int m_MaxFields;					// lines contain at most this many fields
+	char **m_ppFields;					// ptrs to current line field values
+	int m_CurNumFields;					// current line contains this many fields
+	bool m_bCurLikelyHeader;			// true if current line is likely to be a header line
+	bool m_bParsing;					// true if parsing thread has been started and not yet joined
+#ifdef _WIN32
+	HANDLE m_threadHandle;				// handle as returned by _beginthreadex()
+	unsigned int m_threadID;			// identifier as set by _beginthreadex()
+#else
+	int m_threadRslt;					// result as returned by pthread_create ()
+	pthread_t m_threadID;				// identifier as set by pthread_create ()
+#endif
+
+	void JoinParser(void);				// terminate and wait for parsing thread
+public:
+	CSQLiteBulkCSV(void);
+	~CSQLiteBulkCSV(void);
+
+	int SetMaxFields(int NumFields);	// set maximum number of fields - must be set prior to Open()
+	int Open(char *pszFileName);		// open CSV file and start parsing thread
+	int Close(void);					// terminate parsing thread and close CSV file
+	int NextLine(void);					// move to next line, returns number of fields, 0 if no more lines, < 0 if parse errors
+	int GetCurFields(void);				// get current number of fields
+	bool IsLikelyHeaderLine(void);		// true if current line is likely to be a header line
+	int GetInt(int FieldID,int *pRetInt);
+	int GetDouble(int FieldID,double *pRetDouble);
+	int GetText(int FieldID,char **ppszRetText);
+	int NumErrMsgs(void);				// number of error messages from CCSVFile
+	char *GetErrMsg(void);				// returns oldest error message from CCSVFile
+
+	int ParseCSV(void);					// parsing thread, queues parsed lines for the consumer
+
+#ifdef _WIN32
+	static unsigned int __stdcall ParseThreadStart(void *args);	// CSV parsing thread startup
+#else
+	static void *ParseThreadStart(void *args);	// CSV parsing thread startup
+#endif
+};
@@ -19,6 +19,7 @@
 #include "../libbiokanga/commhdrs.h"
 #endif
 
+#include "SQLiteBulk.h"
 #include "SQLiteDE.h"
 
 // Following database schema is utilised
@@ -203,6 +204,15 @@ if((sqlite_error = sqlite3_open_v2(pszDatabase, &m_pDB,SQLITE_OPEN_READWRITE | S
 	return(NULL);
 	}
 
+// page size must be set before any tables are created
+if(CSQLiteBulkInsert::TunePragmas(m_pDB) < eBSFSuccess)
+	{
+	sqlite3_close_v2(m_pDB);
+	sqlite3_shutdown();
+	m_pDB = NULL;
+	return(NULL);
+	}
+
 // create all tables
 pStms = m_StmSQL;
 for(TblIdx = 0; TblIdx < 4; TblIdx++,pStms++)
@@ -242,9 +252,10 @@ if(bSafe)
 	}
 else
 	{
+	// indexes which will be generated after the tables have been populated are deferred, names are resolved in memory whilst bulk inserting
 	for(TblIdx = 0; TblIdx < 4; TblIdx++,pStms++)
 		{
-		if(pStms->pszOpenCreateIndexes == NULL)
+		if(pStms->pszOpenCreateIndexes == NULL || pStms->pszCreateIndexes != NULL)
 			continue;
 		if((sqlite_error = sqlite3_exec(m_pDB,pStms->pszOpenCreateIndexes,0,0,0))!=SQLITE_OK)
 			{
@@ -285,6 +296,22 @@ for(TblIdx = 0; TblIdx <4; TblIdx++,pStms++)
 		return(NULL);
 		}
 	}
+
+// if not safe then transcripts, expressions and bins are inserted in bulk with identifiers assigned when buffered
+if(!bSafe)
+	{
+	if(m_BulkInserts[1].Init(m_pDB,m_StmSQL[1].pTblName,(char *)"TransID",(char *)"ExprID,TransName,Exons,TransLen,TransAnnotation") < eBSFSuccess ||
+		m_BulkInserts[2].Init(m_pDB,m_StmSQL[2].pTblName,(char *)"ExpresID",(char *)"ExprID,TransID,Class,Score,DECntsScore,PearsonScore,CtrlUniqueLoci,ExprUniqueLoci,CtrlExprLociRatio," \
+									"PValueMedian,PValueLow95,PValueHi95,TotCtrlCnts,TotExprCnts,TotCtrlExprCnts,ObsFoldChange," \
+									"FoldMedian,FoldLow95,FoldHi95,ObsPearson,PearsonMedian,PearsonLow95,PearsonHi95," \
+									"CtrlAndExprBins,CtrlOnlyBins,ExprOnlyBins") < eBSFSuccess ||
+		m_BulkInserts[3].Init(m_pDB,m_StmSQL[3].pTblName,(char *)"BinID",(char *)"ExprID,TransID,ExpresID,NthBin,CtrlCounts,ExprCounts") < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - can't initialise bulk inserts: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(false);
+		return(NULL);
+		}
+	}
 return(m_pDB);
 }
 
@@ -295,6 +322,9 @@ int TblIdx;
 int Rslt = 0;
 tsDEStmSQL *pStms;
 pStms = m_StmSQL;
+for(TblIdx = 0; TblIdx < 4; TblIdx++)
+	m_BulkInserts[TblIdx].Reset();
+m_TransNames.Reset();
 if(m_pDB != NULL)
 	{
 	if(!bNoIndexes)
@@ -443,6 +473,27 @@ char szQueryTransName[200];
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 
+if(!m_bSafe)		// bulk loading, transcript identifiers are retained in memory for all transcripts and assigned when buffered
+	{
+	if((TransID = m_TransNames.Locate(pszTransName)) > 0)
+		return(TransID);
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[1];
+	TransID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddText(pszTransName);
+	pBulk->AddInt(NumExons);
+	pBulk->AddInt(TransLen);
+	pBulk->AddText(pszAnnotation);
+	if(pBulk->EndRow() < eBSFSuccess || m_TransNames.Add(pszTransName,TransID) < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblTrans: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	m_NumTrans += 1;
+	return(TransID);
+	}
+
 if(!m_NumTransMRA)
 	memset(m_MRATrans,0,sizeof(m_MRATrans));
 
@@ -579,6 +630,46 @@ int ExpresID;
 char szQueryExpresID[200];
 
 pStm = &m_StmSQL[2];								// access sequence statements
+if(!m_bSafe)
+	{
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[2];
+	ExpresID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(TransID);
+	pBulk->AddInt(Class);
+	pBulk->AddInt(Score);
+	pBulk->AddInt(DECntsScore);
+	pBulk->AddInt(PearsonScore);
+	pBulk->AddInt(CtrlUniqueLoci);
+	pBulk->AddInt(ExprUniqueLoci);
+	pBulk->AddDouble(CtrlExprLociRatio);
+	pBulk->AddDouble(PValueMedian);
+	pBulk->AddDouble(PValueLow95);
+	pBulk->AddDouble(PValueHi95);
+	pBulk->AddInt(TotCtrlCnts);
+	pBulk->AddInt(TotExprCnts);
+	pBulk->AddInt(TotCtrlExprCnts);
+	pBulk->AddDouble(ObsFoldChange);
+	pBulk->AddDouble(FoldMedian);
+	pBulk->AddDouble(FoldLow95);
+	pBulk->AddDouble(FoldHi95);
+	pBulk->AddDouble(ObsPearson);
+	pBulk->AddDouble(PearsonMedian);
+	pBulk->AddDouble(PearsonLow95);
+	pBulk->AddDouble(PearsonHi95);
+	pBulk->AddInt(CtrlAndExprBins);
+	pBulk->AddInt(CtrlOnlyBins);
+	pBulk->AddInt(ExprOnlyBins);
+	if(pBulk->EndRow() < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblExpres: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	m_NumExpres += 1;
+	return(ExpresID);
+	}
+
 if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
@@ -774,6 +865,24 @@ char szQueryBinID[200];
 pStm = &m_StmSQL[3];								// access sequence statements
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
+if(!m_bSafe)
+	{
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[3];
+	BinID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(TransID);
+	pBulk->AddInt(ExpresID);
+	pBulk->AddInt(NthBin);
+	pBulk->AddInt(CtrlCounts);
+	pBulk->AddInt(ExprCounts);
+	if(pBulk->EndRow() < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblBins: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	return(BinID);
+	}
 if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
@@ -804,7 +913,7 @@ if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 5, CtrlCounts))!=SQLITE_O
 	CloseDatabase(true);
 	return(eBSFerrInternal);
 	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 6, CtrlCounts))!=SQLITE_OK)
+if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 6, ExprCounts))!=SQLITE_OK)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
 	CloseDatabase(true);
@@ -890,10 +999,11 @@ int ExpNumFields;
 
 
 // load CSV file and determine number of fields, from these it can be determined if the file also contains the bin counts
-CCSVFile *pCSV = new CCSVFile;
+// CSV lines are parsed on their own thread
+CSQLiteBulkCSV *pCSV = new CSQLiteBulkCSV;
 if(pCSV == NULL)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to instantiate CCSVfile");
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to instantiate CSQLiteBulkCSV");
 	CloseDatabase(true);
 	return(eBSFerrObj);
 	}
@@ -1122,8 +1232,20 @@ while((Rslt=pCSV->NextLine()) > 0)			// onto next line containing fields
 			BinID = AddBin(ExprID,TransID,ExpresID,BinIdx,*pBinValue,pBinValue[1]);
 		}
 	}
+delete pCSV;
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Parsed %d CSV lines - transcripts: %d",NumElsRead, m_NumTrans);
 
+if(!bSafe)		// insert any rows remaining buffered
+	{
+	for(int BulkIdx = 1; BulkIdx < 4; BulkIdx++)
+		if(m_BulkInserts[BulkIdx].Flush() < eBSFSuccess)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into %s: %s", m_StmSQL[BulkIdx].pTblName,sqlite3_errmsg(m_pDB)); 
+			CloseDatabase(true);
+			return(eBSFerrInternal);
+			}
+	}
+
 	// end transaction
 if((sqlite_error = sqlite3_exec(m_pDB,pszEndTransaction,NULL,NULL,NULL))!=SQLITE_OK)
 	{
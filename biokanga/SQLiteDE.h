@@ -41,6 +41,8 @@ class CSQLiteDE
 	int m_NumTransMRA;					// number of entries in MRA transcript table
 	static tsDEStmSQL m_StmSQL[4];		// SQLite table and index statements
 	tsMRATrans m_MRATrans[cMaxMRATrans];	// MRA transcripts
+	CSQLiteBulkInsert m_BulkInserts[4];	// if not safe then rows are inserted in bulk, indexed as m_StmSQL
+	CSQLiteBulkNames m_TransNames;		// if not safe then identifiers for all transcripts are retained in memory
 
 	bool m_bSafe;						// true if safe select required rather than simply getting last assigned ROWID
 	int m_NumTrans;						// number of transcripts added to TblTrans
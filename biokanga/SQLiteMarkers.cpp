@@ -19,6 +19,7 @@
 #include "../libbiokanga/commhdrs.h"
 #endif
 
+#include "SQLiteBulk.h"
 #include "SQLiteMarkers.h"
 
 // Following database schema is utilised
@@ -220,6 +221,15 @@ if((sqlite_error = sqlite3_open_v2(pszDatabase, &m_pDB,SQLITE_OPEN_READWRITE | S
 	return(NULL);
 	}
 
+// page size must be set before any tables are created
+if(CSQLiteBulkInsert::TunePragmas(m_pDB) < eBSFSuccess)
+	{
+	sqlite3_close_v2(m_pDB);
+	sqlite3_shutdown();
+	m_pDB = NULL;
+	return(NULL);
+	}
+
 // create all tables
 pStms = m_StmSQL;
 for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
@@ -302,6 +312,21 @@ for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
 		return(NULL);
 		}
 	}
+
+// if not safe then sequences, loci, SNPs and markers are inserted in bulk with identifiers assigned when buffered
+if(!bSafe)
+	{
+	if(m_BulkInserts[2].Init(m_pDB,m_StmSQL[2].pTblName,(char *)"SeqID",(char *)"ExprID,SeqName") < eBSFSuccess ||
+		m_BulkInserts[3].Init(m_pDB,m_StmSQL[3].pTblName,(char *)"LociID",(char *)"ExprID,SeqID,Offset,Base") < eBSFSuccess ||
+		m_BulkInserts[4].Init(m_pDB,m_StmSQL[4].pTblName,(char *)"SnpID",(char *)"ExprID,CultID,LociID,SrcCnts,Acnt,Ccnt,Gcnt,Tcnt,Ncnt,TotCovCnt,TotMMCnt") < eBSFSuccess ||
+		m_BulkInserts[5].Init(m_pDB,m_StmSQL[5].pTblName,(char *)"MarkerID",(char *)"ExprID,CultID,LociID,Base,Score") < eBSFSuccess ||
+		m_BulkInserts[6].Init(m_pDB,m_StmSQL[6].pTblName,(char *)"MarkerSnpsID",(char *)"ExprID,MarkerID,SnpID") < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - can't initialise bulk inserts: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(false);
+		return(NULL);
+		}
+	}
 return(m_pDB);
 }
 
@@ -312,6 +337,9 @@ int TblIdx;
 int Rslt = 0;
 tsStmSQL *pStms;
 pStms = m_StmSQL;
+for(TblIdx = 0; TblIdx < 7; TblIdx++)
+	m_BulkInserts[TblIdx].Reset();
+m_SeqNames.Reset();
 if(m_pDB != NULL)
 	{
 	if(!bNoIndexes)
@@ -516,6 +544,24 @@ char szSeqTarg[200];
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 
+if(!m_bSafe)		// bulk loading, sequence identifiers are retained in memory for all sequences and assigned when buffered
+	{
+	if((SeqID = m_SeqNames.Locate(pszSeqName)) > 0)
+		return(SeqID);
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[2];
+	SeqID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddText(pszSeqName);
+	if(pBulk->EndRow() < eBSFSuccess || m_SeqNames.Add(pszSeqName,SeqID) < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblSeqs: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	m_NumSeqs += 1;
+	return(SeqID);
+	}
+
 if(!m_NumSeqMRA)
 	memset(m_MRASeqs,0,sizeof(m_MRASeqs));
 
@@ -614,6 +660,24 @@ szBase[1] = '\0';			// so easiest to use a VARCHAR(1) text string
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 
+if(!m_bSafe)
+	{
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[3];
+	LociID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(SeqID);
+	pBulk->AddInt(Offset);
+	pBulk->AddText(szBase);
+	if(pBulk->EndRow() < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblLoci: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	m_NumSNPLoci += 1;
+	return(LociID);
+	}
+
 pStm = &m_StmSQL[3];								// access sequence statements
 if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
 	{
@@ -685,6 +749,32 @@ if(m_pDB == NULL)
 
 szSrcCnts[0] = SrcCnts;
 szSrcCnts[1] = '\0';
+
+if(!m_bSafe)
+	{
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[4];
+	SnpID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(CultID);
+	pBulk->AddInt(LociID);
+	pBulk->AddText(szSrcCnts);
+	pBulk->AddInt(Acnt);
+	pBulk->AddInt(Ccnt);
+	pBulk->AddInt(Gcnt);
+	pBulk->AddInt(Tcnt);
+	pBulk->AddInt(Ncnt);
+	pBulk->AddInt(TotCovCnt);
+	pBulk->AddInt(TotMMCnt);
+	if(pBulk->EndRow() < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblSnps: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	m_NumSNPs += 1;
+	return(SnpID);
+	}
+
 if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
@@ -794,6 +884,25 @@ pStm = &m_StmSQL[5];								// access sequence statements
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 
+if(!m_bSafe)
+	{
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[5];
+	MarkerID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(CultID);
+	pBulk->AddInt(LociID);
+	pBulk->AddText(szBase);
+	pBulk->AddInt(MarkerScore);
+	if(pBulk->EndRow() < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblMarkers: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	m_NumMarkers += 1;
+	return(MarkerID);
+	}
+
 if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
@@ -857,6 +966,21 @@ char szMarkerSnp[200];
 pStm = &m_StmSQL[6];								// access sequence statements
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
+if(!m_bSafe)
+	{
+	CSQLiteBulkInsert *pBulk = &m_BulkInserts[6];
+	MarkerSnpID = (int)pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(MarkerID);
+	pBulk->AddInt(SnpID);
+	if(pBulk->EndRow() < eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into TblMarkerSnps: %s", sqlite3_errmsg(m_pDB));
+		CloseDatabase(true);
+		return(eBSFerrInternal);
+		}
+	return(MarkerSnpID);
+	}
 if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
@@ -975,11 +1099,11 @@ if((sqlite_error = sqlite3_exec(m_pDB,pszBeginTransaction,NULL,NULL,NULL))!=SQLI
 	}
 
 
-// load CSV file and start populating the SQLite database
-CCSVFile *pCSV = new CCSVFile;
+// load CSV file and start populating the SQLite database, CSV lines are parsed on their own thread
+CSQLiteBulkCSV *pCSV = new CSQLiteBulkCSV;
 if(pCSV == NULL)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to instantiate CCSVfile");
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to instantiate CSQLiteBulkCSV");
 	CloseDatabase(true);
 	return(eBSFerrObj);
 	}
@@ -1240,8 +1364,20 @@ while((Rslt=pCSV->NextLine()) > 0)			// onto next line containing fields
 			break;
 		}
 	}
+delete pCSV;
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Parsed %d lines, Unique target sequences: %d, SNP Loci: %d, SNPs: %d, Markers: %d",NumElsRead, m_NumSeqs,m_NumSNPLoci, m_NumSNPs, m_NumMarkers);
 
+if(!bSafe)		// insert any rows remaining buffered
+	{
+	for(int BulkIdx = 2; BulkIdx < 7; BulkIdx++)
+		if(m_BulkInserts[BulkIdx].Flush() < eBSFSuccess)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bulk insert into %s: %s", m_StmSQL[BulkIdx].pTblName,sqlite3_errmsg(m_pDB)); 
+			CloseDatabase(true);
+			return(eBSFerrInternal);
+			}
+	}
+
 	// end transaction
 if((sqlite_error = sqlite3_exec(m_pDB,pszEndTransaction,NULL,NULL,NULL))!=SQLITE_OK)
 	{
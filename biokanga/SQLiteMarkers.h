@@ -47,6 +47,8 @@ class CSQLiteMarkers
 	static tsStmSQL m_StmSQL[7];		// SQLite table and index statements
 	tsCultivar Cultivars[cMaxExprCultivars];	// can process upto this many cultivars in CSV marker file
 	tsMRASeq m_MRASeqs[cMaxMRASeqs];	// MRA sequences
+	CSQLiteBulkInsert m_BulkInserts[7];	// if not safe then rows are inserted in bulk, indexed as m_StmSQL
+	CSQLiteBulkNames m_SeqNames;		// if not safe then identifiers for all sequences are retained in memory
 
 	bool m_bSafe;						// true if safe select required rather than simply getting last assigned ROWID
 	int m_NumSeqs;						// number of seqs added to TblSeqs
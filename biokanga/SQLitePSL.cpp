@@ -19,6 +19,7 @@
 #include "../libbiokanga/commhdrs.h"
 #endif
 
+#include "SQLiteBulk.h"
 #include "SQLitePSL.h"
 
 // Following database schema is utilised
@@ -122,6 +123,7 @@ tsStmSQL CSQLitePSL::m_StmSQL[4] = {   // 4 tables; TblExprs, TblAlignments, Tbl
 CSQLitePSL::CSQLitePSL(void)
 {
 m_pDB = NULL;
+m_NumCachedExprIDs = 0;
 m_pInBuffer = NULL;		
 m_pszPSLLineBuff = NULL;
 m_hPSLinFile = -1;
@@ -221,6 +223,14 @@ if((sqlite_error = sqlite3_open_v2(pszDatabase, &m_pDB,SQLITE_OPEN_READWRITE | S
 	return(NULL);
 	}
 
+// page size must be set before any tables are created
+if(CSQLiteBulkInsert::TunePragmas(m_pDB) < eBSFSuccess)
+	{
+	sqlite3_close_v2(m_pDB);
+	sqlite3_shutdown();
+	m_pDB = NULL;
+	return(NULL);
+	}
 
 // if required then create all tables
 if(StatRslt < 0)
@@ -244,10 +254,11 @@ if(StatRslt < 0)
 	}
 
 
+// indexes which will be generated by EndPopulatingTables() are deferred until the tables have been populated
 pStms = m_StmSQL;
 for(TblIdx = 0; TblIdx < 4; TblIdx++,pStms++)
 	{
-	if(pStms->pszOpenCreateIndexes == NULL)
+	if(pStms->pszOpenCreateIndexes == NULL || pStms->pszCreateIndexes != NULL)
 		continue;
 	if((sqlite_error = sqlite3_exec(m_pDB,pStms->pszOpenCreateIndexes,0,0,0))!=SQLITE_OK)
 		{
@@ -288,6 +299,16 @@ for(TblIdx = 0; TblIdx < 4; TblIdx++,pStms++)
 		}
 	}
 
+// alignments, blocks and summaries are inserted in bulk, alignment identifiers being assigned when buffered
+if(m_BulkInserts[1].Init(m_pDB,m_StmSQL[1].pTblName,(char *)"AlignmentID",(char *)"ExprID,Score,Identity,Matches,Mismatches,RepMatches,NCount,QNumInDels,QBasesInDels,TNumInDels,TBasesInDels,Strand,QName,QSize,QStart,QEnd,TName,TSize,TStart,TEnd,NumBlocks") < eBSFSuccess ||
+	m_BulkInserts[2].Init(m_pDB,m_StmSQL[2].pTblName,NULL,(char *)"ExprID,AlignmentID,BlockSize,QStart,TStart") < eBSFSuccess ||
+	m_BulkInserts[3].Init(m_pDB,m_StmSQL[3].pTblName,NULL,(char *)"ExprID,IsQuery,SeqName,SeqLen,NumAlignments") < eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - can't initialise bulk inserts: %s", sqlite3_errmsg(m_pDB));
+	CloseDatabase(false);
+	return(NULL);
+	}
+
 // initialisation for alignment sequences summaries
 if(m_pAlignmentSummaries != NULL)
 	{
@@ -341,6 +362,9 @@ int TblIdx;
 int Rslt = 0;
 tsStmSQL *pStms;
 pStms = m_StmSQL;
+for(TblIdx = 0; TblIdx < 4; TblIdx++)
+	m_BulkInserts[TblIdx].Reset();
+m_NumCachedExprIDs = 0;
 if(m_pDB != NULL)
 	{
 	if(!bNoIndexes)
@@ -609,61 +633,64 @@ int
 CSQLitePSL::AddSummaryInstances2SQLite(void)
 {
 UINT32 Idx;
-int sqlite_error;
-tsStmSQL *pStm;
+int Rslt;
+CSQLiteBulkInsert *pBulk;
 tsAlignSummary *pCurSummary;
 
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 
 pCurSummary = m_pAlignmentSummaries;
-
+pBulk = &m_BulkInserts[3];
 for(Idx = 0; Idx < m_NumAlignSummaries; Idx++)
 	{
-	// add this alignment block instances
-	pStm = &m_StmSQL[3];
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, pCurSummary->ExprID))!=SQLITE_OK)
+	// add this alignment summary instance
+	pBulk->BeginRow();
+	pBulk->AddInt(pCurSummary->ExprID);
+	pBulk->AddInt(pCurSummary->FlgIsQuery ? 1 : 0);
+	pBulk->AddText((char *)pCurSummary->SeqName);
+	pBulk->AddInt(pCurSummary->SeqLen);
+	pBulk->AddInt(pCurSummary->NumAlignments);
+	if((Rslt = pBulk->EndRow()) < eBSFSuccess)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
 		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 2,  pCurSummary->FlgIsQuery ? 1 : 0))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
+		return(Rslt);
 		}
-	if((sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 3, (char *)pCurSummary->SeqName,(int)strlen((char *)pCurSummary->SeqName)+1,SQLITE_STATIC))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 4, pCurSummary->SeqLen))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 5, pCurSummary->NumAlignments))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_step(pStm->pPrepInsert))!=SQLITE_DONE)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement: %s", sqlite3_errmsg(m_pDB));   
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	sqlite3_reset(pStm->pPrepInsert);
 	pCurSummary = (tsAlignSummary *)((UINT8 *)pCurSummary + pCurSummary->AlignSummarySize);
 	}
+if((Rslt = pBulk->Flush()) < eBSFSuccess)
+	{
+	CloseDatabase(true);
+	return(Rslt);
+	}
 return(m_NumAlignSummaries);
 }
 
+// experiment identifiers are validated against TblExprs once, thereafter the validated identifier is cached
+bool
+CSQLitePSL::IsKnownExprID(int ExprID)
+{
+int Idx;
+int ChkExprID;
+char szExprTarg[200];
+
+for(Idx = 0; Idx < m_NumCachedExprIDs; Idx++)
+	if(m_CachedExprIDs[Idx] == ExprID)
+		return(true);
+
+ChkExprID = -1;
+sprintf(szExprTarg,"select ExprID from TblExprs where ExprID = %d",ExprID);
+sqlite3_exec(m_pDB,szExprTarg,ExecCallbackID,&ChkExprID,NULL);
+if(ChkExprID == -1)	// will be -1 if not already in database
+	return(false);
+
+if(m_NumCachedExprIDs < cMaxCacheExprIDs)
+	m_CachedExprIDs[m_NumCachedExprIDs++] = ExprID;
+else
+	m_CachedExprIDs[ExprID % cMaxCacheExprIDs] = ExprID;
+return(true);
+}
+
 int										// returned sequence identifier for sequence
 CSQLitePSL::AddAlignment(int ExprID,		// alignment was in this experiment
 					int Score,				// Alignment score (using Blat pslScore() function)
@@ -690,23 +717,15 @@ CSQLitePSL::AddAlignment(int ExprID,		// alignment was in this experiment
 					int  *pQStarts,			// starting psn of each block in query
 					int  *pTStarts)			// starting psn of each block in target
 {
-int sqlite_error;
-tsStmSQL *pStm;
+int Rslt;
 int AlignmentID;
 int Idx;
-int ChkExprID;
-char szSeqTarg[200];
+CSQLiteBulkInsert *pBulk;
 
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 
-ChkExprID = -1;
-
-	// not a recently accessed experiment so need to check if already known to SQLite
-sprintf(szSeqTarg,"select ExprID from TblExprs where ExprID = %d",ExprID);
-sqlite3_exec(m_pDB,szSeqTarg,ExecCallbackID,&ChkExprID,NULL);
-
-if(ChkExprID == -1)	// will be -1 if not already in database, treat as error
+if(!IsKnownExprID(ExprID))	// unknown experiment, treat as error
 	{
 	CloseDatabase(true);
 	return(eBSFerrInternal);
@@ -715,194 +734,56 @@ if(ChkExprID == -1)	// will be -1 if not already in database, treat as error
 // validated that the experiment instance identifier is already known to SQLite so can add this alignment instance
 AddAlignSummary(ExprID,pszQName,QSize,pszTName,TSize);
 
-pStm = &m_StmSQL[1];
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 2, Score))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 3, Identity))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 4, Matches))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 5, Mismatches))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 6, RepMatches))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 7, NCount))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 8, QNumInDels))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 9, QBasesInDels))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 10, TNumInDels))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 11, TBasesInDels))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 12, pszStrand,(int)strlen(pszStrand)+1,SQLITE_STATIC))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 13, pszQName,(int)strlen(pszQName)+1,SQLITE_STATIC))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 14, QSize))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 15, QStart))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 16, QEnd))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 17, pszTName,(int)strlen(pszTName)+1,SQLITE_STATIC))!=SQLITE_OK)
+// alignment identifiers are assigned as the alignments are buffered so the blocks can reference their alignment before it has been inserted
+pBulk = &m_BulkInserts[1];
+AlignmentID = (int)pBulk->BeginRow();
+pBulk->AddInt(ExprID);
+pBulk->AddInt(Score);
+pBulk->AddInt(Identity);
+pBulk->AddInt(Matches);
+pBulk->AddInt(Mismatches);
+pBulk->AddInt(RepMatches);
+pBulk->AddInt(NCount);
+pBulk->AddInt(QNumInDels);
+pBulk->AddInt(QBasesInDels);
+pBulk->AddInt(TNumInDels);
+pBulk->AddInt(TBasesInDels);
+pBulk->AddText(pszStrand);
+pBulk->AddText(pszQName);
+pBulk->AddInt(QSize);
+pBulk->AddInt(QStart);
+pBulk->AddInt(QEnd);
+pBulk->AddText(pszTName);
+pBulk->AddInt(TSize);
+pBulk->AddInt(TStart);
+pBulk->AddInt(TEnd);
+pBulk->AddInt(NumBlocks);
+if((Rslt = pBulk->EndRow()) < eBSFSuccess)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
 	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 18, TSize))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 19, TStart))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 20, TEnd))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 21, NumBlocks))!=SQLITE_OK)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-	CloseDatabase(true);
-	return(eBSFerrInternal);
-	}
-if((sqlite_error = sqlite3_step(pStm->pPrepInsert))!=SQLITE_DONE)
-	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement: %s", sqlite3_errmsg(m_pDB));   
-	CloseDatabase(true);
-	return(eBSFerrInternal);
+	return(Rslt);
 	}
-sqlite3_reset(pStm->pPrepInsert);
-
-	// find out the AlignmentID assigned to this alignment instance
-AlignmentID = (int)sqlite3_last_insert_rowid(m_pDB);
-
 
+pBulk = &m_BulkInserts[2];
 for(Idx = 0; Idx < NumBlocks; Idx++, pBlockSizes++,pQStarts++,pTStarts++)
 	{
 	// add this alignment block instances
-	pStm = &m_StmSQL[2];
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, ExprID))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 2, AlignmentID))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 3, *pBlockSizes))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 4, *pQStarts))!=SQLITE_OK)
+	pBulk->BeginRow();
+	pBulk->AddInt(ExprID);
+	pBulk->AddInt(AlignmentID);
+	pBulk->AddInt(*pBlockSizes);
+	pBulk->AddInt(*pQStarts);
+	pBulk->AddInt(*pTStarts);
+	if((Rslt = pBulk->EndRow()) < eBSFSuccess)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
 		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 5, *pTStarts))!=SQLITE_OK)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
-		CloseDatabase(true);
-		return(eBSFerrInternal);
-		}
-	if((sqlite_error = sqlite3_step(pStm->pPrepInsert))!=SQLITE_DONE)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement: %s", sqlite3_errmsg(m_pDB));   
-		CloseDatabase(true);
-		return(eBSFerrInternal);
+		return(Rslt);
 		}
-	sqlite3_reset(pStm->pPrepInsert);
 	}
 
 return(AlignmentID);
 }
 
-
 int
 CSQLitePSL::BeginPopulatingTables(void)
 {
@@ -939,6 +820,15 @@ CSQLitePSL::EndPopulatingTables(void)
 int sqlite_error;
 char *pszEndTransaction = (char *)"END TRANSACTION";
 char *pszPragmaSyncOn = (char *)"PRAGMA synchronous = ON";
+int Rslt;
+
+// insert any alignments and blocks remaining buffered
+if((Rslt = m_BulkInserts[1].Flush()) < eBSFSuccess ||
+	(Rslt = m_BulkInserts[2].Flush()) < eBSFSuccess)
+	{
+	CloseDatabase(true);
+	return(Rslt);
+	}
 AddSummaryInstances2SQLite();
 
 	// end transaction
@@ -1042,41 +932,19 @@ return(eBSFSuccess);
 
 
 //
-// ProcessPSLline
+// ParsePSLline
 // 
 int
-CSQLitePSL::ProcessPSLline(int ExprID)		// parse alignment PSL line which is in this experiment
+CSQLitePSL::ParsePSLline(tsPSLParsedAlign *pAlign)		// parse alignment PSL line into pAlign, returns 1 if alignment accepted, 0 if not accepted or a header line, < 0 if errors
 {
-int AlignmentID;
 int Cnt;
 int Psn;
 int BlockIdx;
 char *pChr;
-
-int Score;
-int Identity;
-
-int Matches;			// number of matches which aren't repeats
-int Mismatches;			// number of bases which do not match
-int RepMatches;			// number of bases which match but are also repeats
-int NCount;				// number of N bases
-int QNumInDels;			// number of InDel seqs in query
-int QBasesInDels;		// number of bases total in all InDels in query
-int TNumInDels;			// number of InDel seqs in target
-int TBasesInDels;		// number of bases total in all InDels in target
-char szStrand[10];		// '+' or '-' for query strand, optionally followed by '+' or '-' for target genomic strand when using translated alignments
-char szQName[cMaxSeqNameLen+1];			// query sequence name
-int  QSize;				// query sequence size
-int  QStart;			// alignment start psn in query
-int  QEnd;				// alignment end psn in query
-char szTName[cMaxSeqNameLen+1];			// target sequence name
-int  TSize;				// target sequence size
-int  TStart;			// alignment start psn in target
-int  TEnd;				// alignment end psn in target
-int  NumBlocks;			// number of blocks in the alignment
-int  BlockSizes[cMaxNumPSLblocks];		// array of sizes of each block
-int  QStarts[cMaxNumPSLblocks];			// starting psn of each block in query
-int  TStarts[cMaxNumPSLblocks];			// starting psn of each block in target
+double pslIdent;
+int  *pBlockSizes;		// array of sizes of each block
+int  *pQStarts;			// starting psn of each block in query
+int  *pTStarts;			// starting psn of each block in target
 
 m_pszPSLLineBuff[m_CurLineLen] = '\0';	
 pChr = (char *)m_pszPSLLineBuff;
@@ -1086,87 +954,87 @@ if(!isdigit(*pChr))	// assume header line if not a digit
 	return(0);
 
 Cnt = sscanf(pChr,"%d %d %d %d %d %d %d %d %n",
-				&Matches,&Mismatches,&RepMatches,&NCount,&QNumInDels,
-				&QBasesInDels,&TNumInDels,&TBasesInDels,&Psn);
+				&pAlign->Matches,&pAlign->Mismatches,&pAlign->RepMatches,&pAlign->NCount,&pAlign->QNumInDels,
+				&pAlign->QBasesInDels,&pAlign->TNumInDels,&pAlign->TBasesInDels,&Psn);
 if(Cnt != 8)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessPSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ParsePSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
 	return(eBSFerrParse);
 	}
 
 pChr += Psn;
 Cnt = sscanf(pChr,"%s %s %d %d %d %s %d %d %d %d %n",
-				szStrand,szQName,&QSize,&QStart,&QEnd,
-				szTName,&TSize,&TStart,&TEnd,&NumBlocks,&Psn);
-if(Cnt != 10)
+				pAlign->szStrand,pAlign->szQName,&pAlign->QSize,&pAlign->QStart,&pAlign->QEnd,
+				pAlign->szTName,&pAlign->TSize,&pAlign->TStart,&pAlign->TEnd,&pAlign->NumBlocks,&Psn);
+if(Cnt != 10 || pAlign->NumBlocks < 0 || pAlign->NumBlocks > cMaxNumPSLblocks)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessPSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ParsePSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
 	return(eBSFerrParse);
 	}
 
+pBlockSizes = &pAlign->Blocks[0];
+pQStarts = &pAlign->Blocks[pAlign->NumBlocks];
+pTStarts = &pAlign->Blocks[pAlign->NumBlocks * 2];
+
 pChr += Psn;
-for(BlockIdx = 0; BlockIdx < NumBlocks; BlockIdx++)
+for(BlockIdx = 0; BlockIdx < pAlign->NumBlocks; BlockIdx++)
 	{
-	if(BlockIdx != (NumBlocks - 1))
-		Cnt = sscanf(pChr," %d , %n",&BlockSizes[BlockIdx],&Psn);
+	if(BlockIdx != (pAlign->NumBlocks - 1))
+		Cnt = sscanf(pChr," %d , %n",&pBlockSizes[BlockIdx],&Psn);
 	else
 		{
-		Cnt = sscanf(pChr," %d %n",&BlockSizes[BlockIdx],&Psn);
+		Cnt = sscanf(pChr," %d %n",&pBlockSizes[BlockIdx],&Psn);
 		if(Cnt == 1 && pChr[Psn] == ',')
 			Psn += 1;
 		}
 
 	if(Cnt != 1)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessPSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ParsePSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
 		return(eBSFerrParse);
 		}
 	pChr += Psn;
 	}
-for(BlockIdx = 0; BlockIdx < NumBlocks; BlockIdx++)	
+for(BlockIdx = 0; BlockIdx < pAlign->NumBlocks; BlockIdx++)	
 	{
-	if(BlockIdx != (NumBlocks - 1))
-		Cnt = sscanf(pChr," %d , %n",&QStarts[BlockIdx],&Psn);
+	if(BlockIdx != (pAlign->NumBlocks - 1))
+		Cnt = sscanf(pChr," %d , %n",&pQStarts[BlockIdx],&Psn);
 	else
 		{
-		Cnt = sscanf(pChr," %d %n",&QStarts[BlockIdx],&Psn);
+		Cnt = sscanf(pChr," %d %n",&pQStarts[BlockIdx],&Psn);
 		if(Cnt == 1 && pChr[Psn] == ',')
 			Psn += 1;
 		}
 	if(Cnt != 1)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessPSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ParsePSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
 		return(eBSFerrParse);
 		}
 	pChr += Psn;
 	}
-for(BlockIdx = 0; BlockIdx < NumBlocks; BlockIdx++)
+for(BlockIdx = 0; BlockIdx < pAlign->NumBlocks; BlockIdx++)
 	{
-	if(BlockIdx != (NumBlocks - 1))
-		Cnt = sscanf(pChr," %d , %n",&TStarts[BlockIdx],&Psn);
+	if(BlockIdx != (pAlign->NumBlocks - 1))
+		Cnt = sscanf(pChr," %d , %n",&pTStarts[BlockIdx],&Psn);
 	else
-		Cnt = sscanf(pChr," %d",&TStarts[BlockIdx]);
+		Cnt = sscanf(pChr," %d",&pTStarts[BlockIdx]);
 	if(Cnt != 1)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessPSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ParsePSLline: Unable to parse line '%s' from input PSL file - %s", m_pszPSLLineBuff,m_szPSLinFile);
 		return(eBSFerrParse);
 		}
 	pChr += Psn;
 	}
 
-Score = pslScore(Matches,Mismatches,RepMatches,QNumInDels,TNumInDels,szStrand,TSize,TStart,TEnd,NumBlocks,BlockSizes,QStarts,TStarts);			
-double pslIdent = (double)pslCalcMilliBad(Matches,Mismatches,RepMatches,QNumInDels,TNumInDels,QSize,QStart,QEnd,szStrand,TSize,TStart,TEnd,NumBlocks,BlockSizes,QStarts,TStarts,true); 
-Identity = (int)(100.0 - pslIdent * 0.1);
+pAlign->Score = pslScore(pAlign->Matches,pAlign->Mismatches,pAlign->RepMatches,pAlign->QNumInDels,pAlign->TNumInDels,pAlign->szStrand,pAlign->TSize,pAlign->TStart,pAlign->TEnd,pAlign->NumBlocks,pBlockSizes,pQStarts,pTStarts);			
+pslIdent = (double)pslCalcMilliBad(pAlign->Matches,pAlign->Mismatches,pAlign->RepMatches,pAlign->QNumInDels,pAlign->TNumInDels,pAlign->QSize,pAlign->QStart,pAlign->QEnd,pAlign->szStrand,pAlign->TSize,pAlign->TStart,pAlign->TEnd,pAlign->NumBlocks,pBlockSizes,pQStarts,pTStarts,true); 
+pAlign->Identity = (int)(100.0 - pslIdent * 0.1);
 m_NumBlatHitsParsed += 1;
-if(Score < m_MinScore ||
-   Identity < m_MinIdentity ||
-   Matches < m_MinMatches)
+if(pAlign->Score < m_MinScore ||
+   pAlign->Identity < m_MinIdentity ||
+   pAlign->Matches < m_MinMatches)
 	return(0);	
-
-AlignmentID = AddAlignment(ExprID,Score,Identity,Matches,Mismatches,RepMatches,NCount,QNumInDels,QBasesInDels,TNumInDels,TBasesInDels,szStrand,szQName,QSize,QStart,QEnd,szTName,TSize,TStart,TEnd,NumBlocks,BlockSizes, QStarts,TStarts);
-if(AlignmentID > 0)
-	m_NumBlatHitsAccepted += 1;
-return(AlignmentID);
+return(1);
 }
 
 int		// 0: EOF -1: error >0 chr
@@ -1248,7 +1116,48 @@ m_NumInBuffer = 0;
 m_InBuffIdx = 0;
 m_NumBlatHitsParsed = 0;
 m_NumBlatHitsAccepted = 0;
-Rslt = ProcessPSL(ExprID);
+
+// PSL lines are parsed and filtered on their own thread with accepted alignments queued for inserting
+if((Rslt = m_ParsedAligns.Init()) < eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessPSLFile: Unable to allocate buffering for parsed alignments");
+	close(m_hPSLinFile);
+	m_hPSLinFile = -1;
+	}
+else
+	{
+	int ParseRslt;
+	tsPSLParsedAlign *pAlign;
+#ifdef _WIN32
+	m_threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ParseThreadStart,this,0,&m_threadID);
+#else
+	m_threadRslt = pthread_create(&m_threadID,NULL,ParseThreadStart,this);
+#endif
+	while((pAlign = (tsPSLParsedAlign *)m_ParsedAligns.NextRec()) != NULL)
+		{
+		Rslt = AddAlignment(ExprID,pAlign->Score,pAlign->Identity,pAlign->Matches,pAlign->Mismatches,pAlign->RepMatches,pAlign->NCount,
+							pAlign->QNumInDels,pAlign->QBasesInDels,pAlign->TNumInDels,pAlign->TBasesInDels,pAlign->szStrand,
+							pAlign->szQName,pAlign->QSize,pAlign->QStart,pAlign->QEnd,pAlign->szTName,pAlign->TSize,pAlign->TStart,pAlign->TEnd,
+							pAlign->NumBlocks,&pAlign->Blocks[0],&pAlign->Blocks[pAlign->NumBlocks],&pAlign->Blocks[pAlign->NumBlocks * 2]);
+		if(Rslt < eBSFSuccess)
+			{
+			m_ParsedAligns.Terminate();
+			break;
+			}
+		if(Rslt > 0)
+			m_NumBlatHitsAccepted += 1;
+		}
+#ifdef _WIN32
+	WaitForSingleObject(m_threadHandle,INFINITE);
+	CloseHandle(m_threadHandle);
+#else
+	pthread_join(m_threadID,NULL);
+#endif
+	ParseRslt = m_ParsedAligns.GetRslt();
+	if(Rslt >= eBSFSuccess && ParseRslt < eBSFSuccess)
+		Rslt = ParseRslt;
+	m_ParsedAligns.Reset();
+	}
 
 if(Rslt >= 0)
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"ProcessPSLFile: Parsed %d alignments and accepted %d from '%s'",m_NumBlatHitsParsed,m_NumBlatHitsAccepted, m_szPSLinFile); 
@@ -1275,11 +1184,28 @@ return(Rslt);
 }
 
 
+#ifdef _WIN32
+unsigned int __stdcall CSQLitePSL::ParseThreadStart(void *args)
+{
+#else
+void * CSQLitePSL::ParseThreadStart(void *args)
+{
+#endif
+CSQLitePSL *pThis = (CSQLitePSL *)args;
+pThis->m_ParsedAligns.Finish(pThis->ProcessPSL());
+#ifdef _WIN32
+ExitThread(1);
+#else
+return NULL;
+#endif
+}
+
 int
-CSQLitePSL::ProcessPSL(int ExprID)
+CSQLitePSL::ProcessPSL(void)	// parse PSL lines, queuing accepted alignments
 {
 int Rslt;
 bool bInWhiteSpace = false;		
+tsPSLParsedAlign *pAlign;
 
 m_CurLineLen = 0;
 Rslt = 0;
@@ -1291,7 +1217,12 @@ while(Rslt >= 0 && (Rslt = GetNxtPSLChr()) > 0) {
 		case '\n':				// accept linefeeds - both Linux and windows are happy with lines terminated by NL
 			bInWhiteSpace = false;
 			if(m_CurLineLen)
-				Rslt = ProcessPSLline(ExprID);
+				{
+				if((pAlign = (tsPSLParsedAlign *)m_ParsedAligns.Reserve(cMaxPSLParsedAlignSize)) == NULL)	// NULL if inserting has been terminated
+					return(eBSFSuccess);
+				if((Rslt = ParsePSLline(pAlign)) > 0)
+					m_ParsedAligns.Commit(sizeof(tsPSLParsedAlign) + (sizeof(INT32) * ((3 * pAlign->NumBlocks) - 1)));
+				}
 			m_CurLineLen = 0;
 			continue;
 		
@@ -1314,7 +1245,12 @@ while(Rslt >= 0 && (Rslt = GetNxtPSLChr()) > 0) {
 			}
 	}
 if(!Rslt && m_CurLineLen)
-	Rslt = ProcessPSLline(ExprID);
+	{
+	if((pAlign = (tsPSLParsedAlign *)m_ParsedAligns.Reserve(cMaxPSLParsedAlignSize)) == NULL)
+		return(eBSFSuccess);
+	if((Rslt = ParsePSLline(pAlign)) > 0)
+		m_ParsedAligns.Commit(sizeof(tsPSLParsedAlign) + (sizeof(INT32) * ((3 * pAlign->NumBlocks) - 1)));
+	}
 return(Rslt);
 }
 
@@ -44,8 +44,34 @@ typedef struct TAG_sAlignSummary {
 		UINT8 SeqName[1];			// lower cased query or target sequence name, extended out to actual length+1 of sequence name
 	} tsAlignSummary;
 
+typedef struct TAG_sPSLParsedAlign {
+	INT32 Score;				// Alignment score (using Blat pslScore() function)
+	INT32 Identity;				// Alignment identity (using Blat 100.0 - pslCalcMilliBad(psl, TRUE) * 0.1)
+	INT32 Matches;				// number of matches which aren't repeats
+	INT32 Mismatches;			// number of bases which do not match
+	INT32 RepMatches;			// number of bases which match but are also repeats
+	INT32 NCount;				// number of N bases
+	INT32 QNumInDels;			// number of InDel seqs in query
+	INT32 QBasesInDels;			// number of bases total in all InDels in query
+	INT32 TNumInDels;			// number of InDel seqs in target
+	INT32 TBasesInDels;			// number of bases total in all InDels in target
+	char szStrand[10];			// '+' or '-' for query strand, optionally followed by '+' or '-' for target genomic strand when using translated alignments
+	char szQName[cMaxSeqNameLen+1];	// query sequence name
+	INT32 QSize;				// query sequence size
+	INT32 QStart;				// alignment start psn in query
+	INT32 QEnd;					// alignment end psn in query
+	char szTName[cMaxSeqNameLen+1];	// target sequence name
+	INT32 TSize;				// target sequence size
+	INT32 TStart;				// alignment start psn in target
+	INT32 TEnd;					// alignment end psn in target
+	INT32 NumBlocks;			// number of blocks in the alignment
+	INT32 Blocks[1];			// NumBlocks block sizes, followed by NumBlocks query starts, followed by NumBlocks target starts
+	} tsPSLParsedAlign;
+
 #pragma pack()
 
+const size_t cMaxPSLParsedAlignSize = sizeof(tsPSLParsedAlign) + (sizeof(INT32) * 3 * cMaxNumPSLblocks);	// max size of any parsed alignment
+
 class CSQLitePSL
 {
 	char m_szPSLinFile[_MAX_PATH];  // processing this input PSL file
@@ -78,18 +104,39 @@ class CSQLitePSL
 
 	sqlite3 *m_pDB;						// pts to instance of SQLite
 	static tsStmSQL m_StmSQL[4];		// SQLite table and index statements
+	CSQLiteBulkInsert m_BulkInserts[4];	// alignments, blocks and summaries are bulk inserted, indexed as m_StmSQL
+
+	int m_NumCachedExprIDs;				// number of experiment identifiers in m_CachedExprIDs
+	int m_CachedExprIDs[cMaxCacheExprIDs];	// experiment identifiers already validated as known to SQLite
+
+	CSQLiteBulkQueue m_ParsedAligns;	// accepted alignments are parsed on their own thread and queued for inserting
+#ifdef _WIN32
+	HANDLE m_threadHandle;				// handle as returned by _beginthreadex()
+	unsigned int m_threadID;			// identifier as set by _beginthreadex()
+#else
+	int m_threadRslt;					// result as returned by pthread_create ()
+	pthread_t m_threadID;				// identifier as set by pthread_create ()
+#endif
 
 	int m_NumAlignments;				// number of alignments added to TblBlatAlignments
 	int m_NumBlocks;					// number of alignment blocks added to TblBlatAlignmentBlocks
 
 	int		GetNxtPSLChr(void);			// returns buffered PSL file char,  0: EOF, -1: error, >0 chr 
 
-	int ProcessPSLline(int ExprID);		// parse alignment PSL line which is in this experiment
+	int ParsePSLline(tsPSLParsedAlign *pAlign);	// parse alignment PSL line, returns 1 if alignment accepted, 0 if not accepted or a header line, < 0 if errors
+
+	bool IsKnownExprID(int ExprID);		// returns true if experiment identifier is known to SQLite
 
 	int ProcessPSLFile(char *pszInPSL,		// parse and load the alignments in this Blat generated PSL file into SQLite
 						    int ExprID);	// the alignments are in this experiment
 
-	int ProcessPSL(int ExprID);
+	int ProcessPSL(void);				// parse PSL lines, queuing accepted alignments
+
+#ifdef _WIN32
+	static unsigned int __stdcall ParseThreadStart(void *args);	// PSL parsing thread startup
+#else
+	static void *ParseThreadStart(void *args);	// PSL parsing thread startup
+#endif
 
 	INT32			// 20bit instance hash over the combination of parameterisation values passed into this function; if < 0 then hashing error 
 		GenSummaryInstanceHash(INT32 ExprID,// alignment summary is for alignment in this experiment
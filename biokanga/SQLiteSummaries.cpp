@@ -12,10 +12,13 @@
 
 #if _WIN32
 #include <process.h>
+#include <psapi.h>
 #include "../libbiokanga/commhdrs.h"
 #else
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <pthread.h>
+#include <sched.h>
 #include "../libbiokanga/commhdrs.h"
 #endif
 
@@ -76,7 +79,26 @@
 //		ResultYName VARCHAR(50),			-- result Y name
 //      ResultYValue VARCHAR(500),			-- result Y value
 
-tsSummStmSQL CSQLiteSummaries::m_StmSQL[7] = {
+// TblPhases
+//		PhaseID INTEGER PRIMARY KEY ASC,	-- Uniquely identifies this phase instance
+//		ProcessingID INTEGER,				-- identifies this processing instance
+//		PhaseName VARCHAR(50),				-- phase name
+//		Start VARCHAR(24),					-- phase started
+//		Finish VARCHAR(24),					-- phase completed
+//		ElapsedSecs REAL,					-- elapsed wall clock seconds
+//		PeakRSSKB INTEGER					-- process peak resident set size (KB) at phase completion
+
+// TblPhaseCounters
+//		PhaseCounterID INTEGER PRIMARY KEY ASC,	-- Uniquely identifies this phase counter instance
+//		PhaseID INTEGER,					-- counter is for this phase
+//		ProcessingID INTEGER,				-- identifies this processing instance
+//		CounterName VARCHAR(50),			-- counter name
+//		Total INTEGER,						-- sum of sample values
+//		NumSamples INTEGER,					-- number of samples
+//		MinSample INTEGER,					-- minimum sample value
+//		MaxSample INTEGER					-- maximum sample value
+
+tsSummStmSQL CSQLiteSummaries::m_StmSQL[cNumSummTbls] = {
 	{(char *)"TblExprs",
 		(char *)"CREATE TABLE IF NOT EXISTS TblExprs (ExprID INTEGER PRIMARY KEY ASC,ExprName VARCHAR(50) UNIQUE, ExprTitle VARCHAR(50) UNIQUE,ExprDescr VARCHAR(1000) DEFAULT '')",
 		(char *)"INSERT INTO TblExprs (ExprName,ExprTitle,ExprName,ExprDescr) VALUES(?,?,?,?)",
@@ -128,12 +150,27 @@ tsSummStmSQL CSQLiteSummaries::m_StmSQL[7] = {
 		(char *)"DROP INDEX IF EXISTS 'TblXYResults_ProcessingID'",
 		(char *)"CREATE INDEX IF NOT EXISTS 'TblXYResults_ProcessingID' ON 'TblXYResults' ('ProcessingID' ASC)",
 		NULL },
+	{ (char *)"TblPhases",
+		(char *)"CREATE TABLE IF NOT EXISTS TblPhases (PhaseID INTEGER PRIMARY KEY ASC,ProcessingID INTEGER,PhaseName VARCHAR(50),Start VARCHAR(24),Finish VARCHAR(24),ElapsedSecs REAL,PeakRSSKB INTEGER)",
+		(char *)"INSERT INTO TblPhases (ProcessingID,PhaseName,Start,Finish,ElapsedSecs,PeakRSSKB) VALUES(?,?,?,?,?,?)",
+		NULL,
+		(char *)"DROP INDEX IF EXISTS 'TblPhases_ProcessingID'",
+		(char *)"CREATE INDEX IF NOT EXISTS 'TblPhases_ProcessingID' ON 'TblPhases' ('ProcessingID' ASC)",
+		NULL },
+	{ (char *)"TblPhaseCounters",
+		(char *)"CREATE TABLE IF NOT EXISTS TblPhaseCounters (PhaseCounterID INTEGER PRIMARY KEY ASC,PhaseID INTEGER,ProcessingID INTEGER,CounterName VARCHAR(50),Total INTEGER,NumSamples INTEGER,MinSample INTEGER,MaxSample INTEGER)",
+		(char *)"INSERT INTO TblPhaseCounters (PhaseID,ProcessingID,CounterName,Total,NumSamples,MinSample,MaxSample) VALUES(?,?,?,?,?,?,?)",
+		NULL,
+		(char *)"DROP INDEX IF EXISTS 'TblPhaseCounters_PhaseID'",
+		(char *)"CREATE INDEX IF NOT EXISTS 'TblPhaseCounters_PhaseID' ON 'TblPhaseCounters' ('PhaseID' ASC)",
+		NULL },
 };
 
 
 CSQLiteSummaries::CSQLiteSummaries(void)
 {
 m_pDB = NULL;
+memset(m_Phases,0,sizeof(m_Phases));
 m_bInitialised = (Init() == eBSFSuccess) ? true : false;
 }
 
@@ -148,7 +185,10 @@ if(m_pDB != NULL)
 sqlite3_shutdown();
 #ifndef _WIN32
 if(m_bInitialised)
+	{
 	pthread_spin_destroy(&m_hSpinLock);
+	pthread_spin_destroy(&m_hPhaseSpinLock);
+	}
 #endif
 }
 
@@ -164,6 +204,17 @@ if(pthread_spin_init(&m_hSpinLock,PTHREAD_PROCESS_PRIVATE)!=0)
 #endif
 	return(eBSFerrInternal);
 	}
+#ifdef _WIN32
+if(!InitializeCriticalSectionAndSpinCount(&m_hPhaseCritSect,1000))
+	{
+	DeleteCriticalSection(&m_hSCritSect);
+#else
+if(pthread_spin_init(&m_hPhaseSpinLock,PTHREAD_PROCESS_PRIVATE)!=0)
+	{
+	pthread_spin_destroy(&m_hSpinLock);
+#endif
+	return(eBSFerrInternal);
+	}
 sqlite3_initialize();
 return(eBSFSuccess);
 }
@@ -186,7 +237,7 @@ while(pthread_spin_trylock(&m_hSpinLock)==EBUSY)
 	{
 	if(SpinCnt -= 1)
 		continue;
-	pthread_yield();
+	sched_yield();
 	SpinCnt = 500;
 	}
 #endif
@@ -202,6 +253,39 @@ pthread_spin_unlock(&m_hSpinLock);
 #endif
 }
 
+inline void
+CSQLiteSummaries::PhaseSerialise(void)
+{
+int SpinCnt = 5000;
+#ifdef _WIN32
+while(!TryEnterCriticalSection(&m_hPhaseCritSect))
+	{
+	if(SpinCnt -= 1)
+		continue;
+	SwitchToThread();
+	SpinCnt = 500;
+	}
+#else
+while(pthread_spin_trylock(&m_hPhaseSpinLock)==EBUSY)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	sched_yield();
+	SpinCnt = 500;
+	}
+#endif
+}
+
+inline void
+CSQLiteSummaries::PhaseRelease(void)
+{
+#ifdef _WIN32
+LeaveCriticalSection(&m_hPhaseCritSect);
+#else
+pthread_spin_unlock(&m_hPhaseSpinLock);
+#endif
+}
+
 
 sqlite3 *
 CSQLiteSummaries::OpenDatabase(char *pszDatabase,		// database to open, if not already existing then will be created
@@ -228,7 +312,7 @@ if((sqlite_error = sqlite3_open_v2(pszDatabase, &m_pDB,SQLITE_OPEN_READWRITE | S
 
 // create all tables which may not already exist
 pStms = m_StmSQL;
-for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
+for(TblIdx = 0; TblIdx < cNumSummTbls; TblIdx++,pStms++)
 	{
 	pStms->pPrepInsert = NULL;
 	if(pStms->pszCreateTbl == NULL)
@@ -246,7 +330,7 @@ for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
 
 
 pStms = m_StmSQL;
-for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
+for(TblIdx = 0; TblIdx < cNumSummTbls; TblIdx++,pStms++)
 	{
 	if(pStms->pszOpenCreateIndexes == NULL)
 		continue;
@@ -263,7 +347,7 @@ for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
 
 // prepare all insert statements
 pStms = m_StmSQL;
-for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
+for(TblIdx = 0; TblIdx < cNumSummTbls; TblIdx++,pStms++)
 	{
 	if(pStms->pszInsert == NULL)
 		{
@@ -300,7 +384,7 @@ tsSummStmSQL *pStms;
 pStms = m_StmSQL;
 if(m_pDB != NULL)
 	{
-	for(TblIdx = 0; TblIdx < 7; TblIdx++,pStms++)
+	for(TblIdx = 0; TblIdx < cNumSummTbls; TblIdx++,pStms++)
 		{
 		if(pStms->pPrepInsert == NULL)
 			continue;
@@ -1006,12 +1090,219 @@ return(ResultID);
 
 
 
+INT64											// returns monotonic clock in microseconds
+CSQLiteSummaries::GetMonotonicUSecs(void)
+{
+#ifdef _WIN32
+LARGE_INTEGER Freq;
+LARGE_INTEGER Cnt;
+QueryPerformanceFrequency(&Freq);
+QueryPerformanceCounter(&Cnt);
+return((INT64)((Cnt.QuadPart / Freq.QuadPart) * 1000000 + ((Cnt.QuadPart % Freq.QuadPart) * 1000000) / Freq.QuadPart));
+#else
+struct timespec ts;
+clock_gettime(CLOCK_MONOTONIC,&ts);
+return(((INT64)ts.tv_sec * 1000000) + (INT64)(ts.tv_nsec / 1000));
+#endif
+}
+
+INT64											// returns peak resident set size (KB) of this process
+CSQLiteSummaries::GetPeakRSSKB(void)
+{
+#ifdef _WIN32
+PROCESS_MEMORY_COUNTERS MemCounters;
+if(!GetProcessMemoryInfo(GetCurrentProcess(),&MemCounters,sizeof(MemCounters)))
+	return(0);
+return((INT64)(MemCounters.PeakWorkingSetSize / 1024));
+#else
+struct rusage Usage;
+if(getrusage(RUSAGE_SELF,&Usage) != 0)
+	return(0);
+return((INT64)Usage.ru_maxrss);			// Linux reports ru_maxrss in KB
+#endif
+}
+
+int												// returned phase identifier, < 0 if errors
+CSQLiteSummaries::StartPhase(int ProcessingID,	// identifier returned by StartProcessing()
+						const char *pszPhaseName)	// phase name
+{
+int PhaseIdx;
+tsSummPhase *pPhase;
+
+if(m_pDB == NULL || ProcessingID < 1 || pszPhaseName == NULL || pszPhaseName[0] == '\0')
+	return(eBSFerrParams);
+
+PhaseSerialise();
+pPhase = m_Phases;
+for(PhaseIdx = 0; PhaseIdx < cMaxSummPhases; PhaseIdx++,pPhase++)
+	if(pPhase->ProcessingID == 0)
+		break;
+if(PhaseIdx == cMaxSummPhases)
+	{
+	PhaseRelease();
+	gDiagnostics.DiagOut(eDLWarn,gszProcName,"StartPhase: unable to start phase '%s', already %d phases active",pszPhaseName,cMaxSummPhases);
+	return(eBSFerrMaxEntries);
+	}
+memset(pPhase,0,sizeof(tsSummPhase));
+pPhase->ProcessingID = ProcessingID;
+strncpy(pPhase->szName,pszPhaseName,cMaxNameLen);
+pPhase->szName[cMaxNameLen] = '\0';
+GetTimeStamp(pPhase->szStart);
+pPhase->StartUSecs = GetMonotonicUSecs();
+PhaseRelease();
+return(PhaseIdx + 1);
+}
+
+int
+CSQLiteSummaries::AddPhaseSample(int PhaseID,		// identifier returned by StartPhase()
+						const char *pszCounterName,	// sample is for this counter
+						INT64 Value)				// sample value
+{
+int CounterIdx;
+tsSummPhase *pPhase;
+tsSummPhaseCounter *pCounter;
+
+if(PhaseID < 1 || PhaseID > cMaxSummPhases || pszCounterName == NULL || pszCounterName[0] == '\0')
+	return(eBSFerrParams);
+
+PhaseSerialise();
+pPhase = &m_Phases[PhaseID-1];
+if(pPhase->ProcessingID == 0)
+	{
+	PhaseRelease();
+	return(eBSFerrParams);
+	}
+pCounter = pPhase->Counters;
+for(CounterIdx = 0; CounterIdx < pPhase->NumCounters; CounterIdx++,pCounter++)
+	if(!strncmp(pCounter->szName,pszCounterName,cMaxNameLen))
+		break;
+if(CounterIdx == pPhase->NumCounters)
+	{
+	if(CounterIdx == cMaxSummPhaseCounters)
+		{
+		PhaseRelease();
+		return(eBSFerrMaxEntries);
+		}
+	strncpy(pCounter->szName,pszCounterName,cMaxNameLen);
+	pCounter->szName[cMaxNameLen] = '\0';
+	pCounter->Total = 0;
+	pCounter->NumSamples = 0;
+	pCounter->MinSample = Value;
+	pCounter->MaxSample = Value;
+	pPhase->NumCounters += 1;
+	}
+pCounter->Total += Value;
+pCounter->NumSamples += 1;
+if(Value < pCounter->MinSample)
+	pCounter->MinSample = Value;
+if(Value > pCounter->MaxSample)
+	pCounter->MaxSample = Value;
+PhaseRelease();
+return(eBSFSuccess);
+}
+
+int												// database identifier of phase row in TblPhases, < 0 if errors
+CSQLiteSummaries::EndPhase(int PhaseID)			// identifier returned by StartPhase()
+{
+int CounterIdx;
+int DBPhaseID;
+int sqlite_error;
+double ElapsedSecs;
+INT64 PeakRSSKB;
+tsSummStmSQL *pStm;
+tsSummPhaseCounter *pCounter;
+tsSummPhase Phase;
+char szTimestamp[cMaxNameLen];
+
+if(PhaseID < 1 || PhaseID > cMaxSummPhases)
+	return(eBSFerrParams);
+
+// take a copy of the phase and release its slot so that database I/O is not performed whilst holding the phase lock
+PhaseSerialise();
+if(m_Phases[PhaseID-1].ProcessingID == 0)
+	{
+	PhaseRelease();
+	return(eBSFerrParams);
+	}
+Phase = m_Phases[PhaseID-1];
+m_Phases[PhaseID-1].ProcessingID = 0;
+PhaseRelease();
+
+ElapsedSecs = (double)(GetMonotonicUSecs() - Phase.StartUSecs) / 1000000.0;
+PeakRSSKB = GetPeakRSSKB();
+
+if(m_pDB == NULL)
+	return(eBSFerrInternal);
+
+SQLiteSerialise();
+GetTimeStamp(szTimestamp);
+pStm = &m_StmSQL[7];
+if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, Phase.ProcessingID))!=SQLITE_OK ||
+	(sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 2, Phase.szName,-1,SQLITE_STATIC))!=SQLITE_OK ||
+	(sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 3, Phase.szStart,-1,SQLITE_STATIC))!=SQLITE_OK ||
+	(sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 4, szTimestamp,-1,SQLITE_STATIC))!=SQLITE_OK ||
+	(sqlite_error = sqlite3_bind_double(pStm->pPrepInsert, 5, ElapsedSecs))!=SQLITE_OK ||
+	(sqlite_error = sqlite3_bind_int64(pStm->pPrepInsert, 6, PeakRSSKB))!=SQLITE_OK)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
+	CloseDatabase();
+	SQLiteRelease();
+	return(eBSFerrInternal);
+	}
+if((sqlite_error = sqlite3_step(pStm->pPrepInsert))!=SQLITE_DONE)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement: %s", sqlite3_errmsg(m_pDB));   
+	CloseDatabase();
+	SQLiteRelease();
+	return(eBSFerrInternal);
+	}
+sqlite3_reset(pStm->pPrepInsert);
+DBPhaseID = (int)sqlite3_last_insert_rowid(m_pDB);
+
+pStm = &m_StmSQL[8];
+pCounter = Phase.Counters;
+for(CounterIdx = 0; CounterIdx < Phase.NumCounters; CounterIdx++,pCounter++)
+	{
+	if((sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 1, DBPhaseID))!=SQLITE_OK ||
+		(sqlite_error = sqlite3_bind_int(pStm->pPrepInsert, 2, Phase.ProcessingID))!=SQLITE_OK ||
+		(sqlite_error = sqlite3_bind_text(pStm->pPrepInsert, 3, pCounter->szName,-1,SQLITE_STATIC))!=SQLITE_OK ||
+		(sqlite_error = sqlite3_bind_int64(pStm->pPrepInsert, 4, pCounter->Total))!=SQLITE_OK ||
+		(sqlite_error = sqlite3_bind_int64(pStm->pPrepInsert, 5, pCounter->NumSamples))!=SQLITE_OK ||
+		(sqlite_error = sqlite3_bind_int64(pStm->pPrepInsert, 6, pCounter->MinSample))!=SQLITE_OK ||
+		(sqlite_error = sqlite3_bind_int64(pStm->pPrepInsert, 7, pCounter->MaxSample))!=SQLITE_OK)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - bind prepared statement: %s", sqlite3_errmsg(m_pDB)); 
+		CloseDatabase();
+		SQLiteRelease();
+		return(eBSFerrInternal);
+		}
+	if((sqlite_error = sqlite3_step(pStm->pPrepInsert))!=SQLITE_DONE)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"sqlite - step prepared statement: %s", sqlite3_errmsg(m_pDB));   
+		CloseDatabase();
+		SQLiteRelease();
+		return(eBSFerrInternal);
+		}
+	sqlite3_reset(pStm->pPrepInsert);
+	}
+SQLiteRelease();
+return(DBPhaseID);
+}
+
 int					// returned process identifier
 CSQLiteSummaries::EndProcessing(int ProcessingID,	// identifier returned by StartProcessing()
 						  int ResultCode)			// processing completed result code
 {
 char szUpdate[cMaxSQLStatement];
 int sqlite_error;
+int PhaseIdx;
+if(m_pDB == NULL)
+	return(eBSFerrInternal);
+
+// any phases still active for this processing instance are ended, e.g. phases abandoned because of processing errors
+for(PhaseIdx = 0; PhaseIdx < cMaxSummPhases; PhaseIdx++)
+	if(m_Phases[PhaseIdx].ProcessingID == ProcessingID)
+		EndPhase(PhaseIdx + 1);
 if(m_pDB == NULL)
 	return(eBSFerrInternal);
 SQLiteSerialise();
@@ -1051,7 +1342,7 @@ if((sqlite_error = sqlite3_exec(m_pDB,pszEndTransaction,NULL,NULL,NULL))!=SQLITE
 tsSummStmSQL *pStms;
 pStms = m_StmSQL;
 int TblIdx;
-for(TblIdx = 0; TblIdx < 6; TblIdx++,pStms++)
+for(TblIdx = 0; TblIdx < cNumSummTbls; TblIdx++,pStms++)
 	{
 	if(pStms->pszCreateIndexes == NULL)
 		continue;
@@ -40,6 +40,7 @@ Process(int PMode,					// processing mode
 		int MinTandemRpts,			// minimum number of tandem repeats
 		int MaxTandemRpts,			// maximum number of repeats
 		int SSRFlankLen,			// SSR flanking sequence length
+		int NumThreads,				// number of worker threads to use
 		int NumInputFiles,			// number of input filespecs
 		char *pszInputFiles[],		// input multifasta files
 		char *pszKMerFreqFile,		// optional, output element KMer freq to this file
@@ -71,6 +72,9 @@ int MinTandemRpts;			// minimum number of tandem repeats
 int MaxTandemRpts;			// maximum number of repeats
 int SSRFlankLen;			// SSR flanking sequence length
 
+int NumberOfProcessors;		// number of installed CPUs
+int NumThreads;				// number of threads (0 defaults to number of CPUs)
+
 int NumInputFiles;			// number of intput filespecs
 char *pszInputFiles[cMaxInFileSpecs];	// names of input files (wildcards allowed) containing sequences to be processed for SSRs
 
@@ -96,6 +100,8 @@ struct arg_int *maxtandemrpts = arg_int0("R","maxtandemrpts","<int>",			"maximum
 
 struct arg_int *flanklen = arg_int0("l","flanklen","<int>",						"report SSR flanking lengths (100bp default)");
 
+struct arg_int *threads = arg_int0("T","threads","<int>",						"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
+
 struct arg_file *inputfiles = arg_filen("i","in","<file>",0,cMaxInFileSpecs,	"Input file(s) containing sequences to process for SSRs");
 struct arg_file *kmerfreq = arg_file0("O","outkmerfreq","<file>",				"Output K-mer element freq to this file");
 struct arg_file *outfile = arg_file1("o","out","<file>",						"Output SSRs to this file");
@@ -108,7 +114,7 @@ struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
-	                mode,minrepellen, maxrepellen, mintandemrpts, maxtandemrpts, flanklen, inputfiles, kmerfreq, outfile,
+	                mode,minrepellen, maxrepellen, mintandemrpts, maxtandemrpts, flanklen, threads, inputfiles, kmerfreq, outfile,
 					end};
 char **pAllArgs;
 int argerrors;
@@ -285,6 +291,23 @@ if (!argerrors)
 		return(1);
 		}
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 	int Idx;
 	for(NumInputFiles=Idx=0;NumInputFiles < cMaxInFileSpecs && Idx < inputfiles->count; Idx++)
 		{
@@ -341,6 +364,7 @@ if (!argerrors)
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"minimum number of tandem element repeats: %d",MinTandemRpts);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"maximum number of tandem element repeats: %d",MaxTandemRpts);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"SSR flanking length: %dbp",SSRFlankLen);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Experiment name : '%s'",szExperimentName);
@@ -363,6 +387,7 @@ if (!argerrors)
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(MinTandemRpts),"mintandemrpts",&MinTandemRpts);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(MaxTandemRpts),"maxtandemrpts",&MaxTandemRpts);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(SSRFlankLen),"flanklen",&SSRFlankLen);
+		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumThreads),"threads",&NumThreads);
 
 	    ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumInputFiles),"NumInputFiles",&NumInputFiles);
 		for(Idx=0; Idx < NumInputFiles; Idx++)
@@ -383,7 +408,7 @@ if (!argerrors)
 #endif
 	gStopWatch.Start();
 
-	Rslt = Process(PMode,eRFCsv,MinRepElLen,MaxRepElLen,MinTandemRpts,MaxTandemRpts,SSRFlankLen,NumInputFiles,pszInputFiles,szKMerFreqFile,szOutFile);
+	Rslt = Process(PMode,eRFCsv,MinRepElLen,MaxRepElLen,MinTandemRpts,MaxTandemRpts,SSRFlankLen,NumThreads,NumInputFiles,pszInputFiles,szKMerFreqFile,szOutFile);
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -412,6 +437,7 @@ Process(int PMode,					// processing mode
 		int MinTandemRpts,			// minimum number of tandem repeats
 		int MaxTandemRpts,			// maximum number of repeats
 		int SSRFlankLen,			// SSR flanking lengths
+		int NumThreads,				// number of worker threads to use
 		int NumInputFiles,			// number of input filespecs
 		char *pszInputFiles[],		// input multifasta files
 		char *pszKMerFreqFile,		// optional, output element KMer freq to this file
@@ -419,7 +445,7 @@ Process(int PMode,					// processing mode
 {
 int Rslt;
 CSSRDiscovery CSSRDiscovery;
-Rslt = CSSRDiscovery.Process(PMode,RptSSRsFormat,MinRepElLen,MaxRepElLen,MinTandemRpts,MaxTandemRpts,SSRFlankLen,NumInputFiles,pszInputFiles,pszKMerFreqFile,pszOutFile);
+Rslt = CSSRDiscovery.Process(PMode,RptSSRsFormat,MinRepElLen,MaxRepElLen,MinTandemRpts,MaxTandemRpts,SSRFlankLen,NumThreads,NumInputFiles,pszInputFiles,pszKMerFreqFile,pszOutFile);
 return(Rslt);
 }
 
@@ -431,6 +457,10 @@ CSSRDiscovery::CSSRDiscovery(void)
 m_pSeqBuff = NULL;
 m_pKMerDist = NULL;
 m_pszRptSSRsBuff = NULL;
+m_pSSRSeqs = NULL;
+m_pSSRWins = NULL;
+m_NumSSRWins = 0;
+m_AllocSSRWins = 0;
 Init();
 }
 
@@ -458,6 +488,17 @@ if(m_pKMerDist != NULL)
 	}
 if(m_pszRptSSRsBuff != NULL)
 	delete m_pszRptSSRsBuff;
+if(m_pSSRSeqs != NULL)
+	delete [] m_pSSRSeqs;
+if(m_pSSRWins != NULL)
+	{
+	tsSSRWin *pWin;
+	int WinIdx;
+	for(pWin = m_pSSRWins, WinIdx = 0; WinIdx < m_AllocSSRWins; WinIdx++, pWin++)
+		if(pWin->pHits != NULL)
+			free(pWin->pHits);
+	free(m_pSSRWins);
+	}
 }
 
 
@@ -467,6 +508,10 @@ CSSRDiscovery::Init(void)
 m_pSeqBuff = NULL;
 m_pKMerDist = NULL;
 m_pszRptSSRsBuff = NULL;
+m_pSSRSeqs = NULL;
+m_pSSRWins = NULL;
+m_NumSSRWins = 0;
+m_AllocSSRWins = 0;
 m_hOutFile = -1;
 m_hOutKMerFreqFile = -1;
 Reset();
@@ -504,6 +549,23 @@ if(m_pszRptSSRsBuff != NULL)
 	m_pszRptSSRsBuff = NULL;
 	}
 
+if(m_pSSRSeqs != NULL)
+	{
+	delete [] m_pSSRSeqs;
+	m_pSSRSeqs = NULL;
+	}
+
+if(m_pSSRWins != NULL)
+	{
+	tsSSRWin *pWin;
+	int WinIdx;
+	for(pWin = m_pSSRWins, WinIdx = 0; WinIdx < m_AllocSSRWins; WinIdx++, pWin++)
+		if(pWin->pHits != NULL)
+			free(pWin->pHits);
+	free(m_pSSRWins);
+	m_pSSRWins = NULL;
+	}
+
 if(m_pSeqBuff != NULL)
 	{
 #ifdef _WIN32
@@ -530,6 +592,11 @@ m_SeqBuffLen = 0;
 m_AllocdKMerFreqMem = 0;
 m_KMerFreqLen = 0;
 m_IdxRptSSRs = 0;
+m_NumSSRSeqs = 0;
+m_NumSSRWins = 0;
+m_AllocSSRWins = 0;
+m_NumSSRWinsClaimed = 0;
+m_NumSSRWinsDone = 0;
 m_CurTime.Stop();
 }
 
@@ -595,6 +662,7 @@ char szSource[cBSFSourceSize];
 char szDescription[cBSFDescriptionSize];
 UINT32 SeqLen;
 int Rslt;
+INT64 SeqOfs;
 tBSFEntryID CurEntryID;
 
 if((Rslt=BioSeqFile.Open(pszFile,cBSFTypeSeq,false))!=eBSFSuccess)
@@ -603,6 +671,8 @@ if((Rslt=BioSeqFile.Open(pszFile,cBSFTypeSeq,false))!=eBSFSuccess)
 	return(Rslt);
 	}
 
+m_SeqBuffLen = 0;
+m_NumSSRSeqs = 0;
 CurEntryID = 0;
 while((Rslt = CurEntryID = BioSeqFile.Next(CurEntryID)) > eBSFSuccess)
 	{
@@ -614,28 +684,30 @@ while((Rslt = CurEntryID = BioSeqFile.Next(CurEntryID)) > eBSFSuccess)
 	if(!SeqLen)
 		continue;
 
-	if(AllocSeqBuff(SeqLen) == NULL)
+	if(AllocSeqBuff(m_SeqBuffLen + SeqLen) == NULL)
 		{
 		Rslt = eBSFerrMem;
 		break;
 		}
 
-	if((Rslt = BioSeqFile.GetData(CurEntryID,eSeqBaseType,0,m_pSeqBuff,SeqLen)) != SeqLen)
+	SeqOfs = m_SeqBuffLen;
+	if((Rslt = BioSeqFile.GetData(CurEntryID,eSeqBaseType,0,&m_pSeqBuff[SeqOfs],SeqLen)) != SeqLen)
 		{
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessBioseqFile - error %d %s",Rslt,BioSeqFile.GetErrMsg());
 		break;
 		}
+	m_SeqBuffLen += SeqLen;
 
-	if((Rslt=IdentifySSRs(szSource,pszFile,SeqLen,m_pSeqBuff)) < eBSFSuccess)
+	if((Rslt=AddSSRSeq(szSource,pszFile,SeqOfs)) < eBSFSuccess)
 		{
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessBioseqFile - error %d",Rslt);
 		break;
 		}
-
-	ReportProgress();
 	}
 if(Rslt == eBSFerrEntry)
 	Rslt = eBSFSuccess;
+if(Rslt >= eBSFSuccess && m_NumSSRSeqs > 0)		// process any remaining batched sequences
+	Rslt = IdentifySSRs(pszFile);
 
 BioSeqFile.Close();
 return(Rslt);
@@ -657,6 +729,7 @@ bool bFirstEntry;
 bool bEntryCreated;
 int Rslt;
 int SeqID;
+INT64 SeqOfs;
 
 if((Rslt=Fasta.Open(pszFile,true))!=eBSFSuccess)
 	{
@@ -682,19 +755,22 @@ bFirstEntry = true;
 bEntryCreated = false;
 SeqID = 0;
 m_SeqBuffLen = 0;
+m_NumSSRSeqs = 0;
+SeqOfs = 0;
 AvailBuffSize = m_AllocdSeqBuffMem;
 while((Rslt = SeqLen = Fasta.ReadSequence(&m_pSeqBuff[m_SeqBuffLen],(int)min(AvailBuffSize,(size_t)cMaxAllocBuffChunk),true,false)) > eBSFSuccess)
 	{
 	if(SeqLen == eBSFFastaDescr)		// just read a descriptor line
 		{
 		SeqID++;
-		if(bEntryCreated)				// add any previous entry
+		if(bEntryCreated)				// add any previous entry to current batch
 			{
-			if((Rslt=IdentifySSRs(szName,pszFile,m_SeqBuffLen,m_pSeqBuff)) < eBSFSuccess)
+			if((Rslt=AddSSRSeq(szName,pszFile,SeqOfs)) < eBSFSuccess)
 				{
 				gDiagnostics.DiagOut(eDLFatal,gszProcName,"ProcessFastaFile - error %d",Rslt);
 				break;
 				}
+			AvailBuffSize = m_AllocdSeqBuffMem - m_SeqBuffLen;	// batch may have been processed and m_SeqBuffLen reset
 			}
 		Descrlen = Fasta.ReadDescriptor(szDescription,cBSFDescriptionSize);
 		// An assumption - will one day bite real hard - is that the
@@ -705,7 +781,7 @@ while((Rslt = SeqLen = Fasta.ReadSequence(&m_pSeqBuff[m_SeqBuffLen],(int)min(Ava
 
 		bFirstEntry = false;
 		bEntryCreated = true;
-		m_SeqBuffLen = 0;
+		SeqOfs = m_SeqBuffLen;
 		continue;
 		}
 	else
@@ -732,11 +808,15 @@ while((Rslt = SeqLen = Fasta.ReadSequence(&m_pSeqBuff[m_SeqBuffLen],(int)min(Ava
 		}
 	}
 
-if(Rslt >= eBSFSuccess && bEntryCreated && m_SeqBuffLen > 0)			// close entry
-	if((Rslt=IdentifySSRs(szName,pszFile,m_SeqBuffLen,m_pSeqBuff)) < eBSFSuccess)
+if(Rslt >= eBSFSuccess && bEntryCreated)			// close entry
+	Rslt = AddSSRSeq(szName,pszFile,SeqOfs);
+if(Rslt >= eBSFSuccess && m_NumSSRSeqs > 0)		// process any remaining batched sequences
+	{
+	if((Rslt=IdentifySSRs(pszFile)) < eBSFSuccess)
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentifySSRs - error %d",Rslt);
 	else
 		Rslt = eBSFSuccess;
+	}
 
 return(Rslt);
 }
@@ -910,40 +990,333 @@ return(pKMerDist->Cnt);
 }
 
 
+// AddSSRSeq
+// Sequences are batched in m_pSeqBuff so that many short sequences, as well as windows partitioning long sequences, can be processed concurrently
+int
+CSSRDiscovery::AddSSRSeq(char *pszName,		// add sequence, buffered in m_pSeqBuff from SeqOfs to m_SeqBuffLen, to current batch, and process batch if full
+			 char *pszInFile,				// sequence parsed from this file
+			 INT64 SeqOfs)					// sequence starts at this offset in m_pSeqBuff
+{
+int Rslt;
+tsSSRSeq *pSeq;
+
+if((INT64)m_SeqBuffLen > SeqOfs)
+	{
+	pSeq = &m_pSSRSeqs[m_NumSSRSeqs++];
+	strncpy(pSeq->szName,pszName,sizeof(pSeq->szName)-1);
+	pSeq->szName[sizeof(pSeq->szName)-1] = '\0';
+	pSeq->SeqOfs = SeqOfs;
+	pSeq->SeqLen = (INT64)m_SeqBuffLen - SeqOfs;
+	pSeq->FirstWinIdx = 0;
+	pSeq->NumWins = 0;
+	}
+
+if(m_NumSSRSeqs > 0 && (m_SeqBuffLen >= cSSRBatchLen || m_NumSSRSeqs == cSSRMaxBatchSeqs))
+	{
+	if((Rslt = IdentifySSRs(pszInFile)) < eBSFSuccess)
+		return(Rslt);
+	m_SeqBuffLen = 0;
+	m_NumSSRSeqs = 0;
+	}
+return(eBSFSuccess);
+}
+
+// IdentifySSRs
+// Partitions the batched sequences into windows which are processed by worker threads, SSRs are then reported in the same order
+// as if each sequence had been processed serially - ordered by element length then by offset within the sequence
+int
+CSSRDiscovery::IdentifySSRs(char *pszInFile)	// identify, and report, SSRs in all sequences in current batch
+{
+int Rslt;
+int SeqIdx;
+int WinIdx;
+int NumWins;
+int NumSSRs;
+int RepElLen;
+int ThreadIdx;
+int NumThreads;
+INT64 WinLen;
+INT64 WinStart;
+tsSSRSeq *pSeq;
+tsSSRWin *pWin;
+tsSSRHit *pHit;
+tsSSRThreadPars *pThreads;
+tsSSRThreadPars *pPars;
+
+// partition sequences into windows of at most cSSRWindowLen, windows within a sequence are of similar length
+m_NumSSRWins = 0;
+pSeq = m_pSSRSeqs;
+for(SeqIdx = 0; SeqIdx < m_NumSSRSeqs; SeqIdx++,pSeq++)
+	{
+	NumWins = (int)((pSeq->SeqLen + cSSRWindowLen - 1) / cSSRWindowLen);
+	WinLen = (pSeq->SeqLen + NumWins - 1) / NumWins;
+	if((m_NumSSRWins + NumWins) > m_AllocSSRWins)
+		{
+		int ReallocWins = m_AllocSSRWins + NumWins + cSSRMaxBatchSeqs;
+		if((pWin = (tsSSRWin *)realloc(m_pSSRWins,sizeof(tsSSRWin) * ReallocWins)) == NULL)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentifySSRs: Memory re-allocation to %lld bytes - %s",(INT64)sizeof(tsSSRWin) * ReallocWins,strerror(errno));
+			return(eBSFerrMem);
+			}
+		memset(&pWin[m_AllocSSRWins],0,sizeof(tsSSRWin) * (ReallocWins - m_AllocSSRWins));
+		m_pSSRWins = pWin;
+		m_AllocSSRWins = ReallocWins;
+		}
+	pSeq->FirstWinIdx = m_NumSSRWins;
+	pSeq->NumWins = NumWins;
+	pWin = &m_pSSRWins[m_NumSSRWins];
+	for(WinStart = 0, WinIdx = 0; WinIdx < NumWins; WinIdx++, pWin++, WinStart += WinLen)
+		{
+		pWin->SeqIdx = SeqIdx;
+		pWin->WinStart = WinStart;
+		pWin->WinEnd = min(WinStart + WinLen,pSeq->SeqLen);
+		pWin->NumExcessive = 0;
+		pWin->NumHits = 0;
+		pWin->RptIdx = 0;
+		}
+	m_NumSSRWins += NumWins;
+	}
+
+// startup worker threads, each thread claims and processes windows until all windows have been claimed
+NumThreads = min(m_NumThreads,m_NumSSRWins);
+if((pThreads = new tsSSRThreadPars [NumThreads]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentifySSRs: Memory allocation for %d threads failed",NumThreads);
+	return(eBSFerrMem);
+	}
+memset(pThreads,0,sizeof(tsSSRThreadPars) * NumThreads);
+m_NumSSRWinsClaimed = 0;
+m_NumSSRWinsDone = 0;
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+	pPars->ThreadIdx = ThreadIdx + 1;
+	pPars->pThis = this;
+	pPars->Rslt = eBSFSuccess;
+#ifdef _WIN32
+	pPars->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,SSRThreadStart,pPars,0,&pPars->threadID);
+#else
+	pPars->threadRslt =	pthread_create (&pPars->threadID , NULL , SSRThreadStart , pPars );
+#endif
+	}
+
+// wait for all threads to have completed
+Rslt = eBSFSuccess;
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+#ifdef _WIN32
+	while(WAIT_TIMEOUT == WaitForSingleObject( pPars->threadHandle, 60000))
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u of %d sequence windows processed",m_NumSSRWinsDone,m_NumSSRWins);
+	CloseHandle( pPars->threadHandle);
+#else
+	struct timespec ts;
+	int JoinRlt;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += 60;
+	while((JoinRlt = pthread_timedjoin_np(pPars->threadID, NULL, &ts)) != 0)
+		{
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u of %d sequence windows processed",m_NumSSRWinsDone,m_NumSSRWins);
+		ts.tv_sec += 60;
+		}
+#endif
+	if(pPars->Rslt < eBSFSuccess && Rslt >= eBSFSuccess)
+		Rslt = pPars->Rslt;
+	}
+delete [] pThreads;
+if(Rslt < eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"IdentifySSRs: Worker thread failed - error %d",Rslt);
+	return(Rslt);
+	}
+
+// report SSRs in sequence order, and within each sequence, in element length then window order
+NumSSRs = 0;
+pSeq = m_pSSRSeqs;
+for(SeqIdx = 0; SeqIdx < m_NumSSRSeqs; SeqIdx++,pSeq++)
+	{
+	for(RepElLen = m_MinRepElLen; RepElLen <= m_MaxRepElLen; RepElLen++)
+		{
+		pWin = &m_pSSRWins[pSeq->FirstWinIdx];
+		for(WinIdx = 0; WinIdx < pSeq->NumWins; WinIdx++, pWin++)
+			{
+			if(RepElLen == m_MinRepElLen)
+				m_TotNumExcessiveTandemSSRs += pWin->NumExcessive;
+			for(pHit = &pWin->pHits[pWin->RptIdx]; pWin->RptIdx < pWin->NumHits && pHit->RepElLen == RepElLen; pWin->RptIdx++, pHit++)
+				{
+				m_TotNumAcceptedSSRs += 1;
+				Report(RepElLen,pHit->NumTandemEls,pHit->SSRStartOfs,pSeq->szName,pszInFile,pSeq->SeqLen,&m_pSeqBuff[pSeq->SeqOfs]);
+				NumSSRs += 1;
+				m_TotNumAcceptedKmerSSRs[RepElLen] += 1;
+				CntKMer(RepElLen,pHit->NumTandemEls,&m_pSeqBuff[pSeq->SeqOfs + pHit->SSRStartOfs]);
+				}
+			}
+		}
+	ReportProgress();
+	}
+return(NumSSRs);
+}
+
+// Thread startup
+#ifdef _WIN32
+unsigned int __stdcall CSSRDiscovery::SSRThreadStart(void *args)
+{
+#else
+void * CSSRDiscovery::SSRThreadStart(void *args)
+{
+#endif
+tsSSRThreadPars *pArgs = (tsSSRThreadPars *)args;
+pArgs->Rslt = pArgs->pThis->SSRThread(pArgs);
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
 int
-CSSRDiscovery::IdentifySSRs(char *pszDescr,	// descriptor for the targeted sequence
-			 char *pszInFile,			// sequence parsed from this file
-			 INT64 TargSeqLen,			// sequence length of targeted sequence within which to search for SSRs
-			 etSeqBase *pTargSeq)		// identify SSRs in this targeted sequence
+CSSRDiscovery::SSRThread(tsSSRThreadPars *pPars)	// worker thread processing windows until all windows claimed
 {
+int Rslt;
+unsigned int WinIdx;
+
+if((pPars->pSeq = new etSeqBase [cSSRWindowLen + (2 * cSSRWindowOverlap) + cSSRWindowPad]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"SSRThread: Memory allocation for window buffering failed");
+	return(eBSFerrMem);
+	}
+
+Rslt = eBSFSuccess;
+while(1)
+	{
+#ifdef _WIN32
+	WinIdx = InterlockedIncrement((volatile LONG *)&m_NumSSRWinsClaimed) - 1;
+#else
+	WinIdx = __sync_fetch_and_add(&m_NumSSRWinsClaimed,1);
+#endif
+	if(WinIdx >= (unsigned int)m_NumSSRWins)
+		break;
+	if((Rslt = IdentifyWinSSRs(pPars,&m_pSSRWins[WinIdx])) < eBSFSuccess)
+		break;
+#ifdef _WIN32
+	InterlockedIncrement((volatile LONG *)&m_NumSSRWinsDone);
+#else
+	__sync_fetch_and_add(&m_NumSSRWinsDone,1);
+#endif
+	}
+
+delete [] pPars->pSeq;
+pPars->pSeq = NULL;
+return(Rslt < eBSFSuccess ? Rslt : eBSFSuccess);
+}
+
+int
+CSSRDiscovery::AddSSRHit(tsSSRWin *pWin,	// accepted SSR in this window
+			 int RepElLen,				// SSR contains repeat elements of this length
+			 int NumTandemEls,			// each repeat element is repeated this many times
+			 INT64 SSRStartOfs)			// SSR starts at this offset within the sequence
+{
+tsSSRHit *pHit;
+int ReallocHits;
+if(pWin->pHits == NULL || pWin->NumHits == pWin->AllocHits)
+	{
+	ReallocHits = pWin->pHits == NULL ? cSSRInitAllocHits : pWin->AllocHits * 2;
+	if((pHit = (tsSSRHit *)realloc(pWin->pHits,sizeof(tsSSRHit) * ReallocHits)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddSSRHit: Memory re-allocation to %lld bytes - %s",(INT64)sizeof(tsSSRHit) * ReallocHits,strerror(errno));
+		return(eBSFerrMem);
+		}
+	pWin->pHits = pHit;
+	pWin->AllocHits = ReallocHits;
+	}
+pHit = &pWin->pHits[pWin->NumHits++];
+pHit->SSRStartOfs = SSRStartOfs;
+pHit->RepElLen = (UINT8)RepElLen;
+pHit->NumTandemEls = (UINT8)NumTandemEls;
+return(pWin->NumHits);
+}
+
+// IdentifyWinSSRs
+// Window bases, plus up to cSSRWindowOverlap flanking bases at either end, are copied into a thread private buffer and scanned for SSRs
+// exactly as if the complete sequence was being scanned; the flanking context ensures that the scanning state, and the marking of bases
+// in SSRs of shorter element lengths, is the same at the window boundaries as it would be if scanning the complete sequence.
+// Only those SSRs starting within the window are accepted for reporting, other SSRs are owned by the adjacent windows.
+// Putative SSR starts are located by comparing 8 bases against the 8 bases one element length downstream in a single 64bit word operation,
+// any base which could not start an SSR (canonical and differing from the downstream base) is skipped without further element comparisons
+int
+CSSRDiscovery::IdentifyWinSSRs(tsSSRThreadPars *pPars,	// worker thread
+			 tsSSRWin *pWin)			// identify SSRs starting within this window
+{
+int Rslt;
 bool bSlough;
 etSeqBase BaseA;
 etSeqBase BaseB;
 INT64 Ofs;
 INT64 SSRStartOfs;
+INT64 ScanStart;
+INT64 ScanLen;
+INT64 OwnStart;
+INT64 OwnEnd;
 int RepElLen;
 int RepElOfs;
 int NumTandemEls;
-int NumSSRs;
 etSeqBase *pBase;
 etSeqBase *pRepElBase;
 etSeqBase *pRepMark;
+etSeqBase *pTargSeq;
 int MarkLen;
+UINT64 WordA;
+UINT64 WordB;
+UINT64 Cands;
+tsSSRSeq *pSeq;
+
+pSeq = &m_pSSRSeqs[pWin->SeqIdx];
+ScanStart = max((INT64)0,pWin->WinStart - cSSRWindowOverlap);
+ScanLen = min(pSeq->SeqLen,pWin->WinEnd + cSSRWindowOverlap) - ScanStart;
+OwnStart = pWin->WinStart - ScanStart;
+OwnEnd = pWin->WinEnd - ScanStart;
+pWin->NumHits = 0;
+pWin->NumExcessive = 0;
+
+// ensure no flag bits set in most significant nibble
+pTargSeq = pPars->pSeq;
+pBase = &m_pSeqBuff[pSeq->SeqOfs + ScanStart];
+for(Ofs = 0; Ofs < ScanLen; Ofs++)
+	pTargSeq[Ofs] = *pBase++ & 0x07;
+memset(&pTargSeq[ScanLen],eBaseN,cSSRWindowPad);
 
-// ensure no flag bits set in most significan nibble
-pBase = pTargSeq;
-for(Ofs = 0; Ofs < TargSeqLen; Ofs++,pBase++)
-	*pBase &= 0x07;
-
-NumSSRs = 0;
 for(RepElLen = m_MinRepElLen; RepElLen <= m_MaxRepElLen; RepElLen++)
 	{
 	pBase = pTargSeq;
 	SSRStartOfs = 0;
 	NumTandemEls = 0;
 	bSlough = false;
-	for(Ofs = 0; Ofs < (TargSeqLen - RepElLen); Ofs++,pBase++)
+	for(Ofs = 0; Ofs < (ScanLen - RepElLen); Ofs++,pBase++)
 		{
+		if(NumTandemEls == 0)	// not within a putative SSR so skip over bases which can't start an SSR
+			{
+			while((Ofs + 8) <= (ScanLen - RepElLen))
+				{
+				memcpy(&WordA,pBase,sizeof(WordA));
+				memcpy(&WordB,&pBase[RepElLen],sizeof(WordB));
+				// high bit in each byte set if bases are identical or either base non-canonical or marked
+				Cands = ~((WordA ^ WordB) + 0x7f7f7f7f7f7f7f7fULL) | (((WordA | WordB) & 0x0c0c0c0c0c0c0c0cULL) + 0x7f7f7f7f7f7f7f7fULL);
+				if((Cands &= 0x8080808080808080ULL) != 0)
+					{
+					while(!(Cands & 0x080))
+						{
+						Cands >>= 8;
+						Ofs++;
+						pBase++;
+						}
+					break;
+					}
+				Ofs += 8;
+				pBase += 8;
+				}
+			if(Ofs >= (ScanLen - RepElLen))
+				break;
+			}
+
 		pRepElBase = pBase;
 		for(RepElOfs = 0; RepElOfs < RepElLen; RepElOfs++,pRepElBase++)
 			{
@@ -1011,14 +1384,17 @@ for(RepElLen = m_MinRepElLen; RepElLen <= m_MaxRepElLen; RepElLen++)
 			if(!bSlough && NumTandemEls >= m_MinTandemRpts)
 				{
 				if(NumTandemEls > m_MaxTandemRpts)
-					m_TotNumExcessiveTandemSSRs += 1;
+					{
+					if(SSRStartOfs >= OwnStart && SSRStartOfs < OwnEnd)
+						pWin->NumExcessive += 1;
+					}
 				else
 					{
-					m_TotNumAcceptedSSRs += 1;
-					Report(RepElLen,NumTandemEls,SSRStartOfs,pszDescr,pszInFile,TargSeqLen,pTargSeq);
-					NumSSRs += 1;
-					m_TotNumAcceptedKmerSSRs[RepElLen] += 1;
-					CntKMer(RepElLen,NumTandemEls,&pTargSeq[SSRStartOfs]);
+					if(SSRStartOfs >= OwnStart && SSRStartOfs < OwnEnd)
+						{
+						if((Rslt = AddSSRHit(pWin,RepElLen,NumTandemEls,ScanStart + SSRStartOfs)) < eBSFSuccess)
+							return(Rslt);
+						}
 
 					// mark this sequence so it doesn't get accepted as being a longer K-mer SSR
 					pRepMark = &pTargSeq[SSRStartOfs];
@@ -1032,12 +1408,10 @@ for(RepElLen = m_MinRepElLen; RepElLen <= m_MaxRepElLen; RepElLen++)
 			NumTandemEls = 0;
 			bSlough = false;
 			}
-		if(!(Ofs % 100))
-			ReportProgress();
 		}
 	}
-return(NumSSRs);
-}	
+return(pWin->NumHits);
+}
 
 int
 CSSRDiscovery::ReportKMers(char *pszKMerFreqFile)	// report SSR repeating element K-mer frequencies to this file
@@ -1128,6 +1502,7 @@ CSSRDiscovery::Process(int PMode,			// procesisng mode - currently unused..
 		int MinTandemRpts,					// minimum number of tandem repeats
 		int MaxTandemRpts,					// maximum number of repeats
 		int SSRFlankLen,					// SSR flanking sequences lengths to report
+		int NumThreads,						// number of worker threads to use
 		int NumInFileSpecs,					// number of input, could be wildcarded, file specs
 		char *pszInFiles[],					// files to be processed
 		char *pszKMerFreqFile,				// optional, output element KMer freq to this file
@@ -1147,6 +1522,7 @@ m_MaxRepElLen = MaxRepElLen;
 m_MinTandemRpts = MinTandemRpts;
 m_MaxTandemRpts = MaxTandemRpts;
 m_SSRFlankLen = SSRFlankLen;
+m_NumThreads = NumThreads;
 
 m_TotNumExcessiveTandemSSRs = 0;
 m_TotNumAcceptedSSRs = 0;
@@ -1223,6 +1599,14 @@ if((m_pszRptSSRsBuff = new char [cMaxAllocRptSSRs]) == NULL)
 	}
 m_IdxRptSSRs = 0;
 
+if((m_pSSRSeqs = new tsSSRSeq [cSSRMaxBatchSeqs]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to allocate memory for batching %d sequences",cSSRMaxBatchSeqs);
+	Reset();
+	return(eBSFerrMem);
+	}
+m_NumSSRSeqs = 0;
+
 #ifdef _WIN32
 if((m_hOutFile = open(pszOutFile, _O_RDWR | _O_BINARY | _O_SEQUENTIAL | _O_CREAT | _O_TRUNC, _S_IREAD | _S_IWRITE ))==-1)
 #else
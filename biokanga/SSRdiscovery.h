@@ -3,6 +3,14 @@
 const size_t cMaxAllocBuffChunk = 0x0ffffff;		// allocate for input sequences buffering in these sized chunks
 const int cMaxAllocRptSSRs = 0x07fffff;				// SSR reporting buffer size
 
+const int cMaxWorkerThreads = 128;					// limiting max number of threads to this many
+const size_t cSSRBatchLen = 0x08000000;				// sequences are accumulated into batches of at least this many bases before being processed by worker threads
+const int cSSRMaxBatchSeqs = 0x010000;				// a batch contains at most this many sequences
+const INT64 cSSRWindowLen = 0x0400000;				// sequences longer than this are partitioned into windows, no longer than this, which are independently processed
+const int cSSRWindowOverlap = 0x010000;				// windows are scanned with this many bases of flanking context, must be much longer than the longest SSR (cMaxRepElLen * (cMaxTandemRpts+1))
+const int cSSRWindowPad = 0x040;					// scanned window bases are followed by this many eBaseN's so the kernel can read past the last base
+const int cSSRInitAllocHits = 0x01000;				// initially allocate to hold this many SSRs per window, realloc'd as required
+
 const int cMinRepElLen = 1;				// minimum element K-mer length
 const int cDfltMinRepElLen = 2;			// default minimum element K-mer length
 const int cDfltMaxRepElLen = 5;			// default maximum element k-mer length
@@ -29,6 +37,45 @@ typedef struct TAG_sKMerDist {
 	UINT32 Cnt;							// number of occurances of SSR with this repeating K-mer element
 	UINT32 TandemRpts[1];				// number of tandem repeats (extended to user specified max repeats)
 	} tsKMerDist;
+
+typedef struct TAG_sSSRSeq {
+	char szName[cBSFSourceSize];		// sequence name
+	INT64 SeqOfs;						// sequence starts at this offset in m_pSeqBuff
+	INT64 SeqLen;						// sequence is this length
+	int FirstWinIdx;					// index into m_pSSRWins of first window partitioning this sequence
+	int NumWins;						// sequence partitioned into this many windows
+	} tsSSRSeq;
+
+typedef struct TAG_sSSRHit {
+	INT64 SSRStartOfs;					// SSR starts at this offset within the sequence
+	UINT8 RepElLen;						// SSR contains repeat elements of this length
+	UINT8 NumTandemEls;					// each repeat element is repeated this many times
+	} tsSSRHit;
+
+typedef struct TAG_sSSRWin {
+	int SeqIdx;							// window is within this m_pSSRSeqs[] sequence
+	INT64 WinStart;						// window owns SSRs starting from this sequence offset inclusive
+	INT64 WinEnd;						// until this sequence offset exclusive
+	UINT32 NumExcessive;				// number of putative SSRs, starting within window, not accepted because of m_MaxTandemRpts
+	int NumHits;						// number of accepted SSRs in pHits
+	int AllocHits;						// pHits allocated to hold this many SSRs
+	int RptIdx;							// index of next SSR in pHits to be reported
+	tsSSRHit *pHits;					// accepted SSRs ordered by RepElLen then SSRStartOfs
+	} tsSSRWin;
+
+typedef struct TAG_sSSRThreadPars {
+	int ThreadIdx;						// uniquely identifies this thread
+#ifdef _WIN32
+	HANDLE threadHandle;				// handle as returned by _beginthreadex()
+	unsigned int threadID;				// identifier as set by _beginthreadex()
+#else
+	int threadRslt;						// result as returned by pthread_create ()
+	pthread_t threadID;					// identifier as set by pthread_create ()
+#endif
+	class CSSRDiscovery *pThis;			// class instance
+	etSeqBase *pSeq;					// thread private copy of window bases plus flanking context, private because SSR bases are marked
+	int Rslt;							// returned result code
+	} tsSSRThreadPars;
 #pragma pack()
 
 class CSSRDiscovery
@@ -43,7 +90,16 @@ class CSSRDiscovery
 
 	size_t m_SeqBuffLen;		// number of bases currently buffered in m_pSeqBuff
 	size_t m_AllocdSeqBuffMem;  // size of memory currently allocated to m_pSeqBuff
-	UINT8 *m_pSeqBuff;			// buffers sequences as read from file
+	UINT8 *m_pSeqBuff;			// buffers batches of sequences as read from file
+
+	int m_NumThreads;			// use at most this many worker threads
+	int m_NumSSRSeqs;			// number of sequences in current batch
+	tsSSRSeq *m_pSSRSeqs;		// allocated to hold cSSRMaxBatchSeqs sequences
+	int m_NumSSRWins;			// number of windows partitioning sequences in current batch
+	int m_AllocSSRWins;			// m_pSSRWins allocated to hold this many windows
+	tsSSRWin *m_pSSRWins;		// windows partitioning sequences in current batch
+	volatile unsigned int m_NumSSRWinsClaimed;	// number of windows claimed for processing by worker threads
+	volatile unsigned int m_NumSSRWinsDone;		// number of windows processed by worker threads
 
 	int m_MinRepElLen;			// identify repeating elements of this minimum length
 	int m_MaxRepElLen;			// ranging upto this maximum length
@@ -104,12 +160,25 @@ class CSSRDiscovery
 
 	int	ReportProgress(bool bForce = false);	// let user know that there is processing activity, normally progress reportde evry 60 sec unless bForce set true
 
+	int AddSSRSeq(char *pszName,		// add sequence, buffered in m_pSeqBuff from SeqOfs to m_SeqBuffLen, to current batch, and process batch if full
+			 char *pszInFile,			// sequence parsed from this file
+			 INT64 SeqOfs);				// sequence starts at this offset in m_pSeqBuff
+
 	int
 		IdentifySSRs(
-			 char *pszDescr,			// descriptor for the targeted sequence
-			 char *pszInFile,			// sequence parsed from this file
-			 INT64 TargSeqLen,			// sequence length of targeted sequence within which to search for SSRs
-			 etSeqBase *pTargSeq);		// identify SSRs in this targeted sequence
+			 char *pszInFile);			// identify, and report, SSRs in all sequences in current batch
+
+	int SSRThread(tsSSRThreadPars *pPars);	// worker thread processing windows until all windows claimed
+
+	int
+		IdentifyWinSSRs(
+			 tsSSRThreadPars *pPars,	// worker thread
+			 tsSSRWin *pWin);			// identify SSRs starting within this window
+
+	int AddSSRHit(tsSSRWin *pWin,		// accepted SSR in this window
+			 int RepElLen,				// SSR contains repeat elements of this length
+			 int NumTandemEls,			// each repeat element is repeated this many times
+			 INT64 SSRStartOfs);		// SSR starts at this offset within the sequence
 
 	etSeqBase *AllocSeqBuff(size_t SeqLen);	// allocate for at least this sequence length
 
@@ -117,6 +186,12 @@ class CSSRDiscovery
 				int Rpts,				// tandem repeat counts
 				etSeqBase *pSeq);		// sequence 
 
+#ifdef _WIN32
+	static unsigned int __stdcall SSRThreadStart(void *args);
+#else
+	static void * SSRThreadStart(void *args);
+#endif
+
 public:
 	CSSRDiscovery(void);
 	~CSSRDiscovery(void);
@@ -131,6 +206,7 @@ public:
 			int MinTandemRpts,		// minimum number of tandem repeats
 			int MaxTandemRpts,		// maximum number of repeats
 			int SSRFlankLen,		// SSR flanking sequences lengths to report
+			int NumThreads,			// number of worker threads to use
 			int NumInFileSpecs,		// number of input, could be wildcarded, file specs
 			char *pszInFile[],		// files to be processed
 			char *pszKMerFreqFile,	// optional, output element KMer freq to this file
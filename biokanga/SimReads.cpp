@@ -54,6 +54,7 @@ Process(etPMode PMode,		// processing mode
 		bool bReadHamDist,	// true if hamming distributions from each sampled read to all other genome subsequences to be generated
 		etFMode FMode,		// output format
 		int NumThreads,		// number of worker threads to use
+		int RandSeed,		// random generator seed, reads simulated with same seed are identical for any number of threads
 		char Strand,		// generate for this strand '+' or '-' or for both '*'
 		int NumReads,		// number of reads required (will be doubled if paired end reads)
 		int ReadLen,		// read lengths
@@ -108,6 +109,7 @@ bool bDedupe;				// true if unique reads only to be generated
 int DfltHamming;			// if >= 0 then the default Hamming edit distance to use
 int NumberOfProcessors;		// number of installed CPUs
 int NumThreads;				// number of threads (0 defaults to number of CPUs)
+int RandSeed;				// if > 0 then random generator seed, otherwise current time used as the seed
 bool bReadHamDist;			// true if hamming distributions from each sampled read to all other genome subsequences to be generated
 int SNPrate;				// generate SNPs at this rate per million bases
 
@@ -183,6 +185,7 @@ struct arg_file *outfile = arg_file1("o","out","<file>",		"output simulated (or
 struct arg_file *outpefile = arg_file0("O","outpe","<file>",	"output simulated (N/2) paired end reads to this file");
 struct arg_file *outsnpfile = arg_file0("u","outsnp","<file>",	"output simulated SNP loci to this BED file, if no SNP rate specified then defaults to 1000 per Mbp");
 struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
+struct arg_int *randseed = arg_int0("y","randseed","<int>",		"if > 0 then random generator seed, otherwise current time used as the seed; same seed generates same reads for any number of threads (default 0)");
 struct arg_lit  *dedupe = arg_lit0("d","dedupe",                "generate unique read sequences only");
 struct arg_int *hamming = arg_int0("e","hamming","<int>",		"if specified and < 0, then dynamically generate Hamming edit distances, otherwise use this static distance (default = static generation with Hamming 0)");
 struct arg_lit  *readhamdist = arg_lit0("r","readhamdist",      "generate hamming distribution from each simulated read to all other subsequences of same length in genome");
@@ -213,7 +216,7 @@ void *argtable[] = {help,version,FileLogLevel,LogFile,
 					indelsize,indelrate,strand,readlen,cutmin,cutmax,dedupe,hamming,featfile,
 					infile,inmnase,hammfile,outpefile,outfile,outsnpfile,summrslts,
 					experimentname,experimentdescr,
-					threads,
+					threads,randseed,
 					end};
 
 char **pAllArgs;
@@ -806,6 +809,20 @@ if (!argerrors)
 		NumThreads = MaxAllowedThreads;
 		}
 
+	RandSeed = randseed->count ? randseed->ival[0] : 0;
+	if(RandSeed <= 0)
+		{
+#ifdef _WIN32
+		INT64 Now;		
+		QueryPerformanceCounter((LARGE_INTEGER *)&Now);
+		RandSeed = (int)(Now & 0x07fffffff);
+#else
+		struct timeval TimeNow;
+		gettimeofday(&TimeNow,NULL);
+		RandSeed = (int)(TimeNow.tv_usec & 0x07fffffff);
+#endif
+		}
+
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Processing parameters:");
 
 	const char *pszDescr;
@@ -958,6 +975,7 @@ if (!argerrors)
 		}
 
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Random number generator using seed: %d",RandSeed);
 
 	if(gExperimentID > 0)
 		{
@@ -978,6 +996,7 @@ if (!argerrors)
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(DfltHamming),"hamming",&DfltHamming);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(bTrueInt),"readhamdist",bReadHamDist  == true ? &bTrueInt : &bFalseInt);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumThreads),"threads",&NumThreads);
+		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(RandSeed),"randseed",&RandSeed);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(SNPrate),"snprate",&SNPrate);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(Region),"genomicregion",&Region);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(UpDnRegLen),"updnreglen",&UpDnRegLen);
@@ -1029,7 +1048,7 @@ if (!argerrors)
 	gStopWatch.Start();
 	Rslt = Process((etPMode)PMode,SEMode,bPEgen,PEmin,PEmax,PropRandReads,
 			DistCluster,SeqErrRate,bSeqErrProfile,SNPrate,
-						InDelSize,InDelRate,bReadHamDist,(etFMode)FMode,NumThreads,Strand,NumReads,
+						InDelSize,InDelRate,bReadHamDist,(etFMode)FMode,NumThreads,RandSeed,Strand,NumReads,
 						ReadLen,Artef5Rate,NumArtef5Seqs,pszArtef5Seqs,Artef3Rate,NumArtef3Seqs,pszArtef3Seqs,
 						CutMin,CutMax,bDedupe,DfltHamming,Region,UpDnRegLen,szFeatFile,szInFile,szProfFile,szHammFile,szOutPEFile,szOutFile,szSNPFile);
 	Rslt = Rslt >=0 ? 0 : 1;
@@ -1068,6 +1087,7 @@ Process(etPMode PMode,		// processing mode
 		bool bReadHamDist,	// true if hamming distributions from each sampled read to all other genome subsequences to be generated
 		etFMode FMode,		// output format
 		int NumThreads,		// number of worker threads to use
+		int RandSeed,		// random generator seed, reads simulated with same seed are identical for any number of threads
 		char Strand,		// generate for this strand '+' or '-' or for both '*'
 		int NumReads,		// number of reads required (will be doubled if paired end reads)
 		int ReadLen,		// read lengths
@@ -1102,7 +1122,7 @@ if((pSimReads = new CSimReads) == NULL)
 
 Rslt = pSimReads->GenSimReads(PMode, SEMode, bPEgen, PEmin, PEmax, PropRandReads, DistCluster,
 		SeqErrRate,	bSeqErrProfile,	SNPrate, InDelSize,	InDelRate, bReadHamDist, FMode,
-		NumThreads,	Strand,	NumReads, ReadLen,	Artef5Rate,	NumArtef5Seqs, pszArtef5Seqs,Artef3Rate,NumArtef3Seqs,	
+		NumThreads,	RandSeed, Strand,	NumReads, ReadLen,	Artef5Rate,	NumArtef5Seqs, pszArtef5Seqs,Artef3Rate,NumArtef3Seqs,	
 		pszArtef3Seqs,	CutMin,	CutMax,	bDedupe,DfltHamming,Region,	UpDnRegLen,	pszFeatFile,pszInFile,pszProfFile,pszHammFile,pszOutPEFile,	pszOutFile,	pszOutSNPs);
 delete pSimReads;
 return(Rslt);
@@ -1562,6 +1582,12 @@ if(m_pHamDistFreq != NULL)
 	m_pHamDistFreq = NULL;
 	}
 
+if(m_pSimChunkReads != NULL)
+	{
+	delete []m_pSimChunkReads;
+	m_pSimChunkReads = NULL;
+	}
+
 m_pCurHamChrom = NULL;
 m_AllocdMemReads = 0;
 m_NumReadsAllocd = 0;
@@ -1581,6 +1607,10 @@ m_InDelRate = 0.0;				// simulated InDel rate per read
 m_PrvProfSeqLen = -1;  // set to read length for which DynErrProfile has been generated
 m_TotReqReads = 0;
 m_CurNumGenReads = 0;
+m_SimChunkBase = 0;
+m_SimChunkSize = cSimChunkSize;
+m_NumSimChunks = 0;
+m_NxtSimChunk = 0;
 m_MaxFastaLineLen = 79;
 memset(m_InducedErrDist,0,sizeof(m_InducedErrDist));	// to hold induced error count distribution
 memset(m_InducedErrPsnDist,0,sizeof(m_InducedErrPsnDist));	// to hold read sequence psn induced error count
@@ -1601,6 +1631,7 @@ m_pGenomeSeq = NULL;		// allocated to hold concatenated (separated by eBaseEOSs)
 m_pHamHdr = NULL;
 m_pCurHamChrom = NULL;
 m_pHamDistFreq = NULL;
+m_pSimChunkReads = NULL;
 Reset(false);
 }
 
@@ -2440,7 +2471,7 @@ if(pszOutSNPs != NULL && pszOutSNPs[0] != '\0')
 else
 	hFile = -1;
 
-TRandomCombined<CRandomMother,CRandomMersenne> RG((int)time(0));
+TRandomCombined<CRandomMother,CRandomMersenne> RG(m_RandSeed);
 BuffOfs = 0;
 SNPiD = 0;
 for(ChromID = 0; ChromID < m_NumChromSeqs; ChromID++,pChromSeq++)
@@ -3227,6 +3258,7 @@ CSimReads::GenSimReads(etPMode PMode,		// processing mode
 		bool bReadHamDist,	// true if hamming distributions from each sampled read to all other genome subsequences to be generated
 		etFMode FMode,		// output format
 		int NumThreads,		// number of worker threads to use
+		int RandSeed,		// random generator seed, reads simulated with same seed are identical for any number of threads
 		char Strand,		// generate for this strand '+' or '-' or for both '*'
 		int NumReads,		// number of reads required (will be 2x this number if generating paired ends)
 		int ReadLen,		// read lengths
@@ -3257,20 +3289,27 @@ int NumReadsReq;
 int ReadsCnt;
 tsWorkerPars WorkerThreads[cMaxWorkerThreads];
 tsWorkerPars *pCurThread;
-int ReadsPerThread;
 int ThreadIdx;
 bool bFirst;
 int MaxReadsPerBatch;		// process at most this number of simulated reads per batch
 int ReportedReads;			// number of reads reported on by last call to ReportReads()
 int TotReportedReads;		// total number of reads reported on by all batches processed by ReportReads()
-int ExhustedChroms;			// number of threads which exhusted attempts to find chroms from which reads can be simulated
 int CurNumGenReads;
 int PrevNumGenReads;
 int MinChromLen;
+bool bHammBatch;			// true if minimum Hamming edit distances are to be dynamically determined for batches of candidate reads
+int NumBatchReads;			// number of reads simulated in current batch
+int ChunkIdx;
+int NumChunkReads;
+int ReadIdx;
+tsSimRead *pSrcRead;
+tsSimRead *pDstRead;
+UINT32 *pHamDistFreq;
 
 Init();
 
-RGseeds.RandomInit((int)time(NULL));
+m_RandSeed = RandSeed;
+RGseeds.RandomInit(RandSeed);
 
 m_PMode = PMode;
 m_FMode = FMode;
@@ -3443,7 +3482,12 @@ else
 	else
 		MaxReadsPerBatch = min(m_TotReqReads,cMaxBatchSize);
 	}
-MaxReadsPerBatch *= NumThreads;
+
+// simulated reads are generated in chunks, each chunk with an independent random stream, so the reads simulated are the same for any number of threads
+// batches are sized as a multiple of the chunk size so that chunk boundaries, and hence random streams, are also independent of the number of threads
+bHammBatch = (bReadHamDist && PMode == ePMSampHamm) || (!bReadHamDist && !bUseLocateHamming && DfltHamming < 0);
+m_SimChunkSize = (bReadHamDist || bHammBatch) ? cSimHammChunkSize : cSimChunkSize;
+MaxReadsPerBatch = ((MaxReadsPerBatch + m_SimChunkSize - 1) / m_SimChunkSize) * m_SimChunkSize;
 
 
 // Allocate to hold all reads if bDedupe is TRUE even though they will be checkpointed, and written to disk, every cChkNumReads. This is because
@@ -3497,15 +3541,11 @@ if(bReadHamDist) {
 		pRead->pHamDistFreq = &m_pHamDistFreq[ReadIdx * (ReadLen+1)];
 	}
 
-#ifdef _WIN32
-if((m_hMtxDedupe = CreateMutex(NULL,false,NULL))==NULL)
-#else
-if(pthread_mutex_init (&m_hMtxDedupe,NULL)!=0)
-#endif
+if((m_pSimChunkReads = new int [(m_NumReadsAllocd + m_SimChunkSize - 1) / m_SimChunkSize]) == NULL)
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Fatal: unable to create mutex");
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: Memory allocation for simulated read chunks failed");
 	Reset(false);
-	return(eBSFerrInternal);
+	return(eBSFerrMem);
 	}
 
 CurNumGenReads = 0;
@@ -3513,13 +3553,15 @@ PrevNumGenReads = 0;
 ReadsOfs = 0;
 TotReportedReads = 0;
 bFirst =true;
-TRandomCombined<CRandomMother,CRandomMersenne> RGseeds((int)time(0));
+m_SimChunkBase = 0;
 do {
 	// initialise all worker thread parameters and start the threads
 	if(!bDedupe)
 		{
 		ReadsOfs = 0;
 		ReadsCnt = min((m_TotReqReads - TotReportedReads),MaxReadsPerBatch);
+		if(!(bReadHamDist || bHammBatch))	// simulating whole chunks keeps chunk boundaries independent of reads sloughed when reporting; excess reads are not reported
+			ReadsCnt = min(((ReadsCnt + m_SimChunkSize - 1) / m_SimChunkSize) * m_SimChunkSize,MaxReadsPerBatch);
 		}
 	else
 		{
@@ -3529,22 +3571,27 @@ do {
 			ReadsCnt = min((int)(((INT64)(m_TotReqReads - TotReportedReads) * 105)/100),MaxReadsPerBatch);
 		if(ReadsCnt < 10000 && (ReadsOfs + 10000) < m_NumReadsAllocd)
 			ReadsCnt = 10000;
+		ReadsCnt = min(ReadsCnt,m_NumReadsAllocd - ReadsOfs);
+		if(bPEgen)
+			ReadsCnt &= ~0x01;			// paired reads are never split across chunks
 		}
-	NumReadsReq = 0;
-	ExhustedChroms = 0;
+
+	// reads in this batch are simulated in chunks, with worker threads claiming chunks until all have been simulated
+	m_NumSimChunks = (ReadsCnt + m_SimChunkSize - 1) / m_SimChunkSize;
+	m_NxtSimChunk = 0;
+	memset(m_pSimChunkReads,0,sizeof(int) * m_NumSimChunks);
+	NumReadsReq = ReadsCnt;
 	for(ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++)
 		{
 		pCurThread = &WorkerThreads[ThreadIdx];
-		ReadsPerThread = ReadsCnt/(NumThreads-ThreadIdx);
-		ReadsCnt -= ReadsPerThread;
 		memset(pCurThread,0,sizeof(tsWorkerPars));
 		pCurThread->pThis = this;
-		pCurThread->RandSeed = RGseeds.IRandom(1,INT_MAX);
 		pCurThread->ThreadIdx = ThreadIdx;
 		pCurThread->DfltHamming = DfltHamming;
 		pCurThread->bUseLocateHamming = bUseLocateHamming;
 		pCurThread->bDedupe = bDedupe;
 		pCurThread->bReadHamDist = bReadHamDist;
+		pCurThread->bHammBatch = bHammBatch;
 		pCurThread->ReadLen = ReadLen;
 		pCurThread->Region = Region;
 		pCurThread->UpDnRegLen = UpDnRegLen;
@@ -3555,10 +3602,8 @@ do {
 		pCurThread->PEmin = PEmin;
 		pCurThread->PEmax = PEmax;
 		pCurThread->NumGenReads=0;
-		pCurThread->NumReqReads=ReadsPerThread;
-		NumReadsReq += ReadsPerThread;
+		pCurThread->NumReqReads=ReadsCnt;
 		pCurThread->pReads = &m_pSimReads[ReadsOfs];
-		ReadsOfs += ReadsPerThread;
 		pCurThread->PMode=PMode;
 		pCurThread->Strand=Strand;
 		pCurThread->bMaxIters = false;
@@ -3583,9 +3628,7 @@ do {
 #ifdef _WIN32
 		while(WAIT_TIMEOUT == WaitForSingleObject( pCurThread->threadHandle, 60000 * 10))
 			{
-			WaitForSingleObject(m_hMtxDedupe,INFINITE);
 			CurNumGenReads = m_CurNumGenReads;
-			ReleaseMutex(m_hMtxDedupe);
 			if(CurNumGenReads > (PrevNumGenReads+1))
 				{
 				gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u reads generated",CurNumGenReads);
@@ -3600,9 +3643,7 @@ do {
 		ts.tv_sec += 60 * 10;
 		while((JoinRlt = pthread_timedjoin_np(pCurThread->threadID, NULL, &ts)) != 0)
 			{
-			pthread_mutex_lock(&m_hMtxDedupe);
 			CurNumGenReads = m_CurNumGenReads;
-			pthread_mutex_unlock(&m_hMtxDedupe);
 			if(CurNumGenReads > (PrevNumGenReads+1))
 				{
 				gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u reads generated",CurNumGenReads);
@@ -3612,12 +3653,50 @@ do {
 			}
 
 #endif
-		if(pCurThread->bMaxIters)
-			ExhustedChroms += 1;
 		}
 
-	if(ExhustedChroms < NumThreads)
+	// chunks will only be short if attempts to find chroms from which reads can be simulated were exhusted
+	// close up any gaps so that simulated reads are contiguous, and in chunk order, for reporting
+	// if deduping then subsequences are marked as selected here, in chunk order, so that the reads retained are independent of thread scheduling
+	NumBatchReads = 0;
+	pDstRead = &m_pSimReads[ReadsOfs];
+	for(ChunkIdx = 0; ChunkIdx < m_NumSimChunks; ChunkIdx++)
+		{
+		pSrcRead = &m_pSimReads[ReadsOfs + (ChunkIdx * m_SimChunkSize)];
+		NumChunkReads = m_pSimChunkReads[ChunkIdx];
+		if(!bDedupe && pSrcRead == pDstRead)
+			{
+			NumBatchReads += NumChunkReads;
+			pDstRead += NumChunkReads;
+			continue;
+			}
+		for(ReadIdx = 0; ReadIdx < NumChunkReads; ReadIdx++,pSrcRead++)
+			{
+			if(bDedupe)
+				{
+				if(*pSrcRead->pSeq & SSSELECTED)	// subsequence already selected by an earlier read
+					continue;
+				*pSrcRead->pSeq |= SSSELECTED;
+				}
+			NumBatchReads += 1;
+			if(pSrcRead == pDstRead)
+				{
+				pDstRead++;
+				continue;
+				}
+			pHamDistFreq = pDstRead->pHamDistFreq;		// hamming distributions are moved along with the read
+			*pDstRead = *pSrcRead;
+			pSrcRead->pHamDistFreq = pHamDistFreq;
+			if(bPEgen)
+				pDstRead->pPartner = pDstRead->FlgPE2 ? &pDstRead[-1] : &pDstRead[1];
+			pDstRead++;
+			}
+		}
+	m_SimChunkBase += m_NumSimChunks;
+
+	if(NumBatchReads > 0)
 		{
+		ReadsOfs += NumBatchReads;
 		ReportedReads = ReportReads(bPEgen,		// true if paired end simulated reads being simulated
 		        Region,						// Hamming regional processing?
 				ReadLen,					// read length
@@ -3637,11 +3716,6 @@ do {
 	}
 while(TotReportedReads < m_TotReqReads && ReadsOfs < m_NumReadsAllocd);
 
-#ifdef _WIN32
-CloseHandle(m_hMtxDedupe);
-#else
-pthread_mutex_destroy(&m_hMtxDedupe);
-#endif
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Total simulated reads generated: %1.8d",TotReportedReads);
 
 if(m_hOutFile != -1)
@@ -3684,6 +3758,80 @@ int
 CSimReads::ThreadSimReads(void * pThreadPars)
 {
 tsWorkerPars *pWorkerPars = (tsWorkerPars *)pThreadPars;
+tsSimCandidate *pCands;
+etSeqBase *pCandSeqs;
+int CandSeqsLen;
+int CandIdx;
+int ChunkIdx;
+int NumChunkReads;
+
+// if dynamic Hamming edit distances are being determined then candidate reads are accumulated and their distances determined as a batch
+pCands = NULL;
+pCandSeqs = NULL;
+if(pWorkerPars->bHammBatch)
+	{
+	CandSeqsLen = pWorkerPars->CutMax + 1;
+	pCands = new tsSimCandidate [cSimHammScreenBatch];
+	pCandSeqs = new etSeqBase [cSimHammScreenBatch * 2 * CandSeqsLen];
+	if(pCands == NULL || pCandSeqs == NULL)
+		{
+		if(pCands != NULL)
+			delete []pCands;
+		if(pCandSeqs != NULL)
+			delete []pCandSeqs;
+		return(eBSFerrMem);
+		}
+	for(CandIdx = 0; CandIdx < cSimHammScreenBatch; CandIdx++)
+		{
+		pCands[CandIdx].pFwdSeq = &pCandSeqs[CandIdx * 2 * CandSeqsLen];
+		pCands[CandIdx].pRevSeq = &pCands[CandIdx].pFwdSeq[CandSeqsLen];
+		}
+	}
+
+pWorkerPars->NumGenReads = 0;
+pWorkerPars->bMaxIters = false;
+while(1)
+	{
+	// claim the next chunk of reads to be simulated, chunks are claimed in any order but the reads simulated into each chunk depend only on that chunk's random stream
+#ifdef _WIN32
+	ChunkIdx = InterlockedIncrement((volatile LONG *)&m_NxtSimChunk) - 1;
+#else
+	ChunkIdx = __sync_fetch_and_add(&m_NxtSimChunk,1);
+#endif
+	if(ChunkIdx >= m_NumSimChunks)
+		break;
+	NumChunkReads = SimChunkReads(pWorkerPars,ChunkIdx,pCands);
+	m_pSimChunkReads[ChunkIdx] = NumChunkReads;
+	pWorkerPars->NumGenReads += NumChunkReads;
+	}
+
+if(pCands != NULL)
+	delete []pCands;
+if(pCandSeqs != NULL)
+	delete []pCandSeqs;
+return(eBSFSuccess);
+}
+
+// ChunkRandSeed
+// Generates the random generator seed for a chunk; each chunk of simulated reads has an independent random stream determined only by the user seed and the chunk's ordinal
+int
+CSimReads::ChunkRandSeed(int RandSeed,		// user specified, or time derived, random generator seed
+			INT64 ChunkID)					// chunk ordinal over all batches
+{
+UINT64 Mix;
+Mix = ((UINT64)RandSeed << 32) ^ (UINT64)ChunkID;
+Mix += (UINT64)0x9E3779B97F4A7C15;
+Mix = (Mix ^ (Mix >> 30)) * (UINT64)0xBF58476D1CE4E5B9;
+Mix = (Mix ^ (Mix >> 27)) * (UINT64)0x94D049BB133111EB;
+Mix ^= Mix >> 31;
+return((int)(Mix & 0x07fffffff));
+}
+
+int				// number of reads simulated into chunk, will be less than chunk size only if attempts to find chroms from which reads can be simulated were exhusted
+CSimReads::SimChunkReads(tsWorkerPars *pWorkerPars,	// worker thread parameters
+			int ChunkIdx,						// simulate reads for this chunk of the current batch
+			tsSimCandidate *pCands)				// if not NULL then holds cSimHammScreenBatch candidates for batched Hamming edit distance determinations
+{
 etSeqBase ReadSeq[cMaxReadLen+1];
 etSeqBase *pReadSeq;
 etSeqBase Nuc;
@@ -3719,18 +3867,39 @@ int TargPsn;
 int IdxLo;
 int IdxHi;
 UINT64 NumChromIters;
-
+UINT64 NumRejectedCands;
+
+int ChunkReqReads;
+int ChunkGenReads;
+int NumAccepted;
+int NumCands;
+int MaxCands;
+int CandIdx;
+tsSimCandidate Cand;
+tsSimCandidate *pCand;
+
+ChunkReqReads = min(m_SimChunkSize,pWorkerPars->NumReqReads - (ChunkIdx * m_SimChunkSize));
+ChunkGenReads = 0;
+NumCands = 0;
 CurNumGenReads = 0;
 NumChromIters = 0;
-pRead = pWorkerPars->pReads;
-pRead += pWorkerPars->NumGenReads;
-pWorkerPars->bMaxIters = false;
-TRandomCombined<CRandomMother,CRandomMersenne> RG(pWorkerPars->RandSeed);
-while(pWorkerPars->NumGenReads < pWorkerPars->NumReqReads)
+NumRejectedCands = 0;
+pRead = &pWorkerPars->pReads[ChunkIdx * m_SimChunkSize];
+TRandomCombined<CRandomMother,CRandomMersenne> RG(ChunkRandSeed(m_RandSeed,m_SimChunkBase + ChunkIdx));
+while(ChunkGenReads < ChunkReqReads)
 	{
-	if(NumChromIters++ > ((UINT64)m_NumChromSeqs * 50))
+	if(NumChromIters++ > ((UINT64)m_NumChromSeqs * 50) || NumRejectedCands > ((UINT64)m_NumChromSeqs * 50))
 		{
-		pWorkerPars->bMaxIters = true;			// flag this thread is terminating because it has exhusted attempts to find chrom from which read can be simulated
+		if(NumCands)							// candidates already batched are not dropped
+			{
+			NumAccepted = AcceptSimCands(pWorkerPars,NumCands,pCands,pRead,&CandIdx);
+			pRead += NumAccepted;
+			ChunkGenReads += NumAccepted;
+			CurNumGenReads += CandIdx;
+			NumCands = 0;
+			}
+		if(ChunkGenReads < ChunkReqReads)
+			pWorkerPars->bMaxIters = true;			// flag this chunk was terminated because attempts to find chrom from which read can be simulated were exhusted
 		break;
 		}
 		// first randomly choose chromosome
@@ -3963,15 +4132,39 @@ while(pWorkerPars->NumGenReads < pWorkerPars->NumReqReads)
 			continue;
 		}
 
-	if(pWorkerPars->bReadHamDist)
+	pCand = pCands == NULL ? &Cand : &pCands[NumCands];
+	pCand->pChromSeq = pChromSeq;
+	pCand->RandStrand = RandStrand;
+	pCand->RandCutSite1 = RandCutSite1;
+	pCand->RandCutSite2 = RandCutSite2;
+	pCand->RandCutLen = RandCutLen;
+	pCand->PERandStrand = PERandStrand;
+	pCand->PERandCutSite1 = PERandCutSite1;
+	pCand->PERandCutSite2 = PERandCutSite2;
+	pCand->PERandCutLen = PERandCutLen;
+
+	if(pCands != NULL)
 		{
-		if(m_PMode == ePMSampHamm)
-			{
-			HammingDistW = MinHammingDistW(pWorkerPars->ReadLen,pWorkerPars->ReadLen,pChromSeq->ChromID,RandCutSite1,ReadSeq);
-			CSeqTrans::ReverseComplement(RandCutLen,ReadSeq);
-			HammingDist = MinHammingDistC(HammingDistW,pWorkerPars->ReadLen,pChromSeq->ChromID,RandCutSite1,ReadSeq);
-			}
-		else
+		// batching dynamic Hamming determinations, the genome is scanned once for all candidates in the batch
+		memcpy(pCand->pFwdSeq,ReadSeq,RandCutLen + 1);
+		memcpy(pCand->pRevSeq,ReadSeq,RandCutLen + 1);
+		CSeqTrans::ReverseComplement(RandCutLen,pCand->pRevSeq);
+		NumCands += 1;
+		NumChromIters = 0;						// attempts to find chroms are limited per candidate, not per batch of candidates
+		MaxCands = min(cSimHammScreenBatch,(ChunkReqReads - ChunkGenReads) / (pWorkerPars->bPEgen ? 2 : 1));
+		if(NumCands < MaxCands)
+			continue;
+
+		NumAccepted = AcceptSimCands(pWorkerPars,NumCands,pCands,pRead,&CandIdx);
+		pRead += NumAccepted;
+		ChunkGenReads += NumAccepted;
+		CurNumGenReads += CandIdx;
+		NumRejectedCands = CandIdx ? 0 : NumRejectedCands + NumCands;	// batches with all candidates rejected are also limited
+		NumCands = 0;
+		}
+	else
+		{
+		if(pWorkerPars->bReadHamDist)
 			{
 			memset(pRead->pHamDistFreq,0,sizeof(UINT32) * (pWorkerPars->ReadLen + 1));
 			HammingDistW = HammingDistCntsW(pWorkerPars->ReadLen,pChromSeq->ChromID,RandCutSite1,ReadSeq,pRead->pHamDistFreq);
@@ -3980,124 +4173,281 @@ while(pWorkerPars->NumGenReads < pWorkerPars->NumReqReads)
 			if(HammingDistW < HammingDist)
 				HammingDist = HammingDistW;
 			}
-		}
-	else
-		{
-		if(pWorkerPars->bUseLocateHamming)
-			{
-			HammingDist = LocateHamming(pChromSeq->szChromName,RandCutSite1);
-			if(HammingDist < 0)	// need to tighten up on this: -1 returned if no such chromosome or no hamming for subsequence at specified loci
-				continue;		// in this experimental release these chroms are simply sloughed
-			}
 		else
 			{
-			if(pWorkerPars->DfltHamming < 0)
+			if(pWorkerPars->bUseLocateHamming)
 				{
-				// now determine the minimal Hamming distance of this sequence from any other sequence in the targeted genome
-				// on both the watson and crick strands
-				// Dynamic Hamming distance determination is an extremely slow process, how to speed it up?????
-				// small speedup by setting initial hamming to be readlen/2. With length 36, currently the largest actual hamming observed
-				// was around 14
-				HammingDistW = MinHammingDistW(pWorkerPars->ReadLen/2,pWorkerPars->ReadLen,pChromSeq->ChromID,RandCutSite1,ReadSeq);
-				CSeqTrans::ReverseComplement(RandCutLen,ReadSeq);
-				HammingDist = MinHammingDistC(HammingDistW,pWorkerPars->ReadLen,pChromSeq->ChromID,RandCutSite1,ReadSeq);
+				HammingDist = LocateHamming(pChromSeq->szChromName,RandCutSite1);
+				if(HammingDist < 0)	// need to tighten up on this: -1 returned if no such chromosome or no hamming for subsequence at specified loci
+					continue;		// in this experimental release these chroms are simply sloughed
 				}
 			else
 				HammingDist = pWorkerPars->DfltHamming;
+			if(pWorkerPars->bDedupe && HammingDist == 0)
+				continue;
 			}
-		if(pWorkerPars->bDedupe && HammingDist == 0)
+		pCand->HammingDist = HammingDist;
+		if((NumAccepted = AcceptSimRead(pWorkerPars,pCand,pRead)) == 0)
 			continue;
+		pRead += NumAccepted;
+		ChunkGenReads += NumAccepted;
+		CurNumGenReads += 1;
+		NumChromIters = 0;
 		}
 
-
-	// we have a sequence starting at RandCutSite1 and ending at RandCutSite2-1 which is of length RandCutLen
-	// if non-duplicates required then mark subsequence as selected
-	if(pWorkerPars->bDedupe)
+	// time to let main thread know that some progress is being made?
+	if(pWorkerPars->bReadHamDist == true || pWorkerPars->bHammBatch || CurNumGenReads >= 500)
 		{
-		pSeqSite = &pSeq[RandCutSite1];
-#ifdef _WIN32
-		WaitForSingleObject(m_hMtxDedupe,INFINITE);
-#else
-		pthread_mutex_lock(&m_hMtxDedupe);
-#endif
-		if(*pSeqSite & SSSELECTED)	// check if this subsequence already selected
-			{
 #ifdef _WIN32
-			ReleaseMutex(m_hMtxDedupe);
+		InterlockedExchangeAdd((volatile LONG *)&m_CurNumGenReads,CurNumGenReads);
 #else
-			pthread_mutex_unlock(&m_hMtxDedupe);
+		__sync_fetch_and_add(&m_CurNumGenReads,CurNumGenReads);
 #endif
-			continue;
-			}
-		*pSeqSite |= SSSELECTED;
+		CurNumGenReads = 0;
+		}
+	}
+if(CurNumGenReads)
+	{
 #ifdef _WIN32
-		ReleaseMutex(m_hMtxDedupe);
+	InterlockedExchangeAdd((volatile LONG *)&m_CurNumGenReads,CurNumGenReads);
 #else
-		pthread_mutex_unlock(&m_hMtxDedupe);
+	__sync_fetch_and_add(&m_CurNumGenReads,CurNumGenReads);
 #endif
-		}
+	}
+return(ChunkGenReads);
+}
 
-	pRead->Status = 0;
-	pRead->ChromSeqID = pChromSeq->ChromSeqID;
-	pRead->ChromID = pChromSeq->ChromID;
-	pRead->Strand = RandStrand;
-	pRead->StartLoci = RandCutSite1;
-	pRead->EndLoci = RandCutSite2 - 1;
-	pRead->Len = RandCutLen;
-	pRead->HammingDist = HammingDist;
-	pRead->pSeq = &pSeq[RandCutSite1];
-	pWorkerPars->NumGenReads += 1;
-	pRead->FlgPE2 = 0;
-	if(pWorkerPars->bPEgen)
-		pRead->pPartner = &pRead[1];
-	else
-		pRead->pPartner = NULL;
-	pRead += 1;
+int				// number of reads (paired ends counted as 2) accepted into pRead
+CSimReads::AcceptSimCands(tsWorkerPars *pWorkerPars,	// worker thread parameters
+				int NumCands,					// number of batched candidate reads
+				tsSimCandidate *pCands,			// batched candidates for which Hamming edit distances are to be determined
+				tsSimRead *pRead,				// accept into reads starting with this read
+				int *pNumAccepted)				// returned number of candidates accepted
+{
+tsSimCandidate *pCand;
+int CandIdx;
+int NumAccepted;
+int NumReads;
+
+NumReads = 0;
+*pNumAccepted = 0;
+MinHammingDists(NumCands,pWorkerPars->ReadLen,pWorkerPars->bReadHamDist ? pWorkerPars->ReadLen : pWorkerPars->ReadLen/2,pCands);
+for(CandIdx = 0; CandIdx < NumCands; CandIdx++)
+	{
+	pCand = &pCands[CandIdx];
+	if(!pWorkerPars->bReadHamDist && pWorkerPars->bDedupe && pCand->HammingDist == 0)
+		continue;
+	if((NumAccepted = AcceptSimRead(pWorkerPars,pCand,pRead)) == 0)
+		continue;
+	pRead += NumAccepted;
+	NumReads += NumAccepted;
+	*pNumAccepted += 1;
+	}
+return(NumReads);
+}
 
-	if(pWorkerPars->bPEgen)
+int				// number of reads (2 if paired end) accepted into pRead, 0 if not accepted because subsequence already selected when deduping
+CSimReads::AcceptSimRead(tsWorkerPars *pWorkerPars,	// worker thread parameters
+				tsSimCandidate *pCand,			// candidate read
+				tsSimRead *pRead)				// accept into this read (and pRead[1] if paired end)
+{
+etSeqBase *pSeq;
+etSeqBase *pSeqSite;
+
+pSeq = &m_pGenomeSeq[pCand->pChromSeq->SeqOfs];
+
+// we have a sequence starting at RandCutSite1 and ending at RandCutSite2-1 which is of length RandCutLen
+// if non-duplicates required then subsequences selected by reads in preceding batches are sloughed; subsequences selected by reads
+// in the current batch are marked by the main thread, in chunk order, once all chunks in the batch have been simulated
+if(pWorkerPars->bDedupe)
+	{
+	pSeqSite = &pSeq[pCand->RandCutSite1];
+	if(*pSeqSite & SSSELECTED)	// check if this subsequence already selected
+		return(0);
+	}
+
+pRead->Status = 0;
+pRead->ChromSeqID = pCand->pChromSeq->ChromSeqID;
+pRead->ChromID = pCand->pChromSeq->ChromID;
+pRead->Strand = pCand->RandStrand;
+pRead->StartLoci = pCand->RandCutSite1;
+pRead->EndLoci = pCand->RandCutSite2 - 1;
+pRead->Len = pCand->RandCutLen;
+pRead->HammingDist = pCand->HammingDist;
+pRead->pSeq = &pSeq[pCand->RandCutSite1];
+pRead->FlgPE2 = 0;
+if(!pWorkerPars->bPEgen)
+	{
+	pRead->pPartner = NULL;
+	return(1);
+	}
+
+pRead->pPartner = &pRead[1];
+pRead += 1;
+pRead->pPartner = &pRead[-1];
+pRead->FlgPE2 = 1;
+pRead->Status = 0;
+pRead->ChromSeqID = pCand->pChromSeq->ChromSeqID;
+pRead->ChromID = pCand->pChromSeq->ChromID;
+pRead->Strand = pCand->PERandStrand;
+pRead->StartLoci = pCand->PERandCutSite1;
+pRead->EndLoci = pCand->PERandCutSite2 - 1;
+pRead->Len = pCand->PERandCutLen;
+pRead->HammingDist = pCand->HammingDist;
+pRead->pSeq = &pSeq[pRead->StartLoci];
+return(2);
+}
+
+// CntHammingWord
+// Returns number of mismatches flagged in a word of 2bit packed base comparisons; flags are in the low bit of each 2bit base
+static inline int
+CntHammingWord(UINT64 Mismatches)
+{
+Mismatches = (Mismatches & 0x3333333333333333) + ((Mismatches >> 2) & 0x3333333333333333);
+Mismatches = (Mismatches + (Mismatches >> 4)) & 0x0f0f0f0f0f0f0f0f;
+return((int)((Mismatches * 0x0101010101010101) >> 56));
+}
+
+// MinHammingDists
+// Batched equivalent of MinHammingDistW() followed by MinHammingDistC() for each candidate; the genome is scanned once with each subsequence
+// compared against all candidates yet to reach a Hamming of 0, rather than the genome being scanned twice for every candidate
+// Subsequences and candidates are 2bit packed, 32 bases per word, so mismatches are counted a word at a time
+void
+CSimReads::MinHammingDists(int NumCands,		// number of candidate reads (at most cSimHammScreenBatch)
+			int ReadLen,						// Hamming distances are over this many bases
+			int MinHamming,						// initial minimum Hamming distance
+			tsSimCandidate *pCands)				// candidates, returned with HammingDist set to minimum of Watson and Crick Hamming distances
+{
+int ChromIdx;
+int SeqIdx;
+int ChromSeqIdx;
+int CurHamming;
+int EndIdx;
+int CandIdx;
+int NumActive;
+int NumWords;
+int WordIdx;
+int WordBases;
+int LastWordBases;
+UINT64 Base;
+UINT64 Diffs;
+UINT64 *pWords;
+UINT64 *pWinBases;
+UINT64 *pWinNs;
+UINT64 *pFwdWords;
+UINT64 *pRevWords;
+tsChromSeq *pChrom;
+etSeqBase *pChromSeq;
+tsSimCandidate *pCand;
+tsSimCandidate *pActive[cSimHammScreenBatch];
+UINT64 *pActiveWords[cSimHammScreenBatch];
+
+NumActive = 0;
+for(CandIdx = 0; CandIdx < NumCands; CandIdx++)
+	{
+	pCands[CandIdx].HammingDist = MinHamming > 0 ? MinHamming : 0;
+	if(MinHamming > 0)
+		pActive[NumActive++] = &pCands[CandIdx];
+	}
+if(NumActive == 0)
+	return;
+
+NumWords = (ReadLen + 31) / 32;
+LastWordBases = ReadLen - ((NumWords - 1) * 32);
+pWords = new UINT64 [(2 + (NumCands * 2)) * NumWords];	// genome subsequence bases and 'N's, then each candidate's Watson and Crick bases
+memset(pWords,0,sizeof(UINT64) * (2 + (NumCands * 2)) * NumWords);
+pWinBases = pWords;
+pWinNs = &pWords[NumWords];
+for(CandIdx = 0; CandIdx < NumActive; CandIdx++)
+	{
+	pActiveWords[CandIdx] = pFwdWords = &pWords[(2 + (CandIdx * 2)) * NumWords];
+	pRevWords = &pFwdWords[NumWords];
+	for(SeqIdx = 0; SeqIdx < ReadLen; SeqIdx++)
 		{
-		pRead->pPartner = &pRead[-1];
-		pRead->FlgPE2 = 1;
-		pRead->Status = 0;
-		pRead->ChromSeqID = pChromSeq->ChromSeqID;
-		pRead->ChromID = pChromSeq->ChromID;
-		pRead->Strand = PERandStrand;
-		pRead->StartLoci = PERandCutSite1;
-		pRead->EndLoci = PERandCutSite2 - 1;
-		pRead->Len = PERandCutLen;
-		pRead->HammingDist = HammingDist;
-		pRead->pSeq = &pSeq[pRead->StartLoci];
-		pWorkerPars->NumGenReads += 1;
-		pRead += 1;
+		pFwdWords[SeqIdx / 32] |= (UINT64)(pActive[CandIdx]->pFwdSeq[SeqIdx] & 0x03) << (2 * (SeqIdx % 32));
+		pRevWords[SeqIdx / 32] |= (UINT64)(pActive[CandIdx]->pRevSeq[SeqIdx] & 0x03) << (2 * (SeqIdx % 32));
 		}
+	}
 
-	CurNumGenReads += 1;
-	NumChromIters = 0;
+pChrom = &m_pChromSeqs[0];
+for(ChromIdx = 0; NumActive > 0 && ChromIdx < m_NumChromSeqs; ChromIdx++, pChrom++)
+	{
+	pChromSeq =  &m_pGenomeSeq[pChrom->SeqOfs];
+	EndIdx = pChrom->Len - ReadLen;
+	if(EndIdx < 0)
+		continue;
 
-	// time to let main thread know that some progress is being made?
-	if(pWorkerPars->bReadHamDist == true || CurNumGenReads >= 500)
+	// pack the initial subsequence, thereafter the packed subsequence is rolled along the chrom a base at a time
+	memset(pWinBases,0,sizeof(UINT64) * NumWords * 2);
+	for(SeqIdx = 0; SeqIdx < ReadLen; SeqIdx++)
 		{
-#ifdef _WIN32
-		WaitForSingleObject(m_hMtxDedupe,INFINITE);
-#else
-		pthread_mutex_lock(&m_hMtxDedupe);
-#endif
+		if((Base = (pChromSeq[SeqIdx] & NUCONLYMSK)) > eBaseT)
+			pWinNs[SeqIdx / 32] |= (UINT64)0x01 << (2 * (SeqIdx % 32));	// 'N's never match
+		else
+			pWinBases[SeqIdx / 32] |= Base << (2 * (SeqIdx % 32));
+		}
 
-		m_CurNumGenReads += CurNumGenReads;
-		CurNumGenReads = 0;
-#ifdef _WIN32
-		ReleaseMutex(m_hMtxDedupe);
-#else
-		pthread_mutex_unlock(&m_hMtxDedupe);
-#endif
+	for(ChromSeqIdx=0; NumActive > 0 && ChromSeqIdx <= EndIdx; ChromSeqIdx++)
+		{
+		if(ChromSeqIdx > 0)
+			{
+			for(WordIdx = 0; WordIdx < NumWords; WordIdx++)
+				{
+				WordBases = WordIdx == NumWords - 1 ? LastWordBases : 32;
+				pWinBases[WordIdx] >>= 2;
+				pWinNs[WordIdx] >>= 2;
+				if((Base = (pChromSeq[ChromSeqIdx + (WordIdx * 32) + WordBases - 1] & NUCONLYMSK)) > eBaseT)
+					pWinNs[WordIdx] |= (UINT64)0x01 << (2 * (WordBases - 1));
+				else
+					pWinBases[WordIdx] |= Base << (2 * (WordBases - 1));
+				}
+			}
+
+		for(CandIdx = 0; CandIdx < NumActive; CandIdx++)
+			{
+			pCand = pActive[CandIdx];
+			pFwdWords = pActiveWords[CandIdx];
+			pRevWords = &pFwdWords[NumWords];
+
+			// Watson, checking for self-loci otherwise hamming would always be 0!
+			if(!(ChromSeqIdx == pCand->RandCutSite1 && pChrom->ChromID == pCand->pChromSeq->ChromID))
+				{
+				CurHamming = 0;
+				for(WordIdx = 0; WordIdx < NumWords; WordIdx++)
+					{
+					Diffs = pWinBases[WordIdx] ^ pFwdWords[WordIdx];
+					if((CurHamming += CntHammingWord(((Diffs | (Diffs >> 1)) & 0x5555555555555555) | pWinNs[WordIdx])) >= pCand->HammingDist)
+						break;
+					}
+				if(CurHamming < pCand->HammingDist)
+					pCand->HammingDist = CurHamming;
+				}
+
+			// Crick, no check for self-loci
+			if(pCand->HammingDist > 0)
+				{
+				CurHamming = 0;
+				for(WordIdx = 0; WordIdx < NumWords; WordIdx++)
+					{
+					Diffs = pWinBases[WordIdx] ^ pRevWords[WordIdx];
+					if((CurHamming += CntHammingWord(((Diffs | (Diffs >> 1)) & 0x5555555555555555) | pWinNs[WordIdx])) >= pCand->HammingDist)
+						break;
+					}
+				if(CurHamming < pCand->HammingDist)
+					pCand->HammingDist = CurHamming;
+				}
+
+			if(pCand->HammingDist == 0)		// can't get any lower so no need to continue comparing this candidate
+				{
+				NumActive -= 1;
+				pActive[CandIdx] = pActive[NumActive];
+				pActiveWords[CandIdx] = pActiveWords[NumActive];
+				CandIdx -= 1;
+				}
+			}
 		}
 	}
-#ifdef _WIN32
-_endthreadex(0);
-return(eBSFSuccess);
-#else
-pthread_exit(NULL);
-#endif
+delete []pWords;
 }
 
 
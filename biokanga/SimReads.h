@@ -24,9 +24,14 @@ const int cMaxPEFragLen     = 100000;	// paired end maximum fragment length
 
 const int cMaxDistClusterLen = 300;		// max clustered read bin size
 
-const int cMaxHammingBatchSize = 5000;	// max number of dynamic Hamming reads to simulate per thread before checkpointing to disk
-const int cMaxProfileBatchSize = 500000;  // max number of end profiled reads to simulate per thread before checkpointing to disk
-const int cMaxBatchSize = 5000000;		// max number of defaulted Hamming and non-profiled reads to simulate per thread before checkpointing to disk
+// batch sizes are independent of the number of worker threads so that the reads simulated for a given seed are the same for any number of threads
+const int cMaxHammingBatchSize = 32768;	// max number of dynamic Hamming reads to simulate per batch before checkpointing to disk
+const int cMaxProfileBatchSize = 500000;  // max number of end profiled reads to simulate per batch before checkpointing to disk
+const int cMaxBatchSize = 5000000;		// max number of defaulted Hamming and non-profiled reads to simulate per batch before checkpointing to disk
+
+const int cSimChunkSize = 10000;		// worker threads claim batch reads to simulate in chunks of this many reads, each chunk has an independent random stream
+const int cSimHammChunkSize = 128;		// chunk size if Hamming edit distances are being dynamically determined
+const int cSimHammScreenBatch = 32;		// dynamically determine Hamming edit distances for batches of this many candidate reads with a single scan of the genome
 
 #define NUCONLYMSK (~cRptMskFlg & 0x0f)	// hiorder bits used as attributes - bit 5 used to flag subsequence already selected
 #define SSSELECTED 0x010				// used as an attribute to flag subsequence starting this loci already selected
@@ -146,26 +151,41 @@ typedef struct TAG_sWorkerPars {
 	pthread_t threadID;		// identifier as set by pthread_create ()
 #endif
     int Rslt;				// processing result code
-	int RandSeed;			// random generator seed for this worker
 	etPMode PMode;			// processing mode
 	int Region;				//  Process regions 0:ALL,1:CDS,2:5'UTR,3:3'UTR,4:Introns,5:5'US,6:3'DS,7:Intergenic (default = ALL)
 	int UpDnRegLen;			// if processing regions then up/down stream regulatory length
-	int NumReqReads;		// number of reads to be generated by this worker thread
-	int NumGenReads;		// number of actually generated reads
+	int NumReqReads;		// number of reads to be generated in current batch by all worker threads
+	int NumGenReads;		// number of reads actually generated by this worker thread
 	int DfltHamming;		// if < 0 then dynamically determine Hamming distance otherwise use this value as the Hamming
 	bool bUseLocateHamming; // if true then call LocateHamming() using distances from file instead of dynamically generating Hammings
 	bool bDedupe;			// if true then slough any reads with a Hamming of 0
 	bool bReadHamDist;		// true if hamming distributions from each sampled read to all other genome subsequences to be generated
+	bool bHammBatch;		// true if minimum Hamming edit distances are to be dynamically determined for batches of candidate reads
 	int ReadLen;			// read length
 	int CutMin;				// min cut length
 	int CutMax;				// max cut length
 	char Strand;			// generate for this strand '+' or '-' or for both '*'
 	bool bPEgen;			// true if paired ends are to be generated
-	bool bMaxIters;			// set true by thread if exhusted attempts to find chrom from which reads can be simulated
+	bool bMaxIters;			// set true by thread if exhusted attempts, in any chunk, to find chrom from which reads can be simulated
 	int PEmin;				// PE minimum fragment
 	int PEmax;				// PE maximum fragment
-	tsSimRead *pReads;		// to hold all reads generated by this worker thread - will have been preallocated to hold NumReqReads
+	tsSimRead *pReads;		// to hold all reads generated in current batch, chunk N reads start at pReads[N * chunk size] - will have been preallocated to hold NumReqReads
 } tsWorkerPars;
+
+typedef struct TAG_sSimCandidate {
+	tsChromSeq *pChromSeq;	// candidate read is on this chrom
+	int RandStrand;			// 0 if '+', 1 if '-'
+	int RandCutSite1;		// read starts at this loci
+	int RandCutSite2;		// and ends immediately before this loci
+	int RandCutLen;			// read length
+	int PERandStrand;		// if paired end then partner read strand
+	int PERandCutSite1;		// partner starts at this loci
+	int PERandCutSite2;		// and ends immediately before this loci
+	int PERandCutLen;		// partner read length
+	int HammingDist;		// read is at least this hamming distance from any other sequence of same length in targeted genome
+	etSeqBase *pFwdSeq;		// if batching Hamming determinations then read sequence
+	etSeqBase *pRevSeq;		// and its reverse complement
+} tsSimCandidate;
 #pragma pack()
 
 class CSimReads
@@ -221,6 +241,12 @@ class CSimReads
 	int m_NumReadsAllocd;			// this many reads have been allocated for in m_pSimReads
 	int m_TotReqReads;				// number of reads required to be simulated - will be 2x user requested number if simulating paired end reads
 	int m_CurNumGenReads;			// current number of generated reads - updated every N reads generated by worker threads
+	int m_RandSeed;					// random generator seed, each chunk's random stream is derived from this seed and the chunk ordinal
+	INT64 m_SimChunkBase;			// ordinal, over all batches, of the first chunk in current batch
+	int m_SimChunkSize;				// batch reads are simulated in chunks of this many reads
+	int m_NumSimChunks;				// number of chunks in current batch
+	int m_NxtSimChunk;				// next chunk to be claimed by a worker thread
+	int *m_pSimChunkReads;			// number of reads actually simulated into each chunk of current batch
 	UINT32 *m_pHamDistFreq;			// allocated to hold hamming distance counts from one read to all other genome subsequences
 
 	int m_MaxFastaLineLen;			// wrap sequences in multifasta output files if line is longer than this many bases
@@ -234,14 +260,34 @@ class CSimReads
 	int // number of substitutions inplace induced into this read
 		SimSeqRand(int SeqLen,etSeqBase *pRead);
 
-#ifdef _WIN32
-	HANDLE m_hMtxDedupe;
-#else
-	pthread_mutex_t m_hMtxDedupe;
-#endif
 
 	static int SortSimReads(const void *arg1, const void *arg2);
 
+	static int ChunkRandSeed(int RandSeed,		// user specified, or time derived, random generator seed
+				INT64 ChunkID);					// chunk ordinal over all batches
+
+	int				// number of reads simulated into chunk
+		SimChunkReads(tsWorkerPars *pWorkerPars,	// worker thread parameters
+				int ChunkIdx,					// simulate reads for this chunk of the current batch
+				tsSimCandidate *pCands);		// if not NULL then holds cSimHammScreenBatch candidates for batched Hamming edit distance determinations
+
+	int				// number of reads (2 if paired end) accepted into pRead, 0 if not accepted because subsequence already selected when deduping
+		AcceptSimRead(tsWorkerPars *pWorkerPars,	// worker thread parameters
+				tsSimCandidate *pCand,			// candidate read
+				tsSimRead *pRead);				// accept into this read (and pRead[1] if paired end)
+
+	int				// number of reads (paired ends counted as 2) accepted into pRead
+		AcceptSimCands(tsWorkerPars *pWorkerPars,	// worker thread parameters
+				int NumCands,					// number of batched candidate reads
+				tsSimCandidate *pCands,			// batched candidates for which Hamming edit distances are to be determined
+				tsSimRead *pRead,				// accept into reads starting with this read
+				int *pNumAccepted);				// returned number of candidates accepted
+
+	void MinHammingDists(int NumCands,			// number of candidate reads (at most cSimHammScreenBatch)
+				int ReadLen,					// Hamming distances are over this many bases
+				int MinHamming,					// initial minimum Hamming distance
+				tsSimCandidate *pCands);		// candidates, returned with HammingDist set to minimum of Watson and Crick Hamming distances
+
 public:
 	CSimReads();
 	~CSimReads();
@@ -269,6 +315,7 @@ public:
 				bool bReadHamDist,	// true if hamming distributions from each sampled read to all other genome subsequences to be generated
 				etFMode FMode,		// output format
 				int NumThreads,		// number of worker threads to use
+				int RandSeed,		// random generator seed, reads simulated with same seed are identical for any number of threads
 				char Strand,		// generate for this strand '+' or '-' or for both '*'
 				int NumReads,		// number of reads required (will be 2x this number if generating paired ends)
 				int ReadLen,		// read lengths
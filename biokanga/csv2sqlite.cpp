@@ -27,6 +27,7 @@
 
 #include "biokanga.h"
 
+#include "./SQLiteBulk.h"
 #include "./SQLiteMarkers.h"
 #include "./SQLiteDE.h"
 
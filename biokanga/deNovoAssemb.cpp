@@ -133,6 +133,7 @@ CdeNovoAssemb::AssembReads(etdeNovoPMode PMode,		// processing mode, currently e
 {
 int Rslt;
 int CurPass;				// incremented every merge pass over sequences
+int PhaseID;				// telemetry phase identifier for current merge pass as returned by gSQLiteSummaries.StartPhase()
 int CurMinReqPEPrimOverlap;	// if primary probe is overlapping onto a PE then the initial primary overlap (onto PE1 or PE2) must be of at least this length
 int CurMinReqPESecOverlap;	// if primary probe was overlapping onto a PE then the secondary probe overlap (onto PE1 or PE2) must be of at least this length
 int CurMinReqPESumOverlap;	// if primary probe was overlapping onto a PE then the sum of the PE1 and PE2 overlap must be of at least this length
@@ -366,6 +367,13 @@ while(m_Sequences.NumSeqs2Assemb) {
 		break;
 
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"AssembReads: Starting pass %d allowing %d substitutions per overlapping Kbp, overlap end primer %d substitutions, processing total of %u sequences with total length %llu...",CurPass,AllowedSubsKbp,AllowedEnd12Subs,m_Sequences.NumSeqs2Assemb,m_Sequences.Seqs2AssembLen);
+	PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"AssembPass") : 0;
+	if(PhaseID > 0)
+		{
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"Pass",CurPass);
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"Seqs2Assemb",m_Sequences.NumSeqs2Assemb);
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"Seqs2AssembLen",(INT64)m_Sequences.Seqs2AssembLen);
+		}
 	if(bProcPE)
 		gDiagnostics.DiagOut(eDLInfo,gszProcName,"AssembReads: MinReqPEPrimOverlap: %d, MinReqPESecOverlap: %d, MinReqPESumOverlap: %d, MinReqSEPrimOverlap :%d, MinPEMergeOverlap: %d, MinReqPESepDist: %d, MaxReqPESepDist: %d",
 								CurMinReqPEPrimOverlap,CurMinReqPESecOverlap,CurMinReqPESumOverlap,CurMinReqSEPrimOverlap,CurMinPEMergeOverlap,m_MinReqPESepDist,m_MaxReqPESepDist);
@@ -442,6 +450,11 @@ while(m_Sequences.NumSeqs2Assemb) {
 		return((teBSFrsltCodes)Rslt);
 
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"AssembReads: Generated %d partial merges resulting in total sequence length %lld ...",m_NumPartialSeqs2Assemb,m_Sequences.Seqs2AssembLen);	// report number of newly merged sequences
+	if(PhaseID > 0)
+		{
+		gSQLiteSummaries.AddPhaseSample(PhaseID,"PartialMerges",m_NumPartialSeqs2Assemb);
+		gSQLiteSummaries.EndPhase(PhaseID);
+		}
 	// what percentage of sequences were merged in current pass - this percentage is used to determine if the thresholds should be relaxed
 	MergedPercentage = 100.0 * ((double)(PrevNumSeqs2Assemb - m_Sequences.NumSeqs2Assemb) / (double)PrevNumSeqs2Assemb);
 	if(MergedPercentage < 0.0)		// possible if too many overlength PEs are being classified as SE relative to sequences merged
@@ -732,20 +745,7 @@ void *pAllocd;
 memreq = ((15 * m_Sequences.Seqs2AssembOfs * sizeof(tSeqWrd4))/10);		// 50% to allow for a subsequent increase, unlikely but if SE converted to PEs then could happen
 if((memreq * 2) < m_Sequences.AllocMemSeqs2Assemb)
 	{
-#ifdef _WIN32
-	pAllocd = realloc(m_Sequences.pSeqs2Assemb,memreq);
-#else
-	pAllocd = mremap(m_Sequences.pSeqs2Assemb,m_Sequences.AllocMemSeqs2Assemb,memreq,MREMAP_MAYMOVE);
-	if(pAllocd == MAP_FAILED)
-		pAllocd = NULL;
-#endif
-	if(pAllocd == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CombinePartialsWithUnmerged: Memory re-allocation to %d bytes - %s",memreq,strerror(errno));
-		Reset(false);
-		return(eBSFerrMem);
-		}
-
+	pAllocd = m_Seqs2AssembArena.Shrink(memreq);
 	m_Sequences.pSeqs2Assemb = pAllocd;
 	m_Sequences.AllocMemSeqs2Assemb = (UINT64)memreq;
 	}
@@ -782,6 +782,7 @@ void * ThreadedOverlapExtend(void * pThreadPars)
 int Rslt = 0;
 tsThreadOverlapExtendPars *pPars = (tsThreadOverlapExtendPars *)pThreadPars; // makes it easier not having to deal with casts!
 CdeNovoAssemb *pThis = (CdeNovoAssemb *)pPars->pThis;
+CNUMATopology::PinWorker(pPars->ThreadIdx - 1);
 Rslt = pThis->ProcOverlapExtend(pPars);
 pPars->Rslt = Rslt;
 #ifdef _WIN32
@@ -26,11 +26,13 @@
 
 
 const int cMaxExtractDescrs = 20;					// at most this number of extraction descriptors can be processed
+const int cMaxWorkerThreads = 128;					// limiting max number of threads to this many
 
 int
 fastaextractproc(int PMode,				// processing mode - 0 by matching descriptor, 1 subsample by selecting every Nth sequence
 		int NthSel,						// if > 0 then select every Nth descriptor.sequence to be extracted
 		int XSense,						// extraction sense - 0 - original sense, 1 - reverse only, 2 - complement only 3 - reverse complement
+		int NumThreads,					// if input file is to be indexed then use at most this many threads
 		int NumDescrs,					// number of descriptors
 		char *pszDescrs[],				// extract sequences with these descriptors
 		char *pszInFasta,				// extract from this multifasta file
@@ -59,6 +61,8 @@ int Rslt = 0;   			// function result code >= 0 represents success, < 0 on failu
 int PMode;					// processing mode
 int NthSel;					// select every Nth sequence
 int XSense;					// extraction sense - 0 - original sense, 1 - reverse only, 2 - complement only 3 - reverse complement
+int NumberOfProcessors;		// number of installed CPUs
+int NumThreads;				// number of threads (0 defaults to number of CPUs)
 
 char szInFile[_MAX_PATH];		// read from this file
 char szOutFile[_MAX_PATH];		// write extracted sequences to this file
@@ -83,6 +87,7 @@ struct arg_file *inputfile = arg_file1("i","in","<file>",		"Input file containin
 struct arg_file *outfile = arg_file1("o","out","<file>",		"Output extracted sequences to this file");
 
 struct arg_int *xsense = arg_int0("x","xsense","<int>",           "Extracted sequences as: 0 - original sense, 1 - reverse only, 2 - complement only 3 - reverse complement");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
 struct arg_file *summrslts = arg_file0("q","sumrslts","<file>",					"Output results summary to this SQLite3 database file");
 struct arg_str *experimentname = arg_str0("w","experimentname","<str>",			"experiment name SQLite3 database file");
@@ -92,7 +97,7 @@ struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
-	                mode,nthsel,extractdescrs, xsense, inputfile, outfile,
+	                mode,nthsel,extractdescrs, xsense, inputfile, outfile,threads,
 					end};
 char **pAllArgs;
 int argerrors;
@@ -283,6 +288,23 @@ if (!argerrors)
 		return(1);
 		}
 	
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 	strcpy(szInFile,inputfile->filename[0]);
 	CUtility::TrimQuotedWhitespcExtd(szInFile);
 
@@ -337,6 +359,7 @@ if (!argerrors)
 
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Extract sequences from file : '%s'",szInFile);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Write extracted features to file: '%s'",szOutFile);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 	if(gExperimentID > 0)
 		{
@@ -344,6 +367,7 @@ if (!argerrors)
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(szLogFile),"log",szLogFile);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(PMode),"mode",&PMode);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(XSense),"xsense",&XSense);
+		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumThreads),"threads",&NumThreads);
 
 	    ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumExtractDescrs),"NumExtractDescrs",&NumExtractDescrs);
 		if(PMode == 0)
@@ -368,7 +392,7 @@ if (!argerrors)
 #endif
 	gStopWatch.Start();
 
-	Rslt = fastaextractproc(PMode,NthSel,XSense,NumExtractDescrs,pszExtractDescrs,szInFile,szOutFile);
+	Rslt = fastaextractproc(PMode,NthSel,XSense,NumThreads,NumExtractDescrs,pszExtractDescrs,szInFile,szOutFile);
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -669,10 +693,66 @@ CUtility::SafeWrite(m_hFEOutFile,szOutBuff,BuffIdx);
 return(SeqLen);
 }
 
+// IdxExtract
+// Extract sequences using the input file '.fai' index, only the index sequence names need be matched and only
+// the sequences to be extracted are copied from the mapped input file
+int
+IdxExtract(CFastaIdx *pFastaIdx,		// indexed input multifasta file
+		int PMode,						// processing mode - 0 by matching descriptor, 1 subsample by selecting every Nth sequence
+		int NthSel,						// if > 0 then select every Nth descriptor.sequence to be extracted
+		int XSense,						// extraction sense - 0 - original sense, 1 - reverse only, 2 - complement only 3 - reverse complement
+		int NumDescrs,					// number of descriptor reqular expressions to match on
+		char *pszOutFasta)				// extracted sequences are being written to this multifasta file
+{
+int NumMatches;
+int SeqID;
+int SeqLen;
+int NumEntries;
+tsFaiEntry *pEntry;
+char szInDescription[cBSFDescriptionSize];
+
+NumMatches = 0;
+NumEntries = pFastaIdx->GetNumEntries();
+for(SeqID = 1; SeqID <= NumEntries; SeqID++)
+	{
+	// simply subsampling by selecting every Nth sequence?
+	if(NumDescrs == 0 || PMode == 1)
+		{
+		if(PMode != 0 && NthSel > 1 && (SeqID % NthSel))
+			continue;
+		}
+	else	// is this a descriptor of interest?
+		if(!ExtractDescrMatches(pFastaIdx->GetName(SeqID-1)))
+			continue;
+	NumMatches += 1;
+
+	pEntry = pFastaIdx->GetEntry(SeqID-1);
+	pFastaIdx->GetDescr(SeqID-1,szInDescription,cBSFDescriptionSize-10);
+	if(pEntry->SeqLen == 0)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Matching descriptor '%s' but no sequence in file - '%s'",szInDescription,pszOutFasta);
+		continue;
+		}
+	if(pEntry->SeqLen >= (INT64)INT_MAX)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Matching descriptor '%s' sequence length %lld is too long to be extracted",szInDescription,pEntry->SeqLen);
+		return(eBSFerrMaxDirEls);
+		}
+	SeqLen = (int)pEntry->SeqLen;
+	if(AllocSeqBuff((size_t)SeqLen + 1) == NULL)
+		return(eBSFerrMem);
+	pFastaIdx->GetSeq(SeqID-1,0,SeqLen,(char *)m_pSeqBuff);
+	CFasta::Ascii2Sense((char *)m_pSeqBuff,SeqLen,m_pSeqBuff,false);
+	WriteSeqFile(XSense,szInDescription,SeqLen,m_pSeqBuff);
+	}
+return(NumMatches);
+}
+
 int
 fastaextractproc(int PMode,				// processing mode - 0 by matching descriptor, 1 subsample by selecting every Nth sequence
 		int NthSel,						// if > 0 then select every Nth descriptor.sequence to be extracted
 		int XSense,						// extraction sense - 0 - original sense, 1 - reverse only, 2 - complement only 3 - reverse complement
+		int NumThreads,					// if input file is to be indexed then use at most this many threads
 		int NumDescrs,					// number of descriptor reqular expressions (in pszDescrs[]) to match on
 		char *pszDescrs[],				// extract sequences with these descriptors
 		char *pszInFasta,				// extract from this multifasta file
@@ -710,6 +790,25 @@ if((m_hFEOutFile = open(pszOutFasta,O_RDWR | O_CREAT |O_TRUNC, S_IREAD | S_IWRIT
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Output results file created/truncated: '%s'",pszOutFasta);
 
+// uncompressed multifasta files are indexed so only sequences to be extracted need be processed
+CFastaIdx FastaIdx;
+if((Rslt = FastaIdx.Open(pszInFasta,NumThreads)) == eBSFSuccess)
+	{
+	if((Rslt = NumMatches = IdxExtract(&FastaIdx,PMode,NthSel,XSense,NumDescrs,pszOutFasta)) >= eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Extracted %d sequences",NumMatches);
+		Rslt = eBSFSuccess;
+		}
+	FastaIdx.Reset();
+	FEReset();
+	return(Rslt);
+	}
+if(Rslt != eBSFerrNotFasta)
+	{
+	FEReset();
+	return(Rslt);
+	}
+
 if((Rslt=Fasta.Open(pszInFasta,true))!=eBSFSuccess)
 	{
 	if(Rslt != eBSFerrNotFasta)
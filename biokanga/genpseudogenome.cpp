@@ -40,11 +40,14 @@ typedef enum TAG_eFMode {
 	} etFMode;
 
 const int cMaxInFileSpecs = 100; // can handle up to this many input files
+const int cMaxWorkerThreads = 128;	// limiting max number of threads to this many
 
 int
 GPGProcess(etPMode PMode,					// processing mode
 		etFMode FMode,					// output format mode
+		int NumThreads,					// use at most this many threads
 		int LenNSeps,					// generate with this number of 'N' bases separating concatenated sequences 
+		bool bSplitSeqs,				// legacy: split sequences longer than cAllocInFasta bases into multiple pseudo genes
 		char *pszTrackTitle,			// track title for output UCSC BED
 		int NumInputFileSpecs,		  	// number of input file specs
 		char *pszInfileSpecs[],		  	// names of inputs files containing multifasta
@@ -71,8 +74,11 @@ int Rslt = 0;   			// function result code >= 0 represents success, < 0 on failu
 int Idx;
 
 int LenNSeps;				// generate with this number of 'N' bases separating concatenated sequences 
+bool bSplitSeqs;			// legacy: split sequences longer than 300M bases into multiple pseudo genes
 int PMode;				// processing mode
 int FMode;				// format output mode
+int NumberOfProcessors;		// number of installed CPUs
+int NumThreads;				// number of threads (0 defaults to number of CPUs)
 
 char szTrackTitle[cMaxDatasetSpeciesChrom];		// track title if output format is UCSC BED
 
@@ -94,11 +100,13 @@ struct arg_file *LogFile = arg_file0("F","log","<file>",		"diagnostics log file"
 struct arg_int *pmode = arg_int0("m","mode","<int>",		    "generate processing mode: 0 - standard");
 struct arg_int *format = arg_int0("M","format","<int>",		    "output format: 0 - output genome as single concatenated fasta)");
 struct arg_int *lennseps = arg_int0("n","lennseps","<int>",		    "generate with this number of 'N' bases separating concatenated sequences (default 100, range 5..100)");
+struct arg_lit  *splitseqs = arg_lit0("S","splitseqs",			"legacy: split sequences longer than 300000000 bases into multiple 'N' separated pseudo genes, default is to retain sequences as single pseudo genes");
 struct arg_file *infiles = arg_filen("i","in","<file>",0,cMaxInFileSpecs,"input from these multifasta files, wildcards allowed");
 struct arg_file *outgenomefile = arg_file1("o","out","<file>",	"output pseudo genome to this file");
 struct arg_file *outgenefile = arg_file1("O","outbed","<file>",	"Output pseudo gene (BED) file");
 
 struct arg_str  *title = arg_str0("t","title","<string>",       "track title");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 struct arg_file *summrslts = arg_file0("q","sumrslts","<file>",		"Output results summary to this SQLite3 database file");
 struct arg_str *experimentname = arg_str0("w","experimentname","<str>",		"experiment name SQLite3 database file");
 struct arg_str *experimentdescr = arg_str0("W","experimentdescr","<str>",	"experiment description SQLite3 database file");
@@ -107,7 +115,7 @@ struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
-					pmode,lennseps,format,title,infiles,	outgenomefile,outgenefile,
+					pmode,lennseps,splitseqs,format,title,infiles,	outgenomefile,outgenefile,threads,
 					end};
 
 char **pAllArgs;
@@ -259,6 +267,7 @@ if (!argerrors)
 		exit(1);
 		}
 
+	bSplitSeqs = splitseqs->count ? true : false;
 
 	FMode = (etFMode)(format->count ? format->ival[0] : eFMdefault);
 	if(FMode < eFMdefault || FMode >= eFMplaceholder)
@@ -283,6 +292,23 @@ if (!argerrors)
 		}
 
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 	strcpy(szOutGeneFile,outgenefile->filename[0]);
 	strcpy(szOutGenomeFile,outgenomefile->filename[0]);
 
@@ -329,10 +355,12 @@ if (!argerrors)
 		}
 
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Length of inter-sequence separator N's: %d",LenNSeps);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Sequences longer than 300000000 bases are : '%s'",bSplitSeqs ? "split into multiple pseudo genes" : "retained as single pseudo genes");
 	for(Idx = 0; Idx < NumInputFiles; Idx++)
 		gDiagnostics.DiagOutMsgOnly(eDLInfo,"Process from input file (%d): '%s'",Idx+1,pszInfileSpecs[Idx]);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Output pseudo genome file : '%s'",szOutGenomeFile);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Output pseudo gene (BED) file : '%s'",szOutGeneFile);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 	if(szExperimentName[0] != '\0')
 		gDiagnostics.DiagOutMsgOnly(eDLInfo,"This processing reference: %s",szExperimentName);
@@ -344,6 +372,8 @@ if (!argerrors)
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"mode",&PMode);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"format",&FMode);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"lennseps",&LenNSeps);
+		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTBool,sizeof(bSplitSeqs),"splitseqs",&bSplitSeqs);
+		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"threads",&NumThreads);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(INT32),"NumInputFiles",&NumInputFiles);
 		for(Idx = 0; Idx < NumInputFiles; Idx++)
 			ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(pszInfileSpecs[Idx]),"in",pszInfileSpecs[Idx]);
@@ -360,7 +390,7 @@ if (!argerrors)
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = GPGProcess((etPMode)PMode,(etFMode)FMode,LenNSeps,szTrackTitle,NumInputFiles,pszInfileSpecs,szOutGenomeFile,szOutGeneFile);
+	Rslt = GPGProcess((etPMode)PMode,(etFMode)FMode,NumThreads,LenNSeps,bSplitSeqs,szTrackTitle,NumInputFiles,pszInfileSpecs,szOutGenomeFile,szOutGeneFile);
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -403,6 +433,43 @@ int m_TotEntries;								// total number of contigs or scaffolds in pseudo genom
 etSeqBase m_100Ns[cMaxNSeps];					// to hold upto 100 eBaseNs used to separate contigs/scaffolds in output pseudo genome
 int m_CurFastaCol;								// next fasta col to write into
 
+// indexed input files are concatenated by worker threads, each thread formatting work items into the output pseudo genome
+// fasta, with work items written in order as their genome offsets and line layout are predetermined
+const int cGPGMaxItemBases = 0x01000000;		// sequences are partitioned into work items of at most this many bases
+
+#pragma pack(1)
+typedef struct TAG_sGPGItem {
+	int EntryIdx;				// index entry for sequence
+	INT64 StartOfs;				// item starts at this sequence base offset
+	int Len;					// item is this many sequence bases
+	int NumSeps;				// item is preceded by this many separator N's
+	UINT32 GenomeOfs;			// pseudo genome offset of first separator or sequence base in item
+	INT64 FileOfs;				// if sequence has irregular line lengths then the file offset located for StartOfs, else -1
+	} tsGPGItem;
+
+typedef struct TAG_sGPGThreadPars {
+	int ThreadIdx;				// uniquely identifies this thread
+#ifdef _WIN32
+	HANDLE threadHandle;		// handle as returned by _beginthreadex()
+	unsigned int threadID;		// identifier as set by _beginthreadex()
+#else
+	int threadRslt;				// result as returned by pthread_create ()
+	pthread_t threadID;			// identifier as set by pthread_create ()
+#endif
+	etSeqBase *pSeq;			// allocated to hold the largest item separators and sequence bases
+	char *pOutBuff;				// allocated to hold the largest item formatted as fasta lines
+	int Rslt;					// thread processing result
+	} tsGPGThreadPars;
+#pragma pack()
+
+CFastaIdx *m_pGPGFastaIdx;						// currently indexed input file
+int m_NumGPGItems;								// number of work items in m_pGPGItems
+int m_AllocGPGItems;							// m_pGPGItems allocated to hold this many work items
+tsGPGItem *m_pGPGItems;							// work items
+volatile unsigned int m_NumGPGItemsClaimed;		// number of work items claimed by worker threads
+volatile unsigned int m_NxtGPGItemWrite;		// next work item to be written to output pseudo genome
+volatile int m_bGPGTerm;						// set by any worker thread failing, all worker threads then terminate
+
 
 void
 GPGReset(void)
@@ -437,6 +504,14 @@ if(m_pOutBEDBuff != NULL)
 	delete m_pOutBEDBuff;
 	m_pOutBEDBuff = NULL;
 	}
+if(m_pGPGItems != NULL)
+	{
+	free(m_pGPGItems);				// was allocated with realloc
+	m_pGPGItems = NULL;
+	}
+m_NumGPGItems = 0;
+m_AllocGPGItems = 0;
+m_pGPGFastaIdx = NULL;
 
 m_OutFastaOfs = 0;
 m_OutBEDOfs = 0;
@@ -455,6 +530,7 @@ m_hOutGeneFile = -1;
 m_pInFastaBuff = NULL;
 m_pOutFastaBuff = NULL;
 m_pOutBEDBuff = NULL;
+m_pGPGItems = NULL;
 GPGReset();
 }
 
@@ -508,8 +584,294 @@ return(eBSFSuccess);
 
 
 
+#ifdef _WIN32
+unsigned __stdcall GPGThreadStart(void * pThreadPars)
+#else
+void * GPGThreadStart(void * pThreadPars)
+#endif
+{
+tsGPGThreadPars *pPars = (tsGPGThreadPars *)pThreadPars; // makes it easier not having to deal with casts!
+unsigned int ItemIdx;
+tsGPGItem *pItem;
+etSeqBase *pSeq;
+int Rslt;
+int SeqIdx;
+int SeqLen;
+int OutOfs;
+int NumCols;
+UINT32 GenomeOfs;
+
+Rslt = eBSFSuccess;
+while(!m_bGPGTerm)
+	{
+#ifdef _WIN32
+	ItemIdx = InterlockedIncrement((volatile LONG *)&m_NumGPGItemsClaimed) - 1;
+#else
+	ItemIdx = __sync_fetch_and_add(&m_NumGPGItemsClaimed,1);
+#endif
+	if(ItemIdx >= (unsigned int)m_NumGPGItems)
+		break;
+	pItem = &m_pGPGItems[ItemIdx];
+
+	// separators followed by the item sequence, translated as would have been by CFasta::ReadSequence()
+	pSeq = pPars->pSeq;
+	if(pItem->NumSeps)
+		memcpy(pSeq,m_100Ns,pItem->NumSeps);
+	if((Rslt = m_pGPGFastaIdx->GetSeq(pItem->EntryIdx,pItem->StartOfs,pItem->Len,(char *)&pSeq[pItem->NumSeps],pItem->FileOfs)) != pItem->Len)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"GPGThreadStart: Unable to read %d bases at offset %lld from sequence '%s'",
+								pItem->Len,pItem->StartOfs,m_pGPGFastaIdx->GetName(pItem->EntryIdx));
+		Rslt = Rslt < eBSFSuccess ? Rslt : eBSFerrFileAccess;
+		m_bGPGTerm = 1;
+		break;
+		}
+	Rslt = eBSFSuccess;
+	CFasta::Ascii2Sense((char *)&pSeq[pItem->NumSeps],pItem->Len,&pSeq[pItem->NumSeps],false);
+	SeqLen = pItem->NumSeps + pItem->Len;
+
+	// format into 70 col lines continuing on from the preceding item
+	OutOfs = 0;
+	GenomeOfs = pItem->GenomeOfs;
+	for(SeqIdx = 0; SeqIdx < SeqLen; SeqIdx += NumCols)
+		{
+		NumCols = min(SeqLen - SeqIdx,(int)(70 - (GenomeOfs % 70)));
+		CSeqTrans::MapSeq2Ascii(&pSeq[SeqIdx],NumCols,&pPars->pOutBuff[OutOfs],'N','U','I',true);
+		OutOfs += NumCols;
+		GenomeOfs += NumCols;
+		if((GenomeOfs % 70) == 0)
+			pPars->pOutBuff[OutOfs++] = '\n';
+		}
+
+	// items are written in order
+	while(m_NxtGPGItemWrite != ItemIdx && !m_bGPGTerm)
+		CUtility::SleepMillisecs(1);
+	if(m_bGPGTerm)
+		break;
+	if(!CUtility::SafeWrite(m_hOutGenomeFile,pPars->pOutBuff,OutOfs))
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"GPGThreadStart: Write to output pseudo genome failed");
+		Rslt = eBSFerrFileAccess;
+		m_bGPGTerm = 1;
+		break;
+		}
+#ifdef _WIN32
+	InterlockedIncrement((volatile LONG *)&m_NxtGPGItemWrite);
+#else
+	__sync_fetch_and_add(&m_NxtGPGItemWrite,1);
+#endif
+	}
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+int
+AddGPGItem(int EntryIdx,INT64 StartOfs,int Len,int NumSeps,UINT32 GenomeOfs,INT64 FileOfs)
+{
+tsGPGItem *pItem;
+if(m_pGPGItems == NULL || m_NumGPGItems == m_AllocGPGItems)
+	{
+	int AllocGPGItems = m_AllocGPGItems + 0x010000;
+	if((pItem = (tsGPGItem *)realloc(m_pGPGItems,sizeof(tsGPGItem) * (size_t)AllocGPGItems)) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddGPGItem: Memory reallocation for %d work items failed",AllocGPGItems);
+		return(eBSFerrMem);
+		}
+	m_pGPGItems = pItem;
+	m_AllocGPGItems = AllocGPGItems;
+	}
+pItem = &m_pGPGItems[m_NumGPGItems++];
+pItem->EntryIdx = EntryIdx;
+pItem->StartOfs = StartOfs;
+pItem->Len = Len;
+pItem->NumSeps = NumSeps;
+pItem->GenomeOfs = GenomeOfs;
+pItem->FileOfs = FileOfs;
+return(eBSFSuccess);
+}
+
+int 
+LoadIdxFasta(int NumThreads,				// use at most this many threads
+			int LenNSeps,					// generate with this number of 'N' bases separating concatenated sequences
+			bool bSplitSeqs,				// legacy: split sequences longer than cAllocInFasta bases into multiple pseudo genes
+			char *pszGenome,char *pszFastaFile,
+			CFastaIdx *pFastaIdx)			// input file has been indexed
+{
+char szName[cBSFSourceSize];
+char szDescription[cBSFDescriptionSize];
+int Rslt;
+int EntryIdx;
+int NumEntries;
+int NumSeps;
+int MaxItemLen;
+int ThreadIdx;
+int NumStarted;
+INT64 ItemLen;
+INT64 ItemOfs;
+INT64 FileOfs;
+INT64 PrevItemOfs;
+INT64 PrevFileOfs;
+INT64 GeneLen;
+INT64 GeneOfs;
+UINT32 GeneStart;
+tsFaiEntry *pEntry;
+tsGPGThreadPars *pThreads;
+tsGPGThreadPars *pPars;
+
+// work items for each sequence, with genome offsets, are determined and the BED gene entries output before any sequences are processed
+m_NumGPGItems = 0;
+MaxItemLen = 0;
+Rslt = eBSFSuccess;
+NumEntries = pFastaIdx->GetNumEntries();
+for(EntryIdx = 0; Rslt >= eBSFSuccess && EntryIdx < NumEntries; EntryIdx++)
+	{
+	pEntry = pFastaIdx->GetEntry(EntryIdx);
+	m_TotEntries += 1;
+	if(pFastaIdx->GetDescr(EntryIdx,szDescription,cBSFDescriptionSize) < 0 || sscanf(szDescription," %s[ ,]",szName)!=1)
+		sprintf(szName,"%s.%d",pszFastaFile,m_TotEntries);
+	if(pEntry->SeqLen == 0)
+		continue;
+	PrevItemOfs = 0;
+	PrevFileOfs = -1;
+	if(((INT64)m_GenomeLen + (LenNSeps * (1 + (bSplitSeqs ? pEntry->SeqLen / cAllocInFasta : 0))) + pEntry->SeqLen) > (INT64)0x0ffffffff)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadIdxFasta: pseudo genome length would exceed %u",0x0ffffffff);
+		return(eBSFerrMaxDirEls);
+		}
+	// sequences are output as a single pseudo gene unless legacy splitting was requested, in which case sequences are split into
+	// cAllocInFasta sized pseudo genes as were read by LoadFasta() in earlier releases, each separated by 'N's if not the first entry
+	for(GeneOfs = 0; Rslt >= eBSFSuccess && GeneOfs < pEntry->SeqLen; GeneOfs += GeneLen)
+		{
+		GeneLen = bSplitSeqs ? min((INT64)cAllocInFasta,pEntry->SeqLen - GeneOfs) : pEntry->SeqLen;
+		NumSeps = m_TotEntries > 1 ? LenNSeps : 0;
+		GeneStart = m_GenomeLen + NumSeps;
+		for(ItemOfs = GeneOfs; Rslt >= eBSFSuccess && ItemOfs < GeneOfs + GeneLen; ItemOfs += ItemLen)
+			{
+			ItemLen = min((INT64)cGPGMaxItemBases,GeneOfs + GeneLen - ItemOfs);
+			// irregular line length sequences can't be directly offset into so the file offset for each item is located
+			// whilst counting bases forward from the preceding item
+			FileOfs = -1;
+			if(pEntry->LineBases == 0)
+				{
+				if((FileOfs = pFastaIdx->LocateBase(EntryIdx,ItemOfs,PrevItemOfs,PrevFileOfs)) < 0)
+					{
+					gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadIdxFasta: Unable to locate offset %lld in sequence '%s'",ItemOfs,pFastaIdx->GetName(EntryIdx));
+					Rslt = (int)FileOfs;
+					break;
+					}
+				PrevItemOfs = ItemOfs;
+				PrevFileOfs = FileOfs;
+				}
+			Rslt = AddGPGItem(EntryIdx,ItemOfs,(int)ItemLen,NumSeps,m_GenomeLen,FileOfs);
+			if((int)ItemLen + NumSeps > MaxItemLen)
+				MaxItemLen = (int)ItemLen + NumSeps;
+			m_GenomeLen += (UINT32)ItemLen + NumSeps;
+			NumSeps = 0;
+			}
+		OutputGene(pszGenome,szName,'+',GeneStart,m_GenomeLen - GeneStart);
+		}
+	}
+if(Rslt < eBSFSuccess || m_NumGPGItems == 0)
+	return(Rslt);
+
+// worker threads write directly to the output pseudo genome so any buffered fasta must first be written
+if(m_CurFastaCol == 70)
+	{
+	m_pOutFastaBuff[m_OutFastaOfs++] = '\n';
+	m_CurFastaCol = 0;
+	}
+if(m_OutFastaOfs > 0)
+	{
+	if(!CUtility::SafeWrite(m_hOutGenomeFile,m_pOutFastaBuff,m_OutFastaOfs))
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadIdxFasta: Write to output pseudo genome failed");
+		return(eBSFerrFileAccess);
+		}
+	m_OutFastaOfs = 0;
+	}
+
+NumThreads = min(NumThreads,m_NumGPGItems);
+if((pThreads = new tsGPGThreadPars [NumThreads]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadIdxFasta: Unable to allocate memory for %d threads",NumThreads);
+	return(eBSFerrMem);
+	}
+memset(pThreads,0,sizeof(tsGPGThreadPars) * NumThreads);
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+	if((pPars->pSeq = new etSeqBase [MaxItemLen + 1]) == NULL ||
+		(pPars->pOutBuff = new char [MaxItemLen + (MaxItemLen / 70) + 10]) == NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadIdxFasta: Unable to allocate memory for sequence buffers");
+		Rslt = eBSFerrMem;
+		break;
+		}
+	}
+
+if(Rslt >= eBSFSuccess)
+	{
+	m_pGPGFastaIdx = pFastaIdx;
+	m_NumGPGItemsClaimed = 0;
+	m_NxtGPGItemWrite = 0;
+	m_bGPGTerm = 0;
+	for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+		{
+		pPars->ThreadIdx = ThreadIdx + 1;
+		pPars->Rslt = eBSFSuccess;
+#ifdef _WIN32
+		pPars->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,GPGThreadStart,pPars,0,&pPars->threadID);
+		if(pPars->threadHandle == NULL)
+#else
+		pPars->threadRslt = pthread_create(&pPars->threadID,NULL,GPGThreadStart,pPars);
+		if(pPars->threadRslt != 0)
+#endif
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadIdxFasta: Unable to start worker thread %d",ThreadIdx + 1);
+			pPars->Rslt = eBSFerrInternal;
+			m_bGPGTerm = 1;
+			break;
+			}
+		}
+	NumStarted = ThreadIdx;
+	for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumStarted; ThreadIdx++, pPars++)
+		{
+#ifdef _WIN32
+		WaitForSingleObject(pPars->threadHandle,INFINITE);
+		CloseHandle(pPars->threadHandle);
+#else
+		pthread_join(pPars->threadID,NULL);
+#endif
+		}
+
+	// first thread error, if any, is the load result
+	for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+		if(pPars->Rslt < eBSFSuccess)
+			{
+			Rslt = pPars->Rslt;
+			break;
+			}
+	m_pGPGFastaIdx = NULL;
+	m_CurFastaCol = m_GenomeLen % 70;		// items were written with the line terminator following the last col
+	}
+
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+	if(pPars->pSeq != NULL)
+		delete [] pPars->pSeq;
+	if(pPars->pOutBuff != NULL)
+		delete [] pPars->pOutBuff;
+	}
+delete [] pThreads;
+return(Rslt);
+}
+
 int 
 LoadFasta(int LenNSeps,					// generate with this number of 'N' bases separating concatenated sequences
+			bool bSplitSeqs,				// legacy: split sequences longer than cAllocInFasta bases into multiple pseudo genes
 			char *pszGenome,char *pszFastaFile)
 {
 CFasta Fasta;
@@ -545,6 +907,11 @@ while((Rslt = SeqLen = Fasta.ReadSequence(m_pInFastaBuff,cAllocInFasta,true,fals
 	{
 	if(!m_TotEntries || SeqLen == eBSFFastaDescr)		// just read a descriptor line or else the first entry without a descriptor
 		{
+		if(bEntryCreated)			// pseudo gene for the preceding entry is complete
+			{
+			OutputGene(pszGenome,szName,'+',GeneStart,m_GenomeLen - GeneStart);
+			bEntryCreated = false;
+			}
 		m_TotEntries += 1;
 		if(SeqLen == eBSFFastaDescr)
 			Descrlen = Fasta.ReadDescriptor(szDescription,cBSFDescriptionSize);
@@ -553,6 +920,14 @@ while((Rslt = SeqLen = Fasta.ReadSequence(m_pInFastaBuff,cAllocInFasta,true,fals
 		if(SeqLen == eBSFFastaDescr)
 			continue;
 		}
+	else
+		if(bEntryCreated)			// sequences longer than cAllocInFasta are read in multiple parts, unless splitting these parts continue the same pseudo gene
+			{
+			if((Rslt=OutputFasta(SeqLen,m_pInFastaBuff)) < eBSFSuccess)
+				break;
+			m_GenomeLen += SeqLen;
+			continue;
+			}
 
 	// if not the first entry then separate with SepLen 'N's
 	if(m_TotEntries > 1)
@@ -567,8 +942,13 @@ while((Rslt = SeqLen = Fasta.ReadSequence(m_pInFastaBuff,cAllocInFasta,true,fals
 	if((Rslt=OutputFasta(SeqLen,m_pInFastaBuff)) < eBSFSuccess)
 		break;
 	m_GenomeLen += SeqLen;
-	OutputGene(pszGenome,szName,'+',GeneStart,m_GenomeLen - GeneStart);
+	if(bSplitSeqs)
+		OutputGene(pszGenome,szName,'+',GeneStart,m_GenomeLen - GeneStart);
+	else
+		bEntryCreated = true;
 	}
+if(Rslt >= eBSFSuccess && bEntryCreated)
+	OutputGene(pszGenome,szName,'+',GeneStart,m_GenomeLen - GeneStart);
 
 if(Rslt < eBSFSuccess)
 	{
@@ -583,7 +963,9 @@ return(eBSFSuccess);
 int
 GPGProcess(etPMode PMode,					// processing mode
 		etFMode FMode,					// output format mode
+		int NumThreads,					// use at most this many threads
 		int LenNSeps,					// generate with this number of 'N' bases separating concatenated sequences 
+		bool bSplitSeqs,				// legacy: split sequences longer than cAllocInFasta bases into multiple pseudo genes
 		char *pszGenomeName,			// track title for output UCSC BED and psudeo genome fasta descriptor
 		int NumInputFileSpecs,		  	// number of input file specs
 		char *pszInfileSpecs[],		  	// names of inputs files containing multifasta
@@ -668,7 +1050,13 @@ for(Idx = 0; Idx < NumInputFileSpecs; Idx++)
 		{
 		pszInfile = glob.File(FileID);
 		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Loading and parsing contig or scaffolds from file '%s'\n",pszInfile);
-		Rslt = LoadFasta(LenNSeps,pszGenomeName,pszInfile);
+		// uncompressed multifasta files are indexed and concatenated by multiple threads, otherwise sequences are parsed with CFasta
+		CFastaIdx FastaIdx;
+		if((Rslt = FastaIdx.Open(pszInfile,NumThreads)) == eBSFSuccess)
+			Rslt = LoadIdxFasta(NumThreads,LenNSeps,bSplitSeqs,pszGenomeName,pszInfile,&FastaIdx);
+		else
+			if(Rslt == eBSFerrNotFasta)
+				Rslt = LoadFasta(LenNSeps,bSplitSeqs,pszGenomeName,pszInfile);
 		if(Rslt != eBSFSuccess)
 			{
 			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Process: Load failed for input contig or scaffolds file '%s'\n",pszInfile);
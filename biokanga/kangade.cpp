@@ -63,6 +63,16 @@ const int cMaxAssumTransLen = 2000000;					// assume no transcribed region will
 const int cMaxAssumTransLoci = cMaxAssumTransLen/10;	// assume very long transcribed regions will be low abundance reads and number of unique read aligned loci will be at most 10% of cMaxAssumTransLen
 
 const int cMaxConfidenceIterations = 10000;	// max number of iterations when calculating confidence intervals and PValues
+const int cMinConfidenceIterations = 1000;	// always at least this many iterations before checking if the PValue has been resolved
+const int cChkConfidenceIterations = 500;	// after cMinConfidenceIterations then check if PValue has been resolved every this many iterations
+const double cResolvedPValue = 0.05;		// iterations stop early when the median PValue is resolved as being either below or above this PValue
+const double cResolvedPValueZ = 3.29;		// median PValue resolved when proportion of iteration PValues below cResolvedPValue differs from 0.5 by at least this many std errors
+const double cPoissonNormApproxLambda = 100000.0;	// Poissons with lambdas larger than this are sampled from the normal approximation
+
+const UINT64 cDERNGSeed = 0x5deece66d1b2f3a5LL;	// seed combined with the FeatureID when seeding the per feature random number stream
+
+const int cMaxBAMLoadThreads = 16;			// at most this many threads loading alignments from an indexed BAM
+const int cBAMChromLociInitalAlloc = 0x0100000;	// loader threads initially allocate to hold this many read alignment loci for a chromosome, doubled as required
 
 const int cMaxExclZones = 1000;			// max allowed number of exclusion zones within which reads are to be excluded
 
@@ -220,6 +230,43 @@ typedef struct TAG_sFeatDE {
 } tsFeatDE;
 
 
+// Poisson sampling of a bin's control and experiment counts
+typedef struct TAG_sBinSampler {
+	tsAlignBin *pBin;			// sampling counts for this bin
+	int CtrlLambda;				// control counts
+	int CtrlRange;				// if CtrlLambda <= 10 then pCtrlPoissons holds this many precomputed Poissons
+	int *pCtrlPoissons;			// precomputed Poissons for CtrlLambda, NULL if CtrlLambda > 10 or no counts
+	int ExprLambda;				// experiment counts
+	int ExprRange;				// if ExprLambda <= 10 then pExprPoissons holds this many precomputed Poissons
+	int *pExprPoissons;			// precomputed Poissons for ExprLambda, NULL if ExprLambda > 10 or no counts
+} tsBinSampler;
+
+// each thread loading alignments from an indexed BAM has it's own instance of the following
+typedef struct TAG_sLoadBAMThreadPars {
+	int ThreadIdx;					// uniquely identifies this loader thread
+#ifdef _WIN32
+	HANDLE threadHandle;			// handle as returned by _beginthreadex()
+	unsigned int threadID;			// identifier as set by _beginthreadex()
+#else
+	int threadRslt;					// result as returned by pthread_create ()
+	pthread_t threadID;				// identifier as set by pthread_create ()
+#endif
+	bool bIsExperiment;				// false if control file, true if experiment
+	int FileID;						// uniquely identifies the file being loaded
+	char *pszInFile;				// loading from this indexed BAM file
+	char FiltStrand;				// process for this strand '+' or '-' or for both '*'
+	UINT32 NumProcessed;			// number of alignments processed by this thread
+	UINT32 NumRdsExcluded;			// number of alignments excluded by this thread because overlaying an exclusion zone
+	UINT32 AllocLoci;				// pLoci allocated to hold this many read alignment loci
+	tsAlignReadLoci *pLoci;			// to hold the read alignment loci for the chromosome currently being loaded
+	teBSFrsltCodes Rslt;			// thread processing completed result - eBSFSuccess if no errors
+} tsLoadBAMThreadPars;
+
+// indexed BAM reference sequences to be loaded
+typedef struct TAG_sIdxRefSeq {
+	char szChrom[cMaxDatasetSpeciesChrom+1];	// reference sequence name
+} tsIdxRefSeq;
+
 // each thread has it's own instance of the following
 typedef struct TAG_ThreadInstData {
 	UINT32 ThreadInst;				// uniquely identifies this thread instance
@@ -250,7 +297,9 @@ typedef struct TAG_ThreadInstData {
 	int NumFeats2Proc;					// process this number of features in Feats2Proc[]
 	int NumFeatsProcessed;				// number features processed currently from Feats2Proc
 	int Feats2Proc[cMaxFeats2ProcAlloc];	// these are the feature identifiers for the features to be processed
-	CSimpleRNG *pSimpleRNG;				// random generator exclusively for use by this thread
+	CSimpleRNG *pSimpleRNG;				// random generator exclusively for use by this thread, reseeded for each feature
+	int NumBinSamplers;					// BinSamplers contains this many bins which are to be Poisson sampled
+	tsBinSampler BinSamplers[cMaxNumBins];	// Poisson samplers for the bins of the feature currently being processed
 } tsThreadInstData;
 
 #pragma pack()
@@ -258,9 +307,11 @@ typedef struct TAG_ThreadInstData {
 #ifdef _WIN32
 CRITICAL_SECTION m_hSCritSect;	// used to serialise
 unsigned __stdcall ThreadedDEproc(void * pThreadPars);
+unsigned __stdcall ThreadedLoadBAMproc(void * pThreadPars);
 #else
 pthread_spinlock_t m_hSpinLock;
 void *ThreadedDEproc(void * pThreadPars);
+void *ThreadedLoadBAMproc(void * pThreadPars);
 #endif
 
 char *Region2Txt(etBEDRegion Region);
@@ -1029,14 +1080,22 @@ tsExclZone *m_pExclZones;			// pts to exclusion zones to which overlaying reads
 UINT32 m_LimitAligned;				// for test/evaluation can limit number of reads parsed to be no more than this number (0 for no limit)
 int m_CoWinLen;						// counts coalescing window length
 
+int m_NumLoadThreads;				// number of threads to use when loading alignments from indexed BAMs
+int m_NumIdxRefSeqs;				// number of indexed BAM reference sequences in m_pIdxRefSeqs
+int m_NxtIdxRefSeq;					// next reference sequence in m_pIdxRefSeqs to be claimed by a loader thread
+tsIdxRefSeq *m_pIdxRefSeqs;			// indexed BAM reference sequences to be loaded
+UINT32 m_IdxNumProcessed;			// total number of alignments processed by all loader threads
+
 tsAlignReadLoci *m_pCtrlAlignReadLoci = NULL; // memory allocated to hold control read alignment loci, reads are written contiguously into this memory
 UINT32 m_AllocdCtrlAlignReadsLoci;			  // how instances of control tsAlignReadLoci have been allocated
 UINT32 m_CurNumCtrlAlignReadsLoci;			  // m_pAlignReadLoci currently contains a total of this many control read alignment loci
+UINT32 m_CurNumCtrlAlignedReads;			  // total number of control reads in m_pCtrlAlignReadLoci, loci loaded from indexed BAMs may be collapsed start counts of multiple reads
 UINT64 m_CurSumCtrlReadsLen;				  // current summed control reads length
 
 tsAlignReadLoci *m_pExprAlignReadLoci = NULL;	// memory allocated to hold experiment read alignment loci, reads are written contiguously into this memory
 UINT32 m_AllocdExprAlignReadsLoci;			// how instances of experiment tsAlignReadLoci have been allocated
 UINT32 m_CurNumExprAlignReadsLoci;			// m_pAlignReadLoci currently contains a total of this many experiment read alignment loci
+UINT32 m_CurNumExprAlignedReads;			// total number of experiment reads in m_pExprAlignReadLoci, loci loaded from indexed BAMs may be collapsed start counts of multiple reads
 UINT64 m_CurSumExprReadsLen;				// current summed control reads length
 
 UINT32 m_NumLoadedCtrlReads;			// total number of control reads actually loaded prior to any  coalescing and library size normalisation
@@ -1052,7 +1111,7 @@ UINT32 m_NumPoissonNormCtrlReads;		// total number of control reads after poisso
 UINT32 m_NumPoissonNormExprReads;		// total number of expression after after poisson noise
 
 UINT32 m_NumFeaturesLoaded;				// total number of features loaded for processing
-UINT32 m_NumFeaturesProcessed;			// current number of features processed
+volatile UINT32 m_NumFeaturesProcessed;	// current number of features processed
 
 tsAlignBin *m_pAlignBins = NULL;		// memory allocated to hold alignment bin cnts
 UINT32 m_AllocdAlignBins = 0;			// how instances of tsAlignBin have been allocated
@@ -1098,7 +1157,7 @@ size_t m_AllocNumPoissonCnts;		 // number allocated
 
 CSimpleRNG m_SimpleRNG;				// used to generate Poisson distributed random cnts
 
-int m_NumFeatsDEd;					// number of features processed into tsFeatDE's
+volatile int m_NumFeatsDEd;			// number of features processed into tsFeatDE's, slots are claimed with atomic increments
 int m_AllocdFeatsDEd;				// number alloc'd
 tsFeatDE *m_pFeatDEs;				// allocated to hold features processed for DE
 
@@ -1204,67 +1263,167 @@ for(Lambda = 1; Lambda <= 10; Lambda++)
 	}
 }
 
-int
-RandPoisson(tsThreadInstData *pThreadInst,int Lambda)
+// PoissonSeq
+// Returns ptr to the precomputed Poissons for Lambda (1..10) and the number of precomputed Poissons, NULL if no precomputed Poissons for Lambda
+int *
+PoissonSeq(int Lambda,		// precomputed Poissons for this lambda
+		   int *pRange)		// returned number of precomputed Poissons
 {
-UINT32 IdxPoisson;
-int *pPoissons;
-int Range;
-
-if(Lambda <= 0)
-	return(0);
-
-if(Lambda > 10)
-	return(pThreadInst == NULL ? m_SimpleRNG.GetPoisson(Lambda) : pThreadInst->pSimpleRNG->GetPoisson(Lambda));
-
 switch(Lambda) {
 	case 1:
-		pPoissons = m_Possion1;
-		Range = cPossion1SeqLen;
-		break;
+		*pRange = cPossion1SeqLen;
+		return(m_Possion1);
 	case 2:
-		pPoissons = m_Possion2;
-		Range = cPossion2SeqLen;
-		break;
+		*pRange = cPossion2SeqLen;
+		return(m_Possion2);
 	case 3:
-		pPoissons = m_Possion3;
-		Range = cPossion3SeqLen;
-		break;
+		*pRange = cPossion3SeqLen;
+		return(m_Possion3);
 	case 4:
-		pPoissons = m_Possion4;
-		Range = cPossion4SeqLen;
-		break;
+		*pRange = cPossion4SeqLen;
+		return(m_Possion4);
 	case 5:
-		pPoissons = m_Possion5;
-		Range = cPossion5SeqLen;
-		break;
+		*pRange = cPossion5SeqLen;
+		return(m_Possion5);
 	case 6:
-		pPoissons = m_Possion6;
-		Range = cPossion6SeqLen;
-		break;
+		*pRange = cPossion6SeqLen;
+		return(m_Possion6);
 	case 7:
-		pPoissons = m_Possion7;
-		Range = cPossion7SeqLen;
-		break;
+		*pRange = cPossion7SeqLen;
+		return(m_Possion7);
 	case 8:
-		pPoissons = m_Possion8;
-		Range = cPossion8SeqLen;
-		break;
+		*pRange = cPossion8SeqLen;
+		return(m_Possion8);
 	case 9:
-		pPoissons = m_Possion9;
-		Range = cPossion9SeqLen;
-		break;
+		*pRange = cPossion9SeqLen;
+		return(m_Possion9);
 	case 10:
-		pPoissons = m_Possion10;
-		Range = cPossion10SeqLen;
-		break;
+		*pRange = cPossion10SeqLen;
+		return(m_Possion10);
 	default:
-		return(0);
+		break;
 	}
-IdxPoisson = pThreadInst == NULL ? m_SimpleRNG.GetUint() : pThreadInst->pSimpleRNG->GetUint();
+*pRange = 0;
+return(NULL);
+}
+
+int
+RandPoisson(tsThreadInstData *pThreadInst,int Lambda)
+{
+UINT32 IdxPoisson;
+int *pPoissons;
+int Range;
+CSimpleRNG *pRNG;
+
+if(Lambda <= 0)
+	return(0);
+
+pRNG = pThreadInst == NULL ? &m_SimpleRNG : pThreadInst->pSimpleRNG;
+if(Lambda > 10)
+	{
+	// at very large lambdas, as when Poisson'ing library sizes, the Poisson is indistinguishable from the normal approximation which is much cheaper to sample
+	if(Lambda > cPoissonNormApproxLambda)
+		{
+		double Sample = pRNG->GetNormal((double)Lambda,sqrt((double)Lambda));
+		return(Sample <= 0.0 ? 0 : (int)(Sample + 0.5));
+		}
+	return(pRNG->GetPoisson(Lambda));
+	}
+
+if((pPoissons = PoissonSeq(Lambda,&Range)) == NULL)
+	return(0);
+IdxPoisson = pRNG->GetUint();
 return(pPoissons[IdxPoisson  % Range]);
 }
 
+// SeedFeatureRNG
+// Counter based seeding of the thread's random generator from the FeatureID (the counter) using the SplitMix64 finaliser
+// The Poisson noise induced into a feature's counts is then dependent only on the feature, and not on which thread processed
+// the feature or in which order, so results are reproducible independent of the number of threads and each feature has a statistically
+// independent random stream
+void
+SeedFeatureRNG(tsThreadInstData *pThreadInst,int FeatureID)
+{
+UINT64 Z;
+UINT32 U;
+UINT32 V;
+Z = cDERNGSeed + ((UINT64)(UINT32)FeatureID * 0x9e3779b97f4a7c15LL);
+Z = (Z ^ (Z >> 30)) * 0xbf58476d1ce4e5b9LL;
+Z = (Z ^ (Z >> 27)) * 0x94d049bb133111ebLL;
+Z ^= (Z >> 31);
+U = (UINT32)(Z >> 32);
+V = (UINT32)Z;
+if(U == 0)			// generator state must be non-zero
+	U = 521288629;
+if(V == 0)
+	V = 362436069;
+pThreadInst->pSimpleRNG->SetState(U,V);
+}
+
+// InitBinSamplers
+// Initialises Poisson samplers for those bins in pPoissonAlignBins which have coverage so that PoissonBins() can sample all bins
+// of a feature at once without needing to reevaluate which bins are to be sampled and their sampling distributions on each iteration
+int										// returns number of bins to be sampled
+InitBinSamplers(tsThreadInstData *pThreadInst)
+{
+int BinIdx;
+tsAlignBin *pBin;
+tsBinSampler *pSampler;
+
+pThreadInst->NumBinSamplers = 0;
+pSampler = pThreadInst->BinSamplers;
+pBin = pThreadInst->pPoissonAlignBins;
+for(BinIdx = 0; BinIdx < m_NumBins; BinIdx++,pBin++)
+	{
+	if(pBin->ControlCoverage == 0 && pBin->ExperimentCoverage == 0)
+		continue;
+	pSampler->pBin = pBin;
+	pSampler->CtrlLambda = (int)pBin->ControlCnts;				// not using coverage
+	pSampler->pCtrlPoissons = PoissonSeq(pSampler->CtrlLambda,&pSampler->CtrlRange);
+	pSampler->ExprLambda = (int)pBin->ExperimentCnts;
+	pSampler->pExprPoissons = PoissonSeq(pSampler->ExprLambda,&pSampler->ExprRange);
+	pSampler += 1;
+	pThreadInst->NumBinSamplers += 1;
+	}
+return(pThreadInst->NumBinSamplers);
+}
+
+// PoissonBins
+// Poisson samples the control and experiment counts for all bins initialised by InitBinSamplers()
+void
+PoissonBins(tsThreadInstData *pThreadInst,
+			UINT32 *pSumCtrlCnts,		// returned sum of sampled control counts
+			UINT32 *pSumExprCnts)		// returned sum of sampled experiment counts
+{
+int Idx;
+UINT32 SumCtrlCnts;
+UINT32 SumExprCnts;
+tsBinSampler *pSampler;
+tsAlignBin *pBin;
+CSimpleRNG *pRNG;
+
+SumCtrlCnts = 0;
+SumExprCnts = 0;
+pRNG = pThreadInst->pSimpleRNG;
+pSampler = pThreadInst->BinSamplers;
+for(Idx = 0; Idx < pThreadInst->NumBinSamplers; Idx++,pSampler++)
+	{
+	pBin = pSampler->pBin;
+	if(pSampler->pCtrlPoissons != NULL)
+		pBin->ControlPoissonCnts = pSampler->pCtrlPoissons[pRNG->GetUint() % pSampler->CtrlRange];
+	else
+		pBin->ControlPoissonCnts = RandPoisson(pThreadInst,pSampler->CtrlLambda);
+	if(pSampler->pExprPoissons != NULL)
+		pBin->ExperimentPoissonCnts = pSampler->pExprPoissons[pRNG->GetUint() % pSampler->ExprRange];
+	else
+		pBin->ExperimentPoissonCnts = RandPoisson(pThreadInst,pSampler->ExprLambda);
+	SumCtrlCnts += pBin->ControlPoissonCnts;
+	SumExprCnts += pBin->ExperimentPoissonCnts;
+	}
+*pSumCtrlCnts = SumCtrlCnts;
+*pSumExprCnts = SumExprCnts;
+}
+
 
 int
 DECreateMutexes(void)
@@ -1540,8 +1699,10 @@ m_MRAChromID = 0;
 
 m_AllocdCtrlAlignReadsLoci = 0;
 m_CurNumCtrlAlignReadsLoci = 0;
+m_CurNumCtrlAlignedReads = 0;
 m_AllocdExprAlignReadsLoci = 0;
 m_CurNumExprAlignReadsLoci = 0;
+m_CurNumExprAlignedReads = 0;
 m_CurSumCtrlReadsLen = 0;
 m_CurSumExprReadsLen = 0;
 
@@ -1552,6 +1713,10 @@ m_AllocdAlignBins = 0;
 m_AllocBinInstStarts = 0;
 
 m_LimitAligned = 0;
+m_NumIdxRefSeqs = 0;
+m_NxtIdxRefSeq = 0;
+m_pIdxRefSeqs = NULL;
+m_IdxNumProcessed = 0;
 m_LibSizeNormExpToCtrl = cNormCntsScale;
 m_NumBins = 0;
 
@@ -1888,9 +2053,7 @@ for(ThreadInst = 1;ThreadInst <= (UINT32)m_NumDEThreads; ThreadInst++,pThreadIns
 	while(WAIT_TIMEOUT == WaitForSingleObject( pThreadInst->threadHandle, 60000 * 10))
 		{
 		// report on progress
-		DEAcquireSerialise();
 		NumFeaturesProcessed = m_NumFeaturesProcessed;
-		DEReleaseSerialise();
 		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u (%1.2f%%) features processed from %d loaded",NumFeaturesProcessed,(NumFeaturesProcessed * 100.0)/m_NumFeaturesLoaded,m_NumFeaturesLoaded);
 		}
 	CloseHandle( pThreadInst->threadHandle);
@@ -1902,9 +2065,7 @@ for(ThreadInst = 1;ThreadInst <= (UINT32)m_NumDEThreads; ThreadInst++,pThreadIns
 	while((JoinRlt = pthread_timedjoin_np(pThreadInst->threadID, NULL, &ts)) != 0)
 		{
 		// report on progress
-		DEAcquireSerialise();
 		NumFeaturesProcessed = m_NumFeaturesProcessed;
-		DEReleaseSerialise();
 		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Progress: %u (%1.2f%%) features processed from %d loaded",NumFeaturesProcessed,(NumFeaturesProcessed * 100.0)/m_NumFeaturesLoaded,m_NumFeaturesLoaded);
 		ts.tv_sec += 60;
 		}
@@ -2102,6 +2263,7 @@ int ArtifactFlankLen;
 DEInit();
 m_DEPMode = PMode;
 m_NumDEThreads = NumThreads;
+m_NumLoadThreads = min(NumThreads,cMaxBAMLoadThreads);
 m_LibSizeNormExpToCtrl = NormCntsScale;
 m_NumBins = NumBins;
 m_LimitAligned = LimitAligned;
@@ -2555,9 +2717,11 @@ while(GetFeats2Proc(pThreadInst))
 		DeltaNumProcessed = NumProcessed - PrevNumProcessed;
 		if(DeltaNumProcessed > 20)
 			{
-			DEAcquireSerialise();
-			m_NumFeaturesProcessed += DeltaNumProcessed;
-			DEReleaseSerialise();
+#ifdef _WIN32
+			InterlockedExchangeAdd((volatile LONG *)&m_NumFeaturesProcessed,DeltaNumProcessed);
+#else
+			__sync_fetch_and_add(&m_NumFeaturesProcessed,DeltaNumProcessed);
+#endif
 			PrevNumProcessed = NumProcessed;
 			}
 		}
@@ -2567,9 +2731,11 @@ while(GetFeats2Proc(pThreadInst))
 DeltaNumProcessed = NumProcessed - PrevNumProcessed;
 if(DeltaNumProcessed > 0)
 	{
-	DEAcquireSerialise();
-	m_NumFeaturesProcessed += DeltaNumProcessed;
-	DEReleaseSerialise();
+#ifdef _WIN32
+	InterlockedExchangeAdd((volatile LONG *)&m_NumFeaturesProcessed,DeltaNumProcessed);
+#else
+	__sync_fetch_and_add(&m_NumFeaturesProcessed,DeltaNumProcessed);
+#endif
 	}
 pThreadInst->Rslt = eBSFSuccess;
 #ifdef _WIN32
@@ -2757,25 +2923,23 @@ return(eBSFSuccess);
 }
 
 
-teBSFrsltCodes						// if > eBSFSuccess then read was silently sloughed because it was in an exclusion loci
-AddReadHit(int FileID,				// parsed from this file
-			bool bIsExperiment,		// true if this is an experimental read
-			char *pszChrom,			// hit to this chrom
-			char Strand,			// on this strand
-			int StartLoci,			// starts at this loci
-			int ReadLen)			// and is of this length
+// ReserveAlignReadLoci
+// Ensures that the control or experiment read alignment loci have been allocated to hold at least NumReq additional loci
+teBSFrsltCodes
+ReserveAlignReadLoci(bool bIsExperiment,	// true if reserving experiment loci, false if control
+			UINT32 NumReq)					// reserve for this many additional loci
 {
 size_t memreq;
 UINT8 *pTmpAlloc;
-UINT32 ChromID;
-tsAlignReadLoci *pAlignReadLoci;
+UINT32 ReallocLoci;
 
 if(bIsExperiment)
 	{
 	// need to allocate more memory?
-	if(m_CurNumExprAlignReadsLoci >= m_AllocdExprAlignReadsLoci)
+	if((m_CurNumExprAlignReadsLoci + NumReq) > m_AllocdExprAlignReadsLoci)
 		{
-		memreq = (m_AllocdExprAlignReadsLoci + cAlignReadsLociRealloc) * sizeof(tsAlignReadLoci);
+		ReallocLoci = max((UINT32)cAlignReadsLociRealloc,NumReq);
+		memreq = ((size_t)m_AllocdExprAlignReadsLoci + ReallocLoci) * sizeof(tsAlignReadLoci);
 	#ifdef _WIN32
 		pTmpAlloc = (UINT8 *) realloc(m_pExprAlignReadLoci,memreq);
 	#else
@@ -2790,16 +2954,17 @@ if(bIsExperiment)
 			return(eBSFerrMem);
 			}
 		m_pExprAlignReadLoci = (tsAlignReadLoci *)pTmpAlloc;
-		m_AllocdExprAlignReadsLoci += cAlignReadsLociRealloc;
+		m_AllocdExprAlignReadsLoci += ReallocLoci;
 		}
 
 	}
 else
 	{
 	// need to allocate more memory?
-	if(m_CurNumCtrlAlignReadsLoci >= m_AllocdCtrlAlignReadsLoci)
+	if((m_CurNumCtrlAlignReadsLoci + NumReq) > m_AllocdCtrlAlignReadsLoci)
 		{
-		memreq = (m_AllocdCtrlAlignReadsLoci + cAlignReadsLociRealloc) * sizeof(tsAlignReadLoci);
+		ReallocLoci = max((UINT32)cAlignReadsLociRealloc,NumReq);
+		memreq = ((size_t)m_AllocdCtrlAlignReadsLoci + ReallocLoci) * sizeof(tsAlignReadLoci);
 	#ifdef _WIN32
 		pTmpAlloc = (UINT8 *) realloc(m_pCtrlAlignReadLoci,memreq);
 	#else
@@ -2814,41 +2979,55 @@ else
 			return(eBSFerrMem);
 			}
 		m_pCtrlAlignReadLoci = (tsAlignReadLoci *)pTmpAlloc;
-		m_AllocdCtrlAlignReadsLoci += cAlignReadsLociRealloc;
+		m_AllocdCtrlAlignReadsLoci += ReallocLoci;
 		}
 	}
+return(eBSFSuccess);
+}
 
-// if read start covers a loci to be excluded then simply slough this read
-ChromID = ChromToID(pszChrom,true);
-if(Strand != '-')		// assume that if strand is not to crick '-' then must be to watson '+' or sense strand
-	Strand = '+';
+// IsExcludedRead
+// Returns true if read overlays an exclusion zone
+bool
+IsExcludedRead(UINT32 ChromID,		// read aligned to this chrom
+			char Strand,			// on this strand
+			int StartLoci,			// starts at this loci
+			int ReadLen)			// and is of this length
+{
+int ExclIdx;
+int EndLoci;
+tsExclZone *pExclLoci;
 
-if(m_NumExclZones > 0)			// if any exclusion zones loaded then need to check for reads to be excluded
+if(m_NumExclZones == 0)
+	return(false);
+EndLoci = StartLoci + ReadLen - 1;
+pExclLoci = m_pExclZones;
+for(ExclIdx = 0; ExclIdx < m_NumExclZones; ExclIdx++, pExclLoci++)
 	{
-	int ExclIdx;
-	int EndLoci = StartLoci + ReadLen - 1;
-	tsExclZone *pExclLoci = m_pExclZones;
-	for(ExclIdx = 0; ExclIdx < m_NumExclZones; ExclIdx++, pExclLoci++)
+	if(ChromID == pExclLoci->ChromID)
 		{
-		if(ChromID == pExclLoci->ChromID)
-			{
-			if(pExclLoci->Strand != '*' && pExclLoci->Strand != Strand)	// must match on strand?
-				continue;												// read strand not matching try next exclusion loci
-			if(StartLoci > pExclLoci->EndLoci)							// read starts after exclusion end loci so try next
-				continue;
-			if(EndLoci < pExclLoci->StartLoci)							// read ends before exclusion start loci so try next
-				continue;
-			m_NumExclReads += 1;										// this read has been excluded
-			return((teBSFrsltCodes)1);									// report read as being excluded
-			}
+		if(pExclLoci->Strand != '*' && pExclLoci->Strand != Strand)	// must match on strand?
+			continue;												// read strand not matching try next exclusion loci
+		if(StartLoci > pExclLoci->EndLoci)							// read starts after exclusion end loci so try next
+			continue;
+		if(EndLoci < pExclLoci->StartLoci)							// read ends before exclusion start loci so try next
+			continue;
+		return(true);
 		}
 	}
+return(false);
+}
 
-// need to ensure read starts are normalised to the strand from which that read aligned
-if(bIsExperiment)
-	pAlignReadLoci = &m_pExprAlignReadLoci[m_CurNumExprAlignReadsLoci++];
-else
-	pAlignReadLoci = &m_pCtrlAlignReadLoci[m_CurNumCtrlAlignReadsLoci++];
+// InitAlignReadLoci
+// Initialise read alignment loci normalising the read start to the strand from which that read aligned
+void
+InitAlignReadLoci(tsAlignReadLoci *pAlignReadLoci,	// initialise this loci
+			int FileID,				// parsed from this file
+			bool bIsExperiment,		// true if this is an experimental read
+			UINT32 ChromID,			// hit to this chrom
+			char Strand,			// on this strand
+			int StartLoci,			// starts at this loci
+			int ReadLen)			// and is of this length
+{
 memset(pAlignReadLoci,0,sizeof(tsAlignReadLoci));
 pAlignReadLoci->ExprFlag = bIsExperiment ? 1 : 0;
 pAlignReadLoci->ChromID = ChromID;
@@ -2860,12 +3039,49 @@ else
 pAlignReadLoci->FileID = FileID;
 pAlignReadLoci->NormCnts = 1;
 pAlignReadLoci->ReadLen = ReadLen;
+pAlignReadLoci->ArtCnts = 1;
+}
+
+teBSFrsltCodes						// if > eBSFSuccess then read was silently sloughed because it was in an exclusion loci
+AddReadHit(int FileID,				// parsed from this file
+			bool bIsExperiment,		// true if this is an experimental read
+			char *pszChrom,			// hit to this chrom
+			char Strand,			// on this strand
+			int StartLoci,			// starts at this loci
+			int ReadLen)			// and is of this length
+{
+teBSFrsltCodes Rslt;
+UINT32 ChromID;
+tsAlignReadLoci *pAlignReadLoci;
+
+if((Rslt = ReserveAlignReadLoci(bIsExperiment,1)) != eBSFSuccess)
+	return(Rslt);
+
+// if read start covers a loci to be excluded then simply slough this read
+ChromID = ChromToID(pszChrom,true);
+if(Strand != '-')		// assume that if strand is not to crick '-' then must be to watson '+' or sense strand
+	Strand = '+';
+
+if(m_NumExclZones > 0 && IsExcludedRead(ChromID,Strand,StartLoci,ReadLen))	// if any exclusion zones loaded then need to check for reads to be excluded
+	{
+	m_NumExclReads += 1;										// this read has been excluded
+	return((teBSFrsltCodes)1);									// report read as being excluded
+	}
+
+// need to ensure read starts are normalised to the strand from which that read aligned
 if(bIsExperiment)
+	{
+	pAlignReadLoci = &m_pExprAlignReadLoci[m_CurNumExprAlignReadsLoci++];
+	m_CurNumExprAlignedReads += 1;
 	m_CurSumExprReadsLen += ReadLen;
+	}
 else
+	{
+	pAlignReadLoci = &m_pCtrlAlignReadLoci[m_CurNumCtrlAlignReadsLoci++];
+	m_CurNumCtrlAlignedReads += 1;
 	m_CurSumCtrlReadsLen += ReadLen;
-
-pAlignReadLoci->ArtCnts = 1;
+	}
+InitAlignReadLoci(pAlignReadLoci,FileID,bIsExperiment,ChromID,Strand,StartLoci,ReadLen);
 return(eBSFSuccess);
 }
 
@@ -3235,6 +3451,322 @@ pTxt[2] = '\0';
 return(pStart);
 }
 
+// ClaimIdxRefSeq
+// Claim next indexed BAM reference sequence for loading, returns NULL if all reference sequences already claimed or load limit reached
+tsIdxRefSeq *
+ClaimIdxRefSeq(tsLoadBAMThreadPars *pPars)
+{
+tsIdxRefSeq *pRefSeq;
+DEAcquireSerialise();
+m_IdxNumProcessed += pPars->NumProcessed;
+pPars->NumProcessed = 0;
+if(m_NxtIdxRefSeq >= m_NumIdxRefSeqs || (m_LimitAligned > 0 && m_IdxNumProcessed > m_LimitAligned))
+	pRefSeq = NULL;
+else
+	pRefSeq = &m_pIdxRefSeqs[m_NxtIdxRefSeq++];
+DEReleaseSerialise();
+return(pRefSeq);
+}
+
+// LoadBAMRefSeq
+// Loads alignments to a single reference sequence from an indexed BAM
+// Start loci are accumulated into a thread local array which is then sorted and identical starts collapsed into counts before
+// the compacted loci are appended to the control or experiment read alignment loci
+teBSFrsltCodes
+LoadBAMRefSeq(tsLoadBAMThreadPars *pPars,	// loader thread parameters
+			CSAMfile *pBAMfile,				// indexed BAM
+			tsIdxRefSeq *pRefSeq,			// load alignments to this reference sequence
+			char *pszLine)					// line buffer, allocated to hold at least cMaxBAMLineLen chars
+{
+teBSFrsltCodes Rslt;
+int LineLen;
+int NameLen;
+char *pTxt;
+char *pFields[10];
+int Field;
+int Flags;
+int StartLoci;
+int ReadLen;
+char Strand;
+UINT32 ChromID;
+UINT32 NumLoci;
+UINT32 NumReads;
+UINT32 Idx;
+UINT64 SumReadsLen;
+tsAlignReadLoci *pCurLoci;
+tsAlignReadLoci *pSrcLoci;
+tsAlignReadLoci *pTmpAlloc;
+
+if((Rslt = (teBSFrsltCodes)pBAMfile->SeekRefSeq(pRefSeq->szChrom)) <= eBSFSuccess)
+	return(Rslt);				// no alignments to this reference sequence, or errors
+
+if((ChromID = ChromToID(pRefSeq->szChrom,true)) == 0)
+	return(eBSFerrMem);
+NameLen = (int)strlen(pRefSeq->szChrom);
+NumLoci = 0;
+NumReads = 0;
+SumReadsLen = 0;
+while((LineLen = pBAMfile->GetNxtSAMline(pszLine)) > 0)
+	{
+	// locate the tab separated fields: QNAME FLAG RNAME POS MAPQ CIGAR RNEXT PNEXT TLEN SEQ
+	pTxt = pszLine;
+	for(Field = 0; Field < 10; Field++)
+		{
+		pFields[Field] = pTxt;
+		if((pTxt = strchr(pTxt,'\t')) == NULL)
+			break;
+		pTxt += 1;
+		}
+	if(Field < 9)
+		continue;
+	if(strncmp(pFields[2],pRefSeq->szChrom,NameLen) || pFields[2][NameLen] != '\t')
+		break;					// alignments are sorted so onto alignments to a different reference sequence
+	Flags = atoi(pFields[1]);
+	StartLoci = atoi(pFields[3]);
+	if(Flags & 0x04 || StartLoci == 0)				// slough if unaligned
+		continue;
+	ReadLen = atoi(pFields[8]);
+	if(Field >= 9 && pFields[9][0] != '*')
+		{
+		pTxt = pFields[9];
+		for(ReadLen = 0; pTxt[ReadLen] != '\0' && !isspace(pTxt[ReadLen]); ReadLen++);
+		}
+
+	pPars->NumProcessed += 1;
+	StartLoci -= 1;					// SAM loci are 1..n whereas BED and CSV are 0..n
+	Strand = Flags & 0x010 ? '-' : '+';
+	if(pPars->FiltStrand != '*' && Strand != pPars->FiltStrand)
+		continue;
+	if(m_NumExclZones > 0 && IsExcludedRead(ChromID,Strand,StartLoci,ReadLen))
+		{
+		pPars->NumRdsExcluded += 1;
+		continue;
+		}
+
+	if(NumLoci == pPars->AllocLoci)
+		{
+		if((pTmpAlloc = (tsAlignReadLoci *)realloc(pPars->pLoci,sizeof(tsAlignReadLoci) * (size_t)pPars->AllocLoci * 2)) == NULL)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadBAMRefSeq: Memory reallocation to %lld bytes failed",(INT64)sizeof(tsAlignReadLoci) * (INT64)pPars->AllocLoci * 2);
+			return(eBSFerrMem);
+			}
+		pPars->pLoci = pTmpAlloc;
+		pPars->AllocLoci *= 2;
+		}
+	InitAlignReadLoci(&pPars->pLoci[NumLoci++],pPars->FileID,pPars->bIsExperiment,ChromID,Strand,StartLoci,ReadLen);
+	NumReads += 1;
+	SumReadsLen += ReadLen;
+	}
+if(LineLen < 0)
+	return((teBSFrsltCodes)LineLen);
+if(NumLoci == 0)
+	return(eBSFSuccess);
+
+// collapse reads starting at the same loci on the same strand into a single loci with counts, as coalescing would have done later
+if(NumLoci > 1)
+	{
+	qsort(pPars->pLoci,NumLoci,sizeof(tsAlignReadLoci),SortAlignments);
+	pCurLoci = pPars->pLoci;
+	pSrcLoci = pCurLoci + 1;
+	for(Idx = 1; Idx < NumLoci; Idx++,pSrcLoci++)
+		{
+		if(pSrcLoci->Loci == pCurLoci->Loci && pSrcLoci->Sense == pCurLoci->Sense)
+			{
+			pCurLoci->NormCnts += 1;
+			pCurLoci->ArtCnts = pCurLoci->NormCnts;
+			continue;
+			}
+		pCurLoci += 1;
+		if(pCurLoci != pSrcLoci)
+			*pCurLoci = *pSrcLoci;
+		}
+	NumLoci = (UINT32)(1 + pCurLoci - pPars->pLoci);
+	}
+
+DEAcquireSerialise();
+if((Rslt = ReserveAlignReadLoci(pPars->bIsExperiment,NumLoci)) == eBSFSuccess)
+	{
+	if(pPars->bIsExperiment)
+		{
+		memcpy(&m_pExprAlignReadLoci[m_CurNumExprAlignReadsLoci],pPars->pLoci,sizeof(tsAlignReadLoci) * NumLoci);
+		m_CurNumExprAlignReadsLoci += NumLoci;
+		m_CurNumExprAlignedReads += NumReads;
+		m_CurSumExprReadsLen += SumReadsLen;
+		}
+	else
+		{
+		memcpy(&m_pCtrlAlignReadLoci[m_CurNumCtrlAlignReadsLoci],pPars->pLoci,sizeof(tsAlignReadLoci) * NumLoci);
+		m_CurNumCtrlAlignReadsLoci += NumLoci;
+		m_CurNumCtrlAlignedReads += NumReads;
+		m_CurSumCtrlReadsLen += SumReadsLen;
+		}
+	}
+DEReleaseSerialise();
+return(Rslt);
+}
+
+#ifdef _WIN32
+unsigned __stdcall ThreadedLoadBAMproc(void * pThreadPars)
+#else
+void *ThreadedLoadBAMproc(void * pThreadPars)
+#endif
+{
+teBSFrsltCodes Rslt;
+int LineLen;
+tsIdxRefSeq *pRefSeq;
+char *pszLine;
+CSAMfile *pBAMfile;
+tsLoadBAMThreadPars *pPars = (tsLoadBAMThreadPars *)pThreadPars; // makes it easier not having to deal with casts!
+
+pPars->Rslt = (teBSFrsltCodes)-1;
+pszLine = NULL;
+pBAMfile = NULL;
+pPars->AllocLoci = cBAMChromLociInitalAlloc;
+if((pPars->pLoci = (tsAlignReadLoci *)malloc(sizeof(tsAlignReadLoci) * (size_t)pPars->AllocLoci)) == NULL ||
+	(pszLine = new char [cMaxBAMLineLen+1]) == NULL ||
+	(pBAMfile = new CSAMfile) == NULL)
+	Rslt = eBSFerrMem;
+else
+	Rslt = (teBSFrsltCodes)pBAMfile->Open(pPars->pszInFile);
+
+if(Rslt == eBSFSuccess)
+	{
+	// each thread has it's own BAM instance and needs to process the header before reference sequences can be located
+	while((LineLen = pBAMfile->GetNxtSAMline(pszLine)) > 0 && pszLine[0] == '@');
+	if(LineLen < 0)
+		Rslt = (teBSFrsltCodes)LineLen;
+	else
+		if(!pBAMfile->HasRefSeqIdx())
+			Rslt = eBSFerrFileAccess;
+	}
+
+while(Rslt >= eBSFSuccess && (pRefSeq = ClaimIdxRefSeq(pPars)) != NULL)
+	Rslt = LoadBAMRefSeq(pPars,pBAMfile,pRefSeq,pszLine);
+if(Rslt > eBSFSuccess)
+	Rslt = eBSFSuccess;
+
+DEAcquireSerialise();
+m_IdxNumProcessed += pPars->NumProcessed;
+DEReleaseSerialise();
+
+if(pBAMfile != NULL)
+	{
+	pBAMfile->Close();
+	delete pBAMfile;
+	}
+if(pszLine != NULL)
+	delete [] pszLine;
+if(pPars->pLoci != NULL)
+	{
+	free(pPars->pLoci);
+	pPars->pLoci = NULL;
+	}
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+// LoadAlignedReadsBAMIdx
+// Load aligned reads from a coordinate sorted and indexed BAM with reference sequences partitioned over multiple loader threads
+// Each thread has it's own BAM instance and, using the index, seeks directly to the alignments of the reference sequences it claims
+teBSFrsltCodes
+LoadAlignedReadsBAMIdx(bool bIsExperiment,		// false if control file, true if experiment
+			int FileID,						// uniquely identifies this file
+			char *pszInFile,				// indexed BAM file
+			char FiltStrand,				// process for this strand '+' or '-' or for both '*'
+			int NumRefSeqs,					// number of reference sequences
+			tsIdxRefSeq *pRefSeqs)			// reference sequences to be loaded
+{
+teBSFrsltCodes Rslt;
+int NumThreads;
+int ThreadIdx;
+UINT32 NumProcessed;
+UINT32 NumRdsExcluded;
+tsLoadBAMThreadPars *pThreads;
+tsLoadBAMThreadPars *pPars;
+
+NumThreads = min(m_NumLoadThreads,NumRefSeqs);
+if(NumThreads < 1)
+	NumThreads = 1;
+if((pThreads = new tsLoadBAMThreadPars [NumThreads]) == NULL)
+	return(eBSFerrMem);
+memset(pThreads,0,sizeof(tsLoadBAMThreadPars) * NumThreads);
+
+m_NumIdxRefSeqs = NumRefSeqs;
+m_NxtIdxRefSeq = 0;
+m_pIdxRefSeqs = pRefSeqs;
+m_IdxNumProcessed = 0;
+gDiagnostics.DiagOut(eDLInfo,gszProcName," BAM is indexed, loading alignments to %d reference sequences using %d threads",NumRefSeqs,NumThreads);
+
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+	pPars->ThreadIdx = ThreadIdx + 1;
+	pPars->bIsExperiment = bIsExperiment;
+	pPars->FileID = FileID;
+	pPars->pszInFile = pszInFile;
+	pPars->FiltStrand = FiltStrand;
+#ifdef _WIN32
+	pPars->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ThreadedLoadBAMproc,pPars,0,&pPars->threadID);
+#else
+	pPars->threadRslt =	pthread_create (&pPars->threadID, NULL , ThreadedLoadBAMproc , pPars );
+#endif
+	}
+
+Rslt = eBSFSuccess;
+NumProcessed = 0;
+NumRdsExcluded = 0;
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+#ifdef _WIN32
+	while(WAIT_TIMEOUT == WaitForSingleObject( pPars->threadHandle, 60000))
+		{
+		DEAcquireSerialise();
+		NumProcessed = m_IdxNumProcessed;
+		DEReleaseSerialise();
+		gDiagnostics.DiagOut(eDLInfo,gszProcName," Loading aligned read %u",NumProcessed);
+		}
+	CloseHandle( pPars->threadHandle);
+#else
+	struct timespec ts;
+	int JoinRlt;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += 60;
+	while((JoinRlt = pthread_timedjoin_np(pPars->threadID, NULL, &ts)) != 0)
+		{
+		DEAcquireSerialise();
+		NumProcessed = m_IdxNumProcessed;
+		DEReleaseSerialise();
+		gDiagnostics.DiagOut(eDLInfo,gszProcName," Loading aligned read %u",NumProcessed);
+		ts.tv_sec += 60;
+		}
+#endif
+	if(pPars->Rslt < eBSFSuccess && Rslt == eBSFSuccess)
+		Rslt = pPars->Rslt;
+	NumRdsExcluded += pPars->NumRdsExcluded;
+	}
+delete [] pThreads;
+NumProcessed = m_IdxNumProcessed;
+m_NumExclReads += NumRdsExcluded;
+m_NumIdxRefSeqs = 0;
+m_NxtIdxRefSeq = 0;
+m_pIdxRefSeqs = NULL;
+
+if(Rslt < eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadAlignedReadsBAMIdx: Errors loading reads from '%s'",pszInFile);
+	return(Rslt);
+	}
+if(!m_NumExclZones)
+	gDiagnostics.DiagOut(eDLInfo,gszProcName," Completed loading aligned reads %u",NumProcessed);
+else
+	gDiagnostics.DiagOut(eDLInfo,gszProcName," Completed loading aligned reads %u, %u acepted, %u were excluded because overlaying exclusion zone",NumProcessed,NumProcessed-NumRdsExcluded,NumRdsExcluded);
+return(eBSFSuccess);
+}
+
 // Load aligned reads from SAM/BAM alignment files
 teBSFrsltCodes
 LoadAlignedReadsSAM(bool bIsExperiment,		// false if control file, true if experiment
@@ -3261,6 +3793,12 @@ char szRNext[128];
 char *pTxt;
 int MAPQ;
 int PNext;
+int NumRefSeqs;
+int AllocRefSeqs;
+tsIdxRefSeq *pRefSeqs;
+tsIdxRefSeq *pTmpRefSeqs;
+bool bFirstAlignment;
+char Strand;
 
 CSAMfile BAMfile;
 
@@ -3272,11 +3810,54 @@ if((Rslt = BAMfile.Open(pszInFile)) != eBSFSuccess)
 	}
 NumProcessed = 0;
 NumRdsExcluded = 0;
+NumRefSeqs = 0;
+AllocRefSeqs = 0;
+pRefSeqs = NULL;
+bFirstAlignment = true;
 while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
 	{
 	if(m_LimitAligned > 0 && (UINT32)NumProcessed > m_LimitAligned)
 		break;
 
+	// retain the header reference sequence names in case the BAM is indexed and can be loaded by reference sequence
+	if(szLine[0] == '@')
+		{
+		if(!strncmp(szLine,"@SQ",3) && (pTxt = strstr(szLine,"SN:")) != NULL)
+			{
+			if(NumRefSeqs == AllocRefSeqs)
+				{
+				if((pTmpRefSeqs = (tsIdxRefSeq *)realloc(pRefSeqs,sizeof(tsIdxRefSeq) * (AllocRefSeqs + 1000))) == NULL)
+					{
+					gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadAlignedReadsSAM: Memory reallocation for reference sequence names failed");
+					if(pRefSeqs != NULL)
+						free(pRefSeqs);
+					BAMfile.Close();
+					return(eBSFerrMem);
+					}
+				pRefSeqs = pTmpRefSeqs;
+				AllocRefSeqs += 1000;
+				}
+			pTxt += 3;
+			for(LineLen = 0; LineLen < cMaxDatasetSpeciesChrom && pTxt[LineLen] != '\0' && !isspace(pTxt[LineLen]); LineLen++)
+				pRefSeqs[NumRefSeqs].szChrom[LineLen] = pTxt[LineLen];
+			pRefSeqs[NumRefSeqs++].szChrom[LineLen] = '\0';
+			}
+		continue;
+		}
+
+	if(bFirstAlignment)
+		{
+		// header has been processed, if an index is available then reference sequences can be loaded in parallel and starts compacted
+		bFirstAlignment = false;
+		if(m_LimitAligned == 0 && NumRefSeqs > 0 && BAMfile.HasRefSeqIdx())
+			{
+			BAMfile.Close();
+			Rslt = LoadAlignedReadsBAMIdx(bIsExperiment,FileID,pszInFile,FiltStrand,NumRefSeqs,pRefSeqs);
+			free(pRefSeqs);
+			return((teBSFrsltCodes)Rslt);
+			}
+		}
+
 	if(!(NumProcessed % 10000))
 		{
 		Now = gStopWatch.ReadUSecs();
@@ -3300,17 +3881,22 @@ while((LineLen = BAMfile.GetNxtSAMline(szLine)) > 0)
 	StartLoci -= 1;					// SAM loci are 1..n whereas BED and CSV are 0..n
 	if(szReadSeq[0] != '*')
 		TLen = (int)strlen(szReadSeq);
+	Strand = Flags & 0x010 ? '-' : '+';
+	if(FiltStrand != '*' && Strand != FiltStrand)
+		continue;
 
 	if((Rslt = AddReadHit(FileID,		// parsed from this file
 		    bIsExperiment,			// true if this is an experimental read
 			szChrom,				// hit to this chrom
-			Flags & 0x010 ? '-' : '+',					// on this strand
+			Strand,					// on this strand
 			StartLoci,				// starts at this loci
 			TLen))	// and is of this length
 			!= eBSFSuccess)
 		{
 		if(Rslt < eBSFSuccess)
 			{
+			if(pRefSeqs != NULL)
+				free(pRefSeqs);
 			BAMfile.Close();
 			return((teBSFrsltCodes)Rslt);
 			}
@@ -3323,6 +3909,8 @@ if(!m_NumExclZones)
 	gDiagnostics.DiagOut(eDLInfo,gszProcName," Completed loading aligned reads %d",NumProcessed);
 else
 	gDiagnostics.DiagOut(eDLInfo,gszProcName," Completed loading aligned reads %d, %d acepted, %d were excluded because overlaying exclusion zone",NumProcessed,NumProcessed-NumRdsExcluded,NumRdsExcluded);
+if(pRefSeqs != NULL)
+	free(pRefSeqs);
 BAMfile.Close();
 return(eBSFSuccess);
 }
@@ -3719,8 +4307,9 @@ if(m_pCtrlAlignReadLoci == NULL)
 		return(eBSFerrMem);
 		}
 #endif
-	m_AllocdExprAlignReadsLoci = cAlignReadsLociInitalAlloc;
+	m_AllocdCtrlAlignReadsLoci = cAlignReadsLociInitalAlloc;
 	m_CurNumCtrlAlignReadsLoci = 0;
+	m_CurNumCtrlAlignedReads = 0;
 	memset(m_pCtrlAlignReadLoci,0,sizeof(tsAlignReadLoci));
 	}
 
@@ -3748,6 +4337,7 @@ if(m_pExprAlignReadLoci == NULL)
 #endif
 	m_AllocdExprAlignReadsLoci = cAlignReadsLociInitalAlloc;
 	m_CurNumExprAlignReadsLoci = 0;
+	m_CurNumExprAlignedReads = 0;
 	memset(m_pExprAlignReadLoci,0,sizeof(tsAlignReadLoci));
 	}
 
@@ -3785,13 +4375,13 @@ for(Idx = 0; Idx < NumInputControlSpecs; Idx++)
 		}
 	}
 
-if(NumInputFilesProcessed == 0 || m_CurNumCtrlAlignReadsLoci == 0)
+if(NumInputFilesProcessed == 0 || m_CurNumCtrlAlignedReads == 0)
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadAlignedReadFiles: Failed to load any control read alignments from any file");
 	DEReset();
 	return(eBSFerrOpnFile);
 	}
-m_NumLoadedCtrlReads = m_CurNumCtrlAlignReadsLoci;
+m_NumLoadedCtrlReads = m_CurNumCtrlAlignedReads;
 m_MeanLenCtrlReads = (UINT32)( m_CurSumCtrlReadsLen / m_NumLoadedCtrlReads);
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: Accepted %d control aligned reads on strand '%c'",m_NumLoadedCtrlReads,Strand);
@@ -3828,7 +4418,7 @@ for(Idx = 0; Idx < NumInputExperimentSpecs; Idx++)
 		}
 	}
 
-m_NumLoadedExprReads = m_CurNumExprAlignReadsLoci;
+m_NumLoadedExprReads = m_CurNumExprAlignedReads;
 if(m_NumLoadedExprReads)
 	m_MeanLenExprReads = (UINT32)( m_CurSumExprReadsLen / m_NumLoadedExprReads);
 
@@ -3846,16 +4436,16 @@ gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: accepted total o
 	// finally, create sorted index by chrom, loci, strand, control over the loaded aligned reads
 if(m_CurNumCtrlAlignReadsLoci > 1)
 	{
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d control aligned reads...",m_NumLoadedCtrlReads);
-	m_mtqsort.qsort(m_pCtrlAlignReadLoci,m_NumLoadedCtrlReads,sizeof(tsAlignReadLoci),SortAlignments);
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d control aligned reads completed",m_NumLoadedCtrlReads);
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d control aligned read loci...",m_CurNumCtrlAlignReadsLoci);
+	m_mtqsort.qsort(m_pCtrlAlignReadLoci,m_CurNumCtrlAlignReadsLoci,sizeof(tsAlignReadLoci),SortAlignments);
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d control aligned read loci completed",m_CurNumCtrlAlignReadsLoci);
 	}
 
 if(m_CurNumExprAlignReadsLoci > 1)
 	{
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d experiment aligned reads...",m_NumLoadedExprReads);
-	m_mtqsort.qsort(m_pExprAlignReadLoci,m_NumLoadedExprReads,sizeof(tsAlignReadLoci),SortAlignments);
-	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d experiment aligned reads completed",m_NumLoadedExprReads);
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d experiment aligned read loci...",m_CurNumExprAlignReadsLoci);
+	m_mtqsort.qsort(m_pExprAlignReadLoci,m_CurNumExprAlignReadsLoci,sizeof(tsAlignReadLoci),SortAlignments);
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadAlignedReadFiles: sorting %d experiment aligned read loci completed",m_CurNumExprAlignReadsLoci);
 	}
 
 return(Rslt);
@@ -4323,14 +4913,12 @@ PearsonsPValue(tsThreadInstData *pThreadInst,	// thread instance
 		double *pFeatMedian)			// returned median for feature
 {
 int PermIter;
-int SrcIdx;
 int MaxNumPerms;
 int Supportive;
+int NumSigPValues;
 double *pPearson;
 double *pPValues;
 double *pFeatFoldChanges;
-tsAlignBin *pAlignBin;
-tsAlignBin *pSrcCnts;
 
 double ChiSqr;
 double PValue;
@@ -4358,31 +4946,33 @@ MaxNumPerms = m_NumBins * 2000;
 if(MaxNumPerms > MaxPerms)
 	MaxNumPerms = MaxPerms;
 
+SeedFeatureRNG(pThreadInst,pThreadInst->FeatureID);
+InitBinSamplers(pThreadInst);
+
 UINT32 TotPoissonCtrlLibCnts = 0;
 UINT32 TotPoissonExprLibCnts = 0;
 
 Supportive = 0;
+NumSigPValues = 0;
 pPearson = pThreadInst->pPearsons;
 pFeatFoldChanges = pThreadInst->pFeatFoldChanges;
 pPValues = pThreadInst->pPValues;
 for(PermIter = 0; PermIter < MaxNumPerms; PermIter++,pPearson++,pFeatFoldChanges++,pPValues++)
 	{
-	SumFeatCtrlPoissonCnts = 0;
-	SumFeatExprPoissonCnts = 0;
-	pAlignBin = pAlignBins;
-	pSrcCnts = pThreadInst->pPoissonAlignBins;
-	// for each bin
-	for(SrcIdx = 0; SrcIdx < m_NumBins; SrcIdx++,pSrcCnts++,pAlignBin++)
+	// adaptive early stopping: once the median PValue has been clearly resolved as being either below or above cResolvedPValue then
+	// further iterations are very unlikely to change the feature's characterisation so the remaining iterations are skipped
+	if(PermIter >= cMinConfidenceIterations && !(PermIter % cChkConfidenceIterations))
 		{
-		if(pAlignBin->ControlCoverage == 0 && pAlignBin->ExperimentCoverage == 0)
-			continue;
-
-		pSrcCnts->ControlPoissonCnts = RandPoisson(pThreadInst,pSrcCnts->ControlCnts);				// not using coverage
-		pSrcCnts->ExperimentPoissonCnts = RandPoisson(pThreadInst,pSrcCnts->ExperimentCnts);
-		SumFeatCtrlPoissonCnts += pSrcCnts->ControlPoissonCnts;
-		SumFeatExprPoissonCnts += pSrcCnts->ExperimentPoissonCnts;
+		double Deviation = fabs((double)NumSigPValues - (PermIter / 2.0));
+		if(Deviation >= (cResolvedPValueZ * sqrt((double)PermIter) / 2.0))
+			{
+			MaxNumPerms = PermIter;
+			break;
+			}
 		}
 
+	PoissonBins(pThreadInst,&SumFeatCtrlPoissonCnts,&SumFeatExprPoissonCnts);
+
 	CurPearson = PoissonPearsons(pThreadInst->pPoissonAlignBins);
 	*pPearson = CurPearson;
 
@@ -4418,6 +5008,8 @@ for(PermIter = 0; PermIter < MaxNumPerms; PermIter++,pPearson++,pFeatFoldChanges
 	*pPValues = pThreadInst->pStats->ChiSqr2PVal(1,ChiSqr);
 	if(*pPValues < 0.0)
 		*pPValues = 0.0;
+	if(*pPValues < cResolvedPValue)
+		NumSigPValues += 1;
 	}
 
 qsort(pThreadInst->pPearsons,MaxNumPerms,sizeof(double),SortDoubles);
@@ -4439,7 +5031,7 @@ else
 	PValue = (pThreadInst->pPValues[LowerIdx] + pThreadInst->pPValues[LowerIdx+1])/2.0;
 
 if(MaxNumPerms & 0x01)
-	*pFeatMedian = m_pFeatFoldChanges[LowerIdx];
+	*pFeatMedian = pThreadInst->pFeatFoldChanges[LowerIdx];
 else
 	*pFeatMedian = (pThreadInst->pFeatFoldChanges[LowerIdx] + pThreadInst->pFeatFoldChanges[LowerIdx+1])/2.0;
 
@@ -4631,10 +5223,13 @@ UINT32 *pExprBin;
 UINT32 BinLen;
 int Idx;
 
-DEAcquireSerialise();
-pFeatDE = &m_pFeatDEs[m_NumFeatsDEd++];
-CurFeatID = m_NumFeatsDEd;
-DEReleaseSerialise();
+// each feature is processed into its own exclusively claimed slot so no serialisation is required
+#ifdef _WIN32
+CurFeatID = InterlockedIncrement((volatile LONG *)&m_NumFeatsDEd);
+#else
+CurFeatID = __sync_add_and_fetch(&m_NumFeatsDEd,1);
+#endif
+pFeatDE = &m_pFeatDEs[CurFeatID-1];
 
 memset(pFeatDE,0,sizeof(tsFeatDE));
 strcpy(pFeatDE->szFeatName,pszFeatName);
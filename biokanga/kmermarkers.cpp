@@ -33,7 +33,9 @@ KmerMarkers(etPMode PMode,				// processing mode - defaults to 0
 		  int SuffixLen,				// cultivar specific suffix length
 		  int MinWithPrefix,			// minimum number of cultivars required to have the shared prefix
 		  int MaxHomozygotic,			// only report prefixes if K-Mer suffixes are homozygotic between a maximum of this many cultivars, if 0 then no homozygotic check
-		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar
+		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar, NULL if K-mers to be partitioned from pszInSeqFiles
+		  int NumInSeqFiles,			// number of cultivar sequence file specs
+		  char *pszInSeqFiles[],		// cultivar sequence files, each fasta entry is a cultivar pseudo-chromosome
 		  char *pszMarkerFile,			// output potential markers to this file
 		  int NumThreads);				// max number of threads allowed
 
@@ -65,6 +67,9 @@ int MinWithPrefix;			// report on K-mers with prefixes shared between at least t
 int MaxHomozygotic;			// only report prefixes if all K-Mer suffixes are homozygotic between a maximum of this many cultivars, if 0 then no homozygotic check
 
 char szSfxPseudoGenome[_MAX_PATH];		// contains assembly + suffix array over all psuedo-chromosomes for all cultivars
+int NumInSeqFiles;						// number of cultivar sequence file specs
+char *pszInSeqFiles[cMaxKMerInSeqFiles];	// cultivar sequence files, each fasta entry is a cultivar pseudo-chromosome
+int Idx;
 char szMarkerFile[_MAX_PATH];			// output potential markers to this file
 
 char szSQLiteDatabase[_MAX_PATH];	// results summaries to this SQLite file
@@ -82,7 +87,8 @@ struct arg_int *kmerlen = arg_int0("k","kmer","<int>",			"K-mers of this length
 struct arg_int *prefixlen = arg_int0("p","prefixlen","<int>",	"K-mer prefix sequences of this length (defaults to K-mer length specified");
 struct arg_int *minwithprefix = arg_int0("s","minshared","<int>","Inter-cultivar shared prefix sequences must be present in this many cultivars (0 default all)");
 struct arg_int *maxhomozygotic = arg_int0("S","maxhomozygotic","<int>","Only report prefix if all suffixes are homozygotic between at most this many different cultivars, if 0 then no check, default 1");
-struct arg_file *infile = arg_file1("i","in","<file>",		    "Use this suffix indexed pseudo-chromosomes file");
+struct arg_file *infile = arg_file0("i","in","<file>",		    "Use this suffix indexed pseudo-chromosomes file");
+struct arg_file *inseqs = arg_filen("I","inseqs","<file>",0,cMaxKMerInSeqFiles,"Alternatively, count K-mers without a suffix index from these multifasta pseudo-chromosome files, each entry is a cultivar, wildcards allowed");
 struct arg_file *outfile = arg_file1("o","markers","<file>",	"Output accepted marker K-mer sequences to this multifasta file");
 struct arg_int *numthreads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
@@ -93,7 +99,7 @@ struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
-	                pmode,kmerlen,prefixlen,minwithprefix,maxhomozygotic,infile,outfile,
+	                pmode,kmerlen,prefixlen,minwithprefix,maxhomozygotic,infile,inseqs,outfile,
 					numthreads,
 					end};
 
@@ -292,14 +298,44 @@ if (!argerrors)
 	else
 		MaxHomozygotic = 0;
 
-	strcpy(szSfxPseudoGenome,infile->filename[0]);
-	CUtility::TrimQuotedWhitespcExtd(szSfxPseudoGenome);
-	if(strlen(szSfxPseudoGenome) < 1)
+	if((infile->count > 0) == (inseqs->count > 0))
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Expected input pseudo-genome suffix array filename '-i<name>' is empty");
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Either input pseudo-genome suffix array '-i<name>' or cultivar pseudo-chromosome sequence files '-I<files>' must be specified, but not both");
 		return(1);
 		}
 
+	szSfxPseudoGenome[0] = '\0';
+	NumInSeqFiles = 0;
+	if(infile->count)
+		{
+		strcpy(szSfxPseudoGenome,infile->filename[0]);
+		CUtility::TrimQuotedWhitespcExtd(szSfxPseudoGenome);
+		if(strlen(szSfxPseudoGenome) < 1)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: Expected input pseudo-genome suffix array filename '-i<name>' is empty");
+			return(1);
+			}
+		}
+	else
+		{
+		for(Idx = 0; NumInSeqFiles < cMaxKMerInSeqFiles && Idx < inseqs->count; Idx++)
+			{
+			pszInSeqFiles[Idx] = NULL;
+			if(pszInSeqFiles[NumInSeqFiles] == NULL)
+				pszInSeqFiles[NumInSeqFiles] = new char [_MAX_PATH];
+			strncpy(pszInSeqFiles[NumInSeqFiles],inseqs->filename[Idx],_MAX_PATH);
+			pszInSeqFiles[NumInSeqFiles][_MAX_PATH-1] = '\0';
+			CUtility::TrimQuotedWhitespcExtd(pszInSeqFiles[NumInSeqFiles]);
+			if(pszInSeqFiles[NumInSeqFiles][0] != '\0')
+				NumInSeqFiles++;
+			}
+		if(!NumInSeqFiles)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Error: After removal of whitespace, no cultivar pseudo-chromosome sequence files specified with '-I<filespec>' option");
+			return(1);
+			}
+		}
+
 	strcpy(szMarkerFile,outfile->filename[0]);
 	CUtility::TrimQuotedWhitespcExtd(szMarkerFile);
 	if(strlen(szMarkerFile) < 1)
@@ -337,7 +373,11 @@ if (!argerrors)
 			gDiagnostics.DiagOutMsgOnly(eDLInfo,"Maximum number of cultivars with homozygotic suffixes: 'Not checked'");
 		}
 
-	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Input indexed pseudo-genome file: '%s'",szSfxPseudoGenome);
+	if(NumInSeqFiles)
+		for(Idx = 0; Idx < NumInSeqFiles; Idx++)
+			gDiagnostics.DiagOutMsgOnly(eDLInfo,"Input cultivar pseudo-chromosome sequence files (%d): '%s'",Idx+1,pszInSeqFiles[Idx]);
+	else
+		gDiagnostics.DiagOutMsgOnly(eDLInfo,"Input indexed pseudo-genome file: '%s'",szSfxPseudoGenome);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Write marker K-mers to file: '%s'",szMarkerFile);
 
 	if(szExperimentName[0] != '\0')
@@ -362,7 +402,11 @@ if (!argerrors)
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumThreads),"threads",&NumThreads);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTInt32,sizeof(NumberOfProcessors),"cpus",&NumberOfProcessors);
 
-		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(szSfxPseudoGenome),"in",szSfxPseudoGenome);
+		if(NumInSeqFiles)
+			for(Idx = 0; Idx < NumInSeqFiles; Idx++)
+				ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(pszInSeqFiles[Idx]),"inseqs",pszInSeqFiles[Idx]);
+		else
+			ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(szSfxPseudoGenome),"in",szSfxPseudoGenome);
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(szMarkerFile),"markers",szMarkerFile);
 		
 		ParamID = gSQLiteSummaries.AddParameter(gProcessingID,ePTText,(int)strlen(szSQLiteDatabase),"sumrslts",szSQLiteDatabase);
@@ -375,7 +419,9 @@ if (!argerrors)
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = KmerMarkers((etPMode)PMode,KMerLen,PrefixLen,SuffixLen,MinWithPrefix,MaxHomozygotic,szSfxPseudoGenome,szMarkerFile,NumThreads);
+	Rslt = KmerMarkers((etPMode)PMode,KMerLen,PrefixLen,SuffixLen,MinWithPrefix,MaxHomozygotic,NumInSeqFiles ? NULL : szSfxPseudoGenome,NumInSeqFiles,pszInSeqFiles,szMarkerFile,NumThreads);
+	for(Idx = 0; Idx < NumInSeqFiles; Idx++)
+		delete [] pszInSeqFiles[Idx];
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -404,14 +450,16 @@ KmerMarkers(etPMode PMode,				// processing mode - defaults to 0
 		  int SuffixLen,				// cultivar specific suffix length
 		  int MinWithPrefix,			// minimum number of cultivars required to have the shared prefix
 		  int MaxHomozygotic,			// only report prefixes if K-Mer suffixes are homozygotic between a maximum of this many cultivars, if 0  then no check
-		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar
+		  char *pszSfxPseudoGenome,		// contains pregenerated suffix over psuedochromosomes for each cultivar, NULL if K-mers to be partitioned from pszInSeqFiles
+		  int NumInSeqFiles,			// number of cultivar sequence file specs
+		  char *pszInSeqFiles[],		// cultivar sequence files, each fasta entry is a cultivar pseudo-chromosome
 		  char *pszMarkerFile,			// output potential markers to this file
 		  int NumThreads)				// max number of threads allowed
 {
 int Rslt;
 CMarkerKMers Markers;
 
-Rslt = Markers.LocKMers(PMode,KMerLen,PrefixLen,SuffixLen,MinWithPrefix,MaxHomozygotic,pszSfxPseudoGenome,pszMarkerFile,NumThreads);
+Rslt = Markers.LocKMers(PMode,KMerLen,PrefixLen,SuffixLen,MinWithPrefix,MaxHomozygotic,pszSfxPseudoGenome,NumInSeqFiles,pszInSeqFiles,pszMarkerFile,NumThreads);
 
 Markers.Reset();
 return(Rslt);
@@ -33,7 +33,8 @@ int MLFProcess(etMLFPMode PMode,		// processing mode
 			int RegRegionLen,			// regulatory region length
 			int MinLength,				// minimum element length
 			int MaxLength,				// maximum element length
-			int JoinOverlap);			// deduping join overlap
+			int JoinOverlap,			// deduping join overlap
+			int NumThreads);			// number of worker threads
 
 char *CSVFormat2Text(teCSVFormat Format);
 
@@ -68,6 +69,8 @@ bool bFeatinsts;			// if true then associate to individual features
 bool bOneCntRead;			// true if one count per read rule to be applied (functional regions are prioritised with CDS as the highest) 
 etISOFProc IsoformRprt;			// feature isoform report processing
 etStrandProc StrandProc;	// how to process read + element strand
+int NumberOfProcessors;		// number of installed CPUs
+int NumThreads;				// number of threads (0 defaults to number of CPUs)
 
 char szInLociFile[_MAX_PATH];	// input element loci from this file
 char szInBEDFile[_MAX_PATH];	// input bed file containing gene features
@@ -107,13 +110,14 @@ struct arg_lit  *onecntread   = arg_lit0("y","onecntread",       "prioritise fun
 struct arg_file *summrslts = arg_file0("q","sumrslts","<file>",		"Output results summary to this SQLite3 database file");
 struct arg_str *experimentname = arg_str0("w","experimentname","<str>",		"experiment name SQLite3 database file");
 struct arg_str *experimentdescr = arg_str0("W","experimentdescr","<str>",	"experiment description SQLite3 database file");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
 struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					summrslts,experimentname,experimentdescr,
 					pmode,dedupe,ftype,featinsts,isoformrprt,onecntread,strandproc,CSVFormat,InLociFile,InBEDFile,RsltsFile,featrsltsfile,summrsltsfile,RegLen,
-					MinLength,MaxLength,JoinOverlap,
+					MinLength,MaxLength,JoinOverlap,threads,
 					end};
 
 char **pAllArgs;
@@ -366,6 +370,23 @@ if (!argerrors)
 	else
 		szSummRsltsFile[0] = '\0';
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 // show user current resource limits
 #ifndef _WIN32
 	gDiagnostics.DiagOut(eDLInfo, gszProcName, "Resources: %s",CUtility::ReportResourceLimits());
@@ -447,6 +468,7 @@ if (!argerrors)
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Minimum element length: %d",iMinLength);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Maximum element length: %d",iMaxLength);
 	gDiagnostics.DiagOutMsgOnly(eDLInfo,"Join overlap: %d",iJoinOverlap);
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 	if(szExperimentName[0] != '\0')
 		gDiagnostics.DiagOutMsgOnly(eDLInfo,"This processing reference: %s",szExperimentName);
@@ -455,7 +477,7 @@ if (!argerrors)
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = MLFProcess((etMLFPMode)PMode,bDedupe,bFeatinsts,bOneCntRead,IsoformRprt,StrandProc,FType,(teCSVFormat)iCSVFormat,szInLociFile,szInBEDFile,szRsltsFile,szFeatRsltsFile,szSummRsltsFile,iRegLen,iMinLength,iMaxLength,iJoinOverlap);
+	Rslt = MLFProcess((etMLFPMode)PMode,bDedupe,bFeatinsts,bOneCntRead,IsoformRprt,StrandProc,FType,(teCSVFormat)iCSVFormat,szInLociFile,szInBEDFile,szRsltsFile,szFeatRsltsFile,szSummRsltsFile,iRegLen,iMinLength,iMaxLength,iJoinOverlap,NumThreads);
 	Rslt = Rslt >=0 ? 0 : 1;
 	if(gExperimentID > 0)
 		{
@@ -508,7 +530,8 @@ int MLFProcess(etMLFPMode PMode,				// processing mode
 			   int RegRegionLen,			// regulatory region length
 			   int MinLength,				// minimum element length
 			   int MaxLength,				// maximum element length
-			   int JoinOverlap)			// deduping join overlap
+			   int JoinOverlap,			// deduping join overlap
+			   int NumThreads)			// number of worker threads
 {
 int Rslt;
 CMapLoci2Feat *pMapLoci2Feat;
@@ -518,7 +541,7 @@ if((pMapLoci2Feat = new CMapLoci2Feat) == NULL)
 	return(eBSFerrObj);
 	}
 Rslt = pMapLoci2Feat->MLFProcess(PMode, bDedupe, bFeatinsts, bOneCntRead, IsoformRprt, StrandProc, Ftype, CSVFormat, pszInLociFile, pszInBEDFile, pszRsltsFile,
-						  pszFeatRsltsFile, pszSummRsltsFile, RegRegionLen, MinLength, MaxLength, JoinOverlap);
+						  pszFeatRsltsFile, pszSummRsltsFile, RegRegionLen, MinLength, MaxLength, JoinOverlap, NumThreads);
 delete pMapLoci2Feat;
 return(Rslt);
 }
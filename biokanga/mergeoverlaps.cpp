@@ -44,7 +44,8 @@ Process(etPMode PMode,				// processing mode
 		char **pszInPE5Files,		// input single ended or 5' end if paired end reads files
 		int NumInPE3Files,			// number of input input 3' end if paired end reads files
 		char **pszInPE3Files,		// input 3' end if paired end reads files
-		char *pszMergeOutFile);		// output file
+		char *pszMergeOutFile,		// output file
+		int NumThreads);			// number of worker threads
 
 
 #ifdef _WIN32
@@ -76,6 +77,8 @@ char *pszInPE5Files[cMaxInFileSpecs];			// input single ended or 5' end if paire
 int NumInPE3Files;								// number of input input 3' end if paired end reads files
 char *pszInPE3Files[cMaxInFileSpecs];			// input 3' end if paired end reads files
 char szOutCtgsFile[_MAX_PATH];					// output assembled contigs file
+int NumberOfProcessors;							// number of installed CPUs
+int NumThreads;									// number of threads (0 defaults to number of CPUs)
 
 // command line args
 struct arg_lit  *help    = arg_lit0("hH","help",                "print this help and exit");
@@ -91,13 +94,14 @@ struct arg_int *naxsubperc = arg_int0("s","maxsubperc","<int>",	"allow at most t
 
 struct arg_file *inpe5files = arg_filen("i","inpe5","<file>",1,cMaxInFileSpecs, "input P1 5' end raw read files (wildcards not allowed, fasta or fastq)");
 struct arg_file *inpe3files = arg_filen("I","inpe3","<file>",1,cMaxInFileSpecs, "input P2 3' end raw read files (wildcards not allowed, fasta or fastq)");
-struct arg_file *outctgsfile = arg_file1("o","outctgsfile","<file>", "output merged pair sequences to this file");
+struct arg_file *outctgsfile = arg_file1("o","outctgsfile","<file>", "output merged pair sequences to this file (gzip compressed if file name has '.gz' extension)");
+struct arg_int *threads = arg_int0("T","threads","<int>",		"number of processing threads 0..128 (defaults to 0 which sets threads to number of CPU cores)");
 
 struct arg_end *end = arg_end(200);
 
 void *argtable[] = {help,version,FileLogLevel,LogFile,
 					pmode,oformat,minoverlap,naxsubperc,
-					inpe5files,inpe3files,outctgsfile,
+					inpe5files,inpe3files,outctgsfile,threads,
 					end};
 
 char **pAllArgs;
@@ -245,6 +249,23 @@ if (!argerrors)
 
 	strcpy(szOutCtgsFile,outctgsfile->filename[0]);					// output file
 
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	NumberOfProcessors = SystemInfo.dwNumberOfProcessors;
+#else
+	NumberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+	int MaxAllowedThreads = min(cMaxWorkerThreads,NumberOfProcessors);	// limit to be at most cMaxWorkerThreads
+	if((NumThreads = threads->count ? threads->ival[0] : MaxAllowedThreads)==0)
+		NumThreads = MaxAllowedThreads;
+	if(NumThreads < 0 || NumThreads > MaxAllowedThreads)
+		{
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Number of threads '-T%d' specified was outside of range %d..%d",NumThreads,1,MaxAllowedThreads);
+		gDiagnostics.DiagOut(eDLWarn,gszProcName,"Warning: Defaulting number of threads to %d",MaxAllowedThreads);
+		NumThreads = MaxAllowedThreads;
+		}
+
 // show user current resource limits
 #ifndef _WIN32
 	gDiagnostics.DiagOut(eDLInfo, gszProcName, "Resources: %s",CUtility::ReportResourceLimits());
@@ -327,13 +348,14 @@ if (!argerrors)
 			gDiagnostics.DiagOutMsgOnly(eDLInfo, "output PE sequences file prefix: '%s'", szOutCtgsFile);
 			break;
 		}
+	gDiagnostics.DiagOutMsgOnly(eDLInfo,"number of threads : %d",NumThreads);
 
 
 #ifdef _WIN32
 	SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
 #endif
 	gStopWatch.Start();
-	Rslt = Process(PMode,OFormat,MinOverlap,MaxSubPerc,NumInPE5Files,pszInPE5Files,NumInPE3Files,pszInPE3Files,szOutCtgsFile);
+	Rslt = Process(PMode,OFormat,MinOverlap,MaxSubPerc,NumInPE5Files,pszInPE5Files,NumInPE3Files,pszInPE3Files,szOutCtgsFile,NumThreads);
 	gStopWatch.Stop();
 	Rslt = Rslt >=0 ? 0 : 1;
 	gDiagnostics.DiagOut(eDLInfo,gszProcName,"Exit code: %d Total processing time: %s",Rslt,gStopWatch.Read());
@@ -359,7 +381,8 @@ Process(etPMode PMode,				// processing mode
 		char **pszInPE5Files,		// input single ended or 5' end if paired end reads files
 		int NumInPE3Files,			// number of input input 3' end if paired end reads files
 		char **pszInPE3Files,		// input 3' end if paired end reads files
-		char *pszMergeOutFile)		// output file
+		char *pszMergeOutFile,		// output file
+		int NumThreads)				// number of worker threads
 {
 int Rslt;
 CMergeReadPairs *pMergeReads = NULL;
@@ -369,7 +392,7 @@ if((pMergeReads = new CMergeReadPairs()) == NULL)
 	return(-1);
 	}
 
-Rslt = pMergeReads->MergeOverlaps(PMode,OFormat,MinOverlap,MaxSubPerc,NumInPE5Files,pszInPE5Files,NumInPE3Files,pszInPE3Files,pszMergeOutFile);
+Rslt = pMergeReads->MergeOverlaps(PMode,OFormat,MinOverlap,MaxSubPerc,NumInPE5Files,pszInPE5Files,NumInPE3Files,pszInPE3Files,pszMergeOutFile,1,false,NumThreads);
 delete pMergeReads;
 
 return(Rslt);
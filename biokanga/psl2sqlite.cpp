@@ -14,6 +14,7 @@
 #endif
 
 #include "biokanga.h"
+#include "SQLiteBulk.h"
 #include "SQLitePSL.h"
 
 int 
@@ -321,6 +321,7 @@ int BuffLen;
 int BuffOfs;
 UINT8 *pSrcSeq;							// used when copying read sequence (src) into concatenated sequence (dst)
 tsBSFRdsHdr RdsHdr;
+CRdsBlocks RdsBlocks;					// V7 block indexed sequences are returned in the V6 format
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Loading sequences from: %s",pszFile);
 
@@ -373,6 +374,12 @@ if(RdsHdr.FlagsCS)
 	return(eBSFerrOpnFile);
 	}
 
+if(RdsHdr.Version >= 7 && (Rslt = (teBSFrsltCodes)RdsBlocks.Open(pszFile)) != eBSFSuccess)
+	{
+	Reset(false);
+	return(Rslt);
+	}
+
 m_RdsSfxHdr.RdsSrcFiles[m_RdsSfxHdr.NumSrcFiles].SrcFileID = FileID;
 strncpy((char *)m_RdsSfxHdr.RdsSrcFiles[m_RdsSfxHdr.NumSrcFiles].SrcFileName,pszFile,sizeof(m_RdsSfxHdr.RdsSrcFiles[m_RdsSfxHdr.NumSrcFiles].SrcFileName)-1);
 
@@ -387,7 +394,7 @@ SizeOfRawRead = RdsHdr.Version < 6 ? sizeof(tsRawReadV5) : sizeof(tsRawReadV6);
 
 // iterate each read sequence starting from the first
 lseek(m_hInFile,(long)RdsHdr.RdsOfs,SEEK_SET);
-while((RdLen = read(m_hInFile,&ReadBuff[BuffLen],sizeof(ReadBuff) - BuffLen)) > 0)
+while((RdLen = (RdsHdr.Version >= 7 ? RdsBlocks.ReadV6(&ReadBuff[BuffLen],sizeof(ReadBuff) - BuffLen) : read(m_hInFile,&ReadBuff[BuffLen],sizeof(ReadBuff) - BuffLen))) > 0)
 	{
 	BuffLen += RdLen;
 	BuffOfs = 0;
@@ -482,6 +489,11 @@ while((RdLen = read(m_hInFile,&ReadBuff[BuffLen],sizeof(ReadBuff) - BuffLen)) >
 	}
 close(m_hInFile);		// reads all loaded from the .rds file so can now close
 m_hInFile = -1;
+if(RdLen < 0 && Rslt == eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadContigs: Errors whilst reading sequences from '%s'",pszFile);
+	Rslt = eBSFerrFileAccess;
+	}
 
 NumAcceptedContigs = NumContigs - (NumUnderlen + NumExcessNs);
 m_TotSeqsParsed += NumContigs;
@@ -20,6 +20,7 @@ m_pChromNames = NULL;		// pts to array of tsBEDchromname's sorted by chromid
 m_pFeatures = NULL;			// pts to array of tsBEDfeature's sorted by name-->chromid-->start-->end
 m_ppFeatureNames = NULL; // sorted (by name->chrom->start->end) array of ptrs into m_pFeatures
 m_ppFeatureChromStarts = NULL; // sorted (by chrom->start->end) array of ptrs into m_pFeatures
+m_pFeatMaxEnds = NULL;
 m_pChromHashes = NULL;
 m_hFile = -1;
 Reset(false);
@@ -197,6 +198,12 @@ if(m_ppFeatureChromStarts != NULL)
 	m_ppFeatureChromStarts = NULL;
 	}
 
+if(m_pFeatMaxEnds != NULL)
+	{
+	delete [] m_pFeatMaxEnds;
+	m_pFeatMaxEnds = NULL;
+	}
+
 if(m_pChromHashes != NULL)
 	{
 	delete m_pChromHashes;
@@ -1231,10 +1238,100 @@ for(Idx = 0; Idx < m_FileHdr.NumFeatures; Idx++)
 	if(FeatLen > pChrom->MaxFeatLen)
 		pChrom->MaxFeatLen = FeatLen;
 	}
+
+if(BuildOverlapIndex() != eBSFSuccess)
+	{
+	delete m_ppFeatureChromStarts;
+	m_ppFeatureChromStarts = NULL;
+	delete m_ppFeatureNames;
+	m_ppFeatureNames = NULL;
+	return(eBSFerrMem);
+	}
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Sort optimisation completed");
 return(eBSFSuccess);
 }
 
+// BuildOverlapIndex
+// Features in m_ppFeatureChromStarts are sorted by chrom->start->end so each chromosome's features
+// can be treated as the in-order layout of an implicit binary tree: leaves at even indexes, node at
+// index i of level k having children at i -/+ 2^(k-1). Each node is augmented in m_pFeatMaxEnds with
+// the maximum feature end in its subtree so overlap queries can prune subtrees ending before the query
+// start - locating all overlaps then costs O(log n + overlaps) irrespective of MaxFeatLen
+teBSFrsltCodes
+CBEDfile::BuildOverlapIndex(void)
+{
+int ChromIdx;
+INT64 Idx;
+INT64 NumFeats;
+INT64 LastIdx;
+INT64 HalfStep;
+INT64 Step;
+int Level;
+INT32 LastMax;
+INT32 MaxEnd;
+INT32 ChildMax;
+INT32 *pMaxEnds;
+tsBEDfeature **ppFeats;
+tsBEDchromname *pChrom;
+
+if(m_pFeatMaxEnds != NULL)
+	{
+	delete [] m_pFeatMaxEnds;
+	m_pFeatMaxEnds = NULL;
+	}
+if(!m_FileHdr.NumFeatures || m_ppFeatureChromStarts == NULL)
+	return(eBSFSuccess);
+
+if((m_pFeatMaxEnds = new INT32 [m_FileHdr.NumFeatures])==NULL)
+	{
+	AddErrMsg("CBEDfile::BuildOverlapIndex","Unable to alloc memory to hold %d feature max ends",m_FileHdr.NumFeatures);
+	return(eBSFerrMem);
+	}
+
+pChrom = m_pChromNames;
+for(ChromIdx = 0; ChromIdx < m_FileHdr.NumChroms; ChromIdx++,pChrom++)
+	{
+	if(!pChrom->NumFeatures || pChrom->FirstStartID < 1)
+		continue;
+	NumFeats = pChrom->NumFeatures;
+	ppFeats = &m_ppFeatureChromStarts[pChrom->FirstStartID-1];
+	pMaxEnds = &m_pFeatMaxEnds[pChrom->FirstStartID-1];
+
+	// leaves
+	LastIdx = 0;
+	LastMax = 0;
+	for(Idx = 0; Idx < NumFeats; Idx += 2)
+		{
+		LastIdx = Idx;
+		LastMax = pMaxEnds[Idx] = ppFeats[Idx]->End;
+		}
+	for(Idx = 1; Idx < NumFeats; Idx += 2)		// level 1 and above are initialised as they are processed
+		pMaxEnds[Idx] = ppFeats[Idx]->End;
+
+	// internal nodes, bottom up; right children beyond the last feature take the max of the rightmost populated node
+	for(Level = 1; ((INT64)1 << Level) <= NumFeats; Level++)
+		{
+		HalfStep = (INT64)1 << (Level - 1);
+		Step = HalfStep << 2;
+		for(Idx = (HalfStep << 1) - 1; Idx < NumFeats; Idx += Step)
+			{
+			MaxEnd = ppFeats[Idx]->End;
+			ChildMax = pMaxEnds[Idx - HalfStep];
+			if(ChildMax > MaxEnd)
+				MaxEnd = ChildMax;
+			ChildMax = Idx + HalfStep < NumFeats ? pMaxEnds[Idx + HalfStep] : LastMax;
+			if(ChildMax > MaxEnd)
+				MaxEnd = ChildMax;
+			pMaxEnds[Idx] = MaxEnd;
+			}
+		LastIdx = (LastIdx >> Level) & 0x01 ? LastIdx - HalfStep : LastIdx + HalfStep;	// parent of previous LastIdx
+		if(LastIdx < NumFeats && pMaxEnds[LastIdx] > LastMax)
+			LastMax = pMaxEnds[LastIdx];
+		}
+	}
+return(eBSFSuccess);
+}
+
 bool 
 CBEDfile::SetStrand(char Strand)	// sets globally which strand features must be on in subsequent processing '+'/'-' or '*' for either
 {
@@ -2022,6 +2119,10 @@ if(Rslt == eBSFSuccess)
 	        }
 		}
 #pragma warning(pop)
+
+if(Rslt == eBSFSuccess)
+	Rslt = BuildOverlapIndex();
+
 if(bCloseFile)
 	{
 	close(m_hFile);
@@ -2702,11 +2803,8 @@ CBEDfile::LocateFeatureIDonChrom(int ChromID, // feature is on which chromosome
  							 int FiltInFlags, // filter out any features which do not have at least one of the specified filter flags set
   							 int FiltOutFlags) // filter out any features which have at least one of the specified filter flags set
 {
-int StartIdx;
-int EndIdx;
-int StartID;
+int FeatID;
 tsBEDchromname *pChrom;
-tsBEDfeature *pProbe;
 
 //sanity checks whilst debugging
 #ifdef _DEBUG
@@ -2718,50 +2816,17 @@ if(ChromID > m_FileHdr.NumChroms)
 	return(eBSFerrChrom);
 #endif
 
-
 pChrom = LocateChromName(ChromID);
 if(pChrom == NULL)
 	return(eBSFerrChrom);
 if(!pChrom->NumFeatures)
 	return(0);
 
-// determine initial lower limit to start linear search from which is a feature ending before OverLapsOfs
-// search terminates when start > OverLapsOfs
-if(pChrom->NumFeatures > 50 && OverLapsOfs > pChrom->MaxFeatLen) 
-	{
-	StartID = LocateStart(ChromID,OverLapsOfs - pChrom->MaxFeatLen,FiltInFlags,FiltOutFlags);
-	if(StartID == 0)
-		StartIdx = pChrom->FirstStartID - 1;
-	else
-		StartIdx = StartID - 1;
-	}
-else
-	StartIdx = pChrom->FirstStartID - 1;
-EndIdx = pChrom->LastStartID - 1;
-while(StartIdx <= EndIdx)
-	{
-	pProbe = m_ppFeatureChromStarts[StartIdx];
-	if(pProbe->Start <= OverLapsOfs &&
-	   pProbe->End >= OverLapsOfs)
-		{
-		if(pProbe->Score < m_MinScore || pProbe->Score > m_MaxScore)
-			continue;
-		if((m_OnStrand != '*' && m_OnStrand != pProbe->Strand) || !(pProbe->FiltFlags & FiltInFlags) || pProbe->FiltFlags & FiltOutFlags)
-			continue;
-		if(--Ith)
-			{
-			return(pProbe->FeatureID);
-			}
-		continue;
-		}
-	if(pProbe->Start > OverLapsOfs)
-		break;
-	}
-
-return(0);
+if(OverlapQuery(pChrom,OverLapsOfs,OverLapsOfs,FiltInFlags,FiltOutFlags,Ith-1,1,&FeatID,false) < Ith)
+	return(0);
+return(FeatID);
 }
 
-
 int											  // returned feature identifier
 CBEDfile::LocateFeatureIDinRangeOnChrom(int ChromID, // feature is on which chromosome
 							 int StartOfs,       // feature must end on or after Start
@@ -2770,10 +2835,7 @@ CBEDfile::LocateFeatureIDinRangeOnChrom(int ChromID, // feature is on which chro
  							 int FiltInFlags, // filter out any features which do not have at least one of the specified filter flags set
   							 int FiltOutFlags) // filter out any features which have at least one of the specified filter flags set
 {
-int StartIdx;
-int EndIdx;
-int StartID;
-tsBEDfeature *pProbe;
+int FeatID;
 
 // sanity checks whilst debug
 #ifdef _DEBUG
@@ -2788,44 +2850,203 @@ if(ChromID < 1 || ChromID > m_FileHdr.NumChroms)
 tsBEDchromname *pChrom = LocateChromName(ChromID);
 if(pChrom == NULL)
 	return(eBSFerrChrom);
+if(!pChrom->NumFeatures)
+	return(0);
 
-// determine initial lower limit to start linear search from which is a feature ending before StartOfs
-// search terminates when start > StartOfs
-if(pChrom->NumFeatures > 20 && StartOfs > pChrom->MaxFeatLen) 
+// only need to locate up to the Ith overlap, callers iterating Ith = 1..n incur O(log n + Ith) per call
+if(OverlapQuery(pChrom,StartOfs,EndOfs,FiltInFlags,FiltOutFlags,Ith-1,1,&FeatID,false) < Ith)
+	return(0);
+return(FeatID);
+}
+
+// LocateFeatureIDsinRangeOnChrom
+// Locates all features overlapping StartOfs..EndOfs in a single pass over the chromosome's interval index
+// Up to MaxFeatIDs feature identifiers are returned in pFeatIDs in ascending feature start order, the returned count is
+// the total number of overlapping features so callers can detect if pFeatIDs was too small
+int											  // returned total number of overlapping features, can be more than MaxFeatIDs
+CBEDfile::LocateFeatureIDsinRangeOnChrom(int ChromID, // features are on which chromosome
+							 int StartOfs,       // features must end on or after Start
+							 int EndOfs,		  // and start on or before End 
+							 int MaxFeatIDs,	// return at most this many feature identifiers
+							 int *pFeatIDs,		// where to return feature identifiers in ascending feature start order
+ 							 int FiltInFlags, // filter out any features which do not have at least one of the specified filter flags set
+  							 int FiltOutFlags) // filter out any features which have at least one of the specified filter flags set
+{
+if(StartOfs < 0 || StartOfs > EndOfs || MaxFeatIDs < 0 || (MaxFeatIDs > 0 && pFeatIDs == NULL))
+	return(eBSFerrParams);
+if(!m_bFeaturesAvail)
+	return(eBSFerrFeature);
+if(ChromID < 1 || ChromID > m_FileHdr.NumChroms)
+	return(eBSFerrChrom);
+
+tsBEDchromname *pChrom = LocateChromName(ChromID);
+if(pChrom == NULL)
+	return(eBSFerrChrom);
+if(!pChrom->NumFeatures)
+	return(0);
+return(OverlapQuery(pChrom,StartOfs,EndOfs,FiltInFlags,FiltOutFlags,0,MaxFeatIDs,pFeatIDs,true));
+}
+
+// LocateFeatureIDsSorted
+// Batch locates features overlapping each of a set of query ranges, queries are expected to be sorted by chrom->start
+// so that successive index traversals are over the same, already cached, region of the index
+// Overlapping feature identifiers for all queries are concatenated into pFeatIDs with each query's FirstOverlap
+// and NumOverlaps updated to reference its identifiers, each query's identifiers are in ascending feature start order
+// and not in feature identifier order. Processing stops at the first query whose overlaps would not
+// fit into the remaining pFeatIDs, callers can then process the returned queries and resubmit the remainder
+int										  // returned number of queries for which all overlaps were returned
+CBEDfile::LocateFeatureIDsSorted(int NumQueries,	  // number of query ranges
+							 tsBEDOverlapQuery *pQueries, // query ranges, expected to be sorted by chrom->start
+							 int MaxFeatIDs,	// pFeatIDs has been allocated to hold at most this many feature identifiers
+							 int *pFeatIDs,		// where to return feature identifiers, referenced by tsBEDOverlapQuery.FirstOverlap
+ 							 int FiltInFlags, // filter out any features which do not have at least one of the specified filter flags set
+  							 int FiltOutFlags) // filter out any features which have at least one of the specified filter flags set
+{
+int QueryIdx;
+int NumFeatIDs;
+int NumOverlaps;
+int CurChromID;
+tsBEDchromname *pChrom;
+tsBEDOverlapQuery *pQuery;
+
+if(NumQueries < 0 || (NumQueries > 0 && pQueries == NULL) || MaxFeatIDs < 0 || (MaxFeatIDs > 0 && pFeatIDs == NULL))
+	return(eBSFerrParams);
+if(!m_bFeaturesAvail)
+	return(eBSFerrFeature);
+
+NumFeatIDs = 0;
+CurChromID = 0;
+pChrom = NULL;
+pQuery = pQueries;
+for(QueryIdx = 0; QueryIdx < NumQueries; QueryIdx++, pQuery++)
 	{
-	StartID = LocateStart(ChromID,StartOfs - pChrom->MaxFeatLen,FiltInFlags,FiltOutFlags);
-	if(StartID == 0)
-		StartIdx = pChrom->FirstStartID - 1;
-	else
-		StartIdx = StartID - 1;
+	if(pQuery->StartOfs < 0 || pQuery->StartOfs > pQuery->EndOfs || pQuery->ChromID < 1 || pQuery->ChromID > m_FileHdr.NumChroms)
+		return(eBSFerrParams);
+	if(pQuery->ChromID != CurChromID)
+		{
+		if((pChrom = LocateChromName(pQuery->ChromID))==NULL)
+			return(eBSFerrChrom);
+		CurChromID = pQuery->ChromID;
+		}
+	pQuery->FirstOverlap = NumFeatIDs;
+	pQuery->NumOverlaps = 0;
+	if(!pChrom->NumFeatures)
+		continue;
+	NumOverlaps = OverlapQuery(pChrom,pQuery->StartOfs,pQuery->EndOfs,FiltInFlags,FiltOutFlags,0,MaxFeatIDs - NumFeatIDs,&pFeatIDs[NumFeatIDs],true);
+	if(NumOverlaps > MaxFeatIDs - NumFeatIDs)		// insufficient remaining to hold all overlaps for this query
+		break;
+	pQuery->NumOverlaps = NumOverlaps;
+	NumFeatIDs += NumOverlaps;
 	}
-else
-	StartIdx = pChrom->FirstStartID - 1;
-EndIdx = pChrom->LastStartID - 1;
-while(StartIdx <= EndIdx)
+return(QueryIdx);
+}
+
+// OverlapQuery
+// Traverses the implicit interval tree (see BuildOverlapIndex) for chromosome pChrom, in-order so features are located in ascending
+// feature start order (as sorted in m_ppFeatureChromStarts), applying the current strand, score and filter flag constraints to overlapping features
+int										// returned number of overlapping features located
+CBEDfile::OverlapQuery(tsBEDchromname *pChrom, // features are on this chromosome
+					 int StartOfs,			// features must end on or after StartOfs
+					 int EndOfs,			// and start on or before EndOfs
+					 int FiltInFlags,		// filter out any features which do not have at least one of the specified filter flags set
+					 int FiltOutFlags,		// filter out any features which have at least one of the specified filter flags set
+					 int SkipFeats,			// don't return the first SkipFeats overlapping features
+					 int MaxFeatIDs,		// return at most this many feature identifiers into pFeatIDs
+					 int *pFeatIDs,			// where to return feature identifiers (ascending feature start order)
+					 bool bCountAll)		// if false then stop once SkipFeats + MaxFeatIDs features located
+{
+typedef struct TAG_sTreeNode {
+	INT64 Idx;			// node index relative to chromosome's first feature
+	int Level;			// node level in tree, leaves are at level 0
+	int bVisited;		// 0 if left subtree still to be processed, 1 if node and right subtree to be processed
+	} tsTreeNode;
+tsTreeNode Stack[64];
+tsTreeNode Node;
+int StackDepth;
+int NumLocated;
+int Level;
+INT64 NumFeats;
+INT64 Idx;
+INT64 EndIdx;
+INT64 ChildIdx;
+tsBEDfeature **ppFeats;
+INT32 *pMaxEnds;
+tsBEDfeature *pProbe;
+
+if(pChrom == NULL || !pChrom->NumFeatures || m_pFeatMaxEnds == NULL)
+	return(0);
+NumFeats = pChrom->NumFeatures;
+ppFeats = &m_ppFeatureChromStarts[pChrom->FirstStartID-1];
+pMaxEnds = &m_pFeatMaxEnds[pChrom->FirstStartID-1];
+
+for(Level = 0; ((INT64)1 << (Level + 1)) <= NumFeats; Level++);		// root is at level floor(log2(NumFeats))
+
+NumLocated = 0;
+Stack[0].Level = Level;
+Stack[0].Idx = ((INT64)1 << Level) - 1;
+Stack[0].bVisited = 0;
+StackDepth = 1;
+while(StackDepth)
 	{
-	pProbe = m_ppFeatureChromStarts[StartIdx++];
-	if(pProbe->Start <= EndOfs &&
-	   pProbe->End >= StartOfs)
+	Node = Stack[--StackDepth];
+	if(Node.Level <= 3)		// small subtrees are more efficiently linearly scanned
 		{
-		if(pProbe->Score < m_MinScore || pProbe->Score > m_MaxScore)
-			continue;
-		if((m_OnStrand != '*' && m_OnStrand != pProbe->Strand) || !(pProbe->FiltFlags & FiltInFlags) || pProbe->FiltFlags & FiltOutFlags)
-			continue;
-		if(--Ith == 0)
+		Idx = (Node.Idx >> Node.Level) << Node.Level;
+		EndIdx = Idx + ((INT64)1 << (Node.Level + 1)) - 1;
+		if(EndIdx > NumFeats)
+			EndIdx = NumFeats;
+		for(; Idx < EndIdx && ppFeats[Idx]->Start <= EndOfs; Idx++)
 			{
-			return(pProbe->FeatureID);
+			pProbe = ppFeats[Idx];
+			if(pProbe->End < StartOfs)
+				continue;
+			if(pProbe->Score < m_MinScore || pProbe->Score > m_MaxScore)
+				continue;
+			if((m_OnStrand != '*' && m_OnStrand != pProbe->Strand) || !(pProbe->FiltFlags & FiltInFlags) || pProbe->FiltFlags & FiltOutFlags)
+				continue;
+			if(NumLocated >= SkipFeats && NumLocated - SkipFeats < MaxFeatIDs)
+				pFeatIDs[NumLocated - SkipFeats] = pProbe->FeatureID;
+			NumLocated += 1;
+			if(!bCountAll && NumLocated >= SkipFeats + MaxFeatIDs)
+				return(NumLocated);
 			}
-		continue;
 		}
-	if(pProbe->Start > EndOfs)
-		break;
+	else
+		if(!Node.bVisited)		// 1st visit, push back node for a 2nd visit and then process left subtree if it could contain overlaps
+			{
+			Stack[StackDepth] = Node;
+			Stack[StackDepth++].bVisited = 1;
+			ChildIdx = Node.Idx - ((INT64)1 << (Node.Level - 1));
+			if(ChildIdx >= NumFeats || pMaxEnds[ChildIdx] >= StartOfs)
+				{
+				Stack[StackDepth].Idx = ChildIdx;
+				Stack[StackDepth].Level = Node.Level - 1;
+				Stack[StackDepth++].bVisited = 0;
+				}
+			}
+		else
+			if(Node.Idx < NumFeats && ppFeats[Node.Idx]->Start <= EndOfs)	// 2nd visit, process node and then right subtree
+				{
+				pProbe = ppFeats[Node.Idx];
+				if(pProbe->End >= StartOfs &&
+					pProbe->Score >= m_MinScore && pProbe->Score <= m_MaxScore &&
+					(m_OnStrand == '*' || m_OnStrand == pProbe->Strand) &&
+					pProbe->FiltFlags & FiltInFlags && !(pProbe->FiltFlags & FiltOutFlags))
+					{
+					if(NumLocated >= SkipFeats && NumLocated - SkipFeats < MaxFeatIDs)
+						pFeatIDs[NumLocated - SkipFeats] = pProbe->FeatureID;
+					NumLocated += 1;
+					if(!bCountAll && NumLocated >= SkipFeats + MaxFeatIDs)
+						return(NumLocated);
+					}
+				Stack[StackDepth].Idx = Node.Idx + ((INT64)1 << (Node.Level - 1));
+				Stack[StackDepth].Level = Node.Level - 1;
+				Stack[StackDepth++].bVisited = 0;
+				}
 	}
-return(0);
+return(NumLocated);
 }
 
-
-
 // returns the number of chromosomes
 int 
 CBEDfile::GetNumChromosomes(void)
@@ -2880,12 +3101,6 @@ CBEDfile::GetNumFeatures(int ChromID,	  // features are on which chromosome
 					 int FiltInFlags, // filter out any features which do not have at least one of the specified filter flags set
 					 int FiltOutFlags) // filter out any features which have at least one of the specified filter flags set
 {
-int NumFeatures;
-int StartIdx;
-int EndIdx;
-int StartID;
-tsBEDfeature *pProbe;
-
 // sanity checks whilst debug
 #ifdef _DEBUG
 if(!m_bFeaturesAvail || !m_FileHdr.NumFeatures)
@@ -2899,37 +3114,9 @@ if(ChromID < 1 || ChromID > m_FileHdr.NumChroms)
 tsBEDchromname *pChrom = LocateChromName(ChromID);
 if(pChrom == NULL)
 	return(eBSFerrChrom);
-
-// determine initial lower limit to start linear search from which is a feature ending before StartOfs
-// search terminates when start > StartOfs
-if(pChrom->NumFeatures > 20 && StartOfs > pChrom->MaxFeatLen) 
-	{
-	StartID = LocateStart(ChromID,StartOfs - pChrom->MaxFeatLen,FiltInFlags,FiltOutFlags);
-	if(StartID == 0)
-		StartIdx = pChrom->FirstStartID - 1;
-	else
-		StartIdx = StartID - 1;
-	}
-else
-	StartIdx = pChrom->FirstStartID - 1;
-EndIdx = pChrom->LastStartID - 1;
-NumFeatures = 0;
-while(StartIdx <= EndIdx)
-	{
-	pProbe = m_ppFeatureChromStarts[StartIdx];
-	if((m_OnStrand == '*' || m_OnStrand == pProbe->Strand) &&
-		pProbe->FiltFlags & FiltInFlags && !(pProbe->FiltFlags & FiltOutFlags) &&
-			pProbe->Start <= EndOfs &&
-			pProbe->End >= StartOfs)
-		{
-		if(pProbe->Score >= m_MinScore && pProbe->Score <= m_MaxScore)
-			NumFeatures++;
-		continue;
-		}
-	if(pProbe->Start > EndOfs)
-		break;
-	}
-return(NumFeatures);
+if(!pChrom->NumFeatures)
+	return(0);
+return(OverlapQuery(pChrom,StartOfs,EndOfs,FiltInFlags,FiltOutFlags,0,0,NULL,true));
 }
 
 // returns start of the Ith (1..n) feature on chromosome 
@@ -124,6 +124,17 @@ typedef struct TAG_sBEDFileHdr {
 
 #pragma pack()
 
+#pragma pack(1)
+// used when batch locating features overlapping a sorted (by chrom->start) set of query ranges
+typedef struct TAG_sBEDOverlapQuery {
+	INT32 ChromID;						// query range is on this chromosome
+	INT32 StartOfs;						// overlapping features must end on or after StartOfs
+	INT32 EndOfs;						// and start on or before EndOfs
+	INT32 FirstOverlap;					// returned index into feature identifiers of first overlapping feature
+	INT32 NumOverlaps;					// returned number of overlapping features
+} tsBEDOverlapQuery;
+#pragma pack()
+
 
 class CBEDfile  : protected CEndian, public CErrorCodes
 {	
@@ -151,6 +162,7 @@ class CBEDfile  : protected CEndian, public CErrorCodes
 
 	tsBEDfeature **m_ppFeatureNames;        // sorted (by name->chrom->start->end) array of ptrs into m_pFeatures
 	tsBEDfeature **m_ppFeatureChromStarts;  // sorted (by chrom->start->end) array of ptrs into m_pFeatures
+	INT32 *m_pFeatMaxEnds;					// implicit per chromosome interval tree - max feature end in subtree rooted at each m_ppFeatureChromStarts[]
 
 	 int m_MinScore;					// current score cutoffs
 	 int m_MaxScore;					// scores on any feature must be between these scores
@@ -183,7 +195,19 @@ class CBEDfile  : protected CEndian, public CErrorCodes
 					 int FiltInFlags, // filter out any features which do not have at least one of the specified filter flags set
 					 int FiltOutFlags); // filter out any features which have at least one of the specified filter flags set
 
-	
+	teBSFrsltCodes BuildOverlapIndex(void);	// builds implicit interval trees over each chromosome's features in m_ppFeatureChromStarts
+
+	int										// returned number of overlapping features located
+		OverlapQuery(tsBEDchromname *pChrom, // features are on this chromosome
+					 int StartOfs,			// features must end on or after StartOfs
+					 int EndOfs,			// and start on or before EndOfs
+					 int FiltInFlags,		// filter out any features which do not have at least one of the specified filter flags set
+					 int FiltOutFlags,		// filter out any features which have at least one of the specified filter flags set
+					 int SkipFeats,			// don't return the first SkipFeats overlapping features
+					 int MaxFeatIDs,		// return at most this many feature identifiers into pFeatIDs
+					 int *pFeatIDs,			// where to return feature identifiers (ascending feature start order)
+					 bool bCountAll);		// if false then stop once SkipFeats + MaxFeatIDs features located
+
 
 	 bool InInternFeat(int FeatBits,int ChromID,int StartOfs,int EndOfs);
 
@@ -312,6 +336,23 @@ public:
  							 int FiltInFlags=cFeatFiltIn, // filter out any features which do not have at least one of the specified filter flags set
   							 int FiltOutFlags=cFeatFiltOut); // filter out any features which have at least one of the specified filter flags set
 
+	int										  // returned total number of overlapping features, can be more than MaxFeatIDs
+		LocateFeatureIDsinRangeOnChrom(int ChromID,	  // features are on which chromosome
+							 int Start,       // features must end on or after Start
+							 int End,		  // and start on or before End 
+							 int MaxFeatIDs,	// return at most this many feature identifiers
+							 int *pFeatIDs,		// where to return feature identifiers in ascending feature start order
+ 							 int FiltInFlags=cFeatFiltIn, // filter out any features which do not have at least one of the specified filter flags set
+  							 int FiltOutFlags=cFeatFiltOut); // filter out any features which have at least one of the specified filter flags set
+
+	int										  // returned number of queries for which all overlaps were returned
+		LocateFeatureIDsSorted(int NumQueries,	  // number of query ranges
+							 tsBEDOverlapQuery *pQueries, // query ranges, expected to be sorted by chrom->start
+							 int MaxFeatIDs,	// pFeatIDs has been allocated to hold at most this many feature identifiers
+							 int *pFeatIDs,		// where to return feature identifiers, referenced by tsBEDOverlapQuery.FirstOverlap
+ 							 int FiltInFlags=cFeatFiltIn, // filter out any features which do not have at least one of the specified filter flags set
+  							 int FiltOutFlags=cFeatFiltOut); // filter out any features which have at least one of the specified filter flags set
+
 	int										  // returned number of features
 		GetNumFeatures(int ChromID,			  // features are on which chromosome
 					   int Start,			  // features must end on or after Start
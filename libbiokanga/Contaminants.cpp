@@ -32,6 +32,8 @@ memset(m_ContaminantVectors,0,sizeof(m_ContaminantVectors));
 m_AllocContaminantsMem = 0;
 m_pContamSeqNodes = 0;
 m_AllocdContamSeqNodesMem = 0;	
+m_pContamBPMasks = NULL;
+m_NumContamBPMasks = 0;
 m_bSerialCreated = false;
 Reset();
 }
@@ -61,6 +63,8 @@ if (m_pContamSeqNodes != NULL)
 		munmap(m_pContamSeqNodes, m_AllocdContamSeqNodesMem);
 #endif
 	}
+if(m_pContamBPMasks != NULL)
+	delete []m_pContamBPMasks;
 if(m_NumVectContaminates > 0)
 	{
 	for(int Idx = 0; Idx < m_NumVectContaminates; Idx++)
@@ -174,6 +178,13 @@ if (m_pContamSeqNodes != NULL)
 	m_AllocdContamSeqNodesMem = 0;
 	}
 
+if(m_pContamBPMasks != NULL)
+	{
+	delete []m_pContamBPMasks;
+	m_pContamBPMasks = NULL;
+	}
+m_NumContamBPMasks = 0;
+
 if(m_NumVectContaminates > 0)
 	{
 	for(Idx = 0; Idx < m_NumVectContaminates; Idx++)
@@ -432,6 +443,7 @@ return(Rslt);
 int
 CContaminants::FinaliseContaminants(void)
 {
+int Rslt;
 int ContamIdx;
 
 tsFlankContam *pPrevContaminants[4];
@@ -485,6 +497,13 @@ if(m_NumFlankContaminates)
 						 pContaminant->ContamLen,	// contaminant sequence is of this length
 						 pContaminant->Bases);		// contaminant sequence
 		}
+
+	// and the bit-parallel masks used to locate the longest overlap before confirming with the b-tree like index
+	if((Rslt = IndexContamBPMasks()) < eBSFSuccess)
+		{
+		Reset();
+		return(Rslt);
+		}
 	}
 return(m_TotNumContaminants);
 }
@@ -1032,6 +1051,176 @@ for(NodeBaseIdx = 0; NodeBaseIdx < pCurNode->NumNodeBases; NodeBaseIdx++,pCurCon
 return(BestContamID == 0 ? -1 : BestReqSubs);
 }
 
+int			// maximum substitutions accepted
+CContaminants::OverlapMaxSubs(int AllowSubsRate,	// allowing substitutions at this rate per 25bp of overlap length
+				int OverlapLen)			// for an overlap of this length
+{
+if(AllowSubsRate == 0)
+	return(0);
+if(OverlapLen >= 10)
+	return(min(1,(AllowSubsRate * (OverlapLen + 15)) / 25));
+return(1);
+}
+
+// IndexContamBPMasks
+// All contaminant sequences of each type are packed, one bit per base, into bitvectors of cContamBPNumMasks masks; the base masks [0..7], indexed by query base,
+// mark the contaminant bases which that query base is accepted as matching using the RecursiveMatch() semantics: query eBaseN's never match, contaminant eBaseN's match any other query base
+// Contaminants are packed in the order in which they are overlaid onto the query: for contaminant suffix overlaps onto query prefixes (5' types) the contaminant bases are packed 5' to 3'
+// and the query prefix is processed 5' to 3', for contaminant prefix overlaps onto query suffixes (3' types) the contaminant bases are packed 3' to 5' with the query suffix processed 3' to 5'
+int			// < 0 if errors, eBSFSuccess if bit-parallel masks generated
+CContaminants::IndexContamBPMasks(void)
+{
+int TypeIdx;
+int NumBits;
+int BitIdx;
+int BaseIdx;
+int QueryBase;
+etSeqBase ContamBase;
+UINT64 BitMsk;
+UINT64 *pMasks;
+tsFlankContam *pContaminant;
+tsContaminantType *pContaminantType;
+
+if(m_pContamBPMasks != NULL)
+	{
+	delete []m_pContamBPMasks;
+	m_pContamBPMasks = NULL;
+	}
+m_NumContamBPMasks = 0;
+
+pContaminantType = m_ContaminantTypes;
+for(TypeIdx = 0; TypeIdx < eAOFPlaceholder; TypeIdx++,pContaminantType++)
+	{
+	pContaminantType->BPNumWords = 0;
+	pContaminantType->BPMasksIdx = 0;
+	if(pContaminantType->NumContaminants == 0)
+		continue;
+	NumBits = 0;
+	for(pContaminant = pContaminantType->pFirstContam; pContaminant <= pContaminantType->pLastContam; pContaminant++)
+		NumBits += pContaminant->ContamLen;
+	if(NumBits > cContamBPMaxWords * 64)		// too many to pack, these contaminants will only be matched using the nodes
+		continue;
+	pContaminantType->BPNumWords = (NumBits + 63) / 64;
+	pContaminantType->BPMasksIdx = m_NumContamBPMasks;
+	m_NumContamBPMasks += pContaminantType->BPNumWords * cContamBPNumMasks;
+	}
+if(m_NumContamBPMasks == 0)
+	return(eBSFSuccess);
+
+if((m_pContamBPMasks = new UINT64 [m_NumContamBPMasks]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal, gszProcName, "IndexContamBPMasks: Unable to allocate memory for %u bit-parallel mask words",m_NumContamBPMasks);
+	m_NumContamBPMasks = 0;
+	return(eBSFerrMem);
+	}
+memset(m_pContamBPMasks,0,sizeof(UINT64) * m_NumContamBPMasks);
+
+pContaminantType = m_ContaminantTypes;
+for(TypeIdx = 0; TypeIdx < eAOFPlaceholder; TypeIdx++,pContaminantType++)
+	{
+	if(pContaminantType->BPNumWords == 0)
+		continue;
+	pMasks = &m_pContamBPMasks[pContaminantType->BPMasksIdx];
+	BitIdx = 0;
+	for(pContaminant = pContaminantType->pFirstContam; pContaminant <= pContaminantType->pLastContam; pContaminant++)
+		{
+		for(BaseIdx = 0; BaseIdx < pContaminant->ContamLen; BaseIdx++,BitIdx++)
+			{
+			if(TypeIdx == eAOF5PE1Targ || TypeIdx == eAOF5PE2Targ)
+				ContamBase = pContaminant->Bases[BaseIdx] & 0x07;
+			else
+				ContamBase = pContaminant->Bases[pContaminant->ContamLen - 1 - BaseIdx] & 0x07;
+			BitMsk = (UINT64)1 << (BitIdx & 0x03f);
+			for(QueryBase = 0; QueryBase < cContamBPValidMask; QueryBase++)
+				if(QueryBase != eBaseN && (ContamBase == eBaseN || ContamBase == QueryBase))
+					pMasks[(QueryBase * pContaminantType->BPNumWords) + (BitIdx >> 6)] |= BitMsk;
+			pMasks[(cContamBPValidMask * pContaminantType->BPNumWords) + (BitIdx >> 6)] |= BitMsk;
+			if(BaseIdx > 0)
+				pMasks[(cContamBPShiftMask * pContaminantType->BPNumWords) + (BitIdx >> 6)] |= BitMsk;
+			if(BaseIdx == pContaminant->ContamLen - 1)
+				pMasks[(cContamBPLastMask * pContaminantType->BPNumWords) + (BitIdx >> 6)] |= BitMsk;
+			}
+		}
+	}
+return(eBSFSuccess);
+}
+
+// BPMatchOverlaps
+// Bit-parallel (shift-and with substitution counting) matching of the query against all packed contaminant sequences of a type simultaneously
+// Every contaminant base is initially a potential overlap start, each query base then advances all surviving overlaps by one contaminant base with overlaps
+// requiring a substitution moving to the next substitution level. An overlap of OverlapLen bases is completed when the OverlapLen'th query base is accepted onto the last base of a contaminant.
+// Processing terminates as soon as there are no surviving overlaps, usually within a few query bases, so the cost is largely independent of the query length and number of substitutions allowed
+int			// < 0 if unable to match with the substitutions allowed, 0 if no overlap, otherwise the longest overlap length of any contaminant of this type
+CContaminants::BPMatchOverlaps(bool bSuffixOverlaps,  // true if processing for contaminant suffix overlaps onto query prefix, false if processing for contaminant prefix overlaps onto query suffix
+				tsContaminantType *pContaminantType,	// contaminants of this type
+				int AllowSubsRate,			// allowing substitutions at this rate
+				int MinOverlap,				// minimum required overlap
+				int MaxOverlap,				// maximum overlap
+				int QueryLen,				// query sequence length
+				etSeqBase *pQuerySeq)		// query sequence
+{
+UINT64 Overlaps[cContamBPMaxSubs+1][cContamBPMaxWords];
+UINT64 Accepted;
+UINT64 Completed;
+UINT64 Surviving;
+UINT64 Carry;
+UINT64 *pMasks;
+UINT64 *pBaseMask;
+UINT64 *pShiftMask;
+UINT64 *pLastMask;
+int NumWords;
+int WordIdx;
+int MaxSubs;
+int Subs;
+int CompletedSubs;
+int OverlapLen;
+int BestOverlap;
+etSeqBase *pQueryBase;
+
+NumWords = pContaminantType->BPNumWords;
+pMasks = &m_pContamBPMasks[pContaminantType->BPMasksIdx];
+pShiftMask = &pMasks[cContamBPShiftMask * NumWords];
+pLastMask = &pMasks[cContamBPLastMask * NumWords];
+MaxSubs = OverlapMaxSubs(AllowSubsRate,MaxOverlap);
+for(OverlapLen = MinOverlap; OverlapLen < MaxOverlap; OverlapLen++)
+	MaxSubs = max(MaxSubs,OverlapMaxSubs(AllowSubsRate,OverlapLen));
+if(MaxSubs > cContamBPMaxSubs)		// can't track that many substitutions, caller will need to walk the nodes
+	return(-1);
+
+for(Subs = 0; Subs <= MaxSubs; Subs++)
+	memcpy(Overlaps[Subs],&pMasks[cContamBPValidMask * NumWords],sizeof(UINT64) * NumWords);
+
+pQueryBase = bSuffixOverlaps ? pQuerySeq : &pQuerySeq[QueryLen-1];
+BestOverlap = 0;
+for(OverlapLen = 1; OverlapLen <= MaxOverlap; OverlapLen++, bSuffixOverlaps ? pQueryBase++ : pQueryBase--)
+	{
+	pBaseMask = &pMasks[(*pQueryBase & 0x07) * NumWords];
+	Completed = 0;
+	Surviving = 0;
+	CompletedSubs = OverlapMaxSubs(AllowSubsRate,OverlapLen);
+	for(Subs = MaxSubs; Subs >= 0; Subs--)	// higher levels first as these accept substitutions from the level below prior to it being advanced
+		{
+		Carry = 0;
+		for(WordIdx = 0; WordIdx < NumWords; WordIdx++)
+			{
+			Accepted = Overlaps[Subs][WordIdx] & pBaseMask[WordIdx];
+			if(Subs)
+				Accepted |= Overlaps[Subs-1][WordIdx];
+			if(Subs == CompletedSubs)
+				Completed |= Accepted & pLastMask[WordIdx];
+			Overlaps[Subs][WordIdx] = ((Accepted << 1) | Carry) & pShiftMask[WordIdx];
+			Carry = Accepted >> 63;
+			Surviving |= Overlaps[Subs][WordIdx];
+			}
+		}
+	if(Completed && OverlapLen >= MinOverlap)
+		BestOverlap = OverlapLen;
+	if(!Surviving)
+		break;
+	}
+return(BestOverlap);
+}
+
 
 const int cMaxSeedIters = 25000;		// max number of iterations (exploration depth) with current QueryWinLen bases looking for marching seed window to extend
 int					// returns number of mismatches or -1 if no hits within AllowSubsRate
@@ -1272,6 +1461,16 @@ AcquireSerialise();
 pContaminantType->NumChecks += 1;		
 ReleaseSerialise();
 bSuffixOverlaps = (Type == eAOF5PE1Targ || Type == eAOF5PE2Targ) ? true : false;
+
+// bit-parallel matching identifies the longest overlap of any contaminant, the nodes are then only walked for that overlap length
+// to confirm and attribute the overlap to the same contaminant as would walking the nodes for all overlap lengths
+if(pContaminantType->BPNumWords > 0 && (Rslt = BPMatchOverlaps(bSuffixOverlaps,pContaminantType,AllowSubsRate,MinOverlap,CurOverlapLen,QueryLen,pQuerySeq)) >= 0)
+	{
+	if(Rslt == 0)
+		return(0);
+	CurOverlapLen = Rslt;
+	}
+
 if(bSuffixOverlaps)
 	pTargBase = &pQuerySeq[CurOverlapLen-1];
 else
@@ -1282,16 +1481,7 @@ pTypeRootNode = &m_pContamSeqNodes[pContaminantType->RootContamSeqNodeIdx-1];
 // have at least one contaminant of requested type which is at least the minimum required length to be an otherlap
 for (OverlapIdx = CurOverlapLen; OverlapIdx >= MinOverlap; OverlapIdx--,bSuffixOverlaps ? pTargBase -= 1 : pTargBase += 1 )
 	{
-	if(AllowSubsRate > 0)
-		{
-		if(OverlapIdx >= 10)
-			MaxAcceptedSubs = min(1,(AllowSubsRate * (OverlapIdx + 15)) / 25);
-		else
-			MaxAcceptedSubs = 1;
-		}
-	else
-		MaxAcceptedSubs = 0;
-		
+	MaxAcceptedSubs = OverlapMaxSubs(AllowSubsRate,OverlapIdx);
 	if((Rslt=RecursiveMatch(bSuffixOverlaps,MaxAcceptedSubs,OverlapIdx,pTargBase,pTypeRootNode,&ContamID)) >= 0)
 		{
 		pContaminant = &m_pContaminants[ContamID - 1];
@@ -10,6 +10,12 @@ const int cMaxContamQuerySeqLen = 2000;			// only process query (usually a NGS r
 
 const int cMinContaminantLen = 4;			// minimum length adaptor contaminant accepted
 const int cMaxContaminantLen = 200;			// maximum length adaptor contaminant accepted
+const int cContamBPMaxSubs = 1;				// bit-parallel overlap matching tracks at most this many substitutions, the most which MatchContaminants() accepts
+const int cContamBPMaxWords = 256;			// bit-parallel overlap matching only if all contaminant sequences of a type can be packed into at most this many 64bit words
+const int cContamBPValidMask = 8;			// bit-parallel masks [0..7] are indexed by query base, [8] marks all contaminant bases
+const int cContamBPShiftMask = 9;			// [9] marks contaminant bases which can be shifted into, i.e. all other than the first base of each contaminant
+const int cContamBPLastMask = 10;			// [10] marks the last base of each contaminant, an overlap is completed on reaching this base
+const int cContamBPNumMasks = 11;			// number of bit-parallel masks for each contaminant type
 const int cMaxNumContaminants = (200 * 8);	// allow at most this many adaptor contaminant sequences to be loaded, need to allow for the multiple orientations a user may request
 const int cAllocNumContaminants = ((cMaxNumContaminants+7)/8);	// initially alloc, then realloc as may be required, for this many Contaminants at a time		
 const int cAllocNumContamNodes = (cAllocNumContaminants*cMaxContaminantLen); // initially alloc, then realloc as may be required, for this many contaminant nodes	
@@ -75,6 +81,8 @@ typedef struct TAG_sContaminantType {
 	tsFlankContam *pFirstContam;			// pts to first contaminant of this type
 	tsFlankContam *pLastContam;				// pts to last contaminant of this type
 	UINT32 RootContamSeqNodeIdx;			// index + 1 (0 if none) into m_pContamSeqNodes[] of root node for contaminant sequences of this type
+	int BPNumWords;							// number of words in each bit-parallel mask, 0 if contaminant sequences are only matched using the nodes
+	UINT32 BPMasksIdx;						// index into m_pContamBPMasks[] of the cContamBPNumMasks bit-parallel masks for this type
 } tsContaminantType;
 
 typedef struct TAG_sContamSeqNodeBase {
@@ -116,6 +124,9 @@ class CContaminants
 	size_t m_AllocdContamSeqNodesMem;		// memory size allocated to hold contamiant nodes
 	tsContamSeqNode *m_pContamSeqNodes;		// ptr to allocated nodes
 
+	UINT32 m_NumContamBPMasks;				// number of words allocated for bit-parallel masks of all contaminant types
+	UINT64 *m_pContamBPMasks;				// bit-parallel masks of all contaminant types
+
 	tsVectContam m_ContaminantVectors[cMaxNumVectors]; // to hold vector contamiant sequences
 
 	int m_CacheContamID;				    // if non-zero then last accessed contaminate identifier
@@ -194,6 +205,22 @@ class CContaminants
 				tsContamSeqNode *pCurNode,  // current node
 				int *pContamID);				// match was to this contamination sequence
 
+	int			// maximum substitutions accepted
+		OverlapMaxSubs(int AllowSubsRate,	// allowing substitutions at this rate per 25bp of overlap length
+				int OverlapLen);			// for an overlap of this length
+
+	int			// < 0 if errors, eBSFSuccess if bit-parallel masks generated
+		IndexContamBPMasks(void);			// generate bit-parallel masks over the contaminant sequences of each type
+
+	int			// < 0 if unable to match with the substitutions allowed, 0 if no overlap, otherwise the longest overlap length of any contaminant of this type
+		BPMatchOverlaps(bool bSuffixOverlaps,  // true if processing for contaminant suffix overlaps onto query prefix, false if processing for contaminant prefix overlaps onto query suffix
+				tsContaminantType *pContaminantType,	// contaminants of this type
+				int AllowSubsRate,			// allowing substitutions at this rate
+				int MinOverlap,				// minimum required overlap
+				int MaxOverlap,				// maximum overlap
+				int QueryLen,				// query sequence length
+				etSeqBase *pQuerySeq);		// query sequence
+
 	bool m_bSerialCreated;					// set true if serialisation rwlocks created/initialised
 #ifdef _WIN32
 	CRITICAL_SECTION m_hSCritSect;
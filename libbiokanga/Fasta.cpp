@@ -902,6 +902,65 @@ UINT8 CFasta::m_SOLiDmap[5][5] = {
 	{'t','g','c','a','n'},
 	{'n','n','n','n','n'}};		
 
+// block tokenizer char classes, see cFCText, cFCBase and cFCSeq
+const UINT8 CFasta::m_ChrClass[256] = {
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,	// 0x00
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0x10
+	0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x05,0x01,0x01,	// 0x20
+	0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,	// 0x30
+	0x01,0x07,0x05,0x07,0x05,0x05,0x05,0x07,0x05,0x05,0x05,0x05,0x05,0x05,0x07,0x05,	// 0x40
+	0x05,0x05,0x05,0x05,0x07,0x05,0x05,0x05,0x05,0x05,0x05,0x01,0x01,0x01,0x01,0x01,	// 0x50
+	0x01,0x07,0x05,0x07,0x05,0x05,0x05,0x07,0x05,0x05,0x05,0x05,0x05,0x05,0x07,0x05,	// 0x60
+	0x05,0x05,0x05,0x05,0x07,0x05,0x05,0x05,0x05,0x05,0x05,0x01,0x01,0x01,0x01,0x01,	// 0x70
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0x80
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0x90
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0xa0
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0xb0
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0xc0
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0xd0
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,	// 0xe0
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00	// 0xf0
+	};
+
+const UINT8 CFasta::m_Ascii2SenseMap[2][256] = {
+	{		// lowercase bases are repeat masked
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x00
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x10
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x06,0x04,0x04,	// 0x20
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x30
+	0x04,0x00,0x04,0x01,0x04,0x04,0x04,0x02,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x40
+	0x04,0x04,0x04,0x04,0x03,0x03,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x50
+	0x04,0x08,0x04,0x09,0x04,0x04,0x04,0x0a,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x60
+	0x04,0x04,0x04,0x04,0x0b,0x0b,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x70
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x80
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x90
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xa0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xb0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xc0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xd0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xe0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04	// 0xf0
+	},
+	{		// uppercase bases are repeat masked
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x00
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x10
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x06,0x04,0x04,	// 0x20
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x30
+	0x04,0x08,0x04,0x09,0x04,0x04,0x04,0x0a,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x40
+	0x04,0x04,0x04,0x04,0x0b,0x0b,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x50
+	0x04,0x00,0x04,0x01,0x04,0x04,0x04,0x02,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x60
+	0x04,0x04,0x04,0x04,0x03,0x03,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x70
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x80
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0x90
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xa0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xb0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xc0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xd0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,	// 0xe0
+	0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04	// 0xf0
+	}};
+
+
 
 int						// returns actual number read (eBSFSuccess == EOF,eBSFFastaDescr == End of current sequence, descriptor line now available)
 CFasta::ReadSequence(void *pRetSeq,		// where to return sequence, can be NULL if only interested in the sequence length
@@ -918,6 +977,8 @@ char *pAscii = (char *)pRetSeq;
 int Rslt;
 bool bSloughEOL;	// if true then skip to end of current line
 int PrevSOLiDbase;
+int RunLen;
+int CpyLen;
 
 if (m_gzFile == NULL && m_hFile == -1 || m_pCurFastaBlock == NULL || m_pCurFastaBlock->pBlock == NULL)
 	return(eBSFerrClosed);
@@ -986,6 +1047,42 @@ while(bMoreToDo) {
 
 	while (m_pCurFastaBlock->BuffIdx < m_pCurFastaBlock->BuffCnt)
 		{
+		// block tokenizer: runs of descriptor or sequence chars which need no per char processing are bulk copied
+		if(bInDescriptor)
+			{
+			if((RunLen = ScanRun(&m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx],m_pCurFastaBlock->BuffCnt - m_pCurFastaBlock->BuffIdx,cFCText)) > 0)
+				{
+				CpyLen = min(RunLen,(int)(cMaxFastaDescrLen - m_DescriptorLen));
+				memcpy(&m_szDescriptor[m_DescriptorLen],&m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx],CpyLen);
+				m_DescriptorLen += CpyLen;
+				m_pCurFastaBlock->BuffIdx += RunLen;
+				continue;
+				}
+			}
+		else
+			if(!bSloughEOL && !m_bIscsfasta && (RunLen = ScanRun(&m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx],m_pCurFastaBlock->BuffCnt - m_pCurFastaBlock->BuffIdx,cFCSeq)) > 0)
+				{
+				if(pRetSeq == NULL)
+					{
+					SeqLen += RunLen;
+					m_pCurFastaBlock->BuffIdx += RunLen;
+					continue;
+					}
+				CpyLen = min(RunLen,Max2Ret - SeqLen);
+				memcpy(pAscii,&m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx],CpyLen);
+				pAscii += CpyLen;
+				SeqLen += CpyLen;
+				m_pCurFastaBlock->BuffIdx += CpyLen;
+				if(SeqLen < Max2Ret)
+					{
+					*pAscii = '\0';
+					continue;
+					}
+				if(bSeqBase)
+					return(Ascii2Sense((char *)pRetSeq,SeqLen,(etSeqBase *)pRetSeq,RptMskUpperCase));
+				return(SeqLen);
+				}
+
 		Chr = m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx++];
 		// ensure reading an ascii text file - only allow whitespace and chrs >= 0x20 and <= 0x7f
 		// note that if within a descriptor line then chars > 0x7f are tolerated but will be substituted with '?' 
@@ -1211,6 +1308,10 @@ int ParseState;
 int SeqLen = 0;
 bool bIsFastQSOLiD;	// some fastq files (from NCBA SRA SRP000191) have SOLiD sequences
 char PrvBase;		// used if decoding SOLiD sequences
+UINT8 *pChrs;
+int AvailLen;
+int RunLen;
+int CpyLen;
 if (m_gzFile == NULL && m_hFile == -1 || m_pCurFastaBlock == NULL || m_pCurFastaBlock->pBlock == NULL)
 	return(eBSFerrClosed);
 if(!m_bRead)
@@ -1242,6 +1343,45 @@ while(ParseState < 6) {
 		}
 	while (ParseState < 6 && m_pCurFastaBlock->BuffIdx < m_pCurFastaBlock->BuffCnt)
 		{
+		// block tokenizer: runs of identifier, base or quality score chars which need no per char processing are bulk copied
+		pChrs = &m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx];
+		AvailLen = m_pCurFastaBlock->BuffCnt - m_pCurFastaBlock->BuffIdx;
+		RunLen = 0;
+		switch(ParseState) {
+			case 1:		// sequence identifier
+				if((RunLen = ScanRun(pChrs,AvailLen,cFCText)) > 0)
+					{
+					CpyLen = min(RunLen,(int)(cMaxFastaDescrLen - m_DescriptorLen));
+					memcpy(&m_szDescriptor[m_DescriptorLen],pChrs,CpyLen);
+					m_DescriptorLen += CpyLen;
+					}
+				break;
+			case 2:		// sequence, SOLiD colorspace is decoded per char
+				if(!bIsFastQSOLiD && (RunLen = ScanRun(pChrs,AvailLen,cFCBase)) > 0)
+					{
+					CpyLen = min(RunLen,(int)cMaxFastQSeqLen - m_FastqSeqLen);
+					memcpy(&m_szFastqSeq[m_FastqSeqLen],pChrs,CpyLen);
+					m_FastqSeqLen += CpyLen;
+					}
+				break;
+			case 4:		// duplicate sequence identifier is sloughed
+				RunLen = ScanRun(pChrs,AvailLen,cFCText);
+				break;
+			case 5:		// quality scores, 1st SOLiD quality score is sloughed per char
+				if(!(bIsFastQSOLiD && !m_FastqSeqQLen) && (RunLen = ScanRun(pChrs,AvailLen,cFCText)) > 0)
+					{
+					CpyLen = min(RunLen,(int)cMaxFastQSeqLen - m_FastqSeqQLen);
+					memcpy(&m_szFastqSeqQ[m_FastqSeqQLen],pChrs,CpyLen);
+					m_FastqSeqQLen += CpyLen;
+					}
+				break;
+			}
+		if(RunLen > 0)
+			{
+			m_pCurFastaBlock->BuffIdx += RunLen;
+			continue;
+			}
+
 		Chr = m_pCurFastaBlock->pBlock[m_pCurFastaBlock->BuffIdx++];
 		if(Chr == '\n')
 			m_CurFastQParseLine += 1;
@@ -1437,6 +1577,298 @@ if(m_FastqSeqLen != m_FastqSeqQLen)
 return(eBSFFastaDescr);
 }
 
+// ScanRun
+// Block tokenizer primitive: returns the length of the run of chars, starting at pChrs, which are all of ChrClass
+// Classification is table driven and unrolled so that runs can be located without per char branching on the char value
+int
+CFasta::ScanRun(UINT8 *pChrs,		// returns length of run of chars starting at pChrs which are all of ChrClass
+				int MaxLen,			// run can be at most this length
+				UINT8 ChrClass)		// chars must be in this class
+{
+int Len = 0;
+while((Len + 4) <= MaxLen && (m_ChrClass[pChrs[Len]] & m_ChrClass[pChrs[Len+1]] & m_ChrClass[pChrs[Len+2]] & m_ChrClass[pChrs[Len+3]] & ChrClass))
+	Len += 4;
+while(Len < MaxLen && (m_ChrClass[pChrs[Len]] & ChrClass))
+	Len += 1;
+return(Len);
+}
+
+// RefillFastaBlock
+// Any unprocessed chars are moved to the start of the block and the remainder of the block is loaded from file
+// Returns number of chars loaded, 0 if EOF, < 0 if errors
+int
+CFasta::RefillFastaBlock(void)
+{
+int Remaining;
+int ReadLen;
+tsFastaBlock *pBlock = m_pCurFastaBlock;
+
+Remaining = pBlock->BuffCnt - pBlock->BuffIdx;
+if(Remaining >= pBlock->AllocSize)
+	{
+	AddErrMsg("CFasta::RefillFastaBlock","Errors whilst reading fastq file - '%s' - near line %d, record is longer than buffer size %d", m_szFile,m_CurFastQParseLine+1,pBlock->AllocSize);
+	return(eBSFerrFastqSeq);
+	}
+if(Remaining <= 0)
+	{
+	pBlock->FileOfs = m_gzFile != NULL ? gztell(m_gzFile) : _lseeki64(m_hFile,0,SEEK_CUR);
+	Remaining = 0;
+	}
+else
+	if(pBlock->BuffIdx > 0)
+		{
+		memmove(pBlock->pBlock,&pBlock->pBlock[pBlock->BuffIdx],Remaining);
+		pBlock->FileOfs += pBlock->BuffIdx;
+		}
+pBlock->BuffIdx = 0;
+pBlock->BuffCnt = Remaining;
+
+if(m_gzFile != NULL)
+	ReadLen = gzread(m_gzFile,&pBlock->pBlock[Remaining],pBlock->AllocSize - Remaining);
+else
+	ReadLen = read(m_hFile,&pBlock->pBlock[Remaining],pBlock->AllocSize - Remaining);
+if(ReadLen < 0)
+	{
+	AddErrMsg("CFasta::RefillFastaBlock","Errors whilst reading fastq file - '%s' near line %d, - %s", m_szFile, m_CurFastQParseLine+1, strerror(errno));
+	return(eBSFerrFileAccess);
+	}
+pBlock->BuffCnt += ReadLen;
+return(ReadLen);
+}
+
+// ParseFastqRec
+// Parses a complete fastq record (seq identifier + sequence + quality scores) in place
+// Lines are located with memchr() and then validated with the block tokenizer char classes, SOLiD colorspace sequences are decoded in place
+// No class state is referenced so multiple threads can concurrently parse records from their own buffers
+// Returns number of chars consumed, 0 if record is incomplete (or only whitespace remaining), < 0 if errors
+int
+CFasta::ParseFastqRec(UINT8 *pChrs,		// parse a complete fastq record starting at pChrs
+					int Len,				// at most this many chars available
+					bool bEOF,				// true if no more chars follow pChrs[Len-1]
+					tsFastqRecView *pRec,	// parsed record, FileOfs is relative to pChrs
+					int *pNumLines,			// returned number of lines consumed
+					const char **ppszErr)	// if errors then returned as describing the error
+{
+int Ofs;
+int LineIdx;
+int LineStart;
+int LineLen;
+int RunLen;
+int NumLines;
+int Idx;
+UINT8 *pEOL;
+char Chr;
+char PrvBase;
+int LineStarts[4];
+int LineLens[4];
+
+*pNumLines = 0;
+*ppszErr = NULL;
+
+// slough whitespace between records
+for(Ofs = 0; Ofs < Len && isspace(pChrs[Ofs]); Ofs++);
+if(Ofs == Len)
+	return(0);
+if(pChrs[Ofs] != '@')
+	{
+	*ppszErr = "expected '@' sequence identifer line";
+	return(eBSFerrFastqSeqID);
+	}
+pRec->FileOfs = Ofs;
+Ofs += 1;
+
+// locate the identifier, sequence, '+' and quality lines; blank lines before the sequence, '+' and quality lines are sloughed
+NumLines = 0;
+for(LineIdx = 0; LineIdx < 4; LineIdx++)
+	{
+	while(1)
+		{
+		LineStart = Ofs;
+		if((pEOL = (UINT8 *)memchr(&pChrs[Ofs],'\n',Len - Ofs)) == NULL)
+			{
+			if(!bEOF || LineIdx < 3)		// only the quality scores can be terminated by EOF
+				{
+				if(bEOF)
+					{
+					*ppszErr = "empty or truncated record elements";
+					return(eBSFerrFileAccess);
+					}
+				return(0);
+				}
+			LineLen = Len - Ofs;
+			Ofs = Len;
+			}
+		else
+			{
+			LineLen = (int)(pEOL - &pChrs[Ofs]);
+			Ofs += LineLen + 1;
+			NumLines += 1;
+			}
+		if(LineLen && pChrs[LineStart + LineLen - 1] == '\r')
+			LineLen -= 1;
+		if(LineIdx == 0 || LineLen > 0 || Ofs == Len)
+			break;
+		}
+	LineStarts[LineIdx] = LineStart;
+	LineLens[LineIdx] = LineLen;
+
+	// validate chars, whitespace other than CR/LF is accepted in identifiers and quality scores
+	RunLen = ScanRun(&pChrs[LineStart],LineLen,LineIdx == 1 ? cFCBase : cFCText);
+	for(Idx = RunLen; Idx < LineLen; Idx++)
+		{
+		Chr = (char)pChrs[LineStart + Idx];
+		if(LineIdx == 1)
+			{
+			if((Chr >= '0' && Chr <= '4') || Chr == '.' || (m_ChrClass[(UINT8)Chr] & cFCBase))
+				continue;
+			*ppszErr = "illegal sequence char";
+			return(eBSFerrFastqSeq);
+			}
+		if(Chr == '\r' || (!isspace((UINT8)Chr) && (Chr < 0x20 || (unsigned char)Chr > 0x7f)))
+			{
+			*ppszErr = "illegal chr";
+			return(eBSFerrFastqChr);
+			}
+		}
+	}
+
+if(LineLens[2] == 0 || pChrs[LineStarts[2]] != '+')
+	{
+	*ppszErr = "expected '+' sequence identifer line";
+	return(eBSFerrFastqDescr);
+	}
+if(LineLens[0] == 0 || LineLens[1] == 0 || LineLens[3] == 0)
+	{
+	*ppszErr = "empty or truncated record elements";
+	return(eBSFerrFileAccess);
+	}
+
+pRec->pDescr = (char *)&pChrs[LineStarts[0]];
+pRec->DescrLen = min(LineLens[0],(int)cMaxFastaDescrLen);
+pRec->pSeq = (char *)&pChrs[LineStarts[1]];
+pRec->SeqLen = LineLens[1];
+pRec->pQual = (char *)&pChrs[LineStarts[3]];
+pRec->QualLen = LineLens[3];
+
+if(ScanRun((UINT8 *)pRec->pSeq,pRec->SeqLen,cFCBase) != pRec->SeqLen)
+	{
+	// SOLiD colorspace: initial primer base followed by colors, decoded in place and the primer base and its quality score are sloughed
+	if(pRec->SeqLen < 2 || !(m_ChrClass[(UINT8)pRec->pSeq[0]] & cFCBase) || (m_ChrClass[(UINT8)pRec->pSeq[1]] & cFCBase))
+		{
+		*ppszErr = "unexpected SOLiD sequence type";
+		return(eBSFerrFastqSeq);
+		}
+	PrvBase = tolower(pRec->pSeq[0]);
+	for(Idx = 1; Idx < pRec->SeqLen; Idx++)
+		{
+		Chr = pRec->pSeq[Idx];
+		if(m_ChrClass[(UINT8)Chr] & cFCBase)
+			{
+			*ppszErr = "unexpected SOLiD sequence type";
+			return(eBSFerrFastqSeq);
+			}
+		switch(PrvBase) {
+			case 'n': case '4':	case '.':			// once an indeterminate base encountered then remainder are also treated as being indeterminate 
+				Chr = 'n';
+				break;
+			case 'a': case 'c': case 'g': case 't':
+				if(Chr >= '0' && Chr <= '3')
+					Chr = m_SOLiDmap[PrvBase == 'a' ? 0 : PrvBase == 'c' ? 1 : PrvBase == 'g' ? 2 : 3][Chr - '0'];
+				break;
+			}
+		pRec->pSeq[Idx-1] = Chr;
+		PrvBase = Chr;
+		}
+	pRec->SeqLen -= 1;
+	pRec->pQual += 1;
+	pRec->QualLen -= 1;
+	}
+
+// overlength sequences and quality scores are silently truncated
+if(pRec->SeqLen > (int)cMaxFastQSeqLen)
+	pRec->SeqLen = cMaxFastQSeqLen;
+if(pRec->QualLen > (int)cMaxFastQSeqLen)
+	pRec->QualLen = cMaxFastQSeqLen;
+if(pRec->SeqLen != pRec->QualLen)
+	{
+	*ppszErr = "number of quality scores not same as number of bases";
+	return(eBSFerrFileAccess);
+	}
+*pNumLines = NumLines;
+return(Ofs);
+}
+
+// ParseFastqRecView
+// Parses a complete fastq record with ParseFastqRec() and reports any errors against the current file and line
+// Returns number of chars consumed, 0 if record is incomplete (or only whitespace remaining), < 0 if errors
+int
+CFasta::ParseFastqRecView(UINT8 *pChrs,	// parse a complete fastq record starting at pChrs
+					int Len,				// at most this many chars available
+					bool bEOF,				// true if no more chars can be loaded from file
+					tsFastqRecView *pRec)	// parsed record
+{
+int Rslt;
+int NumLines;
+const char *pszErr;
+if((Rslt = ParseFastqRec(pChrs,Len,bEOF,pRec,&NumLines,&pszErr)) < 0)
+	{
+	AddErrMsg("CFasta::ReadFastqBatch","Errors whilst reading fastq file - '%s' - near line %d, %s", m_szFile,m_CurFastQParseLine+1,pszErr);
+	return(Rslt);
+	}
+m_CurFastQParseLine += NumLines;
+return(Rslt);
+}
+
+// ReadFastqBatch
+// Returns multiple fastq records per call with each record referencing the identifier, sequence and quality scores in place within the block buffer
+// The returned references are only valid until the next call which reads from this file
+// Whilst records are returned in batches, ReadSequence() can still be used to continue processing from the record following the last batch returned
+int											// returns number of fastq records returned in pRecs, 0 if EOF, < 0 if errors
+CFasta::ReadFastqBatch(int MaxRecs,			// return at most this many records
+					 tsFastqRecView *pRecs)	// records, referencing the block buffer, returned into this array
+{
+int Rslt;
+int NumRecs;
+bool bEOF;
+tsFastaBlock *pBlock;
+
+if ((m_gzFile == NULL && m_hFile == -1) || m_pCurFastaBlock == NULL || m_pCurFastaBlock->pBlock == NULL)
+	return(eBSFerrClosed);
+if(!m_bRead)
+	return(eBSFerrRead);
+if(!m_bIsFastQ || MaxRecs < 1 || pRecs == NULL)
+	return(eBSFerrParams);
+
+m_FastqSeqLen = 0;
+m_FastqSeqIdx = 0;
+m_FastqSeqQLen = 0;
+m_DescrAvail = false;
+pBlock = m_pCurFastaBlock;
+bEOF = false;
+NumRecs = 0;
+while(NumRecs < MaxRecs)
+	{
+	if((Rslt = ParseFastqRecView(&pBlock->pBlock[pBlock->BuffIdx],pBlock->BuffCnt - pBlock->BuffIdx,bEOF,pRecs)) < 0)
+		return(Rslt);
+	if(Rslt == 0)			// need more chars to complete record
+		{
+		if(bEOF || NumRecs)	// if records already returned then these reference the current block so it can't be refilled until the next call
+			break;
+		if((Rslt = RefillFastaBlock()) < 0)
+			return(Rslt);
+		if(Rslt == 0)
+			bEOF = true;
+		continue;
+		}
+	pRecs->FileOfs += pBlock->FileOfs + pBlock->BuffIdx;
+	m_FileDescrOfs = pRecs->FileOfs;
+	pBlock->BuffIdx += Rslt;
+	pRecs += 1;
+	NumRecs += 1;
+	}
+return(NumRecs);
+}
+
 
 
 // ReadSubsequence
@@ -1512,7 +1944,7 @@ return(SeqLen);
 }
 
 // Ascii2Sense
-// Translates ascii into etSeqBase's
+// Translates ascii into etSeqBase's, any char not 'acgtu' or '-' is translated as eBaseN
 // Caller can override assumption that lowercase represents softmasked repeats
 int
 CFasta::Ascii2Sense(char *pAscii,		// expected to be '\0' terminated, or SeqLen long
@@ -1522,43 +1954,11 @@ CFasta::Ascii2Sense(char *pAscii,		// expected to be '\0' terminated, or SeqLen
 {
 char Base;
 int SeqLen = 0;
+const UINT8 *pMap = m_Ascii2SenseMap[RptMskUpperCase ? 1 : 0];
 while(MaxSeqLen-- && (Base = *pAscii++)!='\0')
 	{
+	*pSeq++ = pMap[(UINT8)Base];
 	SeqLen++;
-	switch(Base) {
-		case 'a':
-			*pSeq++ = eBaseA | (RptMskUpperCase ? 0 : cRptMskFlg);
-			continue;
-		case 'A':
-			*pSeq++ = eBaseA  | (RptMskUpperCase ? cRptMskFlg : 0);
-			continue;
-		case 'c':
-			*pSeq++ = eBaseC  | (RptMskUpperCase ? 0 : cRptMskFlg);
-			continue;
-		case 'C':
-			*pSeq++ =  eBaseC | (RptMskUpperCase ? cRptMskFlg : 0);
-			continue;
-		case 'g':
-			*pSeq++ =  eBaseG  | (RptMskUpperCase ? 0 : cRptMskFlg);
-			continue;
-		case 'G':
-			*pSeq++ =  eBaseG | (RptMskUpperCase ? cRptMskFlg : 0);
-			continue;
-		case 't': case 'u': 
-			*pSeq++ =  eBaseT  | (RptMskUpperCase ? 0 : cRptMskFlg);
-			continue;
-		case 'T': case 'U':
-			*pSeq++ =  eBaseT | (RptMskUpperCase ? cRptMskFlg : 0);
-			continue;
-
-		case '-':
-			*pSeq++ =  eBaseInDel;
-			continue;
-
-		default: // 'N'
-			*pSeq++ = eBaseN;
-			continue;
-		}
 	}
 
 return(SeqLen);
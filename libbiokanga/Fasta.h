@@ -40,6 +40,11 @@ const unsigned int cMaxFastQSeqLen = cMaxReadLen;	// Allow FastQ sequences to be
 const int cgzAllocInBuffer = 0x1ffffff;				// gz processing input buffer size
 const int cgzAllocOutBuffer = 0x1ffffff;			// gz processing output buffer size
 
+// character classes used by the block tokenizer to locate runs of characters which can be bulk processed
+const UINT8 cFCText = 0x01;							// descriptor or quality score chars: 0x20..0x7f and tab
+const UINT8 cFCBase = 0x02;							// fastq sequence bases: 'a','c','g','t','n' in either case
+const UINT8 cFCSeq = 0x04;							// fasta sequence chars: alpha or '-'
+
 #pragma pack(1)
 typedef struct TAG_sFastaBlock
 	{
@@ -49,6 +54,18 @@ typedef struct TAG_sFastaBlock
 	INT32 AllocSize;			// block was allocated to buffer at most this many chars in Fasta[]
 	UINT8 *pBlock;				// allocated to hold a block of fasta file content
 	} tsFastaBlock;
+
+// fastq record as returned by ReadFastqBatch(), references are into the fasta block buffer and are only valid until the next read from the file
+typedef struct TAG_sFastqRecView
+	{
+	INT64 FileOfs;				// file offset at which the record's '@' sequence identifier starts
+	INT32 DescrLen;				// sequence identifier length, excludes the leading '@'
+	INT32 SeqLen;				// number of sequence bases
+	INT32 QualLen;				// number of quality scores, will be same as SeqLen
+	char *pDescr;				// sequence identifier, not '\0' terminated
+	char *pSeq;					// sequence bases, not '\0' terminated
+	char *pQual;				// quality scores, not '\0' terminated
+	} tsFastqRecView;
 #pragma pack()
 
 class CFasta : public CErrorCodes
@@ -61,6 +78,8 @@ class CFasta : public CErrorCodes
 	bool m_bIsFastQ;			// true if processing a fastq file
 	bool m_bIscsfasta;			// sequences are in SOLiD csfasta format
 	static UINT8 m_SOLiDmap[5][5]; // used for transforming from SOLiD colorspace into basespace
+	static const UINT8 m_ChrClass[256];	// character classes (cFCText, cFCBase, cFCSeq) used by the block tokenizer
+	static const UINT8 m_Ascii2SenseMap[2][256]; // ascii to etSeqBase, [0] if lowercase is repeat masked, [1] if uppercase is repeat masked
 	bool m_bRead;				// TRUE if reading fasta file, FALSE if write to fasta file
 
 	tsFastaBlock *m_pCurFastaBlock;    // buffered fasta block currently being processed
@@ -83,6 +102,16 @@ class CFasta : public CErrorCodes
 	int CheckIsFasta(void);		// checks if file contents are likely to be fasta or fastq format
 	int	ParseFastQblockQ(void); // Parses a fastq block (seq identifier + sequence + quality scores)
 
+	static int ScanRun(UINT8 *pChrs,	// returns length of run of chars starting at pChrs which are all of ChrClass
+					int MaxLen,			// run can be at most this length
+					UINT8 ChrClass);	// chars must be in this class
+
+	int RefillFastaBlock(void);			// retains unprocessed chars at start of block and appends from file, returns number of chars appended, 0 if EOF
+	int ParseFastqRecView(UINT8 *pChrs,	// parse a complete fastq record starting at pChrs
+					int Len,			// at most this many chars available
+					bool bEOF,			// true if no more chars can be loaded from file
+					tsFastqRecView *pRec); // parsed record, returns number of chars consumed, 0 if record incomplete, < 0 if errors
+
 public:
 	CFasta(void);
 	~CFasta(void);
@@ -121,6 +150,17 @@ public:
 	int ReadQValues(char *pRetQValues,	// where to return quality values
 					 int Max2Ret);			// max to return
 
+	int											// returns number of fastq records returned in pRecs, 0 if EOF, < 0 if errors
+		ReadFastqBatch(int MaxRecs,				// return at most this many records
+					 tsFastqRecView *pRecs);	// records, referencing the block buffer, returned into this array
+
+	static int ParseFastqRec(UINT8 *pChrs,		// parse a complete fastq record starting at pChrs, no state is shared so can be called concurrently by multiple threads
+					int Len,					// at most this many chars available
+					bool bEOF,					// true if no more chars follow pChrs[Len-1]
+					tsFastqRecView *pRec,		// parsed record, FileOfs is relative to pChrs
+					int *pNumLines,				// returned number of lines consumed
+					const char **ppszErr);		// if errors then returned as describing the error
+
 	int ReadDescriptor(char *pszDescriptor,int MaxLen); // copies last descriptor processed into pszDescriptor and returns copied length
 	INT64 GetDescrFileOfs(void);				// returns file offset at which descriptor returned by ReadDescriptor() was parsed from
 
@@ -0,0 +1,748 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#include "stdafx.h"
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#if _WIN32
+#include <process.h>
+#include "../libbiokanga/commhdrs.h"
+#else
+#include <sys/mman.h>
+#include <pthread.h>
+#include "../libbiokanga/commhdrs.h"
+#endif
+
+// CFasta accepts alpha chars and '-' as sequence bases, all other chars outside of descriptor lines are sloughed
+#define IsFaiSeqChr(Chr) ((((Chr) | 0x20) >= 'a' && ((Chr) | 0x20) <= 'z') || (Chr) == '-')
+
+CFastaIdx::CFastaIdx(void)
+{
+m_pMapped = NULL;
+#ifdef _WIN32
+m_hFile = INVALID_HANDLE_VALUE;
+m_hMapping = NULL;
+#else
+m_hFile = -1;
+#endif
+memset(&m_Entries,0,sizeof(m_Entries));
+Reset();
+}
+
+CFastaIdx::~CFastaIdx(void)
+{
+Reset();
+}
+
+void
+CFastaIdx::Reset(void)
+{
+#ifdef _WIN32
+if(m_pMapped != NULL)
+	UnmapViewOfFile(m_pMapped);
+if(m_hMapping != NULL)
+	CloseHandle(m_hMapping);
+if(m_hFile != INVALID_HANDLE_VALUE)
+	CloseHandle(m_hFile);
+m_hMapping = NULL;
+m_hFile = INVALID_HANDLE_VALUE;
+#else
+if(m_pMapped != NULL)
+	munmap(m_pMapped,(size_t)m_FileSize);
+if(m_hFile != -1)
+	close(m_hFile);
+m_hFile = -1;
+#endif
+m_pMapped = NULL;
+m_FileSize = 0;
+m_szFastaFile[0] = '\0';
+FreeEntries(&m_Entries);
+}
+
+void
+CFastaIdx::FreeEntries(tsFaiEntries *pEntries)
+{
+if(pEntries->pEntries != NULL)
+	free(pEntries->pEntries);		// was allocated with malloc/realloc
+if(pEntries->pszNames != NULL)
+	free(pEntries->pszNames);
+memset(pEntries,0,sizeof(tsFaiEntries));
+}
+
+int
+CFastaIdx::AddEntry(tsFaiEntries *pEntries,	// add entry
+				char *pszName,				// sequence name, need not be '\0' terminated
+				int NameLen,				// name is this length
+				INT64 SeqOfs,				// sequence starts at this file offset
+				INT64 SeqLen,				// sequence length in bases
+				int LineBases,				// bases per line
+				int LineWidth)				// bytes per line
+{
+tsFaiEntry *pEntry;
+if(NameLen > cFaiMaxNameLen)
+	NameLen = cFaiMaxNameLen;
+
+if(pEntries->pEntries == NULL || pEntries->NumEntries == pEntries->AllocEntries)
+	{
+	tsFaiEntry *pTmp;
+	int AllocEntries = pEntries->AllocEntries + max(cFaiInitAllocEntries,pEntries->AllocEntries / 2);
+	if((pTmp = (tsFaiEntry *)realloc(pEntries->pEntries,sizeof(tsFaiEntry) * (size_t)AllocEntries)) == NULL)
+		return(eBSFerrMem);
+	pEntries->pEntries = pTmp;
+	pEntries->AllocEntries = AllocEntries;
+	}
+if(pEntries->pszNames == NULL || (pEntries->NamesLen + NameLen + 1) > pEntries->AllocNames)
+	{
+	char *pTmp;
+	int AllocNames = pEntries->AllocNames + max(cFaiInitAllocNames,pEntries->AllocNames / 2);
+	if((pTmp = (char *)realloc(pEntries->pszNames,(size_t)AllocNames)) == NULL)
+		return(eBSFerrMem);
+	pEntries->pszNames = pTmp;
+	pEntries->AllocNames = AllocNames;
+	}
+pEntry = &pEntries->pEntries[pEntries->NumEntries++];
+pEntry->SeqOfs = SeqOfs;
+pEntry->SeqLen = SeqLen;
+pEntry->LineBases = LineBases;
+pEntry->LineWidth = LineWidth;
+pEntry->NameOfs = pEntries->NamesLen;
+memcpy(&pEntries->pszNames[pEntries->NamesLen],pszName,NameLen);
+pEntries->NamesLen += NameLen;
+pEntries->pszNames[pEntries->NamesLen++] = '\0';
+return(eBSFSuccess);
+}
+
+int
+CFastaIdx::Open(char *pszFastaFile,		// open and map fasta file, loading or generating its index
+			int NumThreads,				// if index is to be generated then use at most this many threads
+			bool bWriteIdx)				// if index was generated then write it as '<pszFastaFile>.fai'
+{
+int Rslt;
+INT64 Ofs;
+char szIdxFile[_MAX_PATH+10];
+
+Reset();
+strncpy(m_szFastaFile,pszFastaFile,sizeof(m_szFastaFile)-1);
+m_szFastaFile[sizeof(m_szFastaFile)-1] = '\0';
+
+#ifdef _WIN32
+LARGE_INTEGER FileSize;
+m_hFile = CreateFileA(pszFastaFile,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+if(m_hFile == INVALID_HANDLE_VALUE)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open %s - error %d",pszFastaFile,GetLastError());
+	Reset();
+	return(eBSFerrOpnFile);
+	}
+if(!GetFileSizeEx(m_hFile,&FileSize))
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to determine size of %s - error %d",pszFastaFile,GetLastError());
+	Reset();
+	return(eBSFerrFileAccess);
+	}
+m_FileSize = FileSize.QuadPart;
+#else
+m_hFile = open64(pszFastaFile,O_READSEQ);
+if(m_hFile == -1)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open %s - %s",pszFastaFile,strerror(errno));
+	Reset();
+	return(eBSFerrOpnFile);
+	}
+m_FileSize = _lseeki64(m_hFile,0,SEEK_END);
+#endif
+
+if(m_FileSize < 2)
+	{
+	Reset();
+	return(eBSFerrNotFasta);
+	}
+
+#ifdef _WIN32
+if((m_hMapping = CreateFileMapping(m_hFile,NULL,PAGE_READONLY,0,0,NULL))==NULL ||
+	(m_pMapped = (UINT8 *)MapViewOfFile(m_hMapping,FILE_MAP_READ,0,0,0))==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to map %lld bytes of %s - error %d",m_FileSize,pszFastaFile,GetLastError());
+	Reset();
+	return(eBSFerrMem);
+	}
+#else
+m_pMapped = (UINT8 *)mmap(NULL,(size_t)m_FileSize,PROT_READ,MAP_SHARED,m_hFile,0);
+if(m_pMapped == MAP_FAILED)
+	{
+	m_pMapped = NULL;
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to map %lld bytes of %s - %s",m_FileSize,pszFastaFile,strerror(errno));
+	Reset();
+	return(eBSFerrMem);
+	}
+#endif
+
+// only uncompressed multifasta, with the first non-whitespace char starting a descriptor, can be indexed
+// compressed, fastq or csfasta files are left for processing by CFasta
+if(m_pMapped[0] == 0x1f && m_pMapped[1] == 0x8b)
+	{
+	Reset();
+	return(eBSFerrNotFasta);
+	}
+for(Ofs = 0; Ofs < m_FileSize && isspace(m_pMapped[Ofs]); Ofs++);
+if(Ofs == m_FileSize || m_pMapped[Ofs] != '>' || (Ofs > 0 && m_pMapped[Ofs-1] != '\n' && m_pMapped[Ofs-1] != '\r'))
+	{
+	Reset();
+	return(eBSFerrNotFasta);
+	}
+
+sprintf(szIdxFile,"%s.fai",m_szFastaFile);
+#ifdef _WIN32
+struct _stat64 stFasta;
+struct _stat64 stIdx;
+if(!_stat64(m_szFastaFile,&stFasta) && !_stat64(szIdxFile,&stIdx) && stIdx.st_mtime >= stFasta.st_mtime)
+#else
+struct stat64 stFasta;
+struct stat64 stIdx;
+if(!stat64(m_szFastaFile,&stFasta) && !stat64(szIdxFile,&stIdx) && stIdx.st_mtime >= stFasta.st_mtime)
+#endif
+	{
+	if((Rslt = LoadIdx(szIdxFile)) >= eBSFSuccess)
+		{
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Loaded index '%s' for %d sequences",szIdxFile,m_Entries.NumEntries);
+		return(eBSFSuccess);
+		}
+	gDiagnostics.DiagOut(eDLWarn,gszProcName,"Index '%s' is inconsistent with '%s', regenerating index",szIdxFile,m_szFastaFile);
+	FreeEntries(&m_Entries);
+	}
+
+if((Rslt = GenIdx(NumThreads)) < eBSFSuccess)
+	{
+	Reset();
+	return(Rslt);
+	}
+// not fatal if unable to write index, it will be regenerated when next required
+// indexes with irregular line lengths would be rejected or misread by other faidx consumers so are never written
+if(bWriteIdx)
+	{
+	if(IsFaidxCompat())
+		WriteIdx(szIdxFile);
+	else
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Index for '%s' contains sequences with irregular line lengths, not writing '%s'",m_szFastaFile,szIdxFile);
+	}
+return(eBSFSuccess);
+}
+
+int
+CFastaIdx::LoadIdx(char *pszIdxFile)		// load previously generated index
+{
+int Rslt;
+int hFile;
+INT64 IdxSize;
+char *pszIdx;
+char *pChr;
+char *pszName;
+char *pszEOL;
+int NameLen;
+INT64 SeqLen;
+INT64 SeqOfs;
+INT64 PrevSeqOfs;
+int LineBases;
+int LineWidth;
+tsFaiEntry *pEntry;
+
+#ifdef _WIN32
+if((hFile = open(pszIdxFile,_O_RDONLY | _O_BINARY | _O_SEQUENTIAL))==-1)
+#else
+if((hFile = open(pszIdxFile,O_READSEQ))==-1)
+#endif
+	return(eBSFerrOpnFile);
+IdxSize = _lseeki64(hFile,0,SEEK_END);
+if(IdxSize <= 0 || IdxSize > 0x7fffffff || _lseeki64(hFile,0,SEEK_SET) != 0)
+	{
+	close(hFile);
+	return(eBSFerrFileAccess);
+	}
+if((pszIdx = new char [(size_t)IdxSize + 1]) == NULL)
+	{
+	close(hFile);
+	return(eBSFerrMem);
+	}
+if(read(hFile,pszIdx,(int)IdxSize) != (int)IdxSize)
+	{
+	delete [] pszIdx;
+	close(hFile);
+	return(eBSFerrFileAccess);
+	}
+close(hFile);
+pszIdx[IdxSize] = '\0';
+
+Rslt = eBSFSuccess;
+PrevSeqOfs = 0;
+pChr = pszIdx;
+while(Rslt >= eBSFSuccess && *pChr != '\0')
+	{
+	if((pszEOL = strchr(pChr,'\n')) != NULL)
+		*pszEOL = '\0';
+	pszName = pChr;
+	while(*pChr != '\0' && *pChr != '\t')
+		pChr++;
+	NameLen = (int)(pChr - pszName);
+	if(*pChr != '\t' || sscanf(pChr,"\t%lld\t%lld\t%d\t%d",&SeqLen,&SeqOfs,&LineBases,&LineWidth) != 4 ||
+		SeqLen < 0 || SeqOfs < PrevSeqOfs || SeqOfs > m_FileSize || LineBases < 0 || LineWidth < LineBases ||
+		(LineBases > 0 && (SeqOfs + ((SeqLen / LineBases) * LineWidth) + (SeqLen % LineBases)) > m_FileSize))
+		{
+		Rslt = eBSFerrFileAccess;
+		break;
+		}
+	Rslt = AddEntry(&m_Entries,pszName,NameLen,SeqOfs,SeqLen,LineBases,LineWidth);
+	PrevSeqOfs = SeqOfs;
+	pChr = pszEOL == NULL ? pChr + strlen(pChr) : pszEOL + 1;
+	}
+delete [] pszIdx;
+if(Rslt < eBSFSuccess)
+	return(Rslt);
+if(m_Entries.NumEntries == 0)
+	return(eBSFerrFileAccess);
+
+// first and last entries must be preceded by descriptors
+pEntry = &m_Entries.pEntries[0];
+if(DescrStart(pEntry->SeqOfs) < 0)
+	return(eBSFerrFileAccess);
+pEntry = &m_Entries.pEntries[m_Entries.NumEntries-1];
+if(DescrStart(pEntry->SeqOfs) < 0)
+	return(eBSFerrFileAccess);
+return(eBSFSuccess);
+}
+
+bool
+CFastaIdx::IsFaidxCompat(void)			// true if all sequences have regular line lengths so index can be written in the samtools faidx format
+{
+int EntryIdx;
+tsFaiEntry *pEntry;
+pEntry = m_Entries.pEntries;
+for(EntryIdx = 0; EntryIdx < m_Entries.NumEntries; EntryIdx++,pEntry++)
+	if(pEntry->SeqLen > 0 && (pEntry->LineBases <= 0 || pEntry->LineWidth < pEntry->LineBases))
+		return(false);
+return(m_Entries.NumEntries > 0 ? true : false);
+}
+
+int
+CFastaIdx::WriteIdx(char *pszIdxFile)		// write index
+{
+int hFile;
+int BuffLen;
+int EntryIdx;
+char *pszBuff;
+tsFaiEntry *pEntry;
+
+#ifdef _WIN32
+if((hFile = open(pszIdxFile, _O_RDWR | _O_BINARY | _O_SEQUENTIAL | _O_CREAT | _O_TRUNC, _S_IREAD | _S_IWRITE ))==-1)
+#else
+if((hFile = open(pszIdxFile, O_RDWR | O_CREAT | O_TRUNC, S_IREAD | S_IWRITE ))==-1)
+#endif
+	{
+	gDiagnostics.DiagOut(eDLWarn,gszProcName,"Unable to create or truncate index file '%s' - %s",pszIdxFile,strerror(errno));
+	return(eBSFerrCreateFile);
+	}
+if((pszBuff = new char [0x0100000]) == NULL)
+	{
+	close(hFile);
+	remove(pszIdxFile);
+	return(eBSFerrMem);
+	}
+BuffLen = 0;
+pEntry = m_Entries.pEntries;
+for(EntryIdx = 0; EntryIdx < m_Entries.NumEntries; EntryIdx++,pEntry++)
+	{
+	BuffLen += sprintf(&pszBuff[BuffLen],"%s\t%lld\t%lld\t%d\t%d\n",&m_Entries.pszNames[pEntry->NameOfs],pEntry->SeqLen,pEntry->SeqOfs,pEntry->LineBases,pEntry->LineWidth);
+	if(BuffLen + cFaiMaxNameLen + 100 > 0x0100000)
+		{
+		CUtility::SafeWrite(hFile,pszBuff,BuffLen);
+		BuffLen = 0;
+		}
+	}
+if(BuffLen)
+	CUtility::SafeWrite(hFile,pszBuff,BuffLen);
+delete [] pszBuff;
+#ifdef _WIN32
+_commit(hFile);
+#else
+fsync(hFile);
+#endif
+close(hFile);
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Written index '%s' for %d sequences",pszIdxFile,m_Entries.NumEntries);
+return(eBSFSuccess);
+}
+
+#ifdef _WIN32
+unsigned __stdcall ThreadedFastaIdx(void * pThreadPars)
+#else
+void * ThreadedFastaIdx(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsFaiThreadPars *pPars = (tsFaiThreadPars *)pThreadPars; // makes it easier not having to deal with casts!
+CFastaIdx *pThis = (CFastaIdx *)pPars->pThis;
+Rslt = pThis->IndexThread(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+int
+CFastaIdx::GenIdx(int NumThreads)			// generate index using at most NumThreads threads
+{
+int Rslt;
+int ThreadIdx;
+int EntryIdx;
+INT64 RangeLen;
+tsFaiThreadPars *pThreads;
+tsFaiThreadPars *pPars;
+tsFaiEntry *pEntry;
+
+NumThreads = (int)min((INT64)min(NumThreads,cFaiMaxThreads),1 + (m_FileSize / cFaiMinThreadRange));
+if(NumThreads < 1)
+	NumThreads = 1;
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Generating index for '%s' using %d threads",m_szFastaFile,NumThreads);
+
+if((pThreads = new tsFaiThreadPars [NumThreads]) == NULL)
+	return(eBSFerrMem);
+memset(pThreads,0,sizeof(tsFaiThreadPars) * NumThreads);
+
+// byte ranges are scanned concurrently, each thread indexes those sequences whose descriptors start within its range
+RangeLen = (m_FileSize + NumThreads - 1) / NumThreads;
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+	pPars->ThreadIdx = ThreadIdx + 1;
+	pPars->pThis = this;
+	pPars->StartOfs = RangeLen * ThreadIdx;
+	pPars->EndOfs = min(m_FileSize,RangeLen * (ThreadIdx + 1));
+	pPars->Rslt = eBSFSuccess;
+#ifdef _WIN32
+	pPars->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ThreadedFastaIdx,pPars,0,&pPars->threadID);
+#else
+	pPars->threadRslt = pthread_create(&pPars->threadID,NULL,ThreadedFastaIdx,pPars);
+#endif
+	}
+
+Rslt = eBSFSuccess;
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+#ifdef _WIN32
+	WaitForSingleObject(pPars->threadHandle,INFINITE);
+	CloseHandle(pPars->threadHandle);
+#else
+	pthread_join(pPars->threadID,NULL);
+#endif
+	if(pPars->Rslt < eBSFSuccess && Rslt >= eBSFSuccess)
+		Rslt = pPars->Rslt;
+	}
+
+// concatenate thread entries in file order
+pEntry = NULL;
+for(ThreadIdx = 0, pPars = pThreads; Rslt >= eBSFSuccess && ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	{
+	pEntry = pPars->Entries.pEntries;
+	for(EntryIdx = 0; Rslt >= eBSFSuccess && EntryIdx < pPars->Entries.NumEntries; EntryIdx++, pEntry++)
+		Rslt = AddEntry(&m_Entries,&pPars->Entries.pszNames[pEntry->NameOfs],(int)strlen(&pPars->Entries.pszNames[pEntry->NameOfs]),
+								pEntry->SeqOfs,pEntry->SeqLen,pEntry->LineBases,pEntry->LineWidth);
+	}
+for(ThreadIdx = 0, pPars = pThreads; ThreadIdx < NumThreads; ThreadIdx++, pPars++)
+	FreeEntries(&pPars->Entries);
+delete [] pThreads;
+if(Rslt < eBSFSuccess)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to generate index for '%s'",m_szFastaFile);
+	return(Rslt);
+	}
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"Generated index for %d sequences",m_Entries.NumEntries);
+return(eBSFSuccess);
+}
+
+int
+CFastaIdx::IndexThread(tsFaiThreadPars *pPars)	// index sequences starting within thread's byte range
+{
+int Rslt;
+UINT8 *pDescr;
+UINT8 *pName;
+UINT8 *pSeq;
+UINT8 *pLine;
+UINT8 *pEOL;
+UINT8 *pChr;
+UINT8 *pEOF;
+UINT8 *pEnd;
+INT64 SeqLen;
+int LineLen;
+int LineChrs;
+int LineBases;
+int LineWidth;
+int Width;
+bool bRegular;
+bool bShortLine;
+
+pEOF = &m_pMapped[m_FileSize];
+pEnd = &m_pMapped[pPars->EndOfs];
+
+// locate first descriptor, starting a line, within range
+pDescr = &m_pMapped[pPars->StartOfs];
+while(pDescr < pEnd)
+	{
+	if((pDescr = (UINT8 *)memchr(pDescr,'>',pEnd - pDescr)) == NULL)
+		return(eBSFSuccess);
+	if(pDescr == m_pMapped || pDescr[-1] == '\n' || pDescr[-1] == '\r')
+		break;
+	pDescr++;
+	}
+
+Rslt = eBSFSuccess;
+while(Rslt >= eBSFSuccess && pDescr < pEnd)
+	{
+	// sequence name is the descriptor up to the first space or tab
+	pName = pDescr + 1;
+	for(pChr = pName; pChr < pEOF && *pChr != ' ' && *pChr != '\t' && *pChr != '\n' && *pChr != '\r'; pChr++);
+	LineLen = (int)(pChr - pName);
+	if((pSeq = (UINT8 *)memchr(pChr,'\n',pEOF - pChr)) == NULL)
+		pSeq = pEOF;
+	else
+		pSeq++;
+
+	// sequence continues, line by line, until the next line starting with a descriptor
+	// line geometry is regular if all lines, other than the last, have the same number of bases and bytes, and only line terminators are sloughed
+	SeqLen = 0;
+	LineBases = 0;
+	LineWidth = 0;
+	bRegular = true;
+	bShortLine = false;
+	pDescr = pEOF;
+	pLine = pSeq;
+	while(pLine < pEOF)
+		{
+		if(*pLine == '>')
+			{
+			pDescr = pLine;
+			break;
+			}
+		if((pEOL = (UINT8 *)memchr(pLine,'\n',pEOF - pLine)) == NULL)
+			pEOL = pEOF;
+		LineChrs = 0;
+		for(pChr = pLine; pChr < pEOL; pChr++)
+			if(IsFaiSeqChr(*pChr))
+				LineChrs += 1;
+		if(LineChrs == 0)					// blank lines are only accepted following the last line containing bases
+			{
+			if(SeqLen == 0)
+				bRegular = false;
+			else
+				bShortLine = true;
+			}
+		else
+			if(bRegular)
+				{
+				pChr = pEOL;
+				if(pChr > pLine && pChr[-1] == '\r')
+					pChr--;
+				Width = (int)(pEOL - pLine) + (pEOL < pEOF ? 1 : 0);
+				if(bShortLine || (int)(pChr - pLine) != LineChrs)
+					bRegular = false;
+				else
+					if(LineBases == 0)
+						{
+						LineBases = LineChrs;
+						LineWidth = Width;
+						}
+					else
+						if(LineChrs > LineBases || (LineChrs == LineBases && Width != LineWidth && pEOL < pEOF))
+							bRegular = false;
+						else
+							if(LineChrs < LineBases)
+								bShortLine = true;
+				}
+		SeqLen += LineChrs;
+		pLine = pEOL < pEOF ? pEOL + 1 : pEOF;
+		}
+
+	if(!bRegular || SeqLen == 0)
+		{
+		LineBases = 0;
+		LineWidth = 0;
+		}
+	Rslt = AddEntry(&pPars->Entries,(char *)pName,LineLen,(INT64)(pSeq - m_pMapped),SeqLen,LineBases,LineWidth);
+	}
+return(Rslt);
+}
+
+INT64
+CFastaIdx::DescrStart(INT64 SeqOfs)		// returns file offset of '>' starting descriptor line preceding SeqOfs, < 0 if unable to locate
+{
+INT64 Ofs;
+if(m_pMapped == NULL || SeqOfs < 1 || SeqOfs > m_FileSize)
+	return(-1);
+Ofs = SeqOfs;
+if(Ofs < m_FileSize || m_pMapped[Ofs-1] == '\n')	// unless descriptor was terminated by EOF then skip back over its line terminator
+	{
+	if(m_pMapped[Ofs-1] != '\n')
+		return(-1);
+	Ofs -= 1;
+	}
+while(Ofs > 0 && m_pMapped[Ofs-1] != '\n')
+	Ofs -= 1;
+if(m_pMapped[Ofs] != '>')
+	return(-1);
+return(Ofs);
+}
+
+int
+CFastaIdx::GetNumEntries(void)
+{
+return(m_Entries.NumEntries);
+}
+
+tsFaiEntry *
+CFastaIdx::GetEntry(int EntryIdx)
+{
+if(EntryIdx < 0 || EntryIdx >= m_Entries.NumEntries)
+	return(NULL);
+return(&m_Entries.pEntries[EntryIdx]);
+}
+
+char *
+CFastaIdx::GetName(int EntryIdx)
+{
+if(EntryIdx < 0 || EntryIdx >= m_Entries.NumEntries)
+	return(NULL);
+return(&m_Entries.pszNames[m_Entries.pEntries[EntryIdx].NameOfs]);
+}
+
+int
+CFastaIdx::GetDescr(int EntryIdx,			// copy descriptor, excluding the '>', for this entry
+				char *pszDescr,				// into this buffer
+				int MaxLen)					// buffer can hold at most this many chars including terminating '\0', returns descriptor length
+{
+INT64 Ofs;
+int Len;
+char Chr;
+if(EntryIdx < 0 || EntryIdx >= m_Entries.NumEntries || pszDescr == NULL || MaxLen < 1)
+	return(eBSFerrParams);
+if((Ofs = DescrStart(m_Entries.pEntries[EntryIdx].SeqOfs)) < 0)
+	return(eBSFerrFastaDescr);
+
+// as with CFasta, descriptors are terminated by '\r' or '\n', truncated to cMaxFastaDescrLen, and chars > 0x7f substituted with '?'
+Len = 0;
+for(Ofs += 1; Ofs < m_FileSize && Len < (int)cMaxFastaDescrLen && Len < MaxLen - 1; Ofs++)
+	{
+	Chr = (char)m_pMapped[Ofs];
+	if(Chr == '\n' || Chr == '\r')
+		break;
+	if((UINT8)Chr > 0x7f)
+		Chr = '?';
+	pszDescr[Len++] = Chr;
+	}
+pszDescr[Len] = '\0';
+return(Len);
+}
+
+INT64
+CFastaIdx::LocateBase(int EntryIdx,			// returns file offset from which base at BaseOfs for this entry can be copied, < 0 if errors
+				INT64 BaseOfs,				// base offset
+				INT64 FromBaseOfs,			// if irregular line lengths then counting bases forward from this previously located base offset
+				INT64 FromFileOfs)			// at this file offset, -1 if counting from the sequence start
+{
+tsFaiEntry *pEntry;
+UINT8 *pChr;
+UINT8 *pEOF;
+INT64 Bases2Skip;
+
+if(EntryIdx < 0 || EntryIdx >= m_Entries.NumEntries || BaseOfs < 0)
+	return(eBSFerrParams);
+pEntry = &m_Entries.pEntries[EntryIdx];
+if(BaseOfs > pEntry->SeqLen)
+	return(eBSFerrParams);
+if(pEntry->LineBases > 0)
+	return(pEntry->SeqOfs + ((BaseOfs / pEntry->LineBases) * pEntry->LineWidth) + (BaseOfs % pEntry->LineBases));
+
+// irregular line lengths, or sloughed chars, so need to count bases
+if(FromFileOfs < 0 || FromBaseOfs > BaseOfs)
+	{
+	FromFileOfs = pEntry->SeqOfs;
+	FromBaseOfs = 0;
+	}
+if(FromFileOfs < pEntry->SeqOfs || FromFileOfs > m_FileSize)
+	return(eBSFerrParams);
+pChr = &m_pMapped[FromFileOfs];
+pEOF = &m_pMapped[m_FileSize];
+for(Bases2Skip = BaseOfs - FromBaseOfs; Bases2Skip > 0 && pChr < pEOF; pChr++)
+	if(IsFaiSeqChr(*pChr))
+		Bases2Skip -= 1;
+if(Bases2Skip > 0)
+	return(eBSFerrOfs);
+return((INT64)(pChr - m_pMapped));
+}
+
+int
+CFastaIdx::GetSeq(int EntryIdx,				// copy ascii sequence chars for this entry
+				INT64 StartOfs,				// starting from this base offset
+				int Len,					// copy at most this many bases
+				char *pszSeq,				// into this buffer, must be at least Len+1 chars, returns number of bases copied
+				INT64 FileOfs)				// if irregular line lengths then StartOfs was previously located at this file offset by LocateBase()
+{
+tsFaiEntry *pEntry;
+UINT8 *pChr;
+UINT8 *pEOF;
+int LineRem;
+int CpyLen;
+int NumCopied;
+
+if(EntryIdx < 0 || EntryIdx >= m_Entries.NumEntries || StartOfs < 0 || Len < 0 || pszSeq == NULL)
+	return(eBSFerrParams);
+pEntry = &m_Entries.pEntries[EntryIdx];
+if(StartOfs >= pEntry->SeqLen || Len == 0)
+	{
+	*pszSeq = '\0';
+	return(0);
+	}
+Len = (int)min((INT64)Len,pEntry->SeqLen - StartOfs);
+pEOF = &m_pMapped[m_FileSize];
+NumCopied = 0;
+
+if(pEntry->LineBases > 0)
+	{
+	// regular line lengths so can directly locate the starting base and copy line by line
+	pChr = &m_pMapped[pEntry->SeqOfs + ((StartOfs / pEntry->LineBases) * pEntry->LineWidth) + (StartOfs % pEntry->LineBases)];
+	LineRem = pEntry->LineBases - (int)(StartOfs % pEntry->LineBases);
+	while(NumCopied < Len)
+		{
+		CpyLen = min(LineRem,Len - NumCopied);
+		memcpy(&pszSeq[NumCopied],pChr,CpyLen);
+		NumCopied += CpyLen;
+		pChr += CpyLen + (pEntry->LineWidth - pEntry->LineBases);
+		LineRem = pEntry->LineBases;
+		}
+	}
+else
+	{
+	// irregular line lengths, or sloughed chars, so need to count bases from the sequence start unless already located
+	if(FileOfs >= pEntry->SeqOfs && FileOfs <= m_FileSize)
+		pChr = &m_pMapped[FileOfs];
+	else
+		{
+		if((FileOfs = LocateBase(EntryIdx,StartOfs)) < 0)
+			return((int)FileOfs);
+		pChr = &m_pMapped[FileOfs];
+		}
+	while(NumCopied < Len && pChr < pEOF)
+		{
+		if(IsFaiSeqChr(*pChr))
+			pszSeq[NumCopied++] = (char)*pChr;
+		pChr++;
+		}
+	}
+pszSeq[NumCopied] = '\0';
+return(NumCopied);
+}
@@ -0,0 +1,107 @@
+#pragma once
+// Sidecar '.fai' style indexes of uncompressed multifasta files
+// Files are memory mapped and the index generated in a single pass, with byte ranges of the mapped file being concurrently scanned,
+// recording the name, file offset, length and line geometry of each sequence. Generated indexes are written alongside the fasta file
+// as '<file>.fai' in the samtools faidx format and are reused whilst they are not older than the fasta file. Indexes containing
+// sequences with irregular line lengths can't be represented in the faidx format and are only retained in memory.
+// Sequences, or subsequences, are then copied directly from the mapped file without the file needing to be parsed.
+
+const int cFaiMaxThreads = 16;						// at most this many threads used when generating an index
+const INT64 cFaiMinThreadRange = 0x04000000;		// each thread scans a byte range of at least this many bytes
+const int cFaiInitAllocEntries = 0x04000;			// initially allocate for this many index entries, realloc'd as may be required
+const int cFaiInitAllocNames = 0x040000;			// initially allocate for this many sequence name chars, realloc'd as may be required
+const int cFaiMaxNameLen = 1000;					// sequence names are truncated to be at most this length
+
+#pragma pack(1)
+typedef struct TAG_sFaiEntry {
+	INT64 SeqOfs;				// file offset of the first sequence char following the descriptor line
+	INT64 SeqLen;				// sequence length in bases
+	INT32 LineBases;			// number of bases on each sequence line, except the last; 0 if line lengths are irregular
+	INT32 LineWidth;			// number of bytes on each sequence line, including line terminators; 0 if line lengths are irregular
+	INT32 NameOfs;				// offset of '\0' terminated sequence name in names
+	} tsFaiEntry;
+
+typedef struct TAG_sFaiEntries {
+	int NumEntries;				// number of entries in pEntries
+	int AllocEntries;			// pEntries allocated to hold at most this many entries
+	tsFaiEntry *pEntries;		// index entries, in file order
+	int NamesLen;				// number of chars used in pszNames
+	int AllocNames;				// pszNames allocated to hold at most this many chars
+	char *pszNames;				// concatenated '\0' terminated sequence names
+	} tsFaiEntries;
+
+typedef struct TAG_sFaiThreadPars {
+	int ThreadIdx;				// uniquely identifies this thread
+	void *pThis;				// will be initialised to pt to class instance
+#ifdef _WIN32
+	HANDLE threadHandle;		// handle as returned by _beginthreadex()
+	unsigned int threadID;		// identifier as set by _beginthreadex()
+#else
+	int threadRslt;				// result as returned by pthread_create ()
+	pthread_t threadID;			// identifier as set by pthread_create ()
+#endif
+	INT64 StartOfs;				// index sequences with descriptors starting at or after this file offset
+	INT64 EndOfs;				// and before this file offset
+	tsFaiEntries Entries;		// entries for sequences starting in StartOfs..EndOfs-1
+	int Rslt;					// thread processing result
+	} tsFaiThreadPars;
+#pragma pack()
+
+class CFastaIdx
+{
+	char m_szFastaFile[_MAX_PATH];		// mapped fasta file
+	INT64 m_FileSize;					// mapped file is this size
+	UINT8 *m_pMapped;					// file is mapped starting at this address
+#ifdef _WIN32
+	HANDLE m_hFile;						// mapped file handle
+	HANDLE m_hMapping;					// file mapping handle
+#else
+	int m_hFile;						// mapped file handle
+#endif
+	tsFaiEntries m_Entries;				// index entries
+
+	static void FreeEntries(tsFaiEntries *pEntries);
+	static int AddEntry(tsFaiEntries *pEntries,	// add entry
+					char *pszName,				// sequence name, need not be '\0' terminated
+					int NameLen,				// name is this length
+					INT64 SeqOfs,				// sequence starts at this file offset
+					INT64 SeqLen,				// sequence length in bases
+					int LineBases,				// bases per line
+					int LineWidth);				// bytes per line
+
+	int LoadIdx(char *pszIdxFile);		// load previously generated index, returns < eBSFSuccess if unable to load or index inconsistent with mapped file
+	int GenIdx(int NumThreads);			// generate index using at most NumThreads threads
+	bool IsFaidxCompat(void);			// true if all sequences have regular line lengths so index can be written in the samtools faidx format
+	int WriteIdx(char *pszIdxFile);		// write index
+	INT64 DescrStart(INT64 SeqOfs);		// returns file offset of '>' starting descriptor line preceding SeqOfs, < 0 if unable to locate
+
+public:
+	CFastaIdx(void);
+	~CFastaIdx(void);
+
+	void Reset(void);					// unmaps and closes any opened file
+
+	int Open(char *pszFastaFile,		// open and map fasta file, loading or generating its index
+			int NumThreads = 4,			// if index is to be generated then use at most this many threads
+			bool bWriteIdx = true);		// if index was generated then write it as '<pszFastaFile>.fai'
+										// returns eBSFerrNotFasta if file is compressed or otherwise not indexable, can then be processed with CFasta
+
+	int IndexThread(tsFaiThreadPars *pPars);	// index sequences starting within thread's byte range
+
+	int GetNumEntries(void);			// returns number of indexed sequences
+	tsFaiEntry *GetEntry(int EntryIdx);	// returns ptr to entry (0..GetNumEntries()-1)
+	char *GetName(int EntryIdx);		// returns ptr to '\0' terminated sequence name
+	int GetDescr(int EntryIdx,			// copy descriptor, excluding the '>', for this entry
+				char *pszDescr,			// into this buffer
+				int MaxLen);			// buffer can hold at most this many chars including terminating '\0', returns descriptor length
+	INT64 LocateBase(int EntryIdx,		// returns file offset from which base at BaseOfs for this entry can be copied, < 0 if errors
+				INT64 BaseOfs,			// base offset
+				INT64 FromBaseOfs = 0,		// if irregular line lengths then counting bases forward from this previously located base offset
+				INT64 FromFileOfs = -1);	// at this file offset, -1 if counting from the sequence start
+	int GetSeq(int EntryIdx,			// copy ascii sequence chars for this entry
+				INT64 StartOfs,			// starting from this base offset
+				int Len,				// copy at most this many bases
+				char *pszSeq,			// into this buffer, must be at least Len+1 chars, returns number of bases copied
+				INT64 FileOfs = -1);	// if irregular line lengths then StartOfs was previously located at this file offset by LocateBase()
+};
+
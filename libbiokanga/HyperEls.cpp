@@ -24,35 +24,6 @@ Reset();
 
 CHyperEls::~CHyperEls(void)
 {
-if(m_pSeqBases != NULL)
-	{
-#ifdef _WIN32
-	free(m_pSeqBases);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pSeqBases != MAP_FAILED)
-		munmap(m_pSeqBases,m_MemAllocSeqBases);
-#endif
-	}
-
-if(m_pElements != NULL)
-	{
-#ifdef _WIN32
-	free(m_pElements);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pElements != MAP_FAILED)
-		munmap(m_pElements,m_MemAllocEls);
-#endif
-	}
-if(m_pChroms != NULL)
-	{
-#ifdef _WIN32
-	free(m_pChroms);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pChroms != MAP_FAILED)
-		munmap(m_pChroms,m_MemAllocChroms);
-#endif
-	}
-
 if(m_pChromHashes != NULL)
 	delete m_pChromHashes;
 }
@@ -61,27 +32,10 @@ if(m_pChromHashes != NULL)
 void
 CHyperEls::Reset(void)
 {
-if(m_pSeqBases != NULL)
-	{
-#ifdef _WIN32
-	free(m_pSeqBases);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pSeqBases != MAP_FAILED)
-		munmap(m_pSeqBases,m_MemAllocSeqBases);
-#endif
-	m_pSeqBases = NULL;
-	}
-
-if(m_pElements != NULL)
-	{
-#ifdef _WIN32
-	free(m_pElements);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pElements != MAP_FAILED)
-		munmap(m_pElements,m_MemAllocEls);
-#endif
-	m_pElements = NULL;
-	}
+m_SeqBasesArena.Release();
+m_pSeqBases = NULL;
+m_ElsArena.Release();
+m_pElements = NULL;
 m_MemAllocSeqBases = 0;
 m_MemUsedSeqBases = 0;
 m_NumSeqs = 0;
@@ -94,16 +48,8 @@ m_MaxLenEl = 0;
 m_MinLenEl = -1;
 
 
-if(m_pChroms != NULL)
-	{
-#ifdef _WIN32
-	free(m_pChroms);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pChroms != MAP_FAILED)
-		munmap(m_pChroms,m_MemAllocChroms);
-#endif
-	m_pChroms = 0;
-	}
+m_ChromsArena.Release();
+m_pChroms = NULL;
 
 if(m_pChromHashes != NULL)
 	{
@@ -137,26 +83,12 @@ UINT16 aHash = CUtility::GenHash16(pszChrom);
 if(m_pChroms == NULL)
 	{
 	m_MemAllocChroms = cChromsInitalAllocNum * sizeof(tsHyperChrom);
-#ifdef _WIN32
-	m_pChroms = (tsHyperChrom *) malloc(m_MemAllocChroms);	// initial and perhaps the only allocation
-
-	if(m_pChroms == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddChrom: Memory allocation of %lld bytes - %s",(INT64)m_MemAllocChroms,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pChroms = (tsHyperChrom *)mmap(NULL,m_MemAllocChroms, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pChroms == MAP_FAILED)
+	if((m_pChroms = (tsHyperChrom *)m_ChromsArena.Grow(m_MemAllocChroms)) == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddChrom: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_MemAllocChroms,strerror(errno));
-		m_pChroms = NULL;
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddChrom: Memory allocation of %lld bytes failed",(INT64)m_MemAllocChroms);
 		Reset();
 		return(eBSFerrMem);
 		}
-#endif
 	m_NumChromsAllocd = cChromsInitalAllocNum;
 	m_NumChroms = 0;
 	}
@@ -170,16 +102,9 @@ if(m_pChromHashes == NULL)
 if((m_NumChroms+5) >= m_NumChromsAllocd)
 	{
 	size_t memreq = m_MemAllocChroms + (cChromsGrowAllocNum * sizeof(tsHyperChrom));
-#ifdef _WIN32
-	pNewChrom = (tsHyperChrom *) realloc(m_pChroms,memreq);
-	if(pNewChrom == NULL)
-		{
-#else
-	pNewChrom = (tsHyperChrom *)mremap(m_pChroms,m_MemAllocChroms,memreq,MREMAP_MAYMOVE);
-	if(pNewChrom == MAP_FAILED)
+	if((pNewChrom = (tsHyperChrom *)m_ChromsArena.Grow(memreq)) == NULL)
 		{
-#endif
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory reallocation to %lld bytes failed - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddChrom: Memory reallocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 	m_pChroms = pNewChrom;
@@ -357,83 +282,25 @@ if(m_pSeqBases != NULL && m_MemAllocSeqBases >= memreqseqs && 		// why alloc if
 	return(eBSFSuccess);
 	}
 
-if(m_pSeqBases != NULL && m_MemAllocSeqBases < memreqseqs)
-	{
-#ifdef _WIN32
-	free(m_pSeqBases);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pSeqBases != MAP_FAILED)
-		munmap(m_pSeqBases,m_MemAllocSeqBases);
-#endif
-	m_pSeqBases = NULL;	
-	m_MemAllocSeqBases = 0;
-	}
-
-if(m_pElements != NULL &&  m_MemAllocEls < memreqels)
+if((m_pSeqBases = (etSeqBase *)m_SeqBasesArena.Grow(memreqseqs)) == NULL)
 	{
-#ifdef _WIN32
-	free(m_pElements);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pElements != MAP_FAILED)
-		munmap(m_pElements,m_MemAllocEls);
-#endif
-	m_pElements = NULL;
-	m_MemAllocEls = 0;
-	}
-
-
-if(m_pSeqBases == NULL)
-	{
-	m_MemAllocSeqBases = memreqseqs; 
-
-#ifdef _WIN32
-	m_pSeqBases = (etSeqBase *) malloc(m_MemAllocSeqBases);	// initial and perhaps the only allocation
-	if(m_pSeqBases == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"PreAllocMem: Memory allocation of %lld bytes - %s",(INT64)m_MemAllocSeqBases,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-		// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pSeqBases = (etSeqBase *)mmap(NULL,m_MemAllocSeqBases, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pSeqBases == MAP_FAILED)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"PreAllocMem: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_MemAllocSeqBases,strerror(errno));
-		m_pSeqBases = NULL;
-		Reset();
-		return(eBSFerrMem);
-		}
-#endif
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"PreAllocMem: Memory allocation of %lld bytes failed",(INT64)memreqseqs);
+	Reset();
+	return(eBSFerrMem);
 	}
+m_MemAllocSeqBases = m_SeqBasesArena.Committed();
 memset(m_pSeqBases,0,m_MemAllocSeqBases);
 m_MemUsedSeqBases = 0;
 m_NumSeqs = 0;
 
-if(m_pElements == NULL)
+if((m_pElements = (tsHyperElement *)m_ElsArena.Grow(memreqels)) == NULL)
 	{
-	m_NumElsAllocd = m_EstNumEls;
-	m_MemAllocEls = memreqels;
-#ifdef _WIN32
-	m_pElements = (tsHyperElement *) malloc(m_MemAllocEls);	// initial and perhaps the only allocation
-	if(m_pElements == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes - %s",(INT64)m_MemAllocEls,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-		// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pElements = (tsHyperElement *)mmap(NULL,m_MemAllocEls, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pElements == MAP_FAILED)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_MemAllocEls,strerror(errno));
-		m_pElements = NULL;
-		Reset();
-		return(eBSFerrMem);
-		}
-#endif
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"PreAllocMem: Memory allocation of %lld bytes failed",(INT64)memreqels);
+	Reset();
+	return(eBSFerrMem);
 	}
+m_MemAllocEls = m_ElsArena.Committed();
+m_NumElsAllocd = (int)(m_MemAllocEls / sizeof(tsHyperElement));
 memset(m_pElements,0,m_MemAllocEls);	
 m_NumEls = 0;
 m_NumElsPlus = 0;
@@ -491,27 +358,13 @@ if(!NumSNPBases && pSeq != NULL && m_pSeqBases == NULL)
 		memreq = (size_t)(((size_t)m_EstNumEls * 110)/(size_t)100) * sizeof(etSeqBase) * 100;
 	else
 		memreq = (size_t)cElInitalAllocNum  * sizeof(etSeqBase) * (size_t)100;
-	m_MemAllocSeqBases = memreq;
-#ifdef _WIN32
-	m_pSeqBases = (etSeqBase *) malloc(m_MemAllocSeqBases);	// initial and perhaps the only allocation
-
-	if(m_pSeqBases == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes - %s",(INT64)m_MemAllocSeqBases,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pSeqBases = (etSeqBase *)mmap(NULL,m_MemAllocSeqBases, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pSeqBases == MAP_FAILED)
+	if((m_pSeqBases = (etSeqBase *)m_SeqBasesArena.Grow(memreq)) == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_MemAllocSeqBases,strerror(errno));
-		m_pSeqBases = NULL;
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes failed",(INT64)memreq);
 		Reset();
 		return(eBSFerrMem);
 		}
-#endif
+	m_MemAllocSeqBases = m_SeqBasesArena.Committed();
 	m_MemUsedSeqBases = 0;
 	m_NumSeqs = 0;
 	}
@@ -519,20 +372,13 @@ if(!NumSNPBases && pSeq != NULL && m_pSeqBases == NULL)
 if(!NumSNPBases && pSeq != NULL && (m_MemUsedSeqBases + Len + 10000)  >= m_MemAllocSeqBases)
 	{
 	memreq = m_MemAllocSeqBases + (cElGrowAllocNum * sizeof(etSeqBase) * 200);
-#ifdef _WIN32
-	pBase = (etSeqBase *) realloc(m_pSeqBases,memreq);
-	if(pBase == NULL)
+	if((pBase = (etSeqBase *)m_SeqBasesArena.Grow(memreq)) == NULL)
 		{
-#else
-	pBase = (etSeqBase *)mremap(m_pSeqBases,m_MemAllocSeqBases,memreq,MREMAP_MAYMOVE);
-	if(pBase == MAP_FAILED)
-		{
-#endif
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory reallocation to %lld bytes failed - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory reallocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 	m_pSeqBases = pBase;
-	m_MemAllocSeqBases = memreq;
+	m_MemAllocSeqBases = m_SeqBasesArena.Committed();
 	}
 
 if(m_pElements == NULL)
@@ -547,27 +393,13 @@ if(m_pElements == NULL)
 		memreq = (size_t)cElInitalAllocNum * sizeof(tsHyperElement);
 		m_NumElsAllocd = cElInitalAllocNum;
 		}
-	m_MemAllocEls = memreq;
-#ifdef _WIN32
-	m_pElements = (tsHyperElement *) malloc(m_MemAllocEls);	// initial and perhaps the only allocation
-
-	if(m_pElements == NULL)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes - %s",(INT64)m_MemAllocEls,strerror(errno));
-		Reset();
-		return(eBSFerrMem);
-		}
-#else
-	// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pElements = (tsHyperElement *)mmap(NULL,m_MemAllocEls, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pElements == MAP_FAILED)
+	if((m_pElements = (tsHyperElement *)m_ElsArena.Grow(memreq)) == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_MemAllocEls,strerror(errno));
-		m_pElements = NULL;
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory allocation of %lld bytes failed",(INT64)memreq);
 		Reset();
 		return(eBSFerrMem);
 		}
-#endif
+	m_MemAllocEls = memreq;
 	
 	m_NumEls = 0;
 	m_NumElsPlus = 0;
@@ -579,16 +411,9 @@ if(m_pElements == NULL)
 if((m_NumEls + 1000)  >= m_NumElsAllocd)
 	{
 	memreq = m_MemAllocEls + (cElGrowAllocNum * sizeof(tsHyperElement));
-#ifdef _WIN32
-	pEl = (tsHyperElement *) realloc(m_pElements,memreq);
-	if(pEl == NULL)
+	if((pEl = (tsHyperElement *)m_ElsArena.Grow(memreq)) == NULL)
 		{
-#else
-	pEl = (tsHyperElement *)mremap(m_pElements,m_MemAllocEls,memreq,MREMAP_MAYMOVE);
-	if(pEl == MAP_FAILED)
-		{
-#endif
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory reallocation to %lld bytes failed - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddElCore: Memory reallocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 	m_pElements = pEl;
@@ -77,17 +77,20 @@ class CHyperEls  : public CErrorCodes
 	int m_MinLenEl;				// actual minimal length of any element
 	int m_MaxLenEl;				// actual maximum length of any element
 	size_t m_MemAllocEls;	    // mem allocd for m_pElements
+	CMemArena m_ElsArena;		// m_pElements is allocated from this arena
 	tsHyperElement *m_pElements;
 
 	int m_NumSeqs;				// total number of sequences in m_pSeqBases
 	size_t m_MemUsedSeqBases;	// mem currently used for m_pSeqBases
 	size_t m_MemAllocSeqBases;	// mem allocd for m_pSeqBases
+	CMemArena m_SeqBasesArena;	// m_pSeqBases is allocated from this arena
 	UINT8 *m_pSeqBases;		    // alloc'd to hold any element associated sequence bases which are packed 2 bases per byte
 
 	int m_MRAChromID;			// most recently accessed chromosome identifier
 	int m_NumChromsAllocd;
 	int m_NumChroms;
 	size_t m_MemAllocChroms;	// mem alloc'd for m_pChroms  
+	CMemArena m_ChromsArena;	// m_pChroms is allocated from this arena
 	tsHyperChrom *m_pChroms;
 	UINT64 *m_pChromHashes;		// used to hold indexes into m_pChroms
 
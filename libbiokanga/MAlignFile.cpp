@@ -34,16 +34,6 @@ CMAlignFile::~CMAlignFile(void)
 if(m_hFile != -1)
 	close(m_hFile);
 
-if(m_pDirEls)
-	{
-#ifdef _WIN32
-	free(m_pDirEls);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pDirEls != MAP_FAILED)
-		munmap(m_pDirEls,m_AllocdDirElsMem);
-#endif
-	}
-
 if(m_pAlignBlock)
 	delete m_pAlignBlock;
 if(m_pChromNames)
@@ -400,12 +390,7 @@ if(m_hFile != -1)
 m_szFile[0] = '\0';
 if(m_pDirEls)
 	{
-#ifdef _WIN32
-	free(m_pDirEls);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
-#else
-	if(m_pDirEls != MAP_FAILED)
-		munmap(m_pDirEls,m_AllocdDirElsMem);
-#endif
+	m_DirElsArena.Release();
 	m_AllocdDirElsMem = 0;
 	m_NumAllocdDirEls = 0;
 	m_pDirEls = NULL;
@@ -550,19 +535,9 @@ if(AccessMode == eMAPOCreate)
 	AllocLen = m_NumAllocdDirEls * sizeof(tsBlockDirEl);
 	m_AllocdDirElsMem = AllocLen;
 
-#ifdef _WIN32
-	m_pDirEls = (tsBlockDirEl *) malloc((size_t)m_AllocdDirElsMem);	// initial and will be realloc'd as may be required for additional blocks
-	if(m_pDirEls == NULL)
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes through malloc()  failed - %s",(INT64)m_AllocdDirElsMem,strerror(errno));
-#else
-// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pDirEls = (tsBlockDirEl *)mmap(NULL,(size_t)m_AllocdDirElsMem, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pDirEls == MAP_FAILED)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_AllocdDirElsMem,strerror(errno));
-		m_pDirEls = NULL;
-		}
-#endif
+	// initial and will be grown in place as may be required for additional blocks
+	if((m_pDirEls = (tsBlockDirEl *)m_DirElsArena.Grow((size_t)m_AllocdDirElsMem)) == NULL)
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Open: Memory allocation of %lld bytes for block directory failed",(INT64)m_AllocdDirElsMem);
 	if(m_pDirEls == NULL)
 		{
 		m_AllocdDirElsMem = 0;
@@ -610,17 +585,9 @@ else // else opening existing file
 	m_AllocdDirElsMem = AllocLen;
 	m_NumAllocdDirEls = m_FileHdr.NumAlignBlocks + 1;
 
-#ifdef _WIN32
-	m_pDirEls = (tsBlockDirEl *) malloc((size_t)m_AllocdDirElsMem);	// initial and expected to be the only allocation
-#else
-// gnu malloc is still in the 32bit world and can't handle more than 2GB allocations
-	m_pDirEls = (tsBlockDirEl *)mmap(NULL,(size_t)m_AllocdDirElsMem, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
-	if(m_pDirEls == MAP_FAILED)
-		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"LoadReads: Memory allocation of %lld bytes through mmap()  failed - %s",(INT64)m_AllocdDirElsMem,strerror(errno));
-		m_pDirEls = NULL;
-		}
-#endif
+	// initial and expected to be the only allocation
+	if((m_pDirEls = (tsBlockDirEl *)m_DirElsArena.Grow((size_t)m_AllocdDirElsMem)) == NULL)
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Open: Memory allocation of %lld bytes for block directory failed",(INT64)m_AllocdDirElsMem);
 	if(m_pDirEls == NULL)
 		{
 		m_AllocdDirElsMem = 0;
@@ -1018,16 +985,9 @@ if(m_CurRefChromID == (tChromID)eBSFerrChrom)
 if((BlockID + 10) > m_NumAllocdDirEls)		// need to realloc the block directory?
 	{
 	size_t memreq = ((m_NumAllocdDirEls + cAllocAlignBlockDirs) * sizeof(tsBlockDirEl));
-#ifdef _WIN32
-	pDirEl = (tsBlockDirEl *) realloc(m_pDirEls,memreq);
-	if(pDirEl == NULL)
+	if((pDirEl = (tsBlockDirEl *)m_DirElsArena.Grow(memreq)) == NULL)
 		{
-#else
-	pDirEl = (tsBlockDirEl *)mremap(m_pDirEls,m_AllocdDirElsMem,memreq,MREMAP_MAYMOVE);
-	if(pDirEl == MAP_FAILED)
-		{
-#endif
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"WriteBlock: Memory for block directory reallocation to %lld bytes failed - %s",memreq,strerror(errno));
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"WriteBlock: Memory for block directory reallocation to %lld bytes failed",(INT64)memreq);
 		return(eBSFerrMem);
 		}
 	m_pDirEls = pDirEl;
@@ -158,6 +158,7 @@ class CMAlignFile : protected CEndian,public CErrorCodes
 	tsAlignHdr m_FileHdr;			// alignment header
 	INT64 m_AllocdDirElsMem;		// size of memory allocation for m_pDirEls
 	int m_NumAllocdDirEls;			// actual many dir elements allocated 
+	CMemArena m_DirElsArena;		// m_pDirEls is allocated from this arena
 	tsBlockDirEl *m_pDirEls;		// pts to array of block directory elements
 
 	tsChromName *m_pChromNames;		// directory of all aligned species chromosomes
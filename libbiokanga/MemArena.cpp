@@ -0,0 +1,404 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#include "stdafx.h"
+#ifdef _WIN32
+#include "./commhdrs.h"
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include "./commhdrs.h"
+#endif
+
+#ifndef _WIN32
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1			// mbind() policies as defined in numaif.h, libnuma is not required
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#endif
+
+bool CMemArena::m_bDefaultsInitialised = false;
+UINT32 CMemArena::m_DfltFlags = 0;
+int CMemArena::m_DfltNUMANode = -1;
+
+CMemArena::CMemArena(void)
+{
+m_pBase = NULL;
+m_Reserved = 0;
+m_Committed = 0;
+m_ChunkSize = cMemArenaDfltChunk;
+m_Flags = cMemArenaDefaults;
+m_NUMANode = -1;
+}
+
+CMemArena::~CMemArena(void)
+{
+Release();
+}
+
+void
+CMemArena::Release(void)
+{
+if(m_pBase != NULL)
+	{
+#ifdef _WIN32
+	VirtualFree(m_pBase,0,MEM_RELEASE);
+#else
+	munmap(m_pBase,m_Reserved);
+#endif
+	m_pBase = NULL;
+	}
+m_Reserved = 0;
+m_Committed = 0;
+}
+
+void
+CMemArena::SetDefaults(UINT32 Flags,	// set process wide default flags
+					   int NUMANode)		// and NUMA node
+{
+m_DfltFlags = Flags & ~cMemArenaDefaults;
+m_DfltNUMANode = NUMANode;
+m_bDefaultsInitialised = true;
+}
+
+void
+CMemArena::InitDefaults(void)		// initialise process wide defaults from 'BIOKANGA_ARENA' if not already initialised
+{
+char *pszEnv;
+char *pszNode;
+
+if(m_bDefaultsInitialised)
+	return;
+m_DfltFlags = 0;
+m_DfltNUMANode = -1;
+if((pszEnv = getenv("BIOKANGA_ARENA"))!=NULL)
+	{
+	if(strstr(pszEnv,"hugepages")!=NULL)
+		m_DfltFlags |= cMemArenaHugePages;
+	if(strstr(pszEnv,"interleave")!=NULL)
+		m_DfltFlags |= cMemArenaInterleave;
+	if((pszNode = strstr(pszEnv,"node="))!=NULL)
+		m_DfltNUMANode = atoi(pszNode + 5);
+	}
+m_bDefaultsInitialised = true;
+}
+
+void
+CMemArena::SetPlacement(UINT32 Flags,	// placement flags to be used when arena is next initialised, either explicitly or on first Grow()
+						int NUMANode)		// if >= 0 then pages preferentially placed on this NUMA node
+{
+if(Flags & cMemArenaDefaults)		// flags are in addition to the process wide defaults
+	{
+	InitDefaults();
+	Flags = (Flags & ~cMemArenaDefaults) | m_DfltFlags;
+	if(NUMANode < 0)
+		NUMANode = m_DfltNUMANode;
+	}
+m_Flags = Flags;
+m_NUMANode = NUMANode;
+}
+
+int								// returns number of online NUMA nodes
+CMemArena::NumNUMANodes(UINT64 *pNodeMask)	// optionally with a mask of the online nodes (nodes 0..63)
+{
+UINT64 NodeMask = 0;
+int NumNodes = 0;
+#ifdef _WIN32
+ULONG HighestNode;
+if(!GetNumaHighestNodeNumber(&HighestNode))
+	HighestNode = 0;
+for(ULONG Node = 0; Node <= HighestNode && Node < 64; Node++)
+	NodeMask |= (UINT64)1 << Node;
+#else
+FILE *pOnline;
+char szOnline[200];
+char *pChr;
+int First;
+int Last;
+if((pOnline = fopen("/sys/devices/system/node/online","r"))!=NULL)
+	{
+	if(fgets(szOnline,sizeof(szOnline),pOnline)!=NULL)
+		{
+		// list of node ranges, e.g. '0-3' or '0,2-3'
+		pChr = szOnline;
+		while(*pChr >= '0' && *pChr <= '9')
+			{
+			First = Last = (int)strtol(pChr,&pChr,10);
+			if(*pChr == '-')
+				Last = (int)strtol(pChr+1,&pChr,10);
+			for(; First <= Last && First < 64; First++)
+				NodeMask |= (UINT64)1 << First;
+			if(*pChr == ',')
+				pChr += 1;
+			}
+		}
+	fclose(pOnline);
+	}
+if(NodeMask == 0)
+	NodeMask = 1;
+#endif
+for(int Node = 0; Node < 64; Node++)
+	if(NodeMask & ((UINT64)1 << Node))
+		NumNodes += 1;
+if(pNodeMask != NULL)
+	*pNodeMask = NodeMask;
+return(NumNodes);
+}
+
+void
+CMemArena::Place(void *pAddr,		// apply hugepage and NUMA placement to page aligned memory starting at pAddr
+				size_t Len,				// of this length
+				UINT32 Flags,			// placement flags
+				int NUMANode)			// if >= 0 then pages preferentially placed on this NUMA node
+{
+#ifndef _WIN32
+UINT64 NodeMask;
+if(pAddr == NULL || Len == 0)
+	return;
+#ifdef MADV_HUGEPAGE
+if(Flags & cMemArenaHugePages)
+	madvise(pAddr,Len,MADV_HUGEPAGE);
+#endif
+#ifdef SYS_mbind
+// placement policies are advisory, failures (e.g. kernels without NUMA support) are silently ignored
+if(NUMANode >= 0 && NUMANode < 64)
+	{
+	NodeMask = (UINT64)1 << NUMANode;
+	syscall(SYS_mbind,pAddr,Len,MPOL_PREFERRED,&NodeMask,(unsigned long)65,0);
+	}
+else
+	if((Flags & cMemArenaInterleave) && NumNUMANodes(&NodeMask) > 1)
+		syscall(SYS_mbind,pAddr,Len,MPOL_INTERLEAVE,&NodeMask,(unsigned long)65,0);
+#endif
+#endif
+}
+
+void
+CMemArena::ApplyPlacement(void)	// apply hugepage and NUMA placement to the reserved address space
+{
+Place(m_pBase,m_Reserved,m_Flags,m_NUMANode);
+}
+
+int
+CMemArena::Reserve(size_t MaxSize,	// reserve address space for up to this many bytes
+				size_t MinSize)		// but accepting a reservation of at least this many bytes if address space is limited
+{
+void *pBase;
+MinSize = ((max(MinSize,(size_t)1) + m_ChunkSize - 1) / m_ChunkSize) * m_ChunkSize;
+MaxSize = ((MaxSize + m_ChunkSize - 1) / m_ChunkSize) * m_ChunkSize;
+#ifndef _WIN32
+// reserved address space, although not charged against commit limits, is charged against any process address space limit
+struct rlimit ASLimit;
+if(getrlimit(RLIMIT_AS,&ASLimit)==0 && ASLimit.rlim_cur != RLIM_INFINITY && (UINT64)MaxSize > (UINT64)(ASLimit.rlim_cur / cMemArenaASLimitFract))
+	MaxSize = (size_t)(((ASLimit.rlim_cur / cMemArenaASLimitFract) / m_ChunkSize) * m_ChunkSize);
+#endif
+if(MaxSize < MinSize)
+	MaxSize = MinSize;
+for(;;)
+	{
+#ifdef _WIN32
+	if((pBase = VirtualAlloc(NULL,MaxSize,MEM_RESERVE,PAGE_READWRITE))!=NULL)
+		break;
+#else
+	// inaccessible private mappings are not charged against commit limits, pages are only charged as they are committed by mprotect()
+	if((pBase = mmap(NULL,MaxSize,PROT_NONE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0))!=MAP_FAILED)
+		break;
+#endif
+	if(MaxSize == MinSize)
+		{
+#ifdef _WIN32
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CMemArena::Reserve: unable to reserve %lld bytes of address space - error %d",(INT64)MaxSize,GetLastError());
+#else
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CMemArena::Reserve: unable to reserve %lld bytes of address space - %s",(INT64)MaxSize,strerror(errno));
+#endif
+		return(eBSFerrMem);
+		}
+	MaxSize = max(MinSize,((MaxSize / 2) / m_ChunkSize) * m_ChunkSize);
+	}
+m_pBase = (UINT8 *)pBase;
+m_Reserved = MaxSize;
+m_Committed = 0;
+ApplyPlacement();
+return(eBSFSuccess);
+}
+
+int
+CMemArena::Commit(size_t Ofs,size_t Len)	// commit memory within the reserved address space
+{
+#ifdef _WIN32
+void *pCommit;
+if(m_NUMANode >= 0)
+	pCommit = VirtualAllocExNuma(GetCurrentProcess(),m_pBase + Ofs,Len,MEM_COMMIT,PAGE_READWRITE,(DWORD)m_NUMANode);
+else
+	pCommit = VirtualAlloc(m_pBase + Ofs,Len,MEM_COMMIT,PAGE_READWRITE);
+if(pCommit == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CMemArena::Commit: unable to commit %lld bytes - error %d",(INT64)Len,GetLastError());
+	return(eBSFerrMem);
+	}
+#else
+if(mprotect(m_pBase + Ofs,Len,PROT_READ | PROT_WRITE)!=0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CMemArena::Commit: unable to commit %lld bytes - %s",(INT64)Len,strerror(errno));
+	return(eBSFerrMem);
+	}
+#endif
+return(eBSFSuccess);
+}
+
+int
+CMemArena::Init(size_t InitSize,		// initially commit at least this many bytes
+				UINT64 MaxSize,			// reserve address space for at least this many bytes, 0 to use the default reservation
+				size_t ChunkSize,		// grow arena in multiples of this many bytes
+				UINT32 Flags,			// placement flags
+				int NUMANode)			// if >= 0 then pages preferentially placed on this NUMA node
+{
+int Rslt;
+
+Release();
+if(Flags & cMemArenaDefaults)
+	{
+	InitDefaults();
+	Flags = (Flags & ~cMemArenaDefaults) | m_DfltFlags;
+	if(NUMANode < 0)
+		NUMANode = m_DfltNUMANode;
+	}
+m_Flags = Flags;
+m_NUMANode = NUMANode;
+m_ChunkSize = ChunkSize < cMemArenaMinChunk ? cMemArenaMinChunk : ((ChunkSize + cMemArenaMinChunk - 1) / cMemArenaMinChunk) * cMemArenaMinChunk;
+
+if(MaxSize == 0)
+	MaxSize = sizeof(void *) == 4 ? cMemArenaDfltReserve32 : cMemArenaDfltReserve;
+if(MaxSize < (UINT64)InitSize)
+	MaxSize = (UINT64)InitSize * 2;
+if(sizeof(void *) == 4 && MaxSize > cMemArenaDfltReserve32)
+	MaxSize = max((UINT64)InitSize,cMemArenaDfltReserve32);
+
+if((Rslt = Reserve((size_t)MaxSize,InitSize))!=eBSFSuccess)
+	return(Rslt);
+if(InitSize > 0 && Grow(InitSize) == NULL)
+	{
+	Release();
+	return(eBSFerrMem);
+	}
+return(eBSFSuccess);
+}
+
+int
+CMemArena::Relocate(size_t NewSize)	// arena has outgrown its reservation, relocate into a larger reservation
+{
+int Rslt;
+UINT8 *pPrevBase = m_pBase;
+size_t PrevReserved = m_Reserved;
+size_t PrevCommitted = m_Committed;
+size_t MaxSize = max(NewSize,PrevReserved) * 2;
+
+if((Rslt = Reserve(MaxSize,NewSize))!=eBSFSuccess ||
+	(Rslt = Commit(0,NewSize))!=eBSFSuccess)
+	{
+	if(m_pBase != pPrevBase && m_pBase != NULL)
+#ifdef _WIN32
+		VirtualFree(m_pBase,0,MEM_RELEASE);
+#else
+		munmap(m_pBase,m_Reserved);
+#endif
+	m_pBase = pPrevBase;
+	m_Reserved = PrevReserved;
+	m_Committed = PrevCommitted;
+	return(Rslt);
+	}
+memcpy(m_pBase,pPrevBase,PrevCommitted);
+m_Committed = NewSize;
+#ifdef _WIN32
+VirtualFree(pPrevBase,0,MEM_RELEASE);
+#else
+munmap(pPrevBase,PrevReserved);
+#endif
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"CMemArena::Relocate: arena outgrew its reservation, relocated %lld bytes",(INT64)PrevCommitted);
+return(eBSFSuccess);
+}
+
+void *											// returns arena base or NULL if unable to commit
+CMemArena::Grow(size_t ReqSize)					// ensure at least ReqSize bytes are committed
+{
+size_t NewSize;
+if(m_pBase == NULL)
+	{
+	if(Init(ReqSize,0,m_ChunkSize,m_Flags,m_NUMANode)!=eBSFSuccess)
+		return(NULL);
+	return(m_pBase);
+	}
+if(ReqSize <= m_Committed)
+	return(m_pBase);
+
+NewSize = ((ReqSize + m_ChunkSize - 1) / m_ChunkSize) * m_ChunkSize;
+if(NewSize > m_Reserved)
+	{
+	if(ReqSize <= m_Reserved)
+		NewSize = m_Reserved;
+	else
+		{
+		if(Relocate(NewSize)!=eBSFSuccess)
+			return(NULL);
+		return(m_pBase);
+		}
+	}
+if(Commit(m_Committed,NewSize - m_Committed)!=eBSFSuccess)
+	return(NULL);
+m_Committed = NewSize;
+return(m_pBase);
+}
+
+void *											// returns arena base
+CMemArena::Shrink(size_t ReqSize)				// decommit memory beyond ReqSize bytes
+{
+size_t NewSize;
+if(m_pBase == NULL || ReqSize >= m_Committed)
+	return(m_pBase);
+NewSize = ((ReqSize + m_ChunkSize - 1) / m_ChunkSize) * m_ChunkSize;
+if(NewSize >= m_Committed)
+	return(m_pBase);
+#ifdef _WIN32
+VirtualFree(m_pBase + NewSize,m_Committed - NewSize,MEM_DECOMMIT);
+#else
+// replacing the surplus with a fresh inaccessible mapping returns the pages to the system and uncharges them, placement is reapplied to the replacement
+if(mmap(m_pBase + NewSize,m_Committed - NewSize,PROT_NONE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,-1,0) == MAP_FAILED)
+	return(m_pBase);
+#endif
+m_Committed = NewSize;
+#ifndef _WIN32
+ApplyPlacement();
+#endif
+return(m_pBase);
+}
+
+void
+CMemArena::Zero(void)						// zero all committed memory
+{
+if(m_pBase != NULL && m_Committed)
+	memset(m_pBase,0,m_Committed);
+}
+
+void
+CMemArena::Transfer(CMemArena *pSrc)		// release this arena and take ownership of the memory in pSrc, pSrc is left empty
+{
+if(pSrc == this)
+	return;
+Release();
+m_pBase = pSrc->m_pBase;
+m_Reserved = pSrc->m_Reserved;
+m_Committed = pSrc->m_Committed;
+m_ChunkSize = pSrc->m_ChunkSize;
+m_Flags = pSrc->m_Flags;
+m_NUMANode = pSrc->m_NUMANode;
+pSrc->m_pBase = NULL;
+pSrc->m_Reserved = 0;
+pSrc->m_Committed = 0;
+}
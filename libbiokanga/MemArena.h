@@ -0,0 +1,77 @@
+#pragma once
+// Growable memory arenas replacing the malloc/realloc and mmap/mremap growth patterns used by many of the larger in-memory structures
+// Virtual address space for the maximum arena size is reserved up front and physical memory is committed in chunks as the arena is grown,
+// so growing an arena within its reservation never copies or moves previously committed memory and pointers into the arena remain valid.
+// Only if an arena outgrows its reservation, more likely if process address space is limited, is it relocated into a larger reservation.
+// Committed memory is zero initialised. Arenas can optionally be backed by transparent hugepages, and can have their pages interleaved
+// over all NUMA nodes or preferentially placed on a specific node.
+// Default flags and placement for all arenas can be set through the environment variable 'BIOKANGA_ARENA', a comma separated list of
+// 'hugepages', 'interleave' or 'node=<n>'
+
+const size_t cMemArenaMinChunk = 0x010000;				// arenas are committed in chunks of at least 64KB
+const size_t cMemArenaDfltChunk = 0x01000000;			// by default arenas are committed in chunks of 16MB
+const UINT64 cMemArenaDfltReserve = 0x04000000000;		// by default 64bit processes reserve 256GB of address space for each arena
+const UINT64 cMemArenaDfltReserve32 = 0x020000000;		// 32bit processes reserve 512MB
+// reservations are limited to an eighth of any process address space limit (e.g. 'ulimit -v', or batch scheduler h_vmem) and, if still
+// unable to be reserved, are progressively halved down to the size actually required, with arenas relocated should they outgrow these smaller reservations
+const int cMemArenaASLimitFract = 8;
+
+const UINT32 cMemArenaHugePages = 0x01;		// back arena with transparent hugepages (Linux madvise(MADV_HUGEPAGE), ignored on Windows)
+const UINT32 cMemArenaInterleave = 0x02;	// interleave arena pages over all online NUMA nodes (Linux only, ignored on Windows)
+const UINT32 cMemArenaDefaults = 0x80000000;	// use the process wide default flags and NUMA placement, any other flags are in addition to the defaults
+
+class CMemArena
+{
+	UINT8 *m_pBase;							// arena starts at this address
+	size_t m_Reserved;						// address space reserved for the arena
+	size_t m_Committed;						// memory committed, always a multiple of m_ChunkSize
+	size_t m_ChunkSize;						// memory is committed in multiples of this size
+	UINT32 m_Flags;							// arena placement flags
+	int m_NUMANode;							// if >= 0 then arena pages preferentially placed on this node
+
+	static bool m_bDefaultsInitialised;		// true if process wide defaults have been initialised
+	static UINT32 m_DfltFlags;				// process wide default flags
+	static int m_DfltNUMANode;				// process wide default NUMA node, -1 if none
+
+	static void InitDefaults(void);			// initialise process wide defaults from 'BIOKANGA_ARENA' if not already initialised
+
+	int Reserve(size_t MaxSize,				// reserve address space for up to this many bytes
+				size_t MinSize);			// but accepting a reservation of at least this many bytes if address space is limited
+	int Commit(size_t Ofs,size_t Len);		// commit memory within the reserved address space
+	void ApplyPlacement(void);				// apply hugepage and NUMA placement to the reserved address space
+	int Relocate(size_t NewSize);			// arena has outgrown its reservation, relocate into a larger reservation
+
+public:
+	CMemArena(void);
+	~CMemArena(void);
+
+	void Release(void);						// release all memory, arena can be reinitialised
+
+	int Init(size_t InitSize = 0,				// initially commit at least this many bytes
+				UINT64 MaxSize = 0,				// reserve address space for at least this many bytes, 0 to use the default reservation
+				size_t ChunkSize = cMemArenaDfltChunk,	// grow arena in multiples of this many bytes
+				UINT32 Flags = cMemArenaDefaults,	// placement flags
+				int NUMANode = -1);				// if >= 0 then pages preferentially placed on this NUMA node
+
+	void *Grow(size_t ReqSize);				// ensure at least ReqSize bytes are committed, returns arena base or NULL if unable to commit
+											// the base changes only if ReqSize exceeds the initially reserved address space
+	void *Shrink(size_t ReqSize);			// decommit memory beyond ReqSize bytes, returns arena base; memory later regrown is zero initialised
+	void Zero(void);						// zero all committed memory
+
+	void Transfer(CMemArena *pSrc);			// release this arena and take ownership of the memory in pSrc, pSrc is left empty
+	void SetPlacement(UINT32 Flags,			// placement flags to be used when arena is next initialised, either explicitly or on first Grow()
+					int NUMANode = -1);		// if >= 0 then pages preferentially placed on this NUMA node
+
+	inline void *Base(void) { return(m_pBase); }			// arena base, NULL if not initialised
+	inline size_t Committed(void) { return(m_Committed); }	// currently committed bytes
+	inline size_t Reserved(void) { return(m_Reserved); }		// reserved address space
+
+	static void SetDefaults(UINT32 Flags,	// set process wide default flags
+							int NUMANode = -1);		// and NUMA node
+	static int NumNUMANodes(UINT64 *pNodeMask = NULL);	// returns number of online NUMA nodes, optionally with a mask of the online nodes (nodes 0..63)
+	static void Place(void *pAddr,			// apply hugepage and NUMA placement to page aligned memory starting at pAddr
+					size_t Len,					// of this length
+					UINT32 Flags,				// placement flags
+					int NUMANode = -1);			// if >= 0 then pages preferentially placed on this NUMA node
+};
+
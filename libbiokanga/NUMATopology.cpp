@@ -0,0 +1,228 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#include "stdafx.h"
+#ifdef _WIN32
+#include "./commhdrs.h"
+#else
+#include <sched.h>
+#include "./commhdrs.h"
+#endif
+
+bool CNUMATopology::m_bDiscovered = false;
+int CNUMATopology::m_NumNodes = 1;
+int CNUMATopology::m_NodeIDs[cMaxNUMANodes];
+int CNUMATopology::m_NumNodeCPUs[cMaxNUMANodes];
+UINT64 CNUMATopology::m_NodeCPUs[cMaxNUMANodes][cMaxNUMACPUs/64];
+bool CNUMATopology::m_bPinThreads = false;
+etNUMAIdxMode CNUMATopology::m_IdxMode = eNUMAIdxNone;
+
+int												// returns number of CPUs in list
+CNUMATopology::ParseCPUList(char *pszCPUList,	// parse Linux cpulist (e.g. '0-7,16-23')
+							UINT64 *pCPUs)		// into this CPU bitmap
+{
+char *pChr;
+int First;
+int Last;
+int NumCPUs = 0;
+memset(pCPUs,0,sizeof(UINT64) * (cMaxNUMACPUs/64));
+pChr = pszCPUList;
+while(*pChr >= '0' && *pChr <= '9')
+	{
+	First = Last = (int)strtol(pChr,&pChr,10);
+	if(*pChr == '-')
+		Last = (int)strtol(pChr+1,&pChr,10);
+	for(; First <= Last && First < cMaxNUMACPUs; First++)
+		{
+		pCPUs[First/64] |= (UINT64)1 << (First % 64);
+		NumCPUs += 1;
+		}
+	if(*pChr == ',')
+		pChr += 1;
+	}
+return(NumCPUs);
+}
+
+int										// returns number of nodes onto which threads can be placed
+CNUMATopology::Discover(void)			// discover topology and placement options
+{
+UINT64 NodeMask;
+int NodeID;
+int NumCPUs;
+char *pszEnv;
+
+if(m_bDiscovered)
+	return(m_NumNodes);
+
+m_NumNodes = 0;
+memset(m_NodeIDs,0,sizeof(m_NodeIDs));
+memset(m_NumNodeCPUs,0,sizeof(m_NumNodeCPUs));
+memset(m_NodeCPUs,0,sizeof(m_NodeCPUs));
+
+CMemArena::NumNUMANodes(&NodeMask);
+
+#ifdef _WIN32
+ULONGLONG ProcMask;
+for(NodeID = 0; NodeID < cMaxNUMANodes; NodeID++)
+	{
+	if(!(NodeMask & ((UINT64)1 << NodeID)))
+		continue;
+	if(!GetNumaNodeProcessorMask((UCHAR)NodeID,&ProcMask) || ProcMask == 0)
+		continue;
+	m_NodeCPUs[m_NumNodes][0] = (UINT64)ProcMask;
+	for(NumCPUs = 0; ProcMask != 0; ProcMask &= ProcMask - 1)
+		NumCPUs += 1;
+	m_NodeIDs[m_NumNodes] = NodeID;
+	m_NumNodeCPUs[m_NumNodes++] = NumCPUs;
+	}
+#else
+FILE *pCPUList;
+char szCPUList[4096];
+char szNodeFile[100];
+cpu_set_t AllowedCPUs;
+int CPUIdx;
+
+// only CPUs which this process is allowed to run on (e.g. under cgroups or taskset) are candidates for pinning
+CPU_ZERO(&AllowedCPUs);
+if(sched_getaffinity(0,sizeof(AllowedCPUs),&AllowedCPUs)!=0)
+	CPU_ZERO(&AllowedCPUs);
+
+for(NodeID = 0; NodeID < cMaxNUMANodes; NodeID++)
+	{
+	if(!(NodeMask & ((UINT64)1 << NodeID)))
+		continue;
+	sprintf(szNodeFile,"/sys/devices/system/node/node%d/cpulist",NodeID);
+	if((pCPUList = fopen(szNodeFile,"r"))==NULL)
+		continue;
+	szCPUList[0] = '\0';
+	if(fgets(szCPUList,sizeof(szCPUList),pCPUList)==NULL)
+		szCPUList[0] = '\0';
+	fclose(pCPUList);
+	ParseCPUList(szCPUList,m_NodeCPUs[m_NumNodes]);
+	NumCPUs = 0;
+	for(CPUIdx = 0; CPUIdx < cMaxNUMACPUs && CPUIdx < CPU_SETSIZE; CPUIdx++)
+		{
+		if(!(m_NodeCPUs[m_NumNodes][CPUIdx/64] & ((UINT64)1 << (CPUIdx % 64))))
+			continue;
+		if(CPU_ISSET(CPUIdx,&AllowedCPUs))
+			NumCPUs += 1;
+		else
+			m_NodeCPUs[m_NumNodes][CPUIdx/64] &= ~((UINT64)1 << (CPUIdx % 64));
+		}
+	if(NumCPUs == 0)				// memory only node, or no CPUs on node allowed for this process
+		continue;
+	m_NodeIDs[m_NumNodes] = NodeID;
+	m_NumNodeCPUs[m_NumNodes++] = NumCPUs;
+	}
+#endif
+
+if(m_NumNodes == 0)				// topology unavailable, treat as a single node with no placement
+	{
+	m_NumNodes = 1;
+	m_NodeIDs[0] = 0;
+	m_NumNodeCPUs[0] = 0;
+	}
+
+m_bPinThreads = false;
+m_IdxMode = eNUMAIdxNone;
+if(m_NumNodes > 1 && (pszEnv = getenv("BIOKANGA_NUMA"))!=NULL && strstr(pszEnv,"off")==NULL)
+	{
+	if(strstr(pszEnv,"pin")!=NULL)
+		m_bPinThreads = true;
+	if(strstr(pszEnv,"replicate")!=NULL)
+		{
+		m_IdxMode = eNUMAIdxReplicate;
+		m_bPinThreads = true;		// replicas are only node local if the threads using them are pinned onto that node
+		}
+	else
+		if(strstr(pszEnv,"interleave")!=NULL)
+			m_IdxMode = eNUMAIdxInterleave;
+	}
+m_bDiscovered = true;
+
+if(m_NumNodes > 1)
+	gDiagnostics.DiagOut(eDLInfo,gszProcName,"NUMA: %d nodes, worker threads %s, index %s",m_NumNodes,
+					m_bPinThreads ? "pinned round-robin onto nodes" : "not pinned",
+					m_IdxMode == eNUMAIdxReplicate ? "replicated onto each node" : m_IdxMode == eNUMAIdxInterleave ? "interleaved over nodes" : "placed on first touch");
+return(m_NumNodes);
+}
+
+void
+CNUMATopology::SetPinThreads(bool bPinThreads)	// override worker thread pinning requested through 'BIOKANGA_NUMA'
+{
+Discover();
+m_bPinThreads = (bPinThreads && m_NumNodes > 1) ? true : false;
+if(!m_bPinThreads && m_IdxMode == eNUMAIdxReplicate)
+	m_IdxMode = eNUMAIdxInterleave;
+}
+
+bool
+CNUMATopology::PinThreads(void)			// true if worker threads are being pinned onto nodes
+{
+return(m_bDiscovered && m_bPinThreads);
+}
+
+etNUMAIdxMode
+CNUMATopology::IdxMode(void)			// requested index placement
+{
+Discover();
+return(m_IdxMode);
+}
+
+int
+CNUMATopology::NumNodes(void)			// number of nodes onto which worker threads can be placed
+{
+return(Discover());
+}
+
+int
+CNUMATopology::NodeID(int NodeIdx)		// returns node identifier for NodeIdx (0..NumNodes()-1)
+{
+if(!m_bDiscovered || NodeIdx < 0 || NodeIdx >= m_NumNodes)
+	return(-1);
+return(m_NodeIDs[NodeIdx]);
+}
+
+int
+CNUMATopology::ThreadNode(int ThreadIdx)	// returns NodeIdx onto which worker ThreadIdx (0..n) will be pinned, -1 if threads are not pinned
+{
+if(!PinThreads() || ThreadIdx < 0)
+	return(-1);
+return(ThreadIdx % m_NumNodes);
+}
+
+int
+CNUMATopology::BindThread(int NodeIdx)	// pin calling thread onto the CPUs of node NodeIdx
+{
+if(!m_bDiscovered || NodeIdx < 0 || NodeIdx >= m_NumNodes || m_NumNodeCPUs[NodeIdx] == 0)
+	return(eBSFerrParams);
+#ifdef _WIN32
+if(SetThreadAffinityMask(GetCurrentThread(),(DWORD_PTR)m_NodeCPUs[NodeIdx][0])==0)
+	return(eBSFerrInternal);
+#else
+cpu_set_t NodeCPUs;
+int CPUIdx;
+CPU_ZERO(&NodeCPUs);
+for(CPUIdx = 0; CPUIdx < cMaxNUMACPUs && CPUIdx < CPU_SETSIZE; CPUIdx++)
+	if(m_NodeCPUs[NodeIdx][CPUIdx/64] & ((UINT64)1 << (CPUIdx % 64)))
+		CPU_SET(CPUIdx,&NodeCPUs);
+if(pthread_setaffinity_np(pthread_self(),sizeof(NodeCPUs),&NodeCPUs)!=0)
+	return(eBSFerrInternal);
+#endif
+return(eBSFSuccess);
+}
+
+int								// returns NodeIdx or -1 if not pinned
+CNUMATopology::PinWorker(int ThreadIdx)	// if pinning then pin calling worker thread ThreadIdx (0..n) onto its node
+{
+int NodeIdx;
+if((NodeIdx = ThreadNode(ThreadIdx)) < 0)
+	return(-1);
+if(BindThread(NodeIdx) != eBSFSuccess)
+	return(-1);
+return(NodeIdx);
+}
@@ -0,0 +1,45 @@
+#pragma once
+// NUMA topology discovery and NUMA aware placement of worker threads and of large shared read only structures
+// On multi-socket hosts worker threads can be pinned, round-robin, onto the CPUs of each online NUMA node so that all
+// sockets are loaded, and suffix indexes can either be interleaved over all nodes or replicated onto each node so
+// that index accesses from worker threads are node local.
+// Placement is requested through the environment variable 'BIOKANGA_NUMA', a comma separated list of
+// 'pin' (pin worker threads onto nodes), 'interleave' (interleave index pages over all nodes) or 'replicate'
+// (replicate index onto each node, implies 'pin'). Without 'BIOKANGA_NUMA', or if only a single node is online,
+// threads are left to the OS scheduler and no placement is applied.
+
+const int cMaxNUMANodes = 64;				// supporting at most this many NUMA nodes (nodes 0..63)
+const int cMaxNUMACPUs = 1024;				// supporting at most this many CPUs (CPUs 0..1023)
+
+typedef enum TAG_eNUMAIdxMode {
+	eNUMAIdxNone = 0,						// no index placement, index pages placed on the node which first touches them
+	eNUMAIdxInterleave,						// index pages interleaved over all online nodes
+	eNUMAIdxReplicate						// index replicated onto each node with worker threads using their node local replica
+	} etNUMAIdxMode;
+
+class CNUMATopology
+{
+	static bool m_bDiscovered;								// true if topology has been discovered
+	static int m_NumNodes;									// number of online nodes having at least one CPU available to this process
+	static int m_NodeIDs[cMaxNUMANodes];					// node identifiers
+	static int m_NumNodeCPUs[cMaxNUMANodes];				// number of CPUs available on each node
+	static UINT64 m_NodeCPUs[cMaxNUMANodes][cMaxNUMACPUs/64];	// bitmap of CPUs available on each node
+	static bool m_bPinThreads;								// true if worker threads are to be pinned onto nodes
+	static etNUMAIdxMode m_IdxMode;						// index placement
+
+	static int ParseCPUList(char *pszCPUList,		// parse Linux cpulist (e.g. '0-7,16-23')
+							UINT64 *pCPUs);			// into this CPU bitmap, returns number of CPUs in list
+
+public:
+	static int Discover(void);						// discover topology and placement options, returns number of nodes onto which threads can be placed
+													// must be called from the main thread before any worker threads are started
+	static void SetPinThreads(bool bPinThreads);	// override worker thread pinning requested through 'BIOKANGA_NUMA'
+	static bool PinThreads(void);					// true if worker threads are being pinned onto nodes
+	static etNUMAIdxMode IdxMode(void);				// requested index placement
+	static int NumNodes(void);						// number of nodes onto which worker threads can be placed
+	static int NodeID(int NodeIdx);					// returns node identifier for NodeIdx (0..NumNodes()-1)
+	static int ThreadNode(int ThreadIdx);			// returns NodeIdx onto which worker ThreadIdx (0..n) will be pinned, -1 if threads are not pinned
+	static int BindThread(int NodeIdx);				// pin calling thread onto the CPUs of node NodeIdx
+	static int PinWorker(int ThreadIdx);			// if pinning then pin calling worker thread ThreadIdx (0..n) onto its node, returns NodeIdx or -1 if not pinned
+};
+
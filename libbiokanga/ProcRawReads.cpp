@@ -31,6 +31,7 @@ m_pTetramerCnts = NULL;
 m_pDistQualScores = NULL;
 m_ppReadsIdx = NULL;
 m_pDataBuff = NULL;
+m_pBlockDir = NULL;
 m_bActivity = false;
 m_MTqsort.SetMaxThreads(cDfltSortThreads);
 Reset();
@@ -113,6 +114,13 @@ if(m_pDataBuff != NULL)
 #endif
 	m_pDataBuff = NULL;
 	}
+
+if(m_pBlockDir != NULL)
+	{
+	free(m_pBlockDir);
+	m_pBlockDir = NULL;
+	}
+m_AllocBlockDir = 0;
 m_NumDescrReads = 0;
 m_DataBuffAllocMem = 0;
 m_DataBuffAllocMem = 0;
@@ -120,6 +128,7 @@ m_DataBuffOfs = 0;
 m_bIsSOLiD = false;
 
 memset(&m_FileHdr,0,sizeof(m_FileHdr));
+memset(&m_V7Hdr,0,sizeof(m_V7Hdr));
 }
 
 void
@@ -138,10 +147,12 @@ int WrtLen;
 m_FileHdr.Magic[0] = 'b'; m_FileHdr.Magic[1] = 'i'; m_FileHdr.Magic[2] = 'o'; m_FileHdr.Magic[3] = 'r';
 m_FileHdr.Version = cBSFRRRdsVersion;
 WrtLen = sizeof(tsBSFRdsHdr);
-m_FileHdr.RdsOfs = WrtLen;
+// V7 header immediately follows the file header, the first block of reads starts at the next block aligned file offset
+m_FileHdr.RdsOfs = ((WrtLen + sizeof(tsRdsV7Hdr) + cRdsV7BlockAlign - 1) / cRdsV7BlockAlign) * cRdsV7BlockAlign;
 
 if(_lseeki64(m_hOutFile,0,SEEK_SET) ||
-		!CUtility::SafeWrite(m_hOutFile,&m_FileHdr,WrtLen))
+		!CUtility::SafeWrite(m_hOutFile,&m_FileHdr,WrtLen) ||
+		!CUtility::SafeWrite(m_hOutFile,&m_V7Hdr,sizeof(tsRdsV7Hdr)))
 	{
 	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to write file header to disk file '%s'  - error %s",pszRdsFile,strerror(errno));
 	Reset();
@@ -217,6 +228,7 @@ unsigned long CurElapsed;
 int SizeOfRawRead;
 int CurReadLen;
 int CurDescrLen;
+CRdsBlocks RdsBlocks;					// V7 block indexed reads are returned in the V6 format
 
 CStopWatch CurTime;
 CurTime.Start();
@@ -258,6 +270,11 @@ if((Rslt=Disk2Hdr(pszInfile))!=eBSFSuccess)
 	Reset();
 	return((teBSFrsltCodes)Rslt);
 	}
+if(m_FileHdr.Version >= 7 && (Rslt = RdsBlocks.Open(pszInfile)) != eBSFSuccess)
+	{
+	Reset();
+	return((teBSFrsltCodes)Rslt);
+	}
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Reads file '%s' generator version: %d", pszInfile,m_FileHdr.Version);
 if(m_FileHdr.Version < 4)
 	{
@@ -322,7 +339,7 @@ BuffOfs = 0;
 NumReadsProc = 0;
 MaxLengthRead = 0;
 Elapsed = CurTime.ReadUSecs();
-while((RdLen = read(m_hInFile,&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen)) > 0)
+while((RdLen = (m_FileHdr.Version >= 7 ? RdsBlocks.ReadV6(&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen) : read(m_hInFile,&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen))) > 0)
 	{
 	BuffLen += RdLen;
 	while((BuffLen - BuffOfs) >=  SizeOfRawRead)
@@ -421,6 +438,12 @@ while((RdLen = read(m_hInFile,&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen)) >
 	BuffLen -= BuffOfs;
 	BuffOfs = 0;
 	}
+if(RdLen < 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst reading reads from %s",pszInfile);
+	Reset();
+	return(eBSFerrFileAccess);
+	}
 if(WrtOfs)
 	{
 	if(!CUtility::SafeWrite(m_hOutFile,m_pWrtBuff,WrtOfs))
@@ -463,6 +486,7 @@ int SeqNsIdx;
 int SizeOfRawRead;
 int CurReadLen;
 int CurDescrLen;
+CRdsBlocks RdsBlocks;					// V7 block indexed reads are returned in the V6 format
 
 unsigned long Elapsed;
 unsigned long CurElapsed;
@@ -535,6 +559,11 @@ if((Rslt=Disk2Hdr(pszInfile))!=eBSFSuccess)
 	Reset();
 	return((teBSFrsltCodes)Rslt);
 	}
+if(m_FileHdr.Version >= 7 && (Rslt = RdsBlocks.Open(pszInfile)) != eBSFSuccess)
+	{
+	Reset();
+	return((teBSFrsltCodes)Rslt);
+	}
 
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"Reads file '%s' generator version: %d", pszInfile,m_FileHdr.Version);
 if(m_FileHdr.FlagsCS == 1)
@@ -579,7 +608,7 @@ BuffOfs = 0;
 NumReadsProc = 0;
 MaxLengthRead = 0;
 Elapsed = CurTime.ReadUSecs();
-while((RdLen = read(m_hInFile,&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen)) > 0)
+while((RdLen = (m_FileHdr.Version >= 7 ? RdsBlocks.ReadV6(&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen) : read(m_hInFile,&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen))) > 0)
 	{
 	BuffLen += RdLen;
 	while((BuffLen - BuffOfs) >=  sizeof(tsRawReadV5))
@@ -666,6 +695,12 @@ while((RdLen = read(m_hInFile,&m_pRdsBuff[BuffLen],cRRRdsBuffAlloc - BuffLen)) >
 	BuffLen -= BuffOfs;
 	BuffOfs = 0;
 	}
+if(RdLen < 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst reading reads from %s",pszInfile);
+	Reset();
+	return(eBSFerrFileAccess);
+	}
 
 close(m_hInFile);
 m_hInFile = -1;
@@ -1045,8 +1080,11 @@ CProcRawReads::WriteToFile(etPRRMode PMode,
 int Rslt;
 int Idx;
 int WrtOfs;
+int NumPacked;
+INT64 FileOfs;
 UINT64 TotReadsLen;
-tsRawReadV6 *pReadV6;
+tsRdsV7BlockDir BlockDir;
+tsRdsV7BlockDir *pBlockDir;
 
 unsigned long Elapsed;
 unsigned long CurElapsed;
@@ -1107,44 +1145,69 @@ if(_lseeki64(m_hOutFile,m_FileHdr.RdsOfs,SEEK_SET)!=m_FileHdr.RdsOfs)
 	Reset();
 	return(eBSFerrFileAccess);
 	}
-WrtOfs = 0;
+memset(&m_V7Hdr,0,sizeof(m_V7Hdr));
+m_V7Hdr.BlockSize = cRdsV7BlockSize;
+m_V7Hdr.BlockAlign = cRdsV7BlockAlign;
+FileOfs = m_FileHdr.RdsOfs;
 TotReadsLen = 0;
 Elapsed = CurTime.ReadUSecs();
-for(Idx = 0; Idx < (int)m_NumDescrReads; Idx++)
+for(Idx = 0; Idx < (int)m_NumDescrReads; Idx += NumPacked)
 	{
-	pReadV6 = m_ppReadsIdx[Idx];
-	if(pReadV6->ReadID == 0)
+	// pack as many reads as will fit into the next block, paired reads are not split between blocks
+	if((NumPacked = CRdsBlocks::PackBlock(m_FileHdr.NumRds + 1,(int)m_NumDescrReads - Idx,&m_ppReadsIdx[Idx],PMode == ePMRRNewPaired,cRdsV7BlockSize,m_pWrtBuff,&BlockDir)) < 0)
+		{
+		Reset();
+		return((teBSFrsltCodes)NumPacked);
+		}
+	if(BlockDir.NumReads == 0)
 		continue;
-	if((WrtOfs + 2 * (cMaxFastQSeqLen + cMaxDescrIDLen + sizeof(tsRawReadV6))) >= cRRWrtBuffSize)		// allow a small safety margin
+
+	// blocks are zero padded so the next block starts at a block aligned file offset
+	WrtOfs = ((BlockDir.BlockLen + cRdsV7BlockAlign - 1) / cRdsV7BlockAlign) * cRdsV7BlockAlign;
+	memset(&m_pWrtBuff[BlockDir.BlockLen],0,WrtOfs - BlockDir.BlockLen);
+	if(!CUtility::SafeWrite(m_hOutFile,m_pWrtBuff,WrtOfs))
 		{
-		if(!CUtility::SafeWrite(m_hOutFile,m_pWrtBuff,WrtOfs))
-			{
-			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst writing %d bytes - '%s' - %s",WrtOfs, pszOutFile, strerror(errno));
-			Reset();
-			return(eBSFerrFileAccess);
-			}
-		WrtOfs = 0;
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst writing %d bytes - '%s' - %s",WrtOfs, pszOutFile, strerror(errno));
+		Reset();
+		return(eBSFerrFileAccess);
 		}
-	m_FileHdr.NumRds += 1;
-	pReadV6->ReadID =m_FileHdr.NumRds;
-	memmove(&m_pWrtBuff[WrtOfs],pReadV6,sizeof(tsRawReadV6) + pReadV6->DescrLen + pReadV6->ReadLen);
-	WrtOfs += sizeof(tsRawReadV6) + pReadV6->DescrLen + pReadV6->ReadLen;
-	TotReadsLen += pReadV6->DescrLen + pReadV6->ReadLen + 1;
+	BlockDir.FileOfs = FileOfs;
+	FileOfs += WrtOfs;
 
-	if(!(m_FileHdr.NumRds % 1000))		// reduces the overhead of checking on elapsed time if it is done every 1000 reads...
+	if(m_pBlockDir == NULL || m_V7Hdr.NumBlocks == m_AllocBlockDir)
 		{
-		CurElapsed = CurTime.ReadUSecs();
-		if((CurElapsed - Elapsed) > 60)
+		if((pBlockDir = (tsRdsV7BlockDir *)realloc(m_pBlockDir,sizeof(tsRdsV7BlockDir) * (m_AllocBlockDir + cRRBlockDirAlloc))) == NULL)
 			{
-			Elapsed = CurElapsed;
-			gDiagnostics.DiagOut(eDLInfo,gszProcName,"Written %d reads to file '%s'",m_FileHdr.NumRds,pszOutFile);
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"Memory allocation for %d block directory entries failed",m_AllocBlockDir + cRRBlockDirAlloc);
+			Reset();
+			return(eBSFerrMem);
 			}
+		m_pBlockDir = pBlockDir;
+		m_AllocBlockDir += cRRBlockDirAlloc;
+		}
+	m_pBlockDir[m_V7Hdr.NumBlocks++] = BlockDir;
+
+	if(m_FileHdr.NumRds == 0 || BlockDir.MinReadLen < m_V7Hdr.MinReadLen)
+		m_V7Hdr.MinReadLen = BlockDir.MinReadLen;
+	if(BlockDir.MaxReadLen > m_V7Hdr.MaxReadLen)
+		m_V7Hdr.MaxReadLen = BlockDir.MaxReadLen;
+	m_V7Hdr.TotBases += BlockDir.TotBases;
+	m_FileHdr.NumRds += BlockDir.NumReads;
+	TotReadsLen += BlockDir.TotDescrLen + BlockDir.TotBases + BlockDir.NumReads;
+
+	CurElapsed = CurTime.ReadUSecs();
+	if((CurElapsed - Elapsed) > 60)
+		{
+		Elapsed = CurElapsed;
+		gDiagnostics.DiagOut(eDLInfo,gszProcName,"Written %d reads to file '%s'",m_FileHdr.NumRds,pszOutFile);
 		}
 	}
 
-if(WrtOfs && !CUtility::SafeWrite(m_hOutFile,m_pWrtBuff,WrtOfs))
+// block directory follows the last block
+m_V7Hdr.BlockDirOfs = FileOfs;
+if(m_V7Hdr.NumBlocks && !CUtility::SafeWrite(m_hOutFile,m_pBlockDir,sizeof(tsRdsV7BlockDir) * m_V7Hdr.NumBlocks))
 	{
-	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst writing %d bytes - '%s' - %s",WrtOfs, pszOutFile, strerror(errno));
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Errors whilst writing block directory - '%s' - %s",pszOutFile, strerror(errno));
 	Reset();
 	return(eBSFerrFileAccess);
 	}
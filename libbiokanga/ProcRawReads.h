@@ -2,7 +2,7 @@
 
 const unsigned int cRRMinSeqLen = 10;			// sequences must be at least this length otherwise user is warned and sequence sloughed
 
-const int cBSFRRRdsVersion = 6;				// current file header version
+const int cBSFRRRdsVersion = 7;				// current file header version, V7 is block indexed
 const int cBSFRRRdsVersionBack= 5;			// backward compatible to this version
 
 const int cRRMaxInFiles = 100;				// allow for at most this many input files
@@ -12,6 +12,7 @@ const int cRRMaxDescrLen = 128;				// allow for descriptors of upto this length
 
 const int cRRDataBuffAlloc = 0x0fffffff;		// alloc to hold reads in this byte sized increments, initial allocation will be 2x
 const int cRRRdsBuffAlloc = 0x0fffff;			// alloc to hold preprocessed reads (for stats) in this byte sized allocation
+const int cRRBlockDirAlloc = 0x0400;			// alloc V7 block directory entries in this many increments
 
 // processing modes
 typedef enum TAG_ePRRMode {		
@@ -41,6 +42,9 @@ class CProcRawReads  : public CErrorCodes
 												// reason for this is that it reduces memory requirements when resizing this buffer
 
 	tsBSFRdsHdr m_FileHdr;						// processed reads file header
+	tsRdsV7Hdr m_V7Hdr;							// V7 header following processed reads file header
+	int m_AllocBlockDir;						// m_pBlockDir allocated to hold this many block directory entries
+	tsRdsV7BlockDir *m_pBlockDir;				// V7 block directory being written
 
 	UINT32 *m_pDimerCnts;						// counts of all dimers
 	UINT32 *m_pTrimerCnts;						// counts of all trimers
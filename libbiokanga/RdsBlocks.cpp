@@ -0,0 +1,586 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#include "stdafx.h"
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#if _WIN32
+#include "../libbiokanga/commhdrs.h"
+#else
+#include <sys/mman.h>
+#include "../libbiokanga/commhdrs.h"
+#endif
+
+CRdsBlocks::CRdsBlocks(void)
+{
+m_pMapped = NULL;
+#ifdef _WIN32
+m_hFile = INVALID_HANDLE_VALUE;
+m_hMapping = NULL;
+#else
+m_hFile = -1;
+#endif
+Reset();
+}
+
+CRdsBlocks::~CRdsBlocks(void)
+{
+Reset();
+}
+
+void
+CRdsBlocks::Reset(void)
+{
+#ifdef _WIN32
+if(m_pMapped != NULL)
+	UnmapViewOfFile(m_pMapped);
+if(m_hMapping != NULL)
+	CloseHandle(m_hMapping);
+if(m_hFile != INVALID_HANDLE_VALUE)
+	CloseHandle(m_hFile);
+m_hMapping = NULL;
+m_hFile = INVALID_HANDLE_VALUE;
+#else
+if(m_pMapped != NULL)
+	munmap(m_pMapped,(size_t)m_FileSize);
+if(m_hFile != -1)
+	close(m_hFile);
+m_hFile = -1;
+#endif
+m_pMapped = NULL;
+m_pBlockDir = NULL;
+m_FileSize = 0;
+m_CurBlockIdx = 0;
+m_CurRecIdx = 0;
+m_szRdsFile[0] = '\0';
+memset(&m_FileHdr,0,sizeof(m_FileHdr));
+memset(&m_V7Hdr,0,sizeof(m_V7Hdr));
+}
+
+int
+CRdsBlocks::Open(char *pszRdsFile)			// open and map V7 reads file
+{
+int BlockIdx;
+UINT32 NxtReadID;
+tsRdsV7BlockDir *pBlockDir;
+
+Reset();
+strncpy(m_szRdsFile,pszRdsFile,sizeof(m_szRdsFile)-1);
+m_szRdsFile[sizeof(m_szRdsFile)-1] = '\0';
+
+#ifdef _WIN32
+LARGE_INTEGER FileSize;
+m_hFile = CreateFileA(pszRdsFile,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+if(m_hFile == INVALID_HANDLE_VALUE)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open %s - error %d",pszRdsFile,GetLastError());
+	Reset();
+	return(eBSFerrOpnFile);
+	}
+if(!GetFileSizeEx(m_hFile,&FileSize))
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to determine size of %s - error %d",pszRdsFile,GetLastError());
+	Reset();
+	return(eBSFerrFileAccess);
+	}
+m_FileSize = FileSize.QuadPart;
+#else
+m_hFile = open64(pszRdsFile,O_READSEQ);
+if(m_hFile == -1)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to open %s - %s",pszRdsFile,strerror(errno));
+	Reset();
+	return(eBSFerrOpnFile);
+	}
+m_FileSize = _lseeki64(m_hFile,0,SEEK_END);
+#endif
+
+if(m_FileSize < (INT64)(sizeof(tsBSFRdsHdr) + sizeof(tsRdsV7Hdr)))
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"%s is too small to be a block indexed reads file",pszRdsFile);
+	Reset();
+	return(eBSFerrNotBioseq);
+	}
+
+#ifdef _WIN32
+if((m_hMapping = CreateFileMapping(m_hFile,NULL,PAGE_READONLY,0,0,NULL))==NULL ||
+	(m_pMapped = (UINT8 *)MapViewOfFile(m_hMapping,FILE_MAP_READ,0,0,0))==NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to map %lld bytes of %s - error %d",m_FileSize,pszRdsFile,GetLastError());
+	Reset();
+	return(eBSFerrMem);
+	}
+#else
+m_pMapped = (UINT8 *)mmap(NULL,(size_t)m_FileSize,PROT_READ,MAP_SHARED,m_hFile,0);
+if(m_pMapped == MAP_FAILED)
+	{
+	m_pMapped = NULL;
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Unable to map %lld bytes of %s - %s",m_FileSize,pszRdsFile,strerror(errno));
+	Reset();
+	return(eBSFerrMem);
+	}
+#endif
+
+memcpy(&m_FileHdr,m_pMapped,sizeof(tsBSFRdsHdr));
+if(tolower(m_FileHdr.Magic[0]) != 'b' ||
+	tolower(m_FileHdr.Magic[1]) != 'i' ||
+	tolower(m_FileHdr.Magic[2]) != 'o' ||
+	tolower(m_FileHdr.Magic[3]) != 'r')
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"%s opened but no magic signature - not a reads file",pszRdsFile);
+	Reset();
+	return(eBSFerrNotBioseq);
+	}
+if(m_FileHdr.Version < 7)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"%s is a version %d reads file, block indexed reads files are version 7 or later",pszRdsFile,m_FileHdr.Version);
+	Reset();
+	return(eBSFerrFileVer);
+	}
+memcpy(&m_V7Hdr,&m_pMapped[sizeof(tsBSFRdsHdr)],sizeof(tsRdsV7Hdr));
+
+// validate the block directory before any block is accessed
+if(m_V7Hdr.NumBlocks < 0 || m_V7Hdr.BlockSize <= 0 || m_V7Hdr.BlockDirOfs < m_FileHdr.RdsOfs ||
+	(m_V7Hdr.BlockDirOfs + ((INT64)m_V7Hdr.NumBlocks * (INT64)sizeof(tsRdsV7BlockDir))) > m_FileSize)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"%s block directory is inconsistent with file size, file may be truncated",pszRdsFile);
+	Reset();
+	return(eBSFerrFileAccess);
+	}
+m_pBlockDir = (tsRdsV7BlockDir *)&m_pMapped[m_V7Hdr.BlockDirOfs];
+NxtReadID = 1;
+for(BlockIdx = 0, pBlockDir = m_pBlockDir; BlockIdx < m_V7Hdr.NumBlocks; BlockIdx++, pBlockDir++)
+	{
+	if(pBlockDir->FileOfs < m_FileHdr.RdsOfs || pBlockDir->BlockLen < (int)sizeof(tsRdsV7Block) || pBlockDir->BlockLen > m_V7Hdr.BlockSize ||
+		(pBlockDir->FileOfs + pBlockDir->BlockLen) > m_V7Hdr.BlockDirOfs || pBlockDir->StartReadID != NxtReadID)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"%s block directory entry %d is inconsistent",pszRdsFile,BlockIdx+1);
+		Reset();
+		return(eBSFerrFileAccess);
+		}
+	NxtReadID += pBlockDir->NumReads;
+	}
+if(NxtReadID - 1 != (UINT32)m_FileHdr.NumRds)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"%s block directory contains %u reads, expected %d",pszRdsFile,NxtReadID - 1,m_FileHdr.NumRds);
+	Reset();
+	return(eBSFerrFileAccess);
+	}
+return(eBSFSuccess);
+}
+
+tsBSFRdsHdr *
+CRdsBlocks::GetFileHdr(void)
+{
+return(m_pMapped == NULL ? NULL : &m_FileHdr);
+}
+
+tsRdsV7Hdr *
+CRdsBlocks::GetV7Hdr(void)
+{
+return(m_pMapped == NULL ? NULL : &m_V7Hdr);
+}
+
+int
+CRdsBlocks::GetNumBlocks(void)
+{
+return(m_pMapped == NULL ? 0 : m_V7Hdr.NumBlocks);
+}
+
+tsRdsV7BlockDir *
+CRdsBlocks::GetBlockDir(int BlockIdx)
+{
+if(m_pMapped == NULL || BlockIdx < 0 || BlockIdx >= m_V7Hdr.NumBlocks)
+	return(NULL);
+return(&m_pBlockDir[BlockIdx]);
+}
+
+int
+CRdsBlocks::LocateBlock(UINT32 ReadID)		// returns index of block containing ReadID, < 0 if no block contains ReadID
+{
+int Lo;
+int Hi;
+int Mid;
+tsRdsV7BlockDir *pBlockDir;
+
+if(m_pMapped == NULL || ReadID == 0)
+	return(eBSFerrEntry);
+Lo = 0;
+Hi = m_V7Hdr.NumBlocks - 1;
+while(Lo <= Hi)
+	{
+	Mid = (Lo + Hi) / 2;
+	pBlockDir = &m_pBlockDir[Mid];
+	if(ReadID < pBlockDir->StartReadID)
+		Hi = Mid - 1;
+	else
+		if(ReadID >= pBlockDir->StartReadID + (UINT32)pBlockDir->NumReads)
+			Lo = Mid + 1;
+		else
+			return(Mid);
+	}
+return(eBSFerrEntry);
+}
+
+tsRdsV7Block *
+CRdsBlocks::GetBlock(int BlockIdx)	// returns ptr to mapped block, NULL if block inconsistent with directory
+{
+tsRdsV7Block *pBlock;
+tsRdsV7BlockDir *pBlockDir;
+INT64 NumBases;
+
+if((pBlockDir = GetBlockDir(BlockIdx)) == NULL)
+	return(NULL);
+pBlock = (tsRdsV7Block *)&m_pMapped[pBlockDir->FileOfs];
+NumBases = pBlockDir->TotBases;
+if(pBlock->StartReadID != pBlockDir->StartReadID || pBlock->NumReads != pBlockDir->NumReads || pBlock->BlockLen != pBlockDir->BlockLen ||
+	pBlock->DescrsOfs < (int)(sizeof(tsRdsV7Block) + ((size_t)pBlock->NumReads * sizeof(tsRdsV7Read))) ||
+	pBlock->SeqsOfs < pBlock->DescrsOfs + pBlockDir->TotDescrLen + pBlock->NumReads ||
+	(pBlock->QualsOfs != 0 && (pBlock->QualsOfs < pBlock->SeqsOfs + (NumBases + 3) / 4 || pBlock->QualsOfs + ((NumBases * 5) + 7) / 8 + 1 > pBlock->NRunsOfs)) ||
+	pBlock->NRunsOfs < pBlock->SeqsOfs + (NumBases + 3) / 4 ||
+	pBlock->NumNRuns < 0 || pBlock->NRunsOfs + ((INT64)pBlock->NumNRuns * (INT64)sizeof(tsRdsV7NRun)) > pBlock->BlockLen)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"Block %d in '%s' is inconsistent with block directory",BlockIdx+1,m_szRdsFile);
+	return(NULL);
+	}
+return(pBlock);
+}
+
+tsRdsV7Read *
+CRdsBlocks::GetRead(tsRdsV7Block *pBlock,	// returns ptr to read record
+				int RecIdx)					// read record index (0..NumReads-1)
+{
+if(RecIdx < 0 || RecIdx >= pBlock->NumReads)
+	return(NULL);
+return(&((tsRdsV7Read *)&pBlock[1])[RecIdx]);
+}
+
+char *
+CRdsBlocks::GetDescr(tsRdsV7Block *pBlock,	// returns ptr to '\0' terminated read descriptor
+				tsRdsV7Read *pRead)
+{
+return((char *)pBlock + pBlock->DescrsOfs + pRead->DescrOfs);
+}
+
+int
+CRdsBlocks::UnpackRead(tsRdsV7Block *pBlock,	// unpack read sequence and quality scores
+				tsRdsV7Read *pRead,
+				UINT8 *pPacked)			// into this buffer in the V6 packed format (base in bits 0..2, phred in 3..7), returns read length
+{
+int Idx;
+int RunIdx;
+int BaseOfs;
+int BitOfs;
+UINT8 *pSeqs;
+UINT8 *pQuals;
+UINT8 *pBase;
+tsRdsV7NRun *pNRun;
+
+pSeqs = (UINT8 *)pBlock + pBlock->SeqsOfs;
+pQuals = pBlock->QualsOfs == 0 ? NULL : (UINT8 *)pBlock + pBlock->QualsOfs;
+BaseOfs = pRead->SeqOfs;
+pBase = pPacked;
+for(Idx = 0; Idx < pRead->ReadLen; Idx++, BaseOfs++, pBase++)
+	{
+	*pBase = (pSeqs[BaseOfs >> 2] >> ((BaseOfs & 0x03) * 2)) & 0x03;
+	if(pQuals != NULL)
+		{
+		BitOfs = BaseOfs * 5;
+		*pBase |= (((pQuals[BitOfs >> 3] | (pQuals[(BitOfs >> 3) + 1] << 8)) >> (BitOfs & 0x07)) & 0x01f) << 3;
+		}
+	}
+
+// overlay the indeterminate bases
+pNRun = (tsRdsV7NRun *)((UINT8 *)pBlock + pBlock->NRunsOfs) + pRead->NRunIdx;
+for(RunIdx = 0; RunIdx < pRead->NumNRuns; RunIdx++, pNRun++)
+	{
+	pBase = &pPacked[pNRun->SeqOfs - pRead->SeqOfs];
+	for(Idx = 0; Idx < pNRun->Len; Idx++, pBase++)
+		*pBase = (*pBase & 0xf8) | eBaseN;
+	}
+return(pRead->ReadLen);
+}
+
+int
+CRdsBlocks::SeekRead(UINT32 ReadID)		// next ReadV6() to start returning reads from ReadID
+{
+int BlockIdx;
+if((BlockIdx = LocateBlock(ReadID)) < 0)
+	return(BlockIdx);
+m_CurBlockIdx = BlockIdx;
+m_CurRecIdx = (int)(ReadID - m_pBlockDir[BlockIdx].StartReadID);
+return(eBSFSuccess);
+}
+
+int
+CRdsBlocks::ReadV6(UINT8 *pBuff,		// sequentially decode complete reads as tsRawReadV6's into this buffer
+				int BuffLen)			// buffer can hold at most this many bytes, returns number of bytes decoded, 0 if no more reads, < 0 if errors
+{
+int Len;
+int RecLen;
+tsRdsV7Block *pBlock;
+tsRdsV7Read *pRead;
+tsRawReadV6 *pReadV6;
+
+if(m_pMapped == NULL)
+	return(eBSFerrClosed);
+Len = 0;
+while(m_CurBlockIdx < m_V7Hdr.NumBlocks)
+	{
+	if((pBlock = GetBlock(m_CurBlockIdx)) == NULL)
+		return(eBSFerrFileAccess);
+	while(m_CurRecIdx < pBlock->NumReads)
+		{
+		pRead = GetRead(pBlock,m_CurRecIdx);
+		RecLen = (int)sizeof(tsRawReadV6) + pRead->DescrLen + pRead->ReadLen;
+		if((Len + RecLen) > BuffLen)
+			return(Len);
+		pReadV6 = (tsRawReadV6 *)&pBuff[Len];
+		pReadV6->ReadID = pBlock->StartReadID + m_CurRecIdx;
+		pReadV6->PairReadID = pRead->PairReadID;
+		pReadV6->NumReads = pRead->NumReads;
+		pReadV6->FileID = pRead->FileID;
+		pReadV6->DescrLen = pRead->DescrLen;
+		pReadV6->ReadLen = pRead->ReadLen;
+		memcpy(pReadV6->Read,GetDescr(pBlock,pRead),pRead->DescrLen + 1);
+		UnpackRead(pBlock,pRead,&pReadV6->Read[pRead->DescrLen + 1]);
+		Len += RecLen;
+		m_CurRecIdx += 1;
+		}
+	m_CurBlockIdx += 1;
+	m_CurRecIdx = 0;
+	}
+return(Len);
+}
+
+// block layout is the fixed header, the read records, the descriptors, the 2bit packed sequences, any 5bit packed quality scores and then the indeterminate runs
+// each section starts on an 8 byte block offset, quality scores are followed by a pad byte so scores can be unpacked as 16bit values
+static int					// returns block length
+V7BlockLayout(int NumReads,		// block contains this many reads
+			int TotDescrLen,	// total descriptors length (excluding '\0' terminators)
+			int TotBases,		// total number of bases
+			int NumNRuns,		// total number of indeterminate runs
+			bool bQuals,		// true if quality scores are to be retained
+			tsRdsV7Block *pBlock)	// if not NULL then initialise this block header with section offsets
+{
+int DescrsOfs;
+int SeqsOfs;
+int QualsOfs;
+int NRunsOfs;
+
+DescrsOfs = (int)(sizeof(tsRdsV7Block) + (NumReads * sizeof(tsRdsV7Read)) + 7) & ~0x07;
+SeqsOfs = (DescrsOfs + TotDescrLen + NumReads + 7) & ~0x07;
+QualsOfs = (SeqsOfs + ((TotBases + 3) / 4) + 7) & ~0x07;
+NRunsOfs = bQuals ? (QualsOfs + ((TotBases * 5) + 7) / 8 + 1 + 7) & ~0x07 : QualsOfs;
+if(pBlock != NULL)
+	{
+	pBlock->NumReads = NumReads;
+	pBlock->DescrsOfs = DescrsOfs;
+	pBlock->SeqsOfs = SeqsOfs;
+	pBlock->QualsOfs = bQuals ? QualsOfs : 0;
+	pBlock->NRunsOfs = NRunsOfs;
+	pBlock->NumNRuns = NumNRuns;
+	pBlock->BlockLen = NRunsOfs + (NumNRuns * (int)sizeof(tsRdsV7NRun));
+	}
+return(NRunsOfs + (NumNRuns * (int)sizeof(tsRdsV7NRun)));
+}
+
+int									// returns number of ppReads processed, < 0 if errors
+CRdsBlocks::PackBlock(UINT32 StartReadID,	// first packed read will be assigned this identifier
+				int NumReads,				// number of reads in ppReads
+				tsRawReadV6 **ppReads,		// reads to pack, any with ReadID == 0 are skipped
+				bool bKeepPairs,			// if true then blocks contain an even number of reads so read pairs are not split between blocks
+				int MaxBlockLen,			// block can be at most this many bytes
+				UINT8 *pBlock,				// pack into this block buffer
+				tsRdsV7BlockDir *pBlockDir)	// returned block directory entry, FileOfs is not initialised
+{
+int Idx;
+int BaseIdx;
+int NumPacked;
+int NumBlockReads;
+int NumConsumed;
+int TotDescrLen;
+int TotBases;
+int NumNRuns;
+int CurNRuns;
+int BaseOfs;
+int BitOfs;
+UINT8 Phred;
+bool bInRun;
+bool bQuals;
+UINT8 *pSeqVal;
+UINT8 *pSeqs;
+UINT8 *pQuals;
+char *pDescrs;
+tsRawReadV6 *pReadV6;
+tsRdsV7Block *pHdr;
+tsRdsV7Read *pRead;
+tsRdsV7NRun *pNRun;
+
+// 1st pass determines how many reads will fit into the block, worst case is assumed with quality scores to be retained
+NumPacked = 0;
+NumBlockReads = 0;
+NumConsumed = 0;
+TotDescrLen = 0;
+TotBases = 0;
+NumNRuns = 0;
+for(Idx = 0; Idx < NumReads; Idx++)
+	{
+	pReadV6 = ppReads[Idx];
+	if(pReadV6->ReadID == 0)
+		continue;
+	pSeqVal = &pReadV6->Read[pReadV6->DescrLen+1];
+	CurNRuns = 0;
+	bInRun = false;
+	for(BaseIdx = 0; BaseIdx < pReadV6->ReadLen; BaseIdx++)
+		{
+		if((pSeqVal[BaseIdx] & 0x07) > eBaseT)
+			{
+			if(!bInRun)
+				CurNRuns += 1;
+			bInRun = true;
+			}
+		else
+			bInRun = false;
+		}
+	if(V7BlockLayout(NumPacked + 1,TotDescrLen + pReadV6->DescrLen,TotBases + pReadV6->ReadLen,NumNRuns + CurNRuns,true,NULL) > MaxBlockLen)
+		break;
+	NumPacked += 1;
+	TotDescrLen += pReadV6->DescrLen;
+	TotBases += pReadV6->ReadLen;
+	NumNRuns += CurNRuns;
+	if(!bKeepPairs || !(NumPacked & 0x01))
+		{
+		NumBlockReads = NumPacked;
+		NumConsumed = Idx + 1;
+		}
+	}
+if(Idx == NumReads)				// all remaining reads fitted so no need to retain pairings
+	{
+	NumBlockReads = NumPacked;
+	NumConsumed = NumReads;
+	}
+if(NumBlockReads == 0)
+	{
+	if(NumConsumed == NumReads)	// only reads with ReadID == 0 remained
+		{
+		memset(pBlockDir,0,sizeof(tsRdsV7BlockDir));
+		return(NumConsumed);
+		}
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"PackBlock: unable to fit read into a block of %d bytes",MaxBlockLen);
+	return(eBSFerrMem);
+	}
+
+// 2nd pass determines the block totals for the reads being packed
+TotDescrLen = 0;
+TotBases = 0;
+NumNRuns = 0;
+bQuals = false;
+for(Idx = 0, NumPacked = 0; NumPacked < NumBlockReads; Idx++)
+	{
+	pReadV6 = ppReads[Idx];
+	if(pReadV6->ReadID == 0)
+		continue;
+	NumPacked += 1;
+	TotDescrLen += pReadV6->DescrLen;
+	TotBases += pReadV6->ReadLen;
+	pSeqVal = &pReadV6->Read[pReadV6->DescrLen+1];
+	bInRun = false;
+	for(BaseIdx = 0; BaseIdx < pReadV6->ReadLen; BaseIdx++,pSeqVal++)
+		{
+		if(*pSeqVal & 0xf8)
+			bQuals = true;
+		if((*pSeqVal & 0x07) > eBaseT)
+			{
+			if(!bInRun)
+				NumNRuns += 1;
+			bInRun = true;
+			}
+		else
+			bInRun = false;
+		}
+	}
+
+// 3rd pass packs the reads
+pHdr = (tsRdsV7Block *)pBlock;
+memset(pBlock,0,V7BlockLayout(NumBlockReads,TotDescrLen,TotBases,NumNRuns,bQuals,NULL));
+V7BlockLayout(NumBlockReads,TotDescrLen,TotBases,NumNRuns,bQuals,pHdr);
+pHdr->StartReadID = StartReadID;
+
+memset(pBlockDir,0,sizeof(tsRdsV7BlockDir));
+pBlockDir->StartReadID = StartReadID;
+pBlockDir->NumReads = NumBlockReads;
+pBlockDir->BlockLen = pHdr->BlockLen;
+pBlockDir->TotDescrLen = TotDescrLen;
+pBlockDir->TotBases = TotBases;
+
+pRead = (tsRdsV7Read *)&pHdr[1];
+pDescrs = (char *)pBlock + pHdr->DescrsOfs;
+pSeqs = pBlock + pHdr->SeqsOfs;
+pQuals = bQuals ? pBlock + pHdr->QualsOfs : NULL;
+pNRun = (tsRdsV7NRun *)(pBlock + pHdr->NRunsOfs);
+TotDescrLen = 0;
+BaseOfs = 0;
+NumNRuns = 0;
+for(Idx = 0, NumPacked = 0; NumPacked < NumBlockReads; Idx++)
+	{
+	pReadV6 = ppReads[Idx];
+	if(pReadV6->ReadID == 0)
+		continue;
+	NumPacked += 1;
+	pRead->PairReadID = pReadV6->PairReadID;
+	pRead->NumReads = pReadV6->NumReads;
+	pRead->FileID = pReadV6->FileID;
+	pRead->DescrLen = pReadV6->DescrLen;
+	pRead->ReadLen = pReadV6->ReadLen;
+	pRead->DescrOfs = TotDescrLen;
+	pRead->SeqOfs = BaseOfs;
+	pRead->NRunIdx = NumNRuns;
+	memcpy(&pDescrs[TotDescrLen],pReadV6->Read,pReadV6->DescrLen);
+	TotDescrLen += pReadV6->DescrLen + 1;		// descriptors are '\0' terminated, block was zeroed
+
+	if(NumPacked == 1 || pReadV6->ReadLen < pBlockDir->MinReadLen)
+		pBlockDir->MinReadLen = pReadV6->ReadLen;
+	if(pReadV6->ReadLen > pBlockDir->MaxReadLen)
+		pBlockDir->MaxReadLen = pReadV6->ReadLen;
+
+	pSeqVal = &pReadV6->Read[pReadV6->DescrLen+1];
+	bInRun = false;
+	for(BaseIdx = 0; BaseIdx < pReadV6->ReadLen; BaseIdx++,pSeqVal++,BaseOfs++)
+		{
+		if(pQuals != NULL && (Phred = (*pSeqVal >> 3) & 0x01f) != 0)
+			{
+			BitOfs = BaseOfs * 5;
+			pQuals[BitOfs >> 3] |= Phred << (BitOfs & 0x07);
+			if((BitOfs & 0x07) > 3)
+				pQuals[(BitOfs >> 3) + 1] |= Phred >> (8 - (BitOfs & 0x07));
+			}
+		if((*pSeqVal & 0x07) > eBaseT)		// indeterminate bases are packed as eBaseA and recorded as a run
+			{
+			if(!bInRun)
+				{
+				pNRun[NumNRuns].SeqOfs = BaseOfs;
+				pNRun[NumNRuns++].Len = 0;
+				pRead->NumNRuns += 1;
+				}
+			pNRun[NumNRuns-1].Len += 1;
+			pBlockDir->NumNBases += 1;
+			bInRun = true;
+			}
+		else
+			{
+			pSeqs[BaseOfs >> 2] |= (*pSeqVal & 0x03) << ((BaseOfs & 0x03) * 2);
+			bInRun = false;
+			}
+		}
+	pRead += 1;
+	}
+return(NumConsumed);
+}
@@ -0,0 +1,60 @@
+#pragma once
+// Block indexed (V7) preprocessed reads files
+// Files are memory mapped so blocks of reads can be independently accessed, and processed, by multiple threads
+// Reads can also be sequentially returned in the V6 tsRawReadV6 format, starting from any read identifier, for backward compatible processing
+
+class CRdsBlocks
+{
+	char m_szRdsFile[_MAX_PATH];		// mapped reads file
+	INT64 m_FileSize;					// mapped file is this size
+	UINT8 *m_pMapped;					// file is mapped starting at this address
+#ifdef _WIN32
+	HANDLE m_hFile;						// mapped file handle
+	HANDLE m_hMapping;					// file mapping handle
+#else
+	int m_hFile;						// mapped file handle
+#endif
+	tsBSFRdsHdr m_FileHdr;				// reads file header
+	tsRdsV7Hdr m_V7Hdr;					// V7 header immediately following m_FileHdr
+	tsRdsV7BlockDir *m_pBlockDir;		// block directory, references mapped file
+
+	int m_CurBlockIdx;					// ReadV6() sequential reads are being returned from this block
+	int m_CurRecIdx;					// next read to return from m_CurBlockIdx
+
+public:
+	CRdsBlocks(void);
+	~CRdsBlocks(void);
+
+	void Reset(void);					// unmaps and closes any opened file
+
+	int Open(char *pszRdsFile);			// open and map V7 reads file
+
+	tsBSFRdsHdr *GetFileHdr(void);		// returns ptr to reads file header
+	tsRdsV7Hdr *GetV7Hdr(void);			// returns ptr to V7 header
+
+	int GetNumBlocks(void);				// returns number of blocks
+	tsRdsV7BlockDir *GetBlockDir(int BlockIdx);	// returns directory entry for block
+	int LocateBlock(UINT32 ReadID);		// returns index of block containing ReadID, < 0 if no block contains ReadID
+	tsRdsV7Block *GetBlock(int BlockIdx);	// returns ptr to mapped block, NULL if block inconsistent with directory
+
+	int SeekRead(UINT32 ReadID);		// next ReadV6() to start returning reads from ReadID
+	int ReadV6(UINT8 *pBuff,			// sequentially decode complete reads as tsRawReadV6's into this buffer
+				int BuffLen);			// buffer can hold at most this many bytes, returns number of bytes decoded, 0 if no more reads, < 0 if errors
+
+	static tsRdsV7Read *GetRead(tsRdsV7Block *pBlock,	// returns ptr to read record
+				int RecIdx);			// read record index (0..NumReads-1)
+	static char *GetDescr(tsRdsV7Block *pBlock,			// returns ptr to '\0' terminated read descriptor
+				tsRdsV7Read *pRead);
+	static int UnpackRead(tsRdsV7Block *pBlock,			// unpack read sequence and quality scores
+				tsRdsV7Read *pRead,
+				UINT8 *pPacked);		// into this buffer in the V6 packed format (base in bits 0..2, phred in 3..7), returns read length
+
+	static int									// returns number of ppReads processed, < 0 if errors
+		PackBlock(UINT32 StartReadID,			// first packed read will be assigned this identifier
+				int NumReads,					// number of reads in ppReads
+				tsRawReadV6 **ppReads,			// reads to pack, any with ReadID == 0 are skipped
+				bool bKeepPairs,				// if true then blocks contain an even number of reads so read pairs are not split between blocks
+				int MaxBlockLen,				// block can be at most this many bytes
+				UINT8 *pBlock,					// pack into this block buffer
+				tsRdsV7BlockDir *pBlockDir);	// returned block directory entry, FileOfs is not initialised
+};
@@ -0,0 +1,888 @@
+/*
+ * CSIRO Open Source Software License Agreement (GPLv3)
+ * Copyright (c) 2017, Commonwealth Scientific and Industrial Research Organisation (CSIRO) ABN 41 687 119 230.
+ * See LICENSE for the complete license information (https://github.com/csiro-crop-informatics/biokanga/LICENSE)
+ * Contact: Alex Whan <alex.whan@csiro.au>
+ */
+
+#include "stdafx.h"
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#if _WIN32
+#include <process.h>
+#include "../libbiokanga/commhdrs.h"
+#else
+#include <pthread.h>
+#include "../libbiokanga/commhdrs.h"
+#endif
+
+CReadsIngest::CReadsIngest(void)
+{
+m_gzPE1 = NULL;
+m_gzPE2 = NULL;
+m_pPE1Carry = NULL;
+m_pPE2Carry = NULL;
+m_pChunks = NULL;
+m_NumChunks = 0;
+m_NumThreads = 0;
+m_CASIngest = 0;
+Reset();
+}
+
+CReadsIngest::~CReadsIngest(void)
+{
+Reset();
+}
+
+void
+CReadsIngest::Reset(void)
+{
+int ChunkIdx;
+tsIngestChunk *pChunk;
+
+Close();
+
+if(m_pChunks != NULL)
+	{
+	pChunk = m_pChunks;
+	for(ChunkIdx = 0; ChunkIdx < m_NumChunks; ChunkIdx++,pChunk++)
+		{
+		if(pChunk->pPE1Chrs != NULL)
+			delete []pChunk->pPE1Chrs;
+		if(pChunk->pPE2Chrs != NULL)
+			delete []pChunk->pPE2Chrs;
+		if(pChunk->pPE1Recs != NULL)
+			free(pChunk->pPE1Recs);
+		if(pChunk->pPE2Recs != NULL)
+			free(pChunk->pPE2Recs);
+		}
+	delete []m_pChunks;
+	m_pChunks = NULL;
+	}
+m_NumChunks = 0;
+
+if(m_pPE1Carry != NULL)
+	{
+	delete []m_pPE1Carry;
+	m_pPE1Carry = NULL;
+	}
+if(m_pPE2Carry != NULL)
+	{
+	delete []m_pPE2Carry;
+	m_pPE2Carry = NULL;
+	}
+
+m_bPE = false;
+m_bOrdered = false;
+m_bByteRanges = false;
+m_szPE1File[0] = '\0';
+m_szPE2File[0] = '\0';
+m_PE1FileSize = 0;
+m_NumRanges = 0;
+m_bPE1EOF = false;
+m_bPE2EOF = false;
+m_PE1FileOfs = 0;
+m_PE2FileOfs = 0;
+m_PE1CarryLen = 0;
+m_PE2CarryLen = 0;
+m_NumThreads = 0;
+memset(m_ThreadPars,0,sizeof(m_ThreadPars));
+m_NumChunksAssigned = 0;
+m_NxtDeliverSeq = 1;
+m_NumChunksLoading = 0;
+m_bAllAssigned = false;
+m_bTerminate = false;
+m_Rslt = eBSFSuccess;
+m_pCurChunk = NULL;
+m_CurRecIdx = 0;
+}
+
+void
+CReadsIngest::AcquireSerialise(void)
+{
+int SpinCnt = 500;
+int BackoffMS = 5;
+
+#ifdef _WIN32
+while(InterlockedCompareExchange(&m_CASIngest,1,0)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 500)
+		BackoffMS += 2;
+	}
+#else
+while(__sync_val_compare_and_swap(&m_CASIngest,0,1)!=0)
+	{
+	if(SpinCnt -= 1)
+		continue;
+	CUtility::SleepMillisecs(BackoffMS);
+	SpinCnt = 100;
+	if(BackoffMS < 500)
+		BackoffMS += 2;
+	}
+#endif
+}
+
+void
+CReadsIngest::ReleaseSerialise(void)
+{
+#ifdef _WIN32
+InterlockedCompareExchange(&m_CASIngest,0,1);
+#else
+__sync_val_compare_and_swap(&m_CASIngest,1,0);
+#endif
+}
+
+#ifdef _WIN32
+unsigned __stdcall ThreadedIngest(void * pThreadPars)
+#else
+void * ThreadedIngest(void * pThreadPars)
+#endif
+{
+int Rslt;
+tsIngestThreadPars *pPars = (tsIngestThreadPars *)pThreadPars; // makes it easier not having to deal with casts!
+CReadsIngest *pThis = (CReadsIngest *)pPars->pThis;
+Rslt = pThis->IngestThread(pPars);
+pPars->Rslt = Rslt;
+#ifdef _WIN32
+_endthreadex(0);
+return(eBSFSuccess);
+#else
+pthread_exit(NULL);
+#endif
+}
+
+int
+CReadsIngest::Open(char *pszPE1File,		// SE or PE1 fastq reads file
+			char *pszPE2File,				// if paired end processing then PE2 fastq reads file
+			int NumThreads,					// use this many ingestion threads
+			bool bOrdered)					// true if chunks are to be dequeued in file order
+{
+int Idx;
+int NameLen;
+bool bIsGZ;
+tsIngestChunk *pChunk;
+tsIngestThreadPars *pPars;
+
+Reset();
+
+if(pszPE1File == NULL || pszPE1File[0] == '\0')
+	return(eBSFerrParams);
+
+if(NumThreads < 1)
+	NumThreads = 1;
+else
+	if(NumThreads > cIngestMaxThreads)
+		NumThreads = cIngestMaxThreads;
+
+strncpy(m_szPE1File,pszPE1File,sizeof(m_szPE1File)-1);
+m_szPE1File[sizeof(m_szPE1File)-1] = '\0';
+m_bPE = (pszPE2File == NULL || pszPE2File[0] == '\0') ? false : true;
+if(m_bPE)
+	{
+	strncpy(m_szPE2File,pszPE2File,sizeof(m_szPE2File)-1);
+	m_szPE2File[sizeof(m_szPE2File)-1] = '\0';
+	}
+m_bOrdered = bOrdered;
+
+// only uncompressed SE files can be partitioned into byte ranges, compressed files can't be randomly accessed and paired ends
+// must be loaded with the same number of records in both PE1 and PE2 chunks
+NameLen = (int)strlen(m_szPE1File);
+bIsGZ = (NameLen >= 4 && !stricmp(".gz",&m_szPE1File[NameLen-3])) ? true : false;
+m_PE1FileSize = 0;
+if(!m_bPE && !bIsGZ)
+	{
+#ifdef _WIN32
+	struct _stat64 st;
+	if(!_stat64(m_szPE1File,&st))
+#else
+	struct stat64 st;
+	if(!stat64(m_szPE1File,&st))
+#endif
+		m_PE1FileSize = (INT64)st.st_size;
+	}
+m_bByteRanges = m_PE1FileSize >= cIngestMinRangesFileSize ? true : false;
+
+if(m_bByteRanges)
+	{
+	m_NumRanges = (UINT32)((m_PE1FileSize + cIngestChunkSize - 1) / cIngestChunkSize);
+	}
+else
+	{
+	if((m_gzPE1 = gzopen(m_szPE1File,"rb"))==NULL)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest::Open: Unable to open '%s' - %s",m_szPE1File,strerror(errno));
+		Reset();
+		return(eBSFerrOpnFile);
+		}
+	gzbuffer(m_gzPE1,cgzAllocInBuffer);
+	if(m_bPE)
+		{
+		if((m_gzPE2 = gzopen(m_szPE2File,"rb"))==NULL)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest::Open: Unable to open '%s' - %s",m_szPE2File,strerror(errno));
+			Reset();
+			return(eBSFerrOpnFile);
+			}
+		gzbuffer(m_gzPE2,cgzAllocInBuffer);
+		}
+	if((m_pPE1Carry = new UINT8 [cIngestChunkSize]) == NULL || (m_bPE && (m_pPE2Carry = new UINT8 [cIngestChunkSize]) == NULL))
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest::Open: Unable to allocate memory for chunk buffering");
+		Reset();
+		return(eBSFerrMem);
+		}
+	}
+
+// each ingestion thread can be loading a chunk whilst another chunk is waiting to be dequeued
+m_NumChunks = NumThreads * 2;
+if((m_pChunks = new tsIngestChunk [m_NumChunks]) == NULL)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest::Open: Unable to allocate memory for chunk buffering");
+	Reset();
+	return(eBSFerrMem);
+	}
+memset(m_pChunks,0,sizeof(tsIngestChunk) * m_NumChunks);
+pChunk = m_pChunks;
+for(Idx = 0; Idx < m_NumChunks; Idx++,pChunk++)
+	{
+	pChunk->State = eICSFree;
+	pChunk->AllocRecs = cIngestInitAllocRecs;
+	if((pChunk->pPE1Chrs = new UINT8 [cIngestChunkAlloc]) == NULL ||
+		(pChunk->pPE1Recs = (tsFastqRecView *)malloc(sizeof(tsFastqRecView) * pChunk->AllocRecs)) == NULL ||
+		(m_bPE && ((pChunk->pPE2Chrs = new UINT8 [cIngestChunkAlloc]) == NULL ||
+				(pChunk->pPE2Recs = (tsFastqRecView *)malloc(sizeof(tsFastqRecView) * pChunk->AllocRecs)) == NULL)))
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest::Open: Unable to allocate memory for chunk buffering");
+		Reset();
+		return(eBSFerrMem);
+		}
+	}
+
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"CReadsIngest::Open: loading '%s'%s%s using %d threads%s",m_szPE1File,m_bPE ? " and " : "",m_bPE ? m_szPE2File : "",
+								NumThreads,m_bByteRanges ? " over independent byte ranges" : "");
+
+m_NumThreads = NumThreads;
+pPars = m_ThreadPars;
+for(Idx = 0; Idx < m_NumThreads; Idx++,pPars++)
+	{
+	pPars->ThreadIdx = Idx + 1;
+	pPars->pThis = this;
+	pPars->hFile = -1;
+	pPars->Rslt = eBSFSuccess;
+#ifdef _WIN32
+	pPars->threadHandle = (HANDLE)_beginthreadex(NULL,0x0fffff,ThreadedIngest,pPars,0,&pPars->threadID);
+#else
+	pPars->threadRslt = pthread_create(&pPars->threadID,NULL,ThreadedIngest,pPars);
+#endif
+	}
+return(eBSFSuccess);
+}
+
+int
+CReadsIngest::Close(void)
+{
+int Idx;
+tsIngestThreadPars *pPars;
+
+if(m_NumThreads > 0)
+	{
+	AcquireSerialise();
+	m_bTerminate = true;
+	ReleaseSerialise();
+	pPars = m_ThreadPars;
+	for(Idx = 0; Idx < m_NumThreads; Idx++,pPars++)
+		{
+#ifdef _WIN32
+		WaitForSingleObject(pPars->threadHandle,INFINITE);
+		CloseHandle(pPars->threadHandle);
+#else
+		pthread_join(pPars->threadID,NULL);
+#endif
+		}
+	m_NumThreads = 0;
+	}
+
+if(m_gzPE1 != NULL)
+	{
+	gzclose(m_gzPE1);
+	m_gzPE1 = NULL;
+	}
+if(m_gzPE2 != NULL)
+	{
+	gzclose(m_gzPE2);
+	m_gzPE2 = NULL;
+	}
+m_pCurChunk = NULL;
+return(m_Rslt);
+}
+
+// RecEnd
+// Locates the end of a fastq record using the same line rules as CFasta::ParseFastqRec() but without validating chars
+// Used when loading serially so that the chars of complete records can be quickly located, parsing with validation is subsequently
+// performed concurrently by the ingestion threads
+int
+CReadsIngest::RecEnd(UINT8 *pChrs,		// returns number of chars in the complete fastq record, including any preceding whitespace, starting at pChrs
+				int Len,				// at most this many chars available
+				bool bEOF)				// true if no more chars follow pChrs[Len-1], returns 0 if record incomplete, < 0 if not a fastq record
+{
+int Ofs;
+int LineIdx;
+int LineStart;
+int LineLen;
+UINT8 *pEOL;
+
+for(Ofs = 0; Ofs < Len && isspace(pChrs[Ofs]); Ofs++);
+if(Ofs == Len)
+	return(0);
+if(pChrs[Ofs] != '@')
+	return(eBSFerrFastqSeqID);
+Ofs += 1;
+
+for(LineIdx = 0; LineIdx < 4; LineIdx++)
+	{
+	while(1)
+		{
+		LineStart = Ofs;
+		if((pEOL = (UINT8 *)memchr(&pChrs[Ofs],'\n',Len - Ofs)) == NULL)
+			{
+			if(!bEOF || LineIdx < 3)
+				return(bEOF ? eBSFerrFastqSeq : 0);
+			LineLen = Len - Ofs;
+			Ofs = Len;
+			}
+		else
+			{
+			LineLen = (int)(pEOL - &pChrs[Ofs]);
+			Ofs += LineLen + 1;
+			}
+		if(LineLen && pChrs[LineStart + LineLen - 1] == '\r')
+			LineLen -= 1;
+		if(LineIdx == 0 || LineLen > 0)
+			break;
+		if(Ofs == Len)					// blank line was the last loaded so need more chars before the next line can be located
+			return(bEOF ? eBSFerrFastqSeq : 0);
+		}
+	}
+return(Ofs);
+}
+
+// RecStart
+// Resynchronises onto a fastq record boundary: a line starting with '@', followed by a line of sequence bases, followed by a
+// line starting with '+', followed by a line of quality scores having the same length as the sequence.
+// A quality line starting with '@' can't be mistaken for a record start as the line following the next line will be a sequence line and not a '+' line
+int
+CReadsIngest::RecStart(UINT8 *pChrs,	// returns offset of first fastq record starting after the '\n' at or following pChrs[Ofs]
+				int Ofs,				// start looking for a record boundary from this offset
+				int Len,				// at most this many chars available
+				bool bEOF)				// true if no more chars follow pChrs[Len-1], returns Len if EOF and no record start, < 0 if unable to locate record start
+{
+int Start;
+int LineIdx;
+int LineStart;
+int LineLen;
+int NxtLineStart;
+int SeqLen;
+int Idx;
+UINT8 Chr;
+UINT8 *pEOL;
+bool bIsRec;
+
+while(Ofs < Len && (pEOL = (UINT8 *)memchr(&pChrs[Ofs],'\n',Len - Ofs)) != NULL)
+	{
+	Start = (int)(pEOL - pChrs) + 1;
+	Ofs = Start;
+	if(Start == Len)
+		break;
+	if(pChrs[Start] != '@')
+		continue;
+
+	bIsRec = true;
+	SeqLen = 0;
+	LineStart = Start;
+	for(LineIdx = 0; bIsRec && LineIdx < 4; LineIdx++)
+		{
+		if(LineStart >= Len || (pEOL = (UINT8 *)memchr(&pChrs[LineStart],'\n',Len - LineStart)) == NULL)
+			{
+			if(!bEOF)
+				return(eBSFerrFastqSeqID);
+			if(LineIdx < 3)
+				return(Start);				// truncated final record, left for the parser to report
+			LineLen = Len - LineStart;
+			}
+		else
+			LineLen = (int)(pEOL - &pChrs[LineStart]);
+		NxtLineStart = LineStart + LineLen + 1;
+		if(LineLen && pChrs[LineStart + LineLen - 1] == '\r')
+			LineLen -= 1;
+		switch(LineIdx) {
+			case 1:					// sequence
+				SeqLen = LineLen;
+				if(SeqLen == 0)
+					bIsRec = false;
+				for(Idx = 0; bIsRec && Idx < SeqLen; Idx++)
+					{
+					Chr = pChrs[LineStart + Idx];
+					if(!(isalpha(Chr) || (Chr >= '0' && Chr <= '4') || Chr == '.'))
+						bIsRec = false;
+					}
+				break;
+			case 2:					// '+'
+				if(LineLen == 0 || pChrs[LineStart] != '+')
+					bIsRec = false;
+				break;
+			case 3:					// quality scores
+				if(LineLen != SeqLen)
+					bIsRec = false;
+				break;
+			}
+		LineStart = NxtLineStart;
+		}
+	if(bIsRec)
+		return(Start);
+	}
+return(bEOF ? Len : eBSFerrFastqSeqID);
+}
+
+// LoadSerialChunk
+// Loads the next block of complete SE or PE1/PE2 records into the chunk, the chars of any incomplete record are carried over into the next chunk
+// If PE then both PE1 and PE2 chunks will contain the same number of records
+// Caller must have serialised access
+int												// returns number of SE or PE1/PE2 records loaded, 0 if EOF, < 0 if errors
+CReadsIngest::LoadSerialChunk(tsIngestChunk *pChunk)
+{
+int Len1;
+int Len2;
+int Ofs1;
+int Ofs2;
+int NumRecs1;
+int NumRecs2;
+int RecLen;
+int ReadLen;
+
+Len1 = m_PE1CarryLen;
+if(Len1)
+	memcpy(pChunk->pPE1Chrs,m_pPE1Carry,Len1);
+while(!m_bPE1EOF && Len1 < cIngestChunkSize)
+	{
+	if((ReadLen = gzread(m_gzPE1,&pChunk->pPE1Chrs[Len1],cIngestChunkSize - Len1)) < 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading file '%s' - %s",m_szPE1File,strerror(errno));
+		return(eBSFerrFileAccess);
+		}
+	if(ReadLen == 0)
+		m_bPE1EOF = true;
+	Len1 += ReadLen;
+	}
+
+Ofs1 = 0;
+NumRecs1 = 0;
+while((RecLen = RecEnd(&pChunk->pPE1Chrs[Ofs1],Len1 - Ofs1,m_bPE1EOF)) > 0)
+	{
+	Ofs1 += RecLen;
+	NumRecs1 += 1;
+	}
+if(RecLen < 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading fastq file '%s' near file offset %lld, not a complete fastq record",m_szPE1File,m_PE1FileOfs + Ofs1);
+	return(RecLen);
+	}
+if(NumRecs1 == 0)
+	{
+	if(m_bPE1EOF)
+		return(0);
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading fastq file '%s' near file offset %lld, record is longer than %d chars",m_szPE1File,m_PE1FileOfs,cIngestChunkSize);
+	return(eBSFerrFastqSeq);
+	}
+
+if(m_bPE)
+	{
+	Len2 = m_PE2CarryLen;
+	if(Len2)
+		memcpy(pChunk->pPE2Chrs,m_pPE2Carry,Len2);
+	while(!m_bPE2EOF && Len2 < cIngestChunkSize)
+		{
+		if((ReadLen = gzread(m_gzPE2,&pChunk->pPE2Chrs[Len2],cIngestChunkSize - Len2)) < 0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading file '%s' - %s",m_szPE2File,strerror(errno));
+			return(eBSFerrFileAccess);
+			}
+		if(ReadLen == 0)
+			m_bPE2EOF = true;
+		Len2 += ReadLen;
+		}
+	Ofs2 = 0;
+	NumRecs2 = 0;
+	while(NumRecs2 < NumRecs1 && (RecLen = RecEnd(&pChunk->pPE2Chrs[Ofs2],Len2 - Ofs2,m_bPE2EOF)) > 0)
+		{
+		Ofs2 += RecLen;
+		NumRecs2 += 1;
+		}
+	if(RecLen < 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading fastq file '%s', not a complete fastq record",m_szPE2File);
+		return(RecLen);
+		}
+	if(NumRecs2 < NumRecs1)
+		{
+		if(m_bPE2EOF)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Insufficent reads in file '%s', fewer PE2 reads than PE1 reads in '%s'",m_szPE2File,m_szPE1File);
+			return(eBSFerrFastqSeq);
+			}
+		if(NumRecs2 == 0)
+			{
+			gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading fastq file '%s', record is longer than %d chars",m_szPE2File,cIngestChunkSize);
+			return(eBSFerrFastqSeq);
+			}
+
+		// PE2 records are longer than PE1, only retain the same number of PE1 records as PE2
+		Ofs1 = 0;
+		for(NumRecs1 = 0; NumRecs1 < NumRecs2; NumRecs1++)
+			Ofs1 += RecEnd(&pChunk->pPE1Chrs[Ofs1],Len1 - Ofs1,m_bPE1EOF);
+		}
+	m_PE2CarryLen = Len2 - Ofs2;
+	if(m_PE2CarryLen)
+		memcpy(m_pPE2Carry,&pChunk->pPE2Chrs[Ofs2],m_PE2CarryLen);
+	pChunk->PE2Len = Ofs2;
+	pChunk->PE2FileOfs = m_PE2FileOfs;
+	m_PE2FileOfs += Ofs2;
+	}
+
+m_PE1CarryLen = Len1 - Ofs1;
+if(m_PE1CarryLen)
+	memcpy(m_pPE1Carry,&pChunk->pPE1Chrs[Ofs1],m_PE1CarryLen);
+pChunk->PE1Len = Ofs1;
+pChunk->FileOfs = m_PE1FileOfs;
+m_PE1FileOfs += Ofs1;
+return(NumRecs1);
+}
+
+// LoadRangeChunk
+// Loads byte range (ChunkSeq - 1) from the SE file, chunk chars start at the first record starting in the byte range and end at the first record starting in the next byte range
+// Resynchronisation onto record boundaries is deterministic so each record is contained in exactly one chunk
+int												// returns number of chars in chunk, < 0 if errors
+CReadsIngest::LoadRangeChunk(tsIngestThreadPars *pPars,	// ingestion thread
+					tsIngestChunk *pChunk)		// load byte range into this chunk
+{
+INT64 RangeStart;
+INT64 RangeEnd;
+INT64 ReadStart;
+int ReadLen;
+int Len;
+int Start;
+int End;
+bool bEOF;
+
+End = 0;
+RangeStart = (INT64)(pChunk->ChunkSeq - 1) * cIngestChunkSize;
+RangeEnd = min(RangeStart + cIngestChunkSize,m_PE1FileSize);
+ReadStart = RangeStart > 0 ? RangeStart - 1 : 0;		// need to be able to check if a record starts at RangeStart
+ReadLen = (int)(min(RangeEnd + (2 * cIngestMaxRecLen),m_PE1FileSize) - ReadStart);
+bEOF = (ReadStart + ReadLen) >= m_PE1FileSize ? true : false;
+
+if(_lseeki64(pPars->hFile,ReadStart,SEEK_SET) != ReadStart)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Unable to seek to %lld in file '%s' - %s",ReadStart,m_szPE1File,strerror(errno));
+	return(eBSFerrFileAccess);
+	}
+Len = 0;
+while(Len < ReadLen)
+	{
+	int Cnt;
+	if((Cnt = read(pPars->hFile,&pChunk->pPE1Chrs[Len],ReadLen - Len)) <= 0)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst reading file '%s' at offset %lld - %s",m_szPE1File,ReadStart + Len,Cnt < 0 ? strerror(errno) : "unexpected EOF");
+		return(eBSFerrFileAccess);
+		}
+	Len += Cnt;
+	}
+
+if(RangeStart == 0)
+	Start = 0;
+else
+	Start = RecStart(pChunk->pPE1Chrs,0,Len,bEOF);
+if(Start >= 0)
+	{
+	if(RangeEnd >= m_PE1FileSize)
+		End = Len;
+	else
+		End = RecStart(pChunk->pPE1Chrs,(int)(RangeEnd - ReadStart) - 1,Len,bEOF);
+	}
+if(Start < 0 || End < 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Unable to locate a fastq record boundary in file '%s' following offset %lld",m_szPE1File,Start < 0 ? RangeStart : RangeEnd);
+	return(eBSFerrFastqSeqID);
+	}
+
+if(Start > 0 && End > Start)
+	memmove(pChunk->pPE1Chrs,&pChunk->pPE1Chrs[Start],End - Start);
+pChunk->PE1Len = max(0,End - Start);
+pChunk->FileOfs = ReadStart + Start;
+return(pChunk->PE1Len);
+}
+
+int
+CReadsIngest::ParseChunkChrs(tsIngestChunk *pChunk,	// parses records in SE/PE1 or PE2 chunk chars
+					bool bPE2,					// true if parsing PE2
+					int MaxRecs)				// if > 0 then expecting exactly this many records
+{
+int Rslt;
+int Ofs;
+int Len;
+int NumRecs;
+int NumLines;
+const char *pszErr;
+UINT8 *pChrs;
+tsFastqRecView *pRec;
+tsFastqRecView *pRealloc;
+
+pChrs = bPE2 ? pChunk->pPE2Chrs : pChunk->pPE1Chrs;
+Len = bPE2 ? pChunk->PE2Len : pChunk->PE1Len;
+Ofs = 0;
+NumRecs = 0;
+while(Ofs < Len)
+	{
+	if(NumRecs == pChunk->AllocRecs)
+		{
+		if((pRealloc = (tsFastqRecView *)realloc(pChunk->pPE1Recs,sizeof(tsFastqRecView) * pChunk->AllocRecs * 2)) == NULL)
+			return(eBSFerrMem);
+		pChunk->pPE1Recs = pRealloc;
+		if(m_bPE)
+			{
+			if((pRealloc = (tsFastqRecView *)realloc(pChunk->pPE2Recs,sizeof(tsFastqRecView) * pChunk->AllocRecs * 2)) == NULL)
+				return(eBSFerrMem);
+			pChunk->pPE2Recs = pRealloc;
+			}
+		pChunk->AllocRecs *= 2;
+		}
+	pRec = bPE2 ? &pChunk->pPE2Recs[NumRecs] : &pChunk->pPE1Recs[NumRecs];
+	if((Rslt = CFasta::ParseFastqRec(&pChrs[Ofs],Len - Ofs,true,pRec,&NumLines,&pszErr)) <= 0)
+		{
+		if(Rslt == 0)			// only whitespace remaining
+			break;
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst parsing fastq file '%s' near record %d of chunk %u, %s",bPE2 ? m_szPE2File : m_szPE1File,NumRecs+1,pChunk->ChunkSeq,pszErr);
+		return(Rslt);
+		}
+	pRec->FileOfs += Ofs + (bPE2 ? pChunk->PE2FileOfs : pChunk->FileOfs);
+	Ofs += Rslt;
+	NumRecs += 1;
+	}
+if(MaxRecs > 0 && NumRecs != MaxRecs)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Errors whilst parsing fastq file '%s', expected %d records in chunk %u but parsed %d",bPE2 ? m_szPE2File : m_szPE1File,MaxRecs,pChunk->ChunkSeq,NumRecs);
+	return(eBSFerrFastqSeq);
+	}
+return(NumRecs);
+}
+
+int													// returns number of SE or PE1/PE2 records parsed, < 0 if errors
+CReadsIngest::ParseChunk(tsIngestChunk *pChunk)
+{
+int NumRecs;
+int Rslt;
+pChunk->NumRecs = 0;
+if((NumRecs = ParseChunkChrs(pChunk,false,0)) <= 0)
+	return(NumRecs);
+if(m_bPE && (Rslt = ParseChunkChrs(pChunk,true,NumRecs)) < 0)
+	return(Rslt);
+pChunk->NumRecs = NumRecs;
+return(NumRecs);
+}
+
+int
+CReadsIngest::IngestThread(tsIngestThreadPars *pPars)	// ingestion thread loads and parses chunks until no more chunks to be loaded
+{
+int Rslt;
+int Idx;
+tsIngestChunk *pChunk;
+
+Rslt = eBSFSuccess;
+if(m_bByteRanges)
+	{
+#ifdef _WIN32
+	pPars->hFile = open(m_szPE1File, O_READSEQ );
+#else
+	pPars->hFile = open64(m_szPE1File, O_READSEQ );
+#endif
+	if(pPars->hFile == -1)
+		{
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"CReadsIngest: Unable to open '%s' - %s",m_szPE1File,strerror(errno));
+		AcquireSerialise();
+		if(m_Rslt >= eBSFSuccess)
+			m_Rslt = eBSFerrOpnFile;
+		ReleaseSerialise();
+		return(eBSFerrOpnFile);
+		}
+	}
+
+while(1)
+	{
+	AcquireSerialise();
+	if(m_bTerminate || m_Rslt < eBSFSuccess || m_bAllAssigned)
+		{
+		ReleaseSerialise();
+		break;
+		}
+	pChunk = m_pChunks;
+	for(Idx = 0; Idx < m_NumChunks; Idx++,pChunk++)
+		if(pChunk->State == eICSFree)
+			break;
+	if(Idx == m_NumChunks)				// all chunks are in use, wait for consumers to release a chunk
+		{
+		ReleaseSerialise();
+		CUtility::SleepMillisecs(1);
+		continue;
+		}
+	pChunk->State = eICSLoading;
+	pChunk->NumRecs = 0;
+	pChunk->PE1Len = 0;
+	pChunk->PE2Len = 0;
+	m_NumChunksLoading += 1;
+	if(m_bByteRanges)
+		{
+		pChunk->ChunkSeq = ++m_NumChunksAssigned;
+		if(m_NumChunksAssigned == m_NumRanges)
+			m_bAllAssigned = true;
+		ReleaseSerialise();
+		Rslt = LoadRangeChunk(pPars,pChunk);
+		}
+	else
+		{
+		if((Rslt = LoadSerialChunk(pChunk)) > 0)
+			pChunk->ChunkSeq = ++m_NumChunksAssigned;
+		else
+			m_bAllAssigned = true;
+		ReleaseSerialise();
+		}
+
+	if(Rslt > 0)
+		Rslt = ParseChunk(pChunk);
+
+	AcquireSerialise();
+	m_NumChunksLoading -= 1;
+	if(Rslt < eBSFSuccess || (Rslt == 0 && !m_bByteRanges))
+		{
+		if(Rslt < eBSFSuccess && m_Rslt >= eBSFSuccess)
+			m_Rslt = Rslt;
+		pChunk->State = eICSFree;
+		}
+	else
+		pChunk->State = eICSReady;		// byte ranges containing no records are still made ready so chunk sequence numbering remains contiguous
+	ReleaseSerialise();
+	if(Rslt < eBSFSuccess)
+		break;
+	}
+
+if(pPars->hFile != -1)
+	{
+	close(pPars->hFile);
+	pPars->hFile = -1;
+	}
+return(Rslt < eBSFSuccess ? Rslt : eBSFSuccess);
+}
+
+int												// returns number of records in chunk, 0 if all chunks dequeued, < 0 if errors
+CReadsIngest::GetNxtChunk(tsIngestChunk **ppChunk)	// dequeue next parsed chunk
+{
+int Idx;
+tsIngestChunk *pChunk;
+tsIngestChunk *pReady;
+
+*ppChunk = NULL;
+if(m_pChunks == NULL)
+	return(eBSFerrClosed);
+while(1)
+	{
+	AcquireSerialise();
+	if(m_Rslt < eBSFSuccess)
+		{
+		ReleaseSerialise();
+		return(m_Rslt);
+		}
+	pReady = NULL;
+	pChunk = m_pChunks;
+	for(Idx = 0; Idx < m_NumChunks; Idx++,pChunk++)
+		{
+		if(pChunk->State != eICSReady)
+			continue;
+		if(m_bOrdered)
+			{
+			if(pChunk->ChunkSeq == m_NxtDeliverSeq)
+				{
+				pReady = pChunk;
+				break;
+				}
+			}
+		else
+			if(pReady == NULL || pChunk->ChunkSeq < pReady->ChunkSeq)
+				pReady = pChunk;
+		}
+	if(pReady != NULL)
+		{
+		pReady->State = eICSConsuming;
+		if(m_bOrdered)
+			m_NxtDeliverSeq += 1;
+		ReleaseSerialise();
+		if(pReady->NumRecs == 0)		// byte range without any records starting in that range
+			{
+			ReleaseChunk(pReady);
+			continue;
+			}
+		*ppChunk = pReady;
+		return(pReady->NumRecs);
+		}
+	if(m_bAllAssigned && m_NumChunksLoading == 0)		// no more chunks will be made ready
+		{
+		ReleaseSerialise();
+		return(0);
+		}
+	ReleaseSerialise();
+	CUtility::SleepMillisecs(1);
+	}
+}
+
+void
+CReadsIngest::ReleaseChunk(tsIngestChunk *pChunk)	// chunk has been consumed and can be reused
+{
+if(pChunk == NULL)
+	return;
+AcquireSerialise();
+pChunk->State = eICSFree;
+ReleaseSerialise();
+}
+
+int													// returns 1 if record(s) returned, 0 if no more records, < 0 if errors
+CReadsIngest::NxtRec(tsFastqRecView **ppPE1Rec,		// returns next SE or PE1 record
+			tsFastqRecView **ppPE2Rec)				// and if PE then the paired PE2 record
+{
+int Rslt;
+while(1)
+	{
+	if(m_pCurChunk != NULL)
+		{
+		if(m_CurRecIdx < m_pCurChunk->NumRecs)
+			{
+			*ppPE1Rec = &m_pCurChunk->pPE1Recs[m_CurRecIdx];
+			if(ppPE2Rec != NULL)
+				*ppPE2Rec = m_bPE ? &m_pCurChunk->pPE2Recs[m_CurRecIdx] : NULL;
+			m_CurRecIdx += 1;
+			return(1);
+			}
+		ReleaseChunk(m_pCurChunk);
+		m_pCurChunk = NULL;
+		}
+	if((Rslt = GetNxtChunk(&m_pCurChunk)) <= 0)
+		{
+		m_pCurChunk = NULL;
+		return(Rslt);
+		}
+	m_CurRecIdx = 0;
+	}
+}
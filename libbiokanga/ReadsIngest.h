@@ -0,0 +1,133 @@
+#pragma once
+// Multithreaded ingestion of raw fastq reads files
+// Files are partitioned into chunks which are loaded and parsed by a pool of ingestion threads, parsed chunks are then dequeued by consuming threads
+// Uncompressed single ended files are partitioned into independent byte ranges with chunk starts resynchronised onto fastq record boundaries so
+// both the file reads and parsing are concurrent. Compressed files, or paired ends, are loaded serially in blocks of complete records, with the same number
+// of records in each PE1 and PE2 chunk so pairings are retained, and the blocks are then parsed concurrently.
+// Chunks are numbered in file order and, if requested, are dequeued in that order so reads can be processed in the same order as they were in the file(s)
+
+const int cIngestChunkSize = 0x0400000;			// target chunk size of 4MB chars per chunk
+const int cIngestMaxRecLen = (2 * cMaxFastQSeqLen) + (2 * cMaxFastaDescrLen) + 16;	// a single fastq record will be no longer than this many chars
+const int cIngestChunkAlloc = cIngestChunkSize + (2 * cIngestMaxRecLen) + 16;	// chunk buffers allow for byte range overlap when resynchronising onto record boundaries
+const INT64 cIngestMinRangesFileSize = (INT64)cIngestChunkSize * 4;	// uncompressed SE files must be at least this size before being partitioned into byte ranges
+const int cIngestInitAllocRecs = 0x04000;		// initially allocate for this many records per chunk, realloc'd as may be required
+const int cIngestMaxThreads = 8;				// at most this many ingestion threads
+
+// chunk processing states
+typedef enum TAG_eIngestChunkState {
+	eICSFree = 0,			// chunk is available to be loaded
+	eICSLoading,			// chunk is being loaded and parsed by an ingestion thread
+	eICSReady,				// chunk has been parsed and is ready to be dequeued
+	eICSConsuming			// chunk has been dequeued and records are being processed
+	} teIngestChunkState;
+
+#pragma pack(1)
+typedef struct TAG_sIngestChunk {
+	UINT32 ChunkSeq;			// chunks are sequentially numbered, starting from 1, in file order
+	INT32 State;				// chunk processing state - teIngestChunkState
+	INT64 FileOfs;				// SE or PE1 chunk started at this (uncompressed) file offset
+	INT64 PE2FileOfs;			// PE2 chunk started at this (uncompressed) file offset
+	INT32 NumRecs;				// chunk contains this many SE, or PE1 and PE2 pairs of, parsed records
+	INT32 AllocRecs;			// pPE1Recs and pPE2Recs allocated to hold at most this many records
+	tsFastqRecView *pPE1Recs;	// parsed SE or PE1 records, referencing pPE1Chrs
+	tsFastqRecView *pPE2Recs;	// parsed PE2 records, referencing pPE2Chrs, NULL if SE
+	INT32 PE1Len;				// pPE1Chrs contains this many chars
+	INT32 PE2Len;				// pPE2Chrs contains this many chars
+	UINT8 *pPE1Chrs;			// allocated to hold cIngestChunkAlloc SE or PE1 chars
+	UINT8 *pPE2Chrs;			// allocated to hold cIngestChunkAlloc PE2 chars, NULL if SE
+	} tsIngestChunk;
+
+typedef struct TAG_sIngestThreadPars {
+	int ThreadIdx;				// uniquely identifies this thread
+	void *pThis;				// will be initialised to pt to class instance
+#ifdef _WIN32
+	HANDLE threadHandle;		// handle as returned by _beginthreadex()
+	unsigned int threadID;		// identifier as set by _beginthreadex()
+#else
+	int threadRslt;				// result as returned by pthread_create ()
+	pthread_t threadID;			// identifier as set by pthread_create ()
+#endif
+	int hFile;					// if loading byte ranges then thread has this file opened for reading
+	int Rslt;					// thread processing result
+	} tsIngestThreadPars;
+#pragma pack()
+
+class CReadsIngest
+{
+	bool m_bPE;							// true if processing paired end files
+	bool m_bOrdered;					// true if chunks are to be dequeued in file order
+	bool m_bByteRanges;					// true if SE file is being partitioned into byte ranges
+	char m_szPE1File[_MAX_PATH];		// SE or PE1 reads file
+	char m_szPE2File[_MAX_PATH];		// PE2 reads file
+
+	INT64 m_PE1FileSize;				// if loading byte ranges then file is this size
+	UINT32 m_NumRanges;					// if loading byte ranges then file partitioned into this many ranges
+
+	gzFile m_gzPE1;						// if loading serially then SE or PE1 opened for reading
+	gzFile m_gzPE2;						// if loading serially then PE2 opened for reading
+	bool m_bPE1EOF;						// true if no more chars can be read from m_gzPE1
+	bool m_bPE2EOF;						// true if no more chars can be read from m_gzPE2
+	INT64 m_PE1FileOfs;					// file offset of next SE or PE1 char to be loaded into a chunk
+	INT64 m_PE2FileOfs;					// file offset of next PE2 char to be loaded into a chunk
+	INT32 m_PE1CarryLen;				// m_pPE1Carry holds this many chars of an incomplete record following the last chunk loaded
+	INT32 m_PE2CarryLen;				// m_pPE2Carry holds this many chars of an incomplete record following the last chunk loaded
+	UINT8 *m_pPE1Carry;					// allocated to hold cIngestChunkSize chars carried over into the next SE or PE1 chunk
+	UINT8 *m_pPE2Carry;					// allocated to hold cIngestChunkSize chars carried over into the next PE2 chunk
+
+	int m_NumThreads;					// number of ingestion threads
+	tsIngestThreadPars m_ThreadPars[cIngestMaxThreads];	// ingestion threads
+
+	int m_NumChunks;					// number of chunks in m_pChunks
+	tsIngestChunk *m_pChunks;			// chunks being loaded, parsed or consumed
+	UINT32 m_NumChunksAssigned;			// number of chunks assigned for loading, also sequence number of last chunk assigned
+	UINT32 m_NxtDeliverSeq;				// if ordered then next chunk to be dequeued will have this sequence number
+	int m_NumChunksLoading;				// number of chunks currently being loaded or parsed
+	bool m_bAllAssigned;				// true when there are no more chunks to be assigned for loading
+	bool m_bTerminate;					// set true to request that ingestion threads terminate
+	int m_Rslt;							// set < eBSFSuccess if any ingestion errors
+
+	tsIngestChunk *m_pCurChunk;			// NxtRec() is currently returning records from this chunk
+	int m_CurRecIdx;					// index of next record to return from m_pCurChunk
+
+	volatile unsigned int m_CASIngest;	// used with synchronous compare and swap (CAS) for serialising access to chunks and file loading state
+
+	void AcquireSerialise(void);
+	void ReleaseSerialise(void);
+
+	static int RecEnd(UINT8 *pChrs,		// returns number of chars in the complete fastq record, including any preceding whitespace, starting at pChrs
+					int Len,			// at most this many chars available
+					bool bEOF);			// true if no more chars follow pChrs[Len-1], returns 0 if record incomplete, < 0 if not a fastq record
+
+	static int RecStart(UINT8 *pChrs,	// returns offset of first fastq record starting after the '\n' at or following pChrs[Ofs]
+					int Ofs,			// start looking for a record boundary from this offset
+					int Len,			// at most this many chars available
+					bool bEOF);			// true if no more chars follow pChrs[Len-1], returns Len if EOF and no record start, < 0 if unable to locate record start
+
+	int LoadSerialChunk(tsIngestChunk *pChunk);		// loads next block of complete SE or PE1/PE2 records into chunk, returns number of chars loaded, 0 if EOF
+	int LoadRangeChunk(tsIngestThreadPars *pPars,	// loads byte range (ChunkSeq - 1) into chunk
+					tsIngestChunk *pChunk);
+	int ParseChunk(tsIngestChunk *pChunk);			// parses records in chunk, returns number of SE or PE1/PE2 records parsed
+	int ParseChunkChrs(tsIngestChunk *pChunk,		// parses records in SE/PE1 or PE2 chunk chars
+					bool bPE2,						// true if parsing PE2
+					int MaxRecs);					// if > 0 then expecting exactly this many records
+
+public:
+	CReadsIngest(void);
+	~CReadsIngest(void);
+
+	void Reset(void);
+
+	int Open(char *pszPE1File,			// SE or PE1 fastq reads file
+			char *pszPE2File = NULL,	// if paired end processing then PE2 fastq reads file
+			int NumThreads = 4,			// use this many ingestion threads
+			bool bOrdered = false);		// true if chunks are to be dequeued in file order
+	int Close(void);					// terminates any ingestion threads and closes files
+
+	int IngestThread(tsIngestThreadPars *pPars);	// ingestion thread loads and parses chunks until no more chunks to be loaded
+
+	int GetNxtChunk(tsIngestChunk **ppChunk);		// dequeue next parsed chunk, returns number of records in chunk, 0 if all chunks dequeued, < 0 if errors
+	void ReleaseChunk(tsIngestChunk *pChunk);		// chunk has been consumed and can be reused
+
+	int NxtRec(tsFastqRecView **ppPE1Rec,			// returns next SE or PE1 record
+			tsFastqRecView **ppPE2Rec = NULL);		// and if PE then the paired PE2 record, returns 1 if record(s) returned, 0 if no more records, < 0 if errors
+};
@@ -68,6 +68,7 @@ m_pRefSeqs = NULL;
 m_pBAIChunks = NULL;
 m_pChunkBins = NULL;
 m_p16KOfsVirtAddrs = NULL;
+m_pIdxRefSeqVAs = NULL;
 Reset(false);
 }
 
@@ -159,7 +160,7 @@ if(m_pBAI != NULL)
 
 if(m_pBAIChunks != NULL)
 	{
-	free(m_pBAIChunks);				// was allocated with malloc/realloc, or mmap/mremap, not c++'s new....
+	m_BAIChunksArena.Release();
 	m_pBAIChunks = NULL;
 	}
 
@@ -182,6 +183,13 @@ if(m_pRefSeqs != NULL)
 	m_pRefSeqs = NULL;
 	}
 
+if(m_pIdxRefSeqVAs != NULL)
+	{
+	free(m_pIdxRefSeqVAs);
+	m_pIdxRefSeqVAs = NULL;
+	}
+m_NumIdxRefSeqs = 0;
+
 m_ComprLev = 0;
 m_AllocBAMSize = 0;
 m_CurBAMLen = 0;
@@ -434,6 +442,9 @@ if(m_SAMFileType >= eSFTBAM)
 	m_CurInBAMIdx = 4;
 	m_TotInBAMProc = 4;
 	m_InBAMHdrLen = 0;
+
+	// if there is an associated BAI or CSI index then it can be used to seek directly to alignments for specific reference sequences
+	LoadRefSeqIdx();
 	}
 else
 	{
@@ -475,6 +486,263 @@ else
 return(eBSFSuccess);
 }
 
+int				// attempt to load BAI or CSI index associated with BAM input file, returns number of indexed reference sequences, 0 if no usable index
+CSAMfile::LoadRefSeqIdx(void)
+{
+int Rslt;
+int hIdxFile;
+BGZF *pIdxBGZF;
+bool bCSI;
+int NameLen;
+int ReadLen;
+INT64 IdxLen;
+size_t AllocIdx;
+UINT8 *pIdx;
+UINT8 *pTmp;
+char szIdxFile[_MAX_PATH+10];
+
+if(m_pIdxRefSeqVAs != NULL)
+	{
+	free(m_pIdxRefSeqVAs);
+	m_pIdxRefSeqVAs = NULL;
+	}
+m_NumIdxRefSeqs = 0;
+
+// index file names tried are, in order, '<file>.bai', '<file less .bam>.bai', and '<file>.csi'
+pIdx = NULL;
+IdxLen = 0;
+bCSI = false;
+NameLen = (int)strlen(m_szSAMfileName);
+sprintf(szIdxFile,"%s.bai",m_szSAMfileName);
+#ifdef _WIN32
+hIdxFile = open(szIdxFile,( O_RDONLY | _O_BINARY | _O_SEQUENTIAL),_S_IREAD);
+#else
+hIdxFile = open(szIdxFile,O_RDONLY,S_IREAD);
+#endif
+if(hIdxFile < 0 && NameLen > 4 && !stricmp(&m_szSAMfileName[NameLen-4],".bam"))
+	{
+	strcpy(szIdxFile,m_szSAMfileName);
+	strcpy(&szIdxFile[NameLen-4],".bai");
+#ifdef _WIN32
+	hIdxFile = open(szIdxFile,( O_RDONLY | _O_BINARY | _O_SEQUENTIAL),_S_IREAD);
+#else
+	hIdxFile = open(szIdxFile,O_RDONLY,S_IREAD);
+#endif
+	}
+
+if(hIdxFile >= 0)		// BAI is uncompressed so can simply be read into memory
+	{
+	IdxLen = lseek(hIdxFile,0,SEEK_END);
+	lseek(hIdxFile,0,SEEK_SET);
+	if(IdxLen > 0 && (pIdx = (UINT8 *)malloc((size_t)IdxLen)) != NULL)
+		{
+		if(read(hIdxFile,pIdx,(int)IdxLen) != (int)IdxLen)
+			IdxLen = 0;
+		}
+	close(hIdxFile);
+	}
+else
+	{
+	sprintf(szIdxFile,"%s.csi",m_szSAMfileName);
+#ifdef _WIN32
+	hIdxFile = open(szIdxFile,( O_RDONLY | _O_BINARY | _O_SEQUENTIAL),_S_IREAD);
+#else
+	hIdxFile = open(szIdxFile,O_RDONLY,S_IREAD);
+#endif
+	if(hIdxFile < 0)
+		return(0);
+	if((pIdxBGZF = bgzf_dopen(hIdxFile,"r")) == NULL)	// CSI is BGZF compressed
+		{
+		close(hIdxFile);
+		return(0);
+		}
+	bCSI = true;
+	AllocIdx = 0;
+	do {
+		if((size_t)IdxLen + 0x0100000 > AllocIdx)
+			{
+			if((pTmp = (UINT8 *)realloc(pIdx,AllocIdx + 0x0400000)) == NULL)
+				{
+				IdxLen = 0;
+				break;
+				}
+			pIdx = pTmp;
+			AllocIdx += 0x0400000;
+			}
+		if((ReadLen = (int)bgzf_read(pIdxBGZF,&pIdx[IdxLen],AllocIdx - (size_t)IdxLen)) < 0)
+			{
+			IdxLen = 0;
+			break;
+			}
+		IdxLen += ReadLen;
+		}
+	while(ReadLen > 0);
+	bgzf_close(pIdxBGZF);
+	}
+
+if(pIdx == NULL || IdxLen == 0)
+	{
+	if(pIdx != NULL)
+		free(pIdx);
+	gDiagnostics.DiagOut(eDLWarn,gszProcName,"LoadRefSeqIdx: unable to load index file '%s', alignments will be sequentially processed",szIdxFile);
+	return(0);
+	}
+
+Rslt = ParseRefSeqIdx(bCSI,(size_t)IdxLen,pIdx);
+free(pIdx);
+if(Rslt <= 0)
+	{
+	gDiagnostics.DiagOut(eDLWarn,gszProcName,"LoadRefSeqIdx: index file '%s' is not a valid %s index, alignments will be sequentially processed",szIdxFile,bCSI ? "CSI" : "BAI");
+	return(0);
+	}
+gDiagnostics.DiagOut(eDLInfo,gszProcName,"LoadRefSeqIdx: loaded %s index from '%s' for %d reference sequences",bCSI ? "CSI" : "BAI",szIdxFile,Rslt);
+return(Rslt);
+}
+
+int				// parse BAI or CSI index retaining the virtual address of the first alignment to each reference sequence, returns number of reference sequences or 0 if index not parsed
+CSAMfile::ParseRefSeqIdx(bool bCSI,		// true if index is CSI, false if BAI
+					size_t IdxLen,		// index is this length
+					UINT8 *pIdx)		// index as loaded into memory (CSI after decompression)
+{
+size_t Ofs;
+int MinShift;
+int Depth;
+int AuxLen;
+UINT32 PseudoBin;
+UINT32 NumRefs;
+UINT32 RefIdx;
+UINT32 NumBins;
+UINT32 BinIdx;
+UINT32 Bin;
+UINT32 NumChunks;
+UINT32 ChunkIdx;
+UINT32 NumIntvs;
+UINT64 ChunkVA;
+UINT64 FirstVA;
+
+if(IdxLen < 8 || memcmp(pIdx,bCSI ? "CSI\1" : "BAI\1",4))
+	return(0);
+Ofs = 4;
+if(bCSI)
+	{
+	if(IdxLen < 20)
+		return(0);
+	MinShift = *(int *)&pIdx[4];
+	Depth = *(int *)&pIdx[8];
+	AuxLen = *(int *)&pIdx[12];
+	Ofs = 16;
+	if(MinShift < 1 || Depth < 1 || Depth > 9 || AuxLen < 0 || (Ofs + (size_t)AuxLen + 4) > IdxLen)
+		return(0);
+	Ofs += AuxLen;
+	PseudoBin = (UINT32)((((INT64)1 << ((Depth + 1) * 3)) - 1) / 7) + 1;	// CSI pseudo-bin holding unmapped read counts
+	}
+else
+	PseudoBin = (UINT32)cNumSAIBins;			// BAI pseudo-bin is 37450
+
+NumRefs = *(UINT32 *)&pIdx[Ofs];
+Ofs += 4;
+if(NumRefs == 0 || NumRefs > (IdxLen - Ofs) / 4)
+	return(0);
+if((m_pIdxRefSeqVAs = (UINT64 *)malloc(NumRefs * sizeof(UINT64))) == NULL)
+	return(0);
+
+for(RefIdx = 0; RefIdx < NumRefs; RefIdx++)
+	{
+	if((Ofs + 4) > IdxLen)
+		break;
+	NumBins = *(UINT32 *)&pIdx[Ofs];
+	Ofs += 4;
+	FirstVA = 0;
+	for(BinIdx = 0; BinIdx < NumBins; BinIdx++)
+		{
+		if((Ofs + (bCSI ? 16 : 8)) > IdxLen)
+			break;
+		Bin = *(UINT32 *)&pIdx[Ofs];
+		Ofs += bCSI ? 12 : 4;		// CSI bins also have a loffset
+		NumChunks = *(UINT32 *)&pIdx[Ofs];
+		Ofs += 4;
+		if((UINT64)NumChunks * 16 > (UINT64)(IdxLen - Ofs))
+			break;
+		if(Bin != PseudoBin)		// chunks are all alignments to this reference sequence, the lowest chunk start is the first alignment
+			{
+			for(ChunkIdx = 0; ChunkIdx < NumChunks; ChunkIdx++)
+				{
+				ChunkVA = *(UINT64 *)&pIdx[Ofs + ((size_t)ChunkIdx * 16)];
+				if(FirstVA == 0 || ChunkVA < FirstVA)
+					FirstVA = ChunkVA;
+				}
+			}
+		Ofs += (size_t)NumChunks * 16;
+		}
+	if(BinIdx < NumBins)
+		break;
+	if(!bCSI)						// BAI also has the linear index which is not required here
+		{
+		if((Ofs + 4) > IdxLen)
+			break;
+		NumIntvs = *(UINT32 *)&pIdx[Ofs];
+		Ofs += 4;
+		if((UINT64)NumIntvs * 8 > (UINT64)(IdxLen - Ofs))
+			break;
+		Ofs += (size_t)NumIntvs * 8;
+		}
+	m_pIdxRefSeqVAs[RefIdx] = FirstVA;
+	}
+
+if(RefIdx < NumRefs)				// truncated or otherwise inconsistent index
+	{
+	free(m_pIdxRefSeqVAs);
+	m_pIdxRefSeqVAs = NULL;
+	return(0);
+	}
+m_NumIdxRefSeqs = NumRefs;
+return((int)NumRefs);
+}
+
+bool				// true if BAM input file was opened with an associated BAI or CSI index
+CSAMfile::HasRefSeqIdx(void)
+{
+if(m_pInBGZF == NULL || m_pIdxRefSeqVAs == NULL)
+	return(false);
+// once the BAM header has been processed then the index must be for the same number of reference sequences
+return(m_NumBAMSeqNames == 0 || m_NumIdxRefSeqs == m_NumBAMSeqNames);
+}
+
+int					// 1 if positioned at first alignment to reference sequence, 0 if no alignments to that sequence, < 0 if errors
+CSAMfile::SeekRefSeq(char *pszRefSeqName)	// BAM input with index only: position input so the next GetNxtSAMline() returns first alignment to this reference sequence
+{
+int SeqID;
+UINT64 FirstVA;
+
+if(pszRefSeqName == NULL || pszRefSeqName[0] == '\0')
+	return(eBSFerrParams);
+
+// reference sequence names are only known after the BAM header has been processed
+if(!HasRefSeqIdx() || m_NumBAMSeqNames == 0 || m_NumRefSeqNames < m_NumBAMSeqNames)
+	return(eBSFerrParams);
+
+if((SeqID = LocateRefSeqID(pszRefSeqName)) == 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"SeekRefSeq: unable to locate reference sequence '%s' in '%s'",pszRefSeqName,m_szSAMfileName);
+	return(eBSFerrEntry);
+	}
+if((FirstVA = m_pIdxRefSeqVAs[SeqID-1]) == 0)
+	return(0);
+
+if(bgzf_seek(m_pInBGZF,(INT64)FirstVA,SEEK_SET) < 0)
+	{
+	gDiagnostics.DiagOut(eDLFatal,gszProcName,"SeekRefSeq: unable to seek to reference sequence '%s' alignments in '%s'",pszRefSeqName,m_szSAMfileName);
+	return(eBSFerrFileAccess);
+	}
+
+// discard any buffered alignments, reference sequence name lookups restart from the first reference sequence
+m_CurBAMLen = 0;
+m_CurInBAMIdx = 0;
+m_bInEOF = false;
+m_pCurRefSeq = m_pRefSeqs;
+m_CurRefSeqNameID = 1;
+return(1);
+}
 
 char *
 CSAMfile::TrimWhitespace(char *pTxt)
@@ -1239,6 +1507,7 @@ else  // reading from BAM
 			m_CurInBAMIdx += 4;
 			strcpy(m_pCurRefSeq->szSeqName,(char *)&m_pBAM[m_CurInBAMIdx]);
 			m_CurInBAMIdx += 1 + m_pCurRefSeq->SeqNameLen;
+			m_pCurRefSeq->Hash = GenNameHash(m_pCurRefSeq->szSeqName);
 			m_pCurRefSeq->SeqLen = *(int *)&m_pBAM[m_CurInBAMIdx];
 			m_CurInBAMIdx += 4;
 			m_TotInBAMProc +=  m_pCurRefSeq->SeqNameLen + 9;
@@ -1461,7 +1730,7 @@ if(SAMType >= eSFTBAM_BAI)
 		}
 	m_AllocBAISize = cAllocBAISize;
 
-	if((m_pBAIChunks = (tsBAIChunk *)malloc(sizeof(tsBAIChunk) * cAllocBAIChunks))==NULL)
+	if((m_pBAIChunks = (tsBAIChunk *)m_BAIChunksArena.Grow(sizeof(tsBAIChunk) * cAllocBAIChunks))==NULL)
 		{
 		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Create: unable to alloc memory for BAI or CSI chunks");
 		Reset();
@@ -1913,8 +2182,11 @@ if(m_NumBinsWithChunks > 0)
 	}
 else     // no alignments to this sequence
 	{
-	*pSAI = 0; // n_intv
-	m_CurBAILen += 4;	
+	if(m_SAMFileType == eSFTBAM_BAI)	// CSI has no linear index
+		{
+		*pSAI = 0; // n_intv
+		m_CurBAILen += 4;
+		}
 	}
 
 if(bFinal || (m_CurBAILen + 1000) > m_AllocBAISize)
@@ -1950,10 +2222,10 @@ if(End >= m_MaxIdxRefSeqLen)		// exceeding the limit should have been picked up
 if((m_NumChunks + 5) >= m_AllocBAIChunks)	
 	{
 	tsBAIChunk *pTmp;
-	pTmp = (tsBAIChunk *)realloc(m_pBAIChunks,sizeof(tsBAIChunk) * (m_AllocBAIChunks + cAllocBAIChunks));
+	pTmp = (tsBAIChunk *)m_BAIChunksArena.Grow(sizeof(tsBAIChunk) * (m_AllocBAIChunks + cAllocBAIChunks));
 	if(pTmp == NULL)
 		{
-		gDiagnostics.DiagOut(eDLFatal,gszProcName,"Create: unable to realloc memory for BAI chunks");
+		gDiagnostics.DiagOut(eDLFatal,gszProcName,"AddAlignment: unable to grow memory for BAI chunks");
 		Reset();
 		return(eBSFerrMem);
 		}
@@ -158,6 +158,7 @@ class CSAMfile
 	UINT8 *m_pBAI;							// allocated to hold BAI
 	UINT32 m_AllocBAIChunks;				// currently this many chunks have been allocated
 	UINT32 m_NumChunks;						// current number of chunks
+	CMemArena m_BAIChunksArena;				// m_pBAIChunks is allocated from this arena
 	tsBAIChunk *m_pBAIChunks;				// to hold BAI chunks
 	UINT32 m_NumBinsWithChunks;				// number of bins with at least one chunk
 	UINT32 m_NumAllocdChunkBins;			// this number of bins have been allocated
@@ -166,6 +167,9 @@ class CSAMfile
 	size_t m_Alloc16KOfsVirtAddrsSize;       // currently allocated size, in bytes, of m_p16KOfsVirtAddrs 
 	UINT64 *m_p16KOfsVirtAddrs;				// allocated to hold SAI 16Kbp linear virtual addresses
 
+	UINT32 m_NumIdxRefSeqs;					// number of reference sequences in BAI/CSI index loaded for BAM input
+	UINT64 *m_pIdxRefSeqVAs;				// allocated to hold, for each indexed reference sequence, virtual address of the first alignment or 0 if no alignments
+
 	gzFile m_gzInSAMfile;					// input when reading SAM as gzip
 	int m_hInSAMfile;						// file handle used when reading SAM file
 	BGZF* m_pInBGZF;						// BAM is BGZF compressed 
@@ -228,6 +232,11 @@ class CSAMfile
 	int WriteIdxToDisk(void);				 // write index to disk, returns number of bytes written, can be 0 if none attempted to be written, < 0 if errors
 	int UpdateSAIIndex(bool bFinal = false); // alignments to current sequence completed, update SAI file with bins/chunks for this sequence
 
+	int LoadRefSeqIdx(void);				// attempt to load BAI or CSI index associated with BAM input file, returns number of indexed reference sequences, 0 if no usable index
+	int ParseRefSeqIdx(bool bCSI,			// true if index is CSI, false if BAI
+					size_t IdxLen,			// index is this length
+					UINT8 *pIdx);			// index as loaded into memory (CSI after decompression)
+
 	static char *TrimWhitespace(char *pTxt);	// trim whitespace
 
 public:
@@ -267,6 +276,11 @@ public:
 	int				// alignment length as calculated from SAM/BAM CIGAR string, only 'M','X','=' lengths contribute
 		CigarAlignLen(char *pszCigar);	// alignment length as calculated from SAM/BAM CIGAR
 
+	bool HasRefSeqIdx(void);				// true if BAM input file was opened with an associated BAI or CSI index
+
+	int										// 1 if positioned at first alignment to reference sequence, 0 if no alignments to that sequence, < 0 if errors
+		SeekRefSeq(char *pszRefSeqName);	// BAM input with index only: position input so the next GetNxtSAMline() returns first alignment to this reference sequence
+
 	int										// number of chars returned in pszNxtLine
 		GetNxtSAMline(char *pszNxtLine);	// copy next line read from input source to this line buffer; caller must ensure that at least cMaxBAMLineLen has been allocated for the line buffer
 
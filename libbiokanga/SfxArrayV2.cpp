@@ -23,6 +23,15 @@ static int gMaxBaseCmpLen = (5 * cMaxReadLen);   // used to limit the number of
 static int QSortSeqCmp32(const void *p1,const void *p2);
 static int QSortSeqCmp40(const void *p1,const void *p2);
 static int QSortEntryNames(const void *p1,const void *p2);
+static int QSortCoreSeeds(const void *p1,const void *p2);
+
+// prefetch cache line containing address, used when interleaving suffix array searches
+#ifdef _WIN32
+#include <xmmintrin.h>
+#define SfxPrefetch(pAddr) _mm_prefetch((const char *)(pAddr),_MM_HINT_T0)
+#else
+#define SfxPrefetch(pAddr) __builtin_prefetch((const void *)(pAddr))
+#endif
 
 static UINT8 *gpSfxArray = NULL;
 static etSeqBase *gpSeq = NULL;
@@ -60,6 +69,7 @@ m_AllocBisulfiteMem = 0;
 m_EstSfxEls = 0;
 m_MaxIter = cDfltMaxIter;
 m_bInMemSfx = false;
+m_bReplica = false;
 m_MaxQSortThreads = cDfltSortThreads;
 m_MTqsort.SetMaxThreads(m_MaxQSortThreads);
 m_MaxSfxBlockEls = cMaxAllowConcatSeqLen;
@@ -97,6 +107,12 @@ if(m_bThreadActive)	// if processing reads against sfx blocks then need to termi
 #endif
 	}
 
+if(m_bReplica)			// replicas only own their suffix block
+	{
+	m_pEntriesBlock = NULL;
+	m_pOccKMerClas = NULL;
+	}
+
 if(m_pSfxBlock != NULL)
 	{
 #ifdef _WIN32
@@ -142,6 +158,75 @@ if(m_hFile != -1)
 
 }
 
+CSfxArrayV3 *							// returns replica or NULL if unable to replicate
+CSfxArrayV3::Replicate(int NUMANode)	// replicate the currently loaded suffix block, for query only use, with the replica's pages placed on NUMANode
+{
+CSfxArrayV3 *pReplica;
+tsSfxBlock *pSfxBlock;
+size_t BlockSize;
+
+if(m_pSfxBlock == NULL || m_pEntriesBlock == NULL || m_pSfxBlock->BlockID == 0 || m_bReplica)
+	return(NULL);
+
+// only the concatenated sequences and their suffix array need be replicated
+BlockSize = sizeof(tsSfxBlock) + (size_t)(m_pSfxBlock->ConcatSeqLen * (1 + m_pSfxBlock->SfxElSize));
+if(BlockSize > m_AllocSfxBlockMem)
+	BlockSize = (size_t)m_AllocSfxBlockMem;
+
+#ifdef _WIN32
+pSfxBlock = (tsSfxBlock *) malloc(BlockSize);
+if(pSfxBlock == NULL)
+	{
+	AddErrMsg("CSfxArrayV3::Replicate","Fatal: unable to allocate %lld bytes contiguous memory for index replica",(INT64)BlockSize);
+	return(NULL);
+	}
+#else
+pSfxBlock = (tsSfxBlock *)mmap(NULL,BlockSize, PROT_READ |  PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS, -1,0);
+if(pSfxBlock == MAP_FAILED)
+	{
+	AddErrMsg("CSfxArrayV3::Replicate","Fatal: unable to allocate %lld bytes contiguous memory for index replica",(INT64)BlockSize);
+	return(NULL);
+	}
+CMemArena::Place(pSfxBlock,BlockSize,0,NUMANode);	// pages yet to be touched so will be placed on NUMANode as copied into
+#endif
+memcpy(pSfxBlock,m_pSfxBlock,BlockSize);
+
+if((pReplica = new CSfxArrayV3) == NULL)
+	{
+#ifdef _WIN32
+	free(pSfxBlock);
+#else
+	munmap(pSfxBlock,BlockSize);
+#endif
+	AddErrMsg("CSfxArrayV3::Replicate","Fatal: unable to instantiate index replica");
+	return(NULL);
+	}
+
+// replica shares the entries and KMer classifications, and copies those parameters used when querying
+pReplica->m_bReplica = true;
+pReplica->m_pSfxBlock = pSfxBlock;
+pReplica->m_AllocSfxBlockMem = BlockSize;
+pReplica->m_SfxHeader = m_SfxHeader;
+pReplica->m_pEntriesBlock = m_pEntriesBlock;
+pReplica->m_AllocEntriesBlockMem = m_AllocEntriesBlockMem;
+pReplica->m_pOccKMerClas = m_pOccKMerClas;
+pReplica->m_AllocOccKMerClasMem = m_AllocOccKMerClasMem;
+pReplica->m_OccKMerLen = m_OccKMerLen;
+pReplica->m_MaxKMerOccs = m_MaxKMerOccs;
+pReplica->m_bBisulfite = m_bBisulfite;
+pReplica->m_bColorspace = m_bColorspace;
+pReplica->m_bV3File = m_bV3File;
+pReplica->m_bInMemSfx = m_bInMemSfx;
+pReplica->m_MaxIter = m_MaxIter;
+pReplica->m_MaxMMExploreInDel = m_MaxMMExploreInDel;
+pReplica->m_MaxInDelLen = m_MaxInDelLen;
+pReplica->m_MinInDelSeqLen = m_MinInDelSeqLen;
+pReplica->m_MaxAllowSeqLen = m_MaxAllowSeqLen;
+pReplica->m_MaxSfxBlockEls = m_MaxSfxBlockEls;
+strcpy(pReplica->m_szFile,m_szFile);
+return(pReplica);
+}
+
 int
 CSfxArrayV3::Reset(bool bFlush)			// reset state back to that immediately following instantiation
 {
@@ -182,6 +267,13 @@ if(m_hFile != -1)
 
 memset(&m_SfxHeader,0,sizeof(m_SfxHeader));
 
+if(m_bReplica)			// replicas only own their suffix block
+	{
+	m_pEntriesBlock = NULL;
+	m_pOccKMerClas = NULL;
+	m_bReplica = false;
+	}
+
 if(m_pSfxBlock != NULL)
 	{
 #ifdef _WIN32
@@ -995,6 +1087,18 @@ else // else opening existing file
 		Reset(false);
 		return(eBSFerrMem);
 		}
+	// block pages are yet to be touched so on multinode hosts can be interleaved over all nodes, or if the block is
+	// later to be replicated onto each node then this primary copy is placed on the first node
+	switch(CNUMATopology::IdxMode()) {
+		case eNUMAIdxInterleave:
+			CMemArena::Place(m_pSfxBlock,(size_t)m_SfxHeader.SfxBlockSize,cMemArenaInterleave);
+			break;
+		case eNUMAIdxReplicate:
+			CMemArena::Place(m_pSfxBlock,(size_t)m_SfxHeader.SfxBlockSize,0,CNUMATopology::NodeID(0));
+			break;
+		default:
+			break;
+		}
 #endif
 	m_AllocSfxBlockMem = (size_t)m_SfxHeader.SfxBlockSize;
 	m_pSfxBlock->BlockID = 0;
@@ -6050,7 +6154,8 @@ CSfxArrayV3::LocateQuerySeqs(UINT32 QuerySeqID,			// identifies this query seque
 						 UINT32 MinMatchLen,			// putative alignments must be at least this length
 						 UINT32 MaxHits,				// (IN) process for at most this number of hits
 						 tsQueryAlignNodes *pHits,		// where to return hits (at most MaxHits)
-						 UINT32 CurMaxIter)				// max allowed iterations per subsegmented sequence when matching that subsegment
+						 UINT32 CurMaxIter,				// max allowed iterations per subsegmented sequence when matching that subsegment
+						 tsQueryCoreSeed *pCoreSeeds)	// if not NULL then cores previously located by LocateCoreSeeds(), as generated by GenQueryCoreSeeds()
 {
 UINT32 CurCoreSegOfs;				// current core segment relative start
 UINT32 IterCnt;					// count iterator for current segment target matches
@@ -6136,10 +6241,15 @@ do
 		if(((int)CurCoreSegOfs + CoreLen + CurCoreDelta) > ProbeLen)
 			CurCoreDelta = ProbeLen - (CurCoreSegOfs + CoreLen);
 
-		if(CoreLen <= cMaxKmerLen && OverOccKMerClas(CoreLen,&pProbeSeq[CurCoreSegOfs]) != 1)  // 1 if at least one instance and number of instances <= MaxKMerOccs
-			continue;
+		if(pCoreSeeds != NULL)		// cores already classified and located?
+			TargIdx = pCoreSeeds++->SfxIdx;
+		else
+			{
+			if(CoreLen <= cMaxKmerLen && OverOccKMerClas(CoreLen,&pProbeSeq[CurCoreSegOfs]) != 1)  // 1 if at least one instance and number of instances <= MaxKMerOccs
+				continue;
 
-		TargIdx = LocateFirstExact(&pProbeSeq[CurCoreSegOfs],CoreLen,pTarg,m_pSfxBlock->SfxElSize,pSfxArray,0,0,SfxLen-1);
+			TargIdx = LocateFirstExact(&pProbeSeq[CurCoreSegOfs],CoreLen,pTarg,m_pSfxBlock->SfxElSize,pSfxArray,0,0,SfxLen-1);
+			}
 		if(TargIdx == 0)        // 0 if no core segment matches - NOTE should have been picked up by OverOccKMerClas()!
 			continue;			// try for match on next core segment after shifting core to right
 
@@ -6321,6 +6431,317 @@ if(CurStrand == '-')									// restore probe sequence if had started processing
 return(NumMatches);				// MMDelta requirement met and within the multiple hits limit
 }
 
+//
+// GenQueryCoreSeeds
+// Generates the query cores which would be processed by LocateQuerySeqs() so these can be batch located by LocateCoreSeeds()
+int						// number of core seeds generated, or if pSeeds is NULL then number of seeds which would be generated, < 0 if errors
+CSfxArrayV3::GenQueryCoreSeeds(etSeqBase *pProbeSeq,	// probe
+						 etSeqBase *pRevCplSeq,			// probe reverse complemented, only required if aligning to the crick strand
+						 UINT32 ProbeLen,				// probe length
+						 UINT32 CoreLen,				// core window length
+						 UINT32 CoreDelta,				// core window offset increment (1..n)
+						 eALStrand Align2Strand,		// align to this strand
+						 int MaxSeeds,					// pSeeds can hold at most this many seeds
+						 tsQueryCoreSeed *pSeeds)		// generate seeds into this array in the same order as cores are processed by LocateQuerySeqs()
+{
+int NumSeeds;
+int StrandIdx;
+UINT32 CurCoreSegOfs;
+UINT32 CurCoreDelta;
+UINT32 Idx;
+UINT64 SortKey;
+etSeqBase *pSeq;
+etSeqBase *pCore;
+
+NumSeeds = 0;
+for(StrandIdx = 0; StrandIdx < 2; StrandIdx++)		// watson '+' strand cores are processed before any crick '-' strand cores
+	{
+	if(StrandIdx == 0)
+		{
+		if(Align2Strand == eALSCrick)
+			continue;
+		pSeq = pProbeSeq;
+		}
+	else
+		{
+		if(Align2Strand != eALSboth && Align2Strand != eALSCrick)
+			continue;
+		pSeq = pRevCplSeq;
+		}
+
+	CurCoreDelta = CoreDelta;
+	for(CurCoreSegOfs = 0;
+		CurCoreSegOfs < (UINT32)(ProbeLen - CoreLen); 
+	    CurCoreSegOfs += CurCoreDelta)
+		{
+		if(((int)CurCoreSegOfs + CoreLen + CurCoreDelta) > ProbeLen)
+			CurCoreDelta = ProbeLen - (CurCoreSegOfs + CoreLen);
+		if(pSeeds != NULL)
+			{
+			if(NumSeeds == MaxSeeds || pSeq == NULL)
+				return(eBSFerrParams);
+			pCore = &pSeq[CurCoreSegOfs];
+			SortKey = 0;
+			for(Idx = 0; Idx < (UINT32)cSfxSeedKeyBases; Idx++)
+				{
+				SortKey <<= 4;
+				if(Idx < CoreLen)
+					SortKey |= pCore[Idx] & 0x0f;
+				}
+			pSeeds[NumSeeds].SortKey = SortKey;
+			pSeeds[NumSeeds].pCore = pCore;
+			pSeeds[NumSeeds].SfxIdx = 0;
+			}
+		NumSeeds += 1;
+		}
+	}
+return(NumSeeds);
+}
+
+//
+// LocateCoreSeeds
+// Batch locates core seeds, from any number of query sequences, in the suffix array
+// Seeds are sorted so that identical cores are only located once and neighbouring searches share the upper levels of the suffix array,
+// then located by interleaved binary searches with the suffix elements and targeted sequences for the next probes prefetched
+int						// number of core seeds with at least one exact match, < 0 if errors
+CSfxArrayV3::LocateCoreSeeds(UINT32 CoreLen,			// core length
+						 int NumSeeds,					// number of seeds in pSeeds
+						 tsQueryCoreSeed *pSeeds,		// seeds, from any number of query sequences, to be located
+						 tsQueryCoreSeed **ppSorted)	// caller allocated to hold NumSeeds ptrs, used when sorting seeds
+{
+int SeedIdx;
+int NumSorted;
+int NumLanes;
+int NumLocated;
+tsQueryCoreSeed *pSeed;
+tsQueryCoreSeed *pPrevSeed;
+tsQueryCoreSeed *Lanes[cSfxSeedLanes];
+
+etSeqBase *pTarg;			// target sequence
+void *pSfxArray;			// target sequence suffix array
+INT64 SfxLen;				// number of suffixs in pSfxArray
+
+// ensure suffix array block loaded for iteration!
+if(m_pSfxBlock == NULL || m_pSfxBlock->ConcatSeqLen == 0)
+	return(eBSFerrInternal);
+
+pTarg = (etSeqBase *)&m_pSfxBlock->SeqSuffix[0];
+pSfxArray = (void *)&m_pSfxBlock->SeqSuffix[m_pSfxBlock->ConcatSeqLen];
+SfxLen = m_pSfxBlock->ConcatSeqLen;
+
+// over-occurring cores are not located
+NumSorted = 0;
+pSeed = pSeeds;
+for(SeedIdx = 0; SeedIdx < NumSeeds; SeedIdx++,pSeed++)
+	{
+	pSeed->SfxIdx = 0;
+	if(CoreLen <= cMaxKmerLen && OverOccKMerClas(CoreLen,pSeed->pCore) != 1)  // 1 if at least one instance and number of instances <= MaxKMerOccs
+		continue;
+	ppSorted[NumSorted++] = pSeed;
+	}
+if(NumSorted == 0)
+	return(0);
+if(NumSorted > 1)
+	qsort(ppSorted,NumSorted,sizeof(tsQueryCoreSeed *),QSortCoreSeeds);
+
+// locate unique cores, cores identical to the immediately preceding core are resolved after all unique cores located
+NumLanes = 0;
+pPrevSeed = NULL;
+for(SeedIdx = 0; SeedIdx < NumSorted; SeedIdx++)
+	{
+	pSeed = ppSorted[SeedIdx];
+	if(pPrevSeed != NULL && pPrevSeed->SortKey == pSeed->SortKey && !memcmp(pPrevSeed->pCore,pSeed->pCore,CoreLen))
+		continue;
+	pPrevSeed = pSeed;
+	if(m_bBisulfite)
+		{
+		pSeed->SfxIdx = LocateFirstExact(pSeed->pCore,CoreLen,pTarg,m_pSfxBlock->SfxElSize,pSfxArray,0,0,SfxLen-1);
+		continue;
+		}
+	Lanes[NumLanes++] = pSeed;
+	if(NumLanes == cSfxSeedLanes)
+		{
+		LocateSeedLanes(CoreLen,NumLanes,Lanes,pTarg,m_pSfxBlock->SfxElSize,pSfxArray,SfxLen);
+		NumLanes = 0;
+		}
+	}
+if(NumLanes)
+	LocateSeedLanes(CoreLen,NumLanes,Lanes,pTarg,m_pSfxBlock->SfxElSize,pSfxArray,SfxLen);
+
+NumLocated = 0;
+pPrevSeed = NULL;
+for(SeedIdx = 0; SeedIdx < NumSorted; SeedIdx++)
+	{
+	pSeed = ppSorted[SeedIdx];
+	if(pPrevSeed != NULL && pPrevSeed->SortKey == pSeed->SortKey && !memcmp(pPrevSeed->pCore,pSeed->pCore,CoreLen))
+		pSeed->SfxIdx = pPrevSeed->SfxIdx;
+	if(pSeed->SfxIdx != 0)
+		NumLocated += 1;
+	pPrevSeed = pSeed;
+	}
+return(NumLocated);
+}
+
+typedef struct TAG_sSfxSeedLane {
+	tsQueryCoreSeed *pSeed;		// seed being located
+	int Phase;					// 0 if completed, 1 if locating any exact match, 2 if locating lowest indexed exact match
+	INT64 SfxLo;				// current low index in suffix array
+	INT64 SfxHi;				// current high index in suffix array
+	INT64 Mark;					// lowest indexed exact match thus far
+	INT64 TargPsn;				// suffix array index currently being compared
+	etSeqBase *pTargBase;		// targeted sequence suffix at TargPsn
+} tsSfxSeedLane;
+
+//
+// LocateSeedLanes
+// Concurrently locates seeds with the same binary search sequence as LocateFirstExact(), but with the searches interleaved so that
+// suffix element and targeted sequence loads for all lanes are prefetched and are outstanding together instead of serially stalling
+void
+CSfxArrayV3::LocateSeedLanes(int CoreLen,			// core length
+				  int NumLanes,					// concurrently locate this many seeds
+				  tsQueryCoreSeed **ppLanes,	// seeds to locate
+				  etSeqBase *pTarg,				// target sequence
+				  int SfxElSize,				// size in bytes of suffix element - expected to be either 4 or 5
+				  void *pSfxArray,				// target sequence suffix array
+				  INT64 SfxLen)					// number of suffixs in pSfxArray
+{
+tsSfxSeedLane Lanes[cSfxSeedLanes];
+tsSfxSeedLane *pLane;
+int LaneIdx;
+int NumActive;
+int CmpRslt;
+int Ofs;
+etSeqBase *pEl1;
+etSeqBase *pEl2;
+UINT8 El1;
+UINT8 El2;
+
+if(NumLanes > cSfxSeedLanes)
+	NumLanes = cSfxSeedLanes;
+pLane = Lanes;
+for(LaneIdx = 0; LaneIdx < NumLanes; LaneIdx++,pLane++)
+	{
+	pLane->pSeed = ppLanes[LaneIdx];
+	pLane->pSeed->SfxIdx = 0;
+	pLane->Phase = 1;
+	pLane->SfxLo = 0;
+	pLane->SfxHi = SfxLen - 1;
+	pLane->Mark = 0;
+	}
+
+NumActive = NumLanes;
+while(NumActive)
+	{
+	// bisect and prefetch suffix elements
+	pLane = Lanes;
+	for(LaneIdx = 0; LaneIdx < NumLanes; LaneIdx++,pLane++)
+		{
+		if(!pLane->Phase)
+			continue;
+		pLane->TargPsn = ((INT64)pLane->SfxLo + pLane->SfxHi) / 2L;
+		SfxPrefetch(&((UINT8 *)pSfxArray)[pLane->TargPsn * SfxElSize]);
+		}
+
+	// prefetch the targeted sequences
+	pLane = Lanes;
+	for(LaneIdx = 0; LaneIdx < NumLanes; LaneIdx++,pLane++)
+		{
+		if(!pLane->Phase)
+			continue;
+		pLane->pTargBase = &pTarg[SfxOfsToLoci(SfxElSize,pSfxArray,pLane->TargPsn)];
+		SfxPrefetch(pLane->pTargBase);
+		}
+
+	// compare and narrow
+	pLane = Lanes;
+	for(LaneIdx = 0; LaneIdx < NumLanes; LaneIdx++,pLane++)
+		{
+		if(!pLane->Phase)
+			continue;
+		pEl1 = pLane->pSeed->pCore;
+		pEl2 = pLane->pTargBase;
+		CmpRslt = 0;
+		for(Ofs=0; Ofs < CoreLen; Ofs++)
+			{
+			El2 = *pEl2++ & 0x0f;
+			if(El2 == eBaseEOS)
+				{
+				CmpRslt = -1;
+				break;
+				}
+			El1 = *pEl1++ & 0x0f;
+			if(El1 > El2)
+				{
+				CmpRslt = 1;
+				break;
+				}
+			if(El1 < El2)
+				{
+				CmpRslt = -1;
+				break;
+				}
+			}
+
+		if(pLane->Phase == 1)		// locating any exact match
+			{
+			if(!CmpRslt)
+				{
+				if(pLane->TargPsn == 0 || pLane->SfxLo == pLane->TargPsn) // check if already lowest
+					{
+					pLane->pSeed->SfxIdx = pLane->TargPsn + 1;
+					pLane->Phase = 0;
+					}
+				else
+					{
+					pLane->Mark = pLane->TargPsn;
+					pLane->SfxHi = pLane->TargPsn - 1;
+					pLane->Phase = 2;
+					}
+				}
+			else
+				{
+				if(CmpRslt < 0)
+					{
+					if(pLane->TargPsn == 0)
+						pLane->Phase = 0;
+					else
+						pLane->SfxHi = pLane->TargPsn - 1;
+					}
+				else
+					pLane->SfxLo = pLane->TargPsn + 1;
+				if(pLane->Phase && pLane->SfxHi < pLane->SfxLo)
+					pLane->Phase = 0;		// unable to locate any instance
+				}
+			}
+		else						// locating lowest indexed exact match
+			{
+			if(!CmpRslt)
+				{
+				pLane->Mark = pLane->TargPsn;
+				if(pLane->Mark == 0)
+					{
+					pLane->pSeed->SfxIdx = 1;
+					pLane->Phase = 0;
+					}
+				else
+					pLane->SfxHi = pLane->TargPsn - 1;
+				}
+			else
+				{
+				pLane->SfxLo = pLane->TargPsn + 1;
+				if(pLane->SfxLo == pLane->Mark)
+					{
+					pLane->pSeed->SfxIdx = pLane->Mark + 1;
+					pLane->Phase = 0;
+					}
+				}
+			}
+		if(!pLane->Phase)
+			NumActive -= 1;
+		}
+	}
+}
+
 
 // LocateBestMatches
 // Locate, at most MaxHits, alignments having no more than MaxTotMM mismatches, additional matches are sloughed
@@ -9210,3 +9631,17 @@ tsSfxEntry *pE2 = *(tsSfxEntry **)p2;
 
 return(stricmp((char *)pE1->szSeqName,(char *)pE2->szSeqName));
 }
+
+// QSortCoreSeeds
+// qsorts ptrs to core seeds on their packed leading bases
+static int QSortCoreSeeds(const void *p1,const void *p2)
+{
+tsQueryCoreSeed *pS1 = *(tsQueryCoreSeed **)p1;
+tsQueryCoreSeed *pS2 = *(tsQueryCoreSeed **)p2;
+
+if(pS1->SortKey < pS2->SortKey)
+	return(-1);
+if(pS1->SortKey > pS2->SortKey)
+	return(1);
+return(0);
+}
@@ -11,6 +11,8 @@ const int cSigTermWaitSecs = 2;			// background readahead thread is allowed at m
 
 const int cDfltMaxIter = 50000;			// default max iterations per subsegmented sequence when matching that subsegment
 const int cMaxKmerLen = 18;				// limit on length of KMers which can be frequency counted when checking for over-occurrences
+const int cSfxSeedLanes = 16;			// batched core seeds are located by interleaving this many concurrent suffix array binary searches
+const int cSfxSeedKeyBases = 16;		// batched core seeds are sorted on a key containing at most this many leading core bases
 
 const int cMaxNumIdentNodes = 1024000;	// allow at most this many TargSeqIDs to be hash linked per thread
 const int cHashEntries = 0x03fff;		// TargSeqID start loci are hashed into this many entries
@@ -144,6 +146,12 @@ typedef struct TAG_sQueryAlignNodes {
 	UINT32 HiScorePathNextIdx;							// if > 0 then idex-1 of next node on currently highest scoring path; 0 if no other nodes on path
 } tsQueryAlignNodes;
 
+typedef struct TAG_sQueryCoreSeed {
+	UINT64 SortKey;										// packed leading core bases, seeds are located in key order so neighbouring searches share suffix array paths
+	etSeqBase *pCore;									// core sequence
+	INT64 SfxIdx;										// returned index+1 in suffix array of first exactly matching suffix, 0 if no match or core over-occurring
+} tsQueryCoreSeed;
+
 typedef struct TAG_sQualTarg {
 	UINT32 TargEntryID;		// identifies sequence
 	UINT8  Hits;			// against which there are this many hits (clamped to be at most 255)
@@ -298,6 +306,7 @@ class CSfxArrayV3 : public CErrorCodes, protected CEndian
 	friend class CLocKMers;
 	friend class CMarkerKMers;
 	bool m_bInMemSfx;							// true if in-memory suffix processing only - no file I/O
+	bool m_bReplica;							// true if this instance is a query only replica sharing entries with the instance from which it was replicated
 	int m_hFile;							    // opened/created file handle
 	bool m_bV3File;								// suffix file opened was a V3 file
 	char m_szFile[_MAX_PATH+1];				    // file name as opened/created
@@ -417,6 +426,14 @@ static	void *ThreadedPrereadBlocks(void * pThreadPars);
 				  INT64 SfxLo,					// low index in pSfxArray
 				  INT64 SfxHi);					// high index in pSfxArray
 
+	void LocateSeedLanes(int CoreLen,			// core length
+				  int NumLanes,					// concurrently locate this many seeds
+				  tsQueryCoreSeed **ppLanes,	// seeds to locate
+				  etSeqBase *pTarg,				// target sequence
+				  int SfxElSize,				// size in bytes of suffix element - expected to be either 4 or 5
+				  void *pSfxArray,				// target sequence suffix array
+				  INT64 SfxLen);				// number of suffixs in pSfxArray
+
 	INT64			// index+1 in pSfxArray of last exactly matching probe or 0 if no match
 		LocateLastExact(etSeqBase *pProbe, // pts to probe sequence
 				  int ProbeLen,					// probe length to exactly match over
@@ -500,6 +517,10 @@ public:
 
 	int Close(bool bFlush = true);			// closes opened file
 
+	// Replicate the currently loaded suffix block for query only use, e.g. alignments, with the replica's pages placed on NUMANode
+	// Replicas share entries with this instance so must be deleted before this instance is reset or deleted
+	CSfxArrayV3 *Replicate(int NUMANode);	// returns replica or NULL if unable to replicate
+
     // obtain a copy of the header for external diagnostics
 	tsSfxHeaderV3 *GetSfxHeader(tsSfxHeaderV3 *pCopyTo);
 
@@ -735,7 +756,24 @@ public:
 						 UINT32 MinMatchLen,			// putative alignments must be at least this length
 						 UINT32 MaxHits,				// (IN) process for at most this number of hits
 						 tsQueryAlignNodes *pHits,		// where to return hits (at most MaxHits)
-						 UINT32 CurMaxIter);			// max allowed iterations per subsegmented sequence when matching that subsegment
+						 UINT32 CurMaxIter,				// max allowed iterations per subsegmented sequence when matching that subsegment
+						 tsQueryCoreSeed *pCoreSeeds = NULL);	// if not NULL then cores previously located by LocateCoreSeeds(), as generated by GenQueryCoreSeeds()
+
+		int						// number of core seeds generated, or if pSeeds is NULL then number of seeds which would be generated, < 0 if errors
+			GenQueryCoreSeeds(etSeqBase *pProbeSeq,		// probe
+						 etSeqBase *pRevCplSeq,			// probe reverse complemented, only required if aligning to the crick strand
+						 UINT32 ProbeLen,				// probe length
+						 UINT32 CoreLen,				// core window length
+						 UINT32 CoreDelta,				// core window offset increment (1..n)
+						 eALStrand Align2Strand,		// align to this strand
+						 int MaxSeeds,					// pSeeds can hold at most this many seeds
+						 tsQueryCoreSeed *pSeeds);		// generate seeds into this array in the same order as cores are processed by LocateQuerySeqs()
+
+		int						// number of core seeds with at least one exact match, < 0 if errors
+			LocateCoreSeeds(UINT32 CoreLen,				// core length
+						 int NumSeeds,					// number of seeds in pSeeds
+						 tsQueryCoreSeed *pSeeds,		// seeds, from any number of query sequences, to be located
+						 tsQueryCoreSeed **ppSorted);	// caller allocated to hold NumSeeds ptrs, used when sorting seeds
 
 			
 	int						// < 0 if errors, 0 if no matches, 1..MaxHits, or MaxHits+1 if additional matches have been sloughed
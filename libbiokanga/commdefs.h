@@ -220,4 +220,62 @@ typedef struct TAG_sRawReadV6 {
 	UINT8  Read[1];				// descriptor followed by packed read + phred score (read in bits 0..2, phred in 3..7)
 } tsRawReadV6;
 
+// V7 reads files are block indexed
+// Reads, in ReadID order, are written into blocks of at most cRdsV7BlockSize bytes with each block starting on a cRdsV7BlockAlign file offset
+// so blocks can be memory mapped and independently processed. Within a block the fixed size read records are followed by the descriptors,
+// the 2bit packed sequences, the sidecar 5bit packed phred quality scores, and runs of indeterminate bases.
+// A block directory, one tsRdsV7BlockDir per block, is written following the last block and is located through the tsRdsV7Hdr which immediately follows tsBSFRdsHdr
+const int cRdsV7BlockSize = 0x0800000;			// blocks are at most this many bytes (8MB)
+const int cRdsV7BlockAlign = 0x010000;			// blocks start at file offsets which are multiples of this (64K, also the Windows mapping granularity)
+
+typedef struct TAG_sRdsV7Hdr {
+	INT32 BlockSize;			// blocks are at most this many bytes
+	INT32 BlockAlign;			// blocks start at file offsets which are multiples of this
+	INT32 NumBlocks;			// number of blocks
+	INT64 BlockDirOfs;			// block directory starts at this file offset
+	INT64 TotBases;				// total number of bases over all reads
+	INT32 MinReadLen;			// shortest read length
+	INT32 MaxReadLen;			// longest read length
+} tsRdsV7Hdr;
+
+typedef struct TAG_sRdsV7BlockDir {
+	INT64 FileOfs;				// block starts at this file offset
+	INT32 BlockLen;				// block is this many bytes
+	UINT32 StartReadID;			// first read in block has this identifier, following reads in block have sequentially incremented identifiers
+	INT32 NumReads;				// block contains this many reads
+	INT32 MinReadLen;			// shortest read length in block
+	INT32 MaxReadLen;			// longest read length in block
+	INT32 TotDescrLen;			// total length of descriptors in block (excluding '\0' terminators)
+	INT32 NumNBases;			// total number of indeterminate bases in block
+	INT64 TotBases;				// total number of bases in block
+} tsRdsV7BlockDir;
+
+typedef struct TAG_sRdsV7Block {
+	UINT32 StartReadID;			// first read in block has this identifier
+	INT32 NumReads;				// block contains this many tsRdsV7Read's which immediately follow this block header
+	INT32 BlockLen;				// block is this many bytes, including this header
+	INT32 DescrsOfs;			// '\0' terminated descriptors start at this block offset
+	INT32 SeqsOfs;				// 2bit packed (4 bases per byte, 1st base in bits 0..1) concatenated sequences start at this block offset
+	INT32 QualsOfs;				// 5bit packed phred scores (1st score in bits 0..4) start at this block offset, 0 if all phred scores in block are 0
+	INT32 NRunsOfs;				// runs of indeterminate bases start at this block offset
+	INT32 NumNRuns;				// number of tsRdsV7NRun's
+} tsRdsV7Block;
+
+typedef struct TAG_sRdsV7Read {
+	UINT32 PairReadID;			// this read's paired raw read identifier (0 if not a paired read) bit32 reset if 5' fwd read, bit32 set if 3' read of pair
+	UINT32 NumReads;			// number of source reads merged into this read
+	UINT8 FileID;				// identifies file from which this read was parsed
+	UINT8 DescrLen;				// descriptor length
+	UINT16 ReadLen;				// read length
+	INT32 DescrOfs;				// descriptor starts at this offset relative to DescrsOfs
+	INT32 SeqOfs;				// read starts at this base offset relative to both SeqsOfs and QualsOfs
+	INT32 NRunIdx;				// index of read's first indeterminate run
+	INT32 NumNRuns;				// read has this many indeterminate runs
+} tsRdsV7Read;
+
+typedef struct TAG_sRdsV7NRun {
+	INT32 SeqOfs;				// run starts at this base offset relative to SeqsOfs
+	INT32 Len;					// run is this many bases
+} tsRdsV7NRun;
+
 #pragma pack()
\ No newline at end of file
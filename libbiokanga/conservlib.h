@@ -10,6 +10,8 @@
 #include "./SeqTrans.h"
 #include "./Diagnostics.h"
 #include "./MTqsort.h"
+#include "./MemArena.h"
+#include "./NUMATopology.h"
 #include "./Fasta.h"
 #include "./BEDfile.h"
 #include "./BioSeqFile.h"
@@ -47,6 +49,9 @@
 #include "./SimpleGlob.h"
 #include "./Contaminants.h"
 #include "./ProcRawReads.h"
+#include "./ReadsIngest.h"
+#include "./RdsBlocks.h"
+#include "./FastaIdx.h"
 #include "./GTFFile.h"
 #include "./GFFFile.h"
 #include "./sqlite3.h"
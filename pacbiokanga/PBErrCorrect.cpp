@@ -2564,6 +2564,7 @@ CPBErrCorrect::Process(etPBPMode PMode,		// processing mode
 {
 int Rslt = eBSFSuccess;
 int Idx;
+int PhaseID;							// telemetry phase identifier as returned by gSQLiteSummaries.StartPhase()
 UINT32 NumTargSeqs;
 UINT32 CurNodeID;
 UINT32 MaxSeqLen;
@@ -2801,6 +2802,7 @@ else
 	Adapter3Seq[0] = eBaseEOS;
 	}
 
+PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"LoadSeqs") : 0;
 if((Rslt = LoadSeqs(m_MinPBSeqOverlap,m_MaxPBRdSeqLen, Adapter5Len,Adapter5Seq,Adapter3Len,Adapter3Seq,NumPacBioFiles,pszPacBioFiles,cFlgLCSeq)) < eBSFSuccess)
 	{
 	Reset();
@@ -2845,6 +2847,12 @@ if(NumHCSeqs > 0)
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"CreateBioseqSuffixFile: sorting suffix array...");
 m_pSfxArray->Finalise();
 gDiagnostics.DiagOut(eDLInfo,gszProcName,"CreateBioseqSuffixFile: sorting completed");
+if(PhaseID > 0)
+	{
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"PacBioSeqs",m_NumAcceptTargSeqs);
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"HiConfSeqs",NumHCSeqs);
+	gSQLiteSummaries.EndPhase(PhaseID);
+	}
 
 if(MinSeedCoreLen <= cMaxKmerLen)
 	{
@@ -3278,7 +3286,16 @@ if(m_bRMI)
 	}
 else
 	MaxWorkerThreads = m_NumOvlpCores;
+PhaseID = gProcessingID > 0 ? gSQLiteSummaries.StartPhase(gProcessingID,"Overlap") : 0;
 Rslt = IdentifySequenceOverlaps(MaxSeqLen,m_NumOvlpCores,MaxWorkerThreads);
+if(PhaseID > 0)
+	{
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"Processed",m_NumOverlapProcessed);
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"SWAligned",m_ProvSWchecked);
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"Overlapped",m_ProvOverlapped);
+	gSQLiteSummaries.AddPhaseSample(PhaseID,"Contained",m_ProvContained);
+	gSQLiteSummaries.EndPhase(PhaseID);
+	}
 #ifdef _DEBUG
 #ifdef _WIN32
 _ASSERTE( _CrtCheckMemory());
@@ -11,6 +11,10 @@ const int cMaxTextBuff = 4000;			// buffer upto this length results values text
 const int cMaxNameLen = 50;				// maximum experiment/process/groupas name length
 const int cMaxDescrText = 1000;			// max length descriptive text
 const int cMaxSQLStatement = 500;		// allow for this length SQL statements
+const int cNumSummTbls = 9;				// number of tables in summary database schema
+
+const int cMaxSummPhases = 64;			// at most this many processing phases can be concurrently active
+const int cMaxSummPhaseCounters = 32;	// each phase can aggregate samples for at most this many named counters
 
 typedef enum eSQLliteSummParamTypes {
 	 ePTBool = 0,
@@ -32,11 +36,30 @@ typedef struct TAG_sSummStmsSQL {
 	char *pszDropIndexes;			// SQL statement used to drop indexes on this table
 } tsSummStmSQL;
 
+typedef struct TAG_sSummPhaseCounter {
+	char szName[cMaxNameLen+1];		// counter name
+	INT64 Total;					// sum of all sample values
+	INT64 NumSamples;				// number of samples aggregated
+	INT64 MinSample;				// minimum sample value
+	INT64 MaxSample;				// maximum sample value
+} tsSummPhaseCounter;
+
+typedef struct TAG_sSummPhase {
+	int ProcessingID;				// phase is part of this processing instance, 0 if phase slot is unused
+	char szName[cMaxNameLen+1];		// phase name
+	char szStart[cMaxNameLen];		// timestamp at which phase was started
+	INT64 StartUSecs;				// monotonic clock, in microseconds, at which phase was started
+	int NumCounters;				// number of counters in use
+	tsSummPhaseCounter Counters[cMaxSummPhaseCounters];	// counters with samples aggregated during this phase
+} tsSummPhase;
+
 class CSQLiteSummaries
 {
 	bool m_bInitialised;				// set true after successful initialisation during class construction
 	sqlite3 *m_pDB;						// pts to instance of SQLite
-	static tsSummStmSQL m_StmSQL[7];	// SQLite table and index statements
+	static tsSummStmSQL m_StmSQL[cNumSummTbls];	// SQLite table and index statements
+
+	tsSummPhase m_Phases[cMaxSummPhases];	// currently active phases, samples are aggregated in memory and written to database when phase ends
 
 	
 	char *RemoveQuotes(char *pszRawText);	// remove quotes which may be a risk for aql injection attacks...
@@ -70,6 +93,16 @@ class CSQLiteSummaries
 	inline void SQLiteSerialise(void);	// serialise access to SQLite functionality
 	inline void SQLiteRelease(void);
 
+#ifdef _WIN32
+	CRITICAL_SECTION m_hPhaseCritSect;	// used to serialise access to phase samples
+#else
+	pthread_spinlock_t m_hPhaseSpinLock;	// used to serialise access to phase samples
+#endif
+	inline void PhaseSerialise(void);	// serialise access to phase samples, independent of SQLite serialisation so aggregating samples never waits on database I/O
+	inline void PhaseRelease(void);
+
+	static INT64 GetMonotonicUSecs(void);	// returns monotonic clock in microseconds
+
 public:
 	CSQLiteSummaries(void);
 	~CSQLiteSummaries(void);
@@ -123,6 +156,23 @@ public:
 						 const char *pszResultYName,	// result Y name
 						 void *pResultYValue);			// result Y value
 
+	// Phase telemetry - elapsed time, peak resident memory and named counters are recorded for each phase in TblPhases and TblPhaseCounters
+	// Samples are aggregated in memory; worker threads would normally accumulate their own counts and add these as a single sample per thread
+	// when the thread completes, so that the Min/Max over samples expose any imbalance between threads
+	int												// returned phase identifier, < 0 if errors
+			StartPhase(int ProcessingID,			// identifier returned by StartProcessing()
+						const char *pszPhaseName);	// phase name
+
+	int
+			AddPhaseSample(int PhaseID,				// identifier returned by StartPhase()
+						const char *pszCounterName,	// sample is for this counter
+						INT64 Value);				// sample value
+
+	int												// database identifier of phase row in TblPhases, < 0 if errors
+			EndPhase(int PhaseID);					// identifier returned by StartPhase()
+
+	static INT64 GetPeakRSSKB(void);				// returns peak resident set size (KB) of this process
+
 	int					// returned process identifier
 			EndProcessing(int ProcessingID,					// identifier returned by StartProcessing()
 						  int ResultCode);					// processing result code